@@ -484,6 +484,70 @@ void loadData(PDBClient & pdbClient, std::string fileName, std::string dataType)
 }
 
 
+// Loads a file with BULK_LOAD_THREADS threads, each making the objects of the lines that start in
+// its part of the file, on pages that go straight to the storage of the workers
+void bulkLoadData(PDBClient & pdbClient, std::string fileName, std::string dataType,
+                  std::string setName) {
+
+    std::cout << "to bulk load data from " << fileName << " for type " << dataType << std::endl;
+    struct stat fileStat;
+    if (stat(fileName.c_str(), &fileStat) != 0) {
+        cout << "file: " << fileName.c_str() << ", can't be open! "  << endl;
+        exit(-1);
+    }
+    int numThreads = BULK_LOAD_THREADS;
+    size_t fileSize = fileStat.st_size;
+
+    // the part of the file of a thread, and the line that did not fit in the last page
+    struct FilePart {
+        std::ifstream infile;
+        size_t end;
+        std::string line;
+        bool rollback = false;
+        int numObjects = 0;
+    };
+    std::vector<FilePart> parts(numThreads);
+    for (int i = 0; i < numThreads; i++) {
+        size_t begin = fileSize / numThreads * i;
+        parts[i].end = (i == numThreads - 1) ? fileSize : fileSize / numThreads * (i + 1);
+        parts[i].infile.open(fileName.c_str());
+        if (begin > 0) {
+            // skip the line that starts in the part before
+            parts[i].infile.seekg(begin - 1);
+            std::getline(parts[i].infile, parts[i].line);
+        }
+    }
+
+    std::function<bool(int, Handle<Vector<Handle<Object>>>)> filler =
+        [&](int threadId, Handle<Vector<Handle<Object>>> objects) {
+        FilePart& part = parts[threadId];
+        while (1) {
+            if (!part.rollback) {
+                if (((size_t)part.infile.tellg() >= part.end) ||
+                    !std::getline(part.infile, part.line)) {
+                    return false;
+                }
+                part.rollback = true;
+            }
+            objects->push_back(createObject(part.line, dataType));
+            part.rollback = false;
+            part.numObjects++;
+        }
+    };
+    pdbClient.bulkLoad<Object>(std::pair<std::string, std::string>(setName, "tpch"),
+                               filler,
+                               (size_t)64*(size_t)1024*(size_t)1024,
+                               numThreads);
+
+    int numObjects = 0;
+    for (int i = 0; i < numThreads; i++) {
+        numObjects += parts[i].numObjects;
+        parts[i].infile.close();
+    }
+    std::cout << "loaded " << numObjects << " " << dataType << " objects" << std::endl;
+}
+
+
 int main(int argc, char* argv[]) {
 
     std::string tpchDirectory = "";
@@ -519,10 +583,17 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    if ((argc > 6) || (argc == 1)) {
+    bool whetherToBulkLoad = false;
+    if (argc > 6) {
+        if (strcmp(argv[6], "Y") == 0) {
+           whetherToBulkLoad = true;
+        }
+    }
+
+    if ((argc > 7) || (argc == 1)) {
        std::cout << "Usage: #tpchDirectory #whetherToRegisterLibraries (Y/N)" 
                  << " #whetherToCreateSets (Y/N) #whetherToAddData (Y/N)"
-                 << " #whetherToRemoveData (Y/N)" << std::endl;
+                 << " #whetherToRemoveData (Y/N) #whetherToBulkLoad (Y/N)" << std::endl;
     }
 
     // Connection info
@@ -548,7 +619,20 @@ int main(int argc, char* argv[]) {
         createSets (pdbClient);
     }
 
-    if (whetherToAddData == true) {
+    if ((whetherToAddData == true) && (whetherToBulkLoad == true)) {
+        bulkLoadData(pdbClient, tpchDirectory + "/customer.tbl", "TPCHCustomer", "customer");
+        bulkLoadData(pdbClient, tpchDirectory + "/lineitem.tbl", "TPCHLineItem", "lineitem");
+        bulkLoadData(pdbClient, tpchDirectory + "/nation.tbl", "TPCHNation", "nation");
+        bulkLoadData(pdbClient, tpchDirectory + "/orders.tbl", "TPCHOrder", "order");
+        bulkLoadData(pdbClient, tpchDirectory + "/part.tbl", "TPCHPart", "part");
+        bulkLoadData(pdbClient, tpchDirectory + "/partsupp.tbl", "TPCHTPCHPartSupp", "partsupp");
+        bulkLoadData(pdbClient, tpchDirectory + "/region.tbl", "TPCHRegion", "region");
+        bulkLoadData(pdbClient, tpchDirectory + "/supplier.tbl", "TPCHSupplier", "supplier");
+
+        std::cout << "to flush data to disk" << std::endl;
+        pdbClient.flushData();
+
+    } else if (whetherToAddData == true) {
         loadData(pdbClient, tpchDirectory + "/customer.tbl", "TPCHCustomer");
         loadData(pdbClient, tpchDirectory + "/lineitem.tbl", "TPCHLineItem");
         loadData(pdbClient, tpchDirectory + "/nation.tbl", "TPCHNation");
@@ -34,11 +34,14 @@ AggregationMap<KeyType, ValueType>::AggregationMap(uint32_t initSize) {
         initSize = 2;
     }
 
+    // the number of slots is a power of two
+    initSize = PairArray<KeyType, ValueType>::getNumSlots(initSize);
+
     // this way, we'll allocate extra bytes on the end of the array
     MapRecordClass<KeyType, ValueType> temp;
     size_t size = temp.getObjSize();
-    this->myArray =
-        makeObjectWithExtraStorage<PairArray<KeyType, ValueType>>(size * initSize, initSize);
+    this->myArray = makeObjectWithExtraStorage<PairArray<KeyType, ValueType>>(
+        PairArray<KeyType, ValueType>::getStorageSize(size, initSize), initSize);
 }
 
 template <class KeyType, class ValueType>
@@ -46,7 +49,8 @@ AggregationMap<KeyType, ValueType>::AggregationMap() {
 
     MapRecordClass<KeyType, ValueType> temp;
     size_t size = temp.getObjSize();
-    this->myArray = makeObjectWithExtraStorage<PairArray<KeyType, ValueType>>(size * 2, 2);
+    this->myArray = makeObjectWithExtraStorage<PairArray<KeyType, ValueType>>(
+        PairArray<KeyType, ValueType>::getStorageSize(size, 2), 2);
 }
 
 template <class KeyType, class ValueType>
@@ -23,12 +23,15 @@
 #include "ComputePlan.h"
 #include "FilterExecutor.h"
 #include "HashOneExecutor.h"
+#include "RuntimeFilterExecutor.h"
 #include "FlattenExecutor.h"
 #include "AtomicComputationClasses.h"
 #include "EqualsLambda.h"
 #include "AbstractJoinComp.h"
 #include "Lexer.h"
 #include "Parser.h"
+#include "PDBDebug.h"
+#include <algorithm>
 
 extern int yydebug;
 
@@ -76,6 +79,69 @@ inline void ComputePlan::nullifyPlanPointer() {
     myPlan = nullptr;
 }
 
+inline void ComputePlan::setFusePipelines(bool fusePipelines) {
+    this->fusePipelines = fusePipelines;
+}
+
+inline bool ComputePlan::getFusePipelines() {
+    return fusePipelines;
+}
+
+inline ComputeExecutorPtr ComputePlan::getFusedExecutor(
+    std::vector<std::string>& buildTheseTupleSets, std::map<std::string, ComputeInfoPtr>& params) {
+
+    AtomicComputationList& allComps = myPlan->getComputations();
+    AtomicComputationPtr source = allComps.getProducingAtomicComputation(buildTheseTupleSets[0]);
+    AtomicComputationPtr first = allComps.getProducingAtomicComputation(buildTheseTupleSets[1]);
+    AtomicComputationPtr last = allComps.getProducingAtomicComputation(buildTheseTupleSets.back());
+    if (source == nullptr || first == nullptr || last == nullptr) {
+        return nullptr;
+    }
+    std::string computationName = first->getComputationName();
+
+    // every stage has to be an APPLY or a FILTER of the same computation, without parameters
+    for (int i = 1; i < buildTheseTupleSets.size(); i++) {
+        AtomicComputationPtr a = allComps.getProducingAtomicComputation(buildTheseTupleSets[i]);
+        if (a == nullptr || a->getComputationName() != computationName ||
+            params.count(a->getOutput().getSetName()) != 0) {
+            return nullptr;
+        }
+        std::string type = a->getAtomicComputationType();
+        if (type != "Apply" && type != "Filter") {
+            return nullptr;
+        }
+    }
+
+    // and the pipeline has to cover all of the stages of that computation
+    if (source->getComputationName() == computationName) {
+        return nullptr;
+    }
+    for (auto& consumer : allComps.getConsumingAtomicComputations(last->getOutputName())) {
+        if (consumer->getComputationName() == computationName) {
+            return nullptr;
+        }
+    }
+
+    // the first stage has to work on the objects of the source, and the loop can only carry over
+    // the columns of the source, not the ones that the stages create
+    std::vector<std::string>& sourceAtts = source->getOutput().getAtts();
+    if (first->getInput().getAtts().size() != 1) {
+        return nullptr;
+    }
+    std::vector<std::string> neededAtts = last->getProjection().getAtts();
+    neededAtts.push_back(first->getInput().getAtts()[0]);
+    for (auto& att : neededAtts) {
+        if (std::find(sourceAtts.begin(), sourceAtts.end(), att) == sourceAtts.end()) {
+            return nullptr;
+        }
+    }
+
+    // ask the computation for the loop
+    return myPlan->getNode(computationName)
+        .getComputation()
+        .getFusedExecutor(source->getOutput(), first->getInput(), last->getProjection());
+}
+
 // this does a DFS, trying to find a list of computations that lead to the specified computation
 inline bool recurse(LogicalPlanPtr myPlan,
                     std::vector<AtomicComputationPtr>& listSoFar,
@@ -407,10 +473,26 @@ inline PipelinePtr ComputePlan::buildPipeline(std::vector<std::string> buildThes
             .getComputation()
             .getComputeSink(targetSpec, targetAttsToOpOn, targetProjection, *this);
 
+    // a sink that shuffles by hash counts the tuples it sends to every partition for the stage
+    if ((computeSink != nullptr) && (params.count(ShuffleSkew::getParamName()) != 0)) {
+        computeSink->setShuffleSkew(
+            std::dynamic_pointer_cast<ShuffleSkew>(params[ShuffleSkew::getParamName()]));
+    }
+
     // make the pipeline
     PipelinePtr returnVal = std::make_shared<Pipeline>(
         getPage, discardTempPage, writeBackPage, computeSource, computeSink);
 
+    // if all of the stages come from a computation that can run them as one loop, we are done
+    if (fusePipelines && numTupleSets > 1) {
+        ComputeExecutorPtr fusedStages = getFusedExecutor(buildTheseTupleSets, params);
+        if (fusedStages != nullptr) {
+            PDB_COUT << "fused " << numTupleSets - 1 << " stages into one loop" << std::endl;
+            returnVal->addStage(fusedStages);
+            return returnVal;
+        }
+    }
+
     // add the operations to the pipeline
     AtomicComputationPtr lastOne =
         myPlan->getComputations().getProducingAtomicComputation(buildTheseTupleSets[0]);
@@ -571,6 +653,20 @@ inline PipelinePtr ComputePlan::buildPipeline(std::vector<std::string> buildThes
                       << a->getComputationName() << ") inside of a pipeline.\n";
         }
 
+        // a join side that probes can drop the tuples whose hash is not in the runtime filter of
+        // the other side right after they are hashed, before they are shuffled or probed
+        if ((a->getAtomicComputationType() == "HashLeft" ||
+             a->getAtomicComputationType() == "HashRight") &&
+            params.count(RuntimeFilterArg::getParamName(a->getOutput().getSetName())) != 0) {
+            std::shared_ptr<RuntimeFilterArg> filterArg =
+                std::dynamic_pointer_cast<RuntimeFilterArg>(
+                    params[RuntimeFilterArg::getParamName(a->getOutput().getSetName())]);
+            if (filterArg != nullptr) {
+                returnVal->addStage(
+                    std::make_shared<RuntimeFilterExecutor>(a->getOutput(), filterArg->filters));
+            }
+        }
+
         lastOne = a;
     }
     // std :: cout << "Sink: " << targetSpec << " [" << targetProjection << "]\n";
@@ -703,6 +799,12 @@ inline PipelinePtr ComputePlan::buildPipeline(std::string sourceTupleSetName,
             .getComputation()
             .getComputeSink(targetSpec, targetAttsToOpOn, targetProjection, *this);
 
+    // a sink that shuffles by hash counts the tuples it sends to every partition for the stage
+    if ((computeSink != nullptr) && (params.count(ShuffleSkew::getParamName()) != 0)) {
+        computeSink->setShuffleSkew(
+            std::dynamic_pointer_cast<ShuffleSkew>(params[ShuffleSkew::getParamName()]));
+    }
+
     // make the pipeline
     PipelinePtr returnVal = std::make_shared<Pipeline>(
         getPage, discardTempPage, writeBackPage, computeSource, computeSink);
@@ -870,6 +972,20 @@ inline PipelinePtr ComputePlan::buildPipeline(std::string sourceTupleSetName,
                       << a->getComputationName() << ") inside of a pipeline.\n";
         }
 
+        // a join side that probes can drop the tuples whose hash is not in the runtime filter of
+        // the other side right after they are hashed, before they are shuffled or probed
+        if ((a->getAtomicComputationType() == "HashLeft" ||
+             a->getAtomicComputationType() == "HashRight") &&
+            params.count(RuntimeFilterArg::getParamName(a->getOutput().getSetName())) != 0) {
+            std::shared_ptr<RuntimeFilterArg> filterArg =
+                std::dynamic_pointer_cast<RuntimeFilterArg>(
+                    params[RuntimeFilterArg::getParamName(a->getOutput().getSetName())]);
+            if (filterArg != nullptr) {
+                returnVal->addStage(
+                    std::make_shared<RuntimeFilterExecutor>(a->getOutput(), filterArg->filters));
+            }
+        }
+
         lastOne = a;
     }
 
@@ -31,6 +31,13 @@
 
 // PRELOAD %ComputePlan%
 
+// the stages of a pipeline that come from a single computation can be compiled into one loop when
+// the computation knows how to do it; this is off unless the build sets FUSE_PIPELINES to true or
+// the plan asks for it with setFusePipelines, as only the selections have a fused loop so far
+#ifndef FUSE_PIPELINES
+#define FUSE_PIPELINES false
+#endif
+
 namespace pdb {
 
 typedef std::shared_ptr<LogicalPlan> LogicalPlanPtr;
@@ -49,6 +56,14 @@ class ComputePlan : public Object {
     // computations
     LogicalPlanPtr myPlan;
 
+    // true if buildPipeline should compile the stages of a computation into one loop
+    bool fusePipelines = FUSE_PIPELINES;
+
+    // returns the executor that runs the stages producing buildTheseTupleSets[1..] in one loop,
+    // nullptr if they can not be fused
+    ComputeExecutorPtr getFusedExecutor(std::vector<std::string>& buildTheseTupleSets,
+                                        std::map<std::string, ComputeInfoPtr>& params);
+
 public:
     ENABLE_DEEP_COPY
 
@@ -91,6 +106,12 @@ public:
     // sending the smart pointer.
     void nullifyPlanPointer();
 
+    // turns the fusion of pipeline stages on or off, with fusion off every APPLY and FILTER runs as
+    // a separate stage that materializes its output
+    void setFusePipelines(bool fusePipelines);
+
+    bool getFusePipelines();
+
     // this builds a pipeline between the Computation that produces sourceTupleSetName and the
     // Computation
     // targetComputationName.  Since targetComputationName can have more than one input (in the case
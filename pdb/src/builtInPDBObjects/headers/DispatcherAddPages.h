@@ -0,0 +1,102 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef OBJECTQUERYMODEL_DISPATCHERADDPAGES_H
+#define OBJECTQUERYMODEL_DISPATCHERADDPAGES_H
+
+#include "Object.h"
+#include "Handle.h"
+#include "PDBString.h"
+
+// PRELOAD %DispatcherAddPages%
+
+namespace pdb {
+
+// tells the dispatcher about the pages a client has stored in a set by sending them straight to
+// the storage servers of the workers, so that the statistics of the set stay right; a set that is
+// partitioned by key comes with the estimated number of distinct keys of the whole set. A request
+// with no pages only checks that the set exists and takes objects of the type, a bulk load sends
+// one before it sends any page
+class DispatcherAddPages : public Object {
+
+public:
+    DispatcherAddPages() {}
+    ~DispatcherAddPages() {}
+
+    DispatcherAddPages(std::string databaseName,
+                       std::string setName,
+                       std::string typeName,
+                       int numPages,
+                       size_t numBytes,
+                       size_t numObjects = 0,
+                       std::string keyName = "",
+                       size_t numDistinctKeys = 0)
+        : databaseName(databaseName), setName(setName), typeName(typeName), keyName(keyName) {
+        this->numPages = numPages;
+        this->numBytes = numBytes;
+        this->numObjects = numObjects;
+        this->numDistinctKeys = numDistinctKeys;
+    }
+
+    std::string getDatabaseName() {
+        return databaseName;
+    }
+
+    std::string getSetName() {
+        return setName;
+    }
+
+    std::string getTypeName() {
+        return typeName;
+    }
+
+    int getNumPages() {
+        return numPages;
+    }
+
+    size_t getNumBytes() {
+        return numBytes;
+    }
+
+    size_t getNumObjects() {
+        return numObjects;
+    }
+
+    std::string getKeyName() {
+        return keyName;
+    }
+
+    size_t getNumDistinctKeys() {
+        return numDistinctKeys;
+    }
+
+    ENABLE_DEEP_COPY
+
+private:
+    String databaseName;
+    String setName;
+    String typeName;
+    int numPages;
+    size_t numBytes;
+    size_t numObjects;
+    String keyName;
+    size_t numDistinctKeys;
+};
+}
+
+#endif  // OBJECTQUERYMODEL_DISPATCHERADDPAGES_H
@@ -40,8 +40,14 @@ public:
 
     DispatcherRegisterPartitionPolicy(std::string setNameIn,
                                       std::string databaseNameIn,
-                                      PartitionPolicy::Policy policyIn)
-        : setName(setNameIn), databaseName(databaseNameIn), policy(policyIn) {}
+                                      PartitionPolicy::Policy policyIn,
+                                      std::string partitionSchemeIn = "",
+                                      std::string partitionKeyIn = "")
+        : setName(setNameIn),
+          databaseName(databaseNameIn),
+          policy(policyIn),
+          partitionScheme(partitionSchemeIn),
+          partitionKey(partitionKeyIn) {}
 
     String getSetName() {
         return this->setName;
@@ -55,12 +61,23 @@ public:
         return this->policy;
     }
 
+    // the scheme and the key of a KeyPartitionPolicy, which partitions the data on the client
+    String getPartitionScheme() {
+        return this->partitionScheme;
+    }
+
+    String getPartitionKey() {
+        return this->partitionKey;
+    }
+
     ENABLE_DEEP_COPY
 
 private:
     String setName;
     String databaseName;
     PartitionPolicy::Policy policy;
+    String partitionScheme;
+    String partitionKey;
 };
 }
 
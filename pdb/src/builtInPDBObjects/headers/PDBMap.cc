@@ -84,10 +84,14 @@ Map<KeyType, ValueType>::Map(uint32_t initSize) {
         initSize = 2;
     }
 
+    // the number of slots is a power of two
+    initSize = PairArray<KeyType, ValueType>::getNumSlots(initSize);
+
     // this way, we'll allocate extra bytes on the end of the array
     MapRecordClass<KeyType, ValueType> temp;
     size_t size = temp.getObjSize();
-    myArray = makeObjectWithExtraStorage<PairArray<KeyType, ValueType>>(size * initSize, initSize);
+    myArray = makeObjectWithExtraStorage<PairArray<KeyType, ValueType>>(
+        PairArray<KeyType, ValueType>::getStorageSize(size, initSize), initSize);
 }
 
 template <class KeyType, class ValueType>
@@ -95,7 +99,8 @@ Map<KeyType, ValueType>::Map() {
 
     MapRecordClass<KeyType, ValueType> temp;
     size_t size = temp.getObjSize();
-    myArray = makeObjectWithExtraStorage<PairArray<KeyType, ValueType>>(size * 2, 2);
+    myArray = makeObjectWithExtraStorage<PairArray<KeyType, ValueType>>(
+        PairArray<KeyType, ValueType>::getStorageSize(size, 2), 2);
 }
 
 template <class KeyType, class ValueType>
@@ -112,17 +117,30 @@ template <class KeyType, class ValueType>
 ValueType& Map<KeyType, ValueType>::operator[](const KeyType& which) {
 
     // JiaNote: each time we increase size only when key doesn't exist.
-    // so that we can make sure usedSlot < maxSlots each time before we invoke[] for insertion
-    // and for read-only data, we will not invoke doubleArray(), if we always invoke count() before
-    // invoke []
-    if (myArray->count(which) == 0) {
-        if (myArray->isOverFull()) {
-            Handle<PairArray<KeyType, ValueType>> temp = myArray->doubleArray();
-            myArray = temp;
-        }
+    // so that we can make sure usedSlot < maxSlots each time before we insert, and for read-only
+    // data, we will not invoke doubleArray()
+    bool inserted;
+    return findOrInsert(which, Hasher<KeyType>::hash(which), inserted);
+}
+
+template <class KeyType, class ValueType>
+ValueType& Map<KeyType, ValueType>::findOrInsert(const KeyType& which, bool& inserted) {
+    return findOrInsert(which, Hasher<KeyType>::hash(which), inserted);
+}
+
+template <class KeyType, class ValueType>
+ValueType& Map<KeyType, ValueType>::findOrInsert(const KeyType& which,
+                                                 size_t hashVal,
+                                                 bool& inserted) {
+    // the array only says it has no room when the key is not there, so the array of read-only
+    // data is never doubled
+    ValueType* res = myArray->findOrInsert(which, hashVal, inserted);
+    if (res == nullptr) {
+        Handle<PairArray<KeyType, ValueType>> temp = myArray->doubleArray();
+        myArray = temp;
+        res = myArray->findOrInsert(which, hashVal, inserted);
     }
-    ValueType& res = (*myArray)[which];
-    return res;
+    return *res;
 }
 
 template <class KeyType, class ValueType>
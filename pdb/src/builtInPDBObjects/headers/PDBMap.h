@@ -51,6 +51,13 @@ public:
     // access the value at "which"; if this is undefined, define it and return a reference
     ValueType& operator[](const KeyType& which);
 
+    // the same as operator[], but also tells whether "which" was added, so that a caller that
+    // does different things for a new key and for an old one does not look for it twice
+    ValueType& findOrInsert(const KeyType& which, bool& inserted);
+
+    // the same, with the hash of "which" (Hasher<KeyType>::hash (which)) computed by the caller
+    ValueType& findOrInsert(const KeyType& which, size_t hashVal, bool& inserted);
+
     // clears the particular key from the map, destructing both the key and the value.  NOTE THAT
     // THIS IS ONLY SAFE TO USE IF CLEARME WAS THE VERY LAST ITEM ADDED TO THE MAP.  If it is not,
     // the hash table may be in an inconsistent state.  This is typically used when an out-of-memory
@@ -27,6 +27,10 @@
 #include <type_traits>
 #include <cstring>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "Handle.h"
 #include "Object.h"
 #include "InterfaceFunctions.h"
@@ -110,6 +114,38 @@ public:
 #define GET_KEY(data, i, type) (*((type*)(((char*)data) + sizeof(size_t) + (i * objSize))))
 #define GET_VALUE(data, i, type) (*((type*)(((char*)data) + valueOffset + (i * objSize))))
 
+// the number of control bytes that are looked at together
+#define PAIR_ARRAY_GROUP_SIZE 16
+
+// the control byte of an empty slot; the control byte of a used slot has the high bit clear
+#define PAIR_ARRAY_EMPTY ((unsigned char)0x80)
+
+// the control byte of a key, from its mixed hash
+#define PAIR_ARRAY_FINGERPRINT(mixed) ((unsigned char)((mixed) >> 57))
+
+// spreads the bits of a hash, so that the slot (the low bits) and the control byte (the high bits)
+// of a key depend on all of them, even for std::hash, which is the identity on integers
+inline size_t mixHash(size_t hashVal) {
+    size_t mixed = hashVal * 0x9E3779B97F4A7C15ULL;
+    return mixed ^ (mixed >> 32);
+}
+
+// returns a bit for each of the PAIR_ARRAY_GROUP_SIZE control bytes at control that equals me
+inline uint32_t matchControlBytes(const unsigned char* control, unsigned char me) {
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i*)control);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)me)));
+#else
+    uint32_t matches = 0;
+    for (int i = 0; i < PAIR_ARRAY_GROUP_SIZE; i++) {
+        if (control[i] == me) {
+            matches |= (1u << i);
+        }
+    }
+    return matches;
+#endif
+}
+
 // Note: we need to write all operations in constructors, destructors, and assignment operators
 // WITHOUT using
 // the underlying type in any way (including assignment, initialization, destruction, size).
@@ -127,6 +163,37 @@ bool PairArray<KeyType, ValueType>::isDestructorDisabled() {
 }
 
 
+template <class KeyType, class ValueType>
+size_t PairArray<KeyType, ValueType>::getStorageSize(uint32_t objSize, uint32_t numSlots) {
+    return ((size_t)objSize) * numSlots + numSlots + PAIR_ARRAY_GROUP_SIZE;
+}
+
+template <class KeyType, class ValueType>
+uint32_t PairArray<KeyType, ValueType>::getNumSlots(uint32_t numSlots) {
+    uint32_t val = 2;
+    while (val < numSlots && val < (1u << 31)) {
+        val *= 2;
+    }
+    return val;
+}
+
+template <class KeyType, class ValueType>
+unsigned char* PairArray<KeyType, ValueType>::getControlBytes() {
+    return ((unsigned char*)data) + ((size_t)objSize) * numSlots;
+}
+
+template <class KeyType, class ValueType>
+void PairArray<KeyType, ValueType>::setControlByte(size_t slot, unsigned char value) {
+    unsigned char* control = getControlBytes();
+    control[slot] = value;
+
+    // the copies of the first control bytes after the last slot, so a group never wraps around
+    for (size_t copy = slot + numSlots; copy < numSlots + PAIR_ARRAY_GROUP_SIZE;
+         copy += numSlots) {
+        control[copy] = value;
+    }
+}
+
 template <class KeyType, class ValueType>
 void PairArray<KeyType, ValueType>::setUpAndCopyFrom(void* target, void* source) const {
 
@@ -160,10 +227,17 @@ void PairArray<KeyType, ValueType>::setUpAndCopyFrom(void* target, void* source)
     // now we need to copy the array
     // if our types are fully primitive, just do a memmove
     if (!toMe.keyTypeInfo.descendsFromObject() && !toMe.valueTypeInfo.descendsFromObject()) {
-        memmove((void*)toMe.data, (void*)fromMe.data, ((size_t)toMe.objSize) * (toMe.numSlots));
+        memmove((void*)toMe.data,
+                (void*)fromMe.data,
+                getStorageSize(toMe.objSize, toMe.numSlots));
         return;
     }
 
+    // the control bytes are the same for the copy
+    memmove(toMe.getControlBytes(),
+            fromMe.getControlBytes(),
+            toMe.numSlots + PAIR_ARRAY_GROUP_SIZE);
+
     // one of them is not primitive...
 
     // compute the key and value sizes
@@ -199,6 +273,7 @@ void PairArray<KeyType, ValueType>::setUpAndCopyFrom(void* target, void* source)
                 // handle this here.
                 for (int j = i; j < toMe.numSlots; j++) {
                     GET_HASH(toMe.data, j) = UNUSED;
+                    toMe.setControlByte(j, PAIR_ARRAY_EMPTY);
                 }
                 toMe.setDisableDestructor(true);
                 throw n;
@@ -217,6 +292,7 @@ void PairArray<KeyType, ValueType>::setUpAndCopyFrom(void* target, void* source)
                 // handle this here.
                 for (int j = i; j < toMe.numSlots; j++) {
                     GET_HASH(toMe.data, j) = UNUSED;
+                    toMe.setControlByte(j, PAIR_ARRAY_EMPTY);
                 }
                 toMe.setDisableDestructor(true);
                 throw n;
@@ -232,44 +308,89 @@ PairArray<KeyType, ValueType>::PairArray(const PairArray& toMe) {
 }
 
 template <class KeyType, class ValueType>
-int PairArray<KeyType, ValueType>::count(const KeyType& me) {
+bool PairArray<KeyType, ValueType>::findSlot(const KeyType& me, size_t hashVal, size_t& slot) {
+
+    size_t mixed = mixHash(hashVal);
+    unsigned char fingerprint = PAIR_ARRAY_FINGERPRINT(mixed);
+    unsigned char* control = getControlBytes();
+    size_t mask = numSlots - 1;
+
+    // look at a group of slots at a time: first at the ones with the same control byte, then for
+    // an empty slot, which ends the search, since the key would have been put there
+    size_t group = mixed & mask;
+    for (size_t slotsChecked = 0; slotsChecked < numSlots; slotsChecked += PAIR_ARRAY_GROUP_SIZE) {
+        uint32_t matches = matchControlBytes(control + group, fingerprint);
+        while (matches != 0) {
+            size_t which = (group + __builtin_ctz(matches)) & mask;
+            if (GET_HASH(data, which) == hashVal && GET_KEY(data, which, KeyType) == me) {
+                slot = which;
+                return true;
+            }
+            matches &= matches - 1;
+        }
+        uint32_t empties = matchControlBytes(control + group, PAIR_ARRAY_EMPTY);
+        if (empties != 0) {
+            slot = (group + __builtin_ctz(empties)) & mask;
+            return false;
+        }
+        group = (group + PAIR_ARRAY_GROUP_SIZE) & mask;
+    }
 
-    // hash this dude
-    size_t hashVal = Hasher<KeyType>::hash(me);
+    // the hash table is full
+    slot = numSlots;
+    return false;
+}
+
+template <class KeyType, class ValueType>
+ValueType& PairArray<KeyType, ValueType>::insertAt(size_t slot,
+                                                   const KeyType& me,
+                                                   size_t hashVal) {
+    try {
+        // construct the key and the value
+        new (GET_KEY_PTR(data, slot)) KeyType();
+        new (GET_VALUE_PTR(data, slot)) ValueType();
+    } catch (NotEnoughSpace& n) {
+        std::cout << "Not enough space when in placement new the key type and value type"
+                  << std::endl;
+        throw n;
+    }
 
-    // figure out which slot he goes in
-    size_t slot = hashVal % (numSlots - 1);
+    // add the key
+    try {
+        GET_KEY(data, slot, KeyType) = me;
 
-    // in the worst case, we can loop through the entire hash table looking.  :-(
-    for (size_t slotsChecked = 0; slotsChecked < numSlots; slotsChecked++) {
+        GET_HASH(data, slot) = hashVal;
+        setControlByte(slot, PAIR_ARRAY_FINGERPRINT(mixHash(hashVal)));
 
-        // if we found an empty slot, then this guy was not here
-        if (GET_HASH(data, slot) == UNUSED) {
-            return 0;
-        } else if (GET_HASH(data, slot) == hashVal) {
+        // increment the number of used slots
+        usedSlots++;
 
-            // potential match!!
-            if (GET_KEY(data, slot, KeyType) == me) {
-                return 1;
-            }
-        }
+    } catch (NotEnoughSpace& n) {
+        std::cout << "Not enough space when inserting new key" << std::endl;
+        throw n;
+    }
+
+    // and return the value
+    return GET_VALUE(data, slot, ValueType);
+}
+
+template <class KeyType, class ValueType>
+int PairArray<KeyType, ValueType>::count(const KeyType& me) {
 
-        // if we made it here, then it means that we found a non-empty slot, but no
-        // match... so we simply loop to the next iteration... if slot == (numSlots-1), it
-        // means we've made it to the end of the hash table... go to the beginning
-        if (slot == numSlots - 1)
-            slot = 0;
+    // hash this dude
+    size_t hashVal = Hasher<KeyType>::hash(me);
 
-        // otherwise, just go to the next slot
-        else
-            slot++;
+    size_t slot;
+    if (findSlot(me, hashVal, slot)) {
+        return 1;
     }
 
     // we should never reach here
-    std::cout << "in count(): hashVal = " << hashVal << ", slot = " << slot
-              << ", numSlots =" << numSlots << ". Warning: Ran off the end of the hash table!!\n";
+    if (slot == numSlots) {
+        std::cout << "in count(): hashVal = " << hashVal << ", numSlots =" << numSlots
+                  << ". Warning: Ran off the end of the hash table!!\n";
+    }
     return 0;
-    // exit (1);
 }
 
 template <class KeyType, class ValueType>
@@ -278,49 +399,24 @@ void PairArray<KeyType, ValueType>::setUnused(const KeyType& me) {
     // hash this dude
     size_t hashVal = Hasher<KeyType>::hash(me);
 
-    // figure out which slot he goes in
-    size_t slot = hashVal % (numSlots - 1);
-
-    // in the worst case, we can loop through the entire hash table looking.  :-(
-    for (size_t slotsChecked = 0; slotsChecked < numSlots; slotsChecked++) {
-
-        // if we found an empty slot, then this guy was not here
-        if (GET_HASH(data, slot) == UNUSED) {
+    size_t slot;
+    if (findSlot(me, hashVal, slot) == false) {
+        if (slot == numSlots) {
+            std::cout << "in setUnused(): hashVal = " << hashVal << ", numSlots =" << numSlots
+                      << ". Warning: Ran off the end of the hash table!!\n";
+        } else {
             std::cout << "WARNING: setUnused for an empty slot" << std::endl;
-            return;
-
-            // found a non-empty slot; check for a match
-        } else if (GET_HASH(data, slot) == hashVal) {
-
-            // potential match!!
-            if (GET_KEY(data, slot, KeyType) == me) {
-
-                // destruct those guys
-                ((KeyType*)(GET_KEY_PTR(data, slot)))->~KeyType();
-                ((ValueType*)(GET_VALUE_PTR(data, slot)))->~ValueType();
-                GET_HASH(data, slot) = UNUSED;
-                return;
-            }
         }
-
-        // if we made it here, then it means that we found a non-empty slot, but no
-        // match... so we simply loop to the next iteration... if slot == numSlots - 1, it
-        // means we've made it to the end of the hash table... go to the beginning
-        if (slot == numSlots - 1)
-            slot = 0;
-
-        // otherwise, just go to the next slot
-        else
-            slot++;
+        return;
     }
 
-    // we should never reach here
-    std::cout << "in setUnused(): hashVal = " << hashVal << ", slot = " << slot
-              << ", numSlots =" << numSlots << ". Warning: Ran off the end of the hash table!!\n";
-    // exit (1);
+    // destruct those guys
+    ((KeyType*)(GET_KEY_PTR(data, slot)))->~KeyType();
+    ((ValueType*)(GET_VALUE_PTR(data, slot)))->~ValueType();
+    GET_HASH(data, slot) = UNUSED;
+    setControlByte(slot, PAIR_ARRAY_EMPTY);
 }
 
-
 template <class KeyType, class ValueType>
 ValueType& PairArray<KeyType, ValueType>::operator[](const KeyType& me) {
 
@@ -330,87 +426,46 @@ ValueType& PairArray<KeyType, ValueType>::operator[](const KeyType& me) {
     // hash this dude
     size_t hashVal = Hasher<KeyType>::hash(me);
 
-    // figure out which slot he goes in
-    size_t slot = hashVal % (numSlots - 1);
-
-    // in the worst case, we can loop through the entire hash table looking.  :-(
-    for (size_t slotsChecked = 0; slotsChecked < numSlots; slotsChecked++) {
-
-        // if we found an empty slot, then this guy was not here
-        if (GET_HASH(data, slot) == UNUSED) {
-            try {
-                // construct the key and the value
-                new (GET_KEY_PTR(data, slot)) KeyType();
-                new (GET_VALUE_PTR(data, slot)) ValueType();
-            } catch (NotEnoughSpace& n) {
-                std::cout << "Not enough space when in placement new the key type and value type"
-                          << std::endl;
-                throw n;
-            }
-
-
-            // add the key
-            try {
-                GET_KEY(data, slot, KeyType) = me;
-
-                GET_HASH(data, slot) = hashVal;
-
-                // increment the number of used slots
-                usedSlots++;
-
-            } catch (NotEnoughSpace& n) {
-                std::cout << "Not enough space when inserting new key" << std::endl;
-                throw n;
-            }
-
-            // and return the value
-            return GET_VALUE(data, slot, ValueType);
-
-            // found a non-empty slot; check for a match
-        } else if (GET_HASH(data, slot) == hashVal) {
-
-            // potential match!!
-            if (GET_KEY(data, slot, KeyType) == me) {
-
-                // match!!
-                return GET_VALUE(data, slot, ValueType);
-            }
-        }
-
-        // if we made it here, then it means that we found a non-empty slot, but no
-        // match... so we simply loop to the next iteration... if slot == numSlots - 1, it
-        // means we've made it to the end of the hash table... go to the beginning
-        if (slot == numSlots - 1)
-            slot = 0;
-
-        // otherwise, just go to the next slot
-        else
-            slot++;
+    size_t slot;
+    if (findSlot(me, hashVal, slot)) {
+        return GET_VALUE(data, slot, ValueType);
     }
 
     // we should never reach here
-    std::cout << "Fatal Error: Ran off the end of the hash table!!\n";
-    exit(1);
+    if (slot == numSlots) {
+        std::cout << "Fatal Error: Ran off the end of the hash table!!\n";
+        exit(1);
+    }
+    return insertAt(slot, me, hashVal);
 }
 
 template <class KeyType, class ValueType>
-PairArray<KeyType, ValueType>::PairArray(uint32_t numSlotsIn) : PairArray() {
+ValueType* PairArray<KeyType, ValueType>::findOrInsert(const KeyType& me,
+                                                       size_t hashVal,
+                                                       bool& inserted) {
+
+    size_t slot;
+    inserted = false;
+    if (findSlot(me, hashVal, slot)) {
+        return &GET_VALUE(data, slot, ValueType);
+    }
 
-    // verify that we are a power of two
-    bool gotIt = false;
-    uint32_t val = 1;
-    for (unsigned int pow = 0; pow <= 31; pow++) {
-        if (val >= numSlotsIn) {
-            gotIt = true;
-            break;
-        }
-        val *= 2;
+    // no room for him, the caller has to double the array
+    if (isOverFull() || (slot == numSlots)) {
+        return nullptr;
     }
+    ValueType& value = insertAt(slot, me, hashVal);
+    inserted = true;
+    return &value;
+}
+
+template <class KeyType, class ValueType>
+PairArray<KeyType, ValueType>::PairArray(uint32_t numSlotsIn) : PairArray() {
 
     setDisableDestructor(false);
 
-    // if we are not a power of two, exit
-    if (!gotIt) {
+    // verify that we are a power of two, so that a hash is turned into a slot with a mask
+    if ((numSlotsIn == 0) || ((numSlotsIn & (numSlotsIn - 1)) != 0)) {
         std::cout << "Fatal Error: Bad: could not get the correct size  " << numSlotsIn
                   << " for the array\n";
         exit(1);
@@ -424,6 +479,7 @@ PairArray<KeyType, ValueType>::PairArray(uint32_t numSlotsIn) : PairArray() {
     for (int i = 0; i < numSlots; i++) {
         GET_HASH(data, i) = UNUSED;
     }
+    memset(getControlBytes(), PAIR_ARRAY_EMPTY, numSlots + PAIR_ARRAY_GROUP_SIZE);
 }
 
 template <class KeyType, class ValueType>
@@ -493,10 +549,11 @@ Handle<PairArray<KeyType, ValueType>> PairArray<KeyType, ValueType>::doubleArray
 
     // allocate the new Array
     Handle<PairArray<KeyType, ValueType>> tempArray =
-        makeObjectWithExtraStorage<PairArray<KeyType, ValueType>>(objSize * howMany, howMany);
+        makeObjectWithExtraStorage<PairArray<KeyType, ValueType>>(
+            getStorageSize(objSize, howMany), howMany);
 
     // first, set everything to unused
-    // now, re-hash everything
+    // now, re-hash everything; the hashes are in the records, so the keys are not hashed again
     PairArray<KeyType, ValueType>& newOne = *tempArray;
 
     for (uint32_t i = 0; i < numSlots; i++) {
@@ -504,7 +561,10 @@ Handle<PairArray<KeyType, ValueType>> PairArray<KeyType, ValueType>::doubleArray
         if (GET_HASH(data, i) != UNUSED) {
 
             // copy the dude over
-            newOne[GET_KEY(data, i, KeyType)] = GET_VALUE(data, i, ValueType);
+            size_t slot;
+            newOne.findSlot(GET_KEY(data, i, KeyType), GET_HASH(data, i), slot);
+            newOne.insertAt(slot, GET_KEY(data, i, KeyType), GET_HASH(data, i)) =
+                GET_VALUE(data, i, ValueType);
 
             // and delete the old one
             GET_KEY(data, i, KeyType).~KeyType();
@@ -530,7 +590,7 @@ void PairArray<KeyType, ValueType>::deleteObject(void* deleteMe) {
 template <class KeyType, class ValueType>
 size_t PairArray<KeyType, ValueType>::getSize(void* forMe) {
     PairArray<KeyType, ValueType>& target = *((PairArray<KeyType, ValueType>*)forMe);
-    return sizeof(PairArray<Nothing>) + target.objSize * target.numSlots;
+    return sizeof(PairArray<Nothing>) + getStorageSize(target.objSize, target.numSlots);
 }
 
 template <class KeyType, class ValueType>
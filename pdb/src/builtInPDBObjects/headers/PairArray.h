@@ -65,6 +65,12 @@ private:
 //
 // Since the array class can be variable length, it is used as the key building block for
 // both the Vector and String classes.
+//
+// A PairArray is an open-addressing hash table with a power-of-two number of slots.  Next to the
+// records, it keeps a control byte per slot: PAIR_ARRAY_EMPTY, or 7 bits of the hash of the key.
+// A lookup reads the control bytes of PAIR_ARRAY_GROUP_SIZE slots at once (with SSE2 where we
+// have it), and only looks at the records whose control byte matches.  The control bytes are at
+// an offset from data, not a pointer, so the array can still be moved around like any Object.
 
 template <class KeyType, class ValueType = Nothing>
 class PairArray : public Object {
@@ -102,12 +108,26 @@ private:
     // the max number of slots before doubling
     uint32_t maxSlots;
 
-    // the array of data
+    // delete flag to avoid to run destructor if the flag is set to true; this has to come before
+    // data, or it is the same byte as the hash of the first record
+    bool disableDestructor;
+
+    // the array of data: numSlots records, followed by a control byte for each slot and a copy
+    // of the first PAIR_ARRAY_GROUP_SIZE control bytes, so that a group can be read at any slot
     Nothing data[0];
 
+    // the control bytes that follow the records
+    unsigned char* getControlBytes();
 
-    // delete flag to avoid to run destructor if the flag is set to true
-    bool disableDestructor;
+    // sets the control byte of a slot, and its copy at the end if it has one
+    void setControlByte(size_t slot, unsigned char value);
+
+    // looks for a key; returns true and its slot if it is there, otherwise returns false and the
+    // empty slot it goes to (numSlots if there is none)
+    bool findSlot(const KeyType& me, size_t hashVal, size_t& slot);
+
+    // constructs a key and a value in an empty slot
+    ValueType& insertAt(size_t slot, const KeyType& me, size_t hashVal);
 
 public:
     // create a new PairArray via doubling
@@ -117,6 +137,11 @@ public:
     // to a newly-creaated value
     ValueType& operator[](const KeyType& which);
 
+    // finds the value of a key, or adds the key with a newly-constructed value, in one probe;
+    // hashVal is Hasher<KeyType>::hash (which).  Returns nullptr if the key is not there and
+    // this is over full, then the caller has to double the array first
+    ValueType* findOrInsert(const KeyType& which, size_t hashVal, bool& inserted);
+
     // returns true if this has hit its max fill factor
     bool isOverFull();
 
@@ -138,6 +163,12 @@ public:
 
     // get disable destructor
     bool isDestructorDisabled();
+
+    // the number of bytes to allocate after a PairArray with numSlots records of objSize bytes
+    static size_t getStorageSize(uint32_t objSize, uint32_t numSlots);
+
+    // the number of slots (a power of two) to allocate to hold at least numSlots slots
+    static uint32_t getNumSlots(uint32_t numSlots);
 };
 }
 
@@ -22,6 +22,7 @@
 #include "Object.h"
 #include "Handle.h"
 #include "PDBString.h"
+#include "PDBVector.h"
 #include "DataTypes.h"
 
 // PRELOAD %SetIdentifier%
@@ -112,6 +113,30 @@ class SetIdentifier : public Object {
     return getDatabase() + ":" + getSetName();
   }
 
+  /**
+   * The runtime filters of the hash tables a HashPartitionedJoinBuildHTJobStage built from this set on a node,
+   * in the format of @see BlockedBloomFilter::appendTo, nullptr if there are none
+   */
+  void setRuntimeFilters(Handle<Vector<uint64_t>> runtimeFilters) {
+    this->runtimeFilters = runtimeFilters;
+  }
+
+  Handle<Vector<uint64_t>> getRuntimeFilters() {
+    return runtimeFilters;
+  }
+
+  /**
+   * The tuples a TupleSetJobStage shuffled from a node to every partition, and the keys it split, in the format of
+   * @see ShuffleSkew::appendTo, nullptr if it did not shuffle by hash
+   */
+  void setShuffleSkew(Handle<Vector<uint64_t>> shuffleSkew) {
+    this->shuffleSkew = shuffleSkew;
+  }
+
+  Handle<Vector<uint64_t>> getShuffleSkew() {
+    return shuffleSkew;
+  }
+
   /**
    * Returns true if the @see setName and @see dataBase name match
    * @param rhs the other set identifier we are comparing it to
@@ -140,6 +165,9 @@ class SetIdentifier : public Object {
   bool isAggregationResultOrNot;
   size_t numPages;
   size_t pageSize;
+  Handle<Vector<uint64_t>> runtimeFilters = nullptr;
+
+  Handle<Vector<uint64_t>> shuffleSkew = nullptr;
 };
 }
 
@@ -27,13 +27,15 @@
 
 namespace pdb {
 
-// encapsulates a request to scan a set stored in the database
+// encapsulates a request to scan a set stored in the database; with a window of 0 every page
+// waits for a KeepGoing, otherwise the pages are streamed as SetScanStream describes
 class SetScan : public Object {
 
 public:
-    SetScan(std::string dbNameIn, std::string setNameIn) {
+    SetScan(std::string dbNameIn, std::string setNameIn, int windowSizeIn = 0) {
         dbName = dbNameIn;
         setName = setNameIn;
+        windowSize = windowSizeIn;
     }
 
     SetScan() {}
@@ -47,6 +49,10 @@ public:
         return setName;
     }
 
+    int getWindowSize() {
+        return windowSize;
+    }
+
     ENABLE_DEEP_COPY
 
 private:
@@ -55,6 +61,9 @@ private:
 
     // and the set
     String setName;
+
+    // the pages that may be sent before the client takes one
+    int windowSize = 0;
 };
 }
 
@@ -87,6 +87,15 @@ public:
         return loopEnded;
     }
 
+    // the bytes that follow are a whole page, to be stored as a page of its own
+    void setStoreAsPage() {
+        storeAsPage = true;
+    }
+
+    bool isStoreAsPage() {
+        return storeAsPage;
+    }
+
     ENABLE_DEEP_COPY
 
 private:
@@ -96,6 +105,7 @@ private:
     int typeID;
     bool typeCheck;
     bool loopEnded = false;
+    bool storeAsPage = false;
 };
 }
 
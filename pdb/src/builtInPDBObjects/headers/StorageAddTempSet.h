@@ -35,8 +35,10 @@ public:
     StorageAddTempSet() {}
     ~StorageAddTempSet() {}
 
-    StorageAddTempSet(std::string setName, size_t pageSize = DEFAULT_PAGE_SIZE)
-        : setName(setName), pageSize(pageSize) {}
+    StorageAddTempSet(std::string setName,
+                      size_t pageSize = DEFAULT_PAGE_SIZE,
+                      LocalityType localityType = ShuffleData)
+        : setName(setName), pageSize(pageSize), localityType(localityType) {}
 
     std::string getSetName() {
         return setName;
@@ -46,11 +48,17 @@ public:
         return pageSize;
     }
 
+    // the kind of data in the set, which decides how soon its pages are evicted
+    LocalityType getLocalityType() {
+        return localityType;
+    }
+
     ENABLE_DEEP_COPY
 
 private:
     String setName;
     size_t pageSize;
+    LocalityType localityType;
 };
 }
 
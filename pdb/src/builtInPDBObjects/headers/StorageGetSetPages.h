@@ -64,6 +64,14 @@ public:
         this->setId = setId;
     }
 
+    // get/set the id of the scan ring the pages are pushed to, -1 means the socket
+    int getScanRingID() {
+        return this->scanRingId;
+    }
+    void setScanRingID(int scanRingId) {
+        this->scanRingId = scanRingId;
+    }
+
     ENABLE_DEEP_COPY
 
 
@@ -72,6 +80,7 @@ private:
     DatabaseID dbId;
     UserTypeID userTypeId;
     SetID setId;
+    int scanRingId = -1;
 };
 }
 
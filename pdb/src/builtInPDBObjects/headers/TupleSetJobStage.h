@@ -226,6 +226,17 @@ public:
         return this->repartitionJoinOrNot;
     }
 
+    // to set whether the output for a join is repartitioned on this node only, as the sides of the
+    // join are co-partitioned
+    void setLocalRepartition(bool localRepartitionOrNot) {
+        this->localRepartitionOrNot = localRepartitionOrNot;
+    }
+
+    // to return whether the output for a join is repartitioned on this node only
+    bool isLocalRepartition() {
+        return this->localRepartitionOrNot;
+    }
+
     // to set whether to repartition the output into vectors
     void setRepartitionVector(bool repartitionVectorOrNot) {
         this->repartitionVectorOrNot = repartitionVectorOrNot;
@@ -291,6 +302,11 @@ public:
             }
         }
         std::cout << "[Probing] isProbing=" << this->probeOrNot << std::endl;
+        if (this->localRepartitionOrNot) {
+            std::cout << "[Repartitioning] the sides of the join are co-partitioned, repartitioning "
+                         "on every node"
+                      << std::endl;
+        }
         std::cout << "Number of cluster nodes=" << getNumNodes() << std::endl;
         std::cout << "Total memory on this node is " << totalMemoryOnThisNode << std::endl;
         std::cout << "Number of total partitions=" << getNumTotalPartitions() << std::endl;
@@ -315,6 +331,18 @@ public:
             std::cout << "Atomic computation : \"" << (*it).key << "\" : Hash set \"" << (*it).value << "\"" << std::endl;
           }
         }
+
+        if (runtimeFilters != nullptr) {
+            std::cout << "[Runtime filters] of hash set " << runtimeFilterHashSet << ", "
+                      << runtimeFilters->size() * sizeof(uint64_t) << " bytes" << std::endl;
+        }
+        if (this->splitHeavyKeysOrNot) {
+            std::cout << "[Skew] splitting the heavy keys of the build side" << std::endl;
+        }
+        if (splitKeys != nullptr) {
+            std::cout << "[Skew] copying the tuples of " << splitKeys->size() / 2
+                      << " split keys" << std::endl;
+        }
     }
 
     std::string getOutputTypeName() {
@@ -356,6 +384,58 @@ public:
         this->hashSetsToProbe = hashSetsToProbe;
     }
 
+    // the hash set of the other side of the join this stage shuffles tuples for, the tuples
+    // whose hash is not in its runtime filters are dropped before they are shuffled
+    void setRuntimeFilterHashSet(std::string hashSetName) {
+        this->runtimeFilterHashSet = hashSetName;
+    }
+
+    std::string getRuntimeFilterHashSet() {
+        return this->runtimeFilterHashSet;
+    }
+
+    // the runtime filters of all of the partitions in the cluster, set by the scheduler once the
+    // hash tables are built, nullptr if they are not there
+    void setRuntimeFilters(Handle<Vector<uint64_t>> runtimeFilters) {
+        this->runtimeFilters = runtimeFilters;
+    }
+
+    Handle<Vector<uint64_t>> getRuntimeFilters() {
+        return this->runtimeFilters;
+    }
+
+    // to set whether this stage shuffles the build side of a hash partitioned join, and splits
+    // the heavy keys it sees over several partitions
+    void setSplitHeavyKeys(bool splitHeavyKeysOrNot) {
+        this->splitHeavyKeysOrNot = splitHeavyKeysOrNot;
+    }
+
+    bool isSplittingHeavyKeys() {
+        return this->splitHeavyKeysOrNot;
+    }
+
+    // the keys the build side of the join was split on, as pairs of hash and fanout, set by the
+    // scheduler for the stage that shuffles the other side, whose tuples are copied to all of the
+    // partitions of those keys; nullptr if none were split
+    void setSplitKeys(Handle<Vector<uint64_t>> splitKeys) {
+        this->splitKeys = splitKeys;
+    }
+
+    Handle<Vector<uint64_t>> getSplitKeys() {
+        return this->splitKeys;
+    }
+
+    // the hash set of the other side of the join this stage shuffles tuples for, whose build side
+    // split its heavy keys; the scheduler gives the stage those keys, with or without the runtime
+    // filters of the hash set
+    void setSplitKeysHashSet(std::string hashSetName) {
+        this->splitKeysHashSet = hashSetName;
+    }
+
+    std::string getSplitKeysHashSet() {
+        return this->splitKeysHashSet;
+    }
+
     String getIPAddress(int nodeId) {
         if ((unsigned int)nodeId < numPartitions->size()) {
             std::string ipStr = (*ipAddresses)[nodeId];
@@ -464,6 +544,9 @@ private:
     // Does this stage has a PartitionedJoinSink that partitions JoinMaps
     bool repartitionJoinOrNot = false;
 
+    // Does the PartitionedJoinSink partition the JoinMaps for this node only?
+    bool localRepartitionOrNot = false;
+
     // Does this stage has a HashPartitionSink that partitions Vectors
     bool repartitionVectorOrNot = false;
 
@@ -491,6 +574,17 @@ private:
     // hash set names to probe for join
     Handle<Map<String, String>> hashSetsToProbe = nullptr;
 
+    // the hash set whose runtime filters we apply, and the filters
+    String runtimeFilterHashSet;
+    Handle<Vector<uint64_t>> runtimeFilters = nullptr;
+
+    // do we split the heavy keys of the build side, and the keys it was split on
+    bool splitHeavyKeysOrNot = false;
+    Handle<Vector<uint64_t>> splitKeys = nullptr;
+
+    // the hash set whose split keys we are given
+    String splitKeysHashSet;
+
     // the id to identify this job stage
     JobStageID id;
 
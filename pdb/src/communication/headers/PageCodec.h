@@ -0,0 +1,183 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef PAGE_CODEC_H
+#define PAGE_CODEC_H
+
+#include "Configuration.h"
+#include "PDBCommunicator.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// the adaptive codec compresses a sample of this many bytes with every codec to choose one
+#ifndef PAGE_CODEC_SAMPLE_BYTES
+#define PAGE_CODEC_SAMPLE_BYTES (64 * 1024)
+#endif
+
+// and it samples again after this many pages
+#ifndef PAGE_CODEC_SAMPLE_INTERVAL
+#define PAGE_CODEC_SAMPLE_INTERVAL 16
+#endif
+
+#ifndef PAGE_CODEC_ZSTD_LEVEL
+#define PAGE_CODEC_ZSTD_LEVEL 1
+#endif
+
+namespace pdb {
+
+// the codecs a page can be encoded with; LZ4 and ZSTD are only there if PDB_HAVE_LZ4 and
+// PDB_HAVE_ZSTD are defined
+enum PageCodecType : unsigned char { NoCodec = 0, SnappyCodec = 1, LZ4Codec = 2, ZSTDCodec = 3 };
+
+#define NUM_PAGE_CODECS 4
+
+// every page is sent as this header followed by the encoded bytes
+struct PageFrameHeader {
+    // the PageCodecType of the bytes
+    unsigned char codec;
+
+    // whether the bytes were split into byte planes before they were compressed
+    unsigned char shuffled;
+
+    unsigned char unused[6];
+
+    // the size of the page, and of the encoded bytes that follow
+    size_t numBytes;
+    size_t numEncodedBytes;
+};
+
+// what a codec has done so far
+struct PageCodecStats {
+    long numPages[NUM_PAGE_CODECS] = {0, 0, 0, 0};
+    long numShuffled = 0;
+    size_t numBytesIn = 0;
+    size_t numBytesOut = 0;
+    long encodeNanos = 0;
+    long sampleNanos = 0;
+
+    void add(const PageCodecStats& other);
+
+    long getBytesSaved() const;
+
+    std::string toString() const;
+};
+
+class PageCodec;
+typedef std::shared_ptr<PageCodec> PageCodecPtr;
+
+/*
+ * This class encodes the pages that are shuffled, broadcasted or sent to a client. A page is sent
+ * as two messages, a PageFrameHeader and then the encoded bytes, so a receiver knows the codec and
+ * the size of the page before it gets the bytes, and can put a page that is not compressed right
+ * where it belongs.
+ * The adaptive codec compresses a sample of a page with every codec now and then, with and without
+ * splitting the 8-byte words of the page into byte planes first (which puts the similar bytes of
+ * the offsets and numbers of the objects next to each other), and uses the one that sends the page
+ * in the least time: the time taken to compress it plus the time taken to send the compressed
+ * bytes at the bandwidth the frames have been sent with so far.
+ * A codec is used by one sender at a time; the receiving side is static.
+ */
+
+class PageCodec {
+
+private:
+    // whether the codec is chosen for every page, otherwise fixedCodec is always used
+    bool adaptive;
+    PageCodecType fixedCodec;
+
+    // the bandwidth in bytes per second
+    double bandwidth;
+
+    // the codec used until the next sample
+    PageCodecType chosenCodec;
+    bool chosenShuffled;
+    int pagesUntilSample;
+
+    // the buffers for the encoded bytes, the byte planes and the samples
+    std::vector<char> encodeBuffer;
+    std::vector<char> shuffleBuffer;
+    std::vector<char> sampleBuffer;
+    std::vector<char> sampleOutputBuffer;
+
+    PageCodecStats stats;
+
+    // compresses with a codec, returns the number of bytes written or 0 if that did not work
+    static size_t compress(
+        PageCodecType codec, const char* bytes, size_t numBytes, char* out, size_t outSize);
+
+    static bool decompress(
+        PageCodecType codec, const char* bytes, size_t numBytes, char* out, size_t outSize);
+
+    static size_t getMaxCompressedSize(PageCodecType codec, size_t numBytes);
+
+    // picks the codec for the next pages from a sample of this one
+    void choose(const char* bytes, size_t numBytes);
+
+public:
+    // codecName is one of the codecs of DEFAULT_TRANSFER_CODEC, bandwidth is in MB per second
+    PageCodec(std::string codecName = DEFAULT_TRANSFER_CODEC,
+              size_t bandwidth = DEFAULT_NETWORK_BANDWIDTH);
+
+    // encodes a page, returns the encoded bytes, which stay valid until the next call
+    const char* encode(const void* bytes, size_t numBytes, PageFrameHeader& header);
+
+    // encodes a page and sends the frame
+    bool send(PDBCommunicatorPtr sendUsingMe,
+              const void* bytes,
+              size_t numBytes,
+              std::string& errMsg);
+
+    const PageCodecStats& getStats();
+
+    // the bandwidth the next codec will be chosen for, in bytes per second
+    double getBandwidth();
+
+    // gets a codec from its name, returns false for an unknown or unavailable codec
+    static bool getCodecByName(std::string codecName, PageCodecType& codec);
+
+    static std::string getCodecName(PageCodecType codec);
+
+    // whether this build can encode and decode with a codec
+    static bool isAvailable(PageCodecType codec);
+
+    // splits the 8-byte words of some bytes into byte planes, and back
+    static void shuffleBytes(const char* bytes, size_t numBytes, char* out);
+
+    static void unshuffleBytes(const char* bytes, size_t numBytes, char* out);
+
+    // receives the header of the next frame
+    static bool receiveHeader(PDBCommunicatorPtr receiveFromMe,
+                              PageFrameHeader& header,
+                              std::string& errMsg);
+
+    // receives the encoded bytes of the frame and decodes them into header.numBytes bytes
+    static bool receivePage(PDBCommunicatorPtr receiveFromMe,
+                            const PageFrameHeader& header,
+                            void* bytes,
+                            std::string& errMsg);
+
+    // decodes the encoded bytes of a frame into header.numBytes bytes
+    static bool decode(const PageFrameHeader& header,
+                       const char* encodedBytes,
+                       void* bytes,
+                       std::string& errMsg);
+};
+}
+
+#endif
@@ -0,0 +1,430 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef PAGE_CODEC_CC
+#define PAGE_CODEC_CC
+
+#include "PDBDebug.h"
+#include "PageCodec.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <snappy.h>
+#ifdef PDB_HAVE_LZ4
+#include <lz4.h>
+#endif
+#ifdef PDB_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace pdb {
+
+static long nanosSince(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                begin)
+        .count();
+}
+
+void PageCodecStats::add(const PageCodecStats& other) {
+    for (int i = 0; i < NUM_PAGE_CODECS; i++) {
+        numPages[i] += other.numPages[i];
+    }
+    numShuffled += other.numShuffled;
+    numBytesIn += other.numBytesIn;
+    numBytesOut += other.numBytesOut;
+    encodeNanos += other.encodeNanos;
+    sampleNanos += other.sampleNanos;
+}
+
+long PageCodecStats::getBytesSaved() const {
+    return (long)numBytesIn - (long)numBytesOut;
+}
+
+std::string PageCodecStats::toString() const {
+    std::string out = "pages";
+    for (int i = 0; i < NUM_PAGE_CODECS; i++) {
+        if (numPages[i] > 0) {
+            out += " " + PageCodec::getCodecName((PageCodecType)i) + ":" +
+                std::to_string(numPages[i]);
+        }
+    }
+    out += " (" + std::to_string(numShuffled) + " in byte planes), " +
+        std::to_string(numBytesIn) + " bytes sent as " + std::to_string(numBytesOut) + ", " +
+        std::to_string(getBytesSaved()) + " saved, " + std::to_string(encodeNanos / 1000000) +
+        " ms encoding and " + std::to_string(sampleNanos / 1000000) + " ms sampling";
+    return out;
+}
+
+PageCodec::PageCodec(std::string codecName, size_t bandwidth) {
+    this->adaptive = (codecName == "adaptive");
+    this->fixedCodec = NoCodec;
+    if ((this->adaptive == false) && (getCodecByName(codecName, this->fixedCodec) == false)) {
+        std::cout << "PageCodec: codec " << codecName << " is not available, not compressing"
+                  << std::endl;
+    }
+    this->bandwidth = (double)bandwidth * 1024 * 1024;
+    this->chosenCodec = this->fixedCodec;
+    this->chosenShuffled = false;
+    this->pagesUntilSample = 0;
+}
+
+bool PageCodec::getCodecByName(std::string codecName, PageCodecType& codec) {
+    for (int i = 0; i < NUM_PAGE_CODECS; i++) {
+        if (getCodecName((PageCodecType)i) == codecName) {
+            codec = (PageCodecType)i;
+            return isAvailable(codec);
+        }
+    }
+    return false;
+}
+
+std::string PageCodec::getCodecName(PageCodecType codec) {
+    switch (codec) {
+        case NoCodec:
+            return "none";
+        case SnappyCodec:
+            return "snappy";
+        case LZ4Codec:
+            return "lz4";
+        case ZSTDCodec:
+            return "zstd";
+    }
+    return "unknown";
+}
+
+bool PageCodec::isAvailable(PageCodecType codec) {
+    switch (codec) {
+        case NoCodec:
+        case SnappyCodec:
+            return true;
+        case LZ4Codec:
+#ifdef PDB_HAVE_LZ4
+            return true;
+#else
+            return false;
+#endif
+        case ZSTDCodec:
+#ifdef PDB_HAVE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+size_t PageCodec::getMaxCompressedSize(PageCodecType codec, size_t numBytes) {
+    switch (codec) {
+        case SnappyCodec:
+            return snappy::MaxCompressedLength(numBytes);
+#ifdef PDB_HAVE_LZ4
+        case LZ4Codec:
+            return LZ4_compressBound(numBytes);
+#endif
+#ifdef PDB_HAVE_ZSTD
+        case ZSTDCodec:
+            return ZSTD_compressBound(numBytes);
+#endif
+        default:
+            return numBytes;
+    }
+}
+
+size_t PageCodec::compress(
+    PageCodecType codec, const char* bytes, size_t numBytes, char* out, size_t outSize) {
+    switch (codec) {
+        case SnappyCodec: {
+            size_t compressedSize;
+            snappy::RawCompress(bytes, numBytes, out, &compressedSize);
+            return compressedSize;
+        }
+#ifdef PDB_HAVE_LZ4
+        case LZ4Codec: {
+            int compressedSize = LZ4_compress_default(bytes, out, (int)numBytes, (int)outSize);
+            return (compressedSize > 0) ? compressedSize : 0;
+        }
+#endif
+#ifdef PDB_HAVE_ZSTD
+        case ZSTDCodec: {
+            size_t compressedSize =
+                ZSTD_compress(out, outSize, bytes, numBytes, PAGE_CODEC_ZSTD_LEVEL);
+            return ZSTD_isError(compressedSize) ? 0 : compressedSize;
+        }
+#endif
+        default:
+            return 0;
+    }
+}
+
+bool PageCodec::decompress(
+    PageCodecType codec, const char* bytes, size_t numBytes, char* out, size_t outSize) {
+    switch (codec) {
+        case NoCodec:
+            if (numBytes != outSize) {
+                return false;
+            }
+            memcpy(out, bytes, numBytes);
+            return true;
+        case SnappyCodec: {
+            size_t uncompressedSize;
+            return snappy::GetUncompressedLength(bytes, numBytes, &uncompressedSize) &&
+                (uncompressedSize == outSize) && snappy::RawUncompress(bytes, numBytes, out);
+        }
+#ifdef PDB_HAVE_LZ4
+        case LZ4Codec:
+            return LZ4_decompress_safe(bytes, out, (int)numBytes, (int)outSize) == (int)outSize;
+#endif
+#ifdef PDB_HAVE_ZSTD
+        case ZSTDCodec:
+            return ZSTD_decompress(out, outSize, bytes, numBytes) == outSize;
+#endif
+        default:
+            return false;
+    }
+}
+
+void PageCodec::shuffleBytes(const char* bytes, size_t numBytes, char* out) {
+    size_t numWords = numBytes / 8;
+    for (size_t plane = 0; plane < 8; plane++) {
+        char* planeOut = out + plane * numWords;
+        for (size_t i = 0; i < numWords; i++) {
+            planeOut[i] = bytes[i * 8 + plane];
+        }
+    }
+    memcpy(out + numWords * 8, bytes + numWords * 8, numBytes - numWords * 8);
+}
+
+void PageCodec::unshuffleBytes(const char* bytes, size_t numBytes, char* out) {
+    size_t numWords = numBytes / 8;
+    for (size_t plane = 0; plane < 8; plane++) {
+        const char* planeIn = bytes + plane * numWords;
+        for (size_t i = 0; i < numWords; i++) {
+            out[i * 8 + plane] = planeIn[i];
+        }
+    }
+    memcpy(out + numWords * 8, bytes + numWords * 8, numBytes - numWords * 8);
+}
+
+void PageCodec::choose(const char* bytes, size_t numBytes) {
+    auto begin = std::chrono::steady_clock::now();
+
+    // the sample is made of a few pieces from all over the page
+    const int numPieces = 4;
+    size_t sampleSize = (numBytes < PAGE_CODEC_SAMPLE_BYTES) ? numBytes : PAGE_CODEC_SAMPLE_BYTES;
+    size_t pieceSize = (sampleSize / numPieces) & ~(size_t)7;
+    if (pieceSize == 0) {
+        pieceSize = sampleSize;
+    }
+    sampleSize = 0;
+    sampleBuffer.resize(PAGE_CODEC_SAMPLE_BYTES);
+    for (int i = 0; (i < numPieces) && (sampleSize + pieceSize <= numBytes); i++) {
+        size_t offset = ((numBytes - pieceSize) / (numPieces - 1) * i) & ~(size_t)7;
+        memcpy(sampleBuffer.data() + sampleSize, bytes + offset, pieceSize);
+        sampleSize += pieceSize;
+    }
+    if (sampleSize == 0) {
+        chosenCodec = NoCodec;
+        chosenShuffled = false;
+        return;
+    }
+    shuffleBuffer.resize(std::max(shuffleBuffer.size(), sampleSize));
+    shuffleBytes(sampleBuffer.data(), sampleSize, shuffleBuffer.data());
+
+    // the nanoseconds it takes to get a byte of the page to the receiver with every codec
+    double bestCost = 1e9 / bandwidth;
+    chosenCodec = NoCodec;
+    chosenShuffled = false;
+    for (int i = 1; i < NUM_PAGE_CODECS; i++) {
+        PageCodecType codec = (PageCodecType)i;
+        if (isAvailable(codec) == false) {
+            continue;
+        }
+        size_t outSize = getMaxCompressedSize(codec, sampleSize);
+        sampleOutputBuffer.resize(std::max(sampleOutputBuffer.size(), outSize));
+        for (int shuffled = 0; shuffled < 2; shuffled++) {
+            auto compressBegin = std::chrono::steady_clock::now();
+            size_t compressedSize =
+                compress(codec,
+                         shuffled ? shuffleBuffer.data() : sampleBuffer.data(),
+                         sampleSize,
+                         sampleOutputBuffer.data(),
+                         outSize);
+            long nanos = nanosSince(compressBegin);
+            if (compressedSize == 0) {
+                continue;
+            }
+            double cost =
+                (double)nanos / sampleSize + (double)compressedSize / sampleSize * 1e9 / bandwidth;
+            if (cost < bestCost) {
+                bestCost = cost;
+                chosenCodec = codec;
+                chosenShuffled = (shuffled == 1);
+            }
+        }
+    }
+    stats.sampleNanos += nanosSince(begin);
+}
+
+const char* PageCodec::encode(const void* bytes, size_t numBytes, PageFrameHeader& header) {
+    memset(&header, 0, sizeof(PageFrameHeader));
+    header.numBytes = numBytes;
+    if (adaptive) {
+        if (pagesUntilSample == 0) {
+            choose((const char*)bytes, numBytes);
+            pagesUntilSample = PAGE_CODEC_SAMPLE_INTERVAL;
+        }
+        pagesUntilSample--;
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    const char* encodedBytes = (const char*)bytes;
+    size_t numEncodedBytes = numBytes;
+    PageCodecType codec = chosenCodec;
+    if (codec != NoCodec) {
+        const char* input = (const char*)bytes;
+        if (chosenShuffled) {
+            shuffleBuffer.resize(std::max(shuffleBuffer.size(), numBytes));
+            shuffleBytes(input, numBytes, shuffleBuffer.data());
+            input = shuffleBuffer.data();
+        }
+        size_t outSize = getMaxCompressedSize(codec, numBytes);
+        encodeBuffer.resize(std::max(encodeBuffer.size(), outSize));
+        size_t compressedSize = compress(codec, input, numBytes, encodeBuffer.data(), outSize);
+
+        // a page that does not get smaller is sent as it is
+        if ((compressedSize > 0) && (compressedSize < numBytes)) {
+            encodedBytes = encodeBuffer.data();
+            numEncodedBytes = compressedSize;
+            header.shuffled = chosenShuffled;
+        } else {
+            codec = NoCodec;
+        }
+    }
+    header.codec = codec;
+    header.numEncodedBytes = numEncodedBytes;
+
+    stats.numPages[codec]++;
+    if (header.shuffled) {
+        stats.numShuffled++;
+    }
+    stats.numBytesIn += numBytes;
+    stats.numBytesOut += numEncodedBytes;
+    stats.encodeNanos += nanosSince(begin);
+    return encodedBytes;
+}
+
+bool PageCodec::send(PDBCommunicatorPtr sendUsingMe,
+                     const void* bytes,
+                     size_t numBytes,
+                     std::string& errMsg) {
+    PageFrameHeader header;
+    const char* encodedBytes = encode(bytes, numBytes, header);
+    if (sendUsingMe->sendBytes(&header, sizeof(PageFrameHeader), errMsg) == false) {
+        return false;
+    }
+    auto begin = std::chrono::steady_clock::now();
+    if (sendUsingMe->sendBytes((void*)encodedBytes, header.numEncodedBytes, errMsg) == false) {
+        return false;
+    }
+
+    // a big frame fills the socket buffer, so the time to write it follows the bandwidth we get
+    long nanos = nanosSince(begin);
+    if ((header.numEncodedBytes >= 1024 * 1024) && (nanos > 0)) {
+        bandwidth = 0.8 * bandwidth + 0.2 * (header.numEncodedBytes * 1e9 / nanos);
+    }
+    return true;
+}
+
+const PageCodecStats& PageCodec::getStats() {
+    return stats;
+}
+
+double PageCodec::getBandwidth() {
+    return bandwidth;
+}
+
+bool PageCodec::receiveHeader(PDBCommunicatorPtr receiveFromMe,
+                              PageFrameHeader& header,
+                              std::string& errMsg) {
+    if (receiveFromMe->getSizeOfNextObject() != sizeof(PageFrameHeader)) {
+        errMsg = "PageCodec: expected a page frame header";
+        return false;
+    }
+    if (receiveFromMe->receiveBytes(&header, errMsg) == false) {
+        return false;
+    }
+    if ((header.codec >= NUM_PAGE_CODECS) || (isAvailable((PageCodecType)header.codec) == false)) {
+        errMsg = "PageCodec: can't decode a page encoded with codec " +
+            std::to_string((int)header.codec);
+        return false;
+    }
+    return true;
+}
+
+bool PageCodec::receivePage(PDBCommunicatorPtr receiveFromMe,
+                            const PageFrameHeader& header,
+                            void* bytes,
+                            std::string& errMsg) {
+    if (receiveFromMe->getSizeOfNextObject() != header.numEncodedBytes) {
+        errMsg = "PageCodec: the page is not of the size given by its header";
+        return false;
+    }
+
+    // a page that is not encoded goes right where it belongs
+    if (header.codec == NoCodec) {
+        return receiveFromMe->receiveBytes(bytes, errMsg);
+    }
+    char* encodedBytes = new char[header.numEncodedBytes];
+    bool success = receiveFromMe->receiveBytes(encodedBytes, errMsg) &&
+        decode(header, encodedBytes, bytes, errMsg);
+    delete[] encodedBytes;
+    return success;
+}
+
+bool PageCodec::decode(const PageFrameHeader& header,
+                       const char* encodedBytes,
+                       void* bytes,
+                       std::string& errMsg) {
+    bool success;
+    if (header.shuffled) {
+        char* planes = new char[header.numBytes];
+        success = decompress((PageCodecType)header.codec,
+                             encodedBytes,
+                             header.numEncodedBytes,
+                             planes,
+                             header.numBytes);
+        if (success) {
+            unshuffleBytes(planes, header.numBytes, (char*)bytes);
+        }
+        delete[] planes;
+    } else {
+        success = decompress((PageCodecType)header.codec,
+                             encodedBytes,
+                             header.numEncodedBytes,
+                             (char*)bytes,
+                             header.numBytes);
+    }
+    if (success == false) {
+        errMsg = "PageCodec: can't decode a page encoded with " +
+            getCodecName((PageCodecType)header.codec);
+    }
+    return success;
+}
+}
+
+#endif
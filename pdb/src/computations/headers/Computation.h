@@ -131,6 +131,19 @@ public:
         return getSinkShuffler(consumeMe, projection, plan);
     }
 
+    /**
+     * if the stages this computation adds to a pipeline (the APPLY and FILTER stages of its
+     * lambdas) can be compiled into a single loop, this method returns the executor running that
+     * loop, otherwise it returns nullptr and the stages are run one by one.  It requires the schema
+     * of the TupleSets that go into the first stage, the attributes the first stage operates on,
+     * and the attributes that the last stage carries over from its input
+     */
+    virtual ComputeExecutorPtr getFusedExecutor(TupleSpec& inputSchema,
+                                                TupleSpec& attsToOperateOn,
+                                                TupleSpec& attsToIncludeInOutput) {
+        return nullptr;
+    }
+
     // returns the type of this Computation
     virtual std::string getComputationType() = 0;
 
@@ -23,6 +23,7 @@
 #include "Computation.h"
 #include "PageCircularBufferIterator.h"
 #include "VectorTupleSetIterator.h"
+#include "MorselScheduler.h"
 #include "PDBString.h"
 #include "DataTypes.h"
 #include "DataProxy.h"
@@ -56,6 +57,7 @@ class ScanUserSetBase : public Computation {
   ~ScanUserSetBase() {
     this->iterator = nullptr;
     this->proxy = nullptr;
+    this->morselScheduler = nullptr;
   }
 
   /**
@@ -68,6 +70,8 @@ class ScanUserSetBase : public Computation {
     ScanUserSetBase<OutputClass> &toMe = *((ScanUserSetBase<OutputClass> *) target);
     toMe.iterator = fromMe.iterator;
     toMe.proxy = fromMe.proxy;
+    toMe.morselScheduler = fromMe.morselScheduler;
+    toMe.workerId = fromMe.workerId;
     toMe.batchSize = fromMe.batchSize;
     toMe.dbName = fromMe.dbName;
     toMe.setName = fromMe.setName;
@@ -84,6 +88,26 @@ class ScanUserSetBase : public Computation {
   }
 
   ComputeSourcePtr getComputeSource(TupleSpec &schema, ComputePlan &plan) override {
+
+    // the threads of the stage share the pages, in morsels
+    if (this->morselScheduler != nullptr) {
+      return std::make_shared<MorselTupleSetIterator>(
+
+          [&](Morsel &morsel) -> bool {
+            return this->morselScheduler->getNextMorsel(this->workerId, morsel);
+          },
+
+          [&](Morsel &morsel) -> void {
+            if (this->morselScheduler->finishMorsel(morsel)) {
+              this->releasePage(morsel.page);
+            }
+          },
+
+          this->batchSize
+
+      );
+    }
+
     return std::make_shared<VectorTupleSetIterator>(
 
         [&]() -> void * {
@@ -103,24 +127,7 @@ class ScanUserSetBase : public Computation {
         },
 
         [&](void *freeMe) -> void {
-          if (this->proxy != nullptr) {
-            char *pageRawBytes = (char *) freeMe -
-                (sizeof(NodeID) + sizeof(DatabaseID) + sizeof(UserTypeID) + sizeof(SetID) +
-                    sizeof(PageID) + sizeof(int) + sizeof(size_t));
-
-            PDBPagePtr page = make_shared<PDBPage>(pageRawBytes, 0, 0);
-            NodeID nodeId = page->getNodeID();
-            DatabaseID dbId = page->getDbID();
-            UserTypeID typeId = page->getTypeID();
-            SetID setId = page->getSetID();
-            try {
-              this->proxy->unpinUserPage(nodeId, dbId, typeId, setId, page, false);
-            } catch (NotEnoughSpace &n) {
-              makeObjectAllocatorBlock(4096, true);
-              this->proxy->unpinUserPage(nodeId, dbId, typeId, setId, page, false);
-              throw n;
-            }
-          }
+          this->releasePage(freeMe);
         },
 
         this->batchSize
@@ -128,6 +135,31 @@ class ScanUserSetBase : public Computation {
     );
   }
 
+  /**
+   * unpins a page we are done with
+   * @param freeMe - the bytes of the page, as returned by PDBPage::getBytes()
+   */
+  void releasePage(void *freeMe) {
+    if (this->proxy != nullptr) {
+      char *pageRawBytes = (char *) freeMe -
+          (sizeof(NodeID) + sizeof(DatabaseID) + sizeof(UserTypeID) + sizeof(SetID) +
+              sizeof(PageID) + sizeof(int) + sizeof(size_t));
+
+      PDBPagePtr page = make_shared<PDBPage>(pageRawBytes, 0, 0);
+      NodeID nodeId = page->getNodeID();
+      DatabaseID dbId = page->getDbID();
+      UserTypeID typeId = page->getTypeID();
+      SetID setId = page->getSetID();
+      try {
+        this->proxy->unpinUserPage(nodeId, dbId, typeId, setId, page, false);
+      } catch (NotEnoughSpace &n) {
+        makeObjectAllocatorBlock(4096, true);
+        this->proxy->unpinUserPage(nodeId, dbId, typeId, setId, page, false);
+        throw n;
+      }
+    }
+  }
+
   /**
    * Be careful here that we put PageCircularBufferIteratorPtr and DataProxyPtr in a pdb object
    * @param iterator
@@ -140,6 +172,17 @@ class ScanUserSetBase : public Computation {
     this->proxy = proxy;
   }
 
+  /**
+   * Makes this scan take its objects in morsels from a scheduler shared by the threads of a pipeline
+   * stage, rather than taking whole pages from its iterator
+   * @param morselScheduler - the scheduler, nullptr to go back to whole pages
+   * @param workerId - the id of the thread running this scan
+   */
+  void setMorselScheduler(MorselSchedulerPtr morselScheduler, int workerId) {
+    this->morselScheduler = morselScheduler;
+    this->workerId = workerId;
+  }
+
   void setBatchSize(int batchSize) override {
     this->batchSize = batchSize;
   }
@@ -287,6 +330,10 @@ class ScanUserSetBase : public Computation {
 
   DataProxyPtr proxy = nullptr;
 
+  MorselSchedulerPtr morselScheduler = nullptr;
+
+  int workerId = 0;
+
   String dbName;
 
   String setName;
@@ -23,6 +23,7 @@
 #include "VectorSink.h"
 #include "ScanUserSet.h"
 #include "TypeName.h"
+#include "FusedSelectionExecutor.h"
 
 namespace pdb {
 template<class OutputClass, class InputClass>
@@ -310,6 +311,31 @@ class SelectionCompBase : public Computation {
     return nullptr;
   }
 
+  /**
+   * the selection and the projection run as a single loop if all of their lambdas can be fused
+   * @param inputSchema
+   * @param attsToOperateOn
+   * @param attsToIncludeInOutput
+   * @return
+   */
+  ComputeExecutorPtr getFusedExecutor(TupleSpec &inputSchema,
+                                      TupleSpec &attsToOperateOn,
+                                      TupleSpec &attsToIncludeInOutput) override {
+
+    Handle<InputClass> checkMe = nullptr;
+    RowFunction<bool> selection = getSelection(checkMe).getRowFunction();
+    RowFunction<Handle<OutputClass>> projection = getProjection(checkMe).getRowFunction();
+    if (selection == nullptr || projection == nullptr) {
+      return nullptr;
+    }
+
+    return std::make_shared<FusedSelectionExecutor<InputClass, Handle<OutputClass>>>(inputSchema,
+                                                                                      attsToOperateOn,
+                                                                                      attsToIncludeInOutput,
+                                                                                      selection,
+                                                                                      projection);
+  }
+
   bool needsMaterializeOutput() override {
     return materializeSelectionOut;
   }
@@ -85,6 +85,37 @@ using namespace std;
 #define DEFAULT_NUM_CORES 8
 #endif
 
+// split the shared memory pool into per-NUMA-node arenas, and pin the workers to cores
+#ifndef DEFAULT_USE_NUMA
+#define DEFAULT_USE_NUMA false
+#endif
+
+// the pages backing the shared memory pool, the huge page modes fall back to transparent huge
+// pages and then to regular pages if the kernel has no huge pages to give
+#ifndef DEFAULT_HUGE_PAGE_MODE
+#define DEFAULT_HUGE_PAGE_MODE RegularPages
+#endif
+
+// the codec used for the pages sent between the nodes and to the clients: "none", "snappy", "lz4",
+// "zstd", or "adaptive" to pick one for every page
+#ifndef DEFAULT_TRANSFER_CODEC
+#ifdef ENABLE_COMPRESSION
+#define DEFAULT_TRANSFER_CODEC "adaptive"
+#else
+#define DEFAULT_TRANSFER_CODEC "none"
+#endif
+#endif
+
+// the network bandwidth assumed before any page is sent, in MB per second
+#ifndef DEFAULT_NETWORK_BANDWIDTH
+#define DEFAULT_NETWORK_BANDWIDTH 1024
+#endif
+
+// the replacement strategy of the page cache, UnifiedTwoQueue is scan-resistant
+#ifndef DEFAULT_CACHE_STRATEGY
+#define DEFAULT_CACHE_STRATEGY UnifiedMRU
+#endif
+
 // create a smart pointer for Configuration objects
 class Configuration;
 typedef shared_ptr<Configuration> ConfigurationPtr;
@@ -106,6 +137,9 @@ private:
     size_t maxPageSize;
     bool useUnixDomainSock;
     size_t shmSize;
+    CacheStrategy cacheStrategy;
+    bool useNuma;
+    HugePageMode hugePageMode;
     bool logEnabled;
     string dataDirs;
     string metaDir;
@@ -122,6 +156,8 @@ private:
     LogLevel logLevel;
     string rootDir;
     string statisticsDB;
+    string transferCodec;
+    size_t networkBandwidth;
 
 public:
     Configuration() {
@@ -144,6 +180,9 @@ public:
         assert(broadcastPageSize <= maxPageSize);
         useUnixDomainSock = false;
         shmSize = DEFAULT_SHAREDMEM_SIZE;
+        cacheStrategy = DEFAULT_CACHE_STRATEGY;
+        useNuma = DEFAULT_USE_NUMA;
+        hugePageMode = DEFAULT_HUGE_PAGE_MODE;
         logEnabled = false;
         numThreads = DEFAULT_NUM_THREADS;
         ipcFile = "/tmp/ipcFile";
@@ -153,6 +192,8 @@ public:
         hashPageSize = DEFAULT_HASH_PAGE_SIZE;
         initDirs();
         statisticsDB = "statDB";
+        transferCodec = DEFAULT_TRANSFER_CODEC;
+        networkBandwidth = DEFAULT_NETWORK_BANDWIDTH;
     }
 
     void initDirs() {
@@ -238,6 +279,18 @@ public:
         return shmSize;
     }
 
+    CacheStrategy getCacheStrategy() const {
+        return cacheStrategy;
+    }
+
+    bool getUseNuma() const {
+        return useNuma;
+    }
+
+    HugePageMode getHugePageMode() const {
+        return hugePageMode;
+    }
+
     bool isLogEnabled() const {
         return logEnabled;
     }
@@ -325,6 +378,18 @@ public:
         this->shmSize = shmSize;
     }
 
+    void setCacheStrategy(CacheStrategy cacheStrategy) {
+        this->cacheStrategy = cacheStrategy;
+    }
+
+    void setUseNuma(bool useNuma) {
+        this->useNuma = useNuma;
+    }
+
+    void setHugePageMode(HugePageMode hugePageMode) {
+        this->hugePageMode = hugePageMode;
+    }
+
     void setUseUnixDomainSock(bool useUnixDomainSock) {
         this->useUnixDomainSock = useUnixDomainSock;
     }
@@ -444,6 +509,22 @@ public:
         this->statisticsDB = statisticsDB;
     }
 
+    std::string getTransferCodec() {
+        return this->transferCodec;
+    }
+
+    void setTransferCodec(std::string transferCodec) {
+        this->transferCodec = transferCodec;
+    }
+
+    size_t getNetworkBandwidth() {
+        return this->networkBandwidth;
+    }
+
+    void setNetworkBandwidth(size_t networkBandwidth) {
+        this->networkBandwidth = networkBandwidth;
+    }
+
     void printOut() {
         cout << "nodeID: " << nodeId << endl;
         cout << "serverName: " << serverName << endl;
@@ -472,6 +553,8 @@ public:
         cout << "managerNodePort: " << managerNodePort << endl;
         cout << "logEnabled: " << logEnabled << endl;
         cout << "batchSize: " << batchSize << endl;
+        cout << "transferCodec: " << transferCodec << endl;
+        cout << "networkBandwidth: " << networkBandwidth << endl;
         cout << "statisticsDB: " << statisticsDB << endl;
     }
 };
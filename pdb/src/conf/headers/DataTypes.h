@@ -51,7 +51,9 @@ typedef enum { JobData, ShuffleData, HashPartitionData, PartialAggregationData }
 
 typedef enum { LRU, MRU, Random } LocalitySetReplacementPolicy;
 
-typedef enum { UnifiedLRU, UnifiedMRU, UnifiedIntelligent } CacheStrategy;
+typedef enum { UnifiedLRU, UnifiedMRU, UnifiedIntelligent, UnifiedTwoQueue } CacheStrategy;
+
+typedef enum { RegularPages, TransparentHugePages, HugePages2MB, HugePages1GB } HugePageMode;
 
 
 typedef enum { Read, RepeatedRead, Write } OperationType;
@@ -0,0 +1,54 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef OBJECTQUERYMODEL_HASHPOLICY_H
+#define OBJECTQUERYMODEL_HASHPOLICY_H
+
+#include "KeyPartitionPolicy.h"
+
+#include <functional>
+
+namespace pdb {
+
+class HashPolicy;
+typedef std::shared_ptr<HashPolicy> HashPolicyPtr;
+
+/**
+ * HashPolicy sends an object to the node its key hashes to, the hash modulo the number of nodes.
+ * The hash is given by the client, from a lambda that extracts the key; keyTypeName tells hashes
+ * of different types of keys apart in the partition scheme.
+ */
+class HashPolicy : public KeyPartitionPolicy {
+public:
+    HashPolicy(std::string keyName,
+               std::string keyTypeName,
+               std::function<size_t(Handle<Object>&)> hashKey);
+    ~HashPolicy();
+
+    int getNodeIndex(Handle<Object>& object, size_t keyHash) override;
+
+    std::string getPartitionScheme() override;
+
+    PartitionPolicy::Policy getPolicy() override;
+
+private:
+    std::string keyTypeName;
+};
+}
+
+
+#endif  // OBJECTQUERYMODEL_HASHPOLICY_H
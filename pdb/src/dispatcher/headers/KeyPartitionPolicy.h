@@ -0,0 +1,88 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef OBJECTQUERYMODEL_KEYPARTITIONPOLICY_H
+#define OBJECTQUERYMODEL_KEYPARTITIONPOLICY_H
+
+#include "PartitionPolicy.h"
+#include "HyperLogLog.h"
+
+#include <functional>
+#include <string>
+
+namespace pdb {
+
+class KeyPartitionPolicy;
+typedef std::shared_ptr<KeyPartitionPolicy> KeyPartitionPolicyPtr;
+
+/**
+ * A KeyPartitionPolicy sends every object to a node chosen from a key of the object, which a lambda
+ * of the client extracts, so the objects with the same key are stored on the same node. The nodes
+ * are kept in the order of their addresses, so the same lambda maps a key to the same node in every
+ * set that is partitioned over the same nodes. Two sets partitioned with the same scheme are
+ * co-partitioned: a join on their partition keys can join each node's part of the sets on the node,
+ * without shuffling them. The key is named after the member or the method a join uses to get it.
+ * The policy also estimates the number of distinct keys it has partitioned, for the planner.
+ */
+class KeyPartitionPolicy : public PartitionPolicy {
+public:
+    // hashKey hashes the key of an object
+    KeyPartitionPolicy(std::string keyName, std::function<size_t(Handle<Object>&)> hashKey);
+    ~KeyPartitionPolicy();
+
+    void updateStorageNodes(Handle<Vector<Handle<NodeDispatcherData>>> storageNodes);
+
+    std::shared_ptr<std::unordered_map<NodeID, Handle<Vector<Handle<Object>>>>> partition(
+        Handle<Vector<Handle<Object>>> toPartition);
+
+    // the index in storageNodes of the node an object with the hash of its key goes to
+    virtual int getNodeIndex(Handle<Object>& object, size_t keyHash) = 0;
+
+    // how keys are mapped to nodes: two sets with the same scheme store equal keys on the same node
+    virtual std::string getPartitionScheme() = 0;
+
+    virtual PartitionPolicy::Policy getPolicy() = 0;
+
+    // the member or the method the key is
+    std::string getPartitionKey();
+
+    // the node with the id, or nullptr
+    NodePartitionDataPtr getNode(NodeID nodeId);
+
+    // the estimated number of distinct keys of the objects partitioned so far
+    size_t getNumDistinctKeys();
+
+protected:
+    std::string keyName;
+    std::function<size_t(Handle<Object>&)> hashKey;
+    HyperLogLog distinctKeys;
+
+    // the address:port of every node, in the order of storageNodes
+    std::string getNodeList();
+
+private:
+    std::vector<NodePartitionDataPtr> createNodePartitionData(
+        Handle<Vector<Handle<NodeDispatcherData>>> storageNodes);
+    NodePartitionDataPtr updateExistingNode(NodePartitionDataPtr newNodeData,
+                                            NodePartitionDataPtr oldNodeData);
+    NodePartitionDataPtr updateNewNode(NodePartitionDataPtr newNode);
+    NodePartitionDataPtr handleDeadNode(NodePartitionDataPtr deadNode);
+};
+}
+
+
+#endif  // OBJECTQUERYMODEL_KEYPARTITIONPOLICY_H
@@ -43,7 +43,8 @@ typedef std::shared_ptr<PartitionPolicy> PartitionPolicyPtr;
  */
 class PartitionPolicy {
 public:
-    enum Policy { RANDOM, ROUNDROBIN, FAIR, DEFAULT };
+    // HASH and RANGE are KeyPartitionPolicies, which are driven by a lambda of the client
+    enum Policy { RANDOM, ROUNDROBIN, FAIR, DEFAULT, HASH, RANGE };
 
     std::vector<NodePartitionDataPtr> createNodePartitionData(
         Handle<Vector<Handle<NodeDispatcherData>>> storageNodes);
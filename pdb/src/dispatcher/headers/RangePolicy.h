@@ -0,0 +1,62 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef OBJECTQUERYMODEL_RANGEPOLICY_H
+#define OBJECTQUERYMODEL_RANGEPOLICY_H
+
+#include "KeyPartitionPolicy.h"
+
+#include <functional>
+
+namespace pdb {
+
+class RangePolicy;
+typedef std::shared_ptr<RangePolicy> RangePolicyPtr;
+
+/**
+ * RangePolicy splits the keys into numRanges ranges at sorted boundaries, and sends the objects of
+ * consecutive ranges to the same node, so every node gets a contiguous part of the keys. The range
+ * of an object is given by the client, from a lambda that extracts the key; the boundaries are
+ * described in the partition scheme, so two sets are co-partitioned only if they have the same.
+ */
+class RangePolicy : public KeyPartitionPolicy {
+public:
+    // getRange returns a range from 0 to numRanges - 1, hashKey only counts the distinct keys
+    RangePolicy(std::string keyName,
+                std::string keyTypeName,
+                std::function<size_t(Handle<Object>&)> hashKey,
+                std::function<int(Handle<Object>&)> getRange,
+                int numRanges,
+                std::string boundaries);
+    ~RangePolicy();
+
+    int getNodeIndex(Handle<Object>& object, size_t keyHash) override;
+
+    std::string getPartitionScheme() override;
+
+    PartitionPolicy::Policy getPolicy() override;
+
+private:
+    std::string keyTypeName;
+    std::function<int(Handle<Object>&)> getRange;
+    int numRanges;
+    std::string boundaries;
+};
+}
+
+
+#endif  // OBJECTQUERYMODEL_RANGEPOLICY_H
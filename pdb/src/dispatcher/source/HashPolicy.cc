@@ -0,0 +1,47 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef OBJECTQUERYMODEL_HASHPOLICY_CC
+#define OBJECTQUERYMODEL_HASHPOLICY_CC
+
+#include "HashPolicy.h"
+
+namespace pdb {
+
+HashPolicy::HashPolicy(std::string keyName,
+                       std::string keyTypeName,
+                       std::function<size_t(Handle<Object>&)> hashKey)
+    : KeyPartitionPolicy(keyName, hashKey) {
+    this->keyTypeName = keyTypeName;
+}
+
+HashPolicy::~HashPolicy() {}
+
+int HashPolicy::getNodeIndex(Handle<Object>& object, size_t keyHash) {
+    return (int)(keyHash % storageNodes.size());
+}
+
+std::string HashPolicy::getPartitionScheme() {
+    return "hash<" + keyTypeName + ">/" + getNodeList();
+}
+
+PartitionPolicy::Policy HashPolicy::getPolicy() {
+    return PartitionPolicy::Policy::HASH;
+}
+}
+
+#endif
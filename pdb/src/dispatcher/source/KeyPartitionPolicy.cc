@@ -0,0 +1,177 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef OBJECTQUERYMODEL_KEYPARTITIONPOLICY_CC
+#define OBJECTQUERYMODEL_KEYPARTITIONPOLICY_CC
+
+#include "PDBDebug.h"
+#include "KeyPartitionPolicy.h"
+
+#include <algorithm>
+
+namespace pdb {
+
+KeyPartitionPolicy::KeyPartitionPolicy(std::string keyName,
+                                       std::function<size_t(Handle<Object>&)> hashKey) {
+    this->storageNodes = std::vector<NodePartitionDataPtr>();
+    this->keyName = keyName;
+    this->hashKey = hashKey;
+}
+
+KeyPartitionPolicy::~KeyPartitionPolicy() {}
+
+void KeyPartitionPolicy::updateStorageNodes(
+    Handle<Vector<Handle<NodeDispatcherData>>> activeStorageNodesRaw) {
+
+    auto oldNodes = storageNodes;
+    auto activeStorageNodes = createNodePartitionData(activeStorageNodesRaw);
+    storageNodes = std::vector<NodePartitionDataPtr>();
+
+    for (int i = 0; i < activeStorageNodes.size(); i++) {
+        bool alreadyContains = false;
+        for (int j = 0; j < oldNodes.size(); j++) {
+            if ((*activeStorageNodes[i]) == (*oldNodes[j])) {
+                storageNodes.push_back(updateExistingNode(activeStorageNodes[i], oldNodes[j]));
+                oldNodes.erase(oldNodes.begin() + j);
+                alreadyContains = true;
+                break;
+            }
+        }
+        if (!alreadyContains) {
+            storageNodes.push_back(updateNewNode(activeStorageNodes[i]));
+        }
+    }
+    for (auto oldNode : oldNodes) {
+        handleDeadNode(oldNode);
+    }
+
+    // the order of the nodes must not depend on the order they are listed in
+    std::sort(storageNodes.begin(),
+              storageNodes.end(),
+              [](const NodePartitionDataPtr& a, const NodePartitionDataPtr& b) {
+                  if (a->getAddress() != b->getAddress()) {
+                      return a->getAddress() < b->getAddress();
+                  }
+                  return a->getPort() < b->getPort();
+              });
+}
+
+std::vector<NodePartitionDataPtr> KeyPartitionPolicy::createNodePartitionData(
+    Handle<Vector<Handle<NodeDispatcherData>>> storageNodes) {
+    std::vector<NodePartitionDataPtr> newData = std::vector<NodePartitionDataPtr>();
+    if (storageNodes == nullptr) {
+        return newData;
+    }
+    for (int i = 0; i < storageNodes->size(); i++) {
+        auto nodeData = (*storageNodes)[i];
+        auto newNode =
+            std::make_shared<NodePartitionData>(nodeData->getNodeId(),
+                                                nodeData->getPort(),
+                                                nodeData->getAddress(),
+                                                std::pair<std::string, std::string>("", ""));
+        PDB_COUT << newNode->toString() << std::endl;
+        newData.push_back(newNode);
+    }
+    return newData;
+}
+
+NodePartitionDataPtr KeyPartitionPolicy::updateExistingNode(NodePartitionDataPtr newNode,
+                                                            NodePartitionDataPtr oldNode) {
+    PDB_COUT << "Updating existing node " << newNode->toString() << std::endl;
+    return oldNode;
+}
+
+NodePartitionDataPtr KeyPartitionPolicy::updateNewNode(NodePartitionDataPtr newNode) {
+    PDB_COUT << "Updating new node " << newNode->toString() << std::endl;
+    return newNode;
+}
+
+NodePartitionDataPtr KeyPartitionPolicy::handleDeadNode(NodePartitionDataPtr deadNode) {
+    PDB_COUT << "Deleting node " << deadNode->toString() << std::endl;
+    return deadNode;
+}
+
+std::shared_ptr<std::unordered_map<NodeID, Handle<Vector<Handle<Object>>>>>
+KeyPartitionPolicy::partition(Handle<Vector<Handle<Object>>> toPartition) {
+
+    auto partitionedData =
+        std::make_shared<std::unordered_map<NodeID, Handle<Vector<Handle<Object>>>>>();
+    if (storageNodes.size() == 0) {
+        std::cout
+            << "FATAL ERROR: there is no storage node in the cluster, please check conf/serverlist"
+            << std::endl;
+        exit(-1);
+    }
+
+    // bytes can't be partitioned by key
+    if (toPartition == nullptr) {
+        return partitionedData;
+    }
+
+    // the objects of a node are put in a vector of the node in the current allocation block
+    std::vector<Handle<Vector<Handle<Object>>>> nodeVectors(storageNodes.size(), nullptr);
+    size_t numObjects = toPartition->size();
+    for (size_t i = 0; i < numObjects; i++) {
+        Handle<Object>& object = (*toPartition)[i];
+        size_t keyHash = hashKey(object);
+        distinctKeys.add(keyHash);
+        int index = getNodeIndex(object, keyHash);
+        if (nodeVectors[index] == nullptr) {
+            nodeVectors[index] = makeObject<Vector<Handle<Object>>>();
+        }
+        nodeVectors[index]->push_back(object);
+    }
+    for (int i = 0; i < storageNodes.size(); i++) {
+        if (nodeVectors[i] != nullptr) {
+            partitionedData->insert(std::pair<NodeID, Handle<Vector<Handle<Object>>>>(
+                storageNodes[i]->getNodeId(), nodeVectors[i]));
+        }
+    }
+    return partitionedData;
+}
+
+std::string KeyPartitionPolicy::getPartitionKey() {
+    return this->keyName;
+}
+
+NodePartitionDataPtr KeyPartitionPolicy::getNode(NodeID nodeId) {
+    for (auto& node : storageNodes) {
+        if (node->getNodeId() == nodeId) {
+            return node;
+        }
+    }
+    return nullptr;
+}
+
+size_t KeyPartitionPolicy::getNumDistinctKeys() {
+    return distinctKeys.getEstimate();
+}
+
+std::string KeyPartitionPolicy::getNodeList() {
+    std::string nodeList;
+    for (int i = 0; i < storageNodes.size(); i++) {
+        if (i > 0) {
+            nodeList += ",";
+        }
+        nodeList +=
+            storageNodes[i]->getAddress() + ":" + std::to_string(storageNodes[i]->getPort());
+    }
+    return nodeList;
+}
+}
+
+#endif
@@ -34,6 +34,10 @@ PartitionPolicyPtr PartitionPolicyFactory::buildPartitionPolicy(PartitionPolicy:
         case PartitionPolicy::Policy::DEFAULT:
             // Random policy is the default policy
             return buildDefaultPartitionPolicy();
+        case PartitionPolicy::Policy::HASH:
+        case PartitionPolicy::Policy::RANGE:
+            // the lambda of a KeyPartitionPolicy is the client's, so it partitions the data itself
+            return nullptr;
     }
 }
 
@@ -0,0 +1,59 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef OBJECTQUERYMODEL_RANGEPOLICY_CC
+#define OBJECTQUERYMODEL_RANGEPOLICY_CC
+
+#include "RangePolicy.h"
+
+namespace pdb {
+
+RangePolicy::RangePolicy(std::string keyName,
+                         std::string keyTypeName,
+                         std::function<size_t(Handle<Object>&)> hashKey,
+                         std::function<int(Handle<Object>&)> getRange,
+                         int numRanges,
+                         std::string boundaries)
+    : KeyPartitionPolicy(keyName, hashKey) {
+    this->keyTypeName = keyTypeName;
+    this->getRange = getRange;
+    this->numRanges = (numRanges < 1) ? 1 : numRanges;
+    this->boundaries = boundaries;
+}
+
+RangePolicy::~RangePolicy() {}
+
+int RangePolicy::getNodeIndex(Handle<Object>& object, size_t keyHash) {
+    int range = getRange(object);
+    if (range < 0) {
+        range = 0;
+    } else if (range >= numRanges) {
+        range = numRanges - 1;
+    }
+    return (int)((size_t)range * storageNodes.size() / numRanges);
+}
+
+std::string RangePolicy::getPartitionScheme() {
+    return "range<" + keyTypeName + ">[" + boundaries + "]/" + getNodeList();
+}
+
+PartitionPolicy::Policy RangePolicy::getPolicy() {
+    return PartitionPolicy::Policy::RANGE;
+}
+}
+
+#endif
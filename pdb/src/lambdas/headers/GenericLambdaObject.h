@@ -48,6 +48,13 @@ namespace pdb {
 class GenericLambdaObject;
 typedef std::shared_ptr<GenericLambdaObject> GenericLambdaObjectPtr;
 
+/**
+ * a lambda evaluated on one input object, rather than on a column... all of the handles have the
+ * same layout, so the input is passed as a Handle<Object> and cast back by the leaves of the tree
+ */
+template<typename Out>
+using RowFunction = std::function<Out(Handle<Object> &)>;
+
 /**
  * This is the base class from which all pdb :: Lambdas derive
  */
@@ -544,7 +551,31 @@ class TypedLambdaObject : public GenericLambdaObject {
   std::string getOutputType() override {
     return getTypeName<Out>();
   }
+
+  /**
+   * Returns the fused form of the lambda tree rooted here, used when a pipeline is compiled into a
+   * single loop: a function that computes the output for one input object.
+   * @return the function, or nullptr if this lambda or one of its children can only run column by column
+   */
+  virtual RowFunction<Out> getRowFunction() {
+    return nullptr;
+  }
 };
+
+/**
+ * Returns the fused form of a lambda tree, nullptr if it can not be fused
+ * @tparam Out - the type the tree returns
+ * @param tree - the tree
+ * @return the function that evaluates the tree for one input object
+ */
+template<typename Out>
+RowFunction<Out> getRowFunction(LambdaTree<Out> &tree) {
+  auto typedTree = std::dynamic_pointer_cast<TypedLambdaObject<Out>>(tree.getPtr());
+  if (typedTree == nullptr) {
+    return nullptr;
+  }
+  return typedTree->getRowFunction();
+}
 }
 
 #endif
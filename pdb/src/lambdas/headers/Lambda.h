@@ -65,6 +65,14 @@ class Lambda {
     return tree->getInputIndex();
   }
 
+  /**
+   * returns the fused form of this lambda, nullptr if it can only run column by column
+   * @return the function that evaluates the lambda for one input object
+   */
+  RowFunction<ReturnType> getRowFunction() {
+    return tree->getRowFunction();
+  }
+
   /**
    * convert one of these guys to a map
    * @param returnVal
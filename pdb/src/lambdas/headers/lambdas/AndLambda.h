@@ -25,6 +25,7 @@
 #include "TupleSetMachine.h"
 #include "TupleSet.h"
 #include "Ptr.h"
+#include "ColumnKernels.h"
 
 namespace pdb {
 
@@ -136,6 +137,11 @@ public:
                 // get the output column
                 std::vector<bool>& outColumn = output->getColumn<bool>(outAtt);
 
+                // boolean columns are combined a word at a time by the SIMD kernels
+                if (andColumns(leftColumn, rightColumn, outColumn)) {
+                    return output;
+                }
+
                 // loop down the columns, setting the output
                 auto numTuples = leftColumn.size();
                 outColumn.resize(numTuples);
@@ -148,6 +154,26 @@ public:
             "andLambda");
     }
 
+    RowFunction<bool> getRowFunction() override {
+
+        // get the fused form of both sides
+        RowFunction<LeftType> leftFunction = pdb::getRowFunction(lhs);
+        RowFunction<RightType> rightFunction = pdb::getRowFunction(rhs);
+        if (leftFunction == nullptr || rightFunction == nullptr) {
+            return nullptr;
+        }
+
+        // like &&, the right side is only evaluated if the left side is true
+        return [leftFunction, rightFunction](Handle<Object>& in) {
+            LeftType left = leftFunction(in);
+            if (!checkAnd(left, true)) {
+                return false;
+            }
+            RightType right = rightFunction(in);
+            return checkAnd(left, right);
+        };
+    }
+
 
     std::string toTCAPString(std::vector<std::string>& inputTupleSetNames,
                              std::vector<std::string>& inputColumnNames,
@@ -298,6 +298,14 @@ class AttAccessLambda : public TypedLambdaObject<pdb::Ptr<Out>> {
           },
           "attAccessLambda");
   }
+
+  RowFunction<Ptr<Out>> getRowFunction() override {
+      size_t offset = offsetOfAttToProcess;
+      return [offset](Handle<Object> &in) {
+        Handle<ClassType> &input = reinterpret_cast<Handle<ClassType> &>(in);
+        return Ptr<Out>((Out *) ((char *) &(*input) + offset));
+      };
+  }
 };
 }
 
@@ -112,6 +112,22 @@ callLambda(F& func, std::vector<ReturnType>& assignToMe, int which, void** args)
                              CAST(ParamFive, 4));
 }
 
+// only one of these two versions is going to work... a lambda over a single input can be fused
+// into a pipeline loop, a lambda over several inputs (a join predicate) can not
+template <typename F, typename ReturnType, typename ParamOne, typename ParamTwo>
+typename std::enable_if<std::is_base_of<Nothing, ParamTwo>::value, RowFunction<ReturnType>>::type
+makeRowFunction(F& func) {
+    return [func](Handle<Object>& in) mutable {
+        return func(reinterpret_cast<Handle<ParamOne>&>(in));
+    };
+}
+
+template <typename F, typename ReturnType, typename ParamOne, typename ParamTwo>
+typename std::enable_if<!std::is_base_of<Nothing, ParamTwo>::value, RowFunction<ReturnType>>::type
+makeRowFunction(F& func) {
+    return nullptr;
+}
+
 template <typename F,
           typename ReturnType,
           typename ParamOne = Nothing,
@@ -237,6 +253,10 @@ public:
             "nativeLambda");
     }
 
+    RowFunction<ReturnType> getRowFunction() override {
+        return makeRowFunction<F, ReturnType, ParamOne, ParamTwo>(myFunc);
+    }
+
     // JiaNote: we need this to generate TCAP for a cartesian join
     std::string toTCAPStringForCartesianJoin(int lambdaLabel,
                                              std::string computationName,
@@ -311,6 +311,19 @@ class DereferenceLambda : public TypedLambdaObject<OutType> {
 
         "dereferenceLambda");
   }
+
+  RowFunction<OutType> getRowFunction() override {
+
+    // get the fused form of the child
+    RowFunction<Ptr<OutType>> inputFunction = pdb::getRowFunction(input);
+    if (inputFunction == nullptr) {
+      return nullptr;
+    }
+
+    return [inputFunction](Handle<Object> &in) {
+      return *inputFunction(in);
+    };
+  }
 };
 }
 
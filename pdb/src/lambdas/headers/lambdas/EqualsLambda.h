@@ -26,6 +26,7 @@
 #include "TupleSet.h"
 #include "Ptr.h"
 #include "PDBMap.h"
+#include "ColumnKernels.h"
 
 namespace pdb {
 
@@ -395,6 +396,11 @@ class EqualsLambda : public TypedLambdaObject<bool> {
           // get the output column
           std::vector<bool> &outColumn = output->getColumn<bool>(outAtt);
 
+          // primitive columns are compared by the SIMD kernels
+          if (compareColumns(ColumnEquals, leftColumn, rightColumn, outColumn)) {
+            return output;
+          }
+
           // loop down the columns, setting the output
           int numTuples = leftColumn.size();
           outColumn.resize(numTuples);
@@ -449,6 +455,11 @@ class EqualsLambda : public TypedLambdaObject<bool> {
           // get the output column
           std::vector<size_t> &outColumn = output->getColumn<size_t>(outAtt);
 
+          // primitive columns are hashed by the SIMD kernels
+          if (hashColumn(rightColumn, outColumn)) {
+            return output;
+          }
+
           // loop down the columns, setting the output
           int numTuples = rightColumn.size();
           outColumn.resize(numTuples);
@@ -500,6 +511,11 @@ class EqualsLambda : public TypedLambdaObject<bool> {
           // get the output column
           std::vector<size_t> &outColumn = output->getColumn<size_t>(outAtt);
 
+          // primitive columns are hashed by the SIMD kernels
+          if (hashColumn(leftColumn, outColumn)) {
+            return output;
+          }
+
           // loop down the columns, setting the output
           int numTuples = leftColumn.size();
           outColumn.resize(numTuples);
@@ -511,6 +527,22 @@ class EqualsLambda : public TypedLambdaObject<bool> {
 
         "leftHasher");
   }
+
+  RowFunction<bool> getRowFunction() override {
+
+    // get the fused form of both sides
+    RowFunction<LeftType> leftFunction = pdb::getRowFunction(lhs);
+    RowFunction<RightType> rightFunction = pdb::getRowFunction(rhs);
+    if (leftFunction == nullptr || rightFunction == nullptr) {
+      return nullptr;
+    }
+
+    return [leftFunction, rightFunction](Handle<Object> &in) {
+      LeftType left = leftFunction(in);
+      RightType right = rightFunction(in);
+      return checkEquals(left, right);
+    };
+  }
 };
 }
 
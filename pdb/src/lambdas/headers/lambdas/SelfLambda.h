@@ -128,6 +128,13 @@ class SelfLambda : public TypedLambdaObject<pdb::Ptr<ClassType>> {
         },
         "selfLambda");
   }
+
+  RowFunction<Ptr<ClassType>> getRowFunction() override {
+    return [](Handle<Object> &in) {
+      Handle<ClassType> &input = reinterpret_cast<Handle<ClassType> &>(in);
+      return Ptr<ClassType>((ClassType *) &(*input));
+    };
+  }
 };
 }
 
@@ -18,6 +18,7 @@
 #ifndef PDBCLIENT_H
 #define PDBCLIENT_H
 
+#include "BulkLoader.h"
 #include "CatalogClient.h"
 #include "DispatcherClient.h"
 #include "DistributedStorageManagerClient.h"
@@ -28,9 +29,13 @@
 #include "PDBObject.h"
 #include "PDBVector.h"
 #include "PartitionPolicy.h"
+#include "HashPolicy.h"
+#include "RangePolicy.h"
+#include "PDBMap.h"
 #include "PartitionComp.h"
 #include "Partitioner.h"
 #include "SimpleRequest.h"
+#include "StorageClient.h"
 
 /**
  * This class provides functionality so users can connect and access
@@ -194,6 +199,45 @@ namespace pdb {
       bool registerSet(std::pair<std::string, std::string> setAndDatabase,
                        PartitionPolicy::Policy policy);
 
+      /**
+       * Partitions a set by a key of its objects: from now on, sendData sends
+       * every object of this client to the worker the policy picks for its
+       * key, and the sets partitioned with the same scheme are joined on their
+       * keys without a shuffle. The policy is this client's, as its lambda is.
+       *
+       * @param setAndDatabase
+       * @param policy a HashPolicy or a RangePolicy
+       * @return
+       */
+      bool registerKeyPartition(std::pair<std::string, std::string> setAndDatabase,
+                                KeyPartitionPolicyPtr policy);
+
+      /**
+       * Partitions a set by the hash of a key, keyName is the member or the
+       * method of DataType that getKey returns, as a join names it.
+       *
+       * @param setAndDatabase
+       * @return
+       */
+      template <class DataType, class KeyType>
+      bool registerHashPartition(std::pair<std::string, std::string> setAndDatabase,
+                                 std::string keyName,
+                                 std::function<KeyType(Handle<DataType> &)> getKey);
+
+      /**
+       * Partitions a set by ranges of a key: the keys below the first boundary
+       * go to the first range, and so on, and every worker gets consecutive
+       * ranges.
+       *
+       * @param setAndDatabase
+       * @return
+       */
+      template <class DataType, class KeyType>
+      bool registerRangePartition(std::pair<std::string, std::string> setAndDatabase,
+                                  std::string keyName,
+                                  std::function<KeyType(Handle<DataType> &)> getKey,
+                                  std::vector<KeyType> boundaries);
+
       /**
        *
        * @param setAndDatabase
@@ -207,6 +251,21 @@ namespace pdb {
       bool sendBytes(std::pair<std::string, std::string> setAndDatabase,
                      char *bytes, size_t numBytes);
 
+      /**
+       * Loads a set with numThreads threads, each filling pages of pageSize
+       * bytes with its objects, as a BulkLoadFiller does; the pages go
+       * straight to the storage of the workers, the manager is only told how
+       * many there are. The set must exist with that page size.
+       *
+       * @param setAndDatabase
+       * @return
+       */
+      template <class DataType>
+      bool bulkLoad(std::pair<std::string, std::string> setAndDatabase,
+                    std::function<bool(int, Handle<Vector<Handle<DataType>>>)> filler,
+                    size_t pageSize = DEFAULT_PAGE_SIZE,
+                    int numThreads = BULK_LOAD_THREADS);
+
       /****
        * Methods for invoking Query-related operations
        */
@@ -233,6 +292,15 @@ namespace pdb {
       std::function<bool(Handle<SimpleRequestResult>)>
       generateResponseHandler(std::string description, std::string &errMsg);
 
+      // sends the objects of a set that is partitioned by key to their workers
+      template <class DataType>
+      bool sendPartitionedData(std::pair<std::string, std::string> setAndDatabase,
+                               Handle<Vector<Handle<DataType>>> dataToSend,
+                               KeyPartitionPolicyPtr policy);
+
+      // the sets this client partitions by key
+      std::map<std::pair<std::string, std::string>, KeyPartitionPolicyPtr> keyPartitionPolicies;
+
       // Port of the PlinyCompute manager node
       int port;
 
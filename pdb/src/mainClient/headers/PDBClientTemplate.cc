@@ -54,12 +54,111 @@ namespace pdb {
       return result;
     }
 
+    template <class DataType, class KeyType>
+    bool PDBClient::registerHashPartition(std::pair<std::string, std::string> setAndDatabase,
+                                          std::string keyName,
+                                          std::function<KeyType(Handle<DataType> &)> getKey) {
+
+      KeyPartitionPolicyPtr policy = std::make_shared<HashPolicy>(
+          keyName,
+          typeid(KeyType).name(),
+          [getKey](Handle<Object> &object) {
+              Handle<DataType> data = unsafeCast<DataType>(object);
+              return Hasher<KeyType>::hash(getKey(data));
+          });
+      return registerKeyPartition(setAndDatabase, policy);
+    }
+
+    template <class DataType, class KeyType>
+    bool PDBClient::registerRangePartition(std::pair<std::string, std::string> setAndDatabase,
+                                           std::string keyName,
+                                           std::function<KeyType(Handle<DataType> &)> getKey,
+                                           std::vector<KeyType> boundaries) {
+
+      std::sort(boundaries.begin(), boundaries.end());
+
+      // sets are co-partitioned only if they have the same boundaries, which are told apart by
+      // their hashes, as a key may not be printable
+      std::ostringstream description;
+      for (int i = 0; i < boundaries.size(); i++) {
+          description << (i == 0 ? "" : ",") << std::hex << Hasher<KeyType>::hash(boundaries[i]);
+      }
+      KeyPartitionPolicyPtr policy = std::make_shared<RangePolicy>(
+          keyName,
+          typeid(KeyType).name(),
+          [getKey](Handle<Object> &object) {
+              Handle<DataType> data = unsafeCast<DataType>(object);
+              return Hasher<KeyType>::hash(getKey(data));
+          },
+          [getKey, boundaries](Handle<Object> &object) {
+              Handle<DataType> data = unsafeCast<DataType>(object);
+              return (int)(std::upper_bound(boundaries.begin(), boundaries.end(), getKey(data)) -
+                           boundaries.begin());
+          },
+          boundaries.size() + 1,
+          description.str());
+      return registerKeyPartition(setAndDatabase, policy);
+    }
+
+    template <class DataType>
+    bool PDBClient::sendPartitionedData(std::pair<std::string, std::string> setAndDatabase,
+                                        Handle<Vector<Handle<DataType>>> dataToSend,
+                                        KeyPartitionPolicyPtr policy) {
+
+      Handle<Vector<Handle<Object>>> objects = unsafeCast<Vector<Handle<Object>>>(dataToSend);
+
+      // the objects are copied into a vector per worker, in a block that grows until they fit
+      size_t blockSize = dataToSend->size() * (sizeof(DataType) + 64) * 2 + 1024 * 1024;
+      while (true) {
+          const UseTemporaryAllocationBlock tempBlock{blockSize};
+          std::shared_ptr<std::unordered_map<NodeID, Handle<Vector<Handle<Object>>>>> partitions;
+          try {
+              partitions = policy->partition(objects);
+          } catch (NotEnoughSpace &e) {
+              blockSize *= 2;
+              continue;
+          }
+
+          // every worker stores its objects, the manager only counts their bytes
+          size_t numBytes = blockSize - getBytesAvailableInCurrentAllocatorBlock();
+          for (auto &partition : *partitions) {
+              if (partition.second->size() == 0) {
+                  continue;
+              }
+              NodePartitionDataPtr node = policy->getNode(partition.first);
+              StorageClient storageClient(node->getPort(), node->getAddress(), logger);
+              if (!storageClient.storeData(partition.second,
+                                           setAndDatabase.second,
+                                           setAndDatabase.first,
+                                           getTypeName<DataType>(),
+                                           returnedMsg)) {
+                  return false;
+              }
+          }
+          // the planner is told how many distinct keys the set has so far
+          return dispatcherClient->reportBulkLoad(setAndDatabase,
+                                                  getTypeName<DataType>(),
+                                                  0,
+                                                  numBytes,
+                                                  returnedMsg,
+                                                  dataToSend->size(),
+                                                  policy->getPartitionKey(),
+                                                  policy->getNumDistinctKeys());
+      }
+    }
+
     template <class DataType>
     bool PDBClient::sendData(std::pair<std::string, std::string> setAndDatabase,
                              Handle<Vector<Handle<DataType>>> dataToSend) {
 
-      bool result = dispatcherClient->sendData<DataType>(setAndDatabase, dataToSend,
-                                                 returnedMsg);
+      bool result;
+      auto policy = keyPartitionPolicies.find(setAndDatabase);
+      if (policy != keyPartitionPolicies.end()) {
+          result = sendPartitionedData<DataType>(setAndDatabase, dataToSend, policy->second);
+      } else {
+          result = dispatcherClient->sendData<DataType>(setAndDatabase, dataToSend,
+                                                         returnedMsg);
+      }
 
       if (result==false) {
           errorMsg = "Not able to send data: " + returnedMsg;
@@ -90,6 +189,47 @@ namespace pdb {
         return result;
     }
 
+    template <class DataType>
+    bool PDBClient::bulkLoad(std::pair<std::string, std::string> setAndDatabase,
+                             std::function<bool(int, Handle<Vector<Handle<DataType>>>)> filler,
+                             size_t pageSize,
+                             int numThreads) {
+
+      // the pages of a bulk load are not partitioned by key
+      if (keyPartitionPolicies.count(setAndDatabase) > 0) {
+          errorMsg = "Not able to load data: set " + setAndDatabase.first +
+              " is partitioned by key, its data must be sent with sendData";
+          exit(-1);
+      }
+
+      BulkLoader loader(logger, port, address, numThreads);
+      bool result = loader.load(
+          setAndDatabase.second,
+          setAndDatabase.first,
+          getTypeName<DataType>(),
+          [&](int threadId, Handle<Vector<Handle<Object>>> page) {
+              return filler(threadId, unsafeCast<Vector<Handle<DataType>>>(page));
+          },
+          pageSize,
+          returnedMsg);
+
+      if (result==true) {
+          result = dispatcherClient->reportBulkLoad(setAndDatabase,
+                                                    getTypeName<DataType>(),
+                                                    loader.getNumPagesSent(),
+                                                    loader.getNumBytesSent(),
+                                                    returnedMsg,
+                                                    loader.getNumObjectsSent());
+      }
+      if (result==false) {
+          errorMsg = "Not able to load data: " + returnedMsg;
+          exit(-1);
+      } else {
+          cout << "Loaded " << loader.getNumPagesSent() << " pages.\n";
+      }
+      return result;
+    }
+
     template <class... Types>
     bool PDBClient::executeComputations(Handle<Computation> firstParam,
                                         Handle<Types>... args) {
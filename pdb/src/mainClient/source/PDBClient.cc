@@ -305,6 +305,48 @@ namespace pdb {
       return result;
     }
 
+    bool PDBClient::registerKeyPartition(std::pair<std::string, std::string> setAndDatabase,
+                                         KeyPartitionPolicyPtr policy) {
+
+      // the policy maps keys to the workers in the order of their addresses
+      std::vector<std::string> workers;
+      BulkLoader loader(logger, port, address);
+      bool result = loader.getWorkers(workers, returnedMsg);
+      if ((result==true) && workers.empty()) {
+          returnedMsg = "there are no workers";
+          result = false;
+      }
+      if (result==true) {
+          const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+          Handle<Vector<Handle<NodeDispatcherData>>> nodes =
+              makeObject<Vector<Handle<NodeDispatcherData>>>();
+          for (int i = 0; i < workers.size(); i++) {
+              std::string nodeAddress = workers[i];
+              int nodePort = 8108;
+              size_t pos = workers[i].find(":");
+              if (pos != std::string::npos) {
+                  nodeAddress = workers[i].substr(0, pos);
+                  nodePort = stoi(workers[i].substr(pos + 1));
+              }
+              nodes->push_back(makeObject<NodeDispatcherData>(i, nodePort, nodeAddress));
+          }
+          policy->updateStorageNodes(nodes);
+          result = dispatcherClient->registerKeyPartition(setAndDatabase,
+                                                          policy->getPolicy(),
+                                                          policy->getPartitionScheme(),
+                                                          policy->getPartitionKey(),
+                                                          returnedMsg);
+      }
+      if (result==false) {
+          errorMsg = "Not able to register the partitioning of the set: " + returnedMsg;
+          exit(-1);
+      } else {
+          keyPartitionPolicies[setAndDatabase] = policy;
+          cout << "Set is partitioned on " << policy->getPartitionKey() << ".\n";
+      }
+      return result;
+    }
+
     /****
      * Methods for invoking Query-related operations
      */
@@ -27,11 +27,12 @@
 #include "FrontendQueryTestServer.h"
 #include "HermesExecutionServer.h"
 #include "GenericWork.h"
+#include "PageTransferChannel.h"
 
 int main(int argc, char *argv[]) {
 
   std::cout << "Starting up a PDB server!!\n";
-  std::cout << "[Usage] #numThreads(optional) #sharedMemSize(optional, unit: MB) #managerIp(optional) #localIp(optional)" << std::endl;
+  std::cout << "[Usage] #numThreads(optional) #sharedMemSize(optional, unit: MB) #managerIp(optional) #localIp(optional) #transferCodec(optional, none/snappy/lz4/zstd/adaptive) #networkBandwidth(optional, unit: MB/s) #numa(optional, on/off)" << std::endl;
 
   ConfigurationPtr conf = make_shared<Configuration>();
 
@@ -56,7 +57,7 @@ int main(int argc, char *argv[]) {
     exit(-1);
   }
 
-  if (argc == 5) {
+  if (argc >= 5) {
     numThreads = atoi(argv[1]);
     sharedMemSize = (size_t) (atoi(argv[2])) * (size_t) 1024 * (size_t) 1024;
     standalone = false;
@@ -81,10 +82,29 @@ int main(int argc, char *argv[]) {
       localIp = workerAccess;
     }
   }
+
+  if (argc >= 6) {
+    conf->setTransferCodec(argv[5]);
+  }
+
+  if (argc >= 7) {
+    conf->setNetworkBandwidth((size_t) atol(argv[6]));
+  }
+
+  if (argc >= 8) {
+    std::string numa(argv[7]);
+    if ((numa != "on") && (numa != "off")) {
+      std::cout << "numa must be on or off" << std::endl;
+      exit(-1);
+    }
+    conf->setUseNuma(numa == "on");
+  }
+
   conf->initDirs();
 
   std::cout << "Thread number =" << numThreads << std::endl;
   std::cout << "Shared memory size =" << sharedMemSize << std::endl;
+  std::cout << "NUMA mode =" << (conf->getUseNuma() ? "on" : "off") << std::endl;
 
   if (standalone) {
     std::cout << "We are now running in standalone mode" << std::endl;
@@ -103,7 +123,10 @@ int main(int argc, char *argv[]) {
   pdb::PDBLoggerPtr logger = make_shared<pdb::PDBLogger>(frontendLoggerFile);
   conf->setNumThreads(numThreads);
   conf->setShmSize(sharedMemSize);
-  SharedMemPtr shm = make_shared<SharedMem>(conf->getShmSize(), logger);
+  SharedMemPtr shm = make_shared<SharedMem>(conf->getShmSize(),
+                                            logger,
+                                            conf->getUseNuma(),
+                                            conf->getHugePageMode());
 
   std::string ipcFile = std::string("/tmp/") + localIp + std::string("_") + std::to_string(localPort);
   std::cout << "ipcFile=" << ipcFile << std::endl;
@@ -111,6 +134,14 @@ int main(int argc, char *argv[]) {
 
   string errMsg;
   if (shm != nullptr) {
+    // the rings passing pages between the frontend and the backend, they need to be allocated
+    // before the fork, so that both processes see them
+    PageTransferChannelPtr channel = make_shared<PageTransferChannel>(shm);
+    if (channel->isValid()) {
+      shm->setPageTransferChannel(channel);
+    } else {
+      std::cout << "Can't allocate the page rings, using the socket" << std::endl;
+    }
     pid_t child_pid = fork();
     if (child_pid == 0) {
       // I'm the backend server
@@ -136,6 +167,7 @@ int main(int argc, char *argv[]) {
       // frontEnd.addFunctionality<pdb :: PipelineDummyTestServer>();
       frontEnd.addFunctionality<pdb::PangeaStorageServer>(shm, frontEnd.getWorkerQueue(), logger, conf, standalone);
       frontEnd.getFunctionality<pdb::PangeaStorageServer>().startFlushConsumerThreads();
+      frontEnd.getFunctionality<pdb::PangeaStorageServer>().startUnpinConsumerThread();
       bool createSet = true;
       if (!standalone) {
         createSet = false;
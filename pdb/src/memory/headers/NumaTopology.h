@@ -0,0 +1,98 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <vector>
+
+/**
+ * This class describes the NUMA nodes of the machine, as found in /sys/devices/system/node, and
+ * wraps the system calls used to place memory and threads on them.
+ * It does not need libnuma, a machine without NUMA support is seen as a single node holding all
+ * the cores.
+ * The NUMA mode is process-wide: SharedMem turns it on when it splits its pool into per-node
+ * arenas, and the PDBWorkerQueue then pins its workers to cores. Since the backend is forked after
+ * the pool is created, it inherits the mode from the frontend.
+ */
+class NumaTopology {
+public:
+    /**
+     * Return the number of NUMA nodes, at least 1.
+     */
+    static int getNumNodes();
+
+    /**
+     * Return the cores of a node.
+     */
+    static const std::vector<int>& getCpusOfNode(int node);
+
+    /**
+     * Return the node of a core, 0 if the core is unknown.
+     */
+    static int getNodeOfCpu(int cpu);
+
+    /**
+     * Return the node of the core the calling thread is running on.
+     */
+    static int getCurrentNode();
+
+    /**
+     * Return the core a worker should run on, the workers are spread over the nodes in a
+     * round-robin fashion, so that each node gets its share of the workers.
+     */
+    static int getCpuOfWorker(int workerId);
+
+    /**
+     * Ask the kernel to place the pages of [address, address + size) on a node, the range needs to
+     * be aligned to the system page size. Return false if the policy could not be set.
+     */
+    static bool bindMemory(void* address, size_t size, int node);
+
+    /**
+     * Make a thread created with attr run on a single core.
+     */
+    static bool setThreadCpu(pthread_attr_t* attr, int cpu);
+
+    /**
+     * Turn the NUMA mode on or off for the process.
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * If the NUMA mode is on, return true, otherwise, return false.
+     */
+    static bool isEnabled();
+
+private:
+    struct Topology {
+        std::vector<std::vector<int>> cpusOfNodes;
+        std::vector<int> nodesOfCpus;
+    };
+
+    // read the topology from /sys
+    static Topology readTopology();
+
+    // return the topology, it is read the first time it is needed
+    static Topology& getTopology();
+
+    static bool enabled;
+};
+
+#endif /* NUMA_TOPOLOGY_H */
@@ -22,27 +22,61 @@
 #include <pthread.h>
 #include "PDBLogger.h"
 #include "SlabAllocator.h"
+#include "DataTypes.h"
+#include "SharedMemChunkCache.h"
 
 #ifndef USE_MEMCACHED_SLAB_ALLOCATOR
 #include "tlsf.h"
 #endif
 
 #include <memory>
+#include <vector>
 using namespace std;
 class SharedMem;
 typedef shared_ptr<SharedMem> SharedMemPtr;
 
+class PageTransferChannel;
+typedef shared_ptr<PageTransferChannel> PageTransferChannelPtr;
+
+//the arenas of a NUMA pool start at multiples of this size, so that they can be bound to nodes;
+//a pool of 1GB huge pages is split at multiples of 1GB instead
+#ifndef SHARED_MEM_ARENA_ALIGNMENT
+#define SHARED_MEM_ARENA_ALIGNMENT ((size_t)2 * (size_t)1024 * (size_t)1024)
+#endif
+
+//a part of the pool with its own allocator and lock, placed on one NUMA node in NUMA mode
+struct SharedMemArena {
+    char* start;
+    size_t size;
+    int node;
+    pthread_mutex_t* lock;
+#ifndef USE_MEMCACHED_SLAB_ALLOCATOR
+    void* tlsf;
+#endif
+};
+
 
 //this class wraps a shared memory buffer pool for allocating pages
 //this class uses mmap system call
+//the pool can be backed by huge pages to cut the TLB misses of random accesses, like hash table
+//probes, if the kernel can't give the pages asked for, it falls back to transparent huge pages, and
+//then to regular pages
+//the freed chunks of the sizes used by pages are kept in a lock-free SharedMemChunkCache, so that
+//allocating and freeing pages from many threads doesn't serialize on the lock of the allocator
+//in NUMA mode, the pool is split into one arena per NUMA node, an allocation is served by the
+//arena of the node the calling thread runs on, and by the other arenas if that one is full
 
 class SharedMem {
 public:
-    SharedMem(size_t shmMemSize, pdb::PDBLoggerPtr logger);
+    SharedMem(size_t shmMemSize,
+              pdb::PDBLoggerPtr logger,
+              bool useNuma = false,
+              HugePageMode hugePageMode = RegularPages);
     ~SharedMem();
     void lock();
     void unlock();
     void* malloc(size_t size);
+    void* mallocOnNode(size_t size, int node);
     void* mallocAlign(size_t size, size_t alignment, int& offset);
     void free(void* ptr, size_t size);
     long long computeOffset(void* shmAddress);
@@ -54,24 +88,55 @@ public:
     void _free_unsafe(void* ptr, size_t size);
     size_t getShmSize();
 
+    //the pages actually backing the pool, and their name
+    HugePageMode getHugePageMode();
+    static const char* hugePageModeToString(HugePageMode mode);
+
+    //the arenas of the pool, there is only one if the NUMA mode is off
+    int getNumArenas();
+    const SharedMemArena& getArena(int arenaId);
+
+    //the NUMA node holding an address of the pool
+    int getNodeOfAddress(void* ptr);
+
+    //give the cached free chunks back to the allocator, return the number of bytes released
+    size_t releaseCachedChunks();
+
+    //the rings used to pass pages between the frontend and the backend, set before the fork
+    void setPageTransferChannel(PageTransferChannelPtr channel);
+    PageTransferChannelPtr getPageTransferChannel();
+
 protected:
     int initialize();
     void destroy();
-    int getMem();
+    int getMem(HugePageMode hugePageMode);
+    void* mapHugePages(size_t hugePageSize, int hugePageFlag);
+    int initArenas(bool useNuma);
     int initMallocs();
     int initMutex();
+    int initChunkCache();
+    int getArenaOfAddress(void* ptr);
+    void* mallocFromArena(SharedMemArena& arena, size_t size);
+    void freeToArena(SharedMemArena& arena, void* ptr, size_t size);
 
 private:
-    pthread_mutex_t* memLock;
     pdb::PDBLoggerPtr logger;
 #ifdef USE_MEMCACHED_SLAB_ALLOCATOR
     SlabAllocatorPtr allocator;
 #else
     tlsfAllocator allocator;
-    void* my_tlsf;
 #endif
     void* memPool;
     size_t shmMemSize;
+    //the size of the mapping, the pool size rounded up to the huge page size
+    size_t mappedSize;
+    HugePageMode hugePageMode;
+    std::vector<SharedMemArena> arenas;
+    //the arena of each NUMA node
+    std::vector<int> arenasOfNodes;
+    //in the pool, shared with the backend
+    SharedMemChunkCache* chunkCache;
+    PageTransferChannelPtr pageTransferChannel;
 };
 
 #endif /* SHAREDMEM_H */
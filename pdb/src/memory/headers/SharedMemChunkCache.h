@@ -0,0 +1,112 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef SHARED_MEM_CHUNK_CACHE_H
+#define SHARED_MEM_CHUNK_CACHE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// the number of different chunk sizes that can be cached, the pages only come in a few sizes
+#ifndef SHARED_MEM_NUM_CHUNK_CLASSES
+#define SHARED_MEM_NUM_CHUNK_CLASSES 8
+#endif
+
+// the number of chunks of each size a core keeps for itself
+#ifndef SHARED_MEM_CORE_CACHE_CHUNKS
+#define SHARED_MEM_CORE_CACHE_CHUNKS 2
+#endif
+
+// smaller allocations are not cached, they go to the allocator of the pool
+#ifndef SHARED_MEM_MIN_CHUNK_SIZE
+#define SHARED_MEM_MIN_CHUNK_SIZE ((size_t)64 * (size_t)1024)
+#endif
+
+/**
+ * This class caches the freed chunks of the shared memory pool, so that pages of the same size
+ * can be allocated and freed again without taking the lock of the pool allocator.
+ * Each size has a lock-free central free list per arena, which is a stack linked through the
+ * first word of the free chunks, with a tag next to the head to defeat the ABA problem.
+ * In front of the central lists, each core has a few slots that it fills and empties with atomic
+ * exchanges, so the threads running on different cores don't touch the same cache lines.
+ * The cache lives in the pool itself, and the chunks are linked by their offset in the pool, so
+ * the frontend and the forked backend share it. It only uses atomics, no process-local state.
+ * The cached chunks are still allocated from the point of view of the pool allocator, once the
+ * pool is out of memory SharedMem gives them all back with reclaim().
+ */
+class SharedMemChunkCache {
+public:
+    /**
+     * Return the number of bytes needed for the cache of a pool.
+     */
+    static size_t getSize(int numArenas, int numCpus);
+
+    /**
+     * Build the cache in memory of getSize() bytes aligned to a cache line, the chunks are
+     * addresses in the pool starting at base.
+     */
+    static SharedMemChunkCache* create(void* memory, char* base, int numArenas, int numCpus);
+
+    /**
+     * Take a chunk of the given size from the slots of the current core, or from the central list
+     * of an arena, return nullptr if there is none.
+     */
+    void* allocate(size_t size, int arenaId);
+
+    /**
+     * Take a chunk of the given size from the central list of an arena only.
+     */
+    void* allocateFromArena(size_t size, int arenaId);
+
+    /**
+     * Cache a freed chunk of the given size, in the slots of the current core if toCore is set and
+     * there is room, otherwise in the central list of its arena. Return false if the chunk can't
+     * be cached, it then needs to go back to the pool allocator.
+     */
+    bool release(void* ptr, size_t size, int arenaId, bool toCore);
+
+    /**
+     * Take any cached chunk and return its size in size, return nullptr when the cache is empty.
+     */
+    void* reclaim(size_t& size);
+
+private:
+    // the class of a size, if create is set, a free class is taken for a new size
+    int getClass(size_t size, bool create);
+
+    std::atomic<uint64_t>& getCentralList(int arenaId, int classId);
+    std::atomic<uint64_t>& getCoreSlot(int cpu, int classId, int slot);
+    int getCurrentCpu();
+
+    // a chunk is stored as its offset in the pool divided by 8 plus one, so that 0 means none
+    uint64_t encode(void* ptr);
+    void* decode(uint64_t chunk);
+
+    void pushToCentralList(std::atomic<uint64_t>& head, void* ptr);
+    void* popFromCentralList(std::atomic<uint64_t>& head);
+
+    char* base;
+    int numArenas;
+    int numCpus;
+    std::atomic<size_t> classSizes[SHARED_MEM_NUM_CHUNK_CLASSES];
+    // followed by the central lists of each arena, and the slots of each core
+    std::atomic<uint64_t>* centralLists;
+    std::atomic<uint64_t>* coreSlots;
+};
+
+#endif /* SHARED_MEM_CHUNK_CACHE_H */
@@ -0,0 +1,169 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef NUMA_TOPOLOGY_CC
+#define NUMA_TOPOLOGY_CC
+
+#include "NumaTopology.h"
+#include <dirent.h>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+bool NumaTopology::enabled = false;
+
+// parse a cpu list such as "0-3,8-11"
+static std::vector<int> parseCpuList(const std::string& cpuList) {
+    std::vector<int> cpus;
+    std::stringstream stream(cpuList);
+    std::string range;
+    while (std::getline(stream, range, ',')) {
+        if (range.empty() || (range[0] == '\n')) {
+            continue;
+        }
+        size_t dash = range.find('-');
+        int first = atoi(range.c_str());
+        int last = (dash == std::string::npos) ? first : atoi(range.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+NumaTopology::Topology NumaTopology::readTopology() {
+    Topology topology;
+    // only the cores we are allowed to run on
+    cpu_set_t allowedCpus;
+    CPU_ZERO(&allowedCpus);
+    bool knowsAllowedCpus = (sched_getaffinity(0, sizeof(cpu_set_t), &allowedCpus) == 0);
+    DIR* dir = opendir("/sys/devices/system/node");
+    if (dir != nullptr) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+            if ((strncmp(entry->d_name, "node", 4) != 0) || (entry->d_name[4] < '0') ||
+                (entry->d_name[4] > '9')) {
+                continue;
+            }
+            int node = atoi(entry->d_name + 4);
+            std::ifstream file(std::string("/sys/devices/system/node/") + entry->d_name +
+                               "/cpulist");
+            std::string cpuList;
+            std::getline(file, cpuList);
+            if (node >= (int)topology.cpusOfNodes.size()) {
+                topology.cpusOfNodes.resize(node + 1);
+            }
+            for (int cpu : parseCpuList(cpuList)) {
+                if ((knowsAllowedCpus == false) || CPU_ISSET(cpu, &allowedCpus)) {
+                    topology.cpusOfNodes[node].push_back(cpu);
+                }
+            }
+        }
+        closedir(dir);
+    }
+    // no NUMA support, one node with all the cores
+    if (topology.cpusOfNodes.empty()) {
+        topology.cpusOfNodes.resize(1);
+        long numCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        for (int cpu = 0; cpu < numCpus; cpu++) {
+            if ((knowsAllowedCpus == false) || CPU_ISSET(cpu, &allowedCpus)) {
+                topology.cpusOfNodes[0].push_back(cpu);
+            }
+        }
+    }
+    for (size_t node = 0; node < topology.cpusOfNodes.size(); node++) {
+        for (int cpu : topology.cpusOfNodes[node]) {
+            if (cpu >= (int)topology.nodesOfCpus.size()) {
+                topology.nodesOfCpus.resize(cpu + 1, 0);
+            }
+            topology.nodesOfCpus[cpu] = node;
+        }
+    }
+    return topology;
+}
+
+NumaTopology::Topology& NumaTopology::getTopology() {
+    // initialized once, by the first thread that gets here
+    static Topology topology = readTopology();
+    return topology;
+}
+
+int NumaTopology::getNumNodes() {
+    return getTopology().cpusOfNodes.size();
+}
+
+const std::vector<int>& NumaTopology::getCpusOfNode(int node) {
+    return getTopology().cpusOfNodes.at(node);
+}
+
+int NumaTopology::getNodeOfCpu(int cpu) {
+    Topology& topology = getTopology();
+    if ((cpu < 0) || (cpu >= (int)topology.nodesOfCpus.size())) {
+        return 0;
+    }
+    return topology.nodesOfCpus[cpu];
+}
+
+int NumaTopology::getCurrentNode() {
+    return getNodeOfCpu(sched_getcpu());
+}
+
+int NumaTopology::getCpuOfWorker(int workerId) {
+    Topology& topology = getTopology();
+    int numNodes = topology.cpusOfNodes.size();
+    // skip the nodes without cores (memory-only nodes)
+    for (int i = 0; i < numNodes; i++) {
+        const std::vector<int>& cpus = topology.cpusOfNodes[(workerId + i) % numNodes];
+        if (!cpus.empty()) {
+            return cpus[(workerId / numNodes) % cpus.size()];
+        }
+    }
+    return -1;
+}
+
+bool NumaTopology::bindMemory(void* address, size_t size, int node) {
+    if ((node < 0) || (node >= (int)(sizeof(unsigned long) * 8))) {
+        return false;
+    }
+    unsigned long nodeMask = 1UL << node;
+    return syscall(SYS_mbind, address, size, MPOL_BIND, &nodeMask, sizeof(nodeMask) * 8, 0) == 0;
+}
+
+bool NumaTopology::setThreadCpu(pthread_attr_t* attr, int cpu) {
+    if (cpu < 0) {
+        return false;
+    }
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_attr_setaffinity_np(attr, sizeof(cpu_set_t), &cpus) == 0;
+}
+
+void NumaTopology::setEnabled(bool enabled) {
+    NumaTopology::enabled = enabled;
+}
+
+bool NumaTopology::isEnabled() {
+    return NumaTopology::enabled;
+}
+
+#endif
@@ -16,6 +16,7 @@
  *                                                                           *
  *****************************************************************************/
 #include "SharedMem.h"
+#include "NumaTopology.h"
 #include "Configuration.h"
 #include <sys/mman.h>
 #include <unistd.h>
@@ -30,29 +31,49 @@
 #include <stdio.h>
 #include <string>
 #include <iostream>
+#include <fstream>
 
 #ifndef USE_MEMCACHED_SLAB_ALLOCATOR
 #include "tlsf.h"
 #endif
 
-SharedMem::SharedMem(size_t memSize, pdb::PDBLoggerPtr logger) {
+// older headers don't have the flags to pick the size of the huge pages
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+#define HUGE_PAGE_SIZE_2MB ((size_t)2 * (size_t)1024 * (size_t)1024)
+#define HUGE_PAGE_SIZE_1GB ((size_t)1024 * (size_t)1024 * (size_t)1024)
+
+// where the kernel tells whether transparent huge pages are used for shared memory
+#define SHMEM_THP_SETTING "/sys/kernel/mm/transparent_hugepage/shmem_enabled"
+
+SharedMem::SharedMem(size_t memSize,
+                     pdb::PDBLoggerPtr logger,
+                     bool useNuma,
+                     HugePageMode hugePageMode) {
     this->shmMemSize = memSize;
+    this->mappedSize = memSize;
     this->memPool = nullptr;
-    if (this->getMem() < 0) {
+    this->chunkCache = nullptr;
+    this->logger = logger;
+    if (this->getMem(hugePageMode) < 0) {
         std::cout << "Fatal error: initialize shared memory failed with size=" << memSize
                   << std::endl;
         logger->error(std::string("Fatal error: initialize shared memory failed with size=") +
                       std::to_string(memSize));
         exit(-1);
     }
-#ifdef USE_MEMCACHED_SLAB_ALLOCATOR
-    this->allocator =
-        make_shared<SlabAllocator>(this->memPool, this->shmMemSize, DEFAULT_PAGE_SIZE, 512);
-#else
-    this->my_tlsf = this->allocator.tlsf_create_with_pool(this->memPool, this->shmMemSize);
-#endif
+    this->initArenas(useNuma);
+    this->initMallocs();
     this->initMutex();
-    this->logger = logger;
+    this->initChunkCache();
 }
 
 SharedMem::~SharedMem() {
@@ -60,30 +81,147 @@ SharedMem::~SharedMem() {
 }
 
 void SharedMem::lock() {
-    pthread_mutex_lock(this->memLock);
+    for (SharedMemArena& arena : this->arenas) {
+        pthread_mutex_lock(arena.lock);
+    }
 }
 
 void SharedMem::unlock() {
-    pthread_mutex_unlock(this->memLock);
+    for (int i = (int)this->arenas.size() - 1; i >= 0; i--) {
+        pthread_mutex_unlock(this->arenas[i].lock);
+    }
 }
 
 size_t SharedMem::getShmSize() {
     return this->shmMemSize;
 }
 
+HugePageMode SharedMem::getHugePageMode() {
+    return this->hugePageMode;
+}
 
-void* SharedMem::malloc(size_t size) {
+const char* SharedMem::hugePageModeToString(HugePageMode mode) {
+    switch (mode) {
+        case TransparentHugePages:
+            return "transparent huge pages";
+        case HugePages2MB:
+            return "2MB huge pages";
+        case HugePages1GB:
+            return "1GB huge pages";
+        default:
+            return "regular pages";
+    }
+}
+
+void SharedMem::setPageTransferChannel(PageTransferChannelPtr channel) {
+    this->pageTransferChannel = channel;
+}
+
+PageTransferChannelPtr SharedMem::getPageTransferChannel() {
+    return this->pageTransferChannel;
+}
+
+int SharedMem::getNumArenas() {
+    return this->arenas.size();
+}
+
+const SharedMemArena& SharedMem::getArena(int arenaId) {
+    return this->arenas.at(arenaId);
+}
+
+int SharedMem::getArenaOfAddress(void* ptr) {
+    // the arenas are laid out one after the other, and all but the last have the same size
+    size_t offset = (char*)ptr - (char*)this->memPool;
+    int arenaId = offset / this->arenas[0].size;
+    return (arenaId < (int)this->arenas.size()) ? arenaId : (int)this->arenas.size() - 1;
+}
+
+int SharedMem::getNodeOfAddress(void* ptr) {
+    return this->arenas[this->getArenaOfAddress(ptr)].node;
+}
+
+void* SharedMem::mallocFromArena(SharedMemArena& arena, size_t size) {
     void* ptr;
-    this->lock();
+    pthread_mutex_lock(arena.lock);
 #ifdef USE_MEMCACHED_SLAB_ALLOCATOR
     ptr = this->allocator->slabs_alloc_unsafe(size);
 #else
-    ptr = this->allocator.tlsf_malloc(this->my_tlsf, size);
+    ptr = this->allocator.tlsf_malloc(arena.tlsf, size);
 #endif
-    this->unlock();
+    pthread_mutex_unlock(arena.lock);
     return ptr;
 }
 
+void SharedMem::freeToArena(SharedMemArena& arena, void* ptr, size_t size) {
+    pthread_mutex_lock(arena.lock);
+#ifdef USE_MEMCACHED_SLAB_ALLOCATOR
+    this->allocator->slabs_free_unsafe(ptr, size);
+#else
+    this->allocator.tlsf_free(arena.tlsf, ptr);
+#endif
+    pthread_mutex_unlock(arena.lock);
+}
+
+void* SharedMem::mallocOnNode(size_t size, int node) {
+    int numArenas = this->arenas.size();
+    int first = 0;
+    if ((node >= 0) && (node < (int)this->arenasOfNodes.size())) {
+        first = this->arenasOfNodes[node];
+    }
+    bool isCached = (this->chunkCache != nullptr) && (size >= SHARED_MEM_MIN_CHUNK_SIZE);
+    if (isCached == true) {
+        void* ptr = this->chunkCache->allocate(size, first);
+        if (ptr != nullptr) {
+            return ptr;
+        }
+    }
+    // the arena of the node first, then the remote ones
+    for (int i = 0; i < numArenas; i++) {
+        int arenaId = (first + i) % numArenas;
+        void* ptr = nullptr;
+        if ((isCached == true) && (i > 0)) {
+            ptr = this->chunkCache->allocateFromArena(size, arenaId);
+        }
+        if (ptr == nullptr) {
+            ptr = this->mallocFromArena(this->arenas[arenaId], size);
+        }
+        if (ptr != nullptr) {
+            return ptr;
+        }
+    }
+    // the free memory may be sitting in the cache, in chunks of other sizes
+    if ((this->chunkCache != nullptr) && (this->releaseCachedChunks() > 0)) {
+        for (int i = 0; i < numArenas; i++) {
+            void* ptr = this->mallocFromArena(this->arenas[(first + i) % numArenas], size);
+            if (ptr != nullptr) {
+                return ptr;
+            }
+        }
+    }
+    return nullptr;
+}
+
+size_t SharedMem::releaseCachedChunks() {
+    size_t numReleasedBytes = 0;
+    if (this->chunkCache == nullptr) {
+        return 0;
+    }
+    size_t size;
+    void* ptr;
+    while ((ptr = this->chunkCache->reclaim(size)) != nullptr) {
+        this->freeToArena(this->arenas[this->getArenaOfAddress(ptr)], ptr, size);
+        numReleasedBytes += size;
+    }
+    return numReleasedBytes;
+}
+
+void* SharedMem::malloc(size_t size) {
+    if (this->arenas.size() == 1) {
+        return this->mallocOnNode(size, 0);
+    }
+    return this->mallocOnNode(size, NumaTopology::getCurrentNode());
+}
+
 
 void* SharedMem::mallocAlign(size_t size, size_t alignment, int& offset) {
     void* ptr = this->malloc(size + alignment);
@@ -98,13 +236,16 @@ void* SharedMem::mallocAlign(size_t size, size_t alignment, int& offset) {
 
 
 void SharedMem::free(void* ptr, size_t size) {
-    this->lock();
-#ifdef USE_MEMCACHED_SLAB_ALLOCATOR
-    this->allocator->slabs_free_unsafe(ptr, size);
-#else
-    this->allocator.tlsf_free(this->my_tlsf, ptr);
-#endif
-    this->unlock();
+    int arenaId = this->getArenaOfAddress(ptr);
+    if ((this->chunkCache != nullptr) && (size >= SHARED_MEM_MIN_CHUNK_SIZE)) {
+        // only chunks of the local node go to the slots of the core
+        bool isLocal = (this->arenas.size() == 1) ||
+            (this->arenas[arenaId].node == NumaTopology::getCurrentNode());
+        if (this->chunkCache->release(ptr, size, arenaId, isLocal) == true) {
+            return;
+        }
+    }
+    this->freeToArena(this->arenas[arenaId], ptr, size);
 }
 
 
@@ -129,23 +270,146 @@ int SharedMem::initialize() {
 }
 
 void SharedMem::destroy() {
-    if (this->memLock) {
-        pthread_mutex_destroy(this->memLock);
+    for (SharedMemArena& arena : this->arenas) {
+        if (arena.lock) {
+            pthread_mutex_destroy(arena.lock);
+        }
     }
     if (this->memPool && (this->memPool != (void*)-1)) {
-        munmap(this->memPool, this->shmMemSize);
+        munmap(this->memPool, this->mappedSize);
         this->memPool = (void*)-1;
     }
 }
 
-int SharedMem::getMem() {
+void* SharedMem::mapHugePages(size_t hugePageSize, int hugePageFlag) {
+    size_t size = roundUp(this->shmMemSize, hugePageSize);
+    void* pool = mmap(0,
+                      size,
+                      PROT_READ | PROT_WRITE,
+                      MAP_ANON | MAP_SHARED | MAP_HUGETLB | hugePageFlag,
+                      -1,
+                      0);
+    if (pool == MAP_FAILED) {
+        std::cout << "Can't map " << size << " bytes of shared memory with "
+                  << ((hugePageSize == HUGE_PAGE_SIZE_1GB) ? "1GB" : "2MB")
+                  << " huge pages: " << strerror(errno) << std::endl;
+        return MAP_FAILED;
+    }
+    this->mappedSize = size;
+    return pool;
+}
+
+int SharedMem::getMem(HugePageMode hugePageMode) {
     if (this->memPool && (this->memPool != (void*)-1)) {
         return -1;
     }
-    this->memPool = mmap(0, this->shmMemSize, PROT_READ | PROT_WRITE, MAP_ANON | MAP_SHARED, -1, 0);
-    if (this->memPool == (void*)-1) {
-        return -1;
+    this->memPool = MAP_FAILED;
+    this->hugePageMode = RegularPages;
+
+    // the explicit huge pages come from the kernel's reserved pool, which may be too small
+    if (hugePageMode == HugePages1GB) {
+        this->memPool = this->mapHugePages(HUGE_PAGE_SIZE_1GB, MAP_HUGE_1GB);
+        if (this->memPool != MAP_FAILED) {
+            this->hugePageMode = HugePages1GB;
+        }
+    }
+    if ((this->memPool == MAP_FAILED) &&
+        ((hugePageMode == HugePages1GB) || (hugePageMode == HugePages2MB))) {
+        this->memPool = this->mapHugePages(HUGE_PAGE_SIZE_2MB, MAP_HUGE_2MB);
+        if (this->memPool != MAP_FAILED) {
+            this->hugePageMode = HugePages2MB;
+        }
+    }
+
+    if (this->memPool == MAP_FAILED) {
+        this->mappedSize = this->shmMemSize;
+        this->memPool =
+            mmap(0, this->shmMemSize, PROT_READ | PROT_WRITE, MAP_ANON | MAP_SHARED, -1, 0);
+        if (this->memPool == (void*)-1) {
+            return -1;
+        }
+        // the kernel only backs shared memory with transparent huge pages if it is allowed to
+        if ((hugePageMode != RegularPages) &&
+            (madvise(this->memPool, this->shmMemSize, MADV_HUGEPAGE) == 0)) {
+            std::string setting;
+            std::ifstream settingFile(SHMEM_THP_SETTING);
+            std::getline(settingFile, setting);
+            if ((setting.find("[never]") == std::string::npos) &&
+                (setting.find("[deny]") == std::string::npos)) {
+                this->hugePageMode = TransparentHugePages;
+            } else {
+                std::cout << "Transparent huge pages are disabled for shared memory in "
+                          << SHMEM_THP_SETTING << std::endl;
+            }
+        }
     }
+
+    std::string mapping = std::string("Shared memory pool of ") +
+        std::to_string(this->mappedSize) + std::string(" bytes backed by ") +
+        hugePageModeToString(this->hugePageMode) + std::string(" (asked for ") +
+        hugePageModeToString(hugePageMode) + std::string(")");
+    std::cout << mapping << std::endl;
+    this->logger->info(mapping);
+    return 0;
+}
+
+int SharedMem::initArenas(bool useNuma) {
+    int numNodes = NumaTopology::getNumNodes();
+    // mbind() splits the mapping at the arena boundaries, which must fall on the pages mapped
+    size_t alignment = SHARED_MEM_ARENA_ALIGNMENT;
+    if ((this->hugePageMode == HugePages1GB) && (alignment < HUGE_PAGE_SIZE_1GB)) {
+        alignment = HUGE_PAGE_SIZE_1GB;
+    }
+    size_t arenaSize = roundDown(this->shmMemSize / numNodes, alignment);
+#ifdef USE_MEMCACHED_SLAB_ALLOCATOR
+    if (useNuma == true) {
+        std::cout << "The slab allocator can't split the pool, NUMA mode is off" << std::endl;
+        useNuma = false;
+    }
+#endif
+    if ((useNuma == false) || (numNodes == 1) || (arenaSize == 0)) {
+        SharedMemArena arena;
+        arena.start = (char*)this->memPool;
+        arena.size = this->shmMemSize;
+        arena.node = 0;
+        arena.lock = nullptr;
+        this->arenas.push_back(arena);
+        this->arenasOfNodes.clear();
+        return 0;
+    }
+
+    // one arena per node, the last one gets what is left
+    for (int node = 0; node < numNodes; node++) {
+        SharedMemArena arena;
+        arena.start = (char*)this->memPool + node * arenaSize;
+        arena.size = (node == numNodes - 1) ? (this->shmMemSize - node * arenaSize) : arenaSize;
+        arena.node = node;
+        arena.lock = nullptr;
+        // the last binding runs to the end of the mapping, which is rounded up to a whole page
+        size_t bindSize =
+            (node == numNodes - 1) ? (this->mappedSize - node * arenaSize) : arena.size;
+        if (NumaTopology::bindMemory(arena.start, bindSize, node) == false) {
+            std::cout << "Can't bind the shared memory arena to NUMA node " << node << ": "
+                      << strerror(errno) << std::endl;
+        }
+        this->arenas.push_back(arena);
+        this->arenasOfNodes.push_back(node);
+    }
+    NumaTopology::setEnabled(true);
+    std::cout << "Shared memory pool split into " << numNodes << " NUMA arenas of " << arenaSize
+              << " bytes" << std::endl;
+    return 0;
+}
+
+int SharedMem::initMallocs() {
+#ifdef USE_MEMCACHED_SLAB_ALLOCATOR
+    this->allocator =
+        make_shared<SlabAllocator>(this->memPool, this->shmMemSize, DEFAULT_PAGE_SIZE, 512);
+#else
+    for (SharedMemArena& arena : this->arenas) {
+        arena.tlsf = this->allocator.tlsf_create_with_pool(arena.start, arena.size);
+    }
+#endif
     return 0;
 }
 
@@ -158,14 +422,40 @@ void* SharedMem::getPointer(size_t offset) {
 }
 
 int SharedMem::initMutex() {
-    this->memLock = (pthread_mutex_t*)this->_malloc_unsafe(sizeof(pthread_mutex_t));
-    if (this->memLock == 0) {
-        std::cout << "FATAL ERROR: can't allocate for memLock from buffer pool" << std::endl;
-        return -1;
+    // each arena keeps its lock in its own memory, so that it is shared with the backend
+    for (SharedMemArena& arena : this->arenas) {
+#ifdef USE_MEMCACHED_SLAB_ALLOCATOR
+        arena.lock = (pthread_mutex_t*)this->allocator->slabs_alloc_unsafe(sizeof(pthread_mutex_t));
+#else
+        arena.lock = (pthread_mutex_t*)this->allocator.tlsf_malloc(arena.tlsf,
+                                                                  sizeof(pthread_mutex_t));
+#endif
+        if (arena.lock == 0) {
+            std::cout << "FATAL ERROR: can't allocate for memLock from buffer pool" << std::endl;
+            return -1;
+        }
+        if (pthread_mutex_init(arena.lock, nullptr) != 0) {
+            return -1;
+        }
     }
-    if (pthread_mutex_init(this->memLock, nullptr) != 0) {
+    return 0;
+}
+
+int SharedMem::initChunkCache() {
+    int numCpus = sysconf(_SC_NPROCESSORS_CONF);
+    if (numCpus < 1) {
+        numCpus = 1;
+    }
+    size_t size = SharedMemChunkCache::getSize(this->arenas.size(), numCpus);
+    int offset;
+    void* memory = this->mallocAlign(size, 64, offset);
+    if (memory == nullptr) {
+        std::cout << "Can't allocate the chunk cache from the buffer pool, it is disabled"
+                  << std::endl;
         return -1;
     }
+    this->chunkCache =
+        SharedMemChunkCache::create(memory, (char*)this->memPool, this->arenas.size(), numCpus);
     return 0;
 }
 
@@ -173,7 +463,7 @@ void* SharedMem::_malloc_unsafe(size_t size) {
 #ifdef USE_MEMCACHED_SLAB_ALLOCATOR
     return this->allocator->slabs_alloc_unsafe(size);
 #else
-    return this->allocator.tlsf_malloc(this->my_tlsf, size);
+    return this->allocator.tlsf_malloc(this->arenas[0].tlsf, size);
 #endif
 }
 
@@ -181,6 +471,6 @@ void SharedMem::_free_unsafe(void* ptr, size_t size) {
 #ifdef USE_MEMCACHED_SLAB_ALLOCATOR
     return this->allocator->slabs_free_unsafe(ptr, size);
 #else
-    return this->allocator.tlsf_free(this->my_tlsf, ptr);
+    return this->allocator.tlsf_free(this->arenas[this->getArenaOfAddress(ptr)].tlsf, ptr);
 #endif
 }
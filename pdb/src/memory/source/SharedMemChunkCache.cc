@@ -0,0 +1,213 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#include "SharedMemChunkCache.h"
+#include <new>
+#include <sched.h>
+
+// the head of a central list holds the chunk in its low bits and a tag in its high bits, the tag
+// changes with each push and pop, so a thread that read an old head fails its compare-and-swap
+#define CHUNK_OFFSET_BITS 41
+#define CHUNK_OFFSET_MASK (((uint64_t)1 << CHUNK_OFFSET_BITS) - 1)
+
+#define CACHE_LINE_SIZE 64
+
+// the slots of a core fill whole cache lines
+#define CORE_SLOT_STRIDE                                                                  \
+    ((SHARED_MEM_NUM_CHUNK_CLASSES * SHARED_MEM_CORE_CACHE_CHUNKS + 7) / 8 * 8)
+
+static size_t roundToCacheLine(size_t size) {
+    return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+size_t SharedMemChunkCache::getSize(int numArenas, int numCpus) {
+    return roundToCacheLine(sizeof(SharedMemChunkCache)) +
+        roundToCacheLine(sizeof(std::atomic<uint64_t>) * numArenas * SHARED_MEM_NUM_CHUNK_CLASSES) +
+        sizeof(std::atomic<uint64_t>) * numCpus * CORE_SLOT_STRIDE;
+}
+
+SharedMemChunkCache* SharedMemChunkCache::create(void* memory,
+                                                 char* base,
+                                                 int numArenas,
+                                                 int numCpus) {
+    SharedMemChunkCache* cache = new (memory) SharedMemChunkCache();
+    cache->base = base;
+    cache->numArenas = numArenas;
+    cache->numCpus = numCpus;
+    for (int i = 0; i < SHARED_MEM_NUM_CHUNK_CLASSES; i++) {
+        cache->classSizes[i].store(0);
+    }
+    char* next = (char*)memory + roundToCacheLine(sizeof(SharedMemChunkCache));
+    cache->centralLists = (std::atomic<uint64_t>*)next;
+    for (int i = 0; i < numArenas * SHARED_MEM_NUM_CHUNK_CLASSES; i++) {
+        new (&cache->centralLists[i]) std::atomic<uint64_t>(0);
+    }
+    next += roundToCacheLine(sizeof(std::atomic<uint64_t>) * numArenas *
+                             SHARED_MEM_NUM_CHUNK_CLASSES);
+    cache->coreSlots = (std::atomic<uint64_t>*)next;
+    for (int i = 0; i < numCpus * CORE_SLOT_STRIDE; i++) {
+        new (&cache->coreSlots[i]) std::atomic<uint64_t>(0);
+    }
+    return cache;
+}
+
+int SharedMemChunkCache::getClass(size_t size, bool create) {
+    for (int i = 0; i < SHARED_MEM_NUM_CHUNK_CLASSES; i++) {
+        size_t classSize = this->classSizes[i].load(std::memory_order_acquire);
+        if (classSize == size) {
+            return i;
+        }
+        if (classSize == 0) {
+            if (create == false) {
+                return -1;
+            }
+            // another thread, maybe in the other process, may take this class at the same time
+            if ((this->classSizes[i].compare_exchange_strong(classSize, size) == true) ||
+                (classSize == size)) {
+                return i;
+            }
+        }
+    }
+    return -1;
+}
+
+std::atomic<uint64_t>& SharedMemChunkCache::getCentralList(int arenaId, int classId) {
+    return this->centralLists[arenaId * SHARED_MEM_NUM_CHUNK_CLASSES + classId];
+}
+
+std::atomic<uint64_t>& SharedMemChunkCache::getCoreSlot(int cpu, int classId, int slot) {
+    return this->coreSlots[cpu * CORE_SLOT_STRIDE + classId * SHARED_MEM_CORE_CACHE_CHUNKS + slot];
+}
+
+int SharedMemChunkCache::getCurrentCpu() {
+    int cpu = sched_getcpu();
+    return (cpu < 0) ? 0 : cpu % this->numCpus;
+}
+
+uint64_t SharedMemChunkCache::encode(void* ptr) {
+    return (((char*)ptr - this->base) >> 3) + 1;
+}
+
+void* SharedMemChunkCache::decode(uint64_t chunk) {
+    return this->base + ((chunk - 1) << 3);
+}
+
+void SharedMemChunkCache::pushToCentralList(std::atomic<uint64_t>& head, void* ptr) {
+    std::atomic<uint64_t>* next = (std::atomic<uint64_t>*)ptr;
+    uint64_t chunk = this->encode(ptr);
+    uint64_t oldHead = head.load(std::memory_order_relaxed);
+    uint64_t newHead;
+    do {
+        next->store(oldHead & CHUNK_OFFSET_MASK, std::memory_order_relaxed);
+        newHead = (((oldHead >> CHUNK_OFFSET_BITS) + 1) << CHUNK_OFFSET_BITS) | chunk;
+    } while (head.compare_exchange_weak(
+                 oldHead, newHead, std::memory_order_release, std::memory_order_relaxed) == false);
+}
+
+void* SharedMemChunkCache::popFromCentralList(std::atomic<uint64_t>& head) {
+    uint64_t oldHead = head.load(std::memory_order_acquire);
+    while ((oldHead & CHUNK_OFFSET_MASK) != 0) {
+        void* ptr = this->decode(oldHead & CHUNK_OFFSET_MASK);
+        // the chunk may be taken and overwritten by another thread before we read its link, the
+        // pool is always mapped so the read is harmless, and the tag makes the swap below fail
+        uint64_t next = ((std::atomic<uint64_t>*)ptr)->load(std::memory_order_relaxed);
+        uint64_t newHead = (((oldHead >> CHUNK_OFFSET_BITS) + 1) << CHUNK_OFFSET_BITS) |
+            (next & CHUNK_OFFSET_MASK);
+        if (head.compare_exchange_weak(
+                oldHead, newHead, std::memory_order_acquire, std::memory_order_acquire) == true) {
+            return ptr;
+        }
+    }
+    return nullptr;
+}
+
+void* SharedMemChunkCache::allocate(size_t size, int arenaId) {
+    int classId = this->getClass(size, false);
+    if (classId < 0) {
+        return nullptr;
+    }
+    int cpu = this->getCurrentCpu();
+    for (int i = 0; i < SHARED_MEM_CORE_CACHE_CHUNKS; i++) {
+        std::atomic<uint64_t>& slot = this->getCoreSlot(cpu, classId, i);
+        if (slot.load(std::memory_order_relaxed) != 0) {
+            uint64_t chunk = slot.exchange(0, std::memory_order_acquire);
+            if (chunk != 0) {
+                return this->decode(chunk);
+            }
+        }
+    }
+    return this->popFromCentralList(this->getCentralList(arenaId, classId));
+}
+
+void* SharedMemChunkCache::allocateFromArena(size_t size, int arenaId) {
+    int classId = this->getClass(size, false);
+    if (classId < 0) {
+        return nullptr;
+    }
+    return this->popFromCentralList(this->getCentralList(arenaId, classId));
+}
+
+bool SharedMemChunkCache::release(void* ptr, size_t size, int arenaId, bool toCore) {
+    if ((((char*)ptr - this->base) & 7) != 0) {
+        return false;
+    }
+    int classId = this->getClass(size, true);
+    if (classId < 0) {
+        return false;
+    }
+    if (toCore == true) {
+        int cpu = this->getCurrentCpu();
+        uint64_t chunk = this->encode(ptr);
+        for (int i = 0; i < SHARED_MEM_CORE_CACHE_CHUNKS; i++) {
+            std::atomic<uint64_t>& slot = this->getCoreSlot(cpu, classId, i);
+            uint64_t empty = 0;
+            if ((slot.load(std::memory_order_relaxed) == 0) &&
+                (slot.compare_exchange_strong(empty, chunk, std::memory_order_release) == true)) {
+                return true;
+            }
+        }
+    }
+    this->pushToCentralList(this->getCentralList(arenaId, classId), ptr);
+    return true;
+}
+
+void* SharedMemChunkCache::reclaim(size_t& size) {
+    for (int classId = 0; classId < SHARED_MEM_NUM_CHUNK_CLASSES; classId++) {
+        size = this->classSizes[classId].load(std::memory_order_acquire);
+        if (size == 0) {
+            break;
+        }
+        for (int cpu = 0; cpu < this->numCpus; cpu++) {
+            for (int i = 0; i < SHARED_MEM_CORE_CACHE_CHUNKS; i++) {
+                std::atomic<uint64_t>& slot = this->getCoreSlot(cpu, classId, i);
+                if (slot.load(std::memory_order_relaxed) != 0) {
+                    uint64_t chunk = slot.exchange(0, std::memory_order_acquire);
+                    if (chunk != 0) {
+                        return this->decode(chunk);
+                    }
+                }
+            }
+        }
+        for (int arenaId = 0; arenaId < this->numArenas; arenaId++) {
+            void* ptr = this->popFromCentralList(this->getCentralList(arenaId, classId));
+            if (ptr != nullptr) {
+                return ptr;
+            }
+        }
+    }
+    return nullptr;
+}
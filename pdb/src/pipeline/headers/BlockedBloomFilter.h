@@ -0,0 +1,245 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef BLOCKED_BLOOM_FILTER_H
+#define BLOCKED_BLOOM_FILTER_H
+
+#include "Handle.h"
+#include "PDBVector.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// the bits per key a filter is folded down to once all of the keys are in; with 8 bits set per
+// key in a 512 bit block, 10 bits per key gives about 1% false positives
+#ifndef JOIN_RUNTIME_FILTER_BITS_PER_KEY
+#define JOIN_RUNTIME_FILTER_BITS_PER_KEY 10
+#endif
+
+// the size of the filters built on a node, for all of the partitions of a hash table together;
+// a filter starts this large, as we do not know how many keys are coming, and is folded after
+#ifndef JOIN_RUNTIME_FILTER_MAX_BYTES
+#define JOIN_RUNTIME_FILTER_MAX_BYTES (4 * 1024 * 1024)
+#endif
+
+// a filter that lets more than this fraction of the keys it has not seen through is not used
+#ifndef JOIN_RUNTIME_FILTER_MAX_FALSE_POSITIVES
+#define JOIN_RUNTIME_FILTER_MAX_FALSE_POSITIVES 0.3
+#endif
+
+namespace pdb {
+
+class BlockedBloomFilter;
+typedef std::shared_ptr<BlockedBloomFilter> BlockedBloomFilterPtr;
+
+// a split block Bloom filter over the hashes of the join keys: the filter is an array of 512 bit
+// blocks, a cache line each, and a key sets one bit in each of the 8 words of the block its hash
+// picks, so a lookup touches a single cache line. The block is picked by the low bits of the
+// hash, so a filter with a power of two blocks can be folded to half its size by OR-ing its upper
+// half into the lower half, which lets us size it after the keys are in.
+//
+// The build side of a join fills one in while it builds its hash table, the probe side drops the
+// tuples whose hash is not in it before they are joined, or shuffled to be joined.
+class BlockedBloomFilter {
+
+public:
+    static const size_t WORDS_PER_BLOCK = 8;
+    static const size_t BITS_PER_BLOCK = WORDS_PER_BLOCK * 64;
+
+private:
+    // the words, in ownWords if the filter owns them, or somewhere else if it is a view
+    std::vector<uint64_t> ownWords;
+    uint64_t* words;
+    size_t numBlocks;
+
+    // the number of keys inserted, with duplicates
+    size_t numInserted = 0;
+
+    // the hashes of some types are the value itself, so we mix them before we use their bits
+    static uint64_t mix(uint64_t hash) {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    // the bit a key sets in word i of its block, from the high bits of its mixed hash
+    static uint64_t getMask(uint64_t mixed, size_t i) {
+        static const uint32_t salts[WORDS_PER_BLOCK] = {0x47b6137bU,
+                                                        0x44974d91U,
+                                                        0x8824ad5bU,
+                                                        0xa2b7289dU,
+                                                        0x705495c7U,
+                                                        0x2df1424bU,
+                                                        0x9efc4947U,
+                                                        0x5c6bfb31U};
+        return 1ULL << ((((uint32_t)(mixed >> 32)) * salts[i]) >> 26);
+    }
+
+    static size_t toPowerOfTwo(size_t numBlocks) {
+        size_t powerOfTwo = 1;
+        while (powerOfTwo < numBlocks) {
+            powerOfTwo <<= 1;
+        }
+        return powerOfTwo;
+    }
+
+public:
+    // an empty filter of about numBytes bytes, rounded up to a power of two blocks
+    explicit BlockedBloomFilter(size_t numBytes) {
+        numBlocks = toPowerOfTwo((numBytes + BITS_PER_BLOCK / 8 - 1) / (BITS_PER_BLOCK / 8));
+        ownWords.resize(numBlocks * WORDS_PER_BLOCK, 0);
+        words = ownWords.data();
+    }
+
+    // a view of the words of a filter somewhere else, which have to stay there while it is used
+    BlockedBloomFilter(uint64_t* words, size_t numBlocks) : words(words), numBlocks(numBlocks) {}
+
+    void insert(size_t hash) {
+        uint64_t mixed = mix(hash);
+        uint64_t* block = words + (mixed & (numBlocks - 1)) * WORDS_PER_BLOCK;
+        for (size_t i = 0; i < WORDS_PER_BLOCK; i++) {
+            block[i] |= getMask(mixed, i);
+        }
+        numInserted++;
+    }
+
+    // false if the hash was never inserted, true if it probably was
+    bool mayContain(size_t hash) const {
+        uint64_t mixed = mix(hash);
+        const uint64_t* block = words + (mixed & (numBlocks - 1)) * WORDS_PER_BLOCK;
+        for (size_t i = 0; i < WORDS_PER_BLOCK; i++) {
+            uint64_t mask = getMask(mixed, i);
+            if ((block[i] & mask) != mask) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // folds the filter until it has no more than targetNumBlocks blocks, or one
+    void fold(size_t targetNumBlocks) {
+        while ((numBlocks > 1) && (numBlocks > targetNumBlocks)) {
+            size_t half = numBlocks / 2;
+            for (size_t i = 0; i < half * WORDS_PER_BLOCK; i++) {
+                words[i] |= words[i + half * WORDS_PER_BLOCK];
+            }
+            numBlocks = half;
+        }
+        if (!ownWords.empty()) {
+            ownWords.resize(numBlocks * WORDS_PER_BLOCK);
+            ownWords.shrink_to_fit();
+            words = ownWords.data();
+        }
+    }
+
+    // folds the filter down to about bitsPerKey bits for each key inserted
+    void shrink(size_t bitsPerKey = JOIN_RUNTIME_FILTER_BITS_PER_KEY) {
+        fold(toPowerOfTwo((numInserted * bitsPerKey + BITS_PER_BLOCK - 1) / BITS_PER_BLOCK));
+    }
+
+    // ORs in a filter of the same size, so that it has the keys of both
+    bool merge(const BlockedBloomFilter& other) {
+        if (other.numBlocks != numBlocks) {
+            return false;
+        }
+        for (size_t i = 0; i < numBlocks * WORDS_PER_BLOCK; i++) {
+            words[i] |= other.words[i];
+        }
+        numInserted += other.numInserted;
+        return true;
+    }
+
+    // the fraction of the bits that are set
+    double getFillRatio() const {
+        size_t numSet = 0;
+        for (size_t i = 0; i < numBlocks * WORDS_PER_BLOCK; i++) {
+            numSet += __builtin_popcountll(words[i]);
+        }
+        return (double)numSet / (double)(numBlocks * BITS_PER_BLOCK);
+    }
+
+    // the fraction of the hashes that were not inserted that the filter lets through, about the
+    // chance that all 8 bits of a block are set
+    double estimateFalsePositiveRate() const {
+        double fill = getFillRatio();
+        double rate = 1.0;
+        for (size_t i = 0; i < WORDS_PER_BLOCK; i++) {
+            rate *= fill;
+        }
+        return rate;
+    }
+
+    // true if the filter drops enough of what it is asked about to be worth asking
+    bool isSelective() const {
+        return estimateFalsePositiveRate() <= JOIN_RUNTIME_FILTER_MAX_FALSE_POSITIVES;
+    }
+
+    size_t getNumBlocks() const {
+        return numBlocks;
+    }
+
+    size_t getNumInserted() const {
+        return numInserted;
+    }
+
+    size_t getNumBytes() const {
+        return numBlocks * BITS_PER_BLOCK / 8;
+    }
+
+    // the filters of the partitions of a hash table go from node to node in a Vector, one after
+    // the other, each as its number of blocks followed by its words; a partition that has no
+    // filter, or one that is not selective, has 0 blocks, and lets everything through
+    static void appendTo(BlockedBloomFilterPtr filter, Vector<uint64_t>& toMe) {
+        if ((filter == nullptr) || !filter->isSelective()) {
+            toMe.push_back(0);
+            return;
+        }
+        toMe.push_back(filter->numBlocks);
+        for (size_t i = 0; i < filter->numBlocks * WORDS_PER_BLOCK; i++) {
+            toMe.push_back(filter->words[i]);
+        }
+    }
+
+    // the filters in a Vector written by appendTo, as views of its words, nullptr for the
+    // partitions that have none; returns false if the Vector is not well formed
+    static bool readFrom(Vector<uint64_t>& fromMe, std::vector<BlockedBloomFilterPtr>& filters) {
+        uint64_t* data = fromMe.c_ptr();
+        size_t size = fromMe.size();
+        size_t pos = 0;
+        while (pos < size) {
+            size_t numBlocks = data[pos++];
+            if (numBlocks == 0) {
+                filters.push_back(nullptr);
+                continue;
+            }
+            if (((numBlocks & (numBlocks - 1)) != 0) ||
+                (numBlocks * WORDS_PER_BLOCK > size - pos)) {
+                return false;
+            }
+            filters.push_back(std::make_shared<BlockedBloomFilter>(data + pos, numBlocks));
+            pos += numBlocks * WORDS_PER_BLOCK;
+        }
+        return true;
+    }
+};
+}
+
+#endif
@@ -0,0 +1,595 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef COLUMN_KERNELS_H
+#define COLUMN_KERNELS_H
+
+#include "PDBMap.h"
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(DISABLE_SIMD_KERNELS)
+#define PDB_X86_KERNELS
+#include <immintrin.h>
+#define PDB_AVX2_TARGET __attribute__((target("avx2")))
+#define PDB_AVX512_TARGET __attribute__((target("avx512f")))
+#endif
+
+// Column-at-a-time kernels for the built-in lambdas: comparisons of primitive columns (==, <, >),
+// AND/OR of boolean columns, and hashing of primitive columns. Boolean results are produced as
+// bitmasks of 64 bit words, least significant bit first, which is exactly how libstdc++ lays out
+// a std::vector<bool>, so the kernels write straight into the bool columns of a TupleSet without
+// going through the bit proxies. The widest instruction set the CPU supports is picked at run
+// time; the scalar code is the fallback and also handles the rows that do not fill a whole word.
+
+namespace pdb {
+
+// the instruction sets we have kernels for
+typedef enum { ScalarKernels, AVX2Kernels, AVX512Kernels } ColumnKernelLevel;
+
+// the comparisons we have kernels for
+typedef enum { ColumnEquals, ColumnLessThan, ColumnGreaterThan } ColumnComparison;
+
+// figures out the widest instruction set the CPU supports
+inline ColumnKernelLevel detectColumnKernelLevel() {
+#ifdef PDB_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return AVX512Kernels;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return AVX2Kernels;
+    }
+#endif
+    return ScalarKernels;
+}
+
+// the instruction set the kernels are currently using
+inline ColumnKernelLevel& activeColumnKernelLevel() {
+    static ColumnKernelLevel level = detectColumnKernelLevel();
+    return level;
+}
+
+inline ColumnKernelLevel getColumnKernelLevel() {
+    return activeColumnKernelLevel();
+}
+
+// restricts the kernels to the given instruction set (mostly for testing and benchmarking), we
+// never go beyond what the CPU supports
+inline void setColumnKernelLevel(ColumnKernelLevel level) {
+    ColumnKernelLevel supported = detectColumnKernelLevel();
+    activeColumnKernelLevel() = level < supported ? level : supported;
+}
+
+inline const char* columnKernelLevelToString(ColumnKernelLevel level) {
+    switch (level) {
+        case AVX512Kernels:
+            return "AVX-512";
+        case AVX2Kernels:
+            return "AVX2";
+        default:
+            return "scalar";
+    }
+}
+
+inline size_t getNumMaskWords(size_t numRows) {
+    return (numRows + 63) / 64;
+}
+
+// returns the words holding the bits of a std::vector<bool>, or nullptr if the standard library
+// does not store them as 64 bit words
+inline uint64_t* getMaskWords(std::vector<bool>& mask) {
+#if defined(__GLIBCXX__)
+    if (sizeof(std::_Bit_type) == sizeof(uint64_t) && !mask.empty()) {
+        return reinterpret_cast<uint64_t*>(mask.begin()._M_p);
+    }
+#endif
+    return nullptr;
+}
+
+// copies the bits of a std::vector<bool> into words
+inline void loadMaskWords(std::vector<bool>& mask, std::vector<uint64_t>& words) {
+    size_t numRows = mask.size();
+    words.assign(getNumMaskWords(numRows), 0);
+    for (size_t i = 0; i < numRows; i++) {
+        if (mask[i]) {
+            words[i >> 6] |= ((uint64_t)1) << (i & 63);
+        }
+    }
+}
+
+// copies words into the bits of a std::vector<bool>
+inline void storeMaskWords(std::vector<uint64_t>& words, std::vector<bool>& mask) {
+    size_t numRows = mask.size();
+    for (size_t i = 0; i < numRows; i++) {
+        mask[i] = (words[i >> 6] >> (i & 63)) & 1;
+    }
+}
+
+// appends the positions of the set bits to rows
+inline void selectMaskedRows(const uint64_t* words, size_t numRows, std::vector<uint32_t>& rows) {
+    size_t numWords = getNumMaskWords(numRows);
+    for (size_t w = 0; w < numWords; w++) {
+        uint64_t word = words[w];
+        if (w == numWords - 1 && (numRows & 63) != 0) {
+            word &= (((uint64_t)1) << (numRows & 63)) - 1;
+        }
+        while (word != 0) {
+            rows.push_back((uint32_t)(w * 64 + __builtin_ctzll(word)));
+            word &= word - 1;
+        }
+    }
+}
+
+// appends the positions of the true values of a boolean column to rows
+inline void selectMaskedRows(std::vector<bool>& mask, std::vector<uint32_t>& rows) {
+    uint64_t* words = getMaskWords(mask);
+    if (words != nullptr) {
+        selectMaskedRows(words, mask.size(), rows);
+        return;
+    }
+    size_t numRows = mask.size();
+    for (size_t i = 0; i < numRows; i++) {
+        if (mask[i]) {
+            rows.push_back(i);
+        }
+    }
+}
+
+/**
+ * Scalar kernels, these work for any type, the SIMD ones call them for the rows that do not fill
+ * a whole word.
+ */
+
+template <ColumnComparison op, class T>
+inline bool compareValues(const T& lhs, const T& rhs) {
+    return op == ColumnEquals ? lhs == rhs : (op == ColumnLessThan ? lhs < rhs : lhs > rhs);
+}
+
+template <ColumnComparison op, class T>
+inline void compareScalar(
+    const T* lhs, const T* rhs, size_t fromWord, size_t numRows, uint64_t* out) {
+    for (size_t base = fromWord * 64; base < numRows; base += 64) {
+        size_t limit = numRows - base < 64 ? numRows - base : 64;
+        uint64_t word = 0;
+        for (size_t j = 0; j < limit; j++) {
+            word |= ((uint64_t)compareValues<op>(lhs[base + j], rhs[base + j])) << j;
+        }
+        out[base / 64] = word;
+    }
+}
+
+template <class T>
+inline void hashScalar(const T* in, size_t from, size_t numRows, size_t* out) {
+    for (size_t i = from; i < numRows; i++) {
+        out[i] = Hasher<T>::hash(in[i]);
+    }
+}
+
+/**
+ * AVX2 and AVX-512 kernels
+ */
+
+#ifdef PDB_X86_KERNELS
+
+template <ColumnComparison op>
+PDB_AVX2_TARGET inline uint64_t compareWordAVX2(const int32_t* lhs, const int32_t* rhs) {
+    uint64_t word = 0;
+    for (int j = 0; j < 64; j += 8) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(lhs + j));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(rhs + j));
+        __m256i m = op == ColumnEquals
+            ? _mm256_cmpeq_epi32(a, b)
+            : (op == ColumnLessThan ? _mm256_cmpgt_epi32(b, a) : _mm256_cmpgt_epi32(a, b));
+        word |= ((uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(m))) << j;
+    }
+    return word;
+}
+
+template <ColumnComparison op>
+PDB_AVX2_TARGET inline uint64_t compareWordAVX2(const int64_t* lhs, const int64_t* rhs) {
+    uint64_t word = 0;
+    for (int j = 0; j < 64; j += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(lhs + j));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(rhs + j));
+        __m256i m = op == ColumnEquals
+            ? _mm256_cmpeq_epi64(a, b)
+            : (op == ColumnLessThan ? _mm256_cmpgt_epi64(b, a) : _mm256_cmpgt_epi64(a, b));
+        word |= ((uint64_t)(uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(m))) << j;
+    }
+    return word;
+}
+
+template <ColumnComparison op>
+PDB_AVX2_TARGET inline uint64_t compareWordAVX2(const double* lhs, const double* rhs) {
+    uint64_t word = 0;
+    for (int j = 0; j < 64; j += 4) {
+        __m256d a = _mm256_loadu_pd(lhs + j);
+        __m256d b = _mm256_loadu_pd(rhs + j);
+        // the ordered predicates give false for NaNs, just like the scalar operators
+        __m256d m = _mm256_cmp_pd(
+            a,
+            b,
+            op == ColumnEquals ? _CMP_EQ_OQ : (op == ColumnLessThan ? _CMP_LT_OQ : _CMP_GT_OQ));
+        word |= ((uint64_t)(uint32_t)_mm256_movemask_pd(m)) << j;
+    }
+    return word;
+}
+
+template <ColumnComparison op>
+PDB_AVX512_TARGET inline uint64_t compareWordAVX512(const int32_t* lhs, const int32_t* rhs) {
+    uint64_t word = 0;
+    for (int j = 0; j < 64; j += 16) {
+        __m512i a = _mm512_loadu_si512((const void*)(lhs + j));
+        __m512i b = _mm512_loadu_si512((const void*)(rhs + j));
+        __mmask16 m = _mm512_cmp_epi32_mask(
+            a,
+            b,
+            op == ColumnEquals ? _MM_CMPINT_EQ
+                               : (op == ColumnLessThan ? _MM_CMPINT_LT : _MM_CMPINT_NLE));
+        word |= ((uint64_t)m) << j;
+    }
+    return word;
+}
+
+template <ColumnComparison op>
+PDB_AVX512_TARGET inline uint64_t compareWordAVX512(const int64_t* lhs, const int64_t* rhs) {
+    uint64_t word = 0;
+    for (int j = 0; j < 64; j += 8) {
+        __m512i a = _mm512_loadu_si512((const void*)(lhs + j));
+        __m512i b = _mm512_loadu_si512((const void*)(rhs + j));
+        __mmask8 m = _mm512_cmp_epi64_mask(
+            a,
+            b,
+            op == ColumnEquals ? _MM_CMPINT_EQ
+                               : (op == ColumnLessThan ? _MM_CMPINT_LT : _MM_CMPINT_NLE));
+        word |= ((uint64_t)m) << j;
+    }
+    return word;
+}
+
+template <ColumnComparison op>
+PDB_AVX512_TARGET inline uint64_t compareWordAVX512(const double* lhs, const double* rhs) {
+    uint64_t word = 0;
+    for (int j = 0; j < 64; j += 8) {
+        __m512d a = _mm512_loadu_pd(lhs + j);
+        __m512d b = _mm512_loadu_pd(rhs + j);
+        __mmask8 m = _mm512_cmp_pd_mask(
+            a,
+            b,
+            op == ColumnEquals ? _CMP_EQ_OQ : (op == ColumnLessThan ? _CMP_LT_OQ : _CMP_GT_OQ));
+        word |= ((uint64_t)m) << j;
+    }
+    return word;
+}
+
+template <ColumnComparison op, class T>
+PDB_AVX2_TARGET void compareAVX2(const T* lhs, const T* rhs, size_t numRows, uint64_t* out) {
+    size_t numFullWords = numRows / 64;
+    for (size_t w = 0; w < numFullWords; w++) {
+        out[w] = compareWordAVX2<op>(lhs + w * 64, rhs + w * 64);
+    }
+    compareScalar<op>(lhs, rhs, numFullWords, numRows, out);
+}
+
+template <ColumnComparison op, class T>
+PDB_AVX512_TARGET void compareAVX512(const T* lhs, const T* rhs, size_t numRows, uint64_t* out) {
+    size_t numFullWords = numRows / 64;
+    for (size_t w = 0; w < numFullWords; w++) {
+        out[w] = compareWordAVX512<op>(lhs + w * 64, rhs + w * 64);
+    }
+    compareScalar<op>(lhs, rhs, numFullWords, numRows, out);
+}
+
+// the AND and OR of two masks, isAnd picks which one
+PDB_AVX2_TARGET inline void combineMasksAVX2(
+    const uint64_t* lhs, const uint64_t* rhs, size_t numWords, uint64_t* out, bool isAnd) {
+    size_t w = 0;
+    for (; w + 4 <= numWords; w += 4) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(lhs + w));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(rhs + w));
+        __m256i c = isAnd ? _mm256_and_si256(a, b) : _mm256_or_si256(a, b);
+        _mm256_storeu_si256((__m256i*)(out + w), c);
+    }
+    for (; w < numWords; w++) {
+        out[w] = isAnd ? (lhs[w] & rhs[w]) : (lhs[w] | rhs[w]);
+    }
+}
+
+PDB_AVX512_TARGET inline void combineMasksAVX512(
+    const uint64_t* lhs, const uint64_t* rhs, size_t numWords, uint64_t* out, bool isAnd) {
+    size_t w = 0;
+    for (; w + 8 <= numWords; w += 8) {
+        __m512i a = _mm512_loadu_si512((const void*)(lhs + w));
+        __m512i b = _mm512_loadu_si512((const void*)(rhs + w));
+        __m512i c = isAnd ? _mm512_and_si512(a, b) : _mm512_or_si512(a, b);
+        _mm512_storeu_si512((void*)(out + w), c);
+    }
+    for (; w < numWords; w++) {
+        out[w] = isAnd ? (lhs[w] & rhs[w]) : (lhs[w] | rhs[w]);
+    }
+}
+
+// the integer hash of PDBMap (newHash) eight values at a time, including the remapping of UNUSED
+PDB_AVX2_TARGET inline void hashIntsAVX2(const int32_t* in, size_t numRows, size_t* out) {
+    const __m256i multiplier = _mm256_set1_epi32(0x45d9f3b);
+    const __m256i unused = _mm256_set1_epi32(UNUSED);
+    const __m256i replacement = _mm256_set1_epi32(858931273);
+    size_t i = 0;
+    for (; i + 8 <= numRows; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+        x = _mm256_mullo_epi32(_mm256_xor_si256(_mm256_srli_epi32(x, 16), x), multiplier);
+        x = _mm256_mullo_epi32(_mm256_xor_si256(_mm256_srli_epi32(x, 16), x), multiplier);
+        x = _mm256_xor_si256(_mm256_srli_epi32(x, 16), x);
+        x = _mm256_blendv_epi8(x, replacement, _mm256_cmpeq_epi32(x, unused));
+        _mm256_storeu_si256((__m256i*)(out + i),
+                            _mm256_cvtepu32_epi64(_mm256_castsi256_si128(x)));
+        _mm256_storeu_si256((__m256i*)(out + i + 4),
+                            _mm256_cvtepu32_epi64(_mm256_extracti128_si256(x, 1)));
+    }
+    hashScalar(in, i, numRows, out);
+}
+
+PDB_AVX512_TARGET inline void hashIntsAVX512(const int32_t* in, size_t numRows, size_t* out) {
+    const __m512i multiplier = _mm512_set1_epi32(0x45d9f3b);
+    const __m512i unused = _mm512_set1_epi32(UNUSED);
+    const __m512i replacement = _mm512_set1_epi32(858931273);
+    size_t i = 0;
+    for (; i + 16 <= numRows; i += 16) {
+        __m512i x = _mm512_loadu_si512((const void*)(in + i));
+        x = _mm512_mullo_epi32(_mm512_xor_si512(_mm512_srli_epi32(x, 16), x), multiplier);
+        x = _mm512_mullo_epi32(_mm512_xor_si512(_mm512_srli_epi32(x, 16), x), multiplier);
+        x = _mm512_xor_si512(_mm512_srli_epi32(x, 16), x);
+        x = _mm512_mask_mov_epi32(x, _mm512_cmpeq_epi32_mask(x, unused), replacement);
+        _mm512_storeu_si512((void*)(out + i), _mm512_cvtepu32_epi64(_mm512_castsi512_si256(x)));
+        _mm512_storeu_si512((void*)(out + i + 8),
+                            _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(x, 1)));
+    }
+    hashScalar(in, i, numRows, out);
+}
+
+// std::hash is the identity on integers in libstdc++, so the only work is remapping UNUSED
+PDB_AVX2_TARGET inline void hashLongsAVX2(const int64_t* in, size_t numRows, size_t* out) {
+    const __m256i unused = _mm256_set1_epi64x(UNUSED);
+    const __m256i replacement = _mm256_set1_epi64x(858931273);
+    size_t i = 0;
+    for (; i + 4 <= numRows; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+        x = _mm256_blendv_epi8(x, replacement, _mm256_cmpeq_epi64(x, unused));
+        _mm256_storeu_si256((__m256i*)(out + i), x);
+    }
+    hashScalar(in, i, numRows, out);
+}
+
+PDB_AVX512_TARGET inline void hashLongsAVX512(const int64_t* in, size_t numRows, size_t* out) {
+    const __m512i unused = _mm512_set1_epi64(UNUSED);
+    const __m512i replacement = _mm512_set1_epi64(858931273);
+    size_t i = 0;
+    for (; i + 8 <= numRows; i += 8) {
+        __m512i x = _mm512_loadu_si512((const void*)(in + i));
+        x = _mm512_mask_mov_epi64(x, _mm512_cmpeq_epi64_mask(x, unused), replacement);
+        _mm512_storeu_si512((void*)(out + i), x);
+    }
+    hashScalar(in, i, numRows, out);
+}
+
+#endif
+
+/**
+ * Dispatching on the raw arrays
+ */
+
+// the types we have comparison kernels for, everything else goes through the scalar loops of the
+// lambdas
+template <class T>
+struct IsKernelType {
+    static const bool value = std::is_same<T, int32_t>::value ||
+        std::is_same<T, int64_t>::value || std::is_same<T, double>::value;
+};
+
+template <ColumnComparison op, class T>
+inline void compareArrays(const T* lhs, const T* rhs, size_t numRows, uint64_t* out) {
+#ifdef PDB_X86_KERNELS
+    switch (getColumnKernelLevel()) {
+        case AVX512Kernels:
+            compareAVX512<op>(lhs, rhs, numRows, out);
+            return;
+        case AVX2Kernels:
+            compareAVX2<op>(lhs, rhs, numRows, out);
+            return;
+        default:
+            break;
+    }
+#endif
+    compareScalar<op>(lhs, rhs, 0, numRows, out);
+}
+
+template <class T>
+inline void compareArrays(
+    ColumnComparison op, const T* lhs, const T* rhs, size_t numRows, uint64_t* out) {
+    switch (op) {
+        case ColumnEquals:
+            compareArrays<ColumnEquals>(lhs, rhs, numRows, out);
+            break;
+        case ColumnLessThan:
+            compareArrays<ColumnLessThan>(lhs, rhs, numRows, out);
+            break;
+        case ColumnGreaterThan:
+            compareArrays<ColumnGreaterThan>(lhs, rhs, numRows, out);
+            break;
+    }
+}
+
+inline void combineMasks(
+    const uint64_t* lhs, const uint64_t* rhs, size_t numWords, uint64_t* out, bool isAnd) {
+#ifdef PDB_X86_KERNELS
+    switch (getColumnKernelLevel()) {
+        case AVX512Kernels:
+            combineMasksAVX512(lhs, rhs, numWords, out, isAnd);
+            return;
+        case AVX2Kernels:
+            combineMasksAVX2(lhs, rhs, numWords, out, isAnd);
+            return;
+        default:
+            break;
+    }
+#endif
+    for (size_t w = 0; w < numWords; w++) {
+        out[w] = isAnd ? (lhs[w] & rhs[w]) : (lhs[w] | rhs[w]);
+    }
+}
+
+inline void hashArray(const int32_t* in, size_t numRows, size_t* out) {
+#ifdef PDB_X86_KERNELS
+    switch (getColumnKernelLevel()) {
+        case AVX512Kernels:
+            hashIntsAVX512(in, numRows, out);
+            return;
+        case AVX2Kernels:
+            hashIntsAVX2(in, numRows, out);
+            return;
+        default:
+            break;
+    }
+#endif
+    hashScalar(in, 0, numRows, out);
+}
+
+inline void hashArray(const int64_t* in, size_t numRows, size_t* out) {
+#if defined(PDB_X86_KERNELS) && defined(__GLIBCXX__)
+    switch (getColumnKernelLevel()) {
+        case AVX512Kernels:
+            hashLongsAVX512(in, numRows, out);
+            return;
+        case AVX2Kernels:
+            hashLongsAVX2(in, numRows, out);
+            return;
+        default:
+            break;
+    }
+#endif
+    hashScalar(in, 0, numRows, out);
+}
+
+/**
+ * Dispatching on the columns of a TupleSet, these return false if there is no kernel for the
+ * types, in which case the caller runs its own loop
+ */
+
+template <class LHS, class RHS>
+inline typename std::enable_if<!(std::is_same<LHS, RHS>::value && IsKernelType<LHS>::value),
+                               bool>::type
+compareColumns(ColumnComparison op,
+               std::vector<LHS>& lhs,
+               std::vector<RHS>& rhs,
+               std::vector<bool>& out) {
+    return false;
+}
+
+template <class LHS, class RHS>
+inline typename std::enable_if<std::is_same<LHS, RHS>::value && IsKernelType<LHS>::value,
+                               bool>::type
+compareColumns(ColumnComparison op,
+               std::vector<LHS>& lhs,
+               std::vector<RHS>& rhs,
+               std::vector<bool>& out) {
+    size_t numRows = lhs.size();
+    out.resize(numRows);
+    if (numRows == 0) {
+        return true;
+    }
+    uint64_t* words = getMaskWords(out);
+    if (words != nullptr) {
+        compareArrays(op, lhs.data(), rhs.data(), numRows, words);
+    } else {
+        std::vector<uint64_t> scratch(getNumMaskWords(numRows));
+        compareArrays(op, lhs.data(), rhs.data(), numRows, scratch.data());
+        storeMaskWords(scratch, out);
+    }
+    return true;
+}
+
+template <class LHS, class RHS>
+inline typename std::enable_if<!(std::is_same<LHS, bool>::value && std::is_same<RHS, bool>::value),
+                               bool>::type
+combineColumns(std::vector<LHS>& lhs, std::vector<RHS>& rhs, std::vector<bool>& out, bool isAnd) {
+    return false;
+}
+
+template <class LHS, class RHS>
+inline typename std::enable_if<std::is_same<LHS, bool>::value && std::is_same<RHS, bool>::value,
+                               bool>::type
+combineColumns(std::vector<LHS>& lhs, std::vector<RHS>& rhs, std::vector<bool>& out, bool isAnd) {
+    size_t numRows = lhs.size();
+    out.resize(numRows);
+    if (numRows == 0) {
+        return true;
+    }
+    uint64_t* lhsWords = getMaskWords(lhs);
+    uint64_t* rhsWords = getMaskWords(rhs);
+    uint64_t* outWords = getMaskWords(out);
+    if (lhsWords != nullptr && rhsWords != nullptr && outWords != nullptr) {
+        combineMasks(lhsWords, rhsWords, getNumMaskWords(numRows), outWords, isAnd);
+    } else {
+        std::vector<uint64_t> lhsScratch, rhsScratch;
+        loadMaskWords(lhs, lhsScratch);
+        loadMaskWords(rhs, rhsScratch);
+        combineMasks(lhsScratch.data(),
+                     rhsScratch.data(),
+                     lhsScratch.size(),
+                     lhsScratch.data(),
+                     isAnd);
+        storeMaskWords(lhsScratch, out);
+    }
+    return true;
+}
+
+template <class LHS, class RHS>
+inline bool andColumns(std::vector<LHS>& lhs, std::vector<RHS>& rhs, std::vector<bool>& out) {
+    return combineColumns(lhs, rhs, out, true);
+}
+
+template <class LHS, class RHS>
+inline bool orColumns(std::vector<LHS>& lhs, std::vector<RHS>& rhs, std::vector<bool>& out) {
+    return combineColumns(lhs, rhs, out, false);
+}
+
+// only ints and longs have a hash we can compute in SIMD registers, for doubles std::hash hashes
+// the bytes with murmur, which we leave to the scalar loop
+template <class T>
+struct IsHashKernelType {
+    static const bool value = std::is_same<T, int32_t>::value || std::is_same<T, int64_t>::value;
+};
+
+template <class T>
+inline typename std::enable_if<!IsHashKernelType<T>::value, bool>::type hashColumn(
+    std::vector<T>& in, std::vector<size_t>& out) {
+    return false;
+}
+
+template <class T>
+inline typename std::enable_if<IsHashKernelType<T>::value, bool>::type hashColumn(
+    std::vector<T>& in, std::vector<size_t>& out) {
+    out.resize(in.size());
+    hashArray(in.data(), in.size(), out.data());
+    return true;
+}
+}
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "Object.h"
 #include "TupleSet.h"
+#include "ShuffleSkew.h"
 
 namespace pdb {
 
@@ -39,6 +40,10 @@ public:
     // this writes the tuple set into the output container
     virtual void writeOut(TupleSetPtr writeMe, Handle<Object>& writeToMe) = 0;
 
+    // for the sinks that shuffle tuples by the hash of their keys: they count the tuples they send
+    // to every partition there, and the join sinks split or replicate the heavy keys
+    virtual void setShuffleSkew(ShuffleSkewPtr skew) {}
+
     virtual ~ComputeSink() {}
 };
 }
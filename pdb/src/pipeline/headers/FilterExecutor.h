@@ -72,11 +72,8 @@ public:
         // get the input column to use as a filter
         std::vector<bool>& inputColumn = input->getColumn<bool>(whichAtt);
 
-        // loop over the columns and filter
-        int numColumns = output->getNumColumns();
-        for (int i = 0; i < numColumns; i++) {
-            output->filterColumn(i, inputColumn);
-        }
+        // narrow the selection, the columns are only compacted when somebody needs them
+        output->narrowSelection(inputColumn);
 
         return output;
     }
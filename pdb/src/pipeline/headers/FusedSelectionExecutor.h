@@ -0,0 +1,114 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef FUSED_SELECTION_EXEC_H
+#define FUSED_SELECTION_EXEC_H
+
+#include "ComputeExecutor.h"
+#include "TupleSetMachine.h"
+#include "TupleSet.h"
+#include <functional>
+#include <vector>
+
+namespace pdb {
+
+// runs all of the APPLY and FILTER stages of a selection as one loop over the input objects: the
+// fused selection lambda decides if an object is kept and the fused projection lambda computes
+// its output, so none of the intermediate columns (attributes, comparisons, the boolean mask) are
+// materialized
+template <class InputClass, class OutputType>
+class FusedSelectionExecutor : public ComputeExecutor {
+
+private:
+    // this is the output TupleSet that we return
+    TupleSetPtr output;
+
+    // to setup the output tuple set
+    TupleSetSetupMachine myMachine;
+
+    // the attribute holding the input objects
+    int whichAtt;
+
+    // the attribute we write the projection to
+    int outAtt;
+
+    // the fused lambdas
+    std::function<bool(Handle<Object>&)> selection;
+    std::function<OutputType(Handle<Object>&)> projection;
+
+public:
+    FusedSelectionExecutor(TupleSpec& inputSchema,
+                           TupleSpec& attsToOperateOn,
+                           TupleSpec& attsToIncludeInOutput,
+                           std::function<bool(Handle<Object>&)> selection,
+                           std::function<OutputType(Handle<Object>&)> projection)
+        : myMachine(inputSchema, attsToIncludeInOutput),
+          selection(selection),
+          projection(projection) {
+
+        output = std::make_shared<TupleSet>();
+        std::vector<int> matches = myMachine.match(attsToOperateOn);
+        whichAtt = matches[0];
+        outAtt = attsToIncludeInOutput.getAtts().size();
+    }
+
+    TupleSetPtr process(TupleSetPtr input) override {
+
+        // set up the output tuple set
+        myMachine.setup(input, output);
+
+        // get the input objects
+        std::vector<Handle<InputClass>>& inputColumn =
+            input->getColumn<Handle<InputClass>>(whichAtt);
+
+        // create the output attribute, if needed
+        if (!output->hasColumn(outAtt)) {
+            output->addColumn(outAtt, new std::vector<OutputType>, true);
+        }
+        std::vector<OutputType>& outColumn = output->getColumn<OutputType>(outAtt);
+        outColumn.clear();
+
+        // the rows that pass the selection
+        TupleSelectionPtr newSelection = std::make_shared<TupleSelection>();
+        newSelection->parent = output->getSelection();
+
+        // the loop that replaces the pipeline stages
+        size_t numTuples = inputColumn.size();
+        for (size_t i = 0; i < numTuples; i++) {
+            Handle<Object>& in = reinterpret_cast<Handle<Object>&>(inputColumn[i]);
+            if (selection(in)) {
+                newSelection->rows.push_back(i);
+                outColumn.push_back(projection(in));
+            }
+        }
+
+        // the output column only has the selected rows, the columns we carry over are compacted
+        // when somebody needs them
+        if (newSelection->rows.size() != numTuples) {
+            output->setSelection(newSelection);
+        }
+        return output;
+    }
+
+    std::string getType() override {
+        return "FUSED_SELECTION";
+    }
+};
+}
+
+#endif
@@ -69,27 +69,24 @@ public:
         size_t length = keyColumn.size();
         for (size_t i = 0; i < length; i++) {
 
-            // if this key is not already there...
-            if (myMap.count(keyColumn[i]) == 0) {
-
-                // this point will record where the value is located
-                ValueType* temp = nullptr;
-
-                // try to add the key... this will cause an allocation for a new key/val pair
-                try {
-                    // get the location that we need to write to...
-                    temp = &(myMap[keyColumn[i]]);
-
-                    // if we get an exception, then we could not fit a new key/value pair
-                } catch (NotEnoughSpace& n) {
+            // find the key, or add it... this may cause an allocation for a new key/val pair
+            bool inserted;
+            ValueType* temp = nullptr;
+            try {
+                temp = &(myMap.findOrInsert(keyColumn[i], inserted));
+
+                // if we get an exception, then we could not fit a new key/value pair
+            } catch (NotEnoughSpace& n) {
+
+                // if we got here, then we ran out of space, and so we need to delete the
+                // already-processed data so that we can try again...
+                keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
+                valueColumn.erase(valueColumn.begin(), valueColumn.begin() + i);
+                throw n;
+            }
 
-                    // if we got here, then we ran out of space, and so we need to delete the
-                    // already-processed
-                    // data so that we can try again...
-                    keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
-                    valueColumn.erase(valueColumn.begin(), valueColumn.begin() + i);
-                    throw n;
-                }
+            // if this key was not already there...
+            if (inserted) {
 
                 // we were able to fit a new key/value pair, so copy over the value
                 try {
@@ -110,20 +107,19 @@ public:
                 // the key is there
             } else {
 
-                // get the value and a copy of it
-                ValueType& temp = myMap[keyColumn[i]];
-                ValueType copy = temp;
+                // get a copy of the value
+                ValueType copy = *temp;
 
                 // and add to the old value, producing a new one
                 try {
-                    temp = copy + valueColumn[i];
+                    *temp = copy + valueColumn[i];
 
-                    // if we got here, then it means that we ram out of RAM when we were trying
+                    // if we got here, then it means that we ran out of RAM when we were trying
                     // to put the new value into the hash table
                 } catch (NotEnoughSpace& n) {
 
                     // restore the old value
-                    temp = copy;
+                    *temp = copy;
 
                     // and erase all of the guys who were processed
                     keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
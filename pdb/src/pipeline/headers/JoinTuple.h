@@ -25,6 +25,9 @@
 #include "JoinTupleBase.h"
 #include "PDBPage.h"
 #include "RecordIterator.h"
+#include "UseTemporaryAllocationBlock.h"
+#include "HeavyHitterSketch.h"
+#include "ShuffleSkew.h"
 
 namespace pdb {
 
@@ -389,9 +392,110 @@ public:
 template <typename RHSType>
 class JoinSinkMerger : public SinkMerger {
 
+private:
+    // the maps of the partition being merged by writePartitionOut and fillSpillPage, and where we
+    // are in them
+    Handle<Vector<Handle<JoinMap<RHSType>>>> partitionMaps;
+    int partitionId = -1;
+    size_t posInVector = 0;
+    bool isInMap = false;
+    JoinMapIterator<RHSType> partitionIter;
+    JoinMapIterator<RHSType> partitionEnd;
+    JoinRecordList<RHSType>* partitionList = nullptr;
+    size_t posInList = 0;
+
+    // the partition id and number of partitions of the map being merged, for the spilled maps
+    size_t mapPartitionId = 0;
+    int mapNumPartitions = 1;
+
+    // the filter the hashes of the keys we merge go to, if any
+    BlockedBloomFilterPtr runtimeFilter = nullptr;
+
+    // set when a value does not fit in an empty map, then nothing more is merged or spilled
+    bool failed = false;
+
+    // returns the next value of the partition to merge, or nullptr if there is none left
+    RHSType* getPartitionValue() {
+        while ((partitionList == nullptr) || (posInList == partitionList->size())) {
+            if (partitionList != nullptr) {
+                delete (partitionList);
+                partitionList = nullptr;
+                ++partitionIter;
+            }
+            if (isInMap && (partitionIter != partitionEnd)) {
+                partitionList = *partitionIter;
+                posInList = 0;
+                if ((runtimeFilter != nullptr) && (partitionList->size() > 0)) {
+                    runtimeFilter->insert(partitionList->getHash());
+                }
+                continue;
+            }
+            // this map is done, go to the next map of the partition
+            isInMap = false;
+            if (partitionMaps == nullptr) {
+                return nullptr;
+            }
+            while (posInVector < partitionMaps->size()) {
+                Handle<JoinMap<RHSType>> curMap = (*partitionMaps)[posInVector];
+                posInVector++;
+                if ((curMap != nullptr) &&
+                    (curMap->getPartitionId() % curMap->getNumPartitions() ==
+                     (size_t)partitionId)) {
+                    partitionIter = curMap->begin();
+                    partitionEnd = curMap->end();
+                    mapPartitionId = curMap->getPartitionId();
+                    mapNumPartitions = curMap->getNumPartitions();
+                    isInMap = true;
+                    break;
+                }
+            }
+            if (isInMap == false) {
+                partitionMaps = nullptr;
+                return nullptr;
+            }
+        }
+        return &((*partitionList)[posInList]);
+    }
+
+    // merges what is left of the partition into a map, returns false if the map is full, or if a
+    // value does not fit even in the empty map, then the merger has failed
+    bool mergePartitionInto(JoinMap<RHSType>& myMap) {
+        if (failed) {
+            return false;
+        }
+        RHSType* value;
+        while ((value = getPartitionValue()) != nullptr) {
+            size_t myHash = partitionList->getHash();
+
+            // the size of the map stays the same when a value that did not fit is taken out
+            bool isEmpty = (myMap.size() == 0);
+            try {
+                RHSType* temp = &(myMap.push(myHash));
+                try {
+                    packData(*temp, *value);
+                } catch (NotEnoughSpace& n) {
+                    myMap.setUnused(myHash);
+                    throw n;
+                }
+            } catch (NotEnoughSpace& n) {
+                if (isEmpty) {
+                    std::cout << "ERROR: a join value does not fit in an empty map, the join fails"
+                              << std::endl;
+                    failed = true;
+                }
+                return false;
+            }
+            posInList++;
+        }
+        return true;
+    }
 
 public:
-    ~JoinSinkMerger() {}
+    ~JoinSinkMerger() {
+        if (partitionList != nullptr) {
+            delete (partitionList);
+        }
+    }
 
     JoinSinkMerger() {}
 
@@ -416,6 +520,9 @@ public:
             size_t mySize = myList->size();
             size_t myHash = myList->getHash();
             if (mySize > 0) {
+                if (runtimeFilter != nullptr) {
+                    runtimeFilter->insert(myHash);
+                }
                 for (size_t i = 0; i < mySize; i++) {
                     try {
                         RHSType* temp = &(myMap.push(myHash));
@@ -449,6 +556,9 @@ public:
                 size_t mySize = myList->size();
                 size_t myHash = myList->getHash();
                 if (mySize > 0) {
+                    if (runtimeFilter != nullptr) {
+                        runtimeFilter->insert(myHash);
+                    }
                     for (size_t j = 0; j < mySize; j++) {
                         try {
                             RHSType* temp = &(myMap.push(myHash));
@@ -466,6 +576,69 @@ public:
             }
         }
     }
+
+    void setRuntimeFilter(BlockedBloomFilterPtr filter) override {
+        runtimeFilter = filter;
+    }
+
+    bool canSpill() override {
+        return true;
+    }
+
+    void startPartition(Handle<Object> mergeMe, int partitionId) override {
+        if (partitionList != nullptr) {
+            delete (partitionList);
+            partitionList = nullptr;
+        }
+        this->partitionMaps = unsafeCast<Vector<Handle<JoinMap<RHSType>>>>(mergeMe);
+        this->partitionId = partitionId;
+        posInVector = 0;
+        isInMap = false;
+        posInList = 0;
+    }
+
+    bool writePartitionOut(Handle<Object>& mergeToMe) override {
+        Handle<JoinMap<RHSType>> mergedMap = unsafeCast<JoinMap<RHSType>>(mergeToMe);
+        return mergePartitionInto(*mergedMap);
+    }
+
+    bool fillSpillPage(void* pageToWriteTo, size_t numBytesInPage) override {
+        if (failed || (getPartitionValue() == nullptr)) {
+            return false;
+        }
+
+        // the output container is not the allocation block while we write, so nothing in it is
+        // changed
+        UseTemporaryAllocationBlockPtr spillBlock =
+            std::make_shared<UseTemporaryAllocationBlock>(pageToWriteTo, numBytesInPage);
+        Handle<Vector<Handle<JoinMap<RHSType>>>> spillMaps = nullptr;
+        Handle<JoinMap<RHSType>> spillMap = nullptr;
+        try {
+            spillMaps = makeObject<Vector<Handle<JoinMap<RHSType>>>>(1);
+            spillMap = makeObject<JoinMap<RHSType>>(2, mapPartitionId, mapNumPartitions);
+            spillMaps->push_back(spillMap);
+        } catch (NotEnoughSpace& n) {
+            std::cout << "ERROR: a spill page of " << numBytesInPage << " bytes is too small, "
+                      << "the join fails" << std::endl;
+            failed = true;
+            spillBlock = nullptr;
+            return false;
+        }
+        mergePartitionInto(*spillMap);
+        if (failed) {
+            spillBlock = nullptr;
+            return false;
+        }
+        getRecord(spillMaps);
+
+        // let go of the page before the handles to it, so that they do not free what is on it
+        spillBlock = nullptr;
+        return true;
+    }
+
+    bool hasFailed() override {
+        return failed;
+    }
 };
 
 
@@ -889,6 +1062,87 @@ private:
     // this is the list of columns that we are processing
     void** columns = nullptr;
 
+    // the skew of the stage, nullptr if it is not kept
+    ShuffleSkewPtr skew = nullptr;
+
+    // the tuples we sent to every partition since we last added them to the skew
+    std::vector<uint64_t> numTuples;
+
+    // on the build side, the keys of the sampled tuples, and the keys we split: a split key goes
+    // to the next of its fanout partitions every time
+    struct SplitKey {
+        int fanout = 1;
+        int next = 0;
+    };
+    HeavyHitterSketch sketch;
+    std::unordered_map<size_t, SplitKey> splitKeys;
+    size_t numSeen = 0;
+
+    // on the other side, the copies of the first tuple that are in the last container already,
+    // if it was full before the tuple was copied to all of the partitions of its key
+    int numCopiesDone = 0;
+
+    // the partition a tuple of the build side goes to
+    size_t getBuildPartition(size_t hash, size_t home) {
+        if (numSeen++ % SHUFFLE_SKEW_SAMPLE_RATE == 0) {
+            size_t count = sketch.add(hash);
+            if (sketch.getNumAdded() >= SHUFFLE_SKEW_MIN_SAMPLES) {
+                int fanout = ShuffleSkew::getFanout(
+                    count, sketch.getNumAdded(), numPartitionsPerNode * numNodes);
+                if (fanout > 1) {
+                    SplitKey& key = splitKeys[hash];
+                    if (fanout > key.fanout) {
+                        key.fanout = fanout;
+                        skew->addSplitKey(hash, fanout);
+                    }
+                }
+            }
+        }
+        if (splitKeys.empty()) {
+            return home;
+        }
+        auto it = splitKeys.find(hash);
+        if (it == splitKeys.end()) {
+            return home;
+        }
+        int copy = it->second.next;
+        it->second.next = (copy + 1) % it->second.fanout;
+        return ShuffleSkew::getPartition(hash, copy, numPartitionsPerNode, numNodes);
+    }
+
+    // adds the i^th tuple to a map, if it does not fit the map is left as it was and NotEnoughSpace
+    // is thrown
+    void addToMap(JoinMap<RHSType>& myMap, size_t hash, size_t i) {
+        // try to add the key... this will cause an allocation for a new key/val pair
+        if (myMap.count(hash) == 0) {
+            try {
+                RHSType& temp = myMap.push(hash);
+                pack(temp, i, 0, columns);
+
+                // if we get an exception, then we could not fit a new key/value pair
+            } catch (NotEnoughSpace& n) {
+                myMap.setUnused(hash);
+                throw n;
+            }
+
+            // the key is there
+        } else {
+            // and add the value, an exception means that we couldn't complete the addition
+            RHSType* temp = &(myMap.push(hash));
+
+            // now try to do the copy
+            try {
+
+                pack(*temp, i, 0, columns);
+
+                // if the copy didn't work, pop the value off
+            } catch (NotEnoughSpace& n) {
+                myMap.setUnused(hash);
+                throw n;
+            }
+        }
+    }
+
 public:
     ~PartitionedJoinSink() {
         if (columns != nullptr)
@@ -901,7 +1155,7 @@ public:
                         TupleSpec& attsToOperateOn,
                         TupleSpec& additionalAtts,
                         std::vector<int>& whereEveryoneGoes)
-        : whereEveryoneGoes(whereEveryoneGoes) {
+        : whereEveryoneGoes(whereEveryoneGoes), sketch(SHUFFLE_SKEW_NUM_COUNTERS) {
 
         this->numPartitionsPerNode = numPartitionsPerNode;
 
@@ -918,6 +1172,11 @@ public:
         useTheseAtts = myMachine.match(additionalAtts);
     }
 
+    void setShuffleSkew(ShuffleSkewPtr skew) override {
+        this->skew = skew;
+        this->numTuples.assign(numPartitionsPerNode * numNodes, 0);
+    }
+
     Handle<Object> createNewOutputContainer() override {
         // we create a vector of maps to store the output
         Handle<Vector<Handle<Vector<Handle<JoinMap<RHSType>>>>>> returnVal =
@@ -956,6 +1215,17 @@ public:
         // this is where the hash attribute is located
         std::vector<size_t>& keyColumn = input->getColumn<size_t>(keyAtt);
 
+        // the build side splits its heavy keys, the other side copies their tuples to all of the
+        // partitions they are split over
+        bool isSplitting = false;
+        bool isReplicating = false;
+#ifndef NO_MOD_PARTITION
+        if (skew != nullptr) {
+            isSplitting = skew->isSplitting();
+            isReplicating = !isSplitting && skew->hasSplitKeys();
+        }
+#endif
+
         size_t length = keyColumn.size();
         for (size_t i = 0; i < length; i++) {
 #ifndef NO_MOD_PARTITION
@@ -964,58 +1234,45 @@ public:
             size_t index = (keyColumn[i] / (this->numPartitionsPerNode * this->numNodes)) %
                 (this->numPartitionsPerNode * this->numNodes);
 #endif
-            size_t nodeIndex = index / this->numPartitionsPerNode;
-            size_t partitionIndex = index % this->numPartitionsPerNode;
-            JoinMap<RHSType>& myMap = *((*((*writeMe)[nodeIndex]))[partitionIndex]);
-            // try to add the key... this will cause an allocation for a new key/val pair
-            if (myMap.count(keyColumn[i]) == 0) {
+            int firstCopy = 0;
+            int numCopies = 1;
+            if (isSplitting) {
+                index = getBuildPartition(keyColumn[i], index);
+            } else if (isReplicating) {
+                numCopies = skew->getFanout(keyColumn[i]);
+                if (i == 0) {
+                    firstCopy = numCopiesDone;
+                }
+            }
+            for (int copy = firstCopy; copy < numCopies; copy++) {
+                if (copy > 0) {
+                    index = ShuffleSkew::getPartition(
+                        keyColumn[i], copy, this->numPartitionsPerNode, this->numNodes);
+                }
+                size_t nodeIndex = index / this->numPartitionsPerNode;
+                size_t partitionIndex = index % this->numPartitionsPerNode;
+                JoinMap<RHSType>& myMap = *((*((*writeMe)[nodeIndex]))[partitionIndex]);
                 try {
-                    RHSType& temp = myMap.push(keyColumn[i]);
-                    pack(temp, i, 0, columns);
-
-                    // if we get an exception, then we could not fit a new key/value pair
+                    addToMap(myMap, keyColumn[i], i);
                 } catch (NotEnoughSpace& n) {
                     std::cout << "we are running out of space in writing join sink" << std::endl;
                     // if we got here, then we ran out of space, and so we need to delete the
                     // already-processed
                     // data so that we can try again...
-                    myMap.setUnused(keyColumn[i]);
+                    numCopiesDone = copy;
                     truncate<RHSType>(i, 0, columns);
                     keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
                     throw n;
                 }
-
-                // the key is there
-            } else {
-                // and add the value
-                RHSType* temp;
-                try {
-
-                    temp = &(myMap.push(keyColumn[i]));
-
-                    // an exception means that we couldn't complete the addition
-                } catch (NotEnoughSpace& n) {
-
-                    std::cout << "we are running out of space in writing join sink" << std::endl;
-                    truncate<RHSType>(i, 0, columns);
-                    keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
-                    throw n;
-                }
-
-                // now try to do the copy
-                try {
-
-                    pack(*temp, i, 0, columns);
-
-                    // if the copy didn't work, pop the value off
-                } catch (NotEnoughSpace& n) {
-                    std::cout << "we are running out of space in writing join sink" << std::endl;
-                    myMap.setUnused(keyColumn[i]);
-                    truncate<RHSType>(i, 0, columns);
-                    keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
-                    throw n;
+                if (skew != nullptr) {
+                    numTuples[index]++;
                 }
             }
+            numCopiesDone = 0;
+        }
+
+        if (skew != nullptr) {
+            skew->addNumTuples(numTuples);
         }
     }
 };
@@ -0,0 +1,141 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef MORSEL_TUPLESET_ITER_H
+#define MORSEL_TUPLESET_ITER_H
+
+#include "Ptr.h"
+#include "ComputeSource.h"
+#include "TupleSet.h"
+#include "PDBVector.h"
+#include "Record.h"
+#include <functional>
+
+namespace pdb {
+
+// a range of the objects stored in the vector on a page... this is the unit of work that is handed
+// out to the threads running a pipeline, so that one big or slow page can be shared by all of them
+struct Morsel {
+
+    // the page holding the vector, a Record <Vector <Handle <Object>>>
+    void* page = nullptr;
+
+    // the objects in the morsel are [begin, end)
+    size_t begin = 0;
+    size_t end = 0;
+
+    // used by whoever handed out the morsel to find out when all of the morsels of a page are done
+    void* owner = nullptr;
+};
+
+// this class iterates over the morsels it is given, breaking each of them up into a series of
+// TupleSet objects, just like VectorTupleSetIterator does for whole pages
+class MorselTupleSetIterator : public ComputeSource {
+
+private:
+    // function to call to get another morsel to process, returns false if there is none left
+    std::function<bool(Morsel&)> getAnotherMorsel;
+
+    // function to call when all of the tuples of a morsel have gone through the pipeline
+    std::function<void(Morsel&)> doneWithMorsel;
+
+    // the morsel we are processing, if any
+    Morsel myMorsel;
+    bool haveMorsel;
+
+    // this is the vector the morsel is in
+    Handle<Vector<Handle<Object>>> iterateOverMe;
+
+    // how many objects to put into a chunk
+    size_t chunkSize;
+
+    // where we are in the morsel
+    size_t pos;
+
+    // and the tuple set we return
+    TupleSetPtr output;
+
+public:
+    MorselTupleSetIterator(std::function<bool(Morsel&)> getAnotherMorsel,
+                           std::function<void(Morsel&)> doneWithMorsel,
+                           size_t chunkSize)
+        : getAnotherMorsel(getAnotherMorsel), doneWithMorsel(doneWithMorsel), chunkSize(chunkSize) {
+
+        // create the tuple set that we'll return during iteration
+        output = std::make_shared<TupleSet>();
+        std::vector<Handle<Object>>* inputColumn = new std::vector<Handle<Object>>;
+        output->addColumn(0, inputColumn, true);
+
+        haveMorsel = false;
+        pos = 0;
+    }
+
+    void setChunkSize(size_t chunkSize) override {
+        this->chunkSize = chunkSize;
+    }
+
+    // returns the next tuple set to process, or nullptr if there is not one to process
+    TupleSetPtr getNextTupleSet() override {
+
+        // if we are at the end of the morsel, then all of the tuples that we returned from it
+        // have been flushed through the pipeline, so we can give it back and get another one
+        while ((haveMorsel == false) || (pos == myMorsel.end)) {
+            if (haveMorsel) {
+                iterateOverMe = nullptr;
+                haveMorsel = false;
+                doneWithMorsel(myMorsel);
+            }
+            if (getAnotherMorsel(myMorsel) == false) {
+                return nullptr;
+            }
+            haveMorsel = true;
+            iterateOverMe = ((Record<Vector<Handle<Object>>>*)myMorsel.page)->getRootObject();
+            pos = myMorsel.begin;
+        }
+
+        // compute how many slots in the output vector we can fill
+        size_t numSlotsToIterate = chunkSize;
+        if (numSlotsToIterate + pos > myMorsel.end) {
+            numSlotsToIterate = myMorsel.end - pos;
+        }
+
+        // fill it up
+        Vector<Handle<Object>>& myVec = *iterateOverMe;
+        std::vector<Handle<Object>>& inputColumn = output->getColumn<Handle<Object>>(0);
+        inputColumn.resize(numSlotsToIterate);
+        for (size_t i = 0; i < numSlotsToIterate; i++) {
+            inputColumn[i] = myVec[pos];
+            pos++;
+        }
+
+        return output;
+    }
+
+    ~MorselTupleSetIterator() {
+
+        // if the pipeline stopped in the middle of a morsel, we still have to give it back
+        if (haveMorsel) {
+            iterateOverMe = nullptr;
+            makeObjectAllocatorBlock(4096, true);
+            doneWithMorsel(myMorsel);
+        }
+    }
+};
+}
+
+#endif
@@ -0,0 +1,127 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef RUNTIME_FILTER_EXECUTOR_H
+#define RUNTIME_FILTER_EXECUTOR_H
+
+#include "BlockedBloomFilter.h"
+#include "ComputeExecutor.h"
+#include "ComputeInfo.h"
+#include "TupleSetMachine.h"
+#include "TupleSet.h"
+#include <string>
+#include <vector>
+
+// the executor looks at this many tuples before it decides whether the filter is worth it
+#ifndef JOIN_RUNTIME_FILTER_CHECK_ROWS
+#define JOIN_RUNTIME_FILTER_CHECK_ROWS (64 * 1024)
+#endif
+
+// if the filter drops less than this fraction of the tuples it has looked at, it is turned off
+#ifndef JOIN_RUNTIME_FILTER_MIN_DROPPED
+#define JOIN_RUNTIME_FILTER_MIN_DROPPED 0.05
+#endif
+
+namespace pdb {
+
+// the runtime filters of the hash table a join probes, sent into the pipeline that hashes the
+// probe side; the parameter is found by the name of the tuple set of the hashes
+class RuntimeFilterArg : public ComputeInfo {
+
+public:
+    // a tuple whose hash is h goes to filters[h % filters.size()], which may be nullptr if that
+    // partition has no filter
+    std::vector<BlockedBloomFilterPtr> filters;
+
+    explicit RuntimeFilterArg(std::vector<BlockedBloomFilterPtr>& filters) : filters(filters) {}
+
+    ~RuntimeFilterArg() override = default;
+
+    // the name the parameter goes under, for the tuple set the hashes are in
+    static std::string getParamName(std::string hashTupleSetName) {
+        return "runtimeFilter:" + hashTupleSetName;
+    }
+};
+
+// drops the tuples whose hash, in the last column, is not in the runtime filter of its partition,
+// the columns are not copied, only the selection is narrowed
+class RuntimeFilterExecutor : public ComputeExecutor {
+
+private:
+    // this is the output TupleSet that we return
+    TupleSetPtr output;
+
+    // the column of the hash
+    int whichAtt;
+
+    // to setup the output tuple set, with all of the input columns
+    TupleSetSetupMachine myMachine;
+
+    std::vector<BlockedBloomFilterPtr> filters;
+
+    // the tuples looked at and dropped, to turn the filter off if it does not drop enough
+    size_t numChecked = 0;
+    size_t numDropped = 0;
+    bool isOn = true;
+
+public:
+    RuntimeFilterExecutor(TupleSpec& inputSchema, std::vector<BlockedBloomFilterPtr>& filters)
+        : myMachine(inputSchema, inputSchema), filters(filters) {
+        output = std::make_shared<TupleSet>();
+        whichAtt = inputSchema.getAtts().size() - 1;
+        if (this->filters.empty()) {
+            isOn = false;
+        }
+    }
+
+    TupleSetPtr process(TupleSetPtr input) override {
+
+        // set up the output tuple set
+        myMachine.setup(input, output);
+        if (!isOn) {
+            return output;
+        }
+
+        std::vector<size_t>& hashColumn = input->getColumn<size_t>(whichAtt);
+        size_t numTuples = hashColumn.size();
+        size_t numFilters = filters.size();
+        std::vector<bool> keepMe(numTuples);
+        for (size_t i = 0; i < numTuples; i++) {
+            BlockedBloomFilter* filter = filters[hashColumn[i] % numFilters].get();
+            bool keep = (filter == nullptr) || filter->mayContain(hashColumn[i]);
+            keepMe[i] = keep;
+            numDropped += !keep;
+        }
+        output->narrowSelection(keepMe);
+
+        // a join that most tuples pass is not worth the lookups
+        numChecked += numTuples;
+        if ((numChecked >= JOIN_RUNTIME_FILTER_CHECK_ROWS) &&
+            ((double)numDropped < (double)numChecked * JOIN_RUNTIME_FILTER_MIN_DROPPED)) {
+            isOn = false;
+        }
+        return output;
+    }
+
+    std::string getType() override {
+        return "RUNTIME_FILTER";
+    }
+};
+}
+
+#endif
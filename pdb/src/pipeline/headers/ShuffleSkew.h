@@ -0,0 +1,282 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef SHUFFLE_SKEW_H
+#define SHUFFLE_SKEW_H
+
+#include "ComputeInfo.h"
+#include "PDBVector.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// the join sink that shuffles the build side samples one in this many tuples to find heavy keys
+#ifndef SHUFFLE_SKEW_SAMPLE_RATE
+#define SHUFFLE_SKEW_SAMPLE_RATE 8
+#endif
+
+// the number of keys the sampled tuples are counted for
+#ifndef SHUFFLE_SKEW_NUM_COUNTERS
+#define SHUFFLE_SKEW_NUM_COUNTERS 64
+#endif
+
+// no key is split before a sink has sampled this many tuples
+#ifndef SHUFFLE_SKEW_MIN_SAMPLES
+#define SHUFFLE_SKEW_MIN_SAMPLES 1024
+#endif
+
+// a key is split once it has more than this fraction of the tuples a partition would get if they
+// were spread evenly, over enough partitions that every one gets less than that
+#ifndef SHUFFLE_SKEW_HEAVY_SHARE
+#define SHUFFLE_SKEW_HEAVY_SHARE 0.5
+#endif
+
+// the most partitions a key is split over
+#ifndef SHUFFLE_SKEW_MAX_FANOUT
+#define SHUFFLE_SKEW_MAX_FANOUT 16
+#endif
+
+namespace pdb {
+
+class ShuffleSkew;
+typedef std::shared_ptr<ShuffleSkew> ShuffleSkewPtr;
+
+/*
+ * This class keeps the skew of a stage that shuffles tuples by the hash of their keys, for the
+ * sinks of all of the threads on a node. The sinks count the tuples they send to every partition
+ * in the cluster, and it is reported to the scheduler once the stage is done.
+ *
+ * The sink that shuffles the build side of a hash partitioned join also looks for heavy keys.
+ * Once it sees one, it sends the tuples of the key to the fanout partitions of getPartition in
+ * turn, starting with the partition of the hash, and records the key here. The scheduler merges
+ * the keys of all of the nodes and sends them to the stage that shuffles the other side, whose
+ * sinks send the tuples of a split key to all of its partitions, so that every pair of tuples
+ * with the same key still meets once.
+ */
+class ShuffleSkew : public ComputeInfo {
+
+private:
+    // the partitions in the cluster, in node order
+    int numPartitions;
+    int numNodes;
+
+    // true if the sinks split the heavy keys
+    bool splitting;
+
+    // the tuples sent to every partition
+    std::vector<uint64_t> numTuples;
+
+    // the keys that are split, and the number of partitions they are split over
+    std::unordered_map<size_t, int> splitKeys;
+
+    pthread_mutex_t mutex;
+
+public:
+    ShuffleSkew(int numPartitions, int numNodes, bool splitting)
+        : numPartitions(numPartitions),
+          numNodes(numNodes),
+          splitting(splitting),
+          numTuples(numPartitions, 0) {
+        pthread_mutex_init(&mutex, nullptr);
+    }
+
+    ~ShuffleSkew() override {
+        pthread_mutex_destroy(&mutex);
+    }
+
+    // the name the parameter goes under
+    static std::string getParamName() {
+        return "shuffleSkew";
+    }
+
+    int getNumPartitions() {
+        return numPartitions;
+    }
+
+    int getNumNodes() {
+        return numNodes;
+    }
+
+    bool isSplitting() {
+        return splitting;
+    }
+
+    // the partition the copy-th share of the tuples whose hash is h goes to; the first one is the
+    // partition of the hash, the next ones are on the next nodes, then on the next partitions of
+    // those nodes, so that they are all different as long as copy < the partitions in the cluster
+    static size_t getPartition(size_t hash, int copy, int numPartitionsPerNode, int numNodes) {
+        size_t home = hash % ((size_t)numPartitionsPerNode * numNodes);
+        size_t node = (home / numPartitionsPerNode + copy) % numNodes;
+        size_t partition = (home % numPartitionsPerNode + copy / numNodes) % numPartitionsPerNode;
+        return node * numPartitionsPerNode + partition;
+    }
+
+    // the number of partitions a key that has count of numSampled tuples is split over, 1 if it is
+    // not heavy
+    static int getFanout(size_t count, size_t numSampled, int numPartitions) {
+        if (numSampled == 0) {
+            return 1;
+        }
+        double share = (double)count * numPartitions / numSampled;
+        double fanout = std::ceil(share / SHUFFLE_SKEW_HEAVY_SHARE);
+        double maxFanout = std::min(numPartitions, SHUFFLE_SKEW_MAX_FANOUT);
+        return (int)std::max(1.0, std::min(fanout, maxFanout));
+    }
+
+    // records that a sink splits the key whose hash is given over fanout partitions
+    void addSplitKey(size_t hash, int fanout) {
+        pthread_mutex_lock(&mutex);
+        int& current = splitKeys[hash];
+        current = std::max(current, fanout);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    // the number of partitions the key whose hash is given is split over, 1 if it is not; this is
+    // only called once the split keys are set, so it does not lock
+    int getFanout(size_t hash) {
+        auto it = splitKeys.find(hash);
+        if (it == splitKeys.end()) {
+            return 1;
+        }
+        return it->second;
+    }
+
+    bool hasSplitKeys() {
+        return !splitKeys.empty();
+    }
+
+    size_t getNumSplitKeys() {
+        pthread_mutex_lock(&mutex);
+        size_t numSplitKeys = splitKeys.size();
+        pthread_mutex_unlock(&mutex);
+        return numSplitKeys;
+    }
+
+    // sets the split keys from the scheduler, as pairs of hash and fanout
+    void setSplitKeys(Vector<uint64_t>& keys) {
+        pthread_mutex_lock(&mutex);
+        for (size_t i = 0; i + 1 < keys.size(); i += 2) {
+            int& current = splitKeys[keys[i]];
+            current = std::max(current, (int)keys[i + 1]);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+
+    // appends the split keys as pairs of hash and fanout
+    void appendSplitKeysTo(Vector<uint64_t>& keys) {
+        pthread_mutex_lock(&mutex);
+        for (auto& key : splitKeys) {
+            keys.push_back(key.first);
+            keys.push_back(key.second);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+
+    // adds the tuples a sink sent to every partition, and sets its counts back to 0
+    void addNumTuples(std::vector<uint64_t>& counts) {
+        pthread_mutex_lock(&mutex);
+        for (size_t i = 0; (i < counts.size()) && (i < numTuples.size()); i++) {
+            numTuples[i] += counts[i];
+            counts[i] = 0;
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+
+    // the report: the number of partitions, the tuples sent to every one, then the split keys
+    void appendTo(Vector<uint64_t>& report) {
+        pthread_mutex_lock(&mutex);
+        report.push_back(numPartitions);
+        for (uint64_t count : numTuples) {
+            report.push_back(count);
+        }
+        for (auto& key : splitKeys) {
+            report.push_back(key.first);
+            report.push_back(key.second);
+        }
+        pthread_mutex_unlock(&mutex);
+    }
+
+    // adds the report of a node, returns false if it is not for the same partitions
+    bool readFrom(Vector<uint64_t>& report) {
+        if ((report.size() < 1) || (report[0] != (uint64_t)numPartitions) ||
+            (report.size() < 1 + (size_t)numPartitions) ||
+            ((report.size() - 1 - numPartitions) % 2 != 0)) {
+            return false;
+        }
+        pthread_mutex_lock(&mutex);
+        for (int i = 0; i < numPartitions; i++) {
+            numTuples[i] += report[1 + i];
+        }
+        for (size_t i = 1 + numPartitions; i < report.size(); i += 2) {
+            int& current = splitKeys[report[i]];
+            current = std::max(current, (int)report[i + 1]);
+        }
+        pthread_mutex_unlock(&mutex);
+        return true;
+    }
+
+    // the number of partitions a report is for
+    static int getNumPartitionsOf(Vector<uint64_t>& report) {
+        return (report.size() < 1) ? 0 : (int)report[0];
+    }
+
+    // the tuples sent to the partition that got the most over the mean, 1 if they are even
+    double getImbalance() {
+        pthread_mutex_lock(&mutex);
+        uint64_t total = 0;
+        uint64_t most = 0;
+        for (uint64_t count : numTuples) {
+            total += count;
+            most = std::max(most, count);
+        }
+        pthread_mutex_unlock(&mutex);
+        if (total == 0) {
+            return 1.0;
+        }
+        return (double)most * numPartitions / total;
+    }
+
+    std::string toString() {
+        pthread_mutex_lock(&mutex);
+        uint64_t total = 0;
+        uint64_t most = 0;
+        int mostPartition = 0;
+        for (int i = 0; i < numPartitions; i++) {
+            total += numTuples[i];
+            if (numTuples[i] > most) {
+                most = numTuples[i];
+                mostPartition = i;
+            }
+        }
+        size_t numSplitKeys = splitKeys.size();
+        pthread_mutex_unlock(&mutex);
+        std::ostringstream out;
+        out << total << " tuples to " << numPartitions << " partitions, at most " << most
+            << " to partition " << mostPartition << " (" << getImbalance()
+            << " times the mean), " << numSplitKeys << " heavy keys split";
+        return out.str();
+    }
+};
+}
+
+#endif
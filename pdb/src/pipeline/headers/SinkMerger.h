@@ -23,6 +23,7 @@
 
 #include "Object.h"
 #include "TupleSet.h"
+#include "BlockedBloomFilter.h"
 
 
 namespace pdb {
@@ -45,6 +46,43 @@ public:
     // this writes the tuple set of multiple maps to the output container
     virtual void writeVectorOut(Handle<Object> mergeMe, Handle<Object>& mergeToMe) = 0;
 
+    // the next ones are for mergers that can spill what does not fit in the output container to
+    // disk, like the JoinSinkMerger of a hash partitioned join; they merge one partition at a time
+
+    // returns true if this can spill
+    virtual bool canSpill() {
+        return false;
+    }
+
+    // starts to merge the maps of a partition (out of the partitions on a node) in a vector of
+    // maps; the vector has to stay where it is until the partition is merged
+    virtual void startPartition(Handle<Object> mergeMe, int partitionId) {}
+
+    // merges what is left of the partition into the output container.  Returns false if the
+    // container is full and something is left, which can then go to another container or be
+    // spilled.  Something that does not fit even in an empty container is kept, and hasFailed
+    // returns true from then on
+    virtual bool writePartitionOut(Handle<Object>& mergeToMe) {
+        return true;
+    }
+
+    // writes as much as fits of what is left of the partition to a page, as a vector with one
+    // map, the way writeVectorOut and startPartition read it.  Returns false if nothing is left,
+    // then nothing is written; otherwise it is called again with another page until it does
+    virtual bool fillSpillPage(void* pageToWriteTo, size_t numBytesInPage) {
+        return false;
+    }
+
+    // returns true if something of a partition did not fit in an empty container or spill page;
+    // it is neither merged nor spilled, so whoever runs the merger has to fail, or rows are lost
+    virtual bool hasFailed() {
+        return false;
+    }
+
+    // for the mergers of join hash tables: the hash of every key merged from now on is inserted
+    // into the filter, nullptr stops it
+    virtual void setRuntimeFilter(BlockedBloomFilterPtr filter) {}
+
     virtual ~SinkMerger() {}
 };
 }
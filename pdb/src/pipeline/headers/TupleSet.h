@@ -21,6 +21,9 @@
 
 #include "Handle.h"
 #include "PDBVector.h"
+#include "ColumnKernels.h"
+#include <atomic>
+#include <cassert>
 #include <functional>
 
 namespace pdb {
@@ -66,56 +69,57 @@ typedef std::shared_ptr<TupleSet> TupleSetPtr;
 
 // this structure contains type-specific information that will allow us to properly delete and/or
 // fliter
-// a column
+// a column... these are plain function pointers, so calling them is as cheap as a virtual call
 struct MaintenanceFuncs {
 
     // this is a deleter for a particular column, stored as a void*
-    std::function<void(void*)> deleter;
+    void (*deleter)(void*) = nullptr;
 
     // this is a filter function for a particular column
-    std::function<void*(void*, std::vector<bool>&)> filter;
+    void* (*filter)(void*, std::vector<bool>&) = nullptr;
 
     // this replicates instances of a column to run a join
-    std::function<void*(void*, std::vector<uint32_t>&)> replicate;
+    void* (*replicate)(void*, std::vector<uint32_t>&) = nullptr;
+
+    // this copies the rows at the given positions of a column, in order
+    void* (*gather)(void*, std::vector<uint32_t>&) = nullptr;
 
     // JiaNote: this gets count for a particular column
-    std::function<size_t(void*)> getCount;
+    size_t (*getCount)(void*) = nullptr;
 
     // this is a function that creates and returns a pdb :: Vector for a column
-    std::function<Handle<Vector<Handle<Object>>>()> createPDBVector;
+    Handle<Vector<Handle<Object>>> (*createPDBVector)() = nullptr;
 
     // this function writes out the column to a pdb :: Vector
-    std::function<void(Handle<Vector<Handle<Object>>>&, void*, size_t&)> writeToVector;
+    void (*writeToVector)(Handle<Vector<Handle<Object>>>&, void*, size_t&) = nullptr;
 
     // this is the name of the type that we contain
     std::string typeContained;
 
     // tells us if we need to delete
-    bool mustDelete;
+    bool mustDelete = false;
 
     // tells us the serialized size of an object in this column
-    size_t serializedSize;
-
-    // the last value that we wrote if we are writing out this column
-    size_t lastWritten = 0;
+    size_t serializedSize = 0;
 
     // empty constructor
     MaintenanceFuncs() {}
 
     // fill all of the fields
-    MaintenanceFuncs(
-        std::function<void(void*)> deleter,
-        std::function<void*(void*, std::vector<bool>&)> filter,
-        std::function<void*(void*, std::vector<uint32_t>&)> replicate,
-        std::function<size_t(void*)> getCount,
-        std::function<Handle<Vector<Handle<Object>>>()> createPDBVector,
-        std::function<void(Handle<Vector<Handle<Object>>>&, void*, size_t&)> writeToVector,
-        bool mustDelete,
-        std::string typeContained,
-        size_t serializedSize)
+    MaintenanceFuncs(void (*deleter)(void*),
+                     void* (*filter)(void*, std::vector<bool>&),
+                     void* (*replicate)(void*, std::vector<uint32_t>&),
+                     void* (*gather)(void*, std::vector<uint32_t>&),
+                     size_t (*getCount)(void*),
+                     Handle<Vector<Handle<Object>>> (*createPDBVector)(),
+                     void (*writeToVector)(Handle<Vector<Handle<Object>>>&, void*, size_t&),
+                     bool mustDelete,
+                     std::string typeContained,
+                     size_t serializedSize)
         : deleter(deleter),
           filter(filter),
           replicate(replicate),
+          gather(gather),
           getCount(getCount),
           createPDBVector(createPDBVector),
           writeToVector(writeToVector),
@@ -124,20 +128,175 @@ struct MaintenanceFuncs {
           serializedSize(serializedSize) {}
 };
 
+// the rows of a TupleSet that survived a filter... the positions are in the rows of the parent
+// selection, or in the rows of the columns if there is no parent, so a filter that runs after
+// another one only has to look at the rows that are still selected
+struct TupleSelection {
+
+    // the positions of the selected rows, in increasing order
+    std::vector<uint32_t> rows;
+
+    // the selection this one narrows, nullptr if it selects from all of the rows
+    std::shared_ptr<TupleSelection> parent;
+};
+
+typedef std::shared_ptr<TupleSelection> TupleSelectionPtr;
+
+// a column, with the selection its rows correspond to... a column is shared by all of the
+// TupleSets it is copied to, so that compacting it once is enough for all of them
+struct TupleSetColumn {
+
+    // the column, a std :: vector <ColType> *... the executors may keep a pointer to it, so it is
+    // never replaced when the column is compacted
+    void* data = nullptr;
+
+    // the functions to deal with the column
+    MaintenanceFuncs funcs;
+
+    // the batch the rows of the column come from, and the selection of that batch they are, nullptr
+    // if it is all of the rows
+    size_t batch = 0;
+    TupleSelectionPtr selection;
+
+    // the column compacted to the rows of a narrower selection, and that selection
+    void* compacted = nullptr;
+    TupleSelectionPtr compactedSelection;
+
+    void dropCompacted() {
+        if (compacted != nullptr)
+            funcs.deleter(compacted);
+        compacted = nullptr;
+        compactedSelection = nullptr;
+    }
+
+    ~TupleSetColumn() {
+        dropCompacted();
+        if (funcs.mustDelete)
+            funcs.deleter(data);
+    }
+};
+
+typedef std::shared_ptr<TupleSetColumn> TupleSetColumnPtr;
+
 // this is the basic type that it pushed through the system during query processing
+// a filter does not copy the columns, it narrows the selection of the TupleSet; the columns are
+// compacted to the selected rows the first time somebody asks for them, so a chain of filters only
+// copies the columns that are actually used
 class TupleSet {
 
 private:
-    // the key of this map is an integer (the identifier of the column)
-    // the value is a pair; the first is a pointer to the column, and the second is a pair of
-    // lambdas.  The first is a deleter (which frees the column) and the second is a condenser
-    // (that filters rows from the column)
-    std::map<int, std::pair<void*, MaintenanceFuncs>> columns;
+    // a slot of the column array
+    struct ColumnSlot {
+
+        // the column, nullptr if there is no column in this slot
+        TupleSetColumnPtr column;
+
+        // true if this TupleSet created the column, rather than copied it from another TupleSet
+        bool isOwned = false;
+
+        // the last value that we wrote if we are writing out this column
+        size_t lastWritten = 0;
+    };
+
+    // the columns, indexed by their identifier... the identifiers are small and dense, so a flat
+    // array beats a map
+    std::vector<ColumnSlot> columns;
+
+    // the batch the rows come from: a selection only makes sense for the columns of its batch, and
+    // the columns this set created are overwritten when a new batch comes in
+    size_t batch = getNextBatch();
+
+    // the selected rows, nullptr if all of the rows are selected
+    TupleSelectionPtr selection;
+
+    // the positions of the selected rows in the rows of positionsFrom, the columns that were
+    // created together share their selection, so we usually compute this once per selection
+    bool hasPositions = false;
+    TupleSelectionPtr positionsFrom;
+    std::vector<uint32_t> positions;
+
+    // a batch number no TupleSet has used yet
+    static size_t getNextBatch() {
+        static std::atomic<size_t> nextBatch(1);
+        return nextBatch.fetch_add(1);
+    }
+
+    // get the slot of a column, growing the array if needed
+    ColumnSlot& getSlot(int whichColumn) {
+        if (whichColumn >= (int)columns.size()) {
+            columns.resize(whichColumn + 1);
+        }
+        return columns[whichColumn];
+    }
+
+    // returns true if from is the selection of this set, or one of the selections it narrows
+    bool isAncestorSelection(TupleSelectionPtr& from) {
+        if (from == nullptr) {
+            return true;
+        }
+        for (TupleSelection* cur = selection.get(); cur != nullptr; cur = cur->parent.get()) {
+            if (cur == from.get()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // compute the positions of the selected rows in the rows of the selection from
+    std::vector<uint32_t>& getPositions(TupleSelectionPtr& from) {
+        if (hasPositions && positionsFrom == from) {
+            return positions;
+        }
+        positions = selection->rows;
+        for (TupleSelection* cur = selection->parent.get(); cur != from.get();
+             cur = cur->parent.get()) {
+            for (auto& position : positions) {
+                position = cur->rows[position];
+            }
+        }
+        hasPositions = true;
+        positionsFrom = from;
+        return positions;
+    }
+
+    // returns the column holding the selected rows, compacting it if needed
+    void* compactColumn(int whichColumn) {
+        TupleSetColumn& column = *columns[whichColumn].column;
+        if (column.batch == batch && column.selection == selection) {
+            return column.data;
+        }
+        if (column.batch == batch && column.compacted != nullptr &&
+            column.compactedSelection == selection) {
+            return column.compacted;
+        }
+
+        // the rows of the column can only be compacted to a selection of the same batch that
+        // narrows theirs, anything else is a column we did not take the rows of
+        if ((column.batch != batch) || !isAncestorSelection(column.selection)) {
+            std::cout << "This is bad. Column " << whichColumn << " holds the rows of batch "
+                      << column.batch << ", not those of batch " << batch
+                      << " that the tuple set selects from.\n";
+            assert(false);
+            return column.data;
+        }
+
+        // copy the selected rows, the column is shared, so everybody gets the compacted one
+        void* compacted = column.funcs.gather(column.data, getPositions(column.selection));
+        column.dropCompacted();
+        column.compacted = compacted;
+        column.compactedSelection = selection;
+        return compacted;
+    }
 
 public:
     // get the number of columns in this TupleSet
     int getNumColumns() {
-        return columns.size();
+        int numColumns = 0;
+        for (auto& slot : columns) {
+            if (slot.column != nullptr)
+                numColumns++;
+        }
+        return numColumns;
     }
 
     /* TODO: this will be needed to be able to do joins!!!
@@ -155,8 +314,8 @@ public:
     // this can be used at a later time to re-constitute the tuple set
     std::vector<std::string> getTypeNames() {
         std::vector<std::string> output;
-        for (int i = 0; columns.count(i) != 0; i++) {
-            output.push_back(columns[i].second.typeContained);
+        for (int i = 0; hasColumn(i); i++) {
+            output.push_back(columns[i].column->funcs.typeContained);
         }
         return output;
     }
@@ -174,14 +333,14 @@ public:
 
 
     // this takes as input a vector of pointers to
-    // return a specified column
+    // return a specified column, holding only the selected rows
     template <typename ColType>
     std::vector<ColType>& getColumn(int whichColumn) {
-        if (columns.count(whichColumn) == 0) {
+        if (!hasColumn(whichColumn)) {
             std::cout << "This is bad. Tried to get column " << whichColumn
                       << " but could not find it.\n";
         }
-        return *((std::vector<ColType>*)columns[whichColumn].first);
+        return *((std::vector<ColType>*)compactColumn(whichColumn));
     }
 
     // writes out a specified column... the boolean argument is true when we want to start from
@@ -190,40 +349,85 @@ public:
     void writeOutColumn(int whichColumn,
                         Handle<Vector<Handle<Object>>>& writeToMe,
                         bool startFromScratch) {
-        if (columns.count(whichColumn) == 0) {
+        if (!hasColumn(whichColumn)) {
             std::cout << "This is bad. Tried to write out column " << whichColumn
                       << " but could not find it.\n";
         }
         auto& which = columns[whichColumn];
+        void* data = compactColumn(whichColumn);
 
         // if we we need to start over, then do do
         if (startFromScratch)
-            which.second.lastWritten = 0;
+            which.lastWritten = 0;
 
-        which.second.writeToVector(writeToMe, which.first, which.second.lastWritten);
+        which.column->funcs.writeToVector(writeToMe, data, which.lastWritten);
     }
 
     // use the specified column to build pdb :: Vector of the correct type to hold the output
     // Note: this had better be a Vector <Handle <Something>> or we are going to have problems!!
     Handle<Vector<Handle<Object>>> getOutputVector(int whichColToOutput) {
-        return columns[whichColToOutput].second.createPDBVector();
+        return columns[whichColToOutput].column->funcs.createPDBVector();
     }
 
     // see if we have the specified column
     bool hasColumn(int whichColumn) {
-        return columns.count(whichColumn) != 0;
+        return whichColumn >= 0 && whichColumn < (int)columns.size() &&
+            columns[whichColumn].column != nullptr;
     }
 
-    ~TupleSet() {
+    // returns true if some rows have been filtered out, but not removed from the columns yet
+    bool hasSelection() {
+        return selection != nullptr;
+    }
 
-        // delete all of the columns
-        for (auto& a : columns) {
-            auto& res = a.second;
-            if (res.second.mustDelete)
-                res.second.deleter(res.first);
+    // returns the selected rows, nullptr if all of the rows are selected
+    TupleSelectionPtr getSelection() {
+        return selection;
+    }
+
+    // takes the batch and the selection of another tuple set, this is done before copying its
+    // columns... the columns we created ourselves are going to be overwritten, so their rows are
+    // the new ones
+    void copySelection(TupleSetPtr fromMe) {
+        batch = fromMe->batch;
+        setSelection(fromMe->selection);
+    }
+
+    // starts a new batch with all of its rows selected, the columns are going to be replaced by
+    // new ones
+    void clearSelection() {
+        batch = getNextBatch();
+        setSelection(nullptr);
+    }
+
+    // sets the selection of the rows of the current batch, the columns this set created take the
+    // new rows
+    void setSelection(TupleSelectionPtr newSelection) {
+        selection = newSelection;
+        hasPositions = false;
+        positionsFrom = nullptr;
+        for (auto& slot : columns) {
+            if (slot.column != nullptr && slot.isOwned) {
+                slot.column->dropCompacted();
+                slot.column->batch = batch;
+                slot.column->selection = selection;
+            }
         }
     }
 
+    // narrows the selection to the selected rows for which keepMe is true, no column is copied
+    void narrowSelection(std::vector<bool>& keepMe) {
+        TupleSelectionPtr newSelection = std::make_shared<TupleSelection>();
+        newSelection->parent = selection;
+        newSelection->rows.reserve(keepMe.size());
+        selectMaskedRows(keepMe, newSelection->rows);
+        selection = newSelection;
+        hasPositions = false;
+        positionsFrom = nullptr;
+    }
+
+    ~TupleSet() {}
+
     // filters a column
     void filterColumn(int whichColToFilter, std::vector<bool>& usingMe) {
 
@@ -232,18 +436,19 @@ public:
 
             // filter the column, getting a new version
             auto& value = columns[whichColToFilter];
-            auto res = value.second.filter(value.first, usingMe);
+            void* data = compactColumn(whichColToFilter);
+            TupleSetColumnPtr res = std::make_shared<TupleSetColumn>();
+            res->data = value.column->funcs.filter(data, usingMe);
+            res->funcs = value.column->funcs;
 
-            // delete the old one, if necessary
-            if (value.second.mustDelete) {
-                value.second.deleter(value.first);
-            }
+            // remember that we need to delete it
+            res->funcs.mustDelete = true;
+            res->batch = batch;
+            res->selection = selection;
 
             // record the new column
-            value.first = res;
-
-            // remember that we need to delete it
-            value.second.mustDelete = true;
+            value.column = res;
+            value.isOwned = true;
             return;
         }
 
@@ -257,27 +462,26 @@ public:
                    int whichColToCopyTo,
                    std::vector<uint32_t>& replications) {
 
-        // kill the old one so we don't have a memory leak
-        if (hasColumn(whichColToCopyTo)) {
-            // delete the existing column, if necessary
-            auto& value = columns[whichColToCopyTo];
-            if (value.second.mustDelete) {
-                value.second.deleter(value.first);
-            }
-        }
+        // the replications are given for the selected rows of the other tuple set
+        void* data = fromMe->compactColumn(whichColInFromMe);
 
         // create a copy of the maintenance funcs
-        auto& value = fromMe->columns[whichColInFromMe];
-        MaintenanceFuncs temp = value.second;
+        TupleSetColumnPtr temp = std::make_shared<TupleSetColumn>();
+        temp->funcs = fromMe->columns[whichColInFromMe].column->funcs;
 
         // remember that this is a deep copy... so we need to delete
-        temp.mustDelete = true;
+        temp->funcs.mustDelete = true;
 
         // and go ahead and replicate the column
-        void* newCol = temp.replicate(value.first, replications);
-
-        // and go ahead and remember the column
-        columns[whichColToCopyTo] = std::make_pair(newCol, temp);
+        temp->data = temp->funcs.replicate(data, replications);
+        temp->batch = batch;
+        temp->selection = selection;
+
+        // and go ahead and remember the column, the old one is deleted if nobody else uses it
+        ColumnSlot& slot = getSlot(whichColToCopyTo);
+        slot.column = temp;
+        slot.isOwned = true;
+        slot.lastWritten = 0;
     }
 
     // JiaNote: to get number of rows in a particular column
@@ -286,59 +490,40 @@ public:
         if (hasColumn(whichColumn) == false) {
             return -1;
         }
-        return columns[whichColumn].second.getCount(columns[whichColumn].first);
+        if (selection != nullptr) {
+            return selection->rows.size();
+        }
+        auto& column = *columns[whichColumn].column;
+        return column.funcs.getCount(column.data);
     }
 
 
     // copies a column from another TupleSet, deleting the target, if necessary
     void copyColumn(TupleSetPtr fromMe, int whichColInFromMe, int whichColToCopyTo) {
 
-        // kill the old one so we don't have a memory leak
-        if (hasColumn(whichColToCopyTo)) {
-
-            // delete the existing column, if necessary
-            auto& value = columns[whichColToCopyTo];
-            if (value.second.mustDelete) {
-                value.second.deleter(value.first);
-            }
-        }
-
-        // create a copy of the maintenance funcs
-        auto& value = fromMe->columns[whichColInFromMe];
-        MaintenanceFuncs temp = value.second;
-
-        // remember that this is a shallow copy... no need to delete
-        temp.mustDelete = false;
-
-        // and go ahead and remember the column
-        columns[whichColToCopyTo] = std::make_pair(value.first, temp);
+        // this is a shallow copy... the column is shared, and deleted by the last one to use it
+        ColumnSlot& slot = getSlot(whichColToCopyTo);
+        slot.column = fromMe->columns[whichColInFromMe].column;
+        slot.isOwned = false;
+        slot.lastWritten = 0;
     }
 
     // creates a new column, adding it to the tuple set
     template <typename ColType>
     void addColumn(int where, std::vector<ColType>* addMe, bool needToDelete) {
 
-        // delete the old one, if needed
-        if (columns.count(where) != 0) {
-            auto& value = columns[where];
-            if (value.second.mustDelete) {
-                value.second.deleter(value.first);
-            }
-        }
-
         // now, add the new column... this reqires creating three lambdas to deal with
         // column maintenance.  The first lamba deletes the column, correctly taking into
         // account the type of the column...
-        std::function<void(void*)> deleter;
-        deleter = [](void* deleteMe) {
+        void (*deleter)(void*) = [](void* deleteMe) {
             std::vector<ColType>* killMe = (std::vector<ColType>*)deleteMe;
             delete killMe;
         };
 
         // and the second lambda filters the column, again correctly taking into account
         // the type of the column
-        std::function<void*(void*, std::vector<bool>&)> filter;
-        filter = [](void* filter, std::vector<bool>& whichAreValid) {
+        void* (*filter)(void*, std::vector<bool>&) = [](void* filter,
+                                                         std::vector<bool>& whichAreValid) {
             std::vector<ColType>& filterMe = *((std::vector<ColType>*)filter);
 
             // count the number of rows that need to be retained
@@ -358,8 +543,8 @@ public:
             // and return the result
             return (void*)newVec;
         };
-        std::function<void*(void*, std::vector<uint32_t>&)> replicate;
-        replicate = [](void* replicate, std::vector<uint32_t>& timesToReplicate) {
+        void* (*replicate)(void*, std::vector<uint32_t>&) = [](
+            void* replicate, std::vector<uint32_t>& timesToReplicate) {
 
             std::vector<ColType>& replicateMe = *((std::vector<ColType>*)replicate);
 
@@ -381,15 +566,24 @@ public:
             // and return the result
             return (void*)newVec;
         };
+        // this one compacts the column to the selected rows of a tuple set
+        void* (*gather)(void*, std::vector<uint32_t>&) = [](void* gather,
+                                                           std::vector<uint32_t>& positions) {
+            std::vector<ColType>& gatherMe = *((std::vector<ColType>*)gather);
+            std::vector<ColType>* newVec = new std::vector<ColType>(positions.size());
+            for (size_t i = 0; i < positions.size(); i++) {
+                (*newVec)[i] = gatherMe[positions[i]];
+            }
+            return (void*)newVec;
+        };
         // JiaNote: add getCount to get number of rows for a particular column at runtime
-        std::function<size_t(void*)> getCount;
-        getCount = [](void* countMe) {
+        size_t (*getCount)(void*) = [](void* countMe) {
             std::vector<ColType>* toCountRowsOfMe = (std::vector<ColType>*)countMe;
             return toCountRowsOfMe->size();
         };
 
         // the third lambda is responsible for writing this column to an output vector
-        std::function<void(Handle<Vector<Handle<Object>>>&, void*, size_t&)> writeToVector;
+        void (*writeToVector)(Handle<Vector<Handle<Object>>>&, void*, size_t&);
         if (std::is_base_of<PtrBase, ColType>::value)
             writeToVector =
                 [](Handle<Vector<Handle<Object>>>& writeToMe, void* writeMe, size_t& lastWritten) {
@@ -413,23 +607,32 @@ public:
 
 
         // finally, the sixth creates a pdb :: Vector to hold the column
-        std::function<Handle<Vector<Handle<Object>>>()> createPDBVector;
-        createPDBVector = []() {
+        Handle<Vector<Handle<Object>>> (*createPDBVector)() = []() {
             Handle<Vector<Handle<ColType>>> returnVal = makeObject<Vector<Handle<ColType>>>();
             return unsafeCast<Vector<Handle<Object>>>(returnVal);
         };
 
-        MaintenanceFuncs myFuncs(
+        // the rows of the new column are the selected ones, the old column is deleted if nobody
+        // else uses it
+        TupleSetColumnPtr column = std::make_shared<TupleSetColumn>();
+        column->data = (void*)addMe;
+        column->funcs = MaintenanceFuncs(
             deleter,
             filter,
             replicate,
+            gather,
             getCount,
             createPDBVector,
             writeToVector,
             needToDelete,
             getTypeName<ColType>(),
             getSerializedSize<std::is_base_of<PtrBase, ColType>::value, ColType>());
-        columns[where] = std::make_pair((void*)addMe, myFuncs);
+        column->batch = batch;
+        column->selection = selection;
+        ColumnSlot& slot = getSlot(where);
+        slot.column = column;
+        slot.isOwned = true;
+        slot.lastWritten = 0;
     }
 };
 }
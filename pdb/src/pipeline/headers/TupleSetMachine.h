@@ -67,6 +67,9 @@ public:
     // output
     void setup(TupleSetPtr input, TupleSetPtr output) {
 
+        // the output has the same rows selected as the input
+        output->copySelection(input);
+
         // first, do a shallow copy of all of the atts that are being copied over
         int counter = 0;
         for (auto& i : matches) {
@@ -82,6 +85,9 @@ public:
                    std::vector<uint32_t>& counts,
                    int offset) {
 
+        // the replicated columns only hold the selected rows of the input
+        output->clearSelection();
+
         // first, do a shallow copy of all of the atts that are being copied over
         int counter = 0;
         for (auto& i : matches) {
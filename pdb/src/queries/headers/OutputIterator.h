@@ -28,7 +28,8 @@
 #include "KeepGoing.h"
 #include <string>
 #include <memory>
-#include <snappy.h>
+#include "PageCodec.h"
+#include "SetScanStream.h"
 #include "UseTemporaryAllocationBlock.h"
 
 namespace pdb {
@@ -40,6 +41,8 @@ public:
     bool operator!=(const OutputIterator& me) const {
         if (connection != nullptr || me.connection != nullptr)
             return true;
+        if (stream != nullptr || me.stream != nullptr)
+            return true;
         return false;
     }
 
@@ -56,7 +59,26 @@ public:
     }
 
     void operator++() {
-        if (pos == size - 1) {
+        if ((stream != nullptr) && (pos >= size - 1)) {
+
+            // the next page the workers have streamed to us, skipping empty ones
+            do {
+                data = nullptr;
+                free(page);
+                page = (Record<Vector<Handle<OutType>>>*)stream->nextPage();
+                if (page == nullptr) {
+                    if (!stream->isOk()) {
+                        std::cout << "Problem getting data from a worker\n";
+                    }
+                    stream = nullptr;
+                    return;
+                }
+                data = page->getRootObject();
+                size = data->size();
+            } while (size == 0);
+            pos = 0;
+
+        } else if (pos == size - 1) {
 
             // for allocations
             const UseTemporaryAllocationBlock tempBlock{1024};
@@ -89,32 +111,21 @@ public:
                 connection = nullptr;
                 return;
             }
-#ifdef ENABLE_COMPRESSION
-            char* readToHere = new char[objSize];
-#else
-            void* readToHere = malloc(objSize);
-#endif
             // we've got some more data
-
-            if (!connection->receiveBytes(readToHere, errMsg)) {
+            PageFrameHeader header;
+            if (!PageCodec::receiveHeader(connection, header, errMsg)) {
                 std::cout << "Problem getting data: " << errMsg << "\n";
                 connection = nullptr;
                 return;
             }
-            size_t uncompressedSize = 0;
-            snappy::GetUncompressedLength(readToHere, objSize, &uncompressedSize);
-            page = (Record<Vector<Handle<OutType>>>*)malloc(uncompressedSize);
-#ifdef ENABLE_COMPRESSION
-            snappy::RawUncompress(readToHere, objSize, (char*)(page));
-#else
-            memcpy(page, readToHere, objSize);
-#endif
-
-#ifdef ENABLE_COMPRESSION
-            delete[] readToHere;
-#else
-            free(readToHere);
-#endif
+            page = (Record<Vector<Handle<OutType>>>*)malloc(header.numBytes);
+            if (!PageCodec::receivePage(connection, header, page, errMsg)) {
+                std::cout << "Problem getting data: " << errMsg << "\n";
+                free(page);
+                page = nullptr;
+                connection = nullptr;
+                return;
+            }
             // gets the vector that we are going to iterate over
             data = page->getRootObject();
             // std :: cout << "to obtain size of vector" << std :: endl;
@@ -142,6 +153,15 @@ public:
         this->operator++();
     }
 
+    // iterates over the pages of a stream that has been started
+    OutputIterator(SetScanStreamPtr streamIn) {
+        connection = nullptr;
+        stream = streamIn;
+        data = nullptr;
+        page = nullptr;
+        this->operator++();
+    }
+
     OutputIterator() {
         connection = nullptr;
         data = nullptr;
@@ -179,6 +199,9 @@ private:
     Handle<Vector<Handle<OutType>>> data;
     Record<Vector<Handle<OutType>>>* page;
     PDBCommunicatorPtr connection;
+
+    // the stream the pages come from instead of the connection; dropping it stops the workers
+    SetScanStreamPtr stream;
 };
 }
 
@@ -21,6 +21,9 @@
 
 #include "OutputIterator.h"
 #include "SetScan.h"
+#include "SetScanStream.h"
+#include "GetListOfNodes.h"
+#include "ListOfNodes.h"
 #include <snappy.h>
 
 namespace pdb {
@@ -58,8 +61,21 @@ public:
             return OutputIterator<OutType>();
         }
 
-        // establish a connection
+        // read the set straight from the workers, if the manager can tell us who they are
         std::string errMsg;
+        std::vector<std::string> workers;
+        if ((SET_SCAN_WINDOW > 0) && getWorkers(workers) && (workers.size() > 0)) {
+            SetScanStreamPtr stream =
+                std::make_shared<SetScanStream>(myLogger, workers, dbName, setName);
+            if (stream->start(errMsg)) {
+                PDB_COUT << "streaming the set from " << workers.size() << " workers" << std::endl;
+                return OutputIterator<OutType>(stream);
+            }
+            myLogger->error(errMsg);
+            myLogger->error("output iterator: not able to stream from the workers.\n");
+        }
+
+        // establish a connection
         PDBCommunicatorPtr temp = std::make_shared<PDBCommunicator>();
         if (temp->connectToInternetServer(myLogger, port, serverName, errMsg)) {
             myLogger->error(errMsg);
@@ -84,6 +100,32 @@ public:
     }
 
 private:
+    // asks the manager for the address:port of every worker; false if it can't tell
+    bool getWorkers(std::vector<std::string>& workers) {
+        std::string errMsg;
+        PDBCommunicatorPtr temp = std::make_shared<PDBCommunicator>();
+        if (temp->connectToInternetServer(myLogger, port, serverName, errMsg)) {
+            myLogger->error(errMsg);
+            return false;
+        }
+        const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+        Handle<GetListOfNodes> request = makeObject<GetListOfNodes>();
+        if (!temp->sendObject(request, errMsg)) {
+            myLogger->error(errMsg);
+            return false;
+        }
+        bool success;
+        Handle<ListOfNodes> nodes = temp->getNextObject<ListOfNodes>(success, errMsg);
+        if (!success || (nodes == nullptr) || (nodes->getHostNames() == nullptr)) {
+            return false;
+        }
+        Handle<Vector<String>> hostNames = nodes->getHostNames();
+        for (int i = 0; i < hostNames->size(); i++) {
+            workers.push_back(static_cast<std::string>((*hostNames)[i]));
+        }
+        return true;
+    }
+
     // these are used so that the output knows how to connect to the server for iteration
     int port;
     std::string serverName;
@@ -62,6 +62,33 @@ public:
     virtual bool needsProcessInput() {
         return true;
     }
+
+    // the next three are for processors that can spill what they have in the output page to
+    // disk, like the AggregationProcessor
+
+    // returns true if this can spill its output page
+    virtual bool canSpill() {
+        return false;
+    }
+
+    // starts to spill the objects in the output page that go to the given bucket (out of
+    // numBuckets) at the given spill level, every level splits with other bits of the hash.
+    // Returns false if there is nothing to spill
+    virtual bool startSpill(int level, int numBuckets, int bucket) {
+        return false;
+    }
+
+    // writes the objects being spilled to a page, the way loadInputPage reads them.  Returns true
+    // if the page is full and there are objects left, then it is called again with another page
+    virtual bool fillSpillPage(void* pageToWriteTo, size_t numBytesInPage) {
+        return false;
+    }
+
+    // returns true if the last spill stopped because an object does not fit even in an empty
+    // spill page; the object and everything else is still in the output page
+    virtual bool hasSpillFailed() {
+        return false;
+    }
 };
 }
 
@@ -19,7 +19,9 @@
 #define ABSTRACT_HASH_SET
 
 
+#include "BlockedBloomFilter.h"
 #include <memory>
+#include <vector>
 
 namespace pdb {
 
@@ -34,6 +36,9 @@ typedef std::shared_ptr<AbstractHashSet> AbstractHashSetPtr;
 
 class AbstractHashSet {
 
+private:
+    // the runtime filters of the hash tables of a join, one for every partition of the set
+    std::vector<BlockedBloomFilterPtr> runtimeFilters;
 
 public:
     // return the hash set type
@@ -44,6 +49,17 @@ public:
 
     // get size
     virtual size_t getSize() = 0;
+
+    // the filters are set once the hash tables are built, before the set is probed
+    void setRuntimeFilters(std::vector<BlockedBloomFilterPtr>& filters) {
+        runtimeFilters = filters;
+    }
+
+    std::vector<BlockedBloomFilterPtr>& getRuntimeFilters() {
+        return runtimeFilters;
+    }
+
+    virtual ~AbstractHashSet() {}
 };
 }
 
@@ -31,6 +31,9 @@ AggregationProcessor<KeyType, ValueType>::AggregationProcessor(HashPartitionID i
     count = 0;
     begin = nullptr;
     end = nullptr;
+    spillBegin = nullptr;
+    spillEnd = nullptr;
+    spillFailed = false;
 }
 
 // initialize
@@ -134,10 +137,12 @@ bool AggregationProcessor<KeyType, ValueType>::fillNextOutputPage() {
             }
             KeyType curKey = (*(*begin)).key;
             ValueType curValue = (*(*begin)).value;
-            // if the key is not there
-            if (outputData->count(curKey) == 0) {
-                ValueType* temp = nullptr;
-                temp = &((*outputData)[curKey]);
+
+            // the hash of the key is in the record, we do not compute it again
+            bool inserted;
+            ValueType* temp = &(outputData->findOrInsert(curKey, (*(*begin)).hash, inserted));
+            // if the key was not there
+            if (inserted) {
                 try {
 
                     *temp = curValue;
@@ -150,21 +155,20 @@ bool AggregationProcessor<KeyType, ValueType>::fillNextOutputPage() {
                 }
                 // the key is there
             } else {
-                // get the value and copy of it
-                ValueType& temp = (*outputData)[curKey];
-                ValueType copy = temp;
+                // get a copy of the value
+                ValueType copy = *temp;
 
                 // and add to old value, producing a new one
                 try {
 
-                    temp = copy + curValue;
+                    *temp = copy + curValue;
                     ++(*begin);
                     count++;
 
                     // if we got here, it means we run out of RAM and we need to restore the old
                     // value in the destination hash map
                 } catch (NotEnoughSpace& n) {
-                    temp = copy;
+                    *temp = copy;
                     throw n;
                 }
             }
@@ -201,6 +205,126 @@ bool AggregationProcessor<KeyType, ValueType>::needsProcessInput() {
         return true;
     }
 }
+
+template <class KeyType, class ValueType>
+int AggregationProcessor<KeyType, ValueType>::getSpillBucket(size_t hashVal,
+                                                             int level,
+                                                             int numBuckets) {
+    // the slot in a PairArray comes from the low bits of the mixed hash, and its control byte from
+    // the high 7 bits, so the buckets are taken from the bits in between, 8 more for every level
+    return (int)((mixHash(hashVal) >> (16 + 8 * level)) % numBuckets);
+}
+
+template <class KeyType, class ValueType>
+bool AggregationProcessor<KeyType, ValueType>::canSpill() {
+    return true;
+}
+
+template <class KeyType, class ValueType>
+bool AggregationProcessor<KeyType, ValueType>::startSpill(int level, int numBuckets, int bucket) {
+    if (spillBegin != nullptr) {
+        delete spillBegin;
+    }
+    if (spillEnd != nullptr) {
+        delete spillEnd;
+    }
+    spillBegin = nullptr;
+    spillEnd = nullptr;
+    spillFailed = false;
+    if (outputData == nullptr) {
+        return false;
+    }
+    spillLevel = level;
+    numSpillBuckets = numBuckets;
+    spillBucket = bucket;
+    spillBegin = new PDBMapIterator<KeyType, ValueType>(outputData->getArray(), true);
+    spillEnd = new PDBMapIterator<KeyType, ValueType>(outputData->getArray());
+
+    // go to the first group of the bucket, so that no page is used for an empty bucket
+    while ((*spillBegin) != (*spillEnd)) {
+        if (getSpillBucket((*(*spillBegin)).hash, spillLevel, numSpillBuckets) == spillBucket) {
+            return true;
+        }
+        ++(*spillBegin);
+    }
+    delete spillBegin;
+    delete spillEnd;
+    spillBegin = nullptr;
+    spillEnd = nullptr;
+    return false;
+}
+
+template <class KeyType, class ValueType>
+bool AggregationProcessor<KeyType, ValueType>::fillSpillPage(void* pageToWriteTo,
+                                                             size_t numBytesInPage) {
+    if (spillBegin == nullptr) {
+        return false;
+    }
+
+    // the spilled groups are written as an AggregationMap with our id, as the combiner does, so
+    // they are read back with loadInputPage; the output page is not the allocation block while
+    // we write, so nothing in it is changed
+    UseTemporaryAllocationBlockPtr spillBlock =
+        std::make_shared<UseTemporaryAllocationBlock>(pageToWriteTo, numBytesInPage);
+    Handle<Vector<Handle<AggregationMap<KeyType, ValueType>>>> spillData = nullptr;
+    Handle<AggregationMap<KeyType, ValueType>> spillMap = nullptr;
+    bool isFull = false;
+
+    // the size of the map stays the same when a group that did not fit is taken out
+    bool isEmpty = true;
+    try {
+        spillData = makeObject<Vector<Handle<AggregationMap<KeyType, ValueType>>>>(1);
+        spillMap = makeObject<AggregationMap<KeyType, ValueType>>();
+        spillMap->setHashPartitionId(id);
+        spillData->push_back(spillMap);
+        while ((*spillBegin) != (*spillEnd)) {
+            size_t hashVal = (*(*spillBegin)).hash;
+            if (getSpillBucket(hashVal, spillLevel, numSpillBuckets) != spillBucket) {
+                ++(*spillBegin);
+                continue;
+            }
+            KeyType& curKey = (*(*spillBegin)).key;
+            bool inserted;
+            isEmpty = (spillMap->size() == 0);
+            ValueType* temp = &(spillMap->findOrInsert(curKey, hashVal, inserted));
+            try {
+                *temp = (*(*spillBegin)).value;
+            } catch (NotEnoughSpace& n) {
+                spillMap->setUnused(curKey);
+                throw n;
+            }
+            ++(*spillBegin);
+        }
+    } catch (NotEnoughSpace& n) {
+        if (isEmpty) {
+            // another page would not help, so we stop, and the caller keeps the output page
+            std::cout << "AggregationProcessor-" << id << ": a group does not fit in a spill page "
+                      << "of " << numBytesInPage << " bytes" << std::endl;
+            spillFailed = true;
+        } else {
+            isFull = true;
+        }
+    }
+    if (spillData != nullptr) {
+        getRecord(spillData);
+    }
+
+    // let go of the page before the handles to it, so that they do not free what is on it
+    spillBlock = nullptr;
+    if (isFull) {
+        return true;
+    }
+    delete spillBegin;
+    delete spillEnd;
+    spillBegin = nullptr;
+    spillEnd = nullptr;
+    return false;
+}
+
+template <class KeyType, class ValueType>
+bool AggregationProcessor<KeyType, ValueType>::hasSpillFailed() {
+    return spillFailed;
+}
 }
 
 
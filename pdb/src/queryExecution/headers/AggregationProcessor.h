@@ -45,6 +45,13 @@ public:
     void clearOutputPage() override;
     void clearInputPage() override;
     bool needsProcessInput() override;
+    bool canSpill() override;
+    bool startSpill(int level, int numBuckets, int bucket) override;
+    bool fillSpillPage(void* pageToWriteTo, size_t numBytesInPage) override;
+    bool hasSpillFailed() override;
+
+    // the bucket of a hash at a spill level
+    static int getSpillBucket(size_t hashVal, int level, int numBuckets);
 
 private:
     UseTemporaryAllocationBlockPtr blockPtr;
@@ -59,6 +66,14 @@ private:
     PDBMapIterator<KeyType, ValueType>* end;
 
     int count;
+
+    // the bucket being spilled, and the iterators over the output map for it
+    int spillLevel;
+    int numSpillBuckets;
+    int spillBucket;
+    PDBMapIterator<KeyType, ValueType>* spillBegin;
+    PDBMapIterator<KeyType, ValueType>* spillEnd;
+    bool spillFailed;
 };
 }
 
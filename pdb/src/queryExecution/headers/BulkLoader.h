@@ -0,0 +1,122 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef BULK_LOADER_H
+#define BULK_LOADER_H
+
+#include "Handle.h"
+#include "PDBLogger.h"
+#include "PDBVector.h"
+#include "PDBWork.h"
+#include "PDBWorkerQueue.h"
+#include "PageCodec.h"
+#include "ShuffleChannel.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// the number of threads that build pages for a bulk load
+#ifndef BULK_LOAD_THREADS
+#define BULK_LOAD_THREADS 4
+#endif
+
+namespace pdb {
+
+class BulkLoader;
+typedef std::shared_ptr<BulkLoader> BulkLoaderPtr;
+
+// fills a page with the objects of a thread: it is called with an empty vector that lives on the
+// page, and pushes objects to it until it has no more, then returns false, or until the page is
+// full, when the push_back throws NotEnoughSpace; then the page is sent and the filler is called
+// again with a new one, so it must keep what it needs to make the object that did not fit again,
+// but no Handle to an object of the page
+typedef std::function<bool(int threadId, Handle<Vector<Handle<Object>>> page)> BulkLoadFiller;
+
+/*
+ * This class loads a set from a client without going through the dispatcher of the manager, which
+ * receives every vector sent by sendData, partitions it and forwards it to a storage server one
+ * request at a time. Here numThreads threads of the client fill pages of the size of the set with
+ * a BulkLoadFiller, and every page goes to a worker of its own, in round-robin, over a
+ * ShuffleChannel per worker in page mode: the storage server of the worker puts the page straight
+ * into its page cache, and the channel keeps numCredits pages in flight. The manager is only asked
+ * whether the set takes objects of the type, before any page is made, and for the workers; the
+ * pages and bytes loaded are reported to its dispatcher by the caller.
+ */
+
+class BulkLoader {
+
+private:
+    // the threads that fill the pages; objects can only be made in a thread of a worker queue,
+    // which has an allocator of its own, and there is one worker queue in a process
+    static PDBWorkerQueuePtr workers;
+
+    // the manager, to get the workers from
+    int port;
+    std::string address;
+
+    int numThreads;
+    int numCredits;
+
+    // statistics of the last load
+    long numPagesSent;
+    size_t numBytesSent;
+    size_t numObjectsSent;
+    PageCodecStats codecStats;
+
+    PDBLoggerPtr logger;
+
+public:
+    BulkLoader(PDBLoggerPtr logger,
+               int port,
+               std::string address,
+               int numThreads = BULK_LOAD_THREADS,
+               int numCredits = SHUFFLE_CHANNEL_CREDITS);
+
+    // loads the objects of the filler into a set that exists, stores objects of type typeName and
+    // has pages of pageSize bytes; returns false if the manager does not accept the set, or if a
+    // page could not be made or stored
+    bool load(std::string databaseName,
+              std::string setName,
+              std::string typeName,
+              BulkLoadFiller filler,
+              size_t pageSize,
+              std::string& errMsg);
+
+    // the pages and the bytes of the last load, before encoding, and the objects in them
+    long getNumPagesSent();
+
+    size_t getNumBytesSent();
+
+    size_t getNumObjectsSent();
+
+    const PageCodecStats& getCodecStats();
+
+    // asks the manager for the address:port of every worker
+    bool getWorkers(std::vector<std::string>& workers, std::string& errMsg);
+
+    // asks the dispatcher of the manager whether the set exists and stores objects of the type,
+    // with a DispatcherAddPages request that has no pages
+    bool checkSet(std::string databaseName,
+                  std::string setName,
+                  std::string typeName,
+                  std::string& errMsg);
+};
+}
+
+#endif
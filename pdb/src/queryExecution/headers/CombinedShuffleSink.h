@@ -25,6 +25,7 @@
 #include "TupleSet.h"
 #include "DataTypes.h"
 #include "AggregationMap.h"
+#include "ShuffleSkew.h"
 #include <vector>
 
 namespace pdb {
@@ -41,6 +42,11 @@ private:
     int numNodes;
     int numPartitionsPerNode;
 
+    // the skew of the stage, and the tuples we sent to every partition since we last added them to
+    // it
+    ShuffleSkewPtr skew = nullptr;
+    std::vector<uint64_t> numTuples;
+
 public:
     CombinedShuffleSink(int numPartitionsPerNode,
                         int numNodes,
@@ -70,6 +76,11 @@ public:
         return *((*((*outputData)[nodeId]))[partitionId]);
     }
 
+    void setShuffleSkew(ShuffleSkewPtr skew) override {
+        this->skew = skew;
+        this->numTuples.assign(numNodes * numPartitionsPerNode, 0);
+    }
+
     Handle<Object> createNewOutputContainer() override {
 
         // we create a node-partitioned map to store the output
@@ -111,32 +122,31 @@ public:
 
             hashVal = Hasher<KeyType>::hash(keyColumn[i]);
 
-            AggregationMap<KeyType, ValueType>& myMap =
-                getMap(hashVal % (numNodes * numPartitionsPerNode), writeMe);
-            // if this key is not already there...
-            if (myMap.count(keyColumn[i]) == 0) {
+            size_t whichPartition = hashVal % (numNodes * numPartitionsPerNode);
+            AggregationMap<KeyType, ValueType>& myMap = getMap(whichPartition, writeMe);
+            // find the key, or add it... this may cause an allocation for a new key/val pair
+            bool inserted;
+            ValueType* temp = nullptr;
+            try {
+                temp = &(myMap.findOrInsert(keyColumn[i], hashVal, inserted));
+
+                // if we get an exception, then we could not fit a new key/value pair
+            } catch (NotEnoughSpace& n) {
+
+                // if we got here, then we ran out of space, and so we need to delete the
+                // already-processed data so that we can try again...
+                keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
+                valueColumn.erase(valueColumn.begin(), valueColumn.begin() + i);
+                throw n;
+            }
 
-                // this point will record where the value is located
-                ValueType* temp = nullptr;
-
-                // try to add the key... this will cause an allocation for a new key/val pair
-                try {
-                    // get the location that we need to write to...
-                    temp = &(myMap[keyColumn[i]]);
-
-                    // if we get an exception, then we could not fit a new key/value pair
-                } catch (NotEnoughSpace& n) {
-                    // if we got here, then we ran out of space, and so we need to delete the
-                    // already-processed
-                    // data so that we can try again...
-                    keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
-                    valueColumn.erase(valueColumn.begin(), valueColumn.begin() + i);
-                    throw n;
-                }
+            // if this key was not already there...
+            if (inserted) {
 
                 // we were able to fit a new key/value pair, so copy over the value
                 try {
                     *temp = valueColumn[i];
+
                     // if we could not fit the value...
                 } catch (NotEnoughSpace& n) {
 
@@ -152,19 +162,19 @@ public:
                 // the key is there
             } else {
 
-                // get the value and a copy of it
-                ValueType& temp = myMap[keyColumn[i]];
-                ValueType copy = temp;
+                // get a copy of the value
+                ValueType copy = *temp;
 
                 // and add to the old value, producing a new one
                 try {
-                    temp = copy + valueColumn[i];
-                    // if we got here, then it means that we ram out of RAM when we were trying
+                    *temp = copy + valueColumn[i];
+
+                    // if we got here, then it means that we ran out of RAM when we were trying
                     // to put the new value into the hash table
                 } catch (NotEnoughSpace& n) {
 
                     // restore the old value
-                    temp = copy;
+                    *temp = copy;
 
                     // and erase all of the guys who were processed
                     keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
@@ -172,6 +182,13 @@ public:
                     throw n;
                 }
             }
+            if (skew != nullptr) {
+                numTuples[whichPartition]++;
+            }
+        }
+
+        if (skew != nullptr) {
+            skew->addNumTuples(numTuples);
         }
     }
 
@@ -146,17 +146,13 @@ bool CombinerProcessor<KeyType, ValueType>::fillNextOutputPage() {
             }
             KeyType curKey = (*(*begin)).key;
             ValueType curValue = (*(*begin)).value;
-            if (curOutputMap->count(curKey) == 0) {
-            // if the key is not there
 
-                ValueType* temp = nullptr;
-                try {
-                    temp = &((*curOutputMap)[curKey]);
-
-                } catch (NotEnoughSpace& n) {
+            // the hash of the key is in the record, we do not compute it again
+            bool inserted;
+            ValueType* temp = &(curOutputMap->findOrInsert(curKey, (*(*begin)).hash, inserted));
+            if (inserted) {
+            // if the key was not there
 
-                    throw n;
-                }
                 try {
 
                     *temp = curValue;
@@ -171,21 +167,20 @@ bool CombinerProcessor<KeyType, ValueType>::fillNextOutputPage() {
                 // the key is there
             } else {
 
-                // get the value and copy of it
-                ValueType& temp = (*curOutputMap)[curKey];
-                ValueType copy = temp;
+                // get a copy of the value
+                ValueType copy = *temp;
 
                 // and add to old value, producing a new one
                 try {
 
-                    temp = copy + curValue;
+                    *temp = copy + curValue;
                     ++(*begin);
                     count++;
 
                     // if we got here, it means we run out of RAM and we need to restore the old
                     // value in the destination hash map
                 } catch (NotEnoughSpace& n) {
-                    temp = copy;
+                    *temp = copy;
                     throw n;
                 }
             }
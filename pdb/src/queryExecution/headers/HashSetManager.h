@@ -20,12 +20,18 @@
 
 
 #include "AbstractHashSet.h"
+#include <map>
+#include <pthread.h>
 
 namespace pdb {
 
 /*
  * encapsulates a hash set manager to manage hash tables allocated on heap
  * this functionality will be replaced by Pangea storage manger
+ *
+ * stages of a job may build their hash tables on a node at the same time, so the hash sets are
+ * guarded by a mutex, and a stage reserves the heap memory it is going to build into before it
+ * builds, so that the builds share the memory left instead of each taking most of it
  */
 
 class HashSetManager {
@@ -33,52 +39,114 @@ class HashSetManager {
 private:
     // all hash tables allocated
     std::map<std::string, AbstractHashSetPtr> hashSets;
-    size_t totalSize = 0;
+
+    // heap memory reserved by the stages that build, by the name of the hash set they build
+    std::map<std::string, size_t> reservations;
+
+    pthread_mutex_t mutex;
+
+    // the memory taken by the hash sets, and reserved for what they don't hold yet; to be called
+    // with the mutex held
+    size_t getUsedSize() {
+        size_t usedSize = 0;
+        for (auto& hashSet : hashSets) {
+            if (hashSet.second != nullptr) {
+                usedSize += hashSet.second->getSize();
+            }
+        }
+        for (auto& reservation : reservations) {
+            size_t heldSize = 0;
+            auto hashSet = hashSets.find(reservation.first);
+            if ((hashSet != hashSets.end()) && (hashSet->second != nullptr)) {
+                heldSize = hashSet->second->getSize();
+            }
+            if (reservation.second > heldSize) {
+                usedSize += reservation.second - heldSize;
+            }
+        }
+        return usedSize;
+    }
 
 public:
+    HashSetManager() {
+        pthread_mutex_init(&mutex, nullptr);
+    }
+
+    ~HashSetManager() {
+        pthread_mutex_destroy(&mutex);
+    }
+
     // to get a hash set
     AbstractHashSetPtr getHashSet(std::string name) {
-        if (hashSets.count(name) == 0) {
-            return nullptr;
-        } else {
-            return hashSets[name];
+        AbstractHashSetPtr hashSet = nullptr;
+        pthread_mutex_lock(&mutex);
+        if (hashSets.count(name) != 0) {
+            hashSet = hashSets[name];
         }
+        pthread_mutex_unlock(&mutex);
+        return hashSet;
     }
 
     // to add a hash set
     bool addHashSet(std::string name, AbstractHashSetPtr hashSet) {
+        pthread_mutex_lock(&mutex);
         if (hashSets.count(name) != 0) {
+            pthread_mutex_unlock(&mutex);
             std::cout << "Error: hash set exists: " << name << std::endl;
             return false;
         } else {
             hashSets[name] = hashSet;
-            if (hashSet != nullptr) {
-                totalSize += hashSet->getSize();
-            }
+            pthread_mutex_unlock(&mutex);
             return true;
         }
     }
 
-    // to remove a hash set
+    // to remove a hash set, and the memory reserved for it
     bool removeHashSet(std::string name) {
+        pthread_mutex_lock(&mutex);
         if (hashSets.count(name) == 0) {
+            pthread_mutex_unlock(&mutex);
             std::cout << "Error: hash set doesn't exist: " << name << std::endl;
             return false;
         } else {
-            totalSize -= hashSets[name]->getSize();
             hashSets.erase(name);
+            reservations.erase(name);
+            pthread_mutex_unlock(&mutex);
             return true;
         }
     }
 
-    // get total size
-    size_t getTotalSize() {
-        auto a = hashSets.begin();
-        size_t totalSize = 0;
-        while (a != hashSets.end()) {
-            totalSize += a->second->getSize();
-            ++a;
+    // to reserve heap memory for the hash set of the given name: of the memory available that
+    // the hash sets and the other reservations don't take, we give the given ratio at most, and
+    // no more than is wanted. Returns the size reserved
+    size_t reserveMemory(std::string name, size_t availableSize, size_t wantedSize, double ratio) {
+        pthread_mutex_lock(&mutex);
+        reservations.erase(name);
+        size_t usedSize = getUsedSize();
+        size_t reservedSize = 0;
+        if (availableSize > usedSize) {
+            reservedSize = (double)(availableSize - usedSize) * ratio;
         }
+        if (reservedSize > wantedSize) {
+            reservedSize = wantedSize;
+        }
+        reservations[name] = reservedSize;
+        pthread_mutex_unlock(&mutex);
+        return reservedSize;
+    }
+
+    // to release the memory reserved for a hash set that is not kept
+    void releaseMemory(std::string name) {
+        pthread_mutex_lock(&mutex);
+        reservations.erase(name);
+        pthread_mutex_unlock(&mutex);
+    }
+
+    // get total size, with the memory reserved
+    size_t getTotalSize() {
+        pthread_mutex_lock(&mutex);
+        size_t totalSize = getUsedSize();
+        pthread_mutex_unlock(&mutex);
         return totalSize;
     }
 };
@@ -0,0 +1,143 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef MORSEL_SCHEDULER_H
+#define MORSEL_SCHEDULER_H
+
+#include "PageIterator.h"
+#include "PDBLogger.h"
+#include "MorselTupleSetIterator.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <pthread.h>
+#include <vector>
+
+// the number of objects in a morsel, 0 means that the threads of a pipeline stage take whole pages
+#ifndef MORSEL_SIZE
+#define MORSEL_SIZE 1024
+#endif
+
+namespace pdb {
+
+class MorselScheduler;
+typedef std::shared_ptr<MorselScheduler> MorselSchedulerPtr;
+
+/*
+ * This class hands out the pages that a pipeline stage scans to the threads running the stage, in
+ * morsels of MORSEL_SIZE objects. Every thread splits the pages it reads into its own queue, and a
+ * thread whose queue is empty steals half of the queue of a busy thread, so that a big or slow page
+ * is processed by all of the threads rather than by the one that happened to read it.
+ * The number of threads taking morsels can be changed while the stage runs; the threads above that
+ * number park until they are needed again or the stage is done.
+ */
+
+class MorselScheduler {
+
+private:
+    // the book keeping for the morsels of one page
+    struct MorselPage {
+        std::atomic<int> numUnfinished;
+    };
+
+    // the queue of morsels of one thread, the owner takes them from the front and thieves take them
+    // from the back
+    struct MorselQueue {
+        pthread_mutex_t mutex;
+        std::deque<Morsel> morsels;
+        std::atomic<size_t> size;
+    };
+
+    // the iterators we read pages from, and whether they are used up
+    std::vector<PageIteratorPtr> iterators;
+    std::vector<pthread_mutex_t> iteratorMutexes;
+    std::unique_ptr<std::atomic<bool>[]> exhausted;
+
+    // one queue for every thread
+    std::vector<MorselQueue*> queues;
+
+    // the number of morsels in all of the queues
+    std::atomic<long> numQueued;
+
+    // the number of threads reading or splitting a page, whose morsels are not queued yet
+    std::atomic<int> numSplitting;
+
+    // the number of objects in a morsel
+    size_t morselSize;
+
+    // the threads with an id below this number take morsels
+    std::atomic<int> numActiveWorkers;
+
+    // set when there is no morsel left to hand out
+    bool finished;
+
+    // to park and wake up the threads
+    pthread_mutex_t parkMutex;
+    pthread_cond_t parkCond;
+
+    // statistics
+    std::atomic<long> numMorsels;
+    std::atomic<long> numSteals;
+
+    pdb::PDBLoggerPtr logger;
+
+    // takes a morsel from the queue of the thread
+    bool popMorsel(int workerId, Morsel& morsel);
+
+    // steals half of the queue of another thread, returns the first of the stolen morsels and
+    // queues the others for the thread
+    bool stealMorsels(int workerId, Morsel& morsel);
+
+    // reads another page and splits it into morsels, returns the first one and queues the others
+    // for the thread; returns false if all of the iterators are used up
+    bool splitNextPage(int workerId, Morsel& morsel);
+
+    // waits while the thread is not supposed to take morsels, returns false if the stage is done
+    bool waitUntilActive(int workerId);
+
+public:
+    // creates a scheduler for numWorkers threads, worker i reads from iterators[i % size] first
+    MorselScheduler(std::vector<PageIteratorPtr> iterators,
+                    int numWorkers,
+                    size_t morselSize,
+                    pdb::PDBLoggerPtr logger);
+
+    ~MorselScheduler();
+
+    // gets the next morsel for a thread, returns false when all of the pages have been handed out
+    bool getNextMorsel(int workerId, Morsel& morsel);
+
+    // marks a morsel as processed, returns true if it was the last morsel of its page, in which
+    // case the caller has to release the page
+    bool finishMorsel(Morsel& morsel);
+
+    // changes the number of threads that take morsels, at least one thread keeps running
+    void setNumActiveWorkers(int numActiveWorkers);
+
+    int getNumActiveWorkers();
+
+    int getNumWorkers();
+
+    // the number of morsels handed out, and how many of them were stolen
+    long getNumMorsels();
+
+    long getNumSteals();
+};
+}
+
+#endif
@@ -27,6 +27,9 @@ namespace pdb {
 class PartitionedHashSet;
 typedef std::shared_ptr<PartitionedHashSet> PartitionedHashSetPtr;
 
+class SpillingHashJoin;
+typedef std::shared_ptr<SpillingHashJoin> SpillingHashJoinPtr;
+
 
 /*
  * This class encapsulates a partitioned hash set, which is a collection of managed blocks, and each
@@ -49,6 +52,10 @@ private:
     // whether this partitioned hash set has been cleaned
     bool isCleaned;
 
+    // the partitions that did not fit in the pages, if this is the hash table of a hash
+    // partitioned join
+    SpillingHashJoinPtr spillingHashJoin;
+
     // mutex
     pthread_mutex_t myMutex;
 
@@ -58,6 +65,7 @@ public:
         this->setName = myName;
         this->pageSize = pageSize;
         this->isCleaned = false;
+        this->spillingHashJoin = nullptr;
         pthread_mutex_init(&myMutex, nullptr);
     }
 
@@ -104,6 +112,16 @@ public:
         return retNum;
     }
 
+    // set the partitions that did not fit in the pages
+    void setSpillingHashJoin(SpillingHashJoinPtr spillingHashJoin) {
+        this->spillingHashJoin = spillingHashJoin;
+    }
+
+    // get the partitions that did not fit in the pages, or nullptr
+    SpillingHashJoinPtr getSpillingHashJoin() {
+        return this->spillingHashJoin;
+    }
+
     // add page
     void* addPage() {
         void* block = (void*)malloc(sizeof(char) * pageSize);
@@ -30,8 +30,12 @@
 #include "TupleSetJobStage.h"
 #include "HermesExecutionServer.h"
 #include "PartitionedHashSet.h"
+#include "SpillingHashJoin.h"
 #include "SetSpecifier.h"
 #include "DataPacket.h"
+#include "MorselScheduler.h"
+#include "PageCodec.h"
+#include "ShuffleSkew.h"
 #include <vector>
 #include <memory>
 #include <unordered_map>
@@ -91,6 +95,23 @@ private:
     // vector of nodeId for shuffling
     std::vector<int> nodeIds;
 
+    // hands out the pages of a user set to the threads in morsels, nullptr if no scan is running
+    MorselSchedulerPtr morselScheduler;
+
+    // what the codecs of the pages sent by the stage have done
+    PageCodecStats transferStats;
+    pthread_mutex_t transferStatsMutex;
+
+    // the tuples the stage shuffled to every partition, and the keys it split, nullptr if it does
+    // not shuffle by hash
+    ShuffleSkewPtr shuffleSkew;
+
+    // set when a part of the stage failed, with the first error, so that the stage reports it
+    // instead of results that are not complete
+    bool failed;
+    std::string failure;
+    pthread_mutex_t failureMutex;
+
 
 public:
     // destructor
@@ -120,6 +141,27 @@ public:
                                     std::string address,
                                     int port,
                                     std::string& errMsg);
+    // creates a codec for the pages sent to another node, as configured
+    PageCodecPtr createPageCodec();
+
+    // adds the statistics of a codec to those of the stage
+    void addTransferStats(const PageCodecStats& stats);
+
+    // the bytes sent by the stage, the bytes saved by compressing them and the time it took
+    PageCodecStats getTransferStats();
+
+    // sets up the skew of the stage, if it shuffles tuples by the hash of their keys
+    void createShuffleSkew();
+
+    // the skew of the stage once it has run, nullptr if it was not kept
+    ShuffleSkewPtr getShuffleSkew();
+
+    // marks the stage as failed; the first error is the one that is kept
+    void setFailed(std::string errMsg);
+
+    // returns true if the stage failed, and then its error in errMsg
+    bool hasFailed(std::string& errMsg);
+
     // send Shuffle data
     bool sendData(PDBCommunicatorPtr conn,
                   void* bytes,
@@ -150,7 +192,8 @@ public:
     // create proxy
     DataProxyPtr createProxy(int i, pthread_mutex_t connection_mutex, std::string& errMsg);
 
-    // execute pipeline
+    // execute pipeline; hashTable, if given, is probed instead of the page of the i-th partition
+    // of a partitioned hash set
     void executePipelineWork(int i,
                              SetSpecifierPtr outputSet,
                              std::vector<PageCircularBufferIteratorPtr>& iterators,
@@ -158,7 +201,18 @@ public:
                              DataProxyPtr proxy,
                              std::vector<PageCircularBufferPtr>& sinkBuffers,
                              HermesExecutionServer* server,
-                             std::string& errMsg);
+                             std::string& errMsg,
+                             void* hashTable = nullptr);
+
+    // the second pass of a hash partitioned join, for the partitions whose build side was spilled:
+    // their build side is built into the pages of the probed hash set, and their probe side is run
+    // through the pipeline
+    void runSpilledJoinPartitions(HermesExecutionServer* server,
+                                  SpillingHashJoinPtr spillingHashJoin,
+                                  PartitionedHashSetPtr probedHashSet,
+                                  std::vector<PageCircularBufferPtr>& sinkBuffers,
+                                  SetSpecifierPtr outputSet,
+                                  pthread_mutex_t connection_mutex);
 
     // return the root job stage corresponding to the pipeline
     Handle<TupleSetJobStage>& getJobStage();
@@ -0,0 +1,138 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef SET_SCAN_STREAM_H
+#define SET_SCAN_STREAM_H
+
+#include "PDBCommunicator.h"
+#include "PDBLogger.h"
+#include <deque>
+#include <memory>
+#include <pthread.h>
+#include <string>
+#include <vector>
+
+// the number of pages a worker may send to a client before it waits for the client to take one;
+// with 0, clients read a set through the manager, a page at a time
+#ifndef SET_SCAN_WINDOW
+#define SET_SCAN_WINDOW 2
+#endif
+
+// the number of received pages a client holds for its consumer
+#ifndef SET_SCAN_PREFETCH_PAGES
+#define SET_SCAN_PREFETCH_PAGES 4
+#endif
+
+namespace pdb {
+
+class SetScanStream;
+typedef std::shared_ptr<SetScanStream> SetScanStreamPtr;
+
+/*
+ * This class reads a set on the client side straight from the workers that store it, instead of
+ * from the manager, which asks one worker after the other and takes a round trip per page.
+ * Every worker is sent a SetScan with a window, and streams its pages as PageCodec frames without
+ * waiting, as long as no more than window pages are not taken by the client. A thread per worker
+ * receives the frames into a queue of up to numPrefetchPages pages, and gives the worker a credit
+ * for every page it puts there, so the workers keep sending while the consumer works on a page.
+ * The workers end their streams with a DoneWithResult. A client that stops early sends a credit of
+ * 0 pages, and discards the pages that are on their way until the DoneWithResult comes.
+ */
+
+class SetScanStream {
+
+private:
+    // the connection to a worker and the thread that receives its pages
+    struct Receiver {
+        SetScanStream* stream;
+        PDBCommunicatorPtr communicator;
+        std::string worker;
+        pthread_t thread;
+        bool started;
+    };
+
+    std::vector<Receiver> receivers;
+
+    // the set to scan
+    std::string databaseName;
+    std::string setName;
+
+    int windowSize;
+    int numPrefetchPages;
+
+    // the pages received and not taken yet
+    std::deque<void*> pages;
+
+    // the receivers that are still receiving
+    int numRunning;
+
+    // set when the consumer is gone, then the receivers stop their workers
+    bool aborted;
+
+    // set when a worker could not be read from
+    bool failed;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t pageReady;
+    pthread_cond_t spaceReady;
+
+    // statistics
+    long numPagesReceived;
+    size_t numBytesReceived;
+
+    PDBLoggerPtr logger;
+
+    static void* receive(void* receiver);
+
+    void receivePages(Receiver& receiver);
+
+public:
+    // workers are given as address:port
+    SetScanStream(PDBLoggerPtr logger,
+                  std::vector<std::string> workers,
+                  std::string databaseName,
+                  std::string setName,
+                  int windowSize = SET_SCAN_WINDOW,
+                  int numPrefetchPages = SET_SCAN_PREFETCH_PAGES);
+
+    // stops the workers that are still sending and waits for the receivers
+    ~SetScanStream();
+
+    // sends the scan to every worker and starts to receive; returns false if a worker can't be
+    // reached, then nothing should be read from the stream
+    bool start(std::string& errMsg);
+
+    // waits for the next page, which the caller frees; returns nullptr once every worker is done
+    void* nextPage();
+
+    // false if a worker could not be read from
+    bool isOk();
+
+    long getNumPagesReceived();
+
+    // a credit for the pages the client has taken; 0 pages stops the worker
+    static bool sendCredit(PDBCommunicatorPtr sendUsingMe, int numPages, std::string& errMsg);
+
+    // receives a credit on the worker side, a DoneWithResult is taken as a credit of 0 pages
+    static bool receiveCredit(PDBCommunicatorPtr receiveFromMe,
+                              int& numPages,
+                              std::string& errMsg);
+};
+}
+
+#endif
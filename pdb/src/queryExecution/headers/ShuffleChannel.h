@@ -0,0 +1,121 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef SHUFFLE_CHANNEL_H
+#define SHUFFLE_CHANNEL_H
+
+#include "PageCodec.h"
+#include "PDBCommunicator.h"
+#include "PDBLogger.h"
+#include <memory>
+#include <pthread.h>
+#include <string>
+
+// the number of pages a channel may have in flight before it waits for the receiver to store one
+#ifndef SHUFFLE_CHANNEL_CREDITS
+#define SHUFFLE_CHANNEL_CREDITS 8
+#endif
+
+namespace pdb {
+
+class ShuffleChannel;
+typedef std::shared_ptr<ShuffleChannel> ShuffleChannelPtr;
+
+/*
+ * This class is a connection to the storage server of another node that stays open for all of the
+ * pages a pipeline stage shuffles to that node, instead of one connection and one round trip per
+ * page. It uses the StorageAddObjectInLoop protocol with credit-based flow control: the channel
+ * starts with SHUFFLE_CHANNEL_CREDITS credits, every page sent takes one, and every acknowledgement
+ * of the receiver (sent once it has stored a page) gives one back. So a sender only waits when the
+ * receiver is that many pages behind.
+ * In page mode, every record sent is stored by the receiver as a page of its own, directly in its
+ * page cache; otherwise records are appended as variable-sized bytes, as sendData does.
+ * Every record is sent as a frame of the channel's PageCodec.
+ * A channel can be shared by the threads sending to the same node.
+ */
+
+class ShuffleChannel {
+
+private:
+    PDBCommunicatorPtr communicator;
+
+    // the set the pages go to
+    std::string databaseName;
+    std::string setName;
+
+    // whether every record is stored as a page of its own
+    bool asPages;
+
+    // the pages that can be sent before we have to wait for an acknowledgement
+    int numCredits;
+
+    // the pages sent that are not acknowledged yet
+    int numUnacknowledged;
+
+    // false once something went wrong, then the channel does not send anymore
+    bool ok;
+
+    // whether the end of the loop has been sent
+    bool closed;
+
+    // to serialize the threads sharing the channel
+    pthread_mutex_t mutex;
+
+    // encodes the records
+    PageCodecPtr codec;
+
+    // statistics
+    long numPagesSent;
+
+    PDBLoggerPtr logger;
+
+    // waits for one acknowledgement from the receiver
+    bool receiveCredit(std::string& errMsg);
+
+public:
+    // connects to the storage server at address:port; the pages sent will go to the given set,
+    // encoded with the given codec or, if that is nullptr, with the default one
+    ShuffleChannel(PDBLoggerPtr logger,
+                   std::string address,
+                   int port,
+                   std::string databaseName,
+                   std::string setName,
+                   bool asPages,
+                   int numCredits = SHUFFLE_CHANNEL_CREDITS,
+                   PageCodecPtr codec = nullptr);
+
+    // closes the channel if that has not been done
+    ~ShuffleChannel();
+
+    // sends a record; the bytes can be reused as soon as this returns, without waiting for the
+    // receiver
+    bool sendPage(void* bytes, size_t numBytes, std::string& errMsg);
+
+    // ends the loop and waits for the receiver to store all of the pages sent
+    bool close(std::string& errMsg);
+
+    long getNumPagesSent();
+
+    // the number of bytes sent after encoding
+    size_t getNumBytesSent();
+
+    const PageCodecStats& getCodecStats();
+};
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include "TupleSetMachine.h"
 #include "TupleSet.h"
 #include "DataTypes.h"
+#include "ShuffleSkew.h"
 #include <vector>
 
 namespace pdb {
@@ -39,6 +40,11 @@ private:
     int whichAttToAggregate;
     int numPartitions;
 
+    // the skew of the stage, and the tuples we sent to every partition since we last added them to
+    // it
+    ShuffleSkewPtr skew = nullptr;
+    std::vector<uint64_t> numTuples;
+
 public:
     ShuffleSink(int numPartitions, TupleSpec& inputSchema, TupleSpec& attsToOperateOn) {
 
@@ -53,6 +59,11 @@ public:
         this->numPartitions = numPartitions;
     }
 
+    void setShuffleSkew(ShuffleSkewPtr skew) override {
+        this->skew = skew;
+        this->numTuples.assign(numPartitions, 0);
+    }
+
     Handle<Object> createNewOutputContainer() override {
 
         // we create a node-partitioned map to store the output
@@ -84,42 +95,37 @@ public:
 
             hashVal = Hasher<KeyType>::hash(keyColumn[i]);
 #ifndef NO_MOD_PARTITION
-            Map<KeyType, ValueType>& myMap = *((*writeMe)[(hashVal) % numPartitions]);
+            size_t whichPartition = hashVal % numPartitions;
 #else
-            Map<KeyType, ValueType>& myMap =
-                *((*writeMe)[(hashVal / numPartitions) % numPartitions]);
+            size_t whichPartition = (hashVal / numPartitions) % numPartitions;
 #endif
-            // if this key is not already there...
-            if (myMap.count(keyColumn[i]) == 0) {
+            Map<KeyType, ValueType>& myMap = *((*writeMe)[whichPartition]);
+            // find the key, or add it... this may cause an allocation for a new key/val pair
+            bool inserted;
+            ValueType* temp = nullptr;
+            try {
+                temp = &(myMap.findOrInsert(keyColumn[i], hashVal, inserted));
+
+                // if we get an exception, then we could not fit a new key/value pair
+            } catch (NotEnoughSpace& n) {
+
+                // if we got here, then we ran out of space, and so we need to delete the
+                // already-processed data so that we can try again...
+                keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
+                valueColumn.erase(valueColumn.begin(), valueColumn.begin() + i);
+                throw n;
+            }
 
-                // this point will record where the value is located
-                ValueType* temp = nullptr;
-
-                // try to add the key... this will cause an allocation for a new key/val pair
-                try {
-                    // get the location that we need to write to...
-                    temp = &(myMap[keyColumn[i]]);
-
-                    // if we get an exception, then we could not fit a new key/value pair
-                } catch (NotEnoughSpace& n) {
-                    // if we got here, then we ran out of space, and so we need to delete the
-                    // already-processed
-                    // std :: cout << "not enough space in shuffle sink to get new value" << std ::
-                    // endl;
-                    // data so that we can try again...
-                    keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
-                    valueColumn.erase(valueColumn.begin(), valueColumn.begin() + i);
-                    throw n;
-                }
+            // if this key was not already there...
+            if (inserted) {
 
                 // we were able to fit a new key/value pair, so copy over the value
                 try {
                     *temp = valueColumn[i];
+
                     // if we could not fit the value...
                 } catch (NotEnoughSpace& n) {
 
-                    // std :: cout << "not enough space in shuffle sink to set value" << std ::
-                    // endl;
                     // then we need to erase the key from the map
                     myMap.setUnused(keyColumn[i]);
 
@@ -132,21 +138,19 @@ public:
                 // the key is there
             } else {
 
-                // get the value and a copy of it
-                ValueType& temp = myMap[keyColumn[i]];
-                ValueType copy = temp;
+                // get a copy of the value
+                ValueType copy = *temp;
 
                 // and add to the old value, producing a new one
                 try {
-                    temp = copy + valueColumn[i];
-                    // if we got here, then it means that we ram out of RAM when we were trying
+                    *temp = copy + valueColumn[i];
+
+                    // if we got here, then it means that we ran out of RAM when we were trying
                     // to put the new value into the hash table
                 } catch (NotEnoughSpace& n) {
 
-                    // std :: cout << "not enough space in shuffle sink to update value" << std ::
-                    // endl;
                     // restore the old value
-                    temp = copy;
+                    *temp = copy;
 
                     // and erase all of the guys who were processed
                     keyColumn.erase(keyColumn.begin(), keyColumn.begin() + i);
@@ -154,6 +158,13 @@ public:
                     throw n;
                 }
             }
+            if (skew != nullptr) {
+                numTuples[whichPartition]++;
+            }
+        }
+
+        if (skew != nullptr) {
+            skew->addNumTuples(numTuples);
         }
     }
 
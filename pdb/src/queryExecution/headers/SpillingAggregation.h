@@ -0,0 +1,143 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef SPILLING_AGGREGATION_H
+#define SPILLING_AGGREGATION_H
+
+#include "DataProxy.h"
+#include "PDBLogger.h"
+#include "SimpleSingleTableQueryProcessor.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// the number of buckets the groups of a partition are split into when they do not fit in its
+// aggregation page; with 0, they are not spilled, and the results may not be fully aggregated
+#ifndef AGGREGATION_SPILL_FANOUT
+#define AGGREGATION_SPILL_FANOUT 16
+#endif
+
+// the number of levels of buckets, a bucket whose groups do not fit is split at the next level
+#ifndef AGGREGATION_SPILL_MAX_LEVEL
+#define AGGREGATION_SPILL_MAX_LEVEL 4
+#endif
+
+namespace pdb {
+
+class SpillingAggregation;
+typedef std::shared_ptr<SpillingAggregation> SpillingAggregationPtr;
+
+/*
+ * This class does a grace hash aggregation for the partition of an aggregation processor whose
+ * groups do not fit in its aggregation page. When the page is full, the processor spills the
+ * groups on it to numBuckets temp sets, by the hash of their keys, and goes on with the page
+ * empty. The temp sets are PartialAggregationData, so the storage evicts their pages before the
+ * ones of other temp sets. Once all of the input is in, the groups of every bucket are aggregated
+ * on their own; a bucket whose groups still do not fit is split again at the next level, with
+ * other bits of the hash, until maxLevel, after which the groups of the page are given out as
+ * they are, like an aggregation that does not spill.
+ */
+
+class SpillingAggregation {
+
+private:
+    // the temp set of a bucket, and its pages in the order they were written
+    struct SpillBucket {
+        bool isCreated;
+        SetID setId;
+        std::vector<PageID> pageIds;
+    };
+
+    SimpleSingleTableQueryProcessorPtr processor;
+    DataProxyPtr proxy;
+    PDBLoggerPtr logger;
+
+    // the temp sets are named after this
+    std::string setNamePrefix;
+    int numSetsCreated;
+
+    // the page the processor aggregates into
+    void* outputPage;
+    size_t pageSize;
+
+    int numBuckets;
+    int maxLevel;
+
+    // the buckets of every level
+    std::vector<std::vector<SpillBucket>> buckets;
+
+    // set if a group could not be spilled or read back, the results are then incomplete
+    bool failed;
+
+    // statistics
+    bool spilled;
+    long numPagesSpilled;
+    int deepestLevel;
+
+    // writes the groups in the output page to the buckets of a level, returns false if the storage
+    // failed us, or a group does not fit in a spill page
+    bool spillTo(int level);
+
+    // aggregates the groups of every bucket of a level into a page; freePage is a page we may use
+    // before we call getPage, and is set to nullptr once it is used
+    void aggregateLevel(int level,
+                        void*& freePage,
+                        std::function<void*()> getPage,
+                        std::function<void(void*)> emitPage);
+
+    // finalizes the groups in a page and gives it out
+    void emit(void* page, std::function<void(void*)> emitPage);
+
+    // removes the temp set of a bucket
+    void removeBucket(SpillBucket& bucket);
+
+public:
+    // the processor has to be initialized, and aggregate into pages of pageSize bytes
+    SpillingAggregation(SimpleSingleTableQueryProcessorPtr processor,
+                        DataProxyPtr proxy,
+                        std::string setNamePrefix,
+                        size_t pageSize,
+                        PDBLoggerPtr logger,
+                        int numBuckets = AGGREGATION_SPILL_FANOUT,
+                        int maxLevel = AGGREGATION_SPILL_MAX_LEVEL);
+
+    // removes the temp sets left
+    ~SpillingAggregation();
+
+    // to be called when fillNextOutputPage returns true: spills the groups in the output page of
+    // the processor and loads it again, empty, so that fillNextOutputPage can be called again.
+    // Returns false if they can't be spilled, then the page is as it was
+    bool spill(void* outputPage);
+
+    // true if something was spilled, then the results come from aggregateSpilled
+    bool hasSpilled();
+
+    // true if a group did not fit in an empty spill page, a spilled page could not be read back,
+    // or a bucket could not be split any more; the results can't be complete then, and the stage
+    // has to fail
+    bool hasFailed();
+
+    // to be called when all of the input is in: spills the groups left in the output page, and
+    // aggregates the groups of every bucket into a page it gives to emitPage, finalized.  getPage
+    // gives a page of pageSize bytes to aggregate into, when the output page was given out already
+    void aggregateSpilled(std::function<void*()> getPage, std::function<void(void*)> emitPage);
+};
+}
+
+#endif
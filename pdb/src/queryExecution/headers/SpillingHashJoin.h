@@ -0,0 +1,192 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef SPILLING_HASH_JOIN_H
+#define SPILLING_HASH_JOIN_H
+
+#include "DataProxy.h"
+#include "PDBLogger.h"
+#include "PageCircularBuffer.h"
+#include "Ptr.h"
+#include "RecordIterator.h"
+#include "SinkMerger.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// the most bytes of the build side of a partition that are written at a time before they are
+// appended to a page of its temp set, so that the partitions that spill do not take a page each
+#ifndef JOIN_SPILL_BUFFER_SIZE
+#define JOIN_SPILL_BUFFER_SIZE (16 * 1024 * 1024)
+#endif
+
+namespace pdb {
+
+class SpillingHashJoin;
+typedef std::shared_ptr<SpillingHashJoin> SpillingHashJoinPtr;
+
+/*
+ * This class makes the hash partitioned join a hybrid hash join. The build side of a partition is
+ * merged into its hash table in the PartitionedHashSet as long as it fits; a partition that has no
+ * hash table, because the memory ran out, or whose hash table is full, spills the rest of its
+ * build side to a temp set, and what is in its hash table stays there. When the probe side is
+ * scanned, the maps of the partitions that spilled go to temp sets as well, besides being probed
+ * against what is in memory. In a second pass, the spilled build side of every such partition is
+ * built into a hash table, as many times as it takes if it does not fit in one, and the spilled
+ * probe side is joined with it. The temp sets are HashPartitionData.
+ *
+ * A partition is only touched by one thread at a time: its build thread, then the thread that
+ * scans the probe side, then the thread of the second pass.
+ */
+
+class SpillingHashJoin {
+
+private:
+    // the temp set of one side of a partition, its pages in the order they were written, and the
+    // page being written
+    struct SpillSide {
+        bool isCreated;
+        SetID setId;
+        std::vector<PageID> pageIds;
+        PDBPagePtr curPage;
+    };
+
+    struct SpillPartition {
+        // whether some of the build side is in the hash table, and whether some is spilled
+        bool isResident;
+        bool isSpilled;
+
+        // merges the build side of this partition
+        SinkMergerPtr merger;
+
+        SpillSide build;
+        SpillSide probe;
+
+        // the build side is written here before it is appended to a page of its temp set
+        void* scratchPage;
+        size_t scratchPageSize;
+
+        // the spilled build side being read in the second pass
+        size_t nextBuildPage;
+        PDBPagePtr buildPage;
+        RecordIteratorPtr buildRecords;
+        bool isMerging;
+    };
+
+    std::string setNamePrefix;
+    PDBLoggerPtr logger;
+    std::vector<SpillPartition> partitions;
+
+    // the probe side is written here before it is appended to a page of a temp set
+    void* probeScratchPage;
+    size_t probeScratchPageSize;
+
+    // the name of the temp set of a side of a partition
+    std::string getSetName(int partitionId, std::string side);
+
+    // adds a page to a temp set, and creates the set first if need be
+    bool addPage(SpillSide& side, std::string setName, DataProxyPtr proxy);
+
+    // unpins the page being written of a temp set
+    void closePage(SpillSide& side, DataProxyPtr proxy);
+
+    // removes a temp set
+    void removeSide(SpillSide& side, DataProxyPtr proxy);
+
+    // appends a record to the page being written of a temp set, and adds a page when it is full
+    bool appendRecord(SpillSide& side,
+                      std::string setName,
+                      Record<Object>* record,
+                      DataProxyPtr proxy);
+
+    // gives a scratch page as large as the largest record a page of a temp set can take, or
+    // maxSize bytes if it is less
+    void* getScratchPage(size_t maxSize,
+                         void*& scratchPage,
+                         size_t& scratchPageSize,
+                         SpillSide& side,
+                         std::string setName,
+                         DataProxyPtr proxy);
+
+public:
+    // the temp sets are named after setNamePrefix
+    SpillingHashJoin(std::string setNamePrefix, int numPartitions, PDBLoggerPtr logger);
+
+    // frees the scratch pages; the temp sets are removed by removeSpilled
+    ~SpillingHashJoin();
+
+    // to be called by the build thread of a partition before it merges anything: the merger
+    // merges the build side of the partition, and isResident tells if it has a hash table
+    void startBuild(int partitionId, SinkMergerPtr merger, bool isResident);
+
+    // merges the maps of the partition in a vector of JoinMaps into its hash table, and spills
+    // those that do not fit. Returns false if the storage failed us, or if the merger did
+    bool addBuildMaps(int partitionId,
+                      Handle<Object> maps,
+                      Handle<Object>& hashTable,
+                      DataProxyPtr proxy);
+
+    // to be called by the build thread of a partition once all of its build side is in
+    void finishBuild(int partitionId, DataProxyPtr proxy);
+
+    // whether a partition has a hash table in memory with some of its build side
+    bool isResident(int partitionId);
+
+    // whether some of the build side of a partition is spilled
+    bool isSpilled(int partitionId);
+
+    // whether any partition spilled, then the join needs a second pass
+    bool hasSpilled();
+
+    // the partitions that spilled
+    std::vector<int> getSpilledPartitions();
+
+    // whether the merger of a partition failed, as some of its build side fits neither in a hash
+    // table nor in a spill page; then the join has to fail, or it loses rows
+    bool hasFailed();
+
+    // copies the maps of the partitions that spilled in a page of the probe side to their temp
+    // sets; to be called by the thread that scans the probe side. Returns false if the storage
+    // failed us
+    bool spillProbePage(PDBPagePtr page, DataProxyPtr proxy);
+
+    // to be called by the thread that scans the probe side once it is done
+    void finishProbeSpill(DataProxyPtr proxy);
+
+    // builds the next part of the spilled build side of a partition that fits into a hash table in
+    // a page of pageSize bytes, for the second pass. Returns true if it was the last part, or if
+    // the merger failed, then hasFailed tells
+    bool buildSpilled(int partitionId, void* page, size_t pageSize, DataProxyPtr proxy);
+
+    // pins the pages of the spilled probe side of a partition one after the other and gives them
+    // to a buffer, which is then closed; whoever takes them from the buffer unpins them
+    void feedProbePages(int partitionId, PageCircularBufferPtr buffer, DataProxyPtr proxy);
+
+    // removes the temp sets of a partition, once its second pass is over
+    void removeSpilled(int partitionId, DataProxyPtr proxy);
+
+    // copies the maps of a partition in a vector of JoinMaps, of any type, to a vector in a block
+    // of numBytes bytes. Returns nullptr if there are none
+    static Record<Object>* copyPartitionMaps(Record<Object>* maps,
+                                             int partitionId,
+                                             void* block,
+                                             size_t numBytes);
+};
+}
+
+#endif
@@ -0,0 +1,271 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef BULK_LOADER_CC
+#define BULK_LOADER_CC
+
+#include "PDBDebug.h"
+#include "BulkLoader.h"
+#include "DataTypes.h"
+#include "DispatcherAddPages.h"
+#include "GenericWork.h"
+#include "GetListOfNodes.h"
+#include "ListOfNodes.h"
+#include "SimpleRequestResult.h"
+#include "InterfaceFunctions.h"
+#include "UseTemporaryAllocationBlock.h"
+#include <algorithm>
+#include <atomic>
+
+namespace pdb {
+
+PDBWorkerQueuePtr BulkLoader::workers = nullptr;
+
+BulkLoader::BulkLoader(
+    PDBLoggerPtr logger, int port, std::string address, int numThreads, int numCredits) {
+    this->logger = logger;
+    this->port = port;
+    this->address = address;
+    this->numThreads = (numThreads < 1) ? 1 : numThreads;
+    this->numCredits = numCredits;
+    this->numPagesSent = 0;
+    this->numBytesSent = 0;
+    this->numObjectsSent = 0;
+}
+
+bool BulkLoader::getWorkers(std::vector<std::string>& workers, std::string& errMsg) {
+    PDBCommunicatorPtr communicator = std::make_shared<PDBCommunicator>();
+    if (communicator->connectToInternetServer(this->logger, this->port, this->address, errMsg)) {
+        return false;
+    }
+    const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+    Handle<GetListOfNodes> request = makeObject<GetListOfNodes>();
+    if (communicator->sendObject(request, errMsg) == false) {
+        return false;
+    }
+    bool success;
+    Handle<ListOfNodes> nodes = communicator->getNextObject<ListOfNodes>(success, errMsg);
+    if ((success == false) || (nodes == nullptr) || (nodes->getHostNames() == nullptr)) {
+        errMsg = "BulkLoader: can't get the workers from the manager: " + errMsg;
+        return false;
+    }
+    Handle<Vector<String>> hostNames = nodes->getHostNames();
+    for (int i = 0; i < hostNames->size(); i++) {
+        workers.push_back(static_cast<std::string>((*hostNames)[i]));
+    }
+    return true;
+}
+
+bool BulkLoader::checkSet(std::string databaseName,
+                          std::string setName,
+                          std::string typeName,
+                          std::string& errMsg) {
+    PDBCommunicatorPtr communicator = std::make_shared<PDBCommunicator>();
+    if (communicator->connectToInternetServer(this->logger, this->port, this->address, errMsg)) {
+        return false;
+    }
+    const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+    Handle<DispatcherAddPages> request =
+        makeObject<DispatcherAddPages>(databaseName, setName, typeName, 0, 0);
+    if (communicator->sendObject(request, errMsg) == false) {
+        return false;
+    }
+    bool success;
+    Handle<SimpleRequestResult> result =
+        communicator->getNextObject<SimpleRequestResult>(success, errMsg);
+    if ((success == false) || (result == nullptr)) {
+        errMsg = "BulkLoader: can't check set " + setName + " with the manager: " + errMsg;
+        return false;
+    }
+    if (result->getRes().first == false) {
+        errMsg = "BulkLoader: the manager does not load objects of type " + typeName +
+            " into set " + setName + ": " + result->getRes().second;
+        return false;
+    }
+    return true;
+}
+
+bool BulkLoader::load(std::string databaseName,
+                      std::string setName,
+                      std::string typeName,
+                      BulkLoadFiller filler,
+                      size_t pageSize,
+                      std::string& errMsg) {
+
+    // no page is made before the manager has accepted the set and the type
+    if (checkSet(databaseName, setName, typeName, errMsg) == false) {
+        this->logger->error(errMsg);
+        return false;
+    }
+
+    std::vector<std::string> nodes;
+    if (getWorkers(nodes, errMsg) == false) {
+        this->logger->error(errMsg);
+        return false;
+    }
+    if (nodes.empty()) {
+        errMsg = "BulkLoader: there are no workers to load set " + setName + " to";
+        this->logger->error(errMsg);
+        return false;
+    }
+
+    // the storage server puts its own header in front of the bytes of a page
+    size_t pageHeaderSize = sizeof(NodeID) + sizeof(DatabaseID) + sizeof(UserTypeID) +
+        sizeof(SetID) + sizeof(PageID) + sizeof(int) + sizeof(size_t);
+    if (pageSize <= pageHeaderSize) {
+        errMsg = "BulkLoader: pages of " + std::to_string(pageSize) + " bytes are too small";
+        this->logger->error(errMsg);
+        return false;
+    }
+    size_t numPageBytes = pageSize - pageHeaderSize;
+
+    // a channel per worker, shared by the threads
+    std::vector<ShuffleChannelPtr> channels;
+    for (std::string& node : nodes) {
+        std::string nodeAddress = node;
+        int nodePort = 8108;
+        size_t pos = node.find(":");
+        if (pos != std::string::npos) {
+            nodeAddress = node.substr(0, pos);
+            nodePort = stoi(node.substr(pos + 1));
+        }
+        channels.push_back(std::make_shared<ShuffleChannel>(
+            this->logger, nodeAddress, nodePort, databaseName, setName, true, this->numCredits));
+    }
+
+    if (BulkLoader::workers == nullptr) {
+        BulkLoader::workers = std::make_shared<PDBWorkerQueue>(
+            this->logger, std::max(this->numThreads, BULK_LOAD_THREADS));
+    }
+
+    // the next page goes to this worker
+    std::atomic<long> nextNode(0);
+    std::atomic<bool> failed(false);
+    std::atomic<size_t> numObjects(0);
+    pthread_mutex_t errMutex;
+    pthread_mutex_init(&errMutex, nullptr);
+
+    PDBBuzzerPtr tempBuzzer =
+        make_shared<PDBBuzzer>([&](PDBAlarm myAlarm, int& counter) { counter++; });
+    int counter = 0;
+    for (int i = 0; i < this->numThreads; i++) {
+        PDBWorkerPtr worker = BulkLoader::workers->getWorker();
+        PDBWorkPtr myWork = make_shared<GenericWork>([&, i](PDBBuzzerPtr callerBuzzer) {
+            std::string myErrMsg;
+            char* page = (char*)malloc(numPageBytes);
+            if (page == nullptr) {
+                myErrMsg = "BulkLoader: can't allocate a page of " +
+                    std::to_string(numPageBytes) + " bytes";
+            }
+            bool more = (page != nullptr);
+            while (more && (failed == false)) {
+                size_t numBytes = 0;
+                {
+                    const UseTemporaryAllocationBlock tempBlock{page, numPageBytes};
+                    Handle<Vector<Handle<Object>>> objects = nullptr;
+                    bool full = false;
+                    try {
+                        objects = makeObject<Vector<Handle<Object>>>();
+                        if (objects != nullptr) {
+                            more = filler(i, objects);
+                        }
+                    } catch (NotEnoughSpace& e) {
+                        full = true;
+                    }
+                    if (objects == nullptr) {
+                        myErrMsg = "BulkLoader: can't make a vector on a page";
+                        break;
+                    }
+                    if (objects->size() == 0) {
+                        if (full) {
+                            myErrMsg = "BulkLoader: an object does not fit in a page of " +
+                                std::to_string(numPageBytes) + " bytes";
+                            break;
+                        }
+                        continue;
+                    }
+                    numBytes = getRecord(objects)->numBytes();
+                    numObjects += objects->size();
+                }
+
+                // the channel encodes the page before it returns, so the page can be filled again
+                ShuffleChannelPtr channel = channels[(nextNode++) % channels.size()];
+                if (channel->sendPage(page, numBytes, myErrMsg) == false) {
+                    myErrMsg = "BulkLoader: can't send a page: " + myErrMsg;
+                    break;
+                }
+            }
+            free(page);
+            if (myErrMsg != "") {
+                failed = true;
+                pthread_mutex_lock(&errMutex);
+                errMsg = myErrMsg;
+                pthread_mutex_unlock(&errMutex);
+            }
+            callerBuzzer->buzz(PDBAlarm::WorkAllDone, counter);
+        });
+        worker->execute(myWork, tempBuzzer);
+    }
+    while (counter < this->numThreads) {
+        tempBuzzer->wait();
+    }
+    pthread_mutex_destroy(&errMutex);
+
+    // wait for every page to be stored
+    bool success = (failed == false);
+    this->numPagesSent = 0;
+    this->numBytesSent = 0;
+    this->codecStats = PageCodecStats();
+    for (ShuffleChannelPtr& channel : channels) {
+        std::string closeErrMsg;
+        if ((channel->close(closeErrMsg) == false) && success) {
+            errMsg = "BulkLoader: a worker did not store its pages: " + closeErrMsg;
+            success = false;
+        }
+        this->numPagesSent += channel->getNumPagesSent();
+        this->codecStats.add(channel->getCodecStats());
+    }
+    this->numBytesSent = this->codecStats.numBytesIn;
+    this->numObjectsSent = numObjects;
+    if (success == false) {
+        this->logger->error(errMsg);
+    }
+    PDB_COUT << "BulkLoader: sent " << this->numPagesSent << " pages with " << this->numBytesSent
+             << " bytes to set " << setName << " on " << nodes.size() << " workers with "
+             << this->numThreads << " threads: " << this->codecStats.toString() << std::endl;
+    return success;
+}
+
+long BulkLoader::getNumPagesSent() {
+    return this->numPagesSent;
+}
+
+size_t BulkLoader::getNumBytesSent() {
+    return this->numBytesSent;
+}
+
+size_t BulkLoader::getNumObjectsSent() {
+    return this->numObjectsSent;
+}
+
+const PageCodecStats& BulkLoader::getCodecStats() {
+    return this->codecStats;
+}
+}
+
+#endif
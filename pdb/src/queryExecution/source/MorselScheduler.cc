@@ -0,0 +1,268 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef MORSEL_SCHEDULER_CC
+#define MORSEL_SCHEDULER_CC
+
+#include "PDBDebug.h"
+#include "MorselScheduler.h"
+#include <algorithm>
+#include <sched.h>
+
+namespace pdb {
+
+MorselScheduler::MorselScheduler(std::vector<PageIteratorPtr> iterators,
+                                 int numWorkers,
+                                 size_t morselSize,
+                                 pdb::PDBLoggerPtr logger)
+    : iterators(iterators), iteratorMutexes(iterators.size()) {
+    this->exhausted.reset(new std::atomic<bool>[iterators.size()]);
+    for (int i = 0; i < iterators.size(); i++) {
+        pthread_mutex_init(&(this->iteratorMutexes[i]), nullptr);
+        this->exhausted[i] = false;
+    }
+    if (numWorkers < 1) {
+        numWorkers = 1;
+    }
+    for (int i = 0; i < numWorkers; i++) {
+        MorselQueue* queue = new MorselQueue;
+        pthread_mutex_init(&(queue->mutex), nullptr);
+        queue->size = 0;
+        this->queues.push_back(queue);
+    }
+    this->numQueued = 0;
+    this->numSplitting = 0;
+    this->morselSize = morselSize;
+    this->numActiveWorkers = numWorkers;
+    this->finished = false;
+    this->numMorsels = 0;
+    this->numSteals = 0;
+    this->logger = logger;
+    pthread_mutex_init(&(this->parkMutex), nullptr);
+    pthread_cond_init(&(this->parkCond), nullptr);
+}
+
+MorselScheduler::~MorselScheduler() {
+    for (MorselQueue* queue : this->queues) {
+        pthread_mutex_destroy(&(queue->mutex));
+        delete queue;
+    }
+    for (int i = 0; i < this->iteratorMutexes.size(); i++) {
+        pthread_mutex_destroy(&(this->iteratorMutexes[i]));
+    }
+    pthread_mutex_destroy(&(this->parkMutex));
+    pthread_cond_destroy(&(this->parkCond));
+}
+
+bool MorselScheduler::popMorsel(int workerId, Morsel& morsel) {
+    MorselQueue* queue = this->queues[workerId];
+    if (queue->size.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    bool popped = false;
+    pthread_mutex_lock(&(queue->mutex));
+    if (queue->morsels.empty() == false) {
+        morsel = queue->morsels.front();
+        queue->morsels.pop_front();
+        queue->size = queue->morsels.size();
+        popped = true;
+    }
+    pthread_mutex_unlock(&(queue->mutex));
+    if (popped) {
+        this->numQueued--;
+    }
+    return popped;
+}
+
+bool MorselScheduler::stealMorsels(int workerId, Morsel& morsel) {
+    int numWorkers = this->queues.size();
+    for (int i = 1; i < numWorkers; i++) {
+        MorselQueue* victim = this->queues[(workerId + i) % numWorkers];
+        if (victim->size.load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+
+        // take the back half of the queue, those are the morsels the owner would get to last
+        std::vector<Morsel> stolen;
+        pthread_mutex_lock(&(victim->mutex));
+        size_t numToSteal = (victim->morsels.size() + 1) / 2;
+        for (size_t j = 0; j < numToSteal; j++) {
+            stolen.push_back(victim->morsels.back());
+            victim->morsels.pop_back();
+        }
+        victim->size = victim->morsels.size();
+        pthread_mutex_unlock(&(victim->mutex));
+        if (stolen.empty()) {
+            continue;
+        }
+
+        // process the stolen morsels in order, the first one now and the others from our queue
+        morsel = stolen.back();
+        stolen.pop_back();
+        if (stolen.empty() == false) {
+            MorselQueue* queue = this->queues[workerId];
+            pthread_mutex_lock(&(queue->mutex));
+            for (auto it = stolen.rbegin(); it != stolen.rend(); ++it) {
+                queue->morsels.push_back(*it);
+            }
+            queue->size = queue->morsels.size();
+            pthread_mutex_unlock(&(queue->mutex));
+        }
+        this->numQueued--;
+        this->numSteals++;
+        return true;
+    }
+    return false;
+}
+
+bool MorselScheduler::splitNextPage(int workerId, Morsel& morsel) {
+    int numIterators = this->iterators.size();
+    for (int i = 0; i < numIterators; i++) {
+        int which = (workerId + i) % numIterators;
+        while (this->exhausted[which] == false) {
+
+            // read a page, the iterator may block until the page is there
+            this->numSplitting++;
+            PDBPagePtr page = nullptr;
+            pthread_mutex_lock(&(this->iteratorMutexes[which]));
+            if (this->iterators[which]->hasNext()) {
+                page = this->iterators[which]->next();
+            } else {
+                this->exhausted[which] = true;
+            }
+            pthread_mutex_unlock(&(this->iteratorMutexes[which]));
+            if (page == nullptr) {
+                this->numSplitting--;
+                continue;
+            }
+
+            // split the page, an empty page still gets one (empty) morsel so that it is released
+            void* bytes = page->getBytes();
+            size_t numObjects = ((Record<Vector<Handle<Object>>>*)bytes)->getRootObject()->size();
+            size_t size = (this->morselSize == 0) ? numObjects : this->morselSize;
+            int numPageMorsels = (numObjects == 0) ? 1 : (numObjects + size - 1) / size;
+            MorselPage* owner = new MorselPage;
+            owner->numUnfinished = numPageMorsels;
+            morsel.page = bytes;
+            morsel.begin = 0;
+            morsel.end = std::min(size, numObjects);
+            morsel.owner = owner;
+            if (numPageMorsels > 1) {
+                MorselQueue* queue = this->queues[workerId];
+                pthread_mutex_lock(&(queue->mutex));
+                for (size_t begin = size; begin < numObjects; begin += size) {
+                    Morsel next;
+                    next.page = bytes;
+                    next.begin = begin;
+                    next.end = std::min(begin + size, numObjects);
+                    next.owner = owner;
+                    queue->morsels.push_back(next);
+                }
+                queue->size = queue->morsels.size();
+                pthread_mutex_unlock(&(queue->mutex));
+                this->numQueued += numPageMorsels - 1;
+            }
+            this->numSplitting--;
+            PDB_COUT << "MorselScheduler: worker " << workerId << " split a page of " << numObjects
+                     << " objects into " << numPageMorsels << " morsels" << std::endl;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MorselScheduler::waitUntilActive(int workerId) {
+    pthread_mutex_lock(&(this->parkMutex));
+    while ((workerId >= this->numActiveWorkers) && (this->finished == false)) {
+        pthread_cond_wait(&(this->parkCond), &(this->parkMutex));
+    }
+    bool active = (this->finished == false);
+    pthread_mutex_unlock(&(this->parkMutex));
+    return active;
+}
+
+bool MorselScheduler::getNextMorsel(int workerId, Morsel& morsel) {
+    workerId = workerId % this->queues.size();
+    while (true) {
+
+        // a thread that is not needed right now parks, its queue is emptied by the others
+        if ((workerId >= this->numActiveWorkers) && (waitUntilActive(workerId) == false)) {
+            return false;
+        }
+
+        // our own morsels first, then the morsels of a busy thread, then a new page
+        if (popMorsel(workerId, morsel) || stealMorsels(workerId, morsel) ||
+            splitNextPage(workerId, morsel)) {
+            this->numMorsels++;
+            return true;
+        }
+
+        // all of the pages are read, we are done once the last ones are split and taken
+        if ((this->numQueued == 0) && (this->numSplitting == 0)) {
+            pthread_mutex_lock(&(this->parkMutex));
+            this->finished = true;
+            pthread_cond_broadcast(&(this->parkCond));
+            pthread_mutex_unlock(&(this->parkMutex));
+            return false;
+        }
+        sched_yield();
+    }
+}
+
+bool MorselScheduler::finishMorsel(Morsel& morsel) {
+    MorselPage* owner = (MorselPage*)morsel.owner;
+    if (owner->numUnfinished.fetch_sub(1) == 1) {
+        delete owner;
+        return true;
+    }
+    return false;
+}
+
+void MorselScheduler::setNumActiveWorkers(int numActiveWorkers) {
+    if (numActiveWorkers < 1) {
+        numActiveWorkers = 1;
+    }
+    if (numActiveWorkers > this->queues.size()) {
+        numActiveWorkers = this->queues.size();
+    }
+    pthread_mutex_lock(&(this->parkMutex));
+    this->numActiveWorkers = numActiveWorkers;
+    pthread_cond_broadcast(&(this->parkCond));
+    pthread_mutex_unlock(&(this->parkMutex));
+    this->logger->info(std::string("MorselScheduler: ") + std::to_string(numActiveWorkers) +
+                       " threads take morsels");
+}
+
+int MorselScheduler::getNumActiveWorkers() {
+    return this->numActiveWorkers;
+}
+
+int MorselScheduler::getNumWorkers() {
+    return this->queues.size();
+}
+
+long MorselScheduler::getNumMorsels() {
+    return this->numMorsels;
+}
+
+long MorselScheduler::getNumSteals() {
+    return this->numSteals;
+}
+}
+
+#endif
@@ -46,9 +46,8 @@
 #include "SimpleSendBytesRequest.h"
 #include "ShuffleSink.h"
 #include "PartitionComp.h"
-#ifdef ENABLE_COMPRESSION
-#include <snappy.h>
-#endif
+#include "ShuffleChannel.h"
+#include "RuntimeFilterExecutor.h"
 #include <fstream>
 
 
@@ -56,6 +55,8 @@ namespace pdb {
 
 PipelineStage::~PipelineStage() {
     this->jobStage = nullptr;
+    pthread_mutex_destroy(&(this->transferStatsMutex));
+    pthread_mutex_destroy(&(this->failureMutex));
 }
 
 PipelineStage::PipelineStage(Handle<TupleSetJobStage> stage,
@@ -73,6 +74,11 @@ PipelineStage::PipelineStage(Handle<TupleSetJobStage> stage,
     this->conf = conf;
     this->shm = shm;
     this->id = 0;
+    this->morselScheduler = nullptr;
+    this->shuffleSkew = nullptr;
+    pthread_mutex_init(&(this->transferStatsMutex), nullptr);
+    this->failed = false;
+    pthread_mutex_init(&(this->failureMutex), nullptr);
     int numNodes = this->jobStage->getNumNodes();
     for (int i = 0; i < numNodes; i++) {
         nodeIds.push_back(i);
@@ -89,6 +95,88 @@ int PipelineStage::getNumThreads() {
     return this->numThreads;
 }
 
+
+PageCodecPtr PipelineStage::createPageCodec() {
+    return make_shared<PageCodec>(conf->getTransferCodec(), conf->getNetworkBandwidth());
+}
+
+
+void PipelineStage::addTransferStats(const PageCodecStats& stats) {
+    pthread_mutex_lock(&(this->transferStatsMutex));
+    this->transferStats.add(stats);
+    pthread_mutex_unlock(&(this->transferStatsMutex));
+}
+
+
+PageCodecStats PipelineStage::getTransferStats() {
+    pthread_mutex_lock(&(this->transferStatsMutex));
+    PageCodecStats stats = this->transferStats;
+    pthread_mutex_unlock(&(this->transferStatsMutex));
+    return stats;
+}
+
+
+void PipelineStage::createShuffleSkew() {
+    this->shuffleSkew = nullptr;
+    if ((this->jobStage->isRepartition() == false) || this->jobStage->isBroadcasting()) {
+        return;
+    }
+    int numNodes = this->jobStage->getNumNodes();
+    int numPartitionsInCluster = this->jobStage->getNumTotalPartitions();
+    if (this->jobStage->isRepartitionJoin()) {
+        if (this->jobStage->isLocalRepartition()) {
+            // the partitions of this node only, and the keys are not split
+            int numPartitions =
+                this->jobStage->getNumPartitions(this->jobStage->getNodeId())->size();
+            this->shuffleSkew = make_shared<ShuffleSkew>(numPartitions, 1, false);
+            return;
+        }
+        bool isSplitting = this->jobStage->isSplittingHeavyKeys();
+#ifdef NO_MOD_PARTITION
+        isSplitting = false;
+#endif
+        this->shuffleSkew = make_shared<ShuffleSkew>(
+            (numPartitionsInCluster / numNodes) * numNodes, numNodes, isSplitting);
+        if (this->jobStage->getSplitKeys() != nullptr) {
+            this->shuffleSkew->setSplitKeys(*(this->jobStage->getSplitKeys()));
+        }
+    } else if (this->jobStage->getTargetComputationSpecifier().find("ClusterAggregationComp") !=
+               std::string::npos) {
+        // the sink of the combiner hashes over all of the partitions, the other one over the
+        // partitions of every node
+        if (this->jobStage->isCombining() == false) {
+            numPartitionsInCluster = (numPartitionsInCluster / numNodes) * numNodes;
+        }
+        this->shuffleSkew = make_shared<ShuffleSkew>(numPartitionsInCluster, numNodes, false);
+    }
+}
+
+
+ShuffleSkewPtr PipelineStage::getShuffleSkew() {
+    return this->shuffleSkew;
+}
+
+
+void PipelineStage::setFailed(std::string errMsg) {
+    pthread_mutex_lock(&(this->failureMutex));
+    if (this->failed == false) {
+        this->failed = true;
+        this->failure = errMsg;
+    }
+    pthread_mutex_unlock(&(this->failureMutex));
+}
+
+
+bool PipelineStage::hasFailed(std::string& errMsg) {
+    pthread_mutex_lock(&(this->failureMutex));
+    bool hasFailed = this->failed;
+    if (hasFailed) {
+        errMsg = this->failure;
+    }
+    pthread_mutex_unlock(&(this->failureMutex));
+    return hasFailed;
+}
+
 // send repartitioned data to a remote node
 bool PipelineStage::storeShuffleData(Handle<Vector<Handle<Object>>> data,
                                      std::string databaseName,
@@ -183,17 +271,9 @@ bool PipelineStage::sendData(PDBCommunicatorPtr conn,
         Handle<StorageAddObjectInLoop> request = makeObject<StorageAddObjectInLoop>(
             databaseName, setName, "IntermediateData", false, false);
         conn->sendObject(request, errMsg);
-#ifdef ENABLE_COMPRESSION
-        char* compressedBytes = new char[snappy::MaxCompressedLength(size)];
-        size_t compressedSize;
-        snappy::RawCompress((char*)data, size, compressedBytes, &compressedSize);
-        std::cout << "size before compression is " << size << " and size after compression is "
-                  << compressedSize << std::endl;
-        conn->sendBytes(compressedBytes, compressedSize, errMsg);
-        delete[] compressedBytes;
-#else
-        conn->sendBytes(data, size, errMsg);
-#endif
+        PageCodecPtr codec = createPageCodec();
+        codec->send(conn, data, size, errMsg);
+        addTransferStats(codec->getStats());
 #ifdef DEBUG_SHUFFLING
         // write the data to a test file
         std::string fileName1 =
@@ -346,7 +426,8 @@ void PipelineStage::executePipelineWork(int i,
                                         DataProxyPtr proxy,
                                         std::vector<PageCircularBufferPtr>& sinkBuffers,
                                         HermesExecutionServer* server,
-                                        std::string& errMsg) {
+                                        std::string& errMsg,
+                                        void* hashTable) {
 
 #ifdef REUSE_CONNECTION_FOR_AGG_NO_COMBINER
     // connections
@@ -446,6 +527,7 @@ void PipelineStage::executePipelineWork(int i,
         if (scanner != nullptr) {
             scanner->setIterator(iterators.at(i));
             scanner->setProxy(proxy);
+            scanner->setMorselScheduler(this->morselScheduler, i);
             if ((scanner->getBatchSize() <= 0) || (scanner->getBatchSize() > 100)) {
                 scanner->setBatchSize(batchSize);
             }
@@ -482,6 +564,9 @@ void PipelineStage::executePipelineWork(int i,
 
     // handle probing
     std::map<std::string, ComputeInfoPtr> info;
+    if (this->shuffleSkew != nullptr) {
+        info[ShuffleSkew::getParamName()] = this->shuffleSkew;
+    }
     if ((this->jobStage->isProbing() == true) && (this->jobStage->getHashSets() != nullptr)) {
         Handle<Map<String, String>> hashSetsToProbe = this->jobStage->getHashSets();
         for (PDBMapIterator<String, String> mapIter = hashSetsToProbe->begin();
@@ -499,10 +584,33 @@ void PipelineStage::executePipelineWork(int i,
             if (hashSet->getHashSetType() == "SharedHashSet") {
                 SharedHashSetPtr sharedHashSet = std::dynamic_pointer_cast<SharedHashSet>(hashSet);
                 info[key] = std::make_shared<JoinArg>(*newPlan, sharedHashSet->getPage());
+                // the side of the join hashed in this pipeline is filtered by the keys of the
+                // broadcasted side
+                if (!sharedHashSet->getRuntimeFilters().empty()) {
+                    AtomicComputationPtr joinComp =
+                        newPlan->getPlan()->getComputations().getProducingAtomicComputation(key);
+                    if ((joinComp != nullptr) &&
+                        (joinComp->getAtomicComputationType() == "JoinSets")) {
+                        std::string leftName = joinComp->getInput().getSetName();
+                        std::string rightName = ((ApplyJoin*)joinComp.get())->getRightInput()
+                            .getSetName();
+                        for (std::string& name : buildTheseTupleSets) {
+                            if ((name == leftName) || (name == rightName)) {
+                                info[RuntimeFilterArg::getParamName(name)] =
+                                    std::make_shared<RuntimeFilterArg>(
+                                        sharedHashSet->getRuntimeFilters());
+                            }
+                        }
+                    }
+                }
             } else if (hashSet->getHashSetType() == "PartitionedHashSet") {
                 PartitionedHashSetPtr partitionedHashSet =
                     std::dynamic_pointer_cast<PartitionedHashSet>(hashSet);
-                info[key] = std::make_shared<JoinArg>(*newPlan, partitionedHashSet->getPage(i));
+                void* hashTableToProbe = hashTable;
+                if (hashTableToProbe == nullptr) {
+                    hashTableToProbe = partitionedHashSet->getPage(i);
+                }
+                info[key] = std::make_shared<JoinArg>(*newPlan, hashTableToProbe);
             }
         }
     } else {
@@ -529,6 +637,27 @@ void PipelineStage::executePipelineWork(int i,
     std::cout << "target computation: " << this->jobStage->getTargetComputationSpecifier()
              << std::endl;
 
+#ifndef NO_MOD_PARTITION
+    // the hashes of a hash partitioned join are filtered by the keys of the other side, before
+    // they are shuffled; there is a filter for every partition in the cluster, in node order
+    if ((this->jobStage->getRuntimeFilters() != nullptr) &&
+        (this->jobStage->isLocalRepartition() == false)) {
+        std::vector<BlockedBloomFilterPtr> filters;
+        int numNodes = this->jobStage->getNumNodes();
+        size_t numPartitionsInCluster =
+            (size_t)(this->jobStage->getNumTotalPartitions() / numNodes) * numNodes;
+        if (BlockedBloomFilter::readFrom(*(this->jobStage->getRuntimeFilters()), filters) &&
+            (filters.size() == numPartitionsInCluster)) {
+            info[RuntimeFilterArg::getParamName(this->jobStage->getTargetTupleSetSpecifier())] =
+                std::make_shared<RuntimeFilterArg>(filters);
+        } else {
+            std::cout << "WARNING: the runtime filters of "
+                      << this->jobStage->getRuntimeFilterHashSet()
+                      << " do not match the partitions, they are not used" << std::endl;
+        }
+    }
+#endif
+
     Handle<JoinComp<Object, Object, Object>> join = nullptr;
     std::string targetSpecifier = jobStage->getTargetComputationSpecifier();
     if (targetSpecifier.find("ClusterAggregationComp") != std::string::npos) {
@@ -545,8 +674,16 @@ void PipelineStage::executePipelineWork(int i,
         Handle<Computation> joinComputation =
             newPlan->getPlan()->getNode(targetSpecifier).getComputationHandle();
         join = unsafeCast<JoinComp<Object, Object, Object>, Computation>(joinComputation);
-        join->setNumPartitions(this->jobStage->getNumTotalPartitions());
-        join->setNumNodes(this->jobStage->getNumNodes());
+        if (this->jobStage->isLocalRepartition()) {
+            // the sides of the join are co-partitioned, the maps are for the partitions of this
+            // node only
+            join->setNumPartitions(
+                this->jobStage->getNumPartitions(this->jobStage->getNodeId())->size());
+            join->setNumNodes(1);
+        } else {
+            join->setNumPartitions(this->jobStage->getNumTotalPartitions());
+            join->setNumNodes(this->jobStage->getNumNodes());
+        }
         std::cout << "Join set to have " << join->getNumPartitions() << " partitions" << std::endl;
         std::cout << "Join set to have " << join->getNumNodes() << " nodes" << std::endl;
     } else if (targetSpecifier.find("PartitionComp") != std::string::npos) {
@@ -721,12 +858,18 @@ void PipelineStage::executePipelineWork(int i,
                             0);
                         int numNodes = jobStage->getNumNodes();
                         int k;
-                        for (k = 0; k < numNodes; k++) {
+                        if (jobStage->isLocalRepartition()) {
+                            // all the maps are for this node
                             pageToSend->incRefCount();
-                        }
-                        for (k = 0; k < numNodes; k++) {
-                            PageCircularBufferPtr buffer = sinkBuffers[k];
-                            buffer->addPageToTail(pageToSend);
+                            sinkBuffers[jobStage->getNodeId()]->addPageToTail(pageToSend);
+                        } else {
+                            for (k = 0; k < numNodes; k++) {
+                                pageToSend->incRefCount();
+                            }
+                            for (k = 0; k < numNodes; k++) {
+                                PageCircularBufferPtr buffer = sinkBuffers[k];
+                                buffer->addPageToTail(pageToSend);
+                            }
                         }
                     } else {
                         free((char*)page - headerSize);
@@ -882,9 +1025,14 @@ void PipelineStage::runPipeline(HermesExecutionServer* server,
     std::vector<PageCircularBufferPtr> sourceBuffers;
     // get user set iterators
     std::vector<PageCircularBufferIteratorPtr> iterators;
+    createShuffleSkew();
     PartitionedHashSetPtr hashSet;
     Handle<SetIdentifier> sourceContext = this->jobStage->getSourceContext();
 
+    // the hash table we probe, if some of its partitions were spilled when it was built
+    PartitionedHashSetPtr probedHashSet = nullptr;
+    SpillingHashJoinPtr spillingHashJoin = nullptr;
+
     // to get computations
     Handle<ComputePlan> plan = this->jobStage->getComputePlan();
     plan->nullifyPlanPointer();
@@ -916,6 +1064,11 @@ void PipelineStage::runPipeline(HermesExecutionServer* server,
     if ((sourceContext->getSetType() == UserSetType) &&
         (computation->getComputationType() != "JoinComp")) {
         iterators = getUserSetIterators(server, numThreads, success, errMsg);
+        if ((MORSEL_SIZE > 0) && (iterators.empty() == false)) {
+            std::vector<PageIteratorPtr> pageIterators(iterators.begin(), iterators.end());
+            this->morselScheduler =
+                make_shared<MorselScheduler>(pageIterators, numThreads, MORSEL_SIZE, logger);
+        }
     } else if ((sourceContext->getSetType() == UserSetType) &&
                (computation->getComputationType() == "JoinComp")) {
         int sourceBufferSize = 2;
@@ -932,6 +1085,21 @@ void PipelineStage::runPipeline(HermesExecutionServer* server,
                 make_shared<PageCircularBufferIterator>(i, buffer, myLogger);
             iterators.push_back(iter);
         }
+        if (this->jobStage->getHashSets() != nullptr) {
+            Handle<Map<String, String>> hashSetsToProbe = this->jobStage->getHashSets();
+            for (PDBMapIterator<String, String> mapIter = hashSetsToProbe->begin();
+                 mapIter != hashSetsToProbe->end();
+                 ++mapIter) {
+                std::string hashSetName = (*mapIter).value;
+                PartitionedHashSetPtr partitionedHashSet =
+                    std::dynamic_pointer_cast<PartitionedHashSet>(server->getHashSet(hashSetName));
+                if ((partitionedHashSet != nullptr) &&
+                    (partitionedHashSet->getSpillingHashJoin() != nullptr)) {
+                    probedHashSet = partitionedHashSet;
+                    spillingHashJoin = partitionedHashSet->getSpillingHashJoin();
+                }
+            }
+        }
     } else {
         std::string hashSetName = sourceContext->getDatabase() + ":" + sourceContext->getSetName();
         AbstractHashSetPtr abstractHashSet = server->getHashSet(hashSetName);
@@ -967,6 +1135,12 @@ void PipelineStage::runPipeline(HermesExecutionServer* server,
                       << std::endl;
             std::cout << out << std::endl;
 #endif
+            // a partition without a hash table is only joined in the second pass
+            if ((spillingHashJoin != nullptr) && (spillingHashJoin->isResident(i) == false)) {
+                callerBuzzer->buzz(PDBAlarm::WorkAllDone, counter);
+                return;
+            }
+
             // create a data proxy
             DataProxyPtr proxy = createProxy(i, connection_mutex, errMsg);
 
@@ -1019,20 +1193,56 @@ void PipelineStage::runPipeline(HermesExecutionServer* server,
                 const UseTemporaryAllocationBlock tempBlock{4 * 1024 * 1024};
                 PageCircularBufferIteratorPtr iter = scanIterators[i];
                 PDBPagePtr page = nullptr;
+                DataProxyPtr proxy = nullptr;
+                std::vector<int> probedPartitions;
+                for (int j = 0; j < numPartitions; j++) {
+                    if ((spillingHashJoin == nullptr) || spillingHashJoin->isResident(j)) {
+                        probedPartitions.push_back(j);
+                    }
+                }
+                std::string scanErrMsg;
+                bool spillFailed = false;
+                if (spillingHashJoin != nullptr) {
+                    proxy = createProxy(numPartitions + i, connection_mutex, scanErrMsg);
+                }
                 while (iter->hasNext()) {
                     page = iter->next();
                     if (page != nullptr) {
                         std::cout << "Scanner got a non-null page" << std::endl;
-                        for (int j = 0; j < numPartitions; j++) {
+
+                        // the maps of the spilled partitions are copied before the page is given
+                        // to the partitions that probe it, as they unpin it when they are done
+                        if ((spillingHashJoin != nullptr) && (spillFailed == false)) {
+                            if (hasFailed(scanErrMsg)) {
+                                spillFailed = true;
+                            } else if (spillingHashJoin->spillProbePage(page, proxy) == false) {
+                                setFailed("Error: failed to spill the probe side of the join");
+                                spillFailed = true;
+                            }
+                        }
+                        // once the join cannot be complete, the rest of the scan is only drained
+                        // to give its pages back
+                        if (spillFailed || probedPartitions.empty()) {
+                            proxy->unpinUserPage(nodeId,
+                                                 page->getDbID(),
+                                                 page->getTypeID(),
+                                                 page->getSetID(),
+                                                 page);
+                            continue;
+                        }
+                        for (int j : probedPartitions) {
                             page->incRefCount();
                         }
                         std::cout << "Initialize join source page reference count to "
                                   << page->getRefCount() << std::endl;
-                        for (int j = 0; j < numPartitions; j++) {
+                        for (int j : probedPartitions) {
                             sourceBuffers[j]->addPageToTail(page);
                         }
                     }
                 }
+                if (spillingHashJoin != nullptr) {
+                    spillingHashJoin->finishProbeSpill(proxy);
+                }
                 callerBuzzer->buzz(PDBAlarm::WorkAllDone, sourceCounter);
             });
 
@@ -1056,8 +1266,25 @@ void PipelineStage::runPipeline(HermesExecutionServer* server,
     }
 
     counter = 0;
+    if ((spillingHashJoin != nullptr) && spillingHashJoin->hasSpilled() &&
+        (hasFailed(errMsg) == false)) {
+        runSpilledJoinPartitions(
+            server, spillingHashJoin, probedHashSet, sinkBuffers, outputSet, connection_mutex);
+        if (spillingHashJoin->hasFailed()) {
+            setFailed("Error: the spilled build side of the join does not fit in a hash table");
+        }
+    }
     pthread_mutex_destroy(&connection_mutex);
 
+    if (this->morselScheduler != nullptr) {
+        PDB_COUT << "handed out " << this->morselScheduler->getNumMorsels() << " morsels, "
+                 << this->morselScheduler->getNumSteals() << " of them stolen" << std::endl;
+        this->morselScheduler = nullptr;
+    }
+    if (this->shuffleSkew != nullptr) {
+        std::cout << "shuffle skew: " << this->shuffleSkew->toString() << std::endl;
+    }
+
 
     if (server->getFunctionality<HermesExecutionServer>().setCurPageScanner(nullptr) == false) {
         success = false;
@@ -1070,6 +1297,115 @@ void PipelineStage::runPipeline(HermesExecutionServer* server,
 }
 
 
+// the second pass of a hash partitioned join: every worker takes a page of the probed hash set and
+// joins the spilled partitions it is given one after the other, with a thread that feeds it the
+// spilled probe side
+void PipelineStage::runSpilledJoinPartitions(HermesExecutionServer* server,
+                                             SpillingHashJoinPtr spillingHashJoin,
+                                             PartitionedHashSetPtr probedHashSet,
+                                             std::vector<PageCircularBufferPtr>& sinkBuffers,
+                                             SetSpecifierPtr outputSet,
+                                             pthread_mutex_t connection_mutex) {
+    std::vector<int> spilledPartitions = spillingHashJoin->getSpilledPartitions();
+    int numPartitions = this->jobStage->getNumTotalPartitions() / this->jobStage->getNumNodes();
+
+    // the partitions in memory are all probed by now, so their pages can be used again; every
+    // worker needs another thread for the feeding, so we use half as many as the first pass did
+    int numWorkers = probedHashSet->getNumPages();
+    if (numWorkers > numPartitions / 2) {
+        numWorkers = numPartitions / 2;
+    }
+    if (numWorkers > (int)spilledPartitions.size()) {
+        numWorkers = spilledPartitions.size();
+    }
+    if (numWorkers < 1) {
+        numWorkers = 1;
+    }
+    std::cout << "to join " << spilledPartitions.size() << " spilled partitions with "
+              << numWorkers << " threads." << std::endl;
+
+    PDBBuzzerPtr spillBuzzer =
+        make_shared<PDBBuzzer>([&](PDBAlarm myAlarm, int& spillCounter) { spillCounter++; });
+    int spillCounter = 0;
+    for (int w = 0; w < numWorkers; w++) {
+        PDBWorkerPtr worker =
+            server->getFunctionality<HermesExecutionServer>().getWorkers()->getWorker();
+        PDBWorkPtr myWork = make_shared<GenericWork>([&, w](PDBBuzzerPtr callerBuzzer) {
+            std::string errMsg;
+            DataProxyPtr proxy = createProxy(w, connection_mutex, errMsg);
+            void* page = probedHashSet->getPage(w);
+            if (page == nullptr) {
+                page = probedHashSet->addPage();
+            }
+            if (page == nullptr) {
+                errMsg = "Error: insufficient memory in heap to join the spilled partitions";
+                std::cout << errMsg << std::endl;
+                setFailed(errMsg);
+                callerBuzzer->buzz(PDBAlarm::WorkAllDone, spillCounter);
+                return;
+            }
+            for (int k = w; k < spilledPartitions.size(); k += numWorkers) {
+                int j = spilledPartitions[k];
+
+                // if the build side does not fit in the page, it is built a part at a time, and
+                // the probe side is joined with every part
+                bool isLastPart = false;
+                int numParts = 0;
+                while (isLastPart == false) {
+                    isLastPart = spillingHashJoin->buildSpilled(
+                        j, page, probedHashSet->getPageSize(), proxy);
+                    numParts++;
+                    PDBLoggerPtr myLogger = make_shared<PDBLogger>(
+                        std::string("scanSpilledPartition-") + std::to_string(j));
+                    PageCircularBufferPtr buffer = make_shared<PageCircularBuffer>(2, myLogger);
+                    std::vector<PageCircularBufferIteratorPtr> partitionIterators(numPartitions,
+                                                                                  nullptr);
+                    partitionIterators[j] =
+                        make_shared<PageCircularBufferIterator>(j, buffer, myLogger);
+                    PDBBuzzerPtr feedBuzzer = make_shared<PDBBuzzer>(
+                        [&](PDBAlarm myAlarm, int& feedCounter) { feedCounter++; });
+                    int feedCounter = 0;
+                    PDBWorkerPtr feeder =
+                        server->getFunctionality<HermesExecutionServer>().getWorkers()->getWorker();
+                    PDBWorkPtr feedWork = make_shared<GenericWork>([&](PDBBuzzerPtr feederBuzzer) {
+                        const UseTemporaryAllocationBlock tempBlock{4 * 1024 * 1024};
+                        std::string feedErrMsg;
+                        DataProxyPtr feedProxy =
+                            createProxy(numPartitions + j, connection_mutex, feedErrMsg);
+                        spillingHashJoin->feedProbePages(j, buffer, feedProxy);
+                        feederBuzzer->buzz(PDBAlarm::WorkAllDone, feedCounter);
+                    });
+                    feeder->execute(feedWork, feedBuzzer);
+
+                    getAllocator().setPolicy(jobStage->getAllocatorPolicy());
+                    executePipelineWork(j,
+                                        outputSet,
+                                        partitionIterators,
+                                        nullptr,
+                                        proxy,
+                                        sinkBuffers,
+                                        server,
+                                        errMsg,
+                                        page);
+                    getAllocator().setPolicy(AllocatorPolicy::defaultAllocator);
+                    while (feedCounter < 1) {
+                        feedBuzzer->wait();
+                    }
+                }
+                std::cout << "joined spilled partition " << j << " in " << numParts << " parts"
+                          << std::endl;
+                spillingHashJoin->removeSpilled(j, proxy);
+            }
+            callerBuzzer->buzz(PDBAlarm::WorkAllDone, spillCounter);
+        });
+        worker->execute(myWork, spillBuzzer);
+    }
+    while (spillCounter < numWorkers) {
+        spillBuzzer->wait();
+    }
+}
+
+
 // below method will run the combiner
 void PipelineStage::runPipelineWithShuffleSink(HermesExecutionServer* server) {
     bool success;
@@ -1174,6 +1510,18 @@ void PipelineStage::runPipelineWithShuffleSink(HermesExecutionServer* server) {
                 port = this->jobStage->getPort(i % numNodesToCollect);
                 PDB_COUT << "port = " << port << std::endl;
             }
+
+            // all of the combined pages for the node go through one channel
+            ShuffleChannelPtr channel =
+                make_shared<ShuffleChannel>(logger,
+                                            address,
+                                            port,
+                                            this->jobStage->getSinkContext()->getDatabase(),
+                                            this->jobStage->getSinkContext()->getSetName(),
+                                            true,
+                                            SHUFFLE_CHANNEL_CREDITS,
+                                            createPageCodec());
+
             // get aggregate computation
             PDB_COUT << i << ": to get compute plan" << std::endl;
 #ifdef ENABLE_LARGE_GRAPH
@@ -1206,6 +1554,10 @@ void PipelineStage::runPipelineWithShuffleSink(HermesExecutionServer* server) {
             if (myCombinerPageSize > conf->getShufflePageSize() - 64) {
                 myCombinerPageSize = conf->getShufflePageSize() - 64;
             }
+            // the receiver stores every combined page as a page of the sink set
+            if (myCombinerPageSize > this->jobStage->getSinkContext()->getPageSize() - 64) {
+                myCombinerPageSize = this->jobStage->getSinkContext()->getPageSize() - 64;
+            }
             void* combinerPage = (void*)calloc(myCombinerPageSize, sizeof(char));
             if (combinerPage == nullptr) {
                 std::cout << "Fatal Error: insufficient memory can be allocated from memory"
@@ -1228,34 +1580,10 @@ void PipelineStage::runPipelineWithShuffleSink(HermesExecutionServer* server) {
                         // send out the output page
                         Record<Vector<Handle<Object>>>* record =
                             (Record<Vector<Handle<Object>>>*)combinerPage;
-#ifndef ENABLE_COMPRESSION
-                        this->storeShuffleData(record->getRootObject(),
-                                               this->jobStage->getSinkContext()->getDatabase(),
-                                               this->jobStage->getSinkContext()->getSetName(),
-                                               address,
-                                               port,
-                                               false,
-                                               errMsg);
-#else
-                        char* compressedBytes =
-                            new char[snappy::MaxCompressedLength(record->numBytes())];
-                        size_t compressedSize;
-                        snappy::RawCompress(
-                            (char*)record, record->numBytes(), compressedBytes, &compressedSize);
-                        std::cout << "size before compression is " << record->numBytes()
-                                  << " and size after compression is " << compressedSize
-                                  << std::endl;
-                        this->storeCompressedShuffleData(
-                            compressedBytes,
-                            compressedSize,
-                            this->jobStage->getSinkContext()->getDatabase(),
-                            this->jobStage->getSinkContext()->getSetName(),
-                            address,
-                            port,
-                            errMsg);
-                        delete[] compressedBytes;
-
-#endif
+                        if (channel->sendPage(record, record->numBytes(), errMsg) == false) {
+                            logger->error("Error shuffling data to " + address + ": " + errMsg);
+                            setFailed("Error shuffling data to " + address + ": " + errMsg);
+                        }
 
 
                         // free the output page
@@ -1287,31 +1615,20 @@ void PipelineStage::runPipelineWithShuffleSink(HermesExecutionServer* server) {
             // send the output page
             PDB_COUT << "processed " << numPages << " pages" << std::endl;
             Record<Vector<Handle<Object>>>* record = (Record<Vector<Handle<Object>>>*)combinerPage;
-#ifndef ENABLE_COMPRESSION
-            this->storeShuffleData(record->getRootObject(),
-                                   this->jobStage->getSinkContext()->getDatabase(),
-                                   this->jobStage->getSinkContext()->getSetName(),
-                                   address,
-                                   port,
-                                   false,
-                                   errMsg);
-#else
-            char* compressedBytes = new char[snappy::MaxCompressedLength(record->numBytes())];
-            size_t compressedSize;
-            snappy::RawCompress(
-                (char*)record, record->numBytes(), compressedBytes, &compressedSize);
-            std::cout << "size before compression is " << record->numBytes()
-                      << " and size after compression is " << compressedSize << std::endl;
-            this->storeCompressedShuffleData(compressedBytes,
-                                             compressedSize,
-                                             this->jobStage->getSinkContext()->getDatabase(),
-                                             this->jobStage->getSinkContext()->getSetName(),
-                                             address,
-                                             port,
-                                             errMsg);
-            delete[] compressedBytes;
-
-#endif
+            if (record->getRootObject()->size() > 0) {
+                if (channel->sendPage(record, record->numBytes(), errMsg) == false) {
+                    logger->error("Error shuffling data to " + address + ": " + errMsg);
+                    setFailed("Error shuffling data to " + address + ": " + errMsg);
+                }
+            }
+            if (channel->close(errMsg) == false) {
+                logger->error("Error shuffling data to " + address + ": " + errMsg);
+                setFailed("Error shuffling data to " + address + ": " + errMsg);
+            }
+            addTransferStats(channel->getCodecStats());
+            std::cout << i << ": shuffled " << channel->getNumPagesSent() << " pages with "
+                      << channel->getNumBytesSent() << " bytes to address: " << address
+                      << std::endl;
 
             // free the output page
             combinerProcessor->clearOutputPage();
@@ -1350,6 +1667,11 @@ void PipelineStage::runPipelineWithShuffleSink(HermesExecutionServer* server) {
     while (combinerCounter < numNodes) {
         combinerBuzzer->wait();
     }
+    std::cout << "shuffled " << getTransferStats().toString() << std::endl;
+    if (hasFailed(errMsg)) {
+        success = false;
+        std::cout << errMsg << std::endl;
+    }
 
     combinerCounter = 0;
     return;
@@ -1420,8 +1742,16 @@ void PipelineStage::runPipelineWithBroadcastSink(HermesExecutionServer* server)
             PDB_COUT << "port = " << port << std::endl;
             // get aggregate computation
 
-            PDBCommunicatorPtr communicator = std::make_shared<PDBCommunicator>();
-            communicator->connectToInternetServer(logger, port, address, errMsg);
+            // all of the pages for the node go through one channel
+            ShuffleChannelPtr channel =
+                make_shared<ShuffleChannel>(logger,
+                                            address,
+                                            port,
+                                            jobStage->getSinkContext()->getDatabase(),
+                                            jobStage->getSinkContext()->getSetName(),
+                                            false,
+                                            SHUFFLE_CHANNEL_CREDITS,
+                                            createPageCodec());
 
             PageCircularBufferIteratorPtr myIter = shuffleIters[i];
             int numPages = 0;
@@ -1432,12 +1762,10 @@ void PipelineStage::runPipelineWithBroadcastSink(HermesExecutionServer* server)
                     numPages++;
                     // send out the page
                     Record<Object>* myRecord = (Record<Object>*)(page->getBytes());
-                    sendData(communicator,
-                             myRecord,
-                             myRecord->numBytes(),
-                             jobStage->getSinkContext()->getDatabase(),
-                             jobStage->getSinkContext()->getSetName(),
-                             errMsg);
+                    if (channel->sendPage(myRecord, myRecord->numBytes(), errMsg) == false) {
+                        logger->error("Error broadcasting data to " + address + ": " + errMsg);
+                        setFailed("Error broadcasting data to " + address + ": " + errMsg);
+                    }
                     // unpin the input page
                     page->decRefCount();
                     if (page->getRefCount() == 0) {
@@ -1445,14 +1773,13 @@ void PipelineStage::runPipelineWithBroadcastSink(HermesExecutionServer* server)
                     }
                 }
             }
+            if (channel->close(errMsg) == false) {
+                logger->error("Error broadcasting data to " + address + ": " + errMsg);
+                setFailed("Error broadcasting data to " + address + ": " + errMsg);
+            }
+            addTransferStats(channel->getCodecStats());
             std::cout << "broadcasted " << numPages << " pages to address: " << address
                       << std::endl;
-            sendData(communicator,
-                     nullptr,
-                     DEFAULT_NET_PAGE_SIZE,
-                     jobStage->getSinkContext()->getDatabase(),
-                     jobStage->getSinkContext()->getSetName(),
-                     errMsg);
 #ifdef PROFILING
             out = getAllocator().printInactiveBlocks();
             std::cout << "inactive blocks after sending data in this worker:" << std::endl;
@@ -1486,6 +1813,11 @@ void PipelineStage::runPipelineWithBroadcastSink(HermesExecutionServer* server)
     while (shuffleCounter < numNodes) {
         shuffleBuzzer->wait();
     }
+    std::cout << "broadcasted " << getTransferStats().toString() << std::endl;
+    if (hasFailed(errMsg)) {
+        success = false;
+        std::cout << errMsg << std::endl;
+    }
 
     shuffleCounter = 0;
     return;
@@ -1532,6 +1864,12 @@ void PipelineStage::runPipelineWithHashPartitionSink(HermesExecutionServer* serv
         PDB_COUT << "to run the " << i << "-th hash partitioning work..." << std::endl;
         // start threads
         PDBWorkPtr myWork = make_shared<GenericWork>([&, i](PDBBuzzerPtr callerBuzzer) {
+
+            // the sides of a co-partitioned join are not sent to the other nodes
+            if (jobStage->isLocalRepartition() && (i != myNodeId)) {
+                callerBuzzer->buzz(PDBAlarm::WorkAllDone, shuffleCounter);
+                return;
+            }
             UseTemporaryAllocationBlock tempBlock{32 * 1024 * 1024};
             std::string out = getAllocator().printInactiveBlocks();
             logger->warn(out);
@@ -1557,8 +1895,18 @@ void PipelineStage::runPipelineWithHashPartitionSink(HermesExecutionServer* serv
 
             PDB_COUT << "port = " << port << std::endl;
 
-            PDBCommunicatorPtr communicator = std::make_shared<PDBCommunicator>();
-            communicator->connectToInternetServer(logger, port, address, errMsg);
+            // all of the maps for a remote node go through one channel
+            ShuffleChannelPtr channel = nullptr;
+            if (i != myNodeId) {
+                channel = make_shared<ShuffleChannel>(logger,
+                                                      address,
+                                                      port,
+                                                      jobStage->getSinkContext()->getDatabase(),
+                                                      jobStage->getSinkContext()->getSetName(),
+                                                      false,
+                                                      SHUFFLE_CHANNEL_CREDITS,
+                                                      createPageCodec());
+            }
 
             // get join computation
             PDB_COUT << i << ": to get compute plan" << std::endl;
@@ -1602,7 +1950,8 @@ void PipelineStage::runPipelineWithHashPartitionSink(HermesExecutionServer* serv
                     if (record != nullptr) {
                         Handle<Vector<Handle<Vector<Handle<Object>>>>> objectsToShuffle =
                             record->getRootObject();
-                        Handle<Vector<Handle<Object>>>& objectToShuffle = (*objectsToShuffle)[i];
+                        Handle<Vector<Handle<Object>>>& objectToShuffle =
+                            (*objectsToShuffle)[jobStage->isLocalRepartition() ? 0 : i];
                         Vector<Handle<Object>>& theOtherMaps = *objectToShuffle;
                         for (int j = 0; j < theOtherMaps.size(); j++) {
                             {
@@ -1623,13 +1972,13 @@ void PipelineStage::runPipelineWithHashPartitionSink(HermesExecutionServer* serv
                                         std::cout << getAllocator().printCurrentBlock()
                                                   << std::endl;
                                         makeObjectAllocatorBlock(128 * 1024, true);
-
-                                        sendData(communicator,
-                                                 sendBuffer,
-                                                 numBytes,
-                                                 jobStage->getSinkContext()->getDatabase(),
-                                                 jobStage->getSinkContext()->getSetName(),
-                                                 errMsg);
+                                        if (channel->sendPage(sendBuffer, numBytes, errMsg) ==
+                                            false) {
+                                            logger->error("Error shuffling data to " + address +
+                                                          ": " + errMsg);
+                                            setFailed("Error shuffling data to " + address + ": " +
+                                                      errMsg);
+                                        }
                                     } else {
                                         makeObjectAllocatorBlock(128 * 1024, true);
                                         proxy->pinBytes(jobStage->getSinkContext()->getDatabaseId(),
@@ -1685,12 +2034,10 @@ void PipelineStage::runPipelineWithHashPartitionSink(HermesExecutionServer* serv
                 if (i != myNodeId) {
                     std::cout << getAllocator().printCurrentBlock() << std::endl;
                     makeObjectAllocatorBlock(128 * 1024, true);
-                    sendData(communicator,
-                             sendBuffer,
-                             numBytes,
-                             jobStage->getSinkContext()->getDatabase(),
-                             jobStage->getSinkContext()->getSetName(),
-                             errMsg);
+                    if (channel->sendPage(sendBuffer, numBytes, errMsg) == false) {
+                        logger->error("Error shuffling data to " + address + ": " + errMsg);
+                        setFailed("Error shuffling data to " + address + ": " + errMsg);
+                    }
                 } else {
                     makeObjectAllocatorBlock(128 * 1024, true);
                     proxy->pinBytes(jobStage->getSinkContext()->getDatabaseId(),
@@ -1713,12 +2060,11 @@ void PipelineStage::runPipelineWithHashPartitionSink(HermesExecutionServer* serv
             std::cout << numMaps << " maps are written in total for partition-" << i << std::endl;
             if (i != myNodeId) {
                 makeObjectAllocatorBlock(128 * 1024, true);
-                sendData(communicator,
-                         nullptr,
-                         conf->getNetBroadcastPageSize(),
-                         jobStage->getSinkContext()->getDatabase(),
-                         jobStage->getSinkContext()->getSetName(),
-                         errMsg);
+                if (channel->close(errMsg) == false) {
+                    logger->error("Error shuffling data to " + address + ": " + errMsg);
+                    setFailed("Error shuffling data to " + address + ": " + errMsg);
+                }
+                addTransferStats(channel->getCodecStats());
             }
 #ifdef PROFILING
             out = getAllocator().printInactiveBlocks();
@@ -1751,6 +2097,11 @@ void PipelineStage::runPipelineWithHashPartitionSink(HermesExecutionServer* serv
     while (shuffleCounter < numNodes) {
         shuffleBuzzer->wait();
     }
+    std::cout << "hash partitioned " << getTransferStats().toString() << std::endl;
+    if (hasFailed(errMsg)) {
+        success = false;
+        std::cout << errMsg << std::endl;
+    }
 
     shuffleCounter = 0;
     return;
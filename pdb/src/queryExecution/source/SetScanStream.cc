@@ -0,0 +1,270 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef SET_SCAN_STREAM_CC
+#define SET_SCAN_STREAM_CC
+
+#include "PDBDebug.h"
+#include "SetScanStream.h"
+#include "PageCodec.h"
+#include "SetScan.h"
+#include "DoneWithResult.h"
+#include "InterfaceFunctions.h"
+#include "UseTemporaryAllocationBlock.h"
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace pdb {
+
+SetScanStream::SetScanStream(PDBLoggerPtr logger,
+                             std::vector<std::string> workers,
+                             std::string databaseName,
+                             std::string setName,
+                             int windowSize,
+                             int numPrefetchPages) {
+    this->logger = logger;
+    this->databaseName = databaseName;
+    this->setName = setName;
+    this->windowSize = (windowSize < 1) ? 1 : windowSize;
+    this->numPrefetchPages = (numPrefetchPages < 1) ? 1 : numPrefetchPages;
+    this->numRunning = 0;
+    this->aborted = false;
+    this->failed = false;
+    this->numPagesReceived = 0;
+    this->numBytesReceived = 0;
+    pthread_mutex_init(&(this->mutex), nullptr);
+    pthread_cond_init(&(this->pageReady), nullptr);
+    pthread_cond_init(&(this->spaceReady), nullptr);
+    for (std::string& worker : workers) {
+        Receiver receiver;
+        receiver.stream = this;
+        receiver.communicator = nullptr;
+        receiver.worker = worker;
+        receiver.started = false;
+        this->receivers.push_back(receiver);
+    }
+}
+
+SetScanStream::~SetScanStream() {
+    pthread_mutex_lock(&(this->mutex));
+    this->aborted = true;
+    pthread_cond_broadcast(&(this->spaceReady));
+    pthread_mutex_unlock(&(this->mutex));
+    for (Receiver& receiver : this->receivers) {
+        if (receiver.started) {
+            pthread_join(receiver.thread, nullptr);
+        }
+    }
+    for (void* page : this->pages) {
+        free(page);
+    }
+    PDB_COUT << "SetScanStream: received " << this->numPagesReceived << " pages with "
+             << this->numBytesReceived << " bytes of set " << this->setName << " from "
+             << this->receivers.size() << " workers" << std::endl;
+    pthread_cond_destroy(&(this->spaceReady));
+    pthread_cond_destroy(&(this->pageReady));
+    pthread_mutex_destroy(&(this->mutex));
+}
+
+bool SetScanStream::start(std::string& errMsg) {
+
+    // send the scan to every worker first, so that none of them waits for another to be reached
+    bool success = true;
+    for (Receiver& receiver : this->receivers) {
+        std::string address = receiver.worker;
+        int port = 8108;
+        size_t pos = receiver.worker.find(":");
+        if (pos != std::string::npos) {
+            address = receiver.worker.substr(0, pos);
+            port = stoi(receiver.worker.substr(pos + 1));
+        }
+        PDBCommunicatorPtr communicator = std::make_shared<PDBCommunicator>();
+        if (communicator->connectToInternetServer(this->logger, port, address, errMsg)) {
+            errMsg = "SetScanStream: can't connect to " + receiver.worker + ": " + errMsg;
+            success = false;
+            break;
+        }
+
+        // the credits are a few bytes each, don't let Nagle hold them back
+        int noDelay = 1;
+        setsockopt(
+            communicator->getSocketFD(), IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        const UseTemporaryAllocationBlock tempBlock{1024};
+        Handle<SetScan> request =
+            makeObject<SetScan>(this->databaseName, this->setName, this->windowSize);
+        if (communicator->sendObject(request, errMsg) == false) {
+            errMsg = "SetScanStream: can't send the scan to " + receiver.worker + ": " + errMsg;
+            success = false;
+            break;
+        }
+        receiver.communicator = communicator;
+    }
+
+    // a worker that got the scan is stopped by its receiver
+    if (success == false) {
+        this->logger->error(errMsg);
+        this->aborted = true;
+    }
+    for (Receiver& receiver : this->receivers) {
+        if (receiver.communicator == nullptr) {
+            continue;
+        }
+        pthread_mutex_lock(&(this->mutex));
+        this->numRunning++;
+        pthread_mutex_unlock(&(this->mutex));
+        if (pthread_create(&(receiver.thread), nullptr, SetScanStream::receive, &receiver) != 0) {
+            errMsg = "SetScanStream: can't start a thread to receive from " + receiver.worker;
+            this->logger->error(errMsg);
+            pthread_mutex_lock(&(this->mutex));
+            this->numRunning--;
+            this->aborted = true;
+            pthread_mutex_unlock(&(this->mutex));
+            success = false;
+            continue;
+        }
+        receiver.started = true;
+    }
+    return success;
+}
+
+void* SetScanStream::receive(void* receiver) {
+    Receiver* me = (Receiver*)receiver;
+    me->stream->receivePages(*me);
+    return nullptr;
+}
+
+// the receivers do not allocate objects: the allocator of the client is not theirs, so the
+// credits are sent as bytes, and the DoneWithResult is read as bytes
+void SetScanStream::receivePages(Receiver& receiver) {
+    PDBCommunicatorPtr communicator = receiver.communicator;
+    std::string errMsg;
+    bool ok = true;
+    bool stopSent = false;
+    while (true) {
+
+        // the worker is done, or has stopped
+        if (communicator->getObjectTypeID() == DoneWithResult_TYPEID) {
+            std::vector<char> doneBytes(communicator->getSizeOfNextObject());
+            communicator->receiveBytes(doneBytes.data(), errMsg);
+            break;
+        }
+        PageFrameHeader header;
+        void* page = nullptr;
+        if (PageCodec::receiveHeader(communicator, header, errMsg)) {
+            page = malloc(header.numBytes);
+        }
+        if ((page == nullptr) || (PageCodec::receivePage(communicator, header, page, errMsg) ==
+                                  false)) {
+            this->logger->error("SetScanStream: can't receive a page from " + receiver.worker +
+                                ": " + errMsg);
+            free(page);
+            ok = false;
+            break;
+        }
+
+        // wait for the consumer to make room for the page
+        pthread_mutex_lock(&(this->mutex));
+        while ((this->aborted == false) && (this->pages.size() >= this->numPrefetchPages)) {
+            pthread_cond_wait(&(this->spaceReady), &(this->mutex));
+        }
+        bool stopping = this->aborted;
+        if (stopping == false) {
+            this->pages.push_back(page);
+            this->numPagesReceived++;
+            this->numBytesReceived += header.numBytes;
+            pthread_cond_signal(&(this->pageReady));
+        }
+        pthread_mutex_unlock(&(this->mutex));
+
+        // nobody wants the pages anymore, stop the worker and drop what it has sent already
+        if (stopping) {
+            free(page);
+            if (stopSent == false) {
+                stopSent = true;
+                if (sendCredit(communicator, 0, errMsg) == false) {
+                    break;
+                }
+            }
+            continue;
+        }
+        if (sendCredit(communicator, 1, errMsg) == false) {
+            this->logger->error("SetScanStream: can't send a credit to " + receiver.worker +
+                                ": " + errMsg);
+            ok = false;
+            break;
+        }
+    }
+    pthread_mutex_lock(&(this->mutex));
+    if (ok == false) {
+        this->failed = true;
+    }
+    this->numRunning--;
+    pthread_cond_broadcast(&(this->pageReady));
+    pthread_mutex_unlock(&(this->mutex));
+}
+
+void* SetScanStream::nextPage() {
+    pthread_mutex_lock(&(this->mutex));
+    while (this->pages.empty() && (this->numRunning > 0)) {
+        pthread_cond_wait(&(this->pageReady), &(this->mutex));
+    }
+    void* page = nullptr;
+    if (this->pages.empty() == false) {
+        page = this->pages.front();
+        this->pages.pop_front();
+        pthread_cond_signal(&(this->spaceReady));
+    }
+    pthread_mutex_unlock(&(this->mutex));
+    return page;
+}
+
+bool SetScanStream::isOk() {
+    pthread_mutex_lock(&(this->mutex));
+    bool ok = (this->failed == false);
+    pthread_mutex_unlock(&(this->mutex));
+    return ok;
+}
+
+long SetScanStream::getNumPagesReceived() {
+    return this->numPagesReceived;
+}
+
+bool SetScanStream::sendCredit(PDBCommunicatorPtr sendUsingMe, int numPages, std::string& errMsg) {
+    return sendUsingMe->sendBytes(&numPages, sizeof(int), errMsg);
+}
+
+bool SetScanStream::receiveCredit(PDBCommunicatorPtr receiveFromMe,
+                                  int& numPages,
+                                  std::string& errMsg) {
+    if (receiveFromMe->getObjectTypeID() == DoneWithResult_TYPEID) {
+        bool success;
+        const UseTemporaryAllocationBlock tempBlock{1024};
+        receiveFromMe->getNextObject<DoneWithResult>(success, errMsg);
+        numPages = 0;
+        return success;
+    }
+    if (receiveFromMe->getSizeOfNextObject() != sizeof(int)) {
+        errMsg = "SetScanStream: expected a credit";
+        return false;
+    }
+    return receiveFromMe->receiveBytes(&numPages, errMsg);
+}
+}
+
+#endif
@@ -0,0 +1,167 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef SHUFFLE_CHANNEL_CC
+#define SHUFFLE_CHANNEL_CC
+
+#include "PDBDebug.h"
+#include "ShuffleChannel.h"
+#include "StorageAddObjectInLoop.h"
+#include "SimpleRequestResult.h"
+#include "UseTemporaryAllocationBlock.h"
+#include "InterfaceFunctions.h"
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+namespace pdb {
+
+ShuffleChannel::ShuffleChannel(PDBLoggerPtr logger,
+                               std::string address,
+                               int port,
+                               std::string databaseName,
+                               std::string setName,
+                               bool asPages,
+                               int numCredits,
+                               PageCodecPtr codec) {
+    this->logger = logger;
+    this->databaseName = databaseName;
+    this->setName = setName;
+    this->asPages = asPages;
+    this->numCredits = (numCredits < 1) ? 1 : numCredits;
+    this->numUnacknowledged = 0;
+    this->closed = false;
+    this->codec = (codec == nullptr) ? std::make_shared<PageCodec>() : codec;
+    this->numPagesSent = 0;
+    pthread_mutex_init(&(this->mutex), nullptr);
+    std::string errMsg;
+    this->communicator = std::make_shared<PDBCommunicator>();
+    this->ok =
+        (this->communicator->connectToInternetServer(logger, port, address, errMsg) == false);
+    if (this->ok == false) {
+        logger->error("ShuffleChannel: can't connect to " + address + ":" + std::to_string(port) +
+                      ": " + errMsg);
+    } else {
+        // a request header is followed right away by its page, don't let Nagle hold it back
+        int noDelay = 1;
+        setsockopt(this->communicator->getSocketFD(),
+                   IPPROTO_TCP,
+                   TCP_NODELAY,
+                   &noDelay,
+                   sizeof(noDelay));
+    }
+}
+
+ShuffleChannel::~ShuffleChannel() {
+    std::string errMsg;
+    close(errMsg);
+    pthread_mutex_destroy(&(this->mutex));
+}
+
+bool ShuffleChannel::receiveCredit(std::string& errMsg) {
+    bool success;
+    const UseTemporaryAllocationBlock tempBlock{1024};
+    Handle<SimpleRequestResult> result =
+        this->communicator->getNextObject<SimpleRequestResult>(success, errMsg);
+    if ((success == false) || (result == nullptr)) {
+        this->ok = false;
+        return false;
+    }
+    this->numUnacknowledged--;
+    if (result->getRes().first == false) {
+        errMsg = "Error sending data: " + result->getRes().second;
+        logger->error(errMsg);
+        this->ok = false;
+        return false;
+    }
+    return true;
+}
+
+bool ShuffleChannel::sendPage(void* bytes, size_t numBytes, std::string& errMsg) {
+    pthread_mutex_lock(&(this->mutex));
+
+    // out of credits, wait for the receiver to store a page
+    while (this->ok && (this->numUnacknowledged >= this->numCredits)) {
+        receiveCredit(errMsg);
+    }
+    if ((this->ok == false) || this->closed) {
+        pthread_mutex_unlock(&(this->mutex));
+        return false;
+    }
+
+    {
+        const UseTemporaryAllocationBlock tempBlock{1024};
+        Handle<StorageAddObjectInLoop> request = makeObject<StorageAddObjectInLoop>(
+            this->databaseName, this->setName, "IntermediateData", false, false);
+        if (this->asPages) {
+            request->setStoreAsPage();
+        }
+        this->ok = this->communicator->sendObject(request, errMsg);
+    }
+    if (this->ok) {
+        this->ok = this->codec->send(this->communicator, bytes, numBytes, errMsg);
+    }
+    if (this->ok) {
+        this->numUnacknowledged++;
+        this->numPagesSent++;
+    }
+    bool success = this->ok;
+    pthread_mutex_unlock(&(this->mutex));
+    return success;
+}
+
+bool ShuffleChannel::close(std::string& errMsg) {
+    pthread_mutex_lock(&(this->mutex));
+    if (this->closed) {
+        pthread_mutex_unlock(&(this->mutex));
+        return this->ok;
+    }
+    this->closed = true;
+    if (this->ok) {
+        const UseTemporaryAllocationBlock tempBlock{1024};
+        Handle<StorageAddObjectInLoop> request = makeObject<StorageAddObjectInLoop>();
+        request->setLoopEnded();
+        this->ok = this->communicator->sendObject(request, errMsg);
+    }
+
+    // the acknowledgements of the pages in flight, and then the one for the end of the loop
+    this->numUnacknowledged++;
+    while (this->ok && (this->numUnacknowledged > 0)) {
+        receiveCredit(errMsg);
+    }
+    PDB_COUT << "ShuffleChannel: sent " << this->numPagesSent << " pages to set " << this->setName
+             << ": " << this->codec->getStats().toString() << std::endl;
+    bool success = this->ok;
+    pthread_mutex_unlock(&(this->mutex));
+    return success;
+}
+
+long ShuffleChannel::getNumPagesSent() {
+    return this->numPagesSent;
+}
+
+size_t ShuffleChannel::getNumBytesSent() {
+    return this->codec->getStats().numBytesOut;
+}
+
+const PageCodecStats& ShuffleChannel::getCodecStats() {
+    return this->codec->getStats();
+}
+}
+
+#endif
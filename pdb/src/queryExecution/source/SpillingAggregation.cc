@@ -0,0 +1,263 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef SPILLING_AGGREGATION_CC
+#define SPILLING_AGGREGATION_CC
+
+#include "PDBDebug.h"
+#include "SpillingAggregation.h"
+
+namespace pdb {
+
+SpillingAggregation::SpillingAggregation(SimpleSingleTableQueryProcessorPtr processor,
+                                         DataProxyPtr proxy,
+                                         std::string setNamePrefix,
+                                         size_t pageSize,
+                                         PDBLoggerPtr logger,
+                                         int numBuckets,
+                                         int maxLevel) {
+    this->processor = processor;
+    this->proxy = proxy;
+    this->setNamePrefix = setNamePrefix;
+    this->numSetsCreated = 0;
+    this->outputPage = nullptr;
+    this->pageSize = pageSize;
+    this->logger = logger;
+    this->numBuckets = (numBuckets < 0) ? 0 : numBuckets;
+    this->maxLevel = (maxLevel < 0) ? 0 : maxLevel;
+    this->spilled = false;
+    this->failed = false;
+    this->numPagesSpilled = 0;
+    this->deepestLevel = -1;
+    SpillBucket emptyBucket;
+    emptyBucket.isCreated = false;
+    emptyBucket.setId = 0;
+    this->buckets.resize(this->maxLevel, std::vector<SpillBucket>(this->numBuckets, emptyBucket));
+}
+
+SpillingAggregation::~SpillingAggregation() {
+    for (std::vector<SpillBucket>& level : this->buckets) {
+        for (SpillBucket& bucket : level) {
+            removeBucket(bucket);
+        }
+    }
+    if (this->spilled) {
+        PDB_COUT << "SpillingAggregation " << this->setNamePrefix << ": spilled "
+                 << this->numPagesSpilled << " pages to " << this->numSetsCreated
+                 << " temp sets, down to level " << this->deepestLevel << std::endl;
+    }
+}
+
+bool SpillingAggregation::hasSpilled() {
+    return this->spilled;
+}
+
+bool SpillingAggregation::hasFailed() {
+    return this->failed;
+}
+
+void SpillingAggregation::removeBucket(SpillBucket& bucket) {
+    if (bucket.isCreated) {
+        if (this->proxy->removeTempSet(bucket.setId) == false) {
+            this->logger->error("SpillingAggregation: can't remove temp set " +
+                                std::to_string(bucket.setId));
+        }
+    }
+    bucket.isCreated = false;
+    bucket.pageIds.clear();
+}
+
+bool SpillingAggregation::spillTo(int level) {
+
+    // we only read the pages we know of, so the pages written before a failure are forgotten
+    std::vector<size_t> numPagesBefore;
+    for (SpillBucket& bucket : this->buckets[level]) {
+        numPagesBefore.push_back(bucket.pageIds.size());
+    }
+    bool success = true;
+    for (int i = 0; (i < this->numBuckets) && success; i++) {
+        if (this->processor->startSpill(level, this->numBuckets, i) == false) {
+            continue;
+        }
+        SpillBucket& bucket = this->buckets[level][i];
+        if (bucket.isCreated == false) {
+            std::string setName = this->setNamePrefix + "_" + std::to_string(level) + "_" +
+                std::to_string(i) + "_" + std::to_string(this->numSetsCreated);
+            if (this->proxy->addTempSet(setName, bucket.setId, PartialAggregationData) == false) {
+                this->logger->error("SpillingAggregation: can't add temp set " + setName);
+                success = false;
+                break;
+            }
+            bucket.isCreated = true;
+            this->numSetsCreated++;
+        }
+        bool isFull = true;
+        while (isFull) {
+            PDBPagePtr page;
+            if (this->proxy->addTempPage(bucket.setId, page) == false) {
+                this->logger->error("SpillingAggregation: can't add a page to temp set " +
+                                    std::to_string(bucket.setId));
+                success = false;
+                break;
+            }
+            isFull = this->processor->fillSpillPage(page->getBytes(), page->getSize());
+            if (this->processor->hasSpillFailed()) {
+                this->logger->error("SpillingAggregation: a group of " + this->setNamePrefix +
+                                    " does not fit in a spill page of " +
+                                    std::to_string(page->getSize()) + " bytes");
+                this->failed = true;
+                success = false;
+            }
+            bucket.pageIds.push_back(page->getPageID());
+            this->proxy->unpinTempPage(bucket.setId, page);
+            this->numPagesSpilled++;
+        }
+    }
+    if (success == false) {
+        for (int i = 0; i < this->numBuckets; i++) {
+            this->buckets[level][i].pageIds.resize(numPagesBefore[i]);
+        }
+        return false;
+    }
+    this->spilled = true;
+    if (level > this->deepestLevel) {
+        this->deepestLevel = level;
+    }
+    return true;
+}
+
+bool SpillingAggregation::spill(void* outputPage) {
+    if ((this->numBuckets == 0) || (this->maxLevel == 0) ||
+        (this->processor->canSpill() == false)) {
+        return false;
+    }
+    if (spillTo(0) == false) {
+        return false;
+    }
+    this->outputPage = outputPage;
+    this->processor->clearOutputPage();
+    this->processor->loadOutputPage(outputPage, this->pageSize);
+    return true;
+}
+
+void SpillingAggregation::emit(void* page, std::function<void(void*)> emitPage) {
+    this->processor->finalize();
+    this->processor->fillNextOutputPage();
+    this->processor->clearOutputPage();
+    this->processor->initialize();
+    emitPage(page);
+}
+
+void SpillingAggregation::aggregateLevel(int level,
+                                         void*& freePage,
+                                         std::function<void*()> getPage,
+                                         std::function<void(void*)> emitPage) {
+    for (int i = 0; (i < this->numBuckets) && (this->failed == false); i++) {
+        SpillBucket& bucket = this->buckets[level][i];
+        if (bucket.isCreated == false) {
+            continue;
+        }
+        void* page = freePage;
+        freePage = nullptr;
+        if (page == nullptr) {
+            page = getPage();
+        }
+        this->processor->loadOutputPage(page, this->pageSize);
+
+        // read the bucket back; if its groups do not fit, we split them at the next level
+        bool isSplit = false;
+        for (PageID pageId : bucket.pageIds) {
+            PDBPagePtr inputPage;
+            if (this->proxy->pinTempPage(bucket.setId, pageId, inputPage) == false) {
+                this->logger->error("SpillingAggregation: can't pin page " +
+                                    std::to_string(pageId) + " of temp set " +
+                                    std::to_string(bucket.setId));
+                this->failed = true;
+                break;
+            }
+            this->processor->loadInputPage(inputPage->getBytes());
+            while (this->processor->fillNextOutputPage()) {
+                if ((level + 1 < this->maxLevel) && spillTo(level + 1)) {
+                    isSplit = true;
+                    this->processor->clearOutputPage();
+                    this->processor->loadOutputPage(page, this->pageSize);
+                } else {
+                    this->logger->error("SpillingAggregation: the groups of bucket " +
+                                        std::to_string(i) + " at level " + std::to_string(level) +
+                                        " of " + this->setNamePrefix + " can't be split any more");
+                    this->failed = true;
+                    break;
+                }
+            }
+            this->processor->clearInputPage();
+            this->proxy->unpinTempPage(bucket.setId, inputPage);
+            if (this->failed) {
+                break;
+            }
+        }
+        removeBucket(bucket);
+
+        // the groups left go to the next level with the others, and the page is used for them;
+        // given out on their own they would not be aggregated with the groups spilled before
+        if (isSplit && (this->failed == false) && (spillTo(level + 1) == false)) {
+            this->logger->error("SpillingAggregation: can't spill the groups of bucket " +
+                                std::to_string(i) + " at level " + std::to_string(level) +
+                                " of " + this->setNamePrefix);
+            this->failed = true;
+        }
+        if (this->failed) {
+            // the results are incomplete anyway, so the page is given back empty
+            this->processor->clearOutputPage();
+            freePage = page;
+            return;
+        }
+        if (isSplit) {
+            this->processor->clearOutputPage();
+            freePage = page;
+            aggregateLevel(level + 1, freePage, getPage, emitPage);
+        } else {
+            emit(page, emitPage);
+        }
+    }
+}
+
+void SpillingAggregation::aggregateSpilled(std::function<void*()> getPage,
+                                           std::function<void(void*)> emitPage) {
+    void* freePage = nullptr;
+    if (spillTo(0) == false) {
+        // the groups in the output page may be in the buckets as well, so they can't be given
+        // out on their own
+        this->logger->error("SpillingAggregation: can't spill the groups left in the output "
+                            "page of " + this->setNamePrefix);
+        this->failed = true;
+        emit(this->outputPage, emitPage);
+        return;
+    }
+    this->processor->clearOutputPage();
+    freePage = this->outputPage;
+    aggregateLevel(0, freePage, getPage, emitPage);
+
+    // the page was not needed, give it out empty, so that it is not left with garbage in it
+    if (freePage != nullptr) {
+        this->processor->loadOutputPage(freePage, this->pageSize);
+        emit(freePage, emitPage);
+    }
+}
+}
+
+#endif
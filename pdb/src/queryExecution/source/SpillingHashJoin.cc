@@ -0,0 +1,448 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef SPILLING_HASH_JOIN_CC
+#define SPILLING_HASH_JOIN_CC
+
+#include "PDBDebug.h"
+#include "InterfaceFunctions.h"
+#include "JoinMap.h"
+#include "PDBVector.h"
+#include "SpillingHashJoin.h"
+#include "UseTemporaryAllocationBlock.h"
+#include <limits>
+#include <string.h>
+
+namespace pdb {
+
+SpillingHashJoin::SpillingHashJoin(std::string setNamePrefix,
+                                   int numPartitions,
+                                   PDBLoggerPtr logger) {
+    this->setNamePrefix = setNamePrefix;
+    this->logger = logger;
+    this->probeScratchPage = nullptr;
+    this->probeScratchPageSize = 0;
+    SpillSide emptySide;
+    emptySide.isCreated = false;
+    emptySide.setId = 0;
+    emptySide.curPage = nullptr;
+    SpillPartition emptyPartition;
+    emptyPartition.isResident = false;
+    emptyPartition.isSpilled = false;
+    emptyPartition.merger = nullptr;
+    emptyPartition.build = emptySide;
+    emptyPartition.probe = emptySide;
+    emptyPartition.scratchPage = nullptr;
+    emptyPartition.scratchPageSize = 0;
+    emptyPartition.nextBuildPage = 0;
+    emptyPartition.buildPage = nullptr;
+    emptyPartition.buildRecords = nullptr;
+    emptyPartition.isMerging = false;
+    this->partitions.resize(numPartitions, emptyPartition);
+}
+
+SpillingHashJoin::~SpillingHashJoin() {
+    for (SpillPartition& partition : this->partitions) {
+        if (partition.scratchPage != nullptr) {
+            free(partition.scratchPage);
+        }
+        if (partition.build.isCreated || partition.probe.isCreated) {
+            this->logger->error("SpillingHashJoin: the temp sets of " + this->setNamePrefix +
+                                " are left");
+        }
+    }
+    if (this->probeScratchPage != nullptr) {
+        free(this->probeScratchPage);
+    }
+}
+
+std::string SpillingHashJoin::getSetName(int partitionId, std::string side) {
+    return this->setNamePrefix + "_" + side + "_" + std::to_string(partitionId);
+}
+
+bool SpillingHashJoin::addPage(SpillSide& side, std::string setName, DataProxyPtr proxy) {
+    if (side.isCreated == false) {
+        if (proxy->addTempSet(setName, side.setId, HashPartitionData) == false) {
+            this->logger->error("SpillingHashJoin: can't add temp set " + setName);
+            return false;
+        }
+        side.isCreated = true;
+    }
+    if (proxy->addTempPage(side.setId, side.curPage) == false) {
+        this->logger->error("SpillingHashJoin: can't add a page to temp set " + setName);
+        side.curPage = nullptr;
+        return false;
+    }
+    side.pageIds.push_back(side.curPage->getPageID());
+    return true;
+}
+
+void SpillingHashJoin::closePage(SpillSide& side, DataProxyPtr proxy) {
+    if (side.curPage != nullptr) {
+        proxy->unpinTempPage(side.setId, side.curPage);
+        side.curPage = nullptr;
+    }
+}
+
+void SpillingHashJoin::removeSide(SpillSide& side, DataProxyPtr proxy) {
+    closePage(side, proxy);
+    if (side.isCreated) {
+        if (proxy->removeTempSet(side.setId) == false) {
+            this->logger->error("SpillingHashJoin: can't remove temp set " +
+                                std::to_string(side.setId));
+        }
+    }
+    side.isCreated = false;
+    side.pageIds.clear();
+}
+
+bool SpillingHashJoin::appendRecord(SpillSide& side,
+                                    std::string setName,
+                                    Record<Object>* record,
+                                    DataProxyPtr proxy) {
+    size_t numBytes = record->numBytes();
+    void* bytes = nullptr;
+    if (side.curPage != nullptr) {
+        bytes = side.curPage->addVariableBytes(numBytes);
+    }
+    if (bytes == nullptr) {
+        closePage(side, proxy);
+        if (addPage(side, setName, proxy) == false) {
+            return false;
+        }
+        bytes = side.curPage->addVariableBytes(numBytes);
+        if (bytes == nullptr) {
+            this->logger->error("SpillingHashJoin: a record of " + std::to_string(numBytes) +
+                                " bytes does not fit in a page of temp set " + setName);
+            return false;
+        }
+    }
+    memcpy(bytes, record, numBytes);
+    return true;
+}
+
+void* SpillingHashJoin::getScratchPage(size_t maxSize,
+                                       void*& scratchPage,
+                                       size_t& scratchPageSize,
+                                       SpillSide& side,
+                                       std::string setName,
+                                       DataProxyPtr proxy) {
+    if (scratchPage != nullptr) {
+        return scratchPage;
+    }
+    if ((side.curPage == nullptr) && (addPage(side, setName, proxy) == false)) {
+        return nullptr;
+    }
+
+    // a record is appended after its size
+    scratchPageSize = side.curPage->getSize() - sizeof(size_t);
+    if (scratchPageSize > maxSize) {
+        scratchPageSize = maxSize;
+    }
+    scratchPage = malloc(scratchPageSize);
+    if (scratchPage == nullptr) {
+        this->logger->error("SpillingHashJoin: insufficient memory in heap for a scratch page");
+    }
+    return scratchPage;
+}
+
+void SpillingHashJoin::startBuild(int partitionId, SinkMergerPtr merger, bool isResident) {
+    SpillPartition& partition = this->partitions[partitionId];
+    partition.merger = merger;
+    partition.isResident = isResident;
+}
+
+bool SpillingHashJoin::addBuildMaps(int partitionId,
+                                    Handle<Object> maps,
+                                    Handle<Object>& hashTable,
+                                    DataProxyPtr proxy) {
+    SpillPartition& partition = this->partitions[partitionId];
+    partition.merger->startPartition(maps, partitionId);
+    if (partition.isResident && (partition.isSpilled == false)) {
+        if (partition.merger->writePartitionOut(hashTable)) {
+            return true;
+        }
+        std::cout << "SpillingHashJoin: the hash table of partition " << partitionId << " of "
+                  << this->setNamePrefix << " is full, the rest of its build side is spilled"
+                  << std::endl;
+    }
+
+    // what is in the hash table stays there, everything else of the partition is spilled
+    std::string setName = getSetName(partitionId, "build");
+    void* scratchPage = getScratchPage(JOIN_SPILL_BUFFER_SIZE,
+                                       partition.scratchPage,
+                                       partition.scratchPageSize,
+                                       partition.build,
+                                       setName,
+                                       proxy);
+    if (scratchPage == nullptr) {
+        return false;
+    }
+    while (partition.merger->fillSpillPage(scratchPage, partition.scratchPageSize)) {
+        if (appendRecord(partition.build, setName, (Record<Object>*)scratchPage, proxy) ==
+            false) {
+            return false;
+        }
+        partition.isSpilled = true;
+    }
+    if (partition.merger->hasFailed()) {
+        this->logger->error("SpillingHashJoin: some of the build side of partition " +
+                            std::to_string(partitionId) + " of " + this->setNamePrefix +
+                            " does not fit in a hash table or a spill page");
+        return false;
+    }
+    return true;
+}
+
+void SpillingHashJoin::finishBuild(int partitionId, DataProxyPtr proxy) {
+    SpillPartition& partition = this->partitions[partitionId];
+    closePage(partition.build, proxy);
+    if (partition.scratchPage != nullptr) {
+        free(partition.scratchPage);
+        partition.scratchPage = nullptr;
+    }
+    if (partition.isSpilled) {
+        std::cout << "SpillingHashJoin: partition " << partitionId << " of "
+                  << this->setNamePrefix << " spilled " << partition.build.pageIds.size()
+                  << " pages of its build side" << std::endl;
+    } else {
+        // a partition without a hash table may have had nothing to build
+        removeSide(partition.build, proxy);
+    }
+}
+
+bool SpillingHashJoin::isResident(int partitionId) {
+    return this->partitions[partitionId].isResident;
+}
+
+bool SpillingHashJoin::isSpilled(int partitionId) {
+    return this->partitions[partitionId].isSpilled;
+}
+
+bool SpillingHashJoin::hasSpilled() {
+    for (SpillPartition& partition : this->partitions) {
+        if (partition.isSpilled) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<int> SpillingHashJoin::getSpilledPartitions() {
+    std::vector<int> spilledPartitions;
+    for (int i = 0; i < this->partitions.size(); i++) {
+        if (this->partitions[i].isSpilled) {
+            spilledPartitions.push_back(i);
+        }
+    }
+    return spilledPartitions;
+}
+
+bool SpillingHashJoin::hasFailed() {
+    for (SpillPartition& partition : this->partitions) {
+        if ((partition.merger != nullptr) && partition.merger->hasFailed()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Record<Object>* SpillingHashJoin::copyPartitionMaps(Record<Object>* maps,
+                                                    int partitionId,
+                                                    void* block,
+                                                    size_t numBytes) {
+
+    // where a JoinMap is in the partitions does not depend on what it stores, so we look at the
+    // maps as JoinMap<Object>; they are copied through Handle<Object>, which copies what they are
+    UseTemporaryAllocationBlockPtr copyBlock =
+        std::make_shared<UseTemporaryAllocationBlock>(block, numBytes);
+    Handle<Vector<Handle<JoinMap<Object>>>> inputMaps =
+        ((Record<Vector<Handle<JoinMap<Object>>>>*)maps)->getRootObject();
+    Handle<Vector<Handle<Object>>> copies = nullptr;
+    try {
+        for (size_t i = 0; i < inputMaps->size(); i++) {
+            Handle<JoinMap<Object>> inputMap = (*inputMaps)[i];
+            if ((inputMap == nullptr) ||
+                (inputMap->getPartitionId() % inputMap->getNumPartitions() !=
+                 (size_t)partitionId)) {
+                continue;
+            }
+            if (copies == nullptr) {
+                copies = makeObject<Vector<Handle<Object>>>(1);
+            }
+            copies->push_back(unsafeCast<Object>(inputMap));
+        }
+    } catch (NotEnoughSpace& n) {
+        std::cout << "ERROR: the maps of partition " << partitionId << " do not fit in a page of "
+                  << numBytes << " bytes, some of them are dropped" << std::endl;
+    }
+    Record<Object>* copy = nullptr;
+    if (copies != nullptr) {
+        copy = (Record<Object>*)getRecord(copies);
+    }
+
+    // let go of the block before the handles to it, so that they do not free what is on it
+    copyBlock = nullptr;
+    return copy;
+}
+
+bool SpillingHashJoin::spillProbePage(PDBPagePtr page, DataProxyPtr proxy) {
+    if (hasSpilled() == false) {
+        return true;
+    }
+    RecordIteratorPtr records = std::make_shared<RecordIterator>(page);
+    while (records->hasNext()) {
+        Record<Object>* record = records->next();
+        if (record == nullptr) {
+            continue;
+        }
+        for (int i = 0; i < this->partitions.size(); i++) {
+            SpillPartition& partition = this->partitions[i];
+            if (partition.isSpilled == false) {
+                continue;
+            }
+            std::string setName = getSetName(i, "probe");
+            void* scratchPage = getScratchPage(std::numeric_limits<size_t>::max(),
+                                               this->probeScratchPage,
+                                               this->probeScratchPageSize,
+                                               partition.probe,
+                                               setName,
+                                               proxy);
+            if (scratchPage == nullptr) {
+                return false;
+            }
+            Record<Object>* copy =
+                copyPartitionMaps(record, i, scratchPage, this->probeScratchPageSize);
+            if ((copy != nullptr) &&
+                (appendRecord(partition.probe, setName, copy, proxy) == false)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void SpillingHashJoin::finishProbeSpill(DataProxyPtr proxy) {
+    for (int i = 0; i < this->partitions.size(); i++) {
+        SpillPartition& partition = this->partitions[i];
+        closePage(partition.probe, proxy);
+        if (partition.isSpilled) {
+            std::cout << "SpillingHashJoin: partition " << i << " of " << this->setNamePrefix
+                      << " spilled " << partition.probe.pageIds.size()
+                      << " pages of its probe side" << std::endl;
+        }
+    }
+    if (this->probeScratchPage != nullptr) {
+        free(this->probeScratchPage);
+        this->probeScratchPage = nullptr;
+    }
+}
+
+bool SpillingHashJoin::buildSpilled(int partitionId,
+                                    void* page,
+                                    size_t pageSize,
+                                    DataProxyPtr proxy) {
+    SpillPartition& partition = this->partitions[partitionId];
+    UseTemporaryAllocationBlockPtr block =
+        std::make_shared<UseTemporaryAllocationBlock>(page, pageSize);
+    getAllocator().setPolicy(AllocatorPolicy::noReuseAllocator);
+    Handle<Object> hashTable = partition.merger->createNewOutputContainer();
+
+    // we go on from where the last part stopped
+    bool isFull = false;
+    while (isFull == false) {
+        if (partition.isMerging) {
+            if (partition.merger->writePartitionOut(hashTable) == false) {
+                if (partition.merger->hasFailed()) {
+                    // building it again would not help, as the hash table was empty
+                    this->logger->error("SpillingHashJoin: the spilled build side of partition " +
+                                        std::to_string(partitionId) + " of " +
+                                        this->setNamePrefix + " does not fit in a hash table");
+                    break;
+                }
+                isFull = true;
+                break;
+            }
+            partition.isMerging = false;
+        }
+        if ((partition.buildRecords != nullptr) && partition.buildRecords->hasNext()) {
+            Record<Object>* record = partition.buildRecords->next();
+            if (record != nullptr) {
+                partition.merger->startPartition(record->getRootObject(), partitionId);
+                partition.isMerging = true;
+            }
+            continue;
+        }
+        if (partition.buildPage != nullptr) {
+            partition.buildRecords = nullptr;
+            proxy->unpinTempPage(partition.build.setId, partition.buildPage);
+            partition.buildPage = nullptr;
+        }
+        if (partition.nextBuildPage == partition.build.pageIds.size()) {
+            break;
+        }
+        PageID pageId = partition.build.pageIds[partition.nextBuildPage];
+        partition.nextBuildPage++;
+        if (proxy->pinTempPage(partition.build.setId, pageId, partition.buildPage) == false) {
+            this->logger->error("SpillingHashJoin: can't pin page " + std::to_string(pageId) +
+                                " of temp set " + std::to_string(partition.build.setId));
+            partition.buildPage = nullptr;
+            continue;
+        }
+        partition.buildRecords = std::make_shared<RecordIterator>(partition.buildPage);
+    }
+    getRecord(hashTable);
+    getAllocator().setPolicy(AllocatorPolicy::defaultAllocator);
+
+    // let go of the page before the handles to it, so that they do not free what is on it
+    block = nullptr;
+    return (isFull == false);
+}
+
+void SpillingHashJoin::feedProbePages(int partitionId,
+                                      PageCircularBufferPtr buffer,
+                                      DataProxyPtr proxy) {
+    SpillSide& probe = this->partitions[partitionId].probe;
+    for (PageID pageId : probe.pageIds) {
+        PDBPagePtr page;
+        if (proxy->pinTempPage(probe.setId, pageId, page) == false) {
+            this->logger->error("SpillingHashJoin: can't pin page " + std::to_string(pageId) +
+                                " of temp set " + std::to_string(probe.setId));
+            continue;
+        }
+        page->incRefCount();
+        buffer->addPageToTail(page);
+    }
+    buffer->close();
+}
+
+void SpillingHashJoin::removeSpilled(int partitionId, DataProxyPtr proxy) {
+    SpillPartition& partition = this->partitions[partitionId];
+    partition.buildRecords = nullptr;
+    if (partition.buildPage != nullptr) {
+        proxy->unpinTempPage(partition.build.setId, partition.buildPage);
+        partition.buildPage = nullptr;
+    }
+    removeSide(partition.build, proxy);
+    removeSide(partition.probe, proxy);
+    partition.isSpilled = false;
+    partition.merger = nullptr;
+}
+}
+
+#endif
@@ -74,8 +74,8 @@ public:
 protected:
 
   /**
-   * Approximates the size of the result of this algorithm. The default implementation simply returns the same size
-   * as the source set
+   * Approximates the size of the result of this algorithm. The default implementation asks the @see CostModel what
+   * the computations of the pipeline make of the source set
    * @return the size of the sets
    */
   virtual DataStatistics approximateResultSize(const StatisticsPtr &stats);
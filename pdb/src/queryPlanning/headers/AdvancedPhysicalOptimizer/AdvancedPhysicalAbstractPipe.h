@@ -20,6 +20,7 @@
 #define PDB_ADVANCEDPHYSICALNODE_H
 
 #include "AbstractPhysicalNode.h"
+#include "CostModel.h"
 
 namespace pdb {
 
@@ -155,13 +156,21 @@ class AdvancedPhysicalAbstractPipe : public AbstractPhysicalNode {
   const AdvancedPhysicalAbstractAlgorithmPtr &getSelectedAlgorithm() const;
 
   /**
-   * Return the cost of the pipeline based on the source operator cost
-   * the : formula cost = number_of_bytes / 1000000
+   * Return the cost of the pipeline, the seconds the @see CostModel estimates it takes to scan the source set and
+   * write what the computations of the pipeline make of it
    * @param stats - the statistics a about the sets
    * @return the cost - the cost
    */
   double getCost(const StatisticsPtr &stats) override;
 
+  /**
+   * Estimates the size of the tuple set this pipeline makes, from the source set if the pipeline has one, otherwise
+   * from the sets the tuple set comes from
+   * @param costModel - the model that estimates the tuple sets
+   * @return the estimate
+   */
+  CostEstimate getOutputEstimate(CostModel &costModel);
+
   /**
    * Returns true if this node is a source (starts with a ScanSet)
    * @return true if does false otherwise
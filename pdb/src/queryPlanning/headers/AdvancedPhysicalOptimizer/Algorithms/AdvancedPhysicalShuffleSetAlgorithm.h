@@ -34,12 +34,20 @@ public:
                                       const Handle<SetIdentifier> &source,
                                       const Handle<ComputePlan> &computePlan,
                                       const LogicalPlanPtr &logicalPlan,
-                                      const ConfigurationPtr &conf);
+                                      const ConfigurationPtr &conf,
+                                      bool coPartitioned = false);
 
   PhysicalOptimizerResultPtr generate(int nextStageID, const StatisticsPtr &stats) override;
 
   AdvancedPhysicalAbstractAlgorithmTypeID getType() override;
 
+ private:
+
+  /**
+   * True if the sides of the join are co-partitioned, then this side is partitioned on every node, not shuffled
+   */
+  bool coPartitioned;
+
 };
 
 }
@@ -42,7 +42,8 @@ class AdvancedPhysicalShuffledHashsetPipelineAlgorithm : public AdvancedPhysical
                                                    const Handle<SetIdentifier> &source,
                                                    const Handle<ComputePlan> &computePlan,
                                                    const LogicalPlanPtr &logicalPlan,
-                                                   const ConfigurationPtr &conf);
+                                                   const ConfigurationPtr &conf,
+                                                   bool coPartitioned = false);
 
   /**
    * Generates the stages for this algorithm
@@ -56,6 +57,13 @@ class AdvancedPhysicalShuffledHashsetPipelineAlgorithm : public AdvancedPhysical
    */
   AdvancedPhysicalAbstractAlgorithmTypeID getType() override;
 
+ private:
+
+  /**
+   * True if the sides of the join are co-partitioned, then this side is partitioned on every node, not shuffled
+   */
+  bool coPartitioned;
+
 };
 
 }
@@ -69,12 +69,32 @@ public:
    */
   void setHashSet(const string &hashSet);
 
- protected:
+  /**
+   * Returns the name of the member or the method this side of the join is joined on, if the join has one key
+   * that is a member or a method of the objects of the side, otherwise an empty string
+   * @return the name of the key
+   */
+  std::string getJoinKeyName();
+
+  /**
+   * Returns true if the @see CostModel finds that broadcasting the tuples this side makes to build a hash table on
+   * every node costs no more than shuffling both sides, a side whose hash table does not fit on a node is never
+   * broadcasted
+   * @param stats - the statistics about the sets
+   * @return the value
+   */
+  bool preferBroadcast(const StatisticsPtr &stats);
 
   /**
-   * This is the largest cost that can we can broadcast
+   * Returns true if both sides of the join scan sets that are partitioned with the same partition scheme, each
+   * on the key its side is joined on. Then the objects that join are on the same node, and the sides are
+   * repartitioned on every node instead of being shuffled.
+   * @param stats - the statistics that know the partitioning of the sets
+   * @return the value
    */
-  const double BROADCAST_JOIN_COST_THRESHOLD = 15000;
+  bool isCoPartitioned(const StatisticsPtr &stats);
+
+ protected:
 
   /**
    * When executed this will contain the name of the hash set this join side generated
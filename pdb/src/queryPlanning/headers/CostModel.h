@@ -0,0 +1,220 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PDB_COST_MODEL_H
+#define PDB_COST_MODEL_H
+
+#include "AbstractJobStage.h"
+#include "AtomicComputation.h"
+#include "ComputePlan.h"
+#include "Configuration.h"
+#include "SetIdentifier.h"
+#include "Statistics.h"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// the rates a node works at, in MB per second: the network, a scan of the pages of a set, hashing
+// the tuples of a join into or against a hash table, and spilling what does not fit in memory
+#ifndef COST_MODEL_NETWORK_MB_PER_SEC
+#define COST_MODEL_NETWORK_MB_PER_SEC DEFAULT_NETWORK_BANDWIDTH
+#endif
+
+#ifndef COST_MODEL_SCAN_MB_PER_SEC
+#define COST_MODEL_SCAN_MB_PER_SEC 2048
+#endif
+
+#ifndef COST_MODEL_HASH_MB_PER_SEC
+#define COST_MODEL_HASH_MB_PER_SEC 256
+#endif
+
+#ifndef COST_MODEL_SPILL_MB_PER_SEC
+#define COST_MODEL_SPILL_MB_PER_SEC 128
+#endif
+
+// a hash table takes this many times the bytes of the tuples hashed into it, and may use this part
+// of the memory of a node
+#ifndef COST_MODEL_HASH_TABLE_OVERHEAD
+#define COST_MODEL_HASH_TABLE_OVERHEAD 3.0
+#endif
+
+#ifndef COST_MODEL_HASH_MEMORY_FRACTION
+#define COST_MODEL_HASH_MEMORY_FRACTION 0.5
+#endif
+
+// the selectivities of the filters that have not run yet: an equality, and any other predicate
+#ifndef COST_MODEL_EQUALITY_SELECTIVITY
+#define COST_MODEL_EQUALITY_SELECTIVITY 0.1
+#endif
+
+#ifndef COST_MODEL_DEFAULT_SELECTIVITY
+#define COST_MODEL_DEFAULT_SELECTIVITY 0.5
+#endif
+
+// the output of an aggregation, for the part of its input
+#ifndef COST_MODEL_AGGREGATION_RATIO
+#define COST_MODEL_AGGREGATION_RATIO 0.1
+#endif
+
+namespace pdb {
+
+/**
+ * The estimated size of a set or of a tuple set, numTuples is 0 when only the bytes are known
+ */
+struct CostEstimate {
+
+  double numBytes = 0;
+  double numTuples = 0;
+};
+
+class CostModel;
+typedef std::shared_ptr<CostModel> CostModelPtr;
+
+/**
+ * This class estimates what the stages of a plan cost, for the physical optimizers to pick the sources to start
+ * from, the side of a join to build a hash table of, and the join algorithm.
+ *
+ * The sizes of the tuple sets are estimated from the statistics of the sets they come from: a filter keeps the part
+ * of its input given by the selectivity measured for its predicate on the stages that have run, or a default for it;
+ * a join keeps |L| * |R| / max(distinct keys of L, distinct keys of R) tuples, where the distinct keys are counted by
+ * the clients of the sets that are partitioned on the key, and are taken to be the tuples of the smaller side (a
+ * foreign key join) otherwise. The costs are the seconds a stage takes on every node: the time to scan its input, to
+ * send the bytes it shuffles or broadcasts over the network, to hash the tuples of a join, and to spill the part of a
+ * hash table that does not fit in the memory of a node. A broadcast hash table that does not fit can not be built.
+ *
+ * The model does not choose the join order or where the pipelines are cut: the joins run in the order of the logical
+ * plan, and the pipelines end where the plan has a pipeline breaker. The optimizers only use it to pick which of the
+ * sources to run first, which side of a join to build, and whether to broadcast or to shuffle it.
+ */
+class CostModel {
+
+ public:
+
+  CostModel(const StatisticsPtr &stats, const LogicalPlanPtr &logicalPlan);
+
+  /**
+   * Returns the size of a set from the statistics
+   */
+  CostEstimate getSetEstimate(const Handle<SetIdentifier> &set);
+
+  CostEstimate getSetEstimate(const std::string &databaseName, const std::string &setName);
+
+  /**
+   * Tells the model the size of a tuple set, for one that comes from a set that has been materialized
+   */
+  void setTupleSetEstimate(const std::string &tupleSetName, CostEstimate estimate);
+
+  /**
+   * Estimates the size of a tuple set of the logical plan from the sets it comes from
+   */
+  CostEstimate getTupleSetEstimate(const std::string &tupleSetName);
+
+  /**
+   * Estimates the size of what some computations of a pipeline make of their input: the tuple sets of a join that
+   * do not come from the pipeline are estimated with getTupleSetEstimate
+   */
+  CostEstimate applyComputations(CostEstimate input, const std::vector<AtomicComputationPtr> &computations);
+
+  /**
+   * Returns the selectivity of a filter
+   */
+  double getSelectivity(const AtomicComputationPtr &filter);
+
+  /**
+   * Estimates the output of the join of two tuple sets, given the hashed tuple sets the join gets
+   */
+  CostEstimate getJoinEstimate(CostEstimate left,
+                               CostEstimate right,
+                               const std::string &leftHashName,
+                               const std::string &rightHashName);
+
+  /**
+   * The cost of a pipeline that scans its input and writes its output
+   */
+  double getPipelineCost(CostEstimate input, CostEstimate output);
+
+  /**
+   * The cost of a join that broadcasts the build side to every node, infinite if its hash table does not fit
+   */
+  double getBroadcastJoinCost(CostEstimate build, CostEstimate probe);
+
+  /**
+   * The cost of a join that shuffles both sides by the hash of the key
+   */
+  double getShuffleJoinCost(CostEstimate build, CostEstimate probe);
+
+  /**
+   * The cost of a join of two sets that are partitioned on the key already
+   */
+  double getCoPartitionedJoinCost(CostEstimate build, CostEstimate probe);
+
+  /**
+   * The cost of the cheaper of a broadcast and a shuffle join
+   */
+  double getJoinCost(CostEstimate build, CostEstimate probe);
+
+  /**
+   * Returns true if a broadcast join is not more expensive than a shuffle join
+   */
+  bool preferBroadcast(CostEstimate build, CostEstimate probe);
+
+  /**
+   * Measures the selectivities of the filters of the pipelines that have run, from the bytes they read and wrote,
+   * and keeps them in the statistics for the filters with the same kind of predicate
+   */
+  static void learnSelectivities(std::vector<Handle<AbstractJobStage>> &stages, const StatisticsPtr &stats);
+
+ private:
+
+  /**
+   * Returns the kind of predicate of a filter, the type of the lambda that computes it
+   */
+  static std::string getPredicateType(const AtomicComputationPtr &filter, AtomicComputationList &computations);
+
+  /**
+   * Returns the number of distinct keys of the tuple set hashed by a HashLeft or a HashRight, 0 if not known, 1
+   * for a HashOne
+   */
+  size_t getNumDistinctKeys(const std::string &hashName);
+
+  /**
+   * The statistics of the sets and the selectivities
+   */
+  StatisticsPtr stats;
+
+  /**
+   * The plan the tuple sets are in
+   */
+  LogicalPlanPtr logicalPlan;
+
+  /**
+   * The tuple sets estimated so far
+   */
+  std::map<std::string, CostEstimate> tupleSetEstimates;
+
+  /**
+   * The cluster, with one node of DEFAULT_MEM_SIZE if it is not known
+   */
+  double numNodes;
+  double hashMemoryPerNode;
+};
+
+}
+
+#endif //PDB_COST_MODEL_H
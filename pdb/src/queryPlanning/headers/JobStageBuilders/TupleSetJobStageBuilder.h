@@ -124,6 +124,34 @@ public:
    */
   void setRepartitionJoin(bool repartitionJoinOrNot);
 
+  /**
+   * This is true if the JoinMaps are partitioned for this node only,
+   * because the sides of the join are co-partitioned
+   * @param localRepartitionOrNot
+   */
+  void setLocalRepartition(bool localRepartitionOrNot);
+
+  /**
+   * Sets the hash set of the other side of the join, the stage drops the tuples whose hash is not in the
+   * runtime filters of its hash tables before it shuffles them
+   * @param hashSetName the name of the hash set
+   */
+  void setRuntimeFilterHashSet(const std::string &hashSetName);
+
+  /**
+   * This is true if the stage shuffles the build side of a hash partitioned join, the heavy keys it finds are
+   * split over several partitions, and the other side is copied to all of them
+   * @param splitHeavyKeysOrNot
+   */
+  void setSplitHeavyKeys(bool splitHeavyKeysOrNot);
+
+  /**
+   * Sets the hash set of the other side of the join, the stage copies the tuples of the keys its build side split
+   * to all of their partitions, so it has to wait for them whether it applies the runtime filters or not
+   * @param hashSetName the name of the hash set
+   */
+  void setSplitKeysHashSet(const std::string &hashSetName);
+
 
   /**
    * This is true if we are running a pipeline with a hash partition sink
@@ -286,6 +314,26 @@ private:
    * for JoinMaps
    */
   bool isRepartitionJoin;
+
+  /**
+   * This is true if the JoinMaps are partitioned for this node only
+   */
+  bool isLocalRepartition;
+
+  /**
+   * The hash set whose runtime filters the stage applies, empty if none
+   */
+  std::string runtimeFilterHashSet;
+
+  /**
+   * This is true if the heavy keys of the build side are split
+   */
+  bool isSplittingHeavyKeys;
+
+  /**
+   * The hash set whose split keys the stage copies the tuples of, empty if none
+   */
+  std::string splitKeysHashSet;
   
   /**
    * This is true if we are running a pipeline with a hash partition sink
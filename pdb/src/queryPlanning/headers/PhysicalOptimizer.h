@@ -92,6 +92,12 @@ class PhysicalOptimizer {
   bool hasConsumers(Handle<SetIdentifier> &set);
 
 
+  /**
+   * Returns the identifiers of all the source nodes we still need to process
+   * @return a set of node identifiers
+   */
+  std::set<std::string> getSourceIdentifiers();
+
   /**
    * Returns the best source node based on heuristics
    * @return the node
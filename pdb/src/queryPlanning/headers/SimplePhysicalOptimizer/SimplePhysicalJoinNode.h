@@ -73,11 +73,6 @@ public:
 
 private:
 
-  /**
-   * This is the value where
-   */
-  const double BROADCAST_JOIN_COST_THRESHOLD = 15000;
-
   /**
    * Has one side of this join already been hashed?
    */
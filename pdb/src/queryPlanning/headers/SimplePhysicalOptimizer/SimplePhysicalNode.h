@@ -84,7 +84,8 @@ public:
   bool isConsuming(Handle<SetIdentifier> &set) override;
 
   /**
-   * Return the cost by calling the @see getCost method with the @see sourceSetIdentifier as a parameter.
+   * Return the seconds the @see CostModel estimates it takes to scan the @see sourceSetIdentifier and write what the
+   * pipeline that starts here makes of it, up to the first join, aggregation or node with more than one consumer
    * @param stats - the statistics about the sets
    * @return the cost value
    */
@@ -158,15 +159,6 @@ protected:
 
  protected:
 
-  /**
-   * This method calculates the cost of the provided source. The cost is calculated by the formula :
-   * cost = number_of_bytes / 1000000
-   * @param source
-   * @param stats
-   * @return the const
-   */
-  double getCost(Handle<SetIdentifier> source, const StatisticsPtr &stats);
-
   /**
    * This method returns the set identifier of the source if this node is a source, returns null otherwise
    * @return the set identifier
@@ -0,0 +1,231 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PDB_STAGE_DEPENDENCY_GRAPH_H
+#define PDB_STAGE_DEPENDENCY_GRAPH_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include "Handle.h"
+#include "AbstractJobStage.h"
+
+namespace pdb {
+
+class StageDependencyGraph;
+typedef std::shared_ptr<StageDependencyGraph> StageDependencyGraphPtr;
+
+/**
+ * The state of one (stage, node) pair while the graph is being executed
+ */
+enum StageTaskState {
+  StageTaskWaiting,
+  StageTaskRunning,
+  StageTaskFinished,
+  StageTaskFailed,
+  StageTaskCancelled
+};
+
+/**
+ * This class is used by the @see pdb::QuerySchedulerServer to schedule a sequence of job stages as a DAG instead of
+ * running them one after another with a cluster wide barrier between them.
+ *
+ * Every stage is executed once on every node, so the unit of scheduling is a (stage, node) pair, we call it a task.
+ * A stage depends on an earlier stage if it reads a set or a hash set the earlier stage writes. A dependency is
+ * either:
+ *
+ * -- local : the producer only writes to the node it runs on, so the consumer on node n only needs to wait for the
+ *            producer on node n to finish (for example a hash table build followed by a probe)
+ * -- global : the producer sends data to other nodes (repartition, broadcast, collect as map), so the consumer on
+ *             any node has to wait until the producer finished on every node; a stage that applies the runtime
+ *             filters of a hash table depends globally on its build, as the filters come from every node
+ *
+ * Stages that do not depend on each other (for example the two build sides of a join) can run at the same time.
+ * A task that depends on a failed task never runs, it is cancelled, and so are the tasks that depend on it.
+ * The graph also records the start and end time of every task, so that we can report how long each stage took and
+ * how much time a stage-by-stage barrier would have cost.
+ */
+class StageDependencyGraph {
+ public:
+
+  /**
+   * Creates the dependency graph for the provided stages. The stages are expected to be in the order the physical
+   * optimizer generated them, a stage can only depend on stages that come before it.
+   * @param stages the stages we want to schedule
+   * @param numNodes the number of nodes every stage is executed on
+   */
+  StageDependencyGraph(std::vector<Handle<AbstractJobStage>> &stages, unsigned long numNodes);
+
+  ~StageDependencyGraph();
+
+  /**
+   * Returns all the tasks whose dependencies are satisfied and marks them as running, the tasks that depend on a
+   * failed or cancelled task are marked as cancelled instead
+   * @return a vector of (stage index, node) pairs
+   */
+  std::vector<std::pair<size_t, unsigned long>> takeReadyTasks();
+
+  /**
+   * Marks a task as finished and wakes up the thread waiting in @see StageDependencyGraph#waitForProgress
+   * This method is thread safe.
+   * @param stage the index of the stage
+   * @param node the node the stage was running on
+   * @param success true if the stage finished successfully on the node
+   */
+  void markFinished(size_t stage, unsigned long node, bool success);
+
+  /**
+   * Blocks until some task finishes, returns immediately if a task has finished since the last call
+   */
+  void waitForProgress();
+
+  /**
+   * Returns true if every task has finished
+   * @return true if we are done, false otherwise
+   */
+  bool isFinished();
+
+  /**
+   * Returns the number of tasks that failed, not counting the ones that were cancelled
+   * @return the number
+   */
+  size_t getNumFailed();
+
+  /**
+   * Returns the number of tasks that were cancelled because a task they depend on failed
+   * @return the number
+   */
+  size_t getNumCancelled();
+
+  /**
+   * Prints out the timing for each stage, and compares the time we needed to execute the whole graph with the time
+   * we would have needed if every stage waited for the previous one to finish on all nodes
+   */
+  void printStageTimings();
+
+  /**
+   * Returns true if the provided stage can send data to other nodes than the one it is running on
+   * @param stage the stage
+   * @return true if it does, false otherwise
+   */
+  static bool isExchangingData(Handle<AbstractJobStage> &stage);
+
+  /**
+   * Returns the names of all the sets and hash sets a stage reads
+   * @param stage the stage
+   * @param inputs the vector where we put the names
+   */
+  static void getStageInputs(Handle<AbstractJobStage> &stage, std::vector<std::string> &inputs);
+
+  /**
+   * Returns the names of all the sets and hash sets a stage writes
+   * @param stage the stage
+   * @param outputs the vector where we put the names
+   */
+  static void getStageOutputs(Handle<AbstractJobStage> &stage, std::vector<std::string> &outputs);
+
+ private:
+
+  typedef std::chrono::steady_clock::time_point TimePoint;
+
+  /**
+   * Returns true if all the dependencies of the task are satisfied, must be called with the graph mutex locked
+   * @param stage the index of the stage
+   * @param node the node
+   * @return true if it can run, false otherwise
+   */
+  bool isReady(size_t stage, unsigned long node);
+
+  /**
+   * Returns true if a task this task depends on failed or was cancelled, must be called with the graph mutex locked
+   * @param stage the index of the stage
+   * @param node the node
+   * @return true if it can never run, false otherwise
+   */
+  bool hasFailedProducer(size_t stage, unsigned long node);
+
+  /**
+   * Returns the time in seconds between two time points
+   */
+  static double toSeconds(const TimePoint &begin, const TimePoint &end);
+
+  /**
+   * The stages we are scheduling
+   */
+  std::vector<Handle<AbstractJobStage>> stages;
+
+  /**
+   * The number of nodes each stage runs on
+   */
+  unsigned long numNodes;
+
+  /**
+   * For each stage the indices of the stages it depends on locally
+   */
+  std::vector<std::vector<size_t>> localProducers;
+
+  /**
+   * For each stage the indices of the stages it depends on globally
+   */
+  std::vector<std::vector<size_t>> globalProducers;
+
+  /**
+   * The state of each task, indexed as [stage][node]
+   */
+  std::vector<std::vector<StageTaskState>> states;
+
+  /**
+   * The number of nodes each stage has finished on successfully, and failed or was cancelled on
+   */
+  std::vector<unsigned long> numFinishedNodes;
+  std::vector<unsigned long> numFailedNodes;
+
+  /**
+   * The start and end time of each task, indexed as [stage][node]
+   */
+  std::vector<std::vector<TimePoint>> startTimes;
+  std::vector<std::vector<TimePoint>> endTimes;
+
+  /**
+   * The time the graph was created, used as the reference point for the timings
+   */
+  TimePoint creationTime;
+
+  /**
+   * The total number of finished tasks, whatever their outcome, and of the failed and cancelled ones among them
+   */
+  size_t numFinished;
+  size_t numFailed;
+  size_t numCancelled;
+
+  /**
+   * Set to true by markFinished and when tasks are cancelled, reset by waitForProgress
+   */
+  bool progressMade;
+
+  /**
+   * Protects the state of the graph, and the signal we use to wake up the scheduling thread
+   */
+  pthread_mutex_t graphMutex;
+  pthread_cond_t progressSignal;
+};
+
+}
+
+#endif //PDB_STAGE_DEPENDENCY_GRAPH_H
@@ -20,6 +20,7 @@
 
 #include <memory>
 #include <pthread.h>
+#include <string>
 #include <unordered_map>
 
 namespace pdb {
@@ -36,8 +37,13 @@ struct DataStatistics {
   int numPages = 0;
   size_t pageSize = 0;
   size_t numBytes = 0;
-  int numTuples = 0;
+  size_t numTuples = 0;
   size_t avgTupleSize = 0;
+  // the estimated number of distinct values of a key of the set, by the name of the key
+  std::unordered_map<std::string, size_t> numDistinctKeys;
+  // how a set that is partitioned by key maps its keys to nodes, and the key, empty otherwise
+  std::string partitionScheme;
+  std::string partitionKey;
 };
 
 class Statistics {
@@ -46,6 +52,9 @@ private:
   std::unordered_map<std::string, DataStatistics> dataStatistics;
   std::unordered_map<std::string, double> atomicComputationSelectivity;
   std::unordered_map<std::string, double> lambdaSelectivity;
+  // the cluster the sets are on, 0 if not known
+  int numNodes = 0;
+  size_t memoryPerNode = 0;
   pthread_mutex_t mutex;
 
 public:
@@ -82,6 +91,9 @@ public:
     std::string key = databaseName + ":" + setName;
     std::string aliasKey = aliasDatabase + ":" + aliasSetName;
     dataStatistics[aliasKey] = dataStatistics[key];
+    // the alias is not stored with the policy of the original set
+    dataStatistics[aliasKey].partitionScheme = "";
+    dataStatistics[aliasKey].partitionKey = "";
   }
 
   // to return number of pages of a set
@@ -157,11 +169,11 @@ public:
     pthread_mutex_unlock(&mutex);
   }
 
-  // to return number of tuples of a set
-  int getNumTuples(std::string databaseName, std::string setName) {
+  // to return number of tuples of a set, 0 if not known
+  size_t getNumTuples(std::string databaseName, std::string setName) {
     std::string key = databaseName + ":" + setName;
     if (dataStatistics.count(key) == 0) {
-      return -1;
+      return 0;
     } else {
       return dataStatistics[key].numTuples;
     }
@@ -169,13 +181,42 @@ public:
 
   // to set number of tuples of a set
   void setNumTuples(std::string databaseName, std::string setName,
-                    int numTuples) {
+                    size_t numTuples) {
     std::string key = databaseName + ":" + setName;
     pthread_mutex_lock(&mutex);
     dataStatistics[key].numTuples = numTuples;
     pthread_mutex_unlock(&mutex);
   }
 
+  // to increment number of tuples of a set
+  void incrementNumTuples(std::string databaseName, std::string setName, size_t numTuples) {
+    std::string key = databaseName + ":" + setName;
+    pthread_mutex_lock(&mutex);
+    dataStatistics[key].numTuples += numTuples;
+    pthread_mutex_unlock(&mutex);
+  }
+
+  // to return the number of distinct values of a key of a set, 0 if not known
+  size_t getNumDistinctKeys(std::string databaseName, std::string setName,
+                            std::string keyName) {
+    std::string key = databaseName + ":" + setName;
+    if ((dataStatistics.count(key) == 0) ||
+        (dataStatistics[key].numDistinctKeys.count(keyName) == 0)) {
+      return 0;
+    } else {
+      return dataStatistics[key].numDistinctKeys[keyName];
+    }
+  }
+
+  // to set the number of distinct values of a key of a set
+  void setNumDistinctKeys(std::string databaseName, std::string setName,
+                          std::string keyName, size_t numDistinctKeys) {
+    std::string key = databaseName + ":" + setName;
+    pthread_mutex_lock(&mutex);
+    dataStatistics[key].numDistinctKeys[keyName] = numDistinctKeys;
+    pthread_mutex_unlock(&mutex);
+  }
+
   // to return average tuple size of a set
   size_t getAvgTupleSize(std::string databaseName, std::string setName) {
     std::string key = databaseName + ":" + setName;
@@ -195,6 +236,36 @@ public:
     pthread_mutex_unlock(&mutex);
   }
 
+  // to return the partition scheme of a set, empty if the set is not partitioned by key
+  std::string getPartitionScheme(std::string databaseName, std::string setName) {
+    std::string key = databaseName + ":" + setName;
+    if (dataStatistics.count(key) == 0) {
+      return "";
+    } else {
+      return dataStatistics[key].partitionScheme;
+    }
+  }
+
+  // to return the member or the method a set is partitioned on
+  std::string getPartitionKey(std::string databaseName, std::string setName) {
+    std::string key = databaseName + ":" + setName;
+    if (dataStatistics.count(key) == 0) {
+      return "";
+    } else {
+      return dataStatistics[key].partitionKey;
+    }
+  }
+
+  // to set how a set is partitioned by key
+  void setPartitioning(std::string databaseName, std::string setName,
+                       std::string partitionScheme, std::string partitionKey) {
+    std::string key = databaseName + ":" + setName;
+    pthread_mutex_lock(&mutex);
+    dataStatistics[key].partitionScheme = partitionScheme;
+    dataStatistics[key].partitionKey = partitionKey;
+    pthread_mutex_unlock(&mutex);
+  }
+
   // to return selectivity of an atomic computation
   double getAtomicComputationSelectivity(std::string atomicComputationType) {
     if (atomicComputationSelectivity.count(atomicComputationType) == 0) {
@@ -228,6 +299,24 @@ public:
     pthread_mutex_unlock(&mutex);
   }
 
+  // to return the number of nodes of the cluster, 0 if not known
+  int getNumNodes() {
+    return numNodes;
+  }
+
+  // to return the memory of a node in KB, 0 if not known
+  size_t getMemoryPerNode() {
+    return memoryPerNode;
+  }
+
+  // to set the cluster the sets are on, with the memory of its smallest node in KB
+  void setClusterResources(int numNodes, size_t memoryPerNode) {
+    pthread_mutex_lock(&mutex);
+    this->numNodes = numNodes;
+    this->memoryPerNode = memoryPerNode;
+    pthread_mutex_unlock(&mutex);
+  }
+
   /**
    * This method prints out all the sets in the statistics object
    */
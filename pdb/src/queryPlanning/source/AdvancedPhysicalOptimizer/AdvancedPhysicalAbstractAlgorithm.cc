@@ -17,6 +17,7 @@
  *****************************************************************************/
 
 #include "AdvancedPhysicalOptimizer/AdvancedPhysicalAbstractAlgorithm.h"
+#include "CostModel.h"
 
 AdvancedPhysicalAbstractAlgorithm::AdvancedPhysicalAbstractAlgorithm(const AdvancedPhysicalPipelineNodePtr &handle,
                                                                      const std::string &jobID,
@@ -76,19 +77,23 @@ void AdvancedPhysicalAbstractAlgorithm::updateConsumers(const Handle<SetIdentifi
 
 DataStatistics AdvancedPhysicalAbstractAlgorithm::approximateResultSize(const StatisticsPtr &stats) {
 
-  // TODO this is a silly approximation, the size is never the same we need something better...
-
   // an algorithm should always have a source set
   assert(source != nullptr);
 
   // temp variables
   DataStatistics ds;
 
+  // estimate what the computations of the pipeline make of the source set
+  CostModel costModel(stats, logicalPlan);
+  std::vector<AtomicComputationPtr> computations(pipelineComputations.begin(), pipelineComputations.end());
+  CostEstimate input = costModel.getSetEstimate(source);
+  CostEstimate output = costModel.applyComputations(input, computations);
+
   // set the set stats
   ds.pageSize = stats != nullptr ? stats->getPageSize(source->getDatabase(), source->getSetName()) : 0;
-  ds.numTuples = stats != nullptr ? stats->getNumTuples(source->getDatabase(), source->getSetName()) : 0;
-  ds.numBytes = stats != nullptr ? stats->getNumBytes(source->getDatabase(), source->getSetName()) : 0;
-  ds.avgTupleSize = stats != nullptr ? stats->getAvgTupleSize(source->getDatabase(), source->getSetName()) : 0;
+  ds.numTuples = (size_t) output.numTuples;
+  ds.numBytes = (size_t) output.numBytes;
+  ds.avgTupleSize = ds.numTuples != 0 ? ds.numBytes / ds.numTuples : 0;
 
   // get the size of the source set in bytes
   return ds;
@@ -226,9 +226,20 @@ double AdvancedPhysicalAbstractPipe::getCost(const StatisticsPtr &stats) {
     return 0;
   }
 
-  // calculate the cost based on the formula cost = number_of_bytes / 1000000
-  double cost = stats->getNumBytes(sourceSetIdentifier->getDatabase(), sourceSetIdentifier->getSetName());
-  return double((size_t) cost / 1000000);
+  // the cost of scanning the source set and writing what the computations of this pipe make of it
+  CostModel costModel(stats, logicalPlan);
+  return costModel.getPipelineCost(costModel.getSetEstimate(sourceSetIdentifier), getOutputEstimate(costModel));
+}
+
+CostEstimate AdvancedPhysicalAbstractPipe::getOutputEstimate(CostModel &costModel) {
+
+  // a pipe that has not got its source set yet makes what the sets of the plan make
+  if (sourceSetIdentifier == nullptr) {
+    return pipeComputations.empty() ? CostEstimate()
+                                    : costModel.getTupleSetEstimate(pipeComputations.back()->getOutputName());
+  }
+
+  return costModel.applyComputations(costModel.getSetEstimate(sourceSetIdentifier), pipeComputations);
 }
 
 const AdvancedPhysicalAbstractAlgorithmPtr &AdvancedPhysicalAbstractPipe::getSelectedAlgorithm() const {
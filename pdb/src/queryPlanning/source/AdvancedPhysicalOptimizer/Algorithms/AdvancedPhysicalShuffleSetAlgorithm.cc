@@ -28,14 +28,16 @@ AdvancedPhysicalShuffleSetAlgorithm::AdvancedPhysicalShuffleSetAlgorithm(const A
                                                                          const Handle<SetIdentifier> &source,
                                                                          const Handle<ComputePlan> &computePlan,
                                                                          const LogicalPlanPtr &logicalPlan,
-                                                                         const ConfigurationPtr &conf) : AdvancedPhysicalAbstractAlgorithm(handle,
-                                                                                                                                           jobID,
-                                                                                                                                           isProbing,
-                                                                                                                                           isOutput,
-                                                                                                                                           source,
-                                                                                                                                           computePlan,
-                                                                                                                                           logicalPlan,
-                                                                                                                                           conf) {}
+                                                                         const ConfigurationPtr &conf,
+                                                                         bool coPartitioned) : AdvancedPhysicalAbstractAlgorithm(handle,
+                                                                                                                                 jobID,
+                                                                                                                                 isProbing,
+                                                                                                                                 isOutput,
+                                                                                                                                 source,
+                                                                                                                                 computePlan,
+                                                                                                                                 logicalPlan,
+                                                                                                                                 conf),
+                                                                                               coPartitioned(coPartitioned) {}
 PhysicalOptimizerResultPtr AdvancedPhysicalShuffleSetAlgorithm::generate(int nextStageID,
                                                                          const StatisticsPtr &stats) {
 
@@ -97,12 +99,26 @@ PhysicalOptimizerResultPtr AdvancedPhysicalShuffleSetAlgorithm::generate(int nex
   tupleStageBuilder->setRepartition(true);
   tupleStageBuilder->setAllocatorPolicy(curComp->getAllocatorPolicy());
   tupleStageBuilder->setRepartitionJoin(true);
+  tupleStageBuilder->setLocalRepartition(coPartitioned);
 
   // add all the probing hash sets
   for(auto it : probingHashSets) {
     tupleStageBuilder->addHashSetToProbe(it.first, it.second);
   }
 
+  // the other side has already built its hash tables, so we drop the tuples that do not join before we shuffle
+  // them, the filters are partitioned the way the tuples are shuffled to the nodes, so we can not do it if we
+  // only repartition on the node; for the same reason the other side only splits its heavy keys if we shuffle
+  // to all the nodes, then we copy the tuples of those keys to all of their partitions
+  if(!coPartitioned) {
+    auto joinHashSets = pipeline.back()->getConsumer(0)->to<AdvancedPhysicalAbstractPipe>()->getProbingHashSets();
+    auto joinHashSet = joinHashSets.find(outputName);
+    if(joinHashSet != joinHashSets.end()) {
+      tupleStageBuilder->setRuntimeFilterHashSet(joinHashSet->second);
+      tupleStageBuilder->setSplitKeysHashSet(joinHashSet->second);
+    }
+  }
+
   // update the consumers
   updateConsumers(sink, approximateResultSize(stats), stats);
 
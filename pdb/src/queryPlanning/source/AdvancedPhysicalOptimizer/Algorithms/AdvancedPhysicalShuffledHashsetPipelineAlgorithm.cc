@@ -29,7 +29,8 @@ AdvancedPhysicalShuffledHashsetPipelineAlgorithm::AdvancedPhysicalShuffledHashse
                                                                                    const Handle<SetIdentifier> &source,
                                                                                    const Handle<ComputePlan> &computePlan,
                                                                                    const LogicalPlanPtr &logicalPlan,
-                                                                                   const ConfigurationPtr &conf)
+                                                                                   const ConfigurationPtr &conf,
+                                                                                   bool coPartitioned)
                                                                                    : AdvancedPhysicalAbstractAlgorithm(handle,
                                                                                                                        jobID,
                                                                                                                        isProbing,
@@ -37,7 +38,8 @@ AdvancedPhysicalShuffledHashsetPipelineAlgorithm::AdvancedPhysicalShuffledHashse
                                                                                                                        source,
                                                                                                                        computePlan,
                                                                                                                        logicalPlan,
-                                                                                                                       conf) {}
+                                                                                                                       conf),
+                                                                                     coPartitioned(coPartitioned) {}
 
 PhysicalOptimizerResultPtr AdvancedPhysicalShuffledHashsetPipelineAlgorithm::generate(int nextStageID,
                                                                                       const StatisticsPtr &stats) {
@@ -112,6 +114,11 @@ PhysicalOptimizerResultPtr AdvancedPhysicalShuffledHashsetPipelineAlgorithm::gen
   tupleStageBuilder->setRepartition(true);
   tupleStageBuilder->setAllocatorPolicy(curComp->getAllocatorPolicy());
   tupleStageBuilder->setRepartitionJoin(true);
+  tupleStageBuilder->setLocalRepartition(coPartitioned);
+
+  // the other side is shuffled after our hash tables are built, so it can be copied to all of the partitions of the
+  // keys we split, if the sides are co-partitioned it is not, and we can not split them
+  tupleStageBuilder->setSplitHeavyKeys(!coPartitioned);
 
   // add all the probing hash sets
   for(auto it : probingHashSets) {
@@ -51,8 +51,45 @@ vector<AdvancedPhysicalAbstractAlgorithmPtr> AdvancedPhysicalJoinSidePipe::getPo
   // all the algorithms that we can use
   vector<AdvancedPhysicalAbstractAlgorithmPtr> algorithms;
 
-  // check if we can use a broadcast algorithm
-  if (getCost(stats) < BROADCAST_JOIN_COST_THRESHOLD) {
+  // if the sides are co-partitioned, nothing has to go over the network, so we hash partition the sides locally
+  if (isCoPartitioned(stats)) {
+
+    // build a hash set from the partitions of this side on every node
+    algorithms.push_back(std::make_shared<AdvancedPhysicalShuffledHashsetPipelineAlgorithm>(getAdvancedPhysicalNodeHandle(),
+                                                                                            jobId,
+                                                                                            isJoining(),
+                                                                                            consumers.empty(),
+                                                                                            sourceSetIdentifier,
+                                                                                            computePlan,
+                                                                                            logicalPlan,
+                                                                                            conf,
+                                                                                            true));
+
+    // or partition this side on every node to probe the hash set of the other side
+    algorithms.push_back(std::make_shared<AdvancedPhysicalShuffleSetAlgorithm>(getAdvancedPhysicalNodeHandle(),
+                                                                               jobId,
+                                                                               isJoining(),
+                                                                               consumers.empty(),
+                                                                               sourceSetIdentifier,
+                                                                               computePlan,
+                                                                               logicalPlan,
+                                                                               conf,
+                                                                               true));
+
+    // we can always do a pipeline algorithm on this single pipe
+    algorithms.push_back(std::make_shared<AdvancedPhysicalPipelineAlgorithm>(getAdvancedPhysicalNodeHandle(),
+                                                                             jobId,
+                                                                             isJoining(),
+                                                                             consumers.empty(),
+                                                                             sourceSetIdentifier,
+                                                                             computePlan,
+                                                                             logicalPlan,
+                                                                             conf));
+    return algorithms;
+  }
+
+  // check if broadcasting this side costs no more than shuffling both sides
+  if (preferBroadcast(stats)) {
     algorithms.push_back(std::make_shared<AdvancedPhysicalJoinBroadcastedHashsetAlgorithm>(getAdvancedPhysicalNodeHandle(),
                                                                                            jobId,
                                                                                            isJoining(),
@@ -112,4 +149,101 @@ void AdvancedPhysicalJoinSidePipe::setHashSet(const string &hashSet) {
   this->hashSet = hashSet;
 }
 
+std::string AdvancedPhysicalJoinSidePipe::getJoinKeyName() {
+
+  // find the hash of this side, a join on more than one key is not partitioned on one of them
+  AtomicComputationPtr hash = nullptr;
+  for (auto &it : pipeComputations) {
+    if (it->getAtomicComputationTypeID() == HashLeftTypeID || it->getAtomicComputationTypeID() == HashRightTypeID) {
+      if (hash != nullptr) {
+        return "";
+      }
+      hash = it;
+    }
+  }
+  if (hash == nullptr || hash->getInput().getAtts().size() != 1) {
+    return "";
+  }
+
+  // the hashed column is made by the lambda that extracts the key
+  for (auto &it : pipeComputations) {
+    if (it->getAtomicComputationTypeID() == ApplyLambdaTypeID &&
+        it->getOutputName() == hash->getInputName() &&
+        it->getOutput().getAtts().back() == hash->getInput().getAtts().front()) {
+
+      // the lambda tells us the member or the method it gets
+      auto &info = it->getKeyValuePairs();
+      if (info == nullptr) {
+        return "";
+      }
+      if (info->count("attName") != 0) {
+        return (*info)["attName"];
+      }
+      if (info->count("methodName") != 0) {
+        return (*info)["methodName"];
+      }
+      return "";
+    }
+  }
+
+  return "";
+}
+
+bool AdvancedPhysicalJoinSidePipe::preferBroadcast(const StatisticsPtr &stats) {
+
+  // estimate this side and the side it joins with
+  CostModel costModel(stats, logicalPlan);
+  CostEstimate thisSide = getOutputEstimate(costModel);
+  CostEstimate otherSide;
+  if (consumers.size() == 1) {
+    auto join = consumers.front();
+    for (int i = 0; i < join->getNumProducers(); ++i) {
+      auto side = join->getProducer(i)->to<AdvancedPhysicalAbstractPipe>();
+      if (side.get() != this) {
+        otherSide = side->getOutputEstimate(costModel);
+      }
+    }
+  }
+
+  return costModel.preferBroadcast(thisSide, otherSide);
+}
+
+bool AdvancedPhysicalJoinSidePipe::isCoPartitioned(const StatisticsPtr &stats) {
+
+  // we need to know the partitioning of the sets and the join
+  if (stats == nullptr || consumers.size() != 1) {
+    return false;
+  }
+
+  // both sides have to scan a set that is partitioned on the key of the side
+  auto join = consumers.front();
+  if (join->getNumProducers() != 2) {
+    return false;
+  }
+  std::string partitionScheme;
+  for (int i = 0; i < join->getNumProducers(); ++i) {
+
+    // grab the side
+    auto side = join->getProducer(i)->to<AdvancedPhysicalJoinSidePipe>();
+    if (side == nullptr || !side->isSource() || side->getSourceSetIdentifier() == nullptr) {
+      return false;
+    }
+
+    // grab the partitioning of the set
+    std::string database = side->getSourceSetIdentifier()->getDatabase();
+    std::string set = side->getSourceSetIdentifier()->getSetName();
+    std::string scheme = stats->getPartitionScheme(database, set);
+    std::string key = stats->getPartitionKey(database, set);
+
+    // the set has to be partitioned on the key, with the scheme of the other side
+    if (scheme.empty() || key.empty() || key != side->getJoinKeyName() ||
+        (!partitionScheme.empty() && scheme != partitionScheme)) {
+      return false;
+    }
+    partitionScheme = scheme;
+  }
+
+  return true;
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,404 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#include <algorithm>
+#include <limits>
+#include <set>
+#include "CostModel.h"
+#include "PDBDebug.h"
+#include "AtomicComputationClasses.h"
+#include "TupleSetJobStage.h"
+
+namespace pdb {
+
+// the bytes of a MB, the rates of the model are in MB per second
+static const double BYTES_PER_MB = 1024.0 * 1024.0;
+
+// scales an estimate by the part of the tuples that are kept
+static CostEstimate scaleEstimate(CostEstimate estimate, double ratio) {
+  estimate.numBytes *= ratio;
+  estimate.numTuples *= ratio;
+  return estimate;
+}
+
+CostModel::CostModel(const StatisticsPtr &stats, const LogicalPlanPtr &logicalPlan) : stats(stats),
+                                                                                     logicalPlan(logicalPlan) {
+
+  // the cluster, if the statistics know it
+  numNodes = (stats != nullptr && stats->getNumNodes() > 0) ? stats->getNumNodes() : 1;
+  size_t memoryPerNode = (stats != nullptr && stats->getMemoryPerNode() > 0) ? stats->getMemoryPerNode()
+                                                                              : DEFAULT_MEM_SIZE;
+
+  // the memory is in KB
+  hashMemoryPerNode = (double) memoryPerNode * 1024.0 * COST_MODEL_HASH_MEMORY_FRACTION;
+}
+
+CostEstimate CostModel::getSetEstimate(const Handle<SetIdentifier> &set) {
+
+  // no set, nothing to estimate
+  if (set == nullptr) {
+    return CostEstimate();
+  }
+
+  return getSetEstimate(set->getDatabase(), set->getSetName());
+}
+
+CostEstimate CostModel::getSetEstimate(const std::string &databaseName, const std::string &setName) {
+
+  CostEstimate estimate;
+  if (stats == nullptr) {
+    return estimate;
+  }
+
+  estimate.numBytes = stats->getNumBytes(databaseName, setName);
+  estimate.numTuples = stats->getNumTuples(databaseName, setName);
+  return estimate;
+}
+
+void CostModel::setTupleSetEstimate(const std::string &tupleSetName, CostEstimate estimate) {
+  tupleSetEstimates[tupleSetName] = estimate;
+}
+
+CostEstimate CostModel::getTupleSetEstimate(const std::string &tupleSetName) {
+
+  // did we estimate it already
+  auto it = tupleSetEstimates.find(tupleSetName);
+  if (it != tupleSetEstimates.end()) {
+    return it->second;
+  }
+
+  // without a plan we know nothing about the tuple set
+  CostEstimate estimate;
+  if (logicalPlan == nullptr) {
+    return estimate;
+  }
+
+  // grab the computation that makes the tuple set
+  AtomicComputationPtr computation = logicalPlan->getComputations().getProducingAtomicComputation(tupleSetName);
+  if (computation == nullptr) {
+    return estimate;
+  }
+
+  switch (computation->getAtomicComputationTypeID()) {
+
+    // a scan is as large as its set
+    case ScanSetAtomicTypeID: {
+      auto scan = std::dynamic_pointer_cast<ScanSet>(computation);
+      estimate = getSetEstimate(scan->getDBName(), scan->getSetName());
+      break;
+    }
+
+    // a join depends on both of its inputs
+    case ApplyJoinTypeID: {
+      auto join = std::dynamic_pointer_cast<ApplyJoin>(computation);
+      estimate = getJoinEstimate(getTupleSetEstimate(join->getInputName()),
+                                 getTupleSetEstimate(join->getRightInput().getSetName()),
+                                 join->getInputName(),
+                                 join->getRightInput().getSetName());
+      break;
+    }
+
+    // everything else has one input, the filters and the aggregations change its size
+    default: {
+      estimate = applyComputations(getTupleSetEstimate(computation->getInputName()), {computation});
+      break;
+    }
+  }
+
+  tupleSetEstimates[tupleSetName] = estimate;
+  return estimate;
+}
+
+CostEstimate CostModel::applyComputations(CostEstimate input, const std::vector<AtomicComputationPtr> &computations) {
+
+  // the tuple sets made in this pipeline
+  std::set<std::string> madeHere;
+  for (auto &computation : computations) {
+    madeHere.insert(computation->getOutputName());
+  }
+
+  CostEstimate estimate = input;
+  for (auto &computation : computations) {
+    switch (computation->getAtomicComputationTypeID()) {
+
+      case ApplyFilterTypeID: {
+        estimate = scaleEstimate(estimate, getSelectivity(computation));
+        break;
+      }
+
+      case ApplyAggTypeID: {
+        estimate = scaleEstimate(estimate, COST_MODEL_AGGREGATION_RATIO);
+        break;
+      }
+
+      // the side of the join that is not made in this pipeline comes from a hash table
+      case ApplyJoinTypeID: {
+        auto join = std::dynamic_pointer_cast<ApplyJoin>(computation);
+        std::string leftName = join->getInputName();
+        std::string rightName = join->getRightInput().getSetName();
+        if (madeHere.count(rightName) != 0 && madeHere.count(leftName) == 0) {
+          estimate = getJoinEstimate(getTupleSetEstimate(leftName), estimate, leftName, rightName);
+        } else {
+          estimate = getJoinEstimate(estimate, getTupleSetEstimate(rightName), leftName, rightName);
+        }
+        break;
+      }
+
+      // the lambdas, the hashes, the scans and the writes keep the tuples
+      default: {
+        break;
+      }
+    }
+  }
+
+  return estimate;
+}
+
+std::string CostModel::getPredicateType(const AtomicComputationPtr &filter, AtomicComputationList &computations) {
+
+  // the filter is given the boolean column made by its predicate
+  AtomicComputationPtr predicate = computations.getProducingAtomicComputation(filter->getInputName());
+  if (predicate == nullptr || predicate->getAtomicComputationTypeID() != ApplyLambdaTypeID) {
+    return "";
+  }
+
+  // the lambda tells us what it is
+  auto &info = predicate->getKeyValuePairs();
+  if (info == nullptr || info->count("lambdaType") == 0) {
+    return "";
+  }
+  return (*info)["lambdaType"];
+}
+
+double CostModel::getSelectivity(const AtomicComputationPtr &filter) {
+
+  // the kind of predicate of the filter
+  std::string predicateType;
+  if (logicalPlan != nullptr) {
+    predicateType = getPredicateType(filter, logicalPlan->getComputations());
+  }
+
+  // did we measure it already
+  if (stats != nullptr && !predicateType.empty() && stats->getLambdaSelectivity(predicateType) > 0) {
+    return stats->getLambdaSelectivity(predicateType);
+  }
+
+  // an equality keeps fewer tuples than anything else
+  return predicateType == "==" ? COST_MODEL_EQUALITY_SELECTIVITY : COST_MODEL_DEFAULT_SELECTIVITY;
+}
+
+size_t CostModel::getNumDistinctKeys(const std::string &hashName) {
+
+  if (stats == nullptr || logicalPlan == nullptr) {
+    return 0;
+  }
+
+  // grab the hash
+  AtomicComputationList &computations = logicalPlan->getComputations();
+  AtomicComputationPtr hash = computations.getProducingAtomicComputation(hashName);
+  if (hash == nullptr) {
+    return 0;
+  }
+
+  // a cartesian product has one key
+  if (hash->getAtomicComputationTypeID() == HashOneTypeID) {
+    return 1;
+  }
+  if (hash->getAtomicComputationTypeID() != HashLeftTypeID && hash->getAtomicComputationTypeID() != HashRightTypeID) {
+    return 0;
+  }
+
+  // the hashed column is made by the lambda that extracts the key, a member or a method of the objects
+  AtomicComputationPtr key = computations.getProducingAtomicComputation(hash->getInputName());
+  if (key == nullptr || key->getAtomicComputationTypeID() != ApplyLambdaTypeID) {
+    return 0;
+  }
+  auto &info = key->getKeyValuePairs();
+  std::string keyName;
+  if (info != nullptr && info->count("attName") != 0) {
+    keyName = (*info)["attName"];
+  } else if (info != nullptr && info->count("methodName") != 0) {
+    keyName = (*info)["methodName"];
+  } else {
+    return 0;
+  }
+
+  // go back to the set the objects come from, through the computations that keep them
+  AtomicComputationPtr current = key;
+  while (current->getAtomicComputationTypeID() != ScanSetAtomicTypeID) {
+    if (current->getAtomicComputationTypeID() == ApplyJoinTypeID ||
+        current->getAtomicComputationTypeID() == ApplyAggTypeID) {
+      return 0;
+    }
+    current = computations.getProducingAtomicComputation(current->getInputName());
+    if (current == nullptr) {
+      return 0;
+    }
+  }
+
+  auto scan = std::dynamic_pointer_cast<ScanSet>(current);
+  return stats->getNumDistinctKeys(scan->getDBName(), scan->getSetName(), keyName);
+}
+
+CostEstimate CostModel::getJoinEstimate(CostEstimate left,
+                                        CostEstimate right,
+                                        const std::string &leftHashName,
+                                        const std::string &rightHashName) {
+
+  CostEstimate estimate;
+
+  // without the tuples we only know the bytes, a join on a foreign key is about as large as its larger side
+  if (left.numTuples <= 0 || right.numTuples <= 0) {
+    estimate.numBytes = std::max(left.numBytes, right.numBytes);
+    return estimate;
+  }
+
+  // the keys of the side with fewer keys are among the keys of the other side, every one meets
+  // (|L| / keys of L) * (|R| / keys of R) pairs of tuples; without the keys, the smaller side has unique keys
+  double leftKeys = getNumDistinctKeys(leftHashName);
+  double rightKeys = getNumDistinctKeys(rightHashName);
+  double numKeys = std::max(leftKeys, rightKeys);
+  if (numKeys <= 0) {
+    numKeys = std::min(left.numTuples, right.numTuples);
+  }
+  estimate.numTuples = left.numTuples * right.numTuples / numKeys;
+
+  // a joined tuple has the columns of both sides
+  estimate.numBytes = estimate.numTuples * (left.numBytes / left.numTuples + right.numBytes / right.numTuples);
+  return estimate;
+}
+
+double CostModel::getPipelineCost(CostEstimate input, CostEstimate output) {
+
+  // every node scans its part of the input and writes its part of the output
+  return (input.numBytes + output.numBytes) / BYTES_PER_MB / COST_MODEL_SCAN_MB_PER_SEC / numNodes;
+}
+
+double CostModel::getBroadcastJoinCost(CostEstimate build, CostEstimate probe) {
+
+  // every node builds the whole hash table, it has to fit
+  if (build.numBytes * COST_MODEL_HASH_TABLE_OVERHEAD > hashMemoryPerNode) {
+    return std::numeric_limits<double>::infinity();
+  }
+
+  // every node gets the parts of the build side of the other nodes, hashes all of it and probes its part
+  double network = build.numBytes * (numNodes - 1) / numNodes / BYTES_PER_MB / COST_MODEL_NETWORK_MB_PER_SEC;
+  double hash = (build.numBytes + probe.numBytes / numNodes) / BYTES_PER_MB / COST_MODEL_HASH_MB_PER_SEC;
+  return network + hash;
+}
+
+double CostModel::getShuffleJoinCost(CostEstimate build, CostEstimate probe) {
+
+  // every node sends all but its own partition of its part of both sides
+  double network = (build.numBytes + probe.numBytes) * (numNodes - 1) / (numNodes * numNodes) / BYTES_PER_MB /
+                   COST_MODEL_NETWORK_MB_PER_SEC;
+  return network + getCoPartitionedJoinCost(build, probe);
+}
+
+double CostModel::getCoPartitionedJoinCost(CostEstimate build, CostEstimate probe) {
+
+  // every node hashes a partition of both sides
+  double bytesPerNode = (build.numBytes + probe.numBytes) / numNodes;
+  double hash = bytesPerNode / BYTES_PER_MB / COST_MODEL_HASH_MB_PER_SEC;
+
+  // the part of the hash table of a node that does not fit is written out and read back, with the tuples that
+  // probe it
+  double tableBytes = build.numBytes / numNodes * COST_MODEL_HASH_TABLE_OVERHEAD;
+  double spill = 0;
+  if (tableBytes > hashMemoryPerNode) {
+    double spilledPart = 1.0 - hashMemoryPerNode / tableBytes;
+    spill = 2 * spilledPart * bytesPerNode / BYTES_PER_MB / COST_MODEL_SPILL_MB_PER_SEC;
+  }
+  return hash + spill;
+}
+
+double CostModel::getJoinCost(CostEstimate build, CostEstimate probe) {
+  return std::min(getBroadcastJoinCost(build, probe), getShuffleJoinCost(build, probe));
+}
+
+bool CostModel::preferBroadcast(CostEstimate build, CostEstimate probe) {
+  return getBroadcastJoinCost(build, probe) <= getShuffleJoinCost(build, probe);
+}
+
+void CostModel::learnSelectivities(std::vector<Handle<AbstractJobStage>> &stages, const StatisticsPtr &stats) {
+
+  if (stats == nullptr) {
+    return;
+  }
+
+  for (auto &stage : stages) {
+
+    // only a pipeline that reads a set and writes a set tells us how much of its input it kept
+    if (stage->getJobStageType() != "TupleSetJobStage") {
+      continue;
+    }
+    Handle<TupleSetJobStage> tupleStage = unsafeCast<TupleSetJobStage, AbstractJobStage>(stage);
+    if (tupleStage->isProbing() || tupleStage->isBroadcasting() || tupleStage->isRepartition() ||
+        tupleStage->isCombining() || tupleStage->isInputAggHashOut() || tupleStage->getComputePlan() == nullptr) {
+      continue;
+    }
+    Handle<SetIdentifier> source = tupleStage->getSourceContext();
+    Handle<SetIdentifier> sink = tupleStage->getSinkContext();
+    if (source == nullptr || sink == nullptr) {
+      continue;
+    }
+    double sourceBytes = stats->getNumBytes(source->getDatabase(), source->getSetName());
+    double sinkBytes = stats->getNumBytes(sink->getDatabase(), sink->getSetName());
+    if (sourceBytes <= 0) {
+      continue;
+    }
+
+    // the pipeline has to have exactly one filter and no join or aggregation, then the filter made the difference
+    AtomicComputationList &computations = tupleStage->getComputePlan()->getPlan()->getComputations();
+    std::vector<std::string> tupleSets;
+    tupleStage->getTupleSetsToBuildPipeline(tupleSets);
+    AtomicComputationPtr filter = nullptr;
+    bool oneFilter = true;
+    for (auto &tupleSet : tupleSets) {
+      AtomicComputationPtr computation = computations.getProducingAtomicComputation(tupleSet);
+      if (computation == nullptr) {
+        continue;
+      }
+      AtomicComputationTypeID type = computation->getAtomicComputationTypeID();
+      if (type == ApplyJoinTypeID || type == ApplyAggTypeID || (type == ApplyFilterTypeID && filter != nullptr)) {
+        oneFilter = false;
+        break;
+      }
+      if (type == ApplyFilterTypeID) {
+        filter = computation;
+      }
+    }
+    if (!oneFilter || filter == nullptr) {
+      continue;
+    }
+    std::string predicateType = getPredicateType(filter, computations);
+    if (predicateType.empty()) {
+      continue;
+    }
+
+    // average it with what we measured before, a filter that kept nothing is taken to keep very little
+    double selectivity = std::max(std::min(sinkBytes / sourceBytes, 1.0), 1e-6);
+    double previous = stats->getLambdaSelectivity(predicateType);
+    stats->setLambdaSelectivity(predicateType, previous > 0 ? (previous + selectivity) / 2 : selectivity);
+
+    PDB_COUT << "CostModel: a filter with a " << predicateType << " predicate kept " << selectivity
+             << " of its input" << std::endl;
+  }
+}
+
+}
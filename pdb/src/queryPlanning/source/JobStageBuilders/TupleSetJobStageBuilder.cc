@@ -28,6 +28,8 @@ TupleSetJobStageBuilder::TupleSetJobStageBuilder() {
   // the default for all types of sinks is false
   isProbing = false;
   isRepartitionJoin = false;
+  isLocalRepartition = false;
+  isSplittingHeavyKeys = false;
   isRepartitionVector = false;
   isRepartitioning = false;
   isBroadcasting = false;
@@ -101,6 +103,22 @@ void TupleSetJobStageBuilder::setRepartitionJoin(bool repartitionJoinOrNot) {
   this->isRepartitionJoin = repartitionJoinOrNot;
 }
 
+void TupleSetJobStageBuilder::setLocalRepartition(bool localRepartitionOrNot) {
+  this->isLocalRepartition = localRepartitionOrNot;
+}
+
+void TupleSetJobStageBuilder::setRuntimeFilterHashSet(const std::string &hashSetName) {
+  this->runtimeFilterHashSet = hashSetName;
+}
+
+void TupleSetJobStageBuilder::setSplitHeavyKeys(bool splitHeavyKeysOrNot) {
+  this->isSplittingHeavyKeys = splitHeavyKeysOrNot;
+}
+
+void TupleSetJobStageBuilder::setSplitKeysHashSet(const std::string &hashSetName) {
+  this->splitKeysHashSet = hashSetName;
+}
+
 void TupleSetJobStageBuilder::setRepartitionVector(bool repartitionVectorOrNot) {
   this->isRepartitionVector = repartitionVectorOrNot;
 }
@@ -154,6 +172,10 @@ Handle<TupleSetJobStage> TupleSetJobStageBuilder::build() {
   jobStage->setOutputTypeName(outputTypeName);
   jobStage->setAllocatorPolicy(policy);
   jobStage->setRepartitionJoin(isRepartitionJoin);
+  jobStage->setLocalRepartition(isLocalRepartition);
+  jobStage->setRuntimeFilterHashSet(runtimeFilterHashSet);
+  jobStage->setSplitHeavyKeys(isSplittingHeavyKeys);
+  jobStage->setSplitKeysHashSet(splitKeysHashSet);
   jobStage->setRepartitionVector(isRepartitionVector);
   jobStage->setBroadcasting(isBroadcasting);
   jobStage->setRepartition(isRepartitioning);
@@ -96,6 +96,17 @@ bool PhysicalOptimizer::hasConsumers(Handle<SetIdentifier> &set) {
   return false;
 }
 
+std::set<std::string> PhysicalOptimizer::getSourceIdentifiers() {
+
+  // go through each source and grab the identifier
+  std::set<std::string> identifiers;
+  for(auto &source : sourceNodes) {
+    identifiers.insert(source.first);
+  }
+
+  return identifiers;
+}
+
 AbstractPhysicalNodePtr PhysicalOptimizer::getBestNode(StatisticsPtr &ptr) {
 
   // the default is to just use the first node
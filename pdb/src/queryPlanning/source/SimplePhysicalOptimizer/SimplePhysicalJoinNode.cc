@@ -22,6 +22,7 @@
 #include "SimplePhysicalOptimizer/SimplePhysicalNode.h"
 #include "SimplePhysicalOptimizer/SimplePhysicalJoinNode.h"
 #include "JoinComp.h"
+#include "CostModel.h"
 
 pdb::SimplePhysicalJoinNode::SimplePhysicalJoinNode(string jobId,
                                                     AtomicComputationPtr node,
@@ -79,12 +80,19 @@ pdb::PhysicalOptimizerResultPtr pdb::SimplePhysicalJoinNode::analyzeSingleConsum
     // create a analyzer result
     PhysicalOptimizerResultPtr result = make_shared<PhysicalOptimizerResult>();
 
-    // get the cost of the source set
-    double sourceCost = getCost(tupleStageBuilder->getSourceSetIdentifier(), stats);
+    // estimate the tuples this side gives the join, from the source set of the pipeline, and the other side
+    CostModel costModel(stats, logicalPlan);
+    costModel.setTupleSetEstimate(tupleStageBuilder->getSourceTupleSetName(),
+                                  costModel.getSetEstimate(tupleStageBuilder->getSourceSetIdentifier()));
+    CostEstimate thisSide = costModel.getTupleSetEstimate(targetTupleSetName);
+    std::string otherName = joinNode->getInputName() == targetTupleSetName ? joinNode->getRightInput().getSetName()
+                                                                           : joinNode->getInputName();
+    CostEstimate otherSide = costModel.getTupleSetEstimate(otherName);
 
-    // are we already probing a set in the pipeline, and is the cost of the current source smaller than the join
-    // threshold? if so might be better to go back and process the other side of the join first
-    if (tupleStageBuilder->isPipelineProbing() && (sourceCost <= BROADCAST_JOIN_COST_THRESHOLD) && !rollbacked) {
+    // would the join be cheaper if the other side built the hash table? if so might be better to go back and
+    // process the other side of the join first. This only picks the side that builds the hash table, the join
+    // order and the pipeline breakers still come from the logical plan
+    if (!rollbacked && costModel.getJoinCost(otherSide, thisSide) < costModel.getJoinCost(thisSide, otherSide)) {
 
       // of we tried to rollback the planning for this join if this happens again we will not do it
       rollbacked = true;
@@ -94,15 +102,13 @@ pdb::PhysicalOptimizerResultPtr pdb::SimplePhysicalJoinNode::analyzeSingleConsum
       result->physicalPlanToOutput.clear();
       result->interGlobalSets.clear();
 
-      //PDB_COUT << "WARNING: met a join sink with probing, to return and put cost " << sourceCost << " " << tupleStageBuilder->getSourceSetIdentifier()->toSourceSetName() << " to penalized list \n";
-
       // we return false to signalize that we did no extract a pipeline
       return result;
     }
 
-    // does the cost of the current source exceed the join threshold, if so we need to do a hash partition join
+    // is broadcasting this side more expensive than shuffling both sides, if so we need to do a hash partition join
     // therefore we definitely need to hash the current table this is definitely a pipeline breaker
-    else if (sourceCost > BROADCAST_JOIN_COST_THRESHOLD) {
+    else if (!costModel.preferBroadcast(thisSide, otherSide)) {
 
       // set the partitioning flag so we can know that when probing
       joinNode->setPartitioningLHS(true);
@@ -129,6 +135,9 @@ pdb::PhysicalOptimizerResultPtr pdb::SimplePhysicalJoinNode::analyzeSingleConsum
       tupleStageBuilder->setAllocatorPolicy(curComp->getAllocatorPolicy());
       tupleStageBuilder->setRepartitionJoin(true);
 
+      // the other side waits for our hash tables, so it can be copied to all of the partitions of the keys we split
+      tupleStageBuilder->setSplitHeavyKeys(true);
+
       // create the tuple stage to run a pipeline with a hash partition sink
       Handle<TupleSetJobStage> joinPrepStage = tupleStageBuilder->build();
 
@@ -164,7 +173,7 @@ pdb::PhysicalOptimizerResultPtr pdb::SimplePhysicalJoinNode::analyzeSingleConsum
     } else {
 
       // The other input has not been processed and we can do broadcasting because
-      // costOfCurSource <= JOIN_COST_THRESHOLD. I am a pipeline breaker.
+      // it costs no more than a hash partition join. I am a pipeline breaker.
       // We first need to create a TupleSetJobStage with a broadcasting sink
       // then a BroadcastJoinBuildHTJobStage to build a hash table of that data.
 
@@ -249,6 +258,12 @@ pdb::PhysicalOptimizerResultPtr pdb::SimplePhysicalJoinNode::analyzeSingleConsum
       tupleStageBuilder->setAllocatorPolicy(curComp->getAllocatorPolicy());
       tupleStageBuilder->setRepartitionJoin(true);
 
+      // the hash tables of the other side are built, we drop the tuples that do not join before we shuffle them
+      tupleStageBuilder->setRuntimeFilterHashSet(hashSetName);
+
+      // and we copy the tuples of the keys the other side split to all of their partitions
+      tupleStageBuilder->setSplitKeysHashSet(hashSetName);
+
       // we first create a pipeline breaker to partition RHS by setting
       // the isRepartitioning=true and isRepartitionJoin=true
       Handle<TupleSetJobStage> joinPrepStage = tupleStageBuilder->build();
@@ -17,6 +17,7 @@
  *****************************************************************************/
 #include "SetIdentifier.h"
 #include "Statistics.h"
+#include "CostModel.h"
 #include "JobStageBuilders/TupleSetJobStageBuilder.h"
 #include "SimplePhysicalOptimizer/SimplePhysicalNode.h"
 
@@ -121,25 +122,6 @@ void SimplePhysicalNode::addConsumer(const pdb::AbstractPhysicalNodePtr &consume
   activeConsumers.push_back(std::dynamic_pointer_cast<SimplePhysicalNode>(consumer));
 }
 
-double SimplePhysicalNode::getCost(Handle<SetIdentifier> source, const StatisticsPtr &stats) {
-
-  // if the set identifier does not exist log that
-  if (source == nullptr) {
-    PDB_COUT << "WARNING: the set provided to the get cost is a nullptr\n";
-    return 0;
-  }
-
-  // do we have statistics, if not just return 0
-  if(stats == nullptr) {
-    PDB_COUT << "WARNING: there are not stats when looking for the set=" << source->toSourceSetName() << "\n";
-    return 0;
-  }
-
-  // calculate the cost based on the formula cost = number_of_bytes / 1000000
-  double cost = stats->getNumBytes(source->getDatabase(), source->getSetName());
-  return cost / 1000000.0;
-}
-
 PhysicalOptimizerResultPtr SimplePhysicalNode::analyzeSingleConsumer(TupleSetJobStageBuilderPtr &tupleStageBuilder,
                                                                     SimplePhysicalNodePtr &prevNode,
                                                                     const StatisticsPtr &stats,
@@ -263,8 +245,26 @@ PhysicalOptimizerResultPtr SimplePhysicalNode::analyzeMultipleConsumers(TupleSet
 
 double SimplePhysicalNode::getCost(const StatisticsPtr &stats) {
 
-    // return the cost of the source set identifier
-    return getCost(sourceSetIdentifier, stats);
+  // if the set identifier does not exist log that
+  if (sourceSetIdentifier == nullptr) {
+    PDB_COUT << "WARNING: there is no source set for the node " << getNodeIdentifier() << "\n";
+    return 0;
+  }
+
+  // the computations the pipeline of this source runs before the first join, aggregation or materialization
+  std::vector<AtomicComputationPtr> computations;
+  SimplePhysicalNodePtr current = activeConsumers.empty() ? nullptr : activeConsumers.front();
+  while (current != nullptr &&
+         current->node->getAtomicComputationTypeID() != ApplyJoinTypeID &&
+         current->node->getAtomicComputationTypeID() != ApplyAggTypeID) {
+    computations.push_back(current->node);
+    current = current->activeConsumers.size() == 1 ? current->activeConsumers.front() : nullptr;
+  }
+
+  // the cost of scanning the source set and writing what the pipeline makes of it
+  CostModel costModel(stats, logicalPlan);
+  CostEstimate input = costModel.getSetEstimate(sourceSetIdentifier);
+  return costModel.getPipelineCost(input, costModel.applyComputations(input, computations));
 }
 
 string SimplePhysicalNode::getNodeIdentifier() {
@@ -0,0 +1,394 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PDB_STAGE_DEPENDENCY_GRAPH_CC
+#define PDB_STAGE_DEPENDENCY_GRAPH_CC
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include "StageDependencyGraph.h"
+#include "TupleSetJobStage.h"
+#include "AggregationJobStage.h"
+#include "BroadcastJoinBuildHTJobStage.h"
+#include "HashPartitionedJoinBuildHTJobStage.h"
+#include "LockGuard.h"
+#include "PDBDebug.h"
+
+namespace pdb {
+
+/**
+ * Hash sets share the name with the set they are built from, so we prefix them to tell them apart
+ */
+static const std::string HASH_SET_PREFIX = "hash:";
+
+/**
+ * The runtime filters of a hash set are collected from every node by the scheduler, so the stages that apply them
+ * depend globally on the stage that builds them
+ */
+static const std::string RUNTIME_FILTER_PREFIX = "filter:";
+
+/**
+ * The keys the build side of a hash partitioned join split are reported by the stage that shuffles it, the stage that
+ * shuffles the other side needs them whether it applies the runtime filters or not
+ */
+static const std::string SPLIT_KEYS_PREFIX = "keys:";
+
+StageDependencyGraph::StageDependencyGraph(std::vector<Handle<AbstractJobStage>> &stages,
+                                           unsigned long numNodes) : stages(stages),
+                                                                     numNodes(numNodes),
+                                                                     numFinished(0),
+                                                                     numFailed(0),
+                                                                     numCancelled(0),
+                                                                     progressMade(false) {
+
+  pthread_mutex_init(&graphMutex, nullptr);
+  pthread_cond_init(&progressSignal, nullptr);
+
+  // initialize the per task state
+  localProducers.resize(stages.size());
+  globalProducers.resize(stages.size());
+  states.resize(stages.size(), std::vector<StageTaskState>(numNodes, StageTaskWaiting));
+  startTimes.resize(stages.size(), std::vector<TimePoint>(numNodes));
+  endTimes.resize(stages.size(), std::vector<TimePoint>(numNodes));
+  numFinishedNodes.resize(stages.size(), 0);
+  numFailedNodes.resize(stages.size(), 0);
+
+  // figure out what each stage writes
+  std::vector<std::vector<std::string>> outputs(stages.size());
+  for (size_t i = 0; i < stages.size(); ++i) {
+    getStageOutputs(this->stages[i], outputs[i]);
+  }
+
+  // go through each stage and find the earlier stages that write something this stage reads
+  for (size_t consumer = 0; consumer < stages.size(); ++consumer) {
+
+    std::vector<std::string> inputs;
+    getStageInputs(this->stages[consumer], inputs);
+
+    for (size_t producer = 0; producer < consumer; ++producer) {
+
+      // check if the producer writes one of our inputs
+      bool isDependent = false;
+      bool needsFilters = false;
+      for (const auto &input : inputs) {
+        if (std::find(outputs[producer].begin(), outputs[producer].end(), input) != outputs[producer].end()) {
+          isDependent = true;
+          needsFilters = needsFilters || input.compare(0, RUNTIME_FILTER_PREFIX.size(), RUNTIME_FILTER_PREFIX) == 0;
+        }
+      }
+
+      if (!isDependent) {
+        continue;
+      }
+
+      // if the producer sends data to other nodes we need to wait for it to finish everywhere
+      if (isExchangingData(this->stages[producer]) || needsFilters) {
+        globalProducers[consumer].push_back(producer);
+      } else {
+        localProducers[consumer].push_back(producer);
+      }
+    }
+  }
+
+  creationTime = std::chrono::steady_clock::now();
+}
+
+StageDependencyGraph::~StageDependencyGraph() {
+  pthread_cond_destroy(&progressSignal);
+  pthread_mutex_destroy(&graphMutex);
+}
+
+bool StageDependencyGraph::isExchangingData(Handle<AbstractJobStage> &stage) {
+
+  // only the tuple set stages can have a sink that writes to remote nodes
+  if (stage->getJobStageTypeID() != TupleSetJobStage_TYPEID) {
+    return false;
+  }
+
+  Handle<TupleSetJobStage> tupleSetStage = unsafeCast<TupleSetJobStage, AbstractJobStage>(stage);
+  return tupleSetStage->isRepartition() || tupleSetStage->isBroadcasting() || tupleSetStage->isCollectAsMap();
+}
+
+void StageDependencyGraph::getStageInputs(Handle<AbstractJobStage> &stage, std::vector<std::string> &inputs) {
+
+  switch (stage->getJobStageTypeID()) {
+    case TupleSetJobStage_TYPEID : {
+      Handle<TupleSetJobStage> tupleSetStage = unsafeCast<TupleSetJobStage, AbstractJobStage>(stage);
+      inputs.push_back(tupleSetStage->getSourceContext()->toSourceSetName());
+
+      // the aggregation output we are probing
+      if (tupleSetStage->getHashContext() != nullptr) {
+        inputs.push_back(tupleSetStage->getHashContext()->toSourceSetName());
+      }
+
+      // the hash tables we are probing
+      if (tupleSetStage->getHashSets() != nullptr) {
+        for (auto it = tupleSetStage->getHashSets()->begin(); it != tupleSetStage->getHashSets()->end(); ++it) {
+          inputs.push_back(HASH_SET_PREFIX + std::string((*it).value));
+        }
+      }
+
+      // the hash set whose runtime filters we apply
+      if (!tupleSetStage->getRuntimeFilterHashSet().empty()) {
+        inputs.push_back(RUNTIME_FILTER_PREFIX + tupleSetStage->getRuntimeFilterHashSet());
+      }
+
+      // the hash set whose split keys we copy the tuples of
+      if (!tupleSetStage->getSplitKeysHashSet().empty()) {
+        inputs.push_back(SPLIT_KEYS_PREFIX + tupleSetStage->getSplitKeysHashSet());
+      }
+      break;
+    }
+    case AggregationJobStage_TYPEID : {
+      Handle<AggregationJobStage> aggStage = unsafeCast<AggregationJobStage, AbstractJobStage>(stage);
+      inputs.push_back(aggStage->getSourceContext()->toSourceSetName());
+      break;
+    }
+    case BroadcastJoinBuildHTJobStage_TYPEID : {
+      Handle<BroadcastJoinBuildHTJobStage> buildStage =
+          unsafeCast<BroadcastJoinBuildHTJobStage, AbstractJobStage>(stage);
+      inputs.push_back(buildStage->getSourceContext()->toSourceSetName());
+      break;
+    }
+    case HashPartitionedJoinBuildHTJobStage_TYPEID : {
+      Handle<HashPartitionedJoinBuildHTJobStage> buildStage =
+          unsafeCast<HashPartitionedJoinBuildHTJobStage, AbstractJobStage>(stage);
+      inputs.push_back(buildStage->getSourceContext()->toSourceSetName());
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+void StageDependencyGraph::getStageOutputs(Handle<AbstractJobStage> &stage, std::vector<std::string> &outputs) {
+
+  switch (stage->getJobStageTypeID()) {
+    case TupleSetJobStage_TYPEID : {
+      Handle<TupleSetJobStage> tupleSetStage = unsafeCast<TupleSetJobStage, AbstractJobStage>(stage);
+      outputs.push_back(tupleSetStage->getSinkContext()->toSourceSetName());
+
+      // the set where we store the combined data before shuffling it
+      if (tupleSetStage->getCombinerContext() != nullptr) {
+        outputs.push_back(tupleSetStage->getCombinerContext()->toSourceSetName());
+      }
+
+      // the keys we split, the hash set is built from our sink set
+      if (tupleSetStage->isSplittingHeavyKeys()) {
+        outputs.push_back(SPLIT_KEYS_PREFIX + tupleSetStage->getSinkContext()->toSourceSetName());
+      }
+      break;
+    }
+    case AggregationJobStage_TYPEID : {
+      Handle<AggregationJobStage> aggStage = unsafeCast<AggregationJobStage, AbstractJobStage>(stage);
+      outputs.push_back(aggStage->getSinkContext()->toSourceSetName());
+      break;
+    }
+    case BroadcastJoinBuildHTJobStage_TYPEID : {
+      Handle<BroadcastJoinBuildHTJobStage> buildStage =
+          unsafeCast<BroadcastJoinBuildHTJobStage, AbstractJobStage>(stage);
+      outputs.push_back(HASH_SET_PREFIX + buildStage->getHashSetName());
+      break;
+    }
+    case HashPartitionedJoinBuildHTJobStage_TYPEID : {
+      Handle<HashPartitionedJoinBuildHTJobStage> buildStage =
+          unsafeCast<HashPartitionedJoinBuildHTJobStage, AbstractJobStage>(stage);
+      outputs.push_back(HASH_SET_PREFIX + buildStage->getHashSetName());
+      outputs.push_back(RUNTIME_FILTER_PREFIX + buildStage->getHashSetName());
+      break;
+    }
+    default: {
+      break;
+    }
+  }
+}
+
+bool StageDependencyGraph::isReady(size_t stage, unsigned long node) {
+
+  // the local producers only need to be finished on this node
+  for (auto producer : localProducers[stage]) {
+    if (states[producer][node] != StageTaskFinished) {
+      return false;
+    }
+  }
+
+  // the global producers need to be finished on every node
+  for (auto producer : globalProducers[stage]) {
+    if (numFinishedNodes[producer] != numNodes) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool StageDependencyGraph::hasFailedProducer(size_t stage, unsigned long node) {
+
+  // a local producer has to have failed on this node
+  for (auto producer : localProducers[stage]) {
+    if (states[producer][node] == StageTaskFailed || states[producer][node] == StageTaskCancelled) {
+      return true;
+    }
+  }
+
+  // a global producer on any node
+  for (auto producer : globalProducers[stage]) {
+    if (numFailedNodes[producer] != 0) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+std::vector<std::pair<size_t, unsigned long>> StageDependencyGraph::takeReadyTasks() {
+
+  const LockGuard guard{graphMutex};
+
+  std::vector<std::pair<size_t, unsigned long>> readyTasks;
+  for (size_t stage = 0; stage < stages.size(); ++stage) {
+    for (unsigned long node = 0; node < numNodes; ++node) {
+
+      // skip the tasks that are already running or finished
+      if (states[stage][node] != StageTaskWaiting) {
+        continue;
+      }
+
+      // the producers come before their consumers, so the cancellation reaches the whole chain in one pass
+      if (hasFailedProducer(stage, node)) {
+        states[stage][node] = StageTaskCancelled;
+        startTimes[stage][node] = endTimes[stage][node] = std::chrono::steady_clock::now();
+        numFailedNodes[stage]++;
+        numFinished++;
+        numCancelled++;
+
+        // nothing may be running to wake us up if these were the last tasks
+        progressMade = true;
+        continue;
+      }
+
+      // skip the tasks that can not run yet
+      if (!isReady(stage, node)) {
+        continue;
+      }
+
+      // mark it as running
+      states[stage][node] = StageTaskRunning;
+      startTimes[stage][node] = std::chrono::steady_clock::now();
+      readyTasks.emplace_back(stage, node);
+    }
+  }
+
+  return readyTasks;
+}
+
+void StageDependencyGraph::markFinished(size_t stage, unsigned long node, bool success) {
+
+  const LockGuard guard{graphMutex};
+
+  endTimes[stage][node] = std::chrono::steady_clock::now();
+  numFinished++;
+
+  if (success) {
+    states[stage][node] = StageTaskFinished;
+    numFinishedNodes[stage]++;
+  } else {
+    states[stage][node] = StageTaskFailed;
+    numFailedNodes[stage]++;
+    numFailed++;
+  }
+
+  // wake up the scheduling thread
+  progressMade = true;
+  pthread_cond_signal(&progressSignal);
+}
+
+void StageDependencyGraph::waitForProgress() {
+
+  const LockGuard guard{graphMutex};
+
+  // wait until somebody finishes a task
+  while (!progressMade) {
+    pthread_cond_wait(&progressSignal, &graphMutex);
+  }
+
+  progressMade = false;
+}
+
+bool StageDependencyGraph::isFinished() {
+  const LockGuard guard{graphMutex};
+  return numFinished == stages.size() * numNodes;
+}
+
+size_t StageDependencyGraph::getNumFailed() {
+  const LockGuard guard{graphMutex};
+  return numFailed;
+}
+
+size_t StageDependencyGraph::getNumCancelled() {
+  const LockGuard guard{graphMutex};
+  return numCancelled;
+}
+
+double StageDependencyGraph::toSeconds(const TimePoint &begin, const TimePoint &end) {
+  return std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+}
+
+void StageDependencyGraph::printStageTimings() {
+
+  const LockGuard guard{graphMutex};
+
+  // the time we would need if each stage waited for the slowest node of the previous stage
+  double barrierTime = 0;
+  TimePoint lastEnd = creationTime;
+
+  for (size_t stage = 0; stage < stages.size(); ++stage) {
+
+    double minTime = std::numeric_limits<double>::max();
+    double maxTime = 0;
+    TimePoint firstStart = TimePoint::max();
+    TimePoint stageEnd = creationTime;
+
+    // figure out the fastest and the slowest node
+    for (unsigned long node = 0; node < numNodes; ++node) {
+      double time = toSeconds(startTimes[stage][node], endTimes[stage][node]);
+      minTime = std::min(minTime, time);
+      maxTime = std::max(maxTime, time);
+      firstStart = std::min(firstStart, startTimes[stage][node]);
+      stageEnd = std::max(stageEnd, endTimes[stage][node]);
+    }
+
+    barrierTime += maxTime;
+    lastEnd = std::max(lastEnd, stageEnd);
+
+    PDB_COUT << "Stage " << stages[stage]->getStageId() << " (" << stages[stage]->getJobStageType() << ") started at "
+             << toSeconds(creationTime, firstStart) << "s, finished at " << toSeconds(creationTime, stageEnd)
+             << "s, fastest node " << minTime << "s, slowest node " << maxTime << "s, straggler delay "
+             << maxTime - minTime << "s" << std::endl;
+  }
+
+  double totalTime = toSeconds(creationTime, lastEnd);
+  PDB_COUT << "Executed " << stages.size() << " stages in " << totalTime << "s, with a barrier after each stage "
+           << "it would take at least " << barrierTime << "s, saved " << std::max(0.0, barrierTime - totalTime)
+           << "s" << std::endl;
+}
+
+}
+
+#endif //PDB_STAGE_DEPENDENCY_GRAPH_CC
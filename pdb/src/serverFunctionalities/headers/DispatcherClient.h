@@ -54,6 +54,20 @@ public:
                      PartitionPolicy::Policy policy,
                      std::string& errMsg);
 
+    /**
+     * Tells the DispatcherServer that the client partitions a set with a KeyPartitionPolicy
+     *
+     * @param setAndDatabase
+     * @param partitionScheme the scheme of the policy, sets with the same one are co-partitioned
+     * @param partitionKey the member or the method the set is partitioned on
+     * @return
+     */
+    bool registerKeyPartition(std::pair<std::string, std::string> setAndDatabase,
+                              PartitionPolicy::Policy policy,
+                              std::string partitionScheme,
+                              std::string partitionKey,
+                              std::string& errMsg);
+
     /**
      *
      * @param setAndDatabase
@@ -70,6 +84,23 @@ public:
                    size_t numBytes,
                    std::string& errMsg);
 
+    /**
+     * Tells the DispatcherServer about the pages a bulk load has sent straight to the workers,
+     * and about the objects in them: their number and, for a set partitioned by key, the
+     * estimated number of distinct keys in the whole set
+     *
+     * @param setAndDatabase
+     * @return
+     */
+    bool reportBulkLoad(std::pair<std::string, std::string> setAndDatabase,
+                        std::string typeName,
+                        int numPages,
+                        size_t numBytes,
+                        std::string& errMsg,
+                        size_t numObjects = 0,
+                        std::string keyName = "",
+                        size_t numDistinctKeys = 0);
+
 private:
     CatalogClient myHelper;
     int port;
@@ -45,6 +45,10 @@ namespace pdb {
 // -- Random Policy: the received Vector will be sent to any storage node determined randomly
 // -- Round-Robin Policy: the first received Vector will be sent to the first storage node, 
 //    and so on.
+// Sets that are partitioned by a hash or a range of a key are partitioned by the client, which has
+// the lambda that extracts the key; the DispatcherServer only records their partition scheme.
+// Clients that bulk load a set send their pages to the storage servers of the workers themselves,
+// and only tell the DispatcherServer how many pages and bytes they have stored.
 
 
 class DispatcherServer : public ServerFunctionality {
@@ -78,6 +82,20 @@ public:
     void registerSet(std::pair<std::string, std::string> setAndDatabase,
                      PartitionPolicyPtr partitionPolicy);
 
+    /**
+     * Records that a client partitions a set with a KeyPartitionPolicy, so that the planner can
+     * find the sets that are co-partitioned
+     *
+     * @param partitionScheme the scheme of the policy, sets with the same one are co-partitioned
+     * @param partitionKey the member or the method the set is partitioned on
+     * @return true on success
+     */
+    bool registerKeyPartition(std::string databaseName,
+                              std::string setName,
+                              std::string partitionScheme,
+                              std::string partitionKey,
+                              std::string& errMsg);
+
     /**
      * Dispatch a Vector of pdb::Object's to the correct StorageNodes as defined by that particular
      * set's ParitionPolicy
@@ -120,6 +138,22 @@ private:
                        const std::string& typeName,
                        std::string& errMsg);
 
+    /**
+     * A set that is partitioned by key can't take data that is not partitioned by its client
+     * @return true if the set is partitioned by key, with errMsg saying so
+     */
+    bool isKeyPartitioned(std::string databaseName, std::string setName, std::string& errMsg);
+
+    /**
+     * Checks with the catalog that the set exists and stores objects of the type, before a client
+     * sends the pages of a bulk load straight to the workers
+     * @return true if it does, otherwise false with errMsg saying why
+     */
+    bool setStoresType(const std::string& databaseName,
+                       const std::string& setName,
+                       const std::string& typeName,
+                       std::string& errMsg);
+
     bool sendData(std::pair<std::string, std::string> setAndDatabase,
                   std::string type,
                   Handle<NodeDispatcherData> destination,
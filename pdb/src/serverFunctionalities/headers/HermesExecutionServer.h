@@ -167,6 +167,20 @@ public:
         return this->hashSetMgr.getTotalSize();
     }
 
+    // reserve heap memory to build a hash set into, shared with the stages that build at the same
+    // time
+    size_t reserveHashSetMemory(std::string name,
+                                size_t availableSize,
+                                size_t wantedSize,
+                                double ratio) {
+        return this->hashSetMgr.reserveMemory(name, availableSize, wantedSize, ratio);
+    }
+
+    // release the memory reserved for a hash set that is not kept
+    void releaseHashSetMemory(std::string name) {
+        this->hashSetMgr.releaseMemory(name);
+    }
+
 private:
     ConfigurationPtr conf;
     SharedMemPtr shm;
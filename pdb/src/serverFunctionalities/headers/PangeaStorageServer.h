@@ -97,6 +97,18 @@ public:
     // this allocates a new page at the end of the indicated database/set combo
     PDBPagePtr getNewPage(pair<std::string, std::string> databaseAndSet);
 
+    // receives the next page frame from the communicator, decodes it straight into a new page of
+    // the indicated database/set combo, and unpins the page
+    bool receivePage(pair<std::string, std::string> databaseAndSet,
+                     PDBCommunicatorPtr receiveFromMe,
+                     std::string& errMsg);
+
+    // receives the next record frame from the communicator, and decodes it straight into the bytes
+    // it takes at the end of the input buffer page of the indicated database/set combo
+    bool receiveRecord(pair<std::string, std::string> databaseAndSet,
+                       PDBCommunicatorPtr receiveFromMe,
+                       std::string& errMsg);
+
     // returns a set object referencing the given database/set pair
     SetPtr getSet(std::pair<std::string, std::string> databaseAndSet);
 
@@ -156,6 +168,12 @@ public:
      */
     PageCircularBufferPtr getFlushBuffer();
 
+    /**
+     * Unpin a page the backend doesn't need anymore, and drop it if the set is read only once.
+     * Returns false if the page is not in the cache.
+     */
+    bool unpinPage(DatabaseID dbId, UserTypeID typeId, SetID setId, PageID pageId);
+
     /**
      * Add a new and empty database
      */
@@ -233,7 +251,10 @@ public:
     /**
      * Add a new and empty temporary set
      */
-    bool addTempSet(std::string setName, SetID& setId, size_t pageSize = DEFAULT_PAGE_SIZE);
+    bool addTempSet(std::string setName,
+                    SetID& setId,
+                    size_t pageSize = DEFAULT_PAGE_SIZE,
+                    LocalityType localityType = ShuffleData);
 
 
     /**
@@ -266,6 +287,17 @@ public:
      */
     void stopFlushConsumerThreads();
 
+    /**
+     * Start the thread that unpins the pages the backend pushes to the unpinned ring of the
+     * PageTransferChannel, does nothing if the frontend and the backend don't share a channel.
+     */
+    void startUnpinConsumerThread();
+
+    /**
+     * Stop the unpinning thread.
+     */
+    void stopUnpinConsumerThread();
+
 
     /**
      * returns a worker from thread pool
@@ -422,6 +454,9 @@ private:
     // The vector of flush threads
     std::vector<PDBWorkPtr> flushers;
 
+    // The thread unpinning the pages released by the backend
+    PDBWorkPtr unpinner;
+
     /****** for distribution *******************************/
 
 private:
@@ -38,6 +38,9 @@
 #include "DistributedStorageManagerClient.h"
 #include "StatisticsDB.h"
 #include "RegisterReplica.h"
+#include "ShuffleSkew.h"
+#include <cstdint>
+#include <map>
 #include <vector>
 #include <ExecuteComputation.h>
 
@@ -155,11 +158,17 @@ protected:
     /**
      * This method is used to schedule dynamic pipeline stages
      * It must be invoked after initialize() and before cleanup()
+     * The stages are scheduled as a DAG @see pdb::StageDependencyGraph, a stage starts on a node as soon as the
+     * stages it depends on are finished, stages that do not depend on each other run concurrently.
+     * The stages that depend on a stage that failed are not executed.
      * @param stagesToSchedule is a vector of all the stages we want to schedule
      * @param shuffleInfo is the shuffle information for job stages that needs repartitioning
+     * @param errMsg is set to what went wrong if a stage failed
+     * @return true if every stage was executed successfully on every node, false otherwise
      */
-    void scheduleStages(std::vector<Handle<AbstractJobStage>>& stagesToSchedule,
-                        std::shared_ptr<ShuffleInfo> shuffleInfo);
+    bool scheduleStages(std::vector<Handle<AbstractJobStage>>& stagesToSchedule,
+                        std::shared_ptr<ShuffleInfo> shuffleInfo,
+                        std::string& errMsg);
 
 
     /**
@@ -167,13 +176,10 @@ protected:
      * node and schedules the stage at it.
      * @param stage the stage we want to send
      * @param node the node we want to send the stage to
-     * @param counter a reference to the counter that needs to be increased once the execution of the stage is complete
-     * @param callerBuzzer the buzzer we use to notify the calling thread that we are done executing
+     * @return true if the stage was successfully executed on the node, false otherwise
      */
-    void prepareAndScheduleStage(Handle<AbstractJobStage> &stage,
-                                 unsigned long node,
-                                 int &counter,
-                                 PDBBuzzerPtr &callerBuzzer);
+    bool prepareAndScheduleStage(Handle<AbstractJobStage> &stage,
+                                 unsigned long node);
 
     /**
      * This method schedules a pipeline stage given the index of a specified node and a communicator to that node.
@@ -249,6 +255,43 @@ protected:
      */
     void updateStats(Handle<SetIdentifier> setToUpdateStats);
 
+    /**
+     * Keeps the runtime filters a node sent back with the result of a HashPartitionedJoinBuildHTJobStage, until
+     * the stages that shuffle the other side of the join are sent
+     * @param node the node
+     * @param result the result with the filters, the set it identifies is the one the hash set was built from
+     */
+    void addRuntimeFilters(unsigned long node, Handle<SetIdentifier> &result);
+
+    /**
+     * Returns the runtime filters of all the partitions of a hash set, node after node, in the current
+     * allocation block, or nullptr if some node did not send its filters
+     * @param hashSetName the name of the hash set
+     * @return the filters
+     */
+    Handle<Vector<uint64_t>> getRuntimeFilters(const std::string &hashSetName);
+
+    /**
+     * Adds the skew a node sent back with the result of a TupleSetJobStage that shuffles by hash to the skew of the
+     * stage, and keeps the keys it split until the stage that shuffles the other side of the join is sent
+     * @param stageId the id of the stage
+     * @param result the result with the skew, the set it identifies is the one the hash set is built from
+     */
+    void addShuffleSkew(JobStageID stageId, Handle<SetIdentifier> &result);
+
+    /**
+     * Returns the keys the build side of a join was split on, as pairs of hash and fanout, in the current
+     * allocation block, or nullptr if none were split
+     * @param hashSetName the name of the hash set
+     * @return the keys
+     */
+    Handle<Vector<uint64_t>> getSplitKeys(const std::string &hashSetName);
+
+    /**
+     * Prints the skew of every stage that shuffled by hash, and forgets it
+     */
+    void printShuffleSkew();
+
     /**
      * This method executes a PDB computation given by the ExecuteComputation object, that was sent by a client
      * @param request the object that describes the computation
@@ -268,7 +311,8 @@ protected:
 
     /**
      * This method finds the best source operator using a heuristic, then uses this operator to extract a sequence of
-     * of pipelinable stages.
+     * of pipelinable stages. After that it keeps extracting sequences from the sources that existed before this call,
+     * since they do not depend on the stages we just extracted and can be scheduled at the same time.
      * @param jobStageId the of last executed job stage
      * @param jobStages a vector where we want to store the sequence of jobStages
      * @param intermediateSets a vector where we want to store the information about the intermediate sets
@@ -355,6 +399,21 @@ protected:
      */
     pthread_mutex_t connection_mutex;
 
+    /**
+     * The runtime filters of the hash sets of the current job, for each hash set the filters of every node,
+     * an empty vector for a node that did not send them, and the mutex that protects them
+     */
+    std::map<std::string, std::vector<std::vector<uint64_t>>> runtimeFilters;
+    pthread_mutex_t runtimeFilterMutex;
+
+    /**
+     * The skew of the stages of the current job that shuffle by hash, the keys split by the build side of every
+     * hash set, and the mutex that protects them
+     */
+    std::map<JobStageID, ShuffleSkewPtr> stageSkews;
+    std::map<std::string, ShuffleSkewPtr> splitKeys;
+    pthread_mutex_t shuffleSkewMutex;
+
     /**
      * Used to generate a unique sequential ID
      * getNextSequenceID is thread safe to call
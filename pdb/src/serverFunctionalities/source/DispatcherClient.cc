@@ -21,6 +21,7 @@
 #include "DispatcherClient.h"
 #include "SimpleRequest.h"
 #include "DispatcherRegisterPartitionPolicy.h"
+#include "DispatcherAddPages.h"
 
 namespace pdb {
 
@@ -65,6 +66,77 @@ bool DispatcherClient::registerSet(std::pair<std::string, std::string> setAndDat
         setAndDatabase.second,
         policy);
 }
+
+bool DispatcherClient::registerKeyPartition(std::pair<std::string, std::string> setAndDatabase,
+                                            PartitionPolicy::Policy policy,
+                                            std::string partitionScheme,
+                                            std::string partitionKey,
+                                            std::string& errMsg) {
+
+    return simpleRequest<DispatcherRegisterPartitionPolicy, SimpleRequestResult, bool>(
+        logger,
+        port,
+        address,
+        false,
+        1024 + partitionScheme.size() + partitionKey.size(),
+        [&](Handle<SimpleRequestResult> result) {
+            if (result != nullptr) {
+                if (!result->getRes().first) {
+                    errMsg = "Error registering the partitioning of " + setAndDatabase.first +
+                        ":" + setAndDatabase.second + ": " + result->getRes().second;
+                    logger->error(errMsg);
+                    return false;
+                }
+                return true;
+            }
+            errMsg =
+                "Error registering the partitioning: got nothing back from the DispatcherServer";
+            return false;
+        },
+        setAndDatabase.first,
+        setAndDatabase.second,
+        policy,
+        partitionScheme,
+        partitionKey);
+}
+
+bool DispatcherClient::reportBulkLoad(std::pair<std::string, std::string> setAndDatabase,
+                                      std::string typeName,
+                                      int numPages,
+                                      size_t numBytes,
+                                      std::string& errMsg,
+                                      size_t numObjects,
+                                      std::string keyName,
+                                      size_t numDistinctKeys) {
+
+    return simpleRequest<DispatcherAddPages, SimpleRequestResult, bool>(
+        logger,
+        port,
+        address,
+        false,
+        1024,
+        [&](Handle<SimpleRequestResult> result) {
+            if (result != nullptr) {
+                if (!result->getRes().first) {
+                    errMsg = "Error reporting the pages loaded into " + setAndDatabase.first +
+                        ":" + setAndDatabase.second + ": " + result->getRes().second;
+                    logger->error(errMsg);
+                    return false;
+                }
+                return true;
+            }
+            errMsg = "Error reporting the pages loaded: got nothing back from the DispatcherServer";
+            return false;
+        },
+        setAndDatabase.second,
+        setAndDatabase.first,
+        typeName,
+        numPages,
+        numBytes,
+        numObjects,
+        keyName,
+        numDistinctKeys);
+}
 }
 
 #include "StorageClientTemplate.cc"
@@ -21,6 +21,7 @@
 
 #include "DispatcherServer.h"
 #include "CatalogServer.h"
+#include "CatalogClient.h"
 #include "PDBDebug.h"
 #include "SimpleRequestHandler.h"
 #include "SimpleRequestResult.h"
@@ -31,6 +32,7 @@
 #include "Statistics.h"
 #include "PartitionPolicyFactory.h"
 #include "DispatcherRegisterPartitionPolicy.h"
+#include "DispatcherAddPages.h"
 #include <snappy.h>
 #define MAX_CONCURRENT_REQUESTS 10
 
@@ -106,11 +108,14 @@ void DispatcherServer::registerHandlers(PDBServer& forMe) {
             } else {
                 std::cout << "Dispatch to send vector size = " << dataToSend->size() << std::endl;
             }
-            // Check that the type of the data being stored matches what is known to the catalog
+            size_t numObjects = dataToSend->size();
+            // Check that the type of the data being stored matches what is known to the catalog,
+            // and that the set is not partitioned by the key of a client
             if (!validateTypes(request->getDatabaseName(),
                                request->getSetName(),
                                request->getTypeName(),
-                               errMsg)) {
+                               errMsg) ||
+                isKeyPartitioned(request->getDatabaseName(), request->getSetName(), errMsg)) {
                 Handle<SimpleRequestResult> response =
                     makeObject<SimpleRequestResult>(false, errMsg);
                 res = sendUsingMe->sendObject(response, errMsg);
@@ -155,6 +160,8 @@ void DispatcherServer::registerHandlers(PDBServer& forMe) {
                 stats->getNumBytes(request->getDatabaseName(), request->getSetName());
             size_t newNumBytes = oldNumBytes + numBytes;
             stats->setNumBytes(request->getDatabaseName(), request->getSetName(), newNumBytes);
+            stats->incrementNumTuples(
+                request->getDatabaseName(), request->getSetName(), numObjects);
             numRequestsInProcessing = numRequestsInProcessing - 1;
             pthread_mutex_unlock(&mutex);
             return make_pair(res, errMsg);
@@ -171,9 +178,79 @@ void DispatcherServer::registerHandlers(PDBServer& forMe) {
                 std::string errMsg;
                 bool res = true;
 
-                registerSet(std::pair<std::string, std::string>(request->getSetName(),
-                                                                request->getDatabaseName()),
-                            PartitionPolicyFactory::buildPartitionPolicy(request->getPolicy()));
+                PartitionPolicy::Policy policy = request->getPolicy();
+                if ((policy == PartitionPolicy::Policy::HASH) ||
+                    (policy == PartitionPolicy::Policy::RANGE)) {
+                    // the client partitions the set, we remember how, for the planner
+                    res = registerKeyPartition(request->getDatabaseName(),
+                                               request->getSetName(),
+                                               request->getPartitionScheme(),
+                                               request->getPartitionKey(),
+                                               errMsg);
+                } else {
+                    registerSet(std::pair<std::string, std::string>(request->getSetName(),
+                                                                    request->getDatabaseName()),
+                                PartitionPolicyFactory::buildPartitionPolicy(policy));
+                }
+
+                Handle<SimpleRequestResult> response = makeObject<SimpleRequestResult>(res, errMsg);
+                res = sendUsingMe->sendObject(response, errMsg);
+
+                return make_pair(res, errMsg);
+            }));
+
+    // the pages of a bulk load go from the client straight to the workers, only their number and
+    // size come here; before it sends any page, the client sends a request without pages, to check
+    // that the set takes them
+    forMe.registerHandler(
+        DispatcherAddPages_TYPEID,
+        make_shared<SimpleRequestHandler<DispatcherAddPages>>(
+            [&](Handle<DispatcherAddPages> request, PDBCommunicatorPtr sendUsingMe) {
+
+                PDB_COUT << "A client stored " << request->getNumPages() << " pages with "
+                         << request->getNumBytes() << " bytes in set " << request->getSetName()
+                         << ":" << request->getDatabaseName() << std::endl;
+
+                std::string errMsg;
+                bool res = validateTypes(request->getDatabaseName(),
+                                         request->getSetName(),
+                                         request->getTypeName(),
+                                         errMsg);
+                if (res && (request->getNumPages() == 0)) {
+                    // the pages of a bulk load are not partitioned by key
+                    res = setStoresType(request->getDatabaseName(),
+                                        request->getSetName(),
+                                        request->getTypeName(),
+                                        errMsg) &&
+                        !isKeyPartitioned(
+                            request->getDatabaseName(), request->getSetName(), errMsg);
+                    if (res == false) {
+                        std::cout << errMsg << std::endl;
+                    }
+                } else if (res) {
+                    pthread_mutex_lock(&mutex);
+                    StatisticsPtr stats = getFunctionality<QuerySchedulerServer>().getStats();
+                    if (stats == nullptr) {
+                        getFunctionality<QuerySchedulerServer>().collectStats();
+                        stats = getFunctionality<QuerySchedulerServer>().getStats();
+                    }
+                    stats->incrementNumPages(request->getDatabaseName(),
+                                             request->getSetName(),
+                                             request->getNumPages());
+                    stats->incrementNumBytes(request->getDatabaseName(),
+                                             request->getSetName(),
+                                             request->getNumBytes());
+                    stats->incrementNumTuples(request->getDatabaseName(),
+                                              request->getSetName(),
+                                              request->getNumObjects());
+                    if (request->getNumDistinctKeys() > 0) {
+                        stats->setNumDistinctKeys(request->getDatabaseName(),
+                                                  request->getSetName(),
+                                                  request->getKeyName(),
+                                                  request->getNumDistinctKeys());
+                    }
+                    pthread_mutex_unlock(&mutex);
+                }
 
                 Handle<SimpleRequestResult> response = makeObject<SimpleRequestResult>(res, errMsg);
                 res = sendUsingMe->sendObject(response, errMsg);
@@ -196,6 +273,51 @@ void DispatcherServer::registerStorageNodes(
     }
 }
 
+bool DispatcherServer::registerKeyPartition(std::string databaseName,
+                                            std::string setName,
+                                            std::string partitionScheme,
+                                            std::string partitionKey,
+                                            std::string& errMsg) {
+    if (partitionScheme.empty()) {
+        errMsg = "No partition scheme for set " + setName + ":" + databaseName;
+        return false;
+    }
+    if (statisticsDB->createDataPartitioning(
+            std::pair<std::string, std::string>(databaseName, setName),
+            partitionScheme,
+            partitionKey) == false) {
+        errMsg = "Can't record the partitioning of set " + setName + ":" + databaseName;
+        return false;
+    }
+    pthread_mutex_lock(&mutex);
+    StatisticsPtr stats = getFunctionality<QuerySchedulerServer>().getStats();
+    if (stats == nullptr) {
+        getFunctionality<QuerySchedulerServer>().collectStats();
+        stats = getFunctionality<QuerySchedulerServer>().getStats();
+    }
+    stats->setPartitioning(databaseName, setName, partitionScheme, partitionKey);
+    pthread_mutex_unlock(&mutex);
+    PDB_COUT << "Set " << setName << ":" << databaseName << " is partitioned on " << partitionKey
+             << " with " << partitionScheme << std::endl;
+    return true;
+}
+
+bool DispatcherServer::isKeyPartitioned(std::string databaseName,
+                                        std::string setName,
+                                        std::string& errMsg) {
+    std::string partitionScheme;
+    std::string partitionKey;
+    if (statisticsDB->getDataPartitioning(
+            std::pair<std::string, std::string>(databaseName, setName),
+            partitionScheme,
+            partitionKey)) {
+        errMsg = "Set " + setName + ":" + databaseName + " is partitioned on " + partitionKey +
+            ", its data must be sent by a client that has its partition policy";
+        return true;
+    }
+    return false;
+}
+
 void DispatcherServer::registerSet(std::pair<std::string, std::string> setAndDatabase,
                                    PartitionPolicyPtr partitionPolicy) {
     if (partitionPolicies.find(setAndDatabase) != partitionPolicies.end()) {
@@ -294,6 +416,24 @@ bool DispatcherServer::validateTypes(const std::string& databaseName,
     return true;
 }
 
+bool DispatcherServer::setStoresType(const std::string& databaseName,
+                                     const std::string& setName,
+                                     const std::string& typeName,
+                                     std::string& errMsg) {
+    std::string storedType =
+        getFunctionality<CatalogClient>().getObjectType(databaseName, setName, errMsg);
+    if (storedType == "") {
+        errMsg = "Set " + setName + ":" + databaseName + " cannot be found in the catalog";
+        return false;
+    }
+    if (storedType != typeName) {
+        errMsg = "Loaded type " + typeName + " does not match type " + storedType +
+            " stored in set " + setName + ":" + databaseName;
+        return false;
+    }
+    return true;
+}
+
 bool DispatcherServer::sendData(std::pair<std::string, std::string> setAndDatabase,
                                 std::string type,
                                 Handle<NodeDispatcherData> destination,
@@ -55,7 +55,7 @@
 #include <chrono>
 #include <ctime>
 #include <unistd.h>
-#include <snappy.h>
+#include "PageCodec.h"
 
 #define USING_ALL_NODES
 
@@ -621,6 +621,8 @@ void DistributedStorageManagerServer::registerHandlers(PDBServer& forMe) {
                 stats = getFunctionality<QuerySchedulerServer>().getStats();
             }
             stats->removeSet(request->getDatabase(), request->getSetName());
+            this->statisticsDB->removeDataPartitioning(std::pair<std::string, std::string>(
+                request->getDatabase(), request->getSetName()));
 
             if (failureNodes.empty()) {
                 // If all the nodes succeeded in removing the set then we can simply delete the set
@@ -912,6 +914,16 @@ void DistributedStorageManagerServer::registerHandlers(PDBServer& forMe) {
                         communicator = nullptr;
                         break;
                     }
+                    // a page comes as the header of its frame and then its encoded bytes, both
+                    // are forwarded as they are
+                    PageFrameHeader header;
+                    if (!PageCodec::receiveHeader(communicator, header, errMsg) ||
+                        !sendUsingMe->sendBytes(&header, sizeof(PageFrameHeader), errMsg)) {
+                        std::cout << "Problem forwarding a page header: " << errMsg << std::endl;
+                        communicator = nullptr;
+                        break;
+                    }
+                    objSize = communicator->getSizeOfNextObject();
                     curPage = (char*)malloc(objSize);
                     if (!communicator->receiveBytes(curPage, errMsg)) {
                         std::cout << "Problem getting data from slave: " << errMsg << std::endl;
@@ -27,6 +27,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
 #include <string>
 #include "PDBDebug.h"
 #include "FrontendQueryTestServer.h"
@@ -47,7 +50,8 @@
 #include "AggregationJobStage.h"
 #include "BroadcastJoinBuildHTJobStage.h"
 #include "HashPartitionedJoinBuildHTJobStage.h"
-#include <snappy.h>
+#include "PageCodec.h"
+#include "SetScanStream.h"
 
 namespace pdb {
 
@@ -149,6 +153,7 @@ void FrontendQueryTestServer::registerHandlers(PDBServer &forMe) {
         if (inputSet->getNumPages() == 0) {
           std::cout << "WARNING: repartitioned data size is 0" << std::endl;
         }
+        Handle<Vector<uint64_t>> runtimeFilters = nullptr;
 
         if (!communicatorToBackend->sendObject(newRequest, errMsg)) {
           std::cout << errMsg << std::endl;
@@ -157,11 +162,21 @@ void FrontendQueryTestServer::registerHandlers(PDBServer &forMe) {
         } else {
           PDB_COUT << "Frontend sent request to backend" << std::endl;
           // wait for backend to finish.
-          communicatorToBackend->getNextObject<SimpleRequestResult>(success, errMsg);
+          Handle<SimpleRequestResult> backendResult =
+              communicatorToBackend->getNextObject<SimpleRequestResult>(success, errMsg);
           if (!success) {
             std::cout << "Error waiting for backend to finish this job stage. " << errMsg
                       << std::endl;
             errMsg = std::string("backend failure: ") + errMsg;
+          } else if (backendResult->getRes().first) {
+            // the backend sends the runtime filters of the partitions after a successful build
+            runtimeFilters =
+                communicatorToBackend->getNextObject<Vector<uint64_t>>(success, errMsg);
+            if (!success) {
+              std::cout << "Error receiving the runtime filters from backend. " << errMsg
+                        << std::endl;
+              errMsg = std::string("backend failure: ") + errMsg;
+            }
           }
         }
 
@@ -170,6 +185,9 @@ void FrontendQueryTestServer::registerHandlers(PDBServer &forMe) {
         Handle<SetIdentifier> result = makeObject<SetIdentifier>(inDatabaseName, inSetName);
         result->setNumPages(inputSet->getNumPages());
         result->setPageSize(inputSet->getPageSize());
+        if ((success == true) && (runtimeFilters != nullptr)) {
+          result->setRuntimeFilters(runtimeFilters);
+        }
         if (success == true) {
           PDB_COUT << "Stage is done. " << std::endl;
           errMsg = std::string("execution complete");
@@ -626,6 +644,7 @@ void FrontendQueryTestServer::registerHandlers(PDBServer &forMe) {
 
         bool needsRemoveCombinerSet = false;
         SetPtr combinerSet = nullptr;
+        Handle<Vector<uint64_t>> shuffleSkew = nullptr;
         std::string combinerDatabaseName;
         std::string combinerSetName;
         if (request->getCombinerContext() != nullptr) {
@@ -673,11 +692,22 @@ void FrontendQueryTestServer::registerHandlers(PDBServer &forMe) {
           } else {
             PDB_COUT << "Frontend sent request to backend" << std::endl;
             // wait for backend to finish.
-            communicatorToBackend->getNextObject<SimpleRequestResult>(success, errMsg);
+            Handle<SimpleRequestResult> backendResult =
+                communicatorToBackend->getNextObject<SimpleRequestResult>(success, errMsg);
             if (!success) {
               std::cout << "Error waiting for backend to finish this job stage. "
                         << errMsg << std::endl;
               errMsg = std::string("backend failure: ") + errMsg;
+            } else if (backendResult->getRes().first && newRequest->isRepartition()) {
+              // the backend sends the skew of the shuffle after it, with the keys it split, which
+              // the other side of a join needs, so the stage fails without it
+              shuffleSkew =
+                  communicatorToBackend->getNextObject<Vector<uint64_t>>(success, errMsg);
+              if (!success) {
+                std::cout << "Error receiving the shuffle skew from backend. " << errMsg
+                          << std::endl;
+                errMsg = std::string("backend failure: ") + errMsg;
+              }
             }
           }
         }
@@ -692,6 +722,9 @@ void FrontendQueryTestServer::registerHandlers(PDBServer &forMe) {
         Handle<SetIdentifier> result = makeObject<SetIdentifier>(outDatabaseName, outSetName);
         result->setNumPages(outputSet->getNumPages());
         result->setPageSize(outputSet->getPageSize());
+        if ((success == true) && (shuffleSkew != nullptr) && (shuffleSkew->size() > 0)) {
+          result->setShuffleSkew(shuffleSkew);
+        }
         if (success == true) {
           PDB_COUT << "Stage is done. " << std::endl;
           errMsg = std::string("execution complete");
@@ -749,6 +782,10 @@ void FrontendQueryTestServer::registerHandlers(PDBServer &forMe) {
         // this is the number of pages
         std::string whichDatabase = request->getDatabase();
         std::string whichSet = request->getSetName();
+        // with a window, the pages are streamed, and the client gives a credit for every page
+        int windowSize = request->getWindowSize();
+        int numUnacknowledged = 0;
+        bool stopped = false;
         PDB_COUT << "we are now iterating set:" << whichSet << std::endl;
         // and keep looping while someone wants to get the output
         SetPtr loopingSet = getFunctionality<PangeaStorageServer>().getSet(
@@ -763,11 +800,21 @@ void FrontendQueryTestServer::registerHandlers(PDBServer &forMe) {
         }
         loopingSet->setPinned(true);
         vector<PageIteratorPtr> *pageIters = loopingSet->getIterators();
+        // the codec for the pages sent to the client
+        ConfigurationPtr conf = getFunctionality<PangeaStorageServer>().getConf();
+        PageCodecPtr codec =
+            make_shared<PageCodec>(conf->getTransferCodec(), conf->getNetworkBandwidth());
+        if (windowSize > 0) {
+          // a frame header is followed right away by its page, don't let Nagle hold it back
+          int noDelay = 1;
+          setsockopt(sendUsingMe->getSocketFD(), IPPROTO_TCP, TCP_NODELAY, &noDelay,
+                     sizeof(noDelay));
+        }
         // loop through all pages
         int numIterators = pageIters->size();
-        for (int i = 0; i < numIterators; i++) {
+        for (int i = 0; (i < numIterators) && !stopped; i++) {
           PageIteratorPtr iter = pageIters->at(i);
-          while (iter->hasNext()) {
+          while (!stopped && iter->hasNext()) {
             PDBPagePtr nextPage = iter->next();
             // send the relevant page.
             if (nextPage != nullptr) {
@@ -795,32 +842,27 @@ void FrontendQueryTestServer::registerHandlers(PDBServer &forMe) {
               int vecSize = inputVec->size();
               if (vecSize != 0) {
                 const UseTemporaryAllocationBlock tempBlock{2048};
-#ifdef ENABLE_COMPRESSION
                 char *newRecord = (char *) calloc(nextPage->getSize(), 1);
                 myRec = getRecord(inputVec, newRecord, nextPage->getSize());
-                char *compressedBytes =
-                    new char[snappy::MaxCompressedLength(myRec->numBytes())];
-                size_t compressedSize;
-                snappy::RawCompress((char *) (myRec),
-                                    myRec->numBytes(),
-                                    compressedBytes,
-                                    &compressedSize);
-                std::cout << "Frontend=>Client: size before compression is "
-                          << myRec->numBytes() << " and size after compression is "
-                          << compressedSize << std::endl;
-                sendUsingMe->sendBytes(compressedBytes, compressedSize, errMsg);
-
-                delete[] compressedBytes;
+                bool sent = codec->send(sendUsingMe, myRec, myRec->numBytes(), errMsg);
                 free(newRecord);
-#else
-                if (!sendUsingMe->sendBytes(
-                                    nextPage->getBytes(), nextPage->getSize(), errMsg)) {
-                                return std::make_pair(false, errMsg);
-                            }
-#endif
+                if (!sent) {
+                  return std::make_pair(false, errMsg);
+                }
                 // see whether or not the client wants to see more results
                 bool success;
-                if (sendUsingMe->getObjectTypeID() != DoneWithResult_TYPEID) {
+                if (windowSize > 0) {
+                  // streamed, only wait for the client once it has window pages to take
+                  numUnacknowledged++;
+                  while (!stopped && (numUnacknowledged >= windowSize)) {
+                    int numTaken;
+                    if (!SetScanStream::receiveCredit(sendUsingMe, numTaken, errMsg)) {
+                      return std::make_pair(false, errMsg);
+                    }
+                    numUnacknowledged -= numTaken;
+                    stopped = (numTaken <= 0);
+                  }
+                } else if (sendUsingMe->getObjectTypeID() != DoneWithResult_TYPEID) {
                   Handle<KeepGoing> temp =
                       sendUsingMe->getNextObject<KeepGoing>(success, errMsg);
                   PDB_COUT << "Keep going" << std::endl;
@@ -861,8 +903,18 @@ void FrontendQueryTestServer::registerHandlers(PDBServer &forMe) {
         if (!sendUsingMe->sendObject(temp, errMsg)) {
           return std::make_pair(false, "could not send done message: " + errMsg);
         }
+        // the credits for the pages the client has not taken yet
+        while ((windowSize > 0) && !stopped && (numUnacknowledged > 0)) {
+          int numTaken;
+          if (!SetScanStream::receiveCredit(sendUsingMe, numTaken, errMsg)) {
+            return std::make_pair(false, errMsg);
+          }
+          numUnacknowledged -= numTaken;
+          stopped = (numTaken <= 0);
+        }
         // we got to here means success!!  We processed the query, and got all of the results
-        std::cout << "We have finished scanning this set" << std::endl;
+        std::cout << "We have finished scanning this set, sent "
+                  << codec->getStats().toString() << std::endl;
         return std::make_pair(true, std::string("query completed!!"));
       }));
 }
@@ -41,9 +41,13 @@
 #include "HashPartitionedJoinBuildHTJobStage.h"
 #include "PipelineStage.h"
 #include "PartitionedHashSet.h"
+#include "SpillingAggregation.h"
+#include "SpillingHashJoin.h"
 #include "SharedHashSet.h"
 #include "JoinMap.h"
+#include "BlockedBloomFilter.h"
 #include "RecordIterator.h"
+#include <limits>
 #include <vector>
 
 #ifndef JOIN_HASH_TABLE_SIZE_RATIO
@@ -216,8 +220,11 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
 #ifdef AUTO_TUNING
           size_t memSize = request->getTotalMemoryOnThisNode();
           size_t sharedMemPoolSize = conf->getShmSize();
-          if (hashSetSize > (memSize - sharedMemPoolSize) * 0.8) {
-            hashSetSize = (memSize - sharedMemPoolSize) * 0.8;
+          // the memory is shared with the stages that build on this node at the same time
+          size_t reservedSize = getFunctionality<HermesExecutionServer>().reserveHashSetMemory(
+              request->getHashSetName(), memSize - sharedMemPoolSize, hashSetSize, 0.8);
+          if (reservedSize < hashSetSize) {
+            hashSetSize = reservedSize;
             std::cout << "WARNING: no more memory on heap can be allocated for hash set, "
                 "we reduce hash set size."
                       << std::endl;
@@ -329,6 +336,11 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
             sourceTupleSetSpecifier, targetTupleSetSpecifier, targetComputationSpecifier);
         Handle<Object> myMap = merger->createNewOutputContainer();
 
+        // the keys also go to a runtime filter for the side that probes the hash table
+        BlockedBloomFilterPtr runtimeFilter =
+            std::make_shared<BlockedBloomFilter>(JOIN_RUNTIME_FILTER_MAX_BYTES);
+        merger->setRuntimeFilter(runtimeFilter);
+
         // setup an output page to store intermediate results and final output
         PageCircularBufferIteratorPtr iter = iterators.at(0);
         PDBPagePtr page = nullptr;
@@ -356,6 +368,17 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
 
         getAllocator().setPolicy(AllocatorPolicy::defaultAllocator);
 
+        merger->setRuntimeFilter(nullptr);
+        runtimeFilter->shrink();
+        if (runtimeFilter->isSelective()) {
+          std::vector<BlockedBloomFilterPtr> runtimeFilters{runtimeFilter};
+          sharedHashSet->setRuntimeFilters(runtimeFilters);
+        }
+        std::cout << "BroadcastJoinBuildHTJobStage: runtime filter of "
+                  << runtimeFilter->getNumInserted() << " keys in "
+                  << runtimeFilter->getNumBytes() << " bytes, "
+                  << (runtimeFilter->isSelective() ? "used" : "not selective") << std::endl;
+
         if (this->setCurPageScanner(nullptr) == false) {
           success = false;
           errMsg = "Error: No job is running!";
@@ -379,7 +402,7 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                                                                getAllocator().cleanInactiveBlocks((size_t) ((size_t) 32 * (size_t) 1024 * (size_t) 1024));
                                                                getAllocator().cleanInactiveBlocks((size_t) ((size_t) 256 * (size_t) 1024 * (size_t) 1024));
                                                                const UseTemporaryAllocationBlock block{32 * 1024 * 1024};
-                                                               bool success;
+                                                               bool success = true;
                                                                std::string errMsg;
 
                                                                std::cout << "Backend got Aggregation JobStage message with Id="
@@ -400,27 +423,29 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                                                                double ratio = 0.8;
 #endif
 
+                                                               // the heap memory the partitions aggregate into is reserved under the name of the hash
+                                                               // set they may be kept in, as other stages may build on this node at the same time
+                                                               Handle<SetIdentifier> sinkSetIdentifier = request->getSinkContext();
+                                                               std::string reservationName =
+                                                                   std::string(sinkSetIdentifier->getDatabase()) + ":" + std::string(sinkSetIdentifier->getSetName());
+
 #ifdef AUTO_TUNING
                                                                size_t memSize = request->getTotalMemoryOnThisNode();
                                                                size_t sharedMemPoolSize = conf->getShmSize();
-
-#ifdef ENABLE_LARGE_GRAPH
-                                                               size_t tunedHashPageSize =
-                                                                   (double) (memSize * ((size_t) (1024)) - sharedMemPoolSize -
-                                                                       ((size_t) (conf->getNumThreads()) * (size_t) (256) * (size_t) (1024) *
-                                                                           (size_t) (1024)) -
-                                                                       getFunctionality<HermesExecutionServer>().getHashSetsSize()) *
-                                                                       (ratio) / (double) (numPartitions);
-#else
-                                                               size_t tunedHashPageSize =
-                                                                   (double)(memSize * ((size_t)(1024)) - sharedMemPoolSize -
-                                                                            getFunctionality<HermesExecutionServer>().getHashSetsSize()) *
-                                                                   (ratio) / (double)(numPartitions);
-#endif
+                                                               size_t tunedHashPageSize = conf->getHashPageSize();
                                                                if (memSize * ((size_t) (1024)) <
                                                                    sharedMemPoolSize + (size_t) 512 * (size_t) 1024 * (size_t) 1024) {
                                                                  std::cout << "WARNING: Auto tuning can not work, use default values" << std::endl;
-                                                                 tunedHashPageSize = conf->getHashPageSize();
+                                                               } else {
+#ifdef ENABLE_LARGE_GRAPH
+                                                                 size_t availableSize = memSize * ((size_t) (1024)) - sharedMemPoolSize -
+                                                                     ((size_t) (conf->getNumThreads()) * (size_t) (256) * (size_t) (1024) * (size_t) (1024));
+#else
+                                                                 size_t availableSize = memSize * ((size_t) (1024)) - sharedMemPoolSize;
+#endif
+                                                                 tunedHashPageSize = (double) getFunctionality<HermesExecutionServer>().reserveHashSetMemory(
+                                                                     reservationName, availableSize, std::numeric_limits<size_t>::max(), ratio) /
+                                                                     (double) (numPartitions);
                                                                }
                                                                std::cout << "Tuned hash page size is " << tunedHashPageSize << std::endl;
                                                                conf->setHashPageSize(tunedHashPageSize);
@@ -451,14 +476,12 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                                                                    });
                                                                std::cout << "to run aggregation with " << numPartitions << " threads." << std::endl;
                                                                int hashCounter = 0;
-
+                                                               // set by a thread whose groups could not all be spilled, then the stage fails
+                                                               bool spillFailed = false;
                                                                std::string hashSetName = "";
                                                                PartitionedHashSetPtr aggregationSet = nullptr;
                                                                if (request->needsToMaterializeAggOut() == false) {
-                                                                 Handle<SetIdentifier> sinkSetIdentifier = request->getSinkContext();
-                                                                 std::string dbName = sinkSetIdentifier->getDatabase();
-                                                                 std::string setName = sinkSetIdentifier->getSetName();
-                                                                 hashSetName = dbName + ":" + setName;
+                                                                 hashSetName = reservationName;
                                                                  aggregationSet =
                                                                      make_shared<PartitionedHashSet>(hashSetName, this->conf->getHashPageSize());
                                                                  this->addHashSet(hashSetName, aggregationSet);
@@ -515,10 +538,16 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                                                                    SimpleSingleTableQueryProcessorPtr aggregateProcessor =
                                                                        newAgg->getAggregationProcessor((HashPartitionID) (i));
                                                                    aggregateProcessor->initialize();
+                                                                   // the groups of this partition that do not fit in its page are spilled to temp sets named
+                                                                   // after this
+                                                                   std::string spillSetPrefix = request->getSinkContext()->getDatabase() + "_" +
+                                                                       request->getSinkContext()->getSetName() + "_aggregationSpill_" + std::to_string(i);
                                                                    PageCircularBufferIteratorPtr myIter = hashIters[i];
                                                                    if (request->needsToMaterializeAggOut() == false) {
 
                                                                      void *outBytes = nullptr;
+                                                                     SpillingAggregation spiller(
+                                                                         aggregateProcessor, proxy, spillSetPrefix, aggregationSet->getPageSize(), logger);
                                                                      while (myIter->hasNext()) {
                                                                        PDBPagePtr page = myIter->next();
                                                                        if (page != nullptr) {
@@ -544,7 +573,11 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                                                                              aggregateProcessor->loadOutputPage(
                                                                                  outBytes, aggregationSet->getPageSize());
                                                                            }
-                                                                           if (aggregateProcessor->fillNextOutputPage()) {
+                                                                           bool isFull = aggregateProcessor->fillNextOutputPage();
+                                                                           while (isFull && spiller.spill(outBytes)) {
+                                                                             isFull = aggregateProcessor->fillNextOutputPage();
+                                                                           }
+                                                                           if (isFull) {
                                                                              aggregateProcessor->clearOutputPage();
                                                                              std::cout
                                                                                  << "WARNING: aggregation for partition-" << i
@@ -573,9 +606,28 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                                                                        }
                                                                      }
                                                                      if (outBytes != nullptr) {
-                                                                       aggregateProcessor->finalize();
-                                                                       aggregateProcessor->fillNextOutputPage();
-                                                                       aggregateProcessor->clearOutputPage();
+                                                                       if (spiller.hasSpilled()) {
+                                                                         // every bucket is aggregated into a page of its own in the hash set
+                                                                         spiller.aggregateSpilled(
+                                                                             [&]() {
+                                                                               void *newPage = aggregationSet->addPage();
+                                                                               if (newPage == nullptr) {
+                                                                                 std::cout << "insufficient memory in heap" << std::endl;
+                                                                                 exit(-1);
+                                                                               }
+                                                                               return newPage;
+                                                                             },
+                                                                             [&](void *aggregatedPage) {});
+                                                                       } else {
+                                                                         aggregateProcessor->finalize();
+                                                                         aggregateProcessor->fillNextOutputPage();
+                                                                         aggregateProcessor->clearOutputPage();
+                                                                       }
+                                                                     }
+                                                                     if (spiller.hasFailed()) {
+                                                                       pthread_mutex_lock(&connection_mutex);
+                                                                       spillFailed = true;
+                                                                       pthread_mutex_unlock(&connection_mutex);
                                                                      }
 
                                                                    } else {
@@ -592,6 +644,8 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                                                                      size_t aggregationPageSize = conf->getHashPageSize();
                                                                      // allocate one output page
                                                                      void *aggregationPage = nullptr;
+                                                                     SpillingAggregation spiller(
+                                                                         aggregateProcessor, proxy, spillSetPrefix, aggregationPageSize, logger);
 
                                                                      // get aggOut processor
                                                                      SimpleSingleTableQueryProcessorPtr aggOutProcessor =
@@ -620,7 +674,11 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                                                                              aggregateProcessor->loadOutputPage(aggregationPage,
                                                                                                                 aggregationPageSize);
                                                                            }
-                                                                           if (aggregateProcessor->fillNextOutputPage()) {
+                                                                           bool isFull = aggregateProcessor->fillNextOutputPage();
+                                                                           while (isFull && spiller.spill(aggregationPage)) {
+                                                                             isFull = aggregateProcessor->fillNextOutputPage();
+                                                                           }
+                                                                           if (isFull) {
                                                                              std::cout
                                                                                  << "WARNING: aggregation for partition-" << i
                                                                                  << " can't finish in one aggregation page with size="
@@ -683,36 +741,45 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                                                                        }
                                                                      }
                                                                      if (aggregationPage != nullptr) {
-                                                                       // finalize()
-                                                                       aggregateProcessor->finalize();
-                                                                       aggregateProcessor->fillNextOutputPage();
-                                                                       // load input page
-                                                                       aggOutProcessor->loadInputPage(aggregationPage);
-                                                                       // get output page
-                                                                       if (output == nullptr) {
-                                                                         proxy->addUserPage(outputSet->getDatabaseId(),
-                                                                                            outputSet->getTypeId(),
-                                                                                            outputSet->getSetId(),
-                                                                                            output);
-                                                                         aggOutProcessor->loadOutputPage(output->getBytes(),
-                                                                                                         output->getSize());
-                                                                       }
-                                                                       while (aggOutProcessor->fillNextOutputPage()) {
-                                                                         aggOutProcessor->clearOutputPage();
-                                                                         // unpin the output page
-                                                                         proxy->unpinUserPage(nodeId,
-                                                                                              outputSet->getDatabaseId(),
+                                                                       // writes the groups in an aggregation page to the output set
+                                                                       auto writeAggregationPage = [&](void *aggregatedPage) {
+                                                                         // load input page
+                                                                         aggOutProcessor->loadInputPage(aggregatedPage);
+                                                                         // get output page
+                                                                         if (output == nullptr) {
+                                                                           proxy->addUserPage(outputSet->getDatabaseId(),
                                                                                               outputSet->getTypeId(),
                                                                                               outputSet->getSetId(),
                                                                                               output);
-                                                                         // pin a new output page
-                                                                         proxy->addUserPage(outputSet->getDatabaseId(),
-                                                                                            outputSet->getTypeId(),
-                                                                                            outputSet->getSetId(),
-                                                                                            output);
-                                                                         // load output
-                                                                         aggOutProcessor->loadOutputPage(output->getBytes(),
-                                                                                                         output->getSize());
+                                                                           aggOutProcessor->loadOutputPage(output->getBytes(),
+                                                                                                           output->getSize());
+                                                                         }
+                                                                         while (aggOutProcessor->fillNextOutputPage()) {
+                                                                           aggOutProcessor->clearOutputPage();
+                                                                           // unpin the output page
+                                                                           proxy->unpinUserPage(nodeId,
+                                                                                                outputSet->getDatabaseId(),
+                                                                                                outputSet->getTypeId(),
+                                                                                                outputSet->getSetId(),
+                                                                                                output);
+                                                                           // pin a new output page
+                                                                           proxy->addUserPage(outputSet->getDatabaseId(),
+                                                                                              outputSet->getTypeId(),
+                                                                                              outputSet->getSetId(),
+                                                                                              output);
+                                                                           // load output
+                                                                           aggOutProcessor->loadOutputPage(output->getBytes(),
+                                                                                                           output->getSize());
+                                                                         }
+                                                                       };
+                                                                       if (spiller.hasSpilled()) {
+                                                                         // every bucket is aggregated in the aggregation page in turn
+                                                                         spiller.aggregateSpilled([&]() { return aggregationPage; }, writeAggregationPage);
+                                                                       } else {
+                                                                         // finalize()
+                                                                         aggregateProcessor->finalize();
+                                                                         aggregateProcessor->fillNextOutputPage();
+                                                                         writeAggregationPage(aggregationPage);
                                                                        }
 
                                                                        // finalize() and unpin last output page
@@ -728,6 +795,11 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                                                                        aggregateProcessor->clearOutputPage();
                                                                        free(aggregationPage);
                                                                      }  // aggregationPage != nullptr
+                                                                     if (spiller.hasFailed()) {
+                                                                       pthread_mutex_lock(&connection_mutex);
+                                                                       spillFailed = true;
+                                                                       pthread_mutex_unlock(&connection_mutex);
+                                                                     }
 
                                                                    }  // request->needsToMaterializeAggOut() == true
                                                                    getAllocator().setPolicy(AllocatorPolicy::defaultAllocator);
@@ -855,8 +927,18 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                                                                  hashBuzzer->wait();
                                                                }
 
+                                                               // the memory of a hash set is released when it is removed
+                                                               if (request->needsToMaterializeAggOut()) {
+                                                                 getFunctionality<HermesExecutionServer>().releaseHashSetMemory(reservationName);
+                                                               }
+
                                                                // reset scanner
                                                                pthread_mutex_destroy(&connection_mutex);
+                                                               if (spillFailed) {
+                                                                 success = false;
+                                                                 errMsg = "Error: the spilled groups could not be aggregated, the results would not be complete";
+                                                                 std::cout << errMsg << std::endl;
+                                                               }
 
                                                                if (getFunctionality<HermesExecutionServer>().setCurPageScanner(nullptr) == false) {
                                                                  success = false;
@@ -884,7 +966,7 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
           Handle<HashPartitionedJoinBuildHTJobStage> request, PDBCommunicatorPtr sendUsingMe) {
         getAllocator().cleanInactiveBlocks((size_t) ((size_t) 256 * (size_t) 1024 * (size_t) 1024));
         const UseTemporaryAllocationBlock block{32 * 1024 * 1024};
-        bool success;
+        bool success = true;
         std::string errMsg;
 
         std::cout << "Backend got HashPartitionedJoinBuildHTJobStage message with Id="
@@ -916,13 +998,38 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
         PartitionedHashSetPtr partitionedSet = make_shared<PartitionedHashSet>(hashSetName, hashSetSize);
         this->addHashSet(hashSetName, partitionedSet);
         std::cout << "Added hash set for HashPartitionedJoin to probe" << std::endl;
-        for (int i = 0; i < numPartitions; i++) {
+        // the partitions that do not get a page, or whose page gets full, are spilled to temp
+        // sets and joined in a second pass
+        int numResidentPartitions = numPartitions;
+#ifdef AUTO_TUNING
+        size_t memSize = request->getTotalMemoryOnThisNode();
+        size_t sharedMemPoolSize = conf->getShmSize();
+        if (memSize * ((size_t) (1024)) >=
+            sharedMemPoolSize + (size_t) 512 * (size_t) 1024 * (size_t) 1024) {
+          // the budget is shared with the stages that build on this node at the same time
+          size_t memBudget = getFunctionality<HermesExecutionServer>().reserveHashSetMemory(
+              hashSetName, memSize * ((size_t) (1024)) - sharedMemPoolSize,
+              hashSetSize * (size_t) numPartitions, 0.8);
+          if (memBudget < hashSetSize * (size_t) numPartitions) {
+            numResidentPartitions = (int) (memBudget / hashSetSize);
+          }
+        }
+#endif
+        for (int i = 0; i < numResidentPartitions; i++) {
           void *bytes = partitionedSet->addPage();
           if (bytes == nullptr) {
-            std::cout << "Insufficient memory in heap" << std::endl;
-            exit(1);
+            numResidentPartitions = i;
+            break;
           }
         }
+        if (numResidentPartitions < numPartitions) {
+          std::cout << "WARNING: only " << numResidentPartitions << " out of " << numPartitions
+                    << " partitions of the hash table fit in memory, the others are spilled"
+                    << std::endl;
+        }
+        SpillingHashJoinPtr spillingHashJoin =
+            make_shared<SpillingHashJoin>(hashSetName + "_joinSpill", numPartitions, logger);
+        partitionedSet->setSpillingHashJoin(spillingHashJoin);
         // create multiple page circular queues
         int buildingHTBufferSize = 2;
         std::vector<PageCircularBufferPtr> hashBuffers;
@@ -953,9 +1060,17 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
         std::string targetTupleSetSpecifier = request->getTargetTupleSetSpecifier();
         std::string targetComputationSpecifier = request->getTargetComputationSpecifier();
         Handle<ComputePlan> myComputePlan = request->getComputePlan();
-        SinkMergerPtr merger = myComputePlan->getMerger(sourceTupleSetSpecifier,
-                                                        targetTupleSetSpecifier,
-                                                        targetComputationSpecifier);
+
+        // a runtime filter for every partition, for the side that probes the hash table
+        std::vector<BlockedBloomFilterPtr> runtimeFilters(numPartitions);
+
+        // a merger for every partition, as it keeps where it is in what it spills
+        std::vector<SinkMergerPtr> mergers;
+        for (int i = 0; i < numPartitions; i++) {
+          mergers.push_back(myComputePlan->getMerger(sourceTupleSetSpecifier,
+                                                     targetTupleSetSpecifier,
+                                                     targetComputationSpecifier));
+        }
 
         // start multiple threads, with each thread have a queue and check pages in the queue
         // each page has a vector of JoinMap
@@ -987,9 +1102,19 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
 
             std::string errMsg;
 
-            // make allocator block and allocate the JoinMap
-            const UseTemporaryAllocationBlock tempBlock(partitionedSet->getPage(i),
-                                                        hashSetSize);
+            // make allocator block and allocate the JoinMap, if this partition has a page
+            void *myPage = partitionedSet->getPage(i);
+            runtimeFilters[i] = make_shared<BlockedBloomFilter>(
+                JOIN_RUNTIME_FILTER_MAX_BYTES / numPartitions);
+            mergers[i]->setRuntimeFilter(runtimeFilters[i]);
+            spillingHashJoin->startBuild(i, mergers[i], myPage != nullptr);
+            UseTemporaryAllocationBlockPtr tempBlock = nullptr;
+            Handle<Object> myMap = nullptr;
+            if (myPage != nullptr) {
+              tempBlock = make_shared<UseTemporaryAllocationBlock>(myPage, hashSetSize);
+              getAllocator().setPolicy(AllocatorPolicy::noReuseAllocator);
+              myMap = mergers[i]->createNewOutputContainer();
+            }
 #ifdef PROFILING
             std::string out = getAllocator().printInactiveBlocks();
             logger->warn(out);
@@ -999,8 +1124,6 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
             std::cout << out << std::endl;
 #endif
             PDB_COUT << "hashSetSize = " << hashSetSize << std::endl;
-            getAllocator().setPolicy(AllocatorPolicy::noReuseAllocator);
-            Handle<Object> myMap = merger->createNewOutputContainer();
 
             // setup an output page to store intermediate results and final output
             PageCircularBufferIteratorPtr myIter = hashIters[i];
@@ -1014,7 +1137,10 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                   Record<Object> *record = recordIter->next();
                   if (record != nullptr) {
                     Handle<Object> mapsToMerge = record->getRootObject();
-                    merger->writeVectorOut(mapsToMerge, myMap);
+                    if (spillingHashJoin->addBuildMaps(i, mapsToMerge, myMap, proxy) == false) {
+                      logger->error("HashPartitionedJoinBuildHTJobStage: failed to spill "
+                                    "partition " + std::to_string(i));
+                    }
                   }
                 }
                 // unpin the input page
@@ -1031,10 +1157,18 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
                 PDB_COUT << "####Scanner got a null page" << std::endl;
               }
             }
-            PDB_COUT << "To get record" << std::endl;
-            getRecord(myMap);
-
-            getAllocator().setPolicy(AllocatorPolicy::defaultAllocator);
+            spillingHashJoin->finishBuild(i, proxy);
+            // all of the keys are in, the spilled ones too, as they went through the merger
+            mergers[i]->setRuntimeFilter(nullptr);
+            runtimeFilters[i]->shrink();
+            if (myPage != nullptr) {
+              PDB_COUT << "To get record" << std::endl;
+              getRecord(myMap);
+              getAllocator().setPolicy(AllocatorPolicy::defaultAllocator);
+
+              // let go of the page before the handles to it
+              tempBlock = nullptr;
+            }
 #ifdef PROFILING
             out = getAllocator().printInactiveBlocks();
             std::cout << "HashPartitionedJoinBuildHTJobStage-backend-thread: print "
@@ -1159,6 +1293,11 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
 
         // reset scanner
         pthread_mutex_destroy(&connection_mutex);
+        if (spillingHashJoin->hasFailed()) {
+          success = false;
+          errMsg = "Error: the build side of the join does not fit in a hash table or a spill page";
+          std::cout << errMsg << std::endl;
+        }
 
         if (getFunctionality<HermesExecutionServer>().setCurPageScanner(nullptr) == false) {
           success = false;
@@ -1169,10 +1308,28 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
 
         // return result to frontend
         PDB_COUT << "to send back reply" << std::endl;
-        const UseTemporaryAllocationBlock block1{1024};
-        Handle<SimpleRequestResult> response = makeObject<SimpleRequestResult>(success, errMsg);
-        // return the result
-        success = sendUsingMe->sendObject(response, errMsg);
+        bool built = success;
+        {
+          const UseTemporaryAllocationBlock block1{1024};
+          Handle<SimpleRequestResult> response = makeObject<SimpleRequestResult>(success, errMsg);
+          // return the result
+          success = sendUsingMe->sendObject(response, errMsg);
+        }
+
+        // then the runtime filters of the partitions, in order, for the frontend to send to the
+        // master with the result of the stage
+        if (built && success) {
+          size_t numWords = 0;
+          for (int i = 0; i < numPartitions; i++) {
+            numWords += runtimeFilters[i]->getNumBytes() / sizeof(uint64_t) + 1;
+          }
+          const UseTemporaryAllocationBlock block2{numWords * sizeof(uint64_t) + 1024 * 1024};
+          Handle<Vector<uint64_t>> filters = makeObject<Vector<uint64_t>>(numWords);
+          for (int i = 0; i < numPartitions; i++) {
+            BlockedBloomFilter::appendTo(runtimeFilters[i], *filters);
+          }
+          success = sendUsingMe->sendObject(filters, errMsg);
+        }
         return make_pair(success, errMsg);
 
       }));
@@ -1202,6 +1359,7 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
         std::cout << out << std::endl;
 #endif
         Handle<SetIdentifier> sourceContext = request->getSourceContext();
+        ShuffleSkewPtr shuffleSkew = nullptr;
         if (getCurPageScanner() == nullptr) {
           NodeID nodeId = getFunctionality<HermesExecutionServer>().getNodeID();
           pdb::PDBLoggerPtr logger = getFunctionality<HermesExecutionServer>().getLogger();
@@ -1229,6 +1387,11 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
             PDB_COUT << "run pipeline with combiner..." << std::endl;
             pipeline->runPipelineWithShuffleSink(this);
           }
+          shuffleSkew = pipeline->getShuffleSkew();
+          if (pipeline->hasFailed(errMsg)) {
+            res = false;
+            std::cout << errMsg << std::endl;
+          }
           if ((sourceContext->isAggregationResult() == true) &&
               (sourceContext->getSetType() == PartitionedHashSetType)) {
             std::string hashSetName =
@@ -1272,10 +1435,28 @@ void HermesExecutionServer::registerHandlers(PDBServer &forMe) {
           // We do not remove the hash table, so that we can try again.
         }
         PDB_COUT << "to send back reply" << std::endl;
-        const UseTemporaryAllocationBlock block2{1024};
-        Handle<SimpleRequestResult> response = makeObject<SimpleRequestResult>(res, errMsg);
-        // return the result
-        res = sendUsingMe->sendObject(response, errMsg);
+        bool ran = res;
+        {
+          const UseTemporaryAllocationBlock block2{1024};
+          Handle<SimpleRequestResult> response = makeObject<SimpleRequestResult>(res, errMsg);
+          // return the result
+          res = sendUsingMe->sendObject(response, errMsg);
+        }
+
+        // then the skew of the shuffle, for the frontend to send to the master with the result of
+        // the stage; it is empty if the stage did not keep it
+        if (ran && res && request->isRepartition()) {
+          size_t numWords = 1;
+          if (shuffleSkew != nullptr) {
+            numWords += shuffleSkew->getNumPartitions() + 2 * shuffleSkew->getNumSplitKeys();
+          }
+          const UseTemporaryAllocationBlock block3{numWords * sizeof(uint64_t) + 1024 * 1024};
+          Handle<Vector<uint64_t>> report = makeObject<Vector<uint64_t>>(numWords);
+          if (shuffleSkew != nullptr) {
+            shuffleSkew->appendTo(*report);
+          }
+          res = sendUsingMe->sendObject(report, errMsg);
+        }
         return make_pair(res, errMsg);
       }));
 
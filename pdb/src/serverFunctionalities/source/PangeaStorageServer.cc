@@ -63,6 +63,9 @@
 #include "SharedMem.h"
 #include "PDBFlushProducerWork.h"
 #include "PDBFlushConsumerWork.h"
+#include "PDBUnpinConsumerWork.h"
+#include "PageTransferChannel.h"
+#include "PageCodec.h"
 #include "ExportableObject.h"
 #include "JoinTupleBase.h"
 //#include <hdfs/hdfs.h>
@@ -75,6 +78,9 @@
 #include <map>
 #include <iterator>
 #include <pthread.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
 #ifdef ENABLE_COMPRESSION
 #include <snappy.h>
 #endif
@@ -124,7 +130,8 @@ PangeaStorageServer::PangeaStorageServer(SharedMemPtr shm,
     this->flushBuffer = make_shared<PageCircularBuffer>(FLUSH_BUFFER_SIZE, logger);
 
     // initialize cache, must be initialized before databases
-    this->cache = make_shared<PageCache>(conf, workers, flushBuffer, logger, shm);
+    this->cache = make_shared<PageCache>(
+        conf, workers, flushBuffer, logger, shm, conf->getCacheStrategy());
 
     // initialize and load databases, must be initialized after cache
     this->dbs = new std::map<DatabaseID, DefaultDatabasePtr>();
@@ -190,6 +197,7 @@ void PangeaStorageServer::cleanup(bool flushOrNot) {
 PangeaStorageServer::~PangeaStorageServer() {
 
     stopFlushConsumerThreads();
+    stopUnpinConsumerThread();
     pthread_mutex_destroy(&(this->databaseLock));
     pthread_mutex_destroy(&(this->typeLock));
     pthread_mutex_destroy(&(this->tempsetLock));
@@ -217,6 +225,73 @@ PDBPagePtr PangeaStorageServer::getNewPage(pair<std::string, std::string> databa
 }
 
 
+bool PangeaStorageServer::receivePage(pair<std::string, std::string> databaseAndSet,
+                                      PDBCommunicatorPtr receiveFromMe,
+                                      std::string& errMsg) {
+
+    SetPtr mySet = getSet(databaseAndSet);
+    if (mySet == nullptr) {
+        errMsg = "FATAL ERROR: set to store data doesn't exist!";
+        std::cout << errMsg << std::endl;
+        return false;
+    }
+    PageFrameHeader header;
+    if (PageCodec::receiveHeader(receiveFromMe, header, errMsg) == false) {
+        return false;
+    }
+    size_t headerSize = sizeof(NodeID) + sizeof(DatabaseID) + sizeof(UserTypeID) + sizeof(SetID) +
+        sizeof(PageID) + sizeof(int) + sizeof(size_t);
+    PDBPagePtr myPage = nullptr;
+    if (header.numBytes + headerSize <= mySet->getPageSize()) {
+        const LockGuard guard{workingMutex};
+        myPage = getNewPage(databaseAndSet);
+    }
+    if (myPage == nullptr) {
+        errMsg = "Tried to put a page of " + std::to_string(header.numBytes) + " bytes to set " +
+            databaseAndSet.second + " with page size " + std::to_string(mySet->getPageSize());
+        std::cout << errMsg << std::endl;
+        return false;
+    }
+
+    // the bytes go straight into the page in the cache
+    bool success = PageCodec::receivePage(receiveFromMe, header, myPage->getBytes(), errMsg);
+    CacheKey key;
+    key.dbId = myPage->getDbID();
+    key.typeId = myPage->getTypeID();
+    key.setId = myPage->getSetID();
+    key.pageId = myPage->getPageID();
+    getCache()->decPageRefCount(key);
+    return success;
+}
+
+
+bool PangeaStorageServer::receiveRecord(pair<std::string, std::string> databaseAndSet,
+                                        PDBCommunicatorPtr receiveFromMe,
+                                        std::string& errMsg) {
+
+    SetPtr mySet = getSet(databaseAndSet);
+    if (mySet == nullptr) {
+        errMsg = "FATAL ERROR: set to store data doesn't exist!";
+        std::cout << errMsg << std::endl;
+        return false;
+    }
+    PageFrameHeader header;
+    if (PageCodec::receiveHeader(receiveFromMe, header, errMsg) == false) {
+        return false;
+    }
+    char* myBytes = (char*)mySet->getNewBytes(header.numBytes);
+    if (myBytes == nullptr) {
+        errMsg = "FATAL ERROR: can't get " + std::to_string(header.numBytes) +
+            " bytes from user set " + databaseAndSet.second;
+        std::cout << errMsg << std::endl;
+        return false;
+    }
+
+    // the bytes go straight into the input buffer page of the set in the cache
+    return PageCodec::receivePage(receiveFromMe, header, myBytes, errMsg);
+}
+
+
 void PangeaStorageServer::writeBackRecords(pair<std::string, std::string> databaseAndSet,
                                            bool flushOrNot,
                                            bool directPutOrNot) {
@@ -577,7 +652,10 @@ void PangeaStorageServer::registerHandlers(PDBServer& forMe) {
                 // add a temp set in local
                 SetID setId;
                 bool res = getFunctionality<PangeaStorageServer>().addTempSet(
-                    request->getSetName(), setId, request->getPageSize());
+                    request->getSetName(),
+                    setId,
+                    request->getPageSize(),
+                    request->getLocalityType());
                 if (res == false) {
                     errMsg = "TempSet " + request->getSetName() + " already exists\n";
                 }
@@ -825,6 +903,10 @@ void PangeaStorageServer::registerHandlers(PDBServer& forMe) {
             bool everythingOK = true;
             Handle<StorageAddObjectInLoop> curRequest = request;
             void* requestInLoop = nullptr;
+            // a shuffle channel waits for our acknowledgements, so don't let Nagle hold them
+            int noDelay = 1;
+            setsockopt(
+                sendUsingMe->getSocketFD(), IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
             while (curRequest->isLoopEnded() == false) {
                 bool typeCheckOrNot = request->isTypeCheck();
                 if (typeCheckOrNot == true) {
@@ -843,69 +925,32 @@ void PangeaStorageServer::registerHandlers(PDBServer& forMe) {
 #endif
                 }
 
-                // get the record
-                size_t numBytes = sendUsingMe->getSizeOfNextObject();
-                std::cout << "received " << numBytes << " bytes" << std::endl;
-#ifdef ENABLE_COMPRESSION
-                char* readToHere = new char[numBytes];
-#else
-                void* readToHere = malloc(numBytes);
-#endif
-                everythingOK = sendUsingMe->receiveBytes(readToHere, errMsg);
-
+                // get the record: a shuffled page is stored as a page of its own, other records
+                // are appended to the input buffer page of the set; either way the bytes are
+                // decoded straight into the page cache, and only then acknowledged, which gives the
+                // sender a credit for another page
+                auto databaseAndSet = make_pair((std::string)request->getDatabase(),
+                                                (std::string)request->getSetName());
+                if (curRequest->isStoreAsPage()) {
+                    everythingOK = receivePage(databaseAndSet, sendUsingMe, errMsg);
+                } else {
+                    everythingOK = receiveRecord(databaseAndSet, sendUsingMe, errMsg);
+                }
                 {
                     const UseTemporaryAllocationBlock block{1024};
                     Handle<SimpleRequestResult> response =
                         makeObject<SimpleRequestResult>(everythingOK, errMsg);
-
-                    // return the result
-                    everythingOK = sendUsingMe->sendObject(response, errMsg);
+                    sendUsingMe->sendObject(response, errMsg);
                 }
-                if (everythingOK) {
-#ifdef ENABLE_COMPRESSION
-                    size_t sizeOfBytesToAdd = 0;
-                    snappy::GetUncompressedLength(readToHere, numBytes, &sizeOfBytesToAdd);
-#else
-                    size_t sizeOfBytesToAdd = numBytes;
-#endif
-
-                    auto databaseAndSet = make_pair((std::string)request->getDatabase(),
-                                                    (std::string)request->getSetName());
-                    // now, get a page to write to
-                    SetPtr mySet = getSet(databaseAndSet);
-                    if (mySet == nullptr) {
-                        std::cout << "FATAL ERROR: set to store data doesn't exist!" << std::endl;
-                        std::cout << "databaseName" << databaseAndSet.first << std::endl;
-                        std::cout << "setName" << databaseAndSet.second << std::endl;
-                        return make_pair(
-                            false, std::string("FATAL ERROR: set to store data doesn't exist!"));
-                    }
-                    std::cout << "sizeOfBytesToAdd is " << sizeOfBytesToAdd << std::endl;
-                    char* myBytes = (char*)mySet->getNewBytes(sizeOfBytesToAdd);
-                    if (myBytes == nullptr) {
-                        return make_pair(false,
-                                         std::string("FATAL ERROR: can't get bytes from user set " +
-                                                     databaseAndSet.second));
+                if (everythingOK == false) {
+                    // the rest of the frame was not read, so the loop can't go on
+                    if (requestInLoop != nullptr) {
+                        free(requestInLoop);
                     }
-#ifdef ENABLE_COMPRESSION
-                    snappy::RawUncompress(readToHere, numBytes, myBytes);
-#else
-                    memcpy(myBytes, readToHere, numBytes);
-#endif
-
-                } else {
-                    errMsg =
-                        "Tried to add data of the wrong type to a database set or database set "
-                        "doesn't exit.\n";
-                    everythingOK = false;
+                    return make_pair(false, errMsg);
                 }
-#ifdef ENABLE_COMPRESSION
-                delete[] readToHere;
-#else
-                free(readToHere);
-#endif
 
-                numBytes = sendUsingMe->getSizeOfNextObject();
+                size_t numBytes = sendUsingMe->getSizeOfNextObject();
                 if (requestInLoop != nullptr) {
                     free(requestInLoop);
                 }
@@ -1303,26 +1348,15 @@ void PangeaStorageServer::registerHandlers(PDBServer& forMe) {
             SetID setId = request->getSetID();
             PageID pageId = request->getPageID();
 
-            CacheKey key;
-            key.dbId = dbId;
-            key.typeId = typeId;
-            key.setId = setId;
-            key.pageId = pageId;
-
-
             bool res;
             std::string errMsg;
-            if (getFunctionality<PangeaStorageServer>().getCache()->decPageRefCount(key) == false) {
+            if (getFunctionality<PangeaStorageServer>().unpinPage(dbId, typeId, setId, pageId) ==
+                false) {
                 res = false;
                 errMsg = "Fatal Error: Page doesn't exist for unpinning page.";
-                std::cout << "dbId=" << dbId << ", typeId=" << typeId << ", setId=" << setId
-                          << ", pageId=" << pageId << std::endl;
                 std::cout << errMsg << std::endl;
                 logger->error(errMsg);
             } else {
-#ifdef ENABLE_EVICTION
-                getFunctionality<PangeaStorageServer>().getCache()->evictPage(key);
-#endif
                 res = true;
             }
 
@@ -1365,11 +1399,27 @@ void PangeaStorageServer::registerHandlers(PDBServer& forMe) {
             // use frontend iterators: one iterator for in-memory dirty pages, and one iterator for
             // each file partition
             std::vector<PageIteratorPtr>* iterators = set->getIterators();
-            getFunctionality<PangeaStorageServer>().getCache()->pin(set, MRU, Write);
+            // the set is scanned from the first page to the last, a set that doesn't fit in the
+            // cache is read once, so we ask for its pages to be dropped as soon as they are
+            // consumed, a set that fits is kept for the next scan
+            PageCachePtr cache = getFunctionality<PangeaStorageServer>().getCache();
+            AccessPattern accessPattern = LoopingSequential;
+            if ((size_t)set->getNumPages() * set->getPageSize() > cache->getMaxSize()) {
+                accessPattern = StraightSequential;
+            }
+            cache->pin(set, MRU, Write, accessPattern);
 
             set->setPinned(true);
             int numIterators = iterators->size();
 
+            // the backend claimed a scan ring for this scan, if it takes the pages from the ring
+            PageTransferChannelPtr channel =
+                getFunctionality<PangeaStorageServer>().getSharedMem()->getPageTransferChannel();
+            PageDescriptorRing* scanRing = nullptr;
+            if (channel != nullptr) {
+                scanRing = channel->getScanRing(request->getScanRingID());
+            }
+
             PDBBuzzerPtr tempBuzzer = make_shared<PDBBuzzer>([&](PDBAlarm myAlarm, int& counter) {
                 counter++;
                 PDB_COUT << "counter = " << counter << std::endl;
@@ -1381,7 +1431,7 @@ void PangeaStorageServer::registerHandlers(PDBServer& forMe) {
             for (int i = 0; i < numIterators; i++) {
                 PDBWorkerPtr worker = getFunctionality<PangeaStorageServer>().getWorker();
                 PDBScanWorkPtr scanWork = make_shared<PDBScanWork>(
-                    iterators->at(i), &getFunctionality<PangeaStorageServer>(), counter);
+                    iterators->at(i), &getFunctionality<PangeaStorageServer>(), counter, scanRing);
                 worker->execute(scanWork, tempBuzzer);
             }
 
@@ -1405,6 +1455,19 @@ void PangeaStorageServer::registerHandlers(PDBServer& forMe) {
                 return make_pair(res, errMsg);
             }
 
+            // the backend takes the pages from the scan ring, so it learns the end from the ring
+            if (scanRing != nullptr) {
+                PageDescriptor noMorePages;
+                noMorePages.type = NoMorePagesDescriptor;
+                size_t ticket;
+                if (scanRing->push(noMorePages, ticket) == false) {
+                    res = false;
+                    errMsg = "Fatal Error: the page ring is closed.";
+                    std::cout << errMsg << std::endl;
+                }
+                return make_pair(res, errMsg);
+            }
+
             UseTemporaryAllocationBlock myBlock{1024};
             Handle<StorageNoMorePage> noMorePage = makeObject<StorageNoMorePage>();
             if (!communicatorToBackEnd->sendObject<StorageNoMorePage>(noMorePage, errMsg)) {
@@ -1955,7 +2018,10 @@ bool PangeaStorageServer::removeSet(std::string dbName, std::string typeName, st
 }
 
 
-bool PangeaStorageServer::addTempSet(string setName, SetID& setId, size_t pageSize) {
+bool PangeaStorageServer::addTempSet(string setName,
+                                     SetID& setId,
+                                     size_t pageSize,
+                                     LocalityType localityType) {
     this->logger->writeLn("To add temp set with setName=");
     this->logger->writeLn(setName);
     if (this->name2tempSetId->find(setName) != this->name2tempSetId->end()) {
@@ -1973,7 +2039,8 @@ bool PangeaStorageServer::addTempSet(string setName, SetID& setId, size_t pageSi
                                               this->dataTempPaths,
                                               this->shm,
                                               this->cache,
-                                              this->logger);
+                                              this->logger,
+                                              localityType);
     this->getCache()->pin(tempSet, MRU, Write);
     this->logger->writeLn("temp set created!");
     pthread_mutex_lock(&this->tempsetLock);
@@ -2069,6 +2136,62 @@ void PangeaStorageServer::stopFlushConsumerThreads() {
     this->flushBuffer->close();
 }
 
+/**
+ * Start the thread unpinning the pages released by the backend.
+ */
+void PangeaStorageServer::startUnpinConsumerThread() {
+    PageTransferChannelPtr channel = this->shm->getPageTransferChannel();
+    if ((channel == nullptr) || (this->unpinner != nullptr)) {
+        return;
+    }
+    this->unpinner = make_shared<PDBUnpinConsumerWork>(channel->getUnpinnedPages(), this);
+    PDBWorkerPtr worker;
+    while ((worker = this->getWorker()) == nullptr) {
+        sched_yield();
+    }
+    worker->execute(this->unpinner, this->unpinner->getLinkedBuzzer());
+    PDB_COUT << "unpinning thread started\n";
+}
+
+/**
+ * Stop the unpinning thread.
+ */
+void PangeaStorageServer::stopUnpinConsumerThread() {
+    if (this->unpinner != nullptr) {
+        dynamic_pointer_cast<PDBUnpinConsumerWork>(this->unpinner)->stop();
+    }
+}
+
+/**
+ * Unpin a page released by the backend.
+ */
+bool PangeaStorageServer::unpinPage(DatabaseID dbId,
+                                    UserTypeID typeId,
+                                    SetID setId,
+                                    PageID pageId) {
+    CacheKey key;
+    key.dbId = dbId;
+    key.typeId = typeId;
+    key.setId = setId;
+    key.pageId = pageId;
+
+    if (this->cache->decPageRefCount(key) == false) {
+        std::cout << "dbId=" << dbId << ", typeId=" << typeId << ", setId=" << setId
+                  << ", pageId=" << pageId << std::endl;
+        return false;
+    }
+#ifdef ENABLE_EVICTION
+    this->cache->evictPage(key);
+#else
+    // the pages of a set scanned once are not needed anymore
+    SetPtr set = this->getSet(dbId, typeId, setId);
+    if ((set != nullptr) && (set->isDroppedAfterRead() == true)) {
+        this->cache->dropConsumedPage(key, set);
+    }
+#endif
+    return true;
+}
+
 /**
  * returns a worker from thread pool
  */
@@ -29,6 +29,9 @@
 #include "StorageCollectStatsResponse.h"
 #include "Profiling.h"
 #include "RegisterReplica.h"
+#include "StageDependencyGraph.h"
+#include "CostModel.h"
+#include "LockGuard.h"
 #include <ctime>
 #include <chrono>
 #include <SimplePhysicalOptimizer/SimplePhysicalNodeFactory.h>
@@ -38,6 +41,8 @@ namespace pdb {
 
 QuerySchedulerServer::~QuerySchedulerServer() {
     pthread_mutex_destroy(&connection_mutex);
+    pthread_mutex_destroy(&runtimeFilterMutex);
+    pthread_mutex_destroy(&shuffleSkewMutex);
 }
 
 QuerySchedulerServer::QuerySchedulerServer(PDBLoggerPtr logger,
@@ -46,6 +51,8 @@ QuerySchedulerServer::QuerySchedulerServer(PDBLoggerPtr logger,
                                            bool pseudoClusterMode,
                                            double partitionToCoreRatio) {
     pthread_mutex_init(&connection_mutex, nullptr);
+    pthread_mutex_init(&runtimeFilterMutex, nullptr);
+    pthread_mutex_init(&shuffleSkewMutex, nullptr);
 
     this->port = 8108;
     this->logger = logger;
@@ -65,6 +72,8 @@ QuerySchedulerServer::QuerySchedulerServer(int port,
                                            bool pseudoClusterMode,
                                            double partitionToCoreRatio) {
     pthread_mutex_init(&connection_mutex, nullptr);
+    pthread_mutex_init(&runtimeFilterMutex, nullptr);
+    pthread_mutex_init(&shuffleSkewMutex, nullptr);
 
     this->port = port;
     this->logger = logger;
@@ -160,47 +169,55 @@ StatisticsPtr QuerySchedulerServer::getStats() {
 }
 
 
-void QuerySchedulerServer::scheduleStages(std::vector<Handle<AbstractJobStage>>& stagesToSchedule,
-                                          std::shared_ptr<ShuffleInfo> shuffleInfo) {
+bool QuerySchedulerServer::scheduleStages(std::vector<Handle<AbstractJobStage>>& stagesToSchedule,
+                                          std::shared_ptr<ShuffleInfo> shuffleInfo,
+                                          std::string& errMsg) {
 
-    int counter = 0;
+    // figure out which stages depend on each other, a stage is executed on a node as soon as its inputs are ready
+    StageDependencyGraph stageGraph(stagesToSchedule, (unsigned long) shuffleInfo->getNumNodes());
 
-    // create the buzzer
-    PDBBuzzerPtr tempBuzzer = make_shared<PDBBuzzer>([&](PDBAlarm myAlarm, int& cnt) {
-        cnt++;
-        PDB_COUT << "counter = " << cnt << std::endl;
-    });
+    // launch the ready tasks until every stage is finished on every node
+    while (!stageGraph.isFinished()) {
 
-    // go though all the stages and send them to every node
-    for (auto &stage : stagesToSchedule) {
-        for (unsigned long node = 0; node < shuffleInfo->getNumNodes(); node++) {
+        for (auto &task : stageGraph.takeReadyTasks()) {
 
             // grab a worker
             PDBWorkerPtr myWorker = getWorker();
 
             // create some work for it
-            PDBWorkPtr myWork = make_shared<GenericWork>([&, node](PDBBuzzerPtr callerBuzzer) {
-                prepareAndScheduleStage(stage, node, counter, callerBuzzer);
+            size_t stageIdx = task.first;
+            unsigned long node = task.second;
+            PDBWorkPtr myWork = make_shared<GenericWork>([&, stageIdx, node](PDBBuzzerPtr callerBuzzer) {
+                bool success = prepareAndScheduleStage(stagesToSchedule[stageIdx], node);
+                stageGraph.markFinished(stageIdx, node, success);
             });
 
             // execute the work
-            myWorker->execute(myWork, tempBuzzer);
+            myWorker->execute(myWork, nullptr);
         }
 
-        // wait until all the nodes are finished
-        while (counter < shuffleInfo->getNumNodes()) {
-            tempBuzzer->wait();
-        }
+        // wait until some node finishes a stage
+        stageGraph.waitForProgress();
+    }
+
+    // report how long each stage took
+    stageGraph.printStageTimings();
 
-        // reset the counter for the next stage
-        counter = 0;
+    // and how evenly the stages that shuffled by hash spread their tuples
+    printShuffleSkew();
+
+    // report the failures if we had any
+    if (stageGraph.getNumFailed() != 0) {
+        errMsg = std::to_string(stageGraph.getNumFailed()) + " stages failed to execute on their nodes, " +
+                 std::to_string(stageGraph.getNumCancelled()) + " stages depending on them were not executed";
+        std::cout << errMsg << std::endl;
+        return false;
     }
+    return true;
 }
 
-void QuerySchedulerServer::prepareAndScheduleStage(Handle<AbstractJobStage> &stage,
-                                                   unsigned long node,
-                                                   int &counter,
-                                                   PDBBuzzerPtr &callerBuzzer){
+bool QuerySchedulerServer::prepareAndScheduleStage(Handle<AbstractJobStage> &stage,
+                                                   unsigned long node) {
     // this is where all the stuff we create will be stored (the deep copy of the stage)
     const UseTemporaryAllocationBlock block(256 * 1024 * 1024);
 
@@ -215,8 +232,7 @@ void QuerySchedulerServer::prepareAndScheduleStage(Handle<AbstractJobStage> &sta
 
     // if we failed to acquire a communicator to the node signal a failure and finish
     if(communicator == nullptr) {
-        callerBuzzer->buzz(PDBAlarm::GenericError, counter);
-        return;
+        return false;
     }
 
     // figure out what kind of stage it is and schedule it
@@ -261,12 +277,11 @@ void QuerySchedulerServer::prepareAndScheduleStage(Handle<AbstractJobStage> &sta
     if (!success) {
         PDB_COUT << "Can't execute the " << stage->getJobStageType() << " with " << stage->getStageId()
                  << " on the " << std::to_string(node) << "-th node" << std::endl;
-        callerBuzzer->buzz(PDBAlarm::GenericError, counter);
-        return;
+        return false;
     }
 
     // excellent everything worked just as expected
-    callerBuzzer->buzz(PDBAlarm::WorkAllDone, counter);
+    return true;
 }
 
 PDBCommunicatorPtr QuerySchedulerServer::getCommunicatorToNode(int port, std::string &ip) {
@@ -333,6 +348,16 @@ bool QuerySchedulerServer::scheduleStage(unsigned long node,
 
     // update the statistics based on the returned results
     this->updateStats(result);
+
+    // keep the runtime filters of the hash tables the node built, for the stages that shuffle the other side
+    if (result->getRuntimeFilters() != nullptr) {
+        this->addRuntimeFilters(node, result);
+    }
+
+    // keep the skew of the shuffle for the report, and the keys it split for the stage that shuffles the other side
+    if (result->getShuffleSkew() != nullptr) {
+        this->addShuffleSkew(stage->getStageId(), result);
+    }
     PDB_COUT << stage->getJobStageType() << " execute: wrote set:" << result->getDatabase()
              << ":" << result->getSetName() << std::endl;
 
@@ -381,9 +406,105 @@ Handle<TupleSetJobStage> QuerySchedulerServer::getStageToSend(unsigned long inde
     stageToSend->setIPAddresses(addresses);
     stageToSend->setNodeId(static_cast<NodeID>(index));
 
+    // attach the runtime filters of the hash tables on the other side of the join
+    if (!stageToSend->getRuntimeFilterHashSet().empty()) {
+        stageToSend->setRuntimeFilters(getRuntimeFilters(stageToSend->getRuntimeFilterHashSet()));
+    }
+
+    // and the keys the other side was split on, the tuples of those keys go to all of their partitions
+    if (!stageToSend->getSplitKeysHashSet().empty()) {
+        stageToSend->setSplitKeys(getSplitKeys(stageToSend->getSplitKeysHashSet()));
+    }
+
     return stageToSend;
 }
 
+void QuerySchedulerServer::addRuntimeFilters(unsigned long node, Handle<SetIdentifier> &result) {
+
+    Vector<uint64_t> &filters = *result->getRuntimeFilters();
+
+    const LockGuard guard{runtimeFilterMutex};
+    std::vector<std::vector<uint64_t>> &nodeFilters = runtimeFilters[result->toSourceSetName()];
+    nodeFilters.resize((size_t) shuffleInfo->getNumNodes());
+    if (node < nodeFilters.size()) {
+        nodeFilters[node].assign(filters.c_ptr(), filters.c_ptr() + filters.size());
+    }
+}
+
+Handle<Vector<uint64_t>> QuerySchedulerServer::getRuntimeFilters(const std::string &hashSetName) {
+
+    const LockGuard guard{runtimeFilterMutex};
+
+    // we need the filters of every node, a node that has no data for the hash set sends none
+    auto it = runtimeFilters.find(hashSetName);
+    if (it == runtimeFilters.end()) {
+        return nullptr;
+    }
+    size_t numWords = 0;
+    for (auto &nodeFilters : it->second) {
+        if (nodeFilters.empty()) {
+            PDB_COUT << "Not all the nodes sent the runtime filters of " << hashSetName << std::endl;
+            return nullptr;
+        }
+        numWords += nodeFilters.size();
+    }
+
+    // the partitions of node i come after the ones of node i - 1, the way the tuples are partitioned
+    Handle<Vector<uint64_t>> filters = makeObject<Vector<uint64_t>>(numWords);
+    for (auto &nodeFilters : it->second) {
+        for (uint64_t word : nodeFilters) {
+            filters->push_back(word);
+        }
+    }
+    return filters;
+}
+
+void QuerySchedulerServer::addShuffleSkew(JobStageID stageId, Handle<SetIdentifier> &result) {
+
+    Vector<uint64_t> &report = *result->getShuffleSkew();
+    int numPartitions = ShuffleSkew::getNumPartitionsOf(report);
+
+    const LockGuard guard{shuffleSkewMutex};
+    ShuffleSkewPtr &stageSkew = stageSkews[stageId];
+    if (stageSkew == nullptr) {
+        stageSkew = make_shared<ShuffleSkew>(numPartitions, shuffleInfo->getNumNodes(), false);
+    }
+    if (!stageSkew->readFrom(report)) {
+        PDB_COUT << "The shuffle skew of stage " << stageId << " is not for its partitions" << std::endl;
+        return;
+    }
+
+    // the build side of a join reports the keys it split, both sides are shuffled to the set the hash set is built from
+    if (report.size() > (size_t) numPartitions + 1) {
+        ShuffleSkewPtr &keys = splitKeys[result->toSourceSetName()];
+        if (keys == nullptr) {
+            keys = make_shared<ShuffleSkew>(numPartitions, shuffleInfo->getNumNodes(), false);
+        }
+        keys->readFrom(report);
+    }
+}
+
+Handle<Vector<uint64_t>> QuerySchedulerServer::getSplitKeys(const std::string &hashSetName) {
+
+    const LockGuard guard{shuffleSkewMutex};
+    auto it = splitKeys.find(hashSetName);
+    if (it == splitKeys.end() || !it->second->hasSplitKeys()) {
+        return nullptr;
+    }
+    Handle<Vector<uint64_t>> keys = makeObject<Vector<uint64_t>>(2 * it->second->getNumSplitKeys());
+    it->second->appendSplitKeysTo(*keys);
+    return keys;
+}
+
+void QuerySchedulerServer::printShuffleSkew() {
+
+    const LockGuard guard{shuffleSkewMutex};
+    for (auto &stageSkew : stageSkews) {
+        std::cout << "Stage " << stageSkew.first << " shuffled " << stageSkew.second->toString() << std::endl;
+    }
+    stageSkews.clear();
+}
+
 Handle<AggregationJobStage> QuerySchedulerServer::getStageToSend(unsigned long index,
                                                                  Handle<AggregationJobStage> &stage) {
 
@@ -567,6 +688,20 @@ void QuerySchedulerServer::updateStats(Handle<SetIdentifier> setToUpdateStats) {
     statsForOptimization->setPageSize(databaseName, setName, pageSize);
     statsForOptimization->incrementNumPages(databaseName, setName, numPages);
     statsForOptimization->incrementNumBytes(databaseName, setName, numBytes);
+
+    // the partitioning of a set is known to the statistics database, not to the workers
+    if ((statisticsDB != nullptr) &&
+        statsForOptimization->getPartitionScheme(databaseName, setName).empty()) {
+        std::string partitionScheme;
+        std::string partitionKey;
+        if (statisticsDB->getDataPartitioning(
+                std::pair<std::string, std::string>(databaseName, setName),
+                partitionScheme,
+                partitionKey)) {
+            statsForOptimization->setPartitioning(
+                databaseName, setName, partitionScheme, partitionKey);
+        }
+    }
 }
 
 
@@ -666,6 +801,18 @@ pair<bool, basic_string<char>> QuerySchedulerServer::executeComputation(Handle<E
         this->collectStats();
     }
 
+    // the planner sizes the hash tables of the joins for the smallest node
+    if ((this->statsForOptimization != nullptr) && (this->standardResources != nullptr)) {
+        size_t memoryPerNode = 0;
+        for (auto& resource : *(this->standardResources)) {
+            if ((memoryPerNode == 0) || ((size_t)resource->getMemSize() < memoryPerNode)) {
+                memoryPerNode = (size_t)resource->getMemSize();
+            }
+        }
+        this->statsForOptimization->setClusterResources((int)this->standardResources->size(),
+                                                        memoryPerNode);
+    }
+
     try {
       // parse the plan and initialize the values we need
       Handle<ComputePlan> computePlan = makeObject<ComputePlan>(String(request->getTCAPString()), *computations);
@@ -716,10 +863,20 @@ pair<bool, basic_string<char>> QuerySchedulerServer::executeComputation(Handle<E
         PROFILER_START(scheduleStages)
 
         PDB_COUT << "To schedule the query to run on the cluster" << std::endl;
-        getFunctionality<QuerySchedulerServer>().scheduleStages(jobStages, shuffleInfo);
+        bool scheduled = getFunctionality<QuerySchedulerServer>().scheduleStages(jobStages, shuffleInfo, errMsg);
 
         PROFILER_END(scheduleStages)
 
+        // the stages that depend on the failed ones did not run, so the job can not go on
+        if (!scheduled) {
+            success = false;
+            removeUnusedIntermediateSets(dsmClient, intermediateSets);
+            break;
+        }
+
+        // the filters that ran tell the planner how much of their input they keep
+        CostModel::learnSelectivities(jobStages, statsForOptimization);
+
         // removes the intermediate sets we don't anymore to continue the execution
         removeUnusedIntermediateSets(dsmClient, intermediateSets);
     }
@@ -728,6 +885,16 @@ pair<bool, basic_string<char>> QuerySchedulerServer::executeComputation(Handle<E
     PDB_COUT << "About to remove intermediate sets" << endl;
     removeIntermediateSets(dsmClient);
 
+    // the hash sets of the job are gone, and so are their runtime filters
+    {
+        const LockGuard guard{runtimeFilterMutex};
+        runtimeFilters.clear();
+    }
+    {
+        const LockGuard guard{shuffleSkewMutex};
+        splitKeys.clear();
+    }
+
     // notify the client that we succeeded
     PDB_COUT << "About to send back response to client" << std::endl;
     Handle<SimpleRequestResult> result = makeObject<SimpleRequestResult>(success, errMsg);
@@ -830,6 +997,9 @@ void QuerySchedulerServer::extractPipelineStages(int &jobStageId,
                                                   vector<Handle<AbstractJobStage>> &jobStages,
                                                   vector<Handle<SetIdentifier>> &intermediateSets) {
 
+    // remember the sources we had before we started, the ones created in this round do not have statistics yet
+    std::set<std::string> existingSources = this->physicalOptimizerPtr->getSourceIdentifiers();
+
     // try to get a sequence of stages, if we have any sources left
     int idx = 0;
     bool success = false;
@@ -843,6 +1013,22 @@ void QuerySchedulerServer::extractPipelineStages(int &jobStageId,
 
         std::cout << idx << std::endl;
     }
+
+    // keep extracting sequences as long as the best source was already there when we started, these sequences do
+    // not depend on the statistics of this round so we can schedule them together with the first one
+    while (success && this->physicalOptimizerPtr->hasSources()) {
+
+        // is the best source one that was created in this round, if so we need to wait for the statistics
+        auto bestSource = this->physicalOptimizerPtr->getBestNode(statsForOptimization);
+        if (existingSources.find(bestSource->getNodeIdentifier()) == existingSources.end()) {
+            break;
+        }
+
+        success = this->physicalOptimizerPtr->getNextStagesOptimized(jobStages,
+                                                                     intermediateSets,
+                                                                     statsForOptimization,
+                                                                     jobStageId);
+    }
 }
 
 }
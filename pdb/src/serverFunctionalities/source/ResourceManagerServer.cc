@@ -23,6 +23,9 @@
 #include "InterfaceFunctions.h"
 #include "SimpleRequestHandler.h"
 #include "RequestResources.h"
+#include "GetListOfNodes.h"
+#include "ListOfNodes.h"
+#include "UseTemporaryAllocationBlock.h"
 #include "DataTypes.h"
 #include <stdlib.h>
 #include <regex>
@@ -200,6 +203,26 @@ void ResourceManagerServer::analyzeResources(std::string resourceFileName) {
 
 void ResourceManagerServer::registerHandlers(PDBServer& forMe) {
     // Now we use ResourceManager through getFunctionality() at Scheduler and Dispatcher
+
+    // a client asks for the nodes to read a set from them directly
+    forMe.registerHandler(
+        GetListOfNodes_TYPEID,
+        make_shared<SimpleRequestHandler<GetListOfNodes>>(
+            [&](Handle<GetListOfNodes> request, PDBCommunicatorPtr sendUsingMe) {
+                std::string errMsg;
+                const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+                Handle<Vector<String>> hostNames = makeObject<Vector<String>>();
+                const auto nodes = getAllNodes();
+                for (int i = 0; i < nodes->size(); i++) {
+                    std::string address = static_cast<std::string>((*nodes)[i]->getAddress());
+                    std::string port = std::to_string((*nodes)[i]->getPort());
+                    hostNames->push_back(String(address + ":" + port));
+                }
+                Handle<ListOfNodes> response = makeObject<ListOfNodes>();
+                response->setHostNames(hostNames);
+                bool res = sendUsingMe->sendObject(response, errMsg);
+                return make_pair(res, errMsg);
+            }));
 }
 }
 
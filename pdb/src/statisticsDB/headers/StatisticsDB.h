@@ -46,6 +46,12 @@ public:
      */
     bool createTables ();
 
+    /*
+     * create the table of the sets that are partitioned by key, if it is not there
+     * @return, whether the creation is successful or not
+     */
+    bool createPartitioningTable ();
+
     /*
      * execute the query
      * @param cmdString, the command;
@@ -119,6 +125,36 @@ public:
                                    Handle<Vector<Handle<Computation>>> computations,
                                    long& id);
 
+
+    /*
+     * to record how a set is partitioned by key, replacing what was recorded before
+     * @param databaseAndSetName, the identifier of the set
+     * @param partitionScheme, the scheme of the KeyPartitionPolicy of the set
+     * @param partitionKey, the member or the method the set is partitioned on
+     * @return: whether the entry is written or not
+     */
+    bool createDataPartitioning (std::pair<std::string, std::string> databaseAndSetName,
+                                 std::string partitionScheme,
+                                 std::string partitionKey);
+
+    /*
+     * to get how a set is partitioned by key
+     * @param databaseAndSetName, the identifier of the set
+     * @param partitionScheme, set to the scheme of the set
+     * @param partitionKey, set to the key of the set
+     * @return: whether the set is partitioned by key or not
+     */
+    bool getDataPartitioning (std::pair<std::string, std::string> databaseAndSetName,
+                              std::string& partitionScheme,
+                              std::string& partitionKey);
+
+    /*
+     * to forget how a set is partitioned, when it is removed or partitioned otherwise
+     * @param databaseAndSetName, the identifier of the set
+     * @return: whether the removal is successful or not
+     */
+    bool removeDataPartitioning (std::pair<std::string, std::string> databaseAndSetName);
+
     
      /*
       * given input set's database name and set name, 
@@ -19,6 +19,7 @@ StatisticsDB::StatisticsDB (ConfigurationPtr conf) {
         createTables();
     } else {
         openDB();
+        createPartitioningTable();
     }
 
     //initialize ids
@@ -86,10 +87,27 @@ bool StatisticsDB::createTables () {
 
     }
 
+    if (ret == true) {
+
+         ret = createPartitioningTable();
+
+    }
+
     return ret;
 
 }
 
+bool StatisticsDB::createPartitioningTable () {
+
+    // a database made before sets could be partitioned by key has no such table yet
+    return execDB ("CREATE TABLE IF NOT EXISTS DATA_PARTITIONING ("
+             "DATABASE_NAME VARCHAR(128), SET_NAME VARCHAR(128), "
+             "PARTITION_SCHEME TEXT, PARTITION_KEY VARCHAR(128), "
+             "MODIFICATION_TIME BIGINT, "
+             "PRIMARY KEY (DATABASE_NAME, SET_NAME)) WITHOUT ROWID;");
+
+}
+
 bool StatisticsDB::execDB (std::string cmdString) {
 
     PDB_COUT << "command: " << cmdString << std::endl;
@@ -215,6 +233,59 @@ bool StatisticsDB::createDataTransformation (long input_data_id,
 
 }
 
+bool StatisticsDB::createDataPartitioning (std::pair<std::string, std::string> databaseAndSetName,
+                                           std::string partitionScheme,
+                                           std::string partitionKey) {
+
+     replaceStr(partitionScheme, "'", "''");
+     replaceStr(partitionKey, "'", "''");
+     std::string cmdString = "INSERT OR REPLACE INTO DATA_PARTITIONING "
+                " (DATABASE_NAME, SET_NAME, PARTITION_SCHEME, PARTITION_KEY, MODIFICATION_TIME) "
+                "VALUES(" + quoteStr(databaseAndSetName.first) + ","
+                          + quoteStr(databaseAndSetName.second) + ","
+                          + quoteStr(partitionScheme) + ","
+                          + quoteStr(partitionKey) + ","
+                          + "strftime('%s', 'now', 'localtime'));";
+      PDB_COUT << "CreateDataPartitioning: " << cmdString << std::endl;
+      return execDB(cmdString);
+
+}
+
+bool StatisticsDB::getDataPartitioning (std::pair<std::string, std::string> databaseAndSetName,
+                                        std::string& partitionScheme,
+                                        std::string& partitionKey) {
+
+     bool found = false;
+     sqlite3_stmt * statement;
+     std::string queryString = "SELECT PARTITION_SCHEME, PARTITION_KEY from DATA_PARTITIONING "
+                                  "where DATABASE_NAME=" + quoteStr(databaseAndSetName.first)
+                                  + " AND SET_NAME=" + quoteStr(databaseAndSetName.second);
+     if (sqlite3_prepare_v2(statisticsDBHandler, queryString.c_str(), -1, &statement, NULL) == SQLITE_OK) {
+         if (sqlite3_step(statement) == SQLITE_ROW) {
+            const unsigned char * scheme = sqlite3_column_text(statement, 0);
+            const unsigned char * key = sqlite3_column_text(statement, 1);
+            partitionScheme = (scheme == nullptr) ? "" : (const char *) scheme;
+            partitionKey = (key == nullptr) ? "" : (const char *) key;
+            found = true;
+         }
+     } else {
+         PDB_COUT << (std::string)(sqlite3_errmsg(statisticsDBHandler)) << std::endl;
+     }
+     sqlite3_finalize(statement);
+     return found;
+
+}
+
+bool StatisticsDB::removeDataPartitioning (std::pair<std::string, std::string> databaseAndSetName) {
+
+      std::string cmdString = "DELETE FROM DATA_PARTITIONING where DATABASE_NAME="
+                              + quoteStr(databaseAndSetName.first)
+                              + " AND SET_NAME=" + quoteStr(databaseAndSetName.second);
+      PDB_COUT << "RemoveDataPartitioning: " << cmdString << std::endl;
+      return execDB(cmdString);
+
+}
+
 std::vector<std::shared_ptr<TransformedSet>> 
 StatisticsDB::getTransformedSets(std::pair<std::string, std::string> databaseAndSetName) {
 
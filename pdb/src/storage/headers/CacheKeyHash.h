@@ -0,0 +1,66 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef CACHE_KEY_HASH_H
+#define CACHE_KEY_HASH_H
+
+#include "DataTypes.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Hash function for CacheKey, used for caching and retrieving a page.
+ * The four ids are packed into two 64-bit words and mixed with the splitmix64 finalizer, so that
+ * every bit of every id affects every bit of the hash. This matters because the hash is used both
+ * to pick the PageCache shard and the bucket inside the shard, and page ids of large sets easily
+ * go beyond the few bits a shift-and-add hash would leave them.
+ */
+struct CacheKeyHash {
+
+    static inline uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    std::size_t operator()(const CacheKey& key) const {
+        uint64_t high = ((uint64_t)key.dbId << 32) | (uint64_t)key.typeId;
+        uint64_t low = ((uint64_t)key.setId << 32) | (uint64_t)key.pageId;
+        return (std::size_t)mix(high ^ mix(low));
+    }
+};
+
+/**
+ * Comparator for CacheKey, used for caching and retrieving a page.
+ */
+
+struct CacheKeyEqual {
+
+    bool operator()(const CacheKey& lKey, const CacheKey& rKey) const {
+        if ((lKey.dbId == rKey.dbId) && (lKey.typeId == rKey.typeId) &&
+            (lKey.setId == rKey.setId) && (lKey.pageId == rKey.pageId)) {
+            return true;
+        } else {
+            return false;
+        }
+    }
+};
+
+#endif /* CACHE_KEY_HASH_H */
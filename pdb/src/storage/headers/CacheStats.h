@@ -15,17 +15,53 @@
  *  limitations under the License.                                           *
  *                                                                           *
  *****************************************************************************/
-
 #ifndef CACHESTATS_H
 #define CACHESTATS_H
 
-// TODO
+#include <string>
+#include <vector>
 
+/**
+ * A snapshot of the counters of a PageCache, returned by PageCache::getStats().
+ *
+ * numHits: the number of page requests that found the page in cache
+ * numMisses: the number of page requests that had to load the page from disk
+ * numEvicted: the number of pages the eviction freed or sent to be flushed
+ * numCached: the number of pages that were added to the cache
+ * cachedBytesPerNode: the number of bytes of the pages in cache on each NUMA node, there is only
+ * one node if the shared memory pool is not split into NUMA arenas
+ */
 class CacheStats {
 public:
-    int numHits;
-    int numMisses;
-    int numEvicted;
-    int numCached;
+    CacheStats() : numHits(0), numMisses(0), numEvicted(0), numCached(0) {}
+
+    long numHits;
+    long numMisses;
+    long numEvicted;
+    long numCached;
+    std::vector<size_t> cachedBytesPerNode;
+
+    double getHitRatio() const {
+        long numRequests = numHits + numMisses;
+        return (numRequests == 0) ? 0.0 : (double)numHits / (double)numRequests;
+    }
+
+    std::string toString() const {
+        return "hits=" + std::to_string(numHits) + ", misses=" + std::to_string(numMisses) +
+            ", hitRatio=" + std::to_string(getHitRatio()) + ", evicted=" +
+            std::to_string(numEvicted) + ", cached=" + std::to_string(numCached) +
+            nodesToString();
+    }
+
+    std::string nodesToString() const {
+        if (cachedBytesPerNode.size() <= 1) {
+            return "";
+        }
+        std::string ret = ", cachedBytesPerNode=[";
+        for (size_t node = 0; node < cachedBytesPerNode.size(); node++) {
+            ret += ((node == 0) ? "" : ",") + std::to_string(cachedBytesPerNode[node]);
+        }
+        return ret + "]";
+    }
 };
 #endif /* CACHESTATS_H */
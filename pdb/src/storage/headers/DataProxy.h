@@ -49,9 +49,15 @@ public:
     /**
      * Add a temporary set to store intermediate data with setName specified.
      * The storage system will allocate SetID to the temporary set.
+     * The localityType tells the storage what is in the set, e.g. PartialAggregationData for
+     * the groups an aggregation spills, which are evicted before shuffle data.
      * If successful, return true, otherwise (like setName exists), return false.
      */
-    bool addTempSet(string setName, SetID& setId, bool needMem = true, int numTries = 0);
+    bool addTempSet(string setName,
+                    SetID& setId,
+                    LocalityType localityType = ShuffleData,
+                    bool needMem = true,
+                    int numTries = 0);
 
     /**
      * Remove a temp set with the specified SetID.
@@ -146,11 +152,24 @@ public:
      */
     PageScannerPtr getScanner(int numThreads);
 
+    /**
+     * If the pages are unpinned through the shared ring of the PageTransferChannel,
+     * unpinUserPage() returns as soon as the page is in the ring, and the frontend unpins the
+     * pages in batches. Block until the frontend has unpinned all the pages this proxy released.
+     * It is called before removing a temporary set, before creating a scanner, and when the proxy
+     * is destroyed, so that the storage sees the pages unpinned from then on.
+     */
+    void waitForUnpinnedPages();
+
 
 private:
     pdb::PDBCommunicatorPtr communicator;
     SharedMemPtr shm;
     pdb::PDBLoggerPtr logger;
     NodeID nodeId;
+
+    // the ticket of the last page released through the unpinned ring, if any is pending
+    bool hasPendingUnpins;
+    size_t lastUnpinTicket;
 };
 #endif /* DATAPROXY_H */
@@ -24,8 +24,15 @@
 #include <list>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include <pthread.h>
 using namespace std;
 
+// the number of consecutive pages of a partition after which we consider a set sequentially scanned
+#ifndef SEQUENTIAL_ACCESS_THRESHOLD
+#define SEQUENTIAL_ACCESS_THRESHOLD 4
+#endif
+
 class LocalitySet;
 typedef shared_ptr<LocalitySet> LocalitySetPtr;
 /**
@@ -56,6 +63,8 @@ public:
 
     /*
      * To update a cached page with new access sequenceId
+     * This is called on every cache hit, so if another thread is updating the set at the same time
+     * we skip the reordering instead of waiting for it, which makes the order approximate.
      */
     void updateCachedPage(PDBPagePtr page);
 
@@ -76,6 +85,36 @@ public:
 
     void unpin();
 
+    /*
+     * To declare the access pattern of the set when it is pinned for a scan.
+     * A set we have seen scanned more than once stays LoopingSequential, even if it is declared
+     * StraightSequential.
+     * Declaring StraightSequential is how a caller asks for the pages to be dropped once consumed.
+     */
+    void declareAccessPattern(AccessPattern accessPattern);
+
+    /*
+     * To record that a page of the set was accessed, so that we detect sequential scans that were
+     * not declared.
+     * After SEQUENTIAL_ACCESS_THRESHOLD consecutive pages of a partition the set becomes
+     * StraightSequential, and if a partition is then scanned again from its first page the set
+     * becomes LoopingSequential.
+     */
+    void recordPageAccess(FilePartitionID partitionId, unsigned int pageSeqInPartition);
+
+    /*
+     * Return true if the set is scanned sequentially, so the scans can prefetch more pages.
+     */
+    bool isSequential();
+
+    /*
+     * Return true if a page of the set can be dropped from cache as soon as it is consumed, that is
+     * the case for a set declared StraightSequential with the MRU policy, as long as it is not seen
+     * scanned again. A StraightSequential pattern detected by recordPageAccess() only makes the
+     * scans prefetch more pages.
+     */
+    bool isDroppedAfterRead();
+
 
     /*
      * Getters/Setters
@@ -93,6 +132,10 @@ public:
 
     void setOperationType(OperationType type);
 
+    AccessPattern getAccessPattern();
+
+    void setAccessPattern(AccessPattern pattern);
+
     DurabilityType getDurabilityType();
 
     void setDurabilityType(DurabilityType type);
@@ -112,6 +155,16 @@ protected:
      */
     list<PDBPagePtr>* cachedPages;
 
+    /**
+     * The position of each cached page in the list, so that we can move or remove a page in O(1)
+     */
+    unordered_map<PDBPage*, list<PDBPagePtr>::iterator> cachedPagePositions;
+
+    /**
+     * Protects the cached pages and their positions
+     */
+    pthread_mutex_t cachedPagesMutex;
+
 
     /*
      * Types of the data in the set:
@@ -144,6 +197,32 @@ protected:
      */
     OperationType operationType;
 
+    /*
+     * Access pattern of the set:
+     * 1. StraightSequential: the set is scanned once from the first page to the last
+     * 2. LoopingSequential: the set is scanned sequentially again and again
+     * 3. SmallSequential: we haven't seen a long sequential run yet
+     *
+     * This property is SmallSequential at construction time, it can be declared at pin time, and
+     * is updated by recordPageAccess().
+     */
+    AccessPattern accessPattern;
+
+    /**
+     * True if the set was declared StraightSequential when it was pinned
+     */
+    bool straightSequentialDeclared;
+
+    /**
+     * For each partition, the last page accessed and the length of the sequential run ending there
+     */
+    unordered_map<FilePartitionID, pair<unsigned int, unsigned int>> partitionAccesses;
+
+    /**
+     * Protects the access pattern and the partition accesses
+     */
+    pthread_mutex_t accessPatternMutex;
+
     /**
      * Durability type of the set:
      * 1. TryCache: flush to disk only when evicting dirty data
@@ -23,6 +23,7 @@
 #include "PDBObject.h"
 #include "DataTypes.h"
 #include "PDBLogger.h"
+#include <atomic>
 #include <memory>
 #include <pthread.h>
 #include <stdlib.h>
@@ -83,25 +84,28 @@ public:
     void preparePage();
 
 
+    // the reference count and the pinned flag share one atomic word, so that pinning a cached
+    // page never takes a lock, and the last unpin can't clear the flag of a concurrent pin
     inline void incRefCount() {
-        pthread_mutex_lock(&this->refCountMutex);
-        this->refCount++;
-        this->pinned = true;
-        pthread_mutex_unlock(&this->refCountMutex);
+        int curPinState = this->pinState.load();
+        while (!this->pinState.compare_exchange_weak(curPinState,
+                                                     (curPinState + PIN_STATE_ONE_REF) |
+                                                         PIN_STATE_PINNED)) {
+        }
     }
 
     inline void decRefCount() {
-        pthread_mutex_lock(&this->refCountMutex);
-        this->refCount--;
-        if (this->refCount < 0) {
-            // there is a problem:
-            // reference count should always >= 0
-            this->setPinned(false);
-            this->refCount = 0;
-        } else if (this->refCount == 0) {
-            this->setPinned(false);
-        }
-        pthread_mutex_unlock(&this->refCountMutex);
+        // reference count should always >= 0, so we never decrement it below zero, and the page
+        // is unpinned together with the release of its last reference
+        int curPinState = this->pinState.load();
+        int newPinState;
+        do {
+            if (curPinState < 2 * PIN_STATE_ONE_REF) {
+                newPinState = 0;
+            } else {
+                newPinState = curPinState - PIN_STATE_ONE_REF;
+            }
+        } while (!this->pinState.compare_exchange_weak(curPinState, newPinState));
     }
 
     inline void freeContent() {
@@ -258,12 +262,12 @@ public:
 
     // To return the reference count of this page.
     int getRefCount() {
-        return this->refCount;
+        return this->pinState.load() / PIN_STATE_ONE_REF;
     }
 
     // To reset the reference count of this page.
     void resetRefCount() {
-        this->refCount = 0;
+        this->pinState.fetch_and(PIN_STATE_PINNED);
     }
 
 
@@ -271,7 +275,7 @@ public:
     // Page is pinned if reference count > 0.
     // Once page is unpinned, we can flush the page to disk, or evict the page from cache.
     bool isPinned() {
-        return this->pinned;
+        return (this->pinState.load() & PIN_STATE_PINNED) != 0;
     }
 
     // Return whether page is dirty (i.e. hasn't been flushed to disk yet).
@@ -367,7 +371,11 @@ public:
 
     // To set whether the page is pinned or not.
     void setPinned(bool isPinned) {
-        this->pinned = isPinned;
+        if (isPinned) {
+            this->pinState.fetch_or(PIN_STATE_PINNED);
+        } else {
+            this->pinState.fetch_and(~PIN_STATE_PINNED);
+        }
     }
 
     // To set whether the page is dirty or not.
@@ -415,8 +423,10 @@ private:
     SetID setID;
     PageID pageID;
     size_t size;
-    int refCount;
-    bool pinned;
+    // the lowest bit is the pinned flag, the bits above it are the reference count
+    static const int PIN_STATE_PINNED = 1;
+    static const int PIN_STATE_ONE_REF = 2;
+    std::atomic<int> pinState;
     bool dirty;
     pthread_mutex_t refCountMutex;
     pthread_rwlock_t flushLock;
@@ -23,6 +23,7 @@
 #include "PageCircularBufferIterator.h"
 #include "PDBCommunicator.h"
 #include "PangeaStorageServer.h"
+#include "PageTransferChannel.h"
 #include <memory>
 using namespace std;
 class PDBScanWork;
@@ -35,7 +36,11 @@ typedef shared_ptr<PDBScanWork> PDBScanWorkPtr;
 
 class PDBScanWork : public pdb::PDBWork {
 public:
-    PDBScanWork(PageIteratorPtr iter, pdb::PangeaStorageServer* storage, int& counter);
+    // if scanRing is not nullptr, the pages are pushed to it instead of the socket
+    PDBScanWork(PageIteratorPtr iter,
+                pdb::PangeaStorageServer* storage,
+                int& counter,
+                PageDescriptorRing* scanRing = nullptr);
     ~PDBScanWork();
     bool sendPagePinned(pdb::PDBCommunicatorPtr myCommunicator,
                         bool morePagesToPin,
@@ -52,6 +57,9 @@ public:
                              string& info,
                              string& errMsg);
 
+    // push the pages to the scan ring of the PageTransferChannel instead of the socket
+    void pushPagesToRing(PageDescriptorRing* ring);
+
     // do the actual work
     void execute(PDBBuzzerPtr callerBuzzer) override;
 
@@ -59,6 +67,7 @@ private:
     PageIteratorPtr iter;
     pdb::PangeaStorageServer* storage;
     int& counter;
+    PageDescriptorRing* scanRing;
     pthread_mutex_t connection_mutex;
 };
 
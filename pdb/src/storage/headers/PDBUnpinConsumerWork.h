@@ -0,0 +1,51 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PDB_UNPIN_CONSUMER_WORK_H
+#define PDB_UNPIN_CONSUMER_WORK_H
+
+#include "PDBWork.h"
+#include "PangeaStorageServer.h"
+#include "PageDescriptorRing.h"
+#include <memory>
+using namespace std;
+class PDBUnpinConsumerWork;
+typedef shared_ptr<PDBUnpinConsumerWork> PDBUnpinConsumerWorkPtr;
+
+#ifndef PAGE_UNPIN_BATCH_SIZE
+#define PAGE_UNPIN_BATCH_SIZE 64
+#endif
+
+//this class unpins the pages the backend releases through the unpinned ring of the
+//PageTransferChannel, in the order they were released; it takes the pages that are already in
+//the ring in batches of up to PAGE_UNPIN_BATCH_SIZE, and completes each batch at once
+
+class PDBUnpinConsumerWork : public pdb::PDBWork {
+public:
+    PDBUnpinConsumerWork(PageDescriptorRing* ring, pdb::PangeaStorageServer* server);
+    ~PDBUnpinConsumerWork(){};
+    void execute(PDBBuzzerPtr callerBuzzer) override;
+    void stop();
+
+private:
+    pdb::PangeaStorageServer* server;
+    PageDescriptorRing* ring;
+    bool isStopped;
+};
+
+
+#endif /* PDB_UNPIN_CONSUMER_WORK_H */
@@ -31,11 +31,24 @@
 #include "SharedMem.h"
 #include "PageCircularBuffer.h"
 #include "LocalitySet.h"
+#include "CacheKeyHash.h"
+#include "CacheStats.h"
+#include "TwoQueueReplacer.h"
+#include <atomic>
 #include <unordered_map>
 #include <memory>
 #include <queue>
 using namespace std;
 
+#ifndef PAGE_CACHE_NUM_SHARDS
+#define PAGE_CACHE_NUM_SHARDS 64
+#endif
+
+// the most page loads in flight for all the scans of a storage server together
+#ifndef PAGE_CACHE_IO_QUEUE_DEPTH
+#define PAGE_CACHE_IO_QUEUE_DEPTH 64
+#endif
+
 class PageCache;
 typedef shared_ptr<PageCache> PageCachePtr;
 
@@ -57,33 +70,6 @@ typedef shared_ptr<PageCache> PageCachePtr;
  */
 
 
-/**
- * Hash function for CacheKey, used for caching and retrieving a page.
- */
-
-struct CacheKeyHash {
-
-    std::size_t operator()(const CacheKey& key) const {
-        return (key.dbId << 24) + (key.typeId << 16) + (key.setId << 8) + key.pageId;
-    }
-};
-
-/**
- * Comparator for CacheKey, used for caching and retrieving a page.
- */
-
-struct CacheKeyEqual {
-
-    bool operator()(const CacheKey& lKey, const CacheKey& rKey) const {
-        if ((lKey.dbId == rKey.dbId) && (lKey.typeId == rKey.typeId) &&
-            (lKey.setId == rKey.setId) && (lKey.pageId == rKey.pageId)) {
-            return true;
-        } else {
-            return false;
-        }
-    }
-};
-
 /**
  * Comparator for the last access time of two cached pages, used for eviction.
  */
@@ -112,6 +98,34 @@ struct CompareCachedPagesMRU {
     }
 };
 
+/**
+ * One partition of the cached pages. Each shard has its own reader-writer lock, so that lookups
+ * of resident pages only take the lock of one shard in read mode, and never contend with each
+ * other. The lock is only taken in write mode to add or remove a page.
+ */
+struct PageCacheShard {
+
+    PageCacheShard() : size(0), numHits(0), numMisses(0), numEvicted(0), numCached(0) {
+        pthread_rwlock_init(&lock, nullptr);
+    }
+
+    ~PageCacheShard() {
+        pthread_rwlock_destroy(&lock);
+    }
+
+    unordered_map<CacheKey, PDBPagePtr, CacheKeyHash, CacheKeyEqual> pages;
+    pthread_rwlock_t lock;
+
+    // the number of bytes allocated for the pages in this shard
+    std::atomic<size_t> size;
+
+    // the counters for the CacheStats, kept per shard so that they are not shared by all threads
+    std::atomic<long> numHits;
+    std::atomic<long> numMisses;
+    std::atomic<long> numEvicted;
+    std::atomic<long> numCached;
+};
+
 /**
  * This class wraps a global page cache adopting multiple eviction policy, and by default it uses
  * MRU.
@@ -176,6 +190,25 @@ public:
     // Get a page directly from cache, if it is not in cache return nullptr
     PDBPagePtr getPage(CacheKey key, LocalitySet* set = nullptr);
 
+    // Get a page directly from cache and pin it, if it is not in cache return nullptr without
+    // logging a warning. Used by the scans to find out which pages they have to load.
+    PDBPagePtr getPageIfCached(CacheKey key, LocalitySet* set = nullptr);
+
+    // Build a page from data that was loaded asynchronously into a buffer allocated by
+    // allocateBufferFromSharedMemoryBlocking(), then cache and pin it. If another thread cached
+    // the same page in the meantime, the buffer is freed and the cached page is pinned instead.
+    PDBPagePtr cacheLoadedPage(PartitionedFilePtr file,
+                               FilePartitionID partitionId,
+                               unsigned int pageSeqInPartition,
+                               char* pageData,
+                               int internalOffset,
+                               size_t pageSize,
+                               LocalitySet* set = nullptr);
+
+    // Free a buffer allocated by allocateBufferFromSharedMemoryBlocking() that was not used for a
+    // page, for example because loading the page failed.
+    void freeBuffer(char* data, int internalOffset, size_t size);
+
 
     // To allocate a new page, blocking until get a page, set it as pinned&dirty, add it to cache,
     // and increment reference count
@@ -213,7 +246,14 @@ public:
     void evict();
 
     // Evict page specified by cachekey from cache.
-    bool evictPage(CacheKey key, bool tryFlushOrNot = true);
+    // evicted is false if the caller discards the page, so the replacer doesn't remember it.
+    bool evictPage(CacheKey key, bool tryFlushOrNot = true, bool evicted = true);
+
+    // Evict a clean page that nobody has pinned, used to free the pages of a set scanned once in
+    // sequence as soon as they are consumed, instead of waiting for the cache to fill up.
+    // Dirty pages are left to the normal eviction. The freed page is also removed from the cached
+    // pages of its set. Return true if the page was freed.
+    bool dropConsumedPage(CacheKey key, LocalitySetPtr set);
 
     // Compute the threshold when to trigger eviction.
     void getAndSetWarnSize(unsigned int numSets, double warnThreshold);
@@ -236,7 +276,12 @@ public:
 
     // Remove page specified by Key from cache hashMap.
     // This function will be used by the flushConsumer thread.
-    bool removePage(CacheKey key);
+    // evicted is false if the page is removed because it is not needed anymore.
+    bool removePage(CacheKey key, bool evicted = true);
+
+    // Remove page specified by Key from cache hashMap only if nobody has pinned it, so that it
+    // can be safely freed afterwards. Returns false if the page is pinned or not in cache.
+    bool removePageIfUnpinned(CacheKey key, bool evicted = true);
     bool freePage(PDBPagePtr page);
     // Lock for eviction.
     void evictionLock();
@@ -290,35 +335,89 @@ public:
     void removeLocalitySetFromPriorityList(LocalitySetPtr set, PriorityLevel level);
 
 
+    // Get a snapshot of the hit, miss, eviction and caching counters of the cache.
+    CacheStats getStats();
+
+    // Get the asynchronous I/O engine shared by the scans of this cache, it is created on first
+    // use, so that a process forked from the server doesn't inherit its threads.
+    SharedPageIOEnginePtr getIOEngine();
+
     // Get logger
     pdb::PDBLoggerPtr getLogger() {
         return this->logger;
     }
 
+    // Get the number of bytes the cache can hold
+    size_t getMaxSize() {
+        return this->maxSize;
+    }
+
     void pin(LocalitySetPtr set, LocalitySetReplacementPolicy policy, OperationType operationType);
 
+    // Pin the set and declare how it is going to be accessed.
+    void pin(LocalitySetPtr set,
+             LocalitySetReplacementPolicy policy,
+             OperationType operationType,
+             AccessPattern accessPattern);
+
     void unpin(LocalitySetPtr set);
 
 
 private:
-    unordered_map<CacheKey, PDBPagePtr, CacheKeyHash, CacheKeyEqual>* cache;
+    // Return the shard that is responsible for the page specified by key.
+    PageCacheShard* getShard(CacheKey key);
+
+    // Look up a page, and if it is in cache, pin it while holding the shard lock in read mode, so
+    // that it can not be evicted before it is pinned. Returns nullptr if the page is not in cache.
+    PDBPagePtr pinCachedPage(CacheKey key);
+
+    // Stamp the page with the next access sequence id.
+    void updateAccessSequenceId(PDBPagePtr page);
+
+    // Evict unpinned pages from one shard in MRU order, until the cache is below the stopSize,
+    // or the shard is below the shardStopSize.
+    int evictShard(PageCacheShard* shard, size_t stopSize, size_t shardStopSize);
+
+    // Evict the pages selected by the 2Q replacer until the cache is below the evictStopSize.
+    int evictTwoQueue();
+
+    // The size at which an eviction stops, it is below the evictStopSize when we are already
+    // below the evictStopSize but a page still does not fit into the fragmented free memory.
+    size_t getEvictionStopSize();
+
+    // Count the bytes allocated for a page that is added to, or removed from, a shard, in the
+    // size of the shard, the size of the cache and the bytes cached on the NUMA node of the page.
+    void countPageBytes(PageCacheShard* shard, PDBPagePtr page, bool added);
+
+    vector<PageCacheShard*> shards;
     pdb::PDBLoggerPtr logger;
     ConfigurationPtr conf;
-    size_t size;
+    std::atomic<size_t> size;
+
+    // the bytes of the cached pages on each NUMA node, kept with the size so that getStats()
+    // doesn't have to walk the pages
+    std::atomic<size_t>* cachedBytesPerNode;
+    int numNodes;
     size_t maxSize;
     size_t warnSize;       // the threshold to evict
     size_t evictStopSize;  // the threshold to stop eviction
     pthread_rwlock_t evictionAndFlushLock;
-    pthread_mutex_t cacheMutex;
     pthread_mutex_t evictionMutex;
-    bool inEviction;
+    std::atomic<bool> inEviction;
     pdb::PDBWorkerQueuePtr workers;
     pdb::PDBWorkPtr evictWork;
-    long accessCount;
-    pthread_mutex_t countLock;
+    std::atomic<long> accessCount;
+
+    // the shard the next eviction starts from, so that all shards are evicted evenly
+    std::atomic<unsigned int> nextShardToEvict;
     SharedMemPtr shm;
     PageCircularBufferPtr flushBuffer;
     CacheStrategy strategy;
+    SharedPageIOEnginePtr ioEngine;
+    pthread_mutex_t ioEngineMutex;
+
+    // only used by the UnifiedTwoQueue strategy
+    TwoQueueReplacerPtr twoQueueReplacer;
     /*
      * index = 0, TransientLifetimeEnded
      * index = 1, PersistentLifetimeEnded
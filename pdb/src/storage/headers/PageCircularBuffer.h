@@ -21,17 +21,31 @@
 
 #include "PDBPage.h"
 #include "PDBLogger.h"
+#include <atomic>
 #include <pthread.h>
 #include <memory>
 using namespace std;
 class PageCircularBuffer;
 typedef shared_ptr<PageCircularBuffer> PageCircularBufferPtr;
 
+// the number of times a thread retries (yielding in between) before it parks on the condition
+// variable, set it to 0 to park right away
+#ifndef PAGE_CIRCULAR_BUFFER_SPINS
+#define PAGE_CIRCULAR_BUFFER_SPINS 64
+#endif
+
 /**
  * This class implements a concurrent blocking circular buffer for producer-consumer problems.
  * The consumer threads will wait until there are pages available in the buffer.
  * The producer threads will wait until there are rooms available in the buffer to push back new
  * pages.
+ *
+ * The buffer is a bounded lock-free multi-producer multi-consumer queue: each slot has a sequence
+ * number telling whether it is free or holds a page for the current round, and producers and
+ * consumers claim slots with a compare-and-swap on the tail and head positions, so they never
+ * take a lock while the buffer is neither full nor empty.
+ * A thread that finds the buffer full (or empty) retries a few times, and then parks on a
+ * condition variable, the mutex is only taken to park and to wake up parked threads.
  */
 
 class PageCircularBuffer {
@@ -53,6 +67,13 @@ public:
      */
     PDBPagePtr popPageFromHead();
 
+    /**
+     * Non-blocking versions of addPageToTail() and popPageFromHead(), return false if the buffer
+     * is full (or empty).
+     */
+    bool tryAddPageToTail(PDBPagePtr page);
+    bool tryPopPageFromHead(PDBPagePtr& page);
+
     /**
      * If the buffer is full, return true, otherwise, return false.
      */
@@ -84,31 +105,10 @@ public:
      * If the buffer is closed, return true, otherwise, return false.
      */
     bool isClosed() {
-        return closed;
+        return closed.load(std::memory_order_acquire);
     }
 
 protected:
-    /**
-     * Return the page array used to construct the concurrent blocking circular buffer.
-     */
-    PDBPagePtr* getPageArray() {
-        return pageArray;
-    }
-
-    /**
-     * Return the head index to the concurrent blocking circular buffer.
-     */
-    unsigned int getPageArrayHead() {
-        return pageArrayHead;
-    }
-
-    /**
-     * Return the tail index to the concurrent blocking circular buffer.
-     */
-    unsigned int getPageArrayTail() {
-        return pageArrayTail;
-    }
-
     /**
      * Return the maximum size of the concurrent blocking circular buffer.
      */
@@ -122,15 +122,33 @@ protected:
     int initArray();
 
 private:
-    PDBPagePtr* pageArray;
+    struct Slot {
+        std::atomic<size_t> sequence;
+        PDBPagePtr page;
+    };
+
+    // wake up the threads parked on cond, if there are any
+    void wakeUp(std::atomic<int>& numParked, pthread_cond_t& cond);
+
+    Slot* slots;
     pdb::PDBLoggerPtr logger;
     unsigned int maxArraySize;
-    unsigned int pageArrayHead;
-    unsigned int pageArrayTail;
+
+    // the positions of the next page to pop and of the next page to add, they only grow, and are
+    // padded so that producers and consumers don't bounce the same cache line
+    char headPadding[64];
+    std::atomic<size_t> pageArrayHead;
+    char tailPadding[64];
+    std::atomic<size_t> pageArrayTail;
+    char parkPadding[64];
+
+    // used only to park the threads that wait for a page or for room
     pthread_mutex_t mutex;
-    pthread_mutex_t addPageMutex;
-    pthread_cond_t cond;
-    bool closed;
+    pthread_cond_t notEmpty;
+    pthread_cond_t notFull;
+    std::atomic<int> numParkedConsumers;
+    std::atomic<int> numParkedProducers;
+    std::atomic<bool> closed;
 };
 
 
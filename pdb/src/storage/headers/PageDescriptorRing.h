@@ -0,0 +1,175 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PAGE_DESCRIPTOR_RING_H
+#define PAGE_DESCRIPTOR_RING_H
+
+#include "DataTypes.h"
+#include "SharedMem.h"
+#include <atomic>
+#include <stddef.h>
+
+#ifndef PAGE_DESCRIPTOR_RING_SPINS
+#define PAGE_DESCRIPTOR_RING_SPINS 128
+#endif
+
+class PageDescriptorRing;
+
+/**
+ * The kinds of messages carried by a PageDescriptorRing.
+ */
+typedef enum {
+    // a page pinned by the frontend for the backend to read
+    PagePinnedDescriptor,
+    // the frontend has pinned all the pages of the scan
+    NoMorePagesDescriptor,
+    // the backend is done with a page, the frontend needs to unpin it
+    PageUnpinnedDescriptor
+} PageDescriptorType;
+
+/**
+ * The information about a page that the frontend and the backend exchange.
+ * The page itself is in the shared memory pool, only its offset travels through the ring.
+ */
+struct PageDescriptor {
+    PageDescriptorType type;
+    NodeID nodeId;
+    DatabaseID dbId;
+    UserTypeID typeId;
+    SetID setId;
+    PageID pageId;
+    size_t pageSize;
+    size_t offset;
+    bool wasDirty;
+};
+
+/**
+ * This class implements a bounded multi-producer multi-consumer ring of page descriptors that
+ * lives in the shared memory pool, so that the frontend and the forked backend can hand pages to
+ * each other without sending messages over the local socket.
+ * Producers and consumers claim slots with a compare-and-swap on the positions, each slot has a
+ * sequence number that tells whether it is ready to be written or read.
+ * A thread that finds the ring full (or empty) spins for a little while, and then sleeps on a
+ * futex, which is shared between the processes because the pool is mapped with MAP_SHARED.
+ * The ring is created before the backend is forked, so both processes see it at the same address.
+ */
+class PageDescriptorRing {
+public:
+    /**
+     * Allocate a ring with the given capacity (rounded up to a power of two) in the shared
+     * memory pool, return nullptr if the pool is out of memory.
+     */
+    static PageDescriptorRing* create(SharedMemPtr shm, unsigned int capacity);
+
+    /**
+     * Destroy the ring and give its memory back to the pool.
+     */
+    static void destroy(SharedMemPtr shm, PageDescriptorRing* ring);
+
+    /**
+     * Add a descriptor to the ring, if the ring is full, block until there is room.
+     * Return false if the ring is closed, otherwise the position of the descriptor in the ring
+     * is returned in ticket.
+     */
+    bool push(const PageDescriptor& descriptor, size_t& ticket);
+
+    /**
+     * Take the oldest descriptor from the ring, if the ring is empty, block until a descriptor is
+     * added. Return false if the ring is empty and closed.
+     */
+    bool pop(PageDescriptor& descriptor, size_t& ticket);
+
+    /**
+     * Non-blocking versions of push() and pop(), return false if the ring is full (or empty).
+     */
+    bool tryPush(const PageDescriptor& descriptor, size_t& ticket);
+    bool tryPop(PageDescriptor& descriptor, size_t& ticket);
+
+    /**
+     * Tell the producer of the descriptor at ticket that it has been handled, the descriptors
+     * need to be completed in the order of their tickets.
+     */
+    void complete(size_t ticket);
+
+    /**
+     * Block until the descriptor at ticket has been completed by a consumer.
+     */
+    void waitForCompletion(size_t ticket);
+
+    /**
+     * Close the ring, wake up all the threads waiting on it.
+     */
+    void close();
+
+    /**
+     * If the ring is closed, return true, otherwise, return false.
+     */
+    bool isClosed();
+
+    /**
+     * Return the number of descriptors in the ring.
+     */
+    size_t getSize();
+
+    /**
+     * Return the maximum number of descriptors in the ring.
+     */
+    size_t getCapacity();
+
+private:
+    // the slots follow the ring in the shared memory
+    struct Slot {
+        std::atomic<size_t> sequence;
+        PageDescriptor descriptor;
+    };
+
+    explicit PageDescriptorRing(size_t capacity);
+
+    Slot* getSlots();
+
+    // sleep on futexWord until it changes from expected
+    static void wait(std::atomic<int>* futexWord, int expected);
+
+    // wake up all the threads sleeping on futexWord
+    static void wakeAll(std::atomic<int>* futexWord);
+
+    size_t capacity;
+    size_t mask;
+
+    // the distance from the start of the allocated memory to the ring, used to free it
+    int allocationOffset;
+
+    alignas(64) std::atomic<size_t> enqueuePos;
+    alignas(64) std::atomic<size_t> dequeuePos;
+
+    // bumped each time a descriptor is added, consumers sleep on it
+    alignas(64) std::atomic<int> numPushes;
+    std::atomic<int> numWaitingConsumers;
+
+    // bumped each time a descriptor is taken, producers sleep on it
+    alignas(64) std::atomic<int> numPops;
+    std::atomic<int> numWaitingProducers;
+
+    // the number of completed descriptors, producers waiting for completion sleep on numCompletes
+    alignas(64) std::atomic<size_t> numCompleted;
+    std::atomic<int> numCompletes;
+    std::atomic<int> numWaitingForCompletion;
+
+    std::atomic<bool> closed;
+};
+
+#endif /* PAGE_DESCRIPTOR_RING_H */
@@ -0,0 +1,160 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PAGE_IO_ENGINE_H
+#define PAGE_IO_ENGINE_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+using namespace std;
+
+class PageIOEngine;
+typedef shared_ptr<PageIOEngine> PageIOEnginePtr;
+
+class SharedPageIOEngine;
+typedef shared_ptr<SharedPageIOEngine> SharedPageIOEnginePtr;
+
+/**
+ * One asynchronous page read or write.
+ * The caller owns the request and must keep it alive until it is returned by
+ * PageIOEngine::waitForCompletion().
+ */
+struct PageIORequest {
+
+    // the file handle, the buffer, the number of bytes and the file offset of the I/O
+    int handle;
+    char* buffer;
+    size_t length;
+    off_t offset;
+    bool isWrite;
+
+    // the number of bytes read or written, or -errno if the I/O failed
+    ssize_t result;
+
+    // not touched by the engine, the caller can use it to find its own state
+    void* userData;
+
+    // set by a SharedPageIOEngine to find the client that submitted the request
+    void* client;
+
+    // used by the engines that need an iovec
+    struct iovec iov;
+};
+
+/**
+ * This class is the interface of the asynchronous I/O backends used to load and store pages.
+ * Unlike PartitionedFile::loadPage(), which blocks the calling thread for each page, an engine
+ * accepts a batch of requests at once and lets the device work on all of them concurrently, so that
+ * a scan can keep several pages in flight per partition.
+ *
+ * There are three backends, createPageIOEngine() picks the first one that works on this machine:
+ * 1. io_uring, on Linux 5.1 and newer.
+ * 2. Linux native AIO (what libaio wraps), it is only really asynchronous for O_DIRECT files.
+ * 3. A pool of threads that issue blocking pread()/pwrite().
+ * The first two are used through the raw system calls, so no extra library is needed.
+ *
+ * An engine is not thread-safe: one thread at a time can submit requests, and one thread at a time
+ * can wait for them, which may be another thread than the one that submits. To share a backend
+ * between threads, use a SharedPageIOEngine.
+ */
+class PageIOEngine {
+
+public:
+    virtual ~PageIOEngine() {}
+
+    // Submit a batch of requests. Returns false, without submitting anything, if that would put
+    // more requests in flight than the queue depth. Requests that fail later are returned by
+    // waitForCompletion() with a negative result.
+    virtual bool submit(vector<PageIORequest*>& requests) = 0;
+
+    // Block until one of the submitted requests completes, and return it.
+    // Returns nullptr if there is no request in flight.
+    virtual PageIORequest* waitForCompletion() = 0;
+
+    // The name of the backend.
+    virtual string getName() = 0;
+
+    // The maximum number of requests in flight.
+    unsigned int getQueueDepth() {
+        return queueDepth;
+    }
+
+    // The number of requests submitted that have not been returned by waitForCompletion() yet.
+    unsigned int getNumInFlight() {
+        return numInFlight;
+    }
+
+protected:
+    unsigned int queueDepth = 0;
+    std::atomic<unsigned int> numInFlight{0};
+};
+
+/**
+ * This class shares one backend, with its ring or its threads, between all the scans of a storage
+ * server. Each scan gets its own client through createClient(), a PageIOEngine limited to its own
+ * queue depth, and a completion thread hands every completed request back to the client that
+ * submitted it. A client can be used by one thread at a time, different clients by different
+ * threads.
+ */
+class SharedPageIOEngine : public enable_shared_from_this<SharedPageIOEngine> {
+
+public:
+    // backend is nullptr if no asynchronous I/O engine is available
+    explicit SharedPageIOEngine(PageIOEnginePtr backend);
+
+    // the clients keep the engine alive, so there is no request in flight when it is destroyed
+    ~SharedPageIOEngine();
+
+    // Create a client that keeps at most queueDepth requests in flight.
+    // Returns nullptr if no asynchronous I/O engine is available.
+    PageIOEnginePtr createClient(unsigned int queueDepth);
+
+    // Submit a batch of requests for a client. Returns false, without submitting anything, if the
+    // backend has no room for them.
+    bool submit(void* client, vector<PageIORequest*>& requests);
+
+    // The name of the backend.
+    string getName();
+
+private:
+    static void* runCompletionThread(void* arg);
+
+    PageIOEnginePtr backend;
+    pthread_t completionThread;
+    pthread_mutex_t mutex;
+    pthread_cond_t requestSubmitted;
+    unsigned int numInFlight;
+    bool stopped;
+};
+
+// Create a SharedPageIOEngine over the best backend supported by the kernel.
+SharedPageIOEnginePtr createSharedPageIOEngine(unsigned int queueDepth);
+
+// Create the best asynchronous I/O engine supported by the kernel, with the given queue depth.
+PageIOEnginePtr createPageIOEngine(unsigned int queueDepth);
+
+// Create an engine of a specific backend, "io_uring", "aio" or "threads".
+// Returns nullptr if the backend is not supported.
+PageIOEnginePtr createPageIOEngine(string name, unsigned int queueDepth);
+
+#endif /* PAGE_IO_ENGINE_H */
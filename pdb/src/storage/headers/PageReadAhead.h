@@ -0,0 +1,146 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PAGE_READ_AHEAD_H
+#define PAGE_READ_AHEAD_H
+
+#include "PageCache.h"
+#include "PartitionedFile.h"
+#include "PageIOEngine.h"
+#include <deque>
+#include <memory>
+#include <vector>
+using namespace std;
+
+// the number of pages a scan keeps in flight per partition
+#ifndef PAGE_SCAN_IO_DEPTH
+#define PAGE_SCAN_IO_DEPTH 8
+#endif
+
+// the number of pages a scan keeps in flight per partition once the set is known to be scanned
+// sequentially
+#ifndef SEQUENTIAL_SCAN_PREFETCH_DEPTH
+#define SEQUENTIAL_SCAN_PREFETCH_DEPTH 32
+#endif
+
+// the most memory the pages in flight of one scan can take, this limits the number of pages in
+// flight if the pages are big
+#ifndef PAGE_SCAN_MAX_IO_BYTES
+#define PAGE_SCAN_MAX_IO_BYTES ((size_t)(512) * (size_t)(1024) * (size_t)(1024))
+#endif
+
+class PageReadAhead;
+typedef shared_ptr<PageReadAhead> PageReadAheadPtr;
+
+/**
+ * A page of the read-ahead window, either already in cache, or being loaded asynchronously.
+ */
+struct ReadAheadSlot {
+    FilePartitionID partitionId;
+    unsigned int pageSeqInPartition;
+    PageID pageId;
+    PDBPagePtr page;
+    PageIORequest request;
+    int internalOffset;
+    bool inFlight;
+};
+
+/**
+ * This class keeps a window of pages of a PartitionedFile that a scan will need next.
+ * The pages already in cache are pinned right away, the others are loaded asynchronously through a
+ * PageIOEngine, so that the device works on the next pages while the scan processes the current
+ * one. The pages are returned in the order they were added.
+ *
+ * The buffers in flight are not accounted in the cache size until the pages are taken, so only the
+ * first page of the window may block and evict, for the others the window stops growing if the
+ * cache has no room for them.
+ */
+class PageReadAhead {
+
+public:
+    /**
+     * To create a window of at most maxDepth pages.
+     * set is the locality set passed to the cache, it can be nullptr.
+     */
+    PageReadAhead(PageCachePtr cache,
+                  PartitionedFilePtr file,
+                  LocalitySet* set,
+                  unsigned int maxDepth);
+
+    /**
+     * Waits for the loads in flight, and unpins the pages that were not taken.
+     */
+    ~PageReadAhead();
+
+    /**
+     * Return false if no asynchronous I/O engine is available, then the caller should load the
+     * pages synchronously.
+     */
+    bool isAsynchronous();
+
+    /**
+     * To add a page at the end of the window.
+     * Return false if the window is full, or if the cache has no room for the page.
+     */
+    bool add(FilePartitionID partitionId, unsigned int pageSeqInPartition, PageID pageId);
+
+    /**
+     * To return the first page of the window pinned, waiting for its load if needed.
+     */
+    PDBPagePtr take();
+
+    /**
+     * To change the number of pages the window can hold, it can't exceed the maxDepth.
+     */
+    void setDepth(unsigned int depth);
+
+    bool isFull();
+
+    bool isEmpty();
+
+    /**
+     * Return the id of the page take() will return.
+     */
+    PageID getFirstPageId();
+
+private:
+    /**
+     * To submit the loads added since the last submission, if the engine doesn't accept them, the
+     * pages are loaded synchronously.
+     */
+    void submit();
+
+    /**
+     * To load a page synchronously through the cache.
+     */
+    PDBPagePtr loadPage(ReadAheadSlot* slot);
+
+    PageCachePtr cache;
+    PartitionedFilePtr file;
+    LocalitySet* set;
+    unsigned int maxDepth;
+    unsigned int depth;
+    deque<ReadAheadSlot*> window;
+    vector<PageIORequest*> requestsToSubmit;
+
+    // a client of the engine shared by the scans of the cache, nullptr if no asynchronous I/O
+    // engine is available
+    PageIOEnginePtr ioEngine;
+};
+
+
+#endif
@@ -29,6 +29,7 @@
 #include "PDBLogger.h"
 #include "PageCircularBufferIterator.h"
 #include "SharedMem.h"
+#include "PageTransferChannel.h"
 #include "DataTypes.h"
 #include "StoragePagePinned.h"
 #include <string.h>
@@ -49,6 +50,9 @@ typedef shared_ptr<PageScanner> PageScannerPtr;
  * At the end of recvPagesLoop(), it will receive a special message from frontend,
  * telling the scanner that all messages have been received and the recvPagesLoop()
  * can return.
+ * If the frontend and the backend share a PageTransferChannel, the pages come through a scan
+ * ring instead, getSetIterators() then starts a thread that moves them to the buffer, and closes
+ * the buffer when the frontend tells that all the pages have been pinned.
  */
 class PageScanner {
 
@@ -105,6 +109,12 @@ public:
     bool recvPagesLoop(pdb::Handle<pdb::StoragePagePinned> pinnedPage,
                        pdb::PDBCommunicatorPtr myCommunicator);
 
+    /**
+     * Move the pages from the scan ring of the PageTransferChannel to the buffer, until the
+     * frontend tells that there are no more pages, then release the ring and close the buffer.
+     */
+    void recvPagesFromRing();
+
     /**
      * Close the buffer
      */
@@ -123,6 +133,14 @@ private:
     unsigned int numThreads;
     SharedMemPtr shm;
     NodeID nodeId;
+
+    // the thread running recvPagesFromRing()
+    pthread_t ringThread;
+    bool ringThreadStarted;
+
+    // the scan ring of the PageTransferChannel the frontend pushes our pages to, nullptr if none,
+    // it is given back to the channel when the scan ends, or when the scanner is destroyed
+    ScanRingGuardPtr scanRing;
 };
 
 
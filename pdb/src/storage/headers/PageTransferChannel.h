@@ -0,0 +1,150 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PAGE_TRANSFER_CHANNEL_H
+#define PAGE_TRANSFER_CHANNEL_H
+
+#include "PageDescriptorRing.h"
+#include "SharedMem.h"
+#include <memory>
+#include <pthread.h>
+#include <vector>
+using namespace std;
+
+#ifndef PAGE_TRANSFER_RING_SIZE
+#define PAGE_TRANSFER_RING_SIZE 1024
+#endif
+
+#ifndef PAGE_TRANSFER_NUM_SCAN_RINGS
+#define PAGE_TRANSFER_NUM_SCAN_RINGS 16
+#endif
+
+// how long a scan waits for a scan ring before it falls back to receiving its pages over the
+// local socket
+#ifndef PAGE_TRANSFER_SCAN_RING_TIMEOUT_MS
+#define PAGE_TRANSFER_SCAN_RING_TIMEOUT_MS 1000
+#endif
+
+class PageTransferChannel;
+typedef shared_ptr<PageTransferChannel> PageTransferChannelPtr;
+
+class ScanRingGuard;
+typedef shared_ptr<ScanRingGuard> ScanRingGuardPtr;
+
+/**
+ * This class holds the rings the frontend and the backend use to exchange pages through the
+ * shared memory pool instead of the local socket:
+ * - each scan gets a scan ring of its own, the frontend pushes the pages it pins for the scan to
+ *   it, followed by a NoMorePages descriptor, and the backend PageScanner pops them. Concurrent
+ *   stages scan concurrently, so the end of one scan must not end the others;
+ * - the backend pushes the pages it is done with to the unpinned ring, and a frontend thread
+ *   unpins them from the cache.
+ * The channel must be created before the backend is forked, and it is reachable from both
+ * processes through SharedMem::getPageTransferChannel().
+ * The scan rings are claimed by the backend, which sends the id of the ring with the
+ * StorageGetSetPages request, so only the copy of the channel in the backend tracks which rings
+ * are in use.
+ */
+class PageTransferChannel {
+public:
+    PageTransferChannel(SharedMemPtr shm,
+                        unsigned int ringSize = PAGE_TRANSFER_RING_SIZE,
+                        unsigned int numScanRings = PAGE_TRANSFER_NUM_SCAN_RINGS);
+    ~PageTransferChannel();
+
+    /**
+     * Return true if all the rings could be allocated in the shared memory pool.
+     */
+    bool isValid();
+
+    /**
+     * Claim a scan ring that no other scan is using, block until one is released if all of them
+     * are in use, for at most timeoutMs milliseconds. Return the id of the ring, or -1 if the
+     * channel is closed or no ring was released in time.
+     */
+    int acquireScanRing(unsigned int timeoutMs = PAGE_TRANSFER_SCAN_RING_TIMEOUT_MS);
+
+    /**
+     * Give a scan ring back once the NoMorePages descriptor of its scan has been taken.
+     */
+    void releaseScanRing(int scanRingId);
+
+    /**
+     * Return the ring carrying the pages pinned by the frontend to the backend for one scan.
+     */
+    PageDescriptorRing* getScanRing(int scanRingId);
+
+    /**
+     * Return the ring carrying the pages released by the backend to the frontend.
+     */
+    PageDescriptorRing* getUnpinnedPages();
+
+    /**
+     * Close all the rings, wake up all the threads waiting on them.
+     */
+    void close();
+
+private:
+    vector<PageDescriptorRing*> scanRings;
+    PageDescriptorRing* unpinnedPages;
+
+    // which scan rings are claimed by a scan, only used in the backend
+    vector<bool> scanRingInUse;
+    bool closed;
+    pthread_mutex_t scanRingMutex;
+    pthread_cond_t scanRingReleased;
+};
+
+/**
+ * This class holds a scan ring claimed with PageTransferChannel::acquireScanRing(), and gives it
+ * back to the channel when it is destroyed, so that a scan that fails or ends early doesn't keep
+ * its ring claimed forever.
+ */
+class ScanRingGuard {
+public:
+    /**
+     * Claim a scan ring of the channel, getScanRingId() is -1 if none could be claimed.
+     */
+    ScanRingGuard(PageTransferChannelPtr channel,
+                  unsigned int timeoutMs = PAGE_TRANSFER_SCAN_RING_TIMEOUT_MS);
+    ~ScanRingGuard();
+
+    /**
+     * Return the id of the claimed ring, or -1 if the guard holds no ring.
+     */
+    int getScanRingId();
+
+    /**
+     * Give the ring back now, the destructor then does nothing.
+     */
+    void release();
+
+    /**
+     * Keep the ring claimed after the guard is destroyed, for a ring the frontend may still push
+     * the pages of the scan to, which must not be handed to another scan.
+     */
+    void dismiss();
+
+private:
+    ScanRingGuard(const ScanRingGuard&) = delete;
+    ScanRingGuard& operator=(const ScanRingGuard&) = delete;
+
+    PageTransferChannelPtr channel;
+    int scanRingId;
+};
+
+#endif /* PAGE_TRANSFER_CHANNEL_H */
@@ -29,17 +29,28 @@
 #include "PDBFile.h"
 #include "PageCache.h"
 #include "UserSet.h"
+#include "PageReadAhead.h"
 
+/**
+ * This class iterates the pages of a partition of a file.
+ * For PartitionedFile instances, it keeps a window of up to PAGE_SCAN_IO_DEPTH pages that are
+ * loaded asynchronously through a PageReadAhead, so the device works on the next pages while the
+ * caller processes the current one. Once the set is known to be scanned sequentially, either
+ * because it was pinned with a sequential AccessPattern or because the LocalitySet detected it,
+ * the window grows to SEQUENTIAL_SCAN_PREFETCH_DEPTH pages.
+ */
 class PartitionPageIterator : public PageIteratorInterface {
 
 public:
     /**
      * To create a new PartitionPageIterator instance
+     * If ioDepth is 1, the pages are loaded synchronously one by one.
      */
     PartitionPageIterator(PageCachePtr cache,
                           PDBFilePtr file,
                           FilePartitionID partitionId,
-                          UserSet* set = nullptr);
+                          UserSet* set = nullptr,
+                          unsigned int ioDepth = PAGE_SCAN_IO_DEPTH);
     /*
      * To support polymorphism.
      */
@@ -56,6 +67,22 @@ public:
     bool hasNext();
 
 private:
+    /**
+     * The number of pages to keep in flight, depending on the access pattern of the set.
+     */
+    unsigned int getReadAheadDepth();
+
+    /**
+     * To create the read-ahead window on the first call, return false if the pages have to be
+     * loaded synchronously.
+     */
+    bool startReadAhead();
+
+    /**
+     * To fill the read-ahead window and return its first page.
+     */
+    PDBPagePtr takeFromReadAhead();
+
     PageCachePtr cache;
     PDBFilePtr file;
     FileType type;
@@ -65,6 +92,13 @@ private:
     unsigned int numPages;
     unsigned int numIteratedPages;
     UserSet* set;
+
+    // the pages added to the read-ahead window so far
+    unsigned int numRequestedPages;
+    unsigned int ioDepth;
+
+    // created on the first call to next(), nullptr if we load the pages synchronously
+    PageReadAheadPtr readAhead;
 };
 
 
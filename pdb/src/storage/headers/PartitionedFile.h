@@ -20,6 +20,7 @@
 
 #include "PDBFile.h"
 #include "PartitionedFileMetaData.h"
+#include "PageIOEngine.h"
 #include "SharedMem.h"
 #include <string>
 #include <vector>
@@ -174,6 +175,17 @@ public:
                           char* pageInCache,
                           size_t length);
 
+    /**
+     * To prepare an asynchronous load of a page, the request can then be submitted to a
+     * PageIOEngine together with the loads of other pages.
+     * Return false if the partition is not opened, or the page doesn't exist.
+     */
+    bool prepareLoadPageRequest(FilePartitionID partitionId,
+                                unsigned int pageSeqInPartition,
+                                char* pageInCache,
+                                size_t length,
+                                PageIORequest& request);
+
 
     /**
      * Similar with above method.
@@ -24,6 +24,7 @@
 #include "DataTypes.h"
 #include "PageCache.h"
 #include "PageIterator.h"
+#include "PageReadAhead.h"
 #include <set>
 #include <memory>
 using namespace std;
@@ -64,9 +65,19 @@ public:
     bool hasNext() override;
 
 private:
+    /**
+     * If the set is scanned sequentially, to add the next pages that were flushed to file, starting
+     * from the current one, to the read-ahead window, and return the current page from the window.
+     * Return nullptr if the current page has to be loaded synchronously.
+     */
+    PDBPagePtr takeFlushedPageFromReadAhead(PageID pageId);
+
     PageCachePtr cache;
     UserSet* set;
     std::unordered_map<PageID, FileSearchKey>::iterator iter;
+
+    // created the first time we meet a flushed page of a sequentially scanned set
+    PageReadAheadPtr readAhead;
 };
 
 
@@ -0,0 +1,120 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TWO_QUEUE_REPLACER_H
+#define TWO_QUEUE_REPLACER_H
+
+#include "PDBPage.h"
+#include "CacheKeyHash.h"
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <pthread.h>
+using namespace std;
+
+// the share of the cache the pages that were only referenced once can use before we evict them
+#ifndef TWO_QUEUE_RECENT_RATIO
+#define TWO_QUEUE_RECENT_RATIO 0.25
+#endif
+
+// how many evicted pages we remember, relative to the number of pages that fit in the cache
+#ifndef TWO_QUEUE_GHOST_RATIO
+#define TWO_QUEUE_GHOST_RATIO 0.5
+#endif
+
+class TwoQueueReplacer;
+typedef shared_ptr<TwoQueueReplacer> TwoQueueReplacerPtr;
+
+/**
+ * This class implements the 2Q replacement policy (Johnson and Shasha, VLDB'94) for the PageCache
+ * when it uses the UnifiedTwoQueue strategy.
+ *
+ * Cached pages are kept in one of two queues:
+ * - recent: pages that were referenced once since they were loaded, in FIFO order.
+ * - frequent: pages that were referenced again while they were cached, or soon after they were
+ *   evicted from the recent queue, in LRU order.
+ * Additionally we remember the keys of the pages recently evicted from the recent queue, the ghost
+ * queue, so that a page that comes back soon is admitted directly into the frequent queue.
+ *
+ * Eviction takes pages from the recent queue as long as it holds more than its share of the
+ * cache, so a large sequential scan, whose pages are referenced only once, only recycles the
+ * recent queue, and does not flush the hash partition and join pages other jobs keep reusing.
+ *
+ * This class does not own the pages, the PageCache tells it when a page is added to the cache,
+ * referenced, or removed from the cache. All methods are thread-safe.
+ */
+class TwoQueueReplacer {
+
+public:
+    // maxSize is the size of the cache in bytes, and pageSize the typical size of a page
+    TwoQueueReplacer(size_t maxSize, size_t pageSize);
+
+    ~TwoQueueReplacer();
+
+    // A page was added to the cache.
+    void addPage(CacheKey key, PDBPagePtr page);
+
+    // A cached page was referenced. To keep cache hits cheap, if another thread is using the
+    // replacer we skip the reordering instead of waiting.
+    void accessPage(CacheKey key);
+
+    // A page was removed from the cache. Only a page that was evicted from the recent queue is
+    // remembered in the ghost queue, not one its owner removed, e.g. because its set was cleared.
+    void removePage(CacheKey key, bool evicted);
+
+    // Select unpinned pages to evict, in eviction order, until their size adds up to bytesToFree.
+    // The pages stay in the queues until the PageCache removes them.
+    vector<PDBPagePtr> selectPagesForReplacement(size_t bytesToFree);
+
+    // Return the number of pages in the recent queue, the frequent queue and the ghost queue.
+    size_t getNumRecentPages();
+    size_t getNumFrequentPages();
+    size_t getNumGhosts();
+
+private:
+    enum QueueType { RecentQueue, FrequentQueue };
+
+    struct Entry {
+        QueueType queue;
+        list<PDBPagePtr>::iterator position;
+    };
+
+    // The number of bytes a page uses in the cache.
+    static size_t getCachedSize(PDBPagePtr page);
+
+    // Return true if the eviction can take the page.
+    static bool isEvictable(PDBPagePtr page);
+
+    // Remember the key of a page evicted from the recent queue, must be called with the mutex held.
+    void addGhost(CacheKey key);
+
+    list<PDBPagePtr> recentPages;
+    list<PDBPagePtr> frequentPages;
+    list<CacheKey> ghosts;
+    unordered_map<CacheKey, Entry, CacheKeyHash, CacheKeyEqual> entries;
+    unordered_map<CacheKey, list<CacheKey>::iterator, CacheKeyHash, CacheKeyEqual> ghostPositions;
+
+    // the bytes used by the recent queue, and the most it may use before we evict from it
+    size_t recentSize;
+    size_t maxRecentSize;
+
+    size_t maxNumGhosts;
+    pthread_mutex_t mutex;
+};
+
+#endif /* TWO_QUEUE_REPLACER_H */
@@ -37,6 +37,7 @@
 #include "StorageRemoveTempSet.h"
 #include "CloseConnection.h"
 #include "Configuration.h"
+#include "PageTransferChannel.h"
 
 #ifndef MAX_RETRIES
 #define MAX_RETRIES 5
@@ -51,11 +52,29 @@ DataProxy::DataProxy(NodeID nodeId,
     this->shm = shm;
     this->logger = logger;
     this->communicator->setLongConnection(true);
+    this->hasPendingUnpins = false;
+    this->lastUnpinTicket = 0;
 }
 
-DataProxy::~DataProxy() {}
+DataProxy::~DataProxy() {
+    waitForUnpinnedPages();
+}
+
+void DataProxy::waitForUnpinnedPages() {
+    if (this->hasPendingUnpins == false) {
+        return;
+    }
+    // the frontend unpins the pages in the order of their tickets, so once the last page is
+    // unpinned, all the others are
+    PageTransferChannelPtr channel = this->shm->getPageTransferChannel();
+    if (channel != nullptr) {
+        channel->getUnpinnedPages()->waitForCompletion(this->lastUnpinTicket);
+    }
+    this->hasPendingUnpins = false;
+}
 
-bool DataProxy::addTempSet(string setName, SetID& setId, bool needMem, int numTries) {
+bool DataProxy::addTempSet(
+    string setName, SetID& setId, LocalityType localityType, bool needMem, int numTries) {
     if (numTries == MAX_RETRIES) {
         return false;
     }
@@ -78,13 +97,13 @@ bool DataProxy::addTempSet(string setName, SetID& setId, bool needMem, int numTr
         {
             const pdb::UseTemporaryAllocationBlock myBlock{1024};
             pdb::Handle<pdb::StorageAddTempSet> msg =
-                pdb::makeObject<pdb::StorageAddTempSet>(setName);
+                pdb::makeObject<pdb::StorageAddTempSet>(setName, DEFAULT_PAGE_SIZE, localityType);
             // we don't know the SetID to be added, the frontend will assign one.
             // send the message out
             if (!this->communicator->sendObject<pdb::StorageAddTempSet>(msg, errMsg)) {
                 // We reserve Database 0 and Type 0 as temp data
                 cout << "Sending object failure: " << errMsg << "\n";
-                return addTempSet(setName, setId, needMem, numTries + 1);
+                return addTempSet(setName, setId, localityType, needMem, numTries + 1);
             }
         }
 
@@ -93,7 +112,7 @@ bool DataProxy::addTempSet(string setName, SetID& setId, bool needMem, int numTr
             size_t objectSize = this->communicator->getSizeOfNextObject();
             if (objectSize == 0) {
                 cout << "Receiving ack failure" << std::endl;
-                return addTempSet(setName, setId, needMem, numTries + 1);
+                return addTempSet(setName, setId, localityType, needMem, numTries + 1);
             }
             const pdb::UseTemporaryAllocationBlock myBlock{objectSize};
             bool success;
@@ -102,7 +121,7 @@ bool DataProxy::addTempSet(string setName, SetID& setId, bool needMem, int numTr
 
             if (ack == nullptr) {
                 cout << "Receiving ack failure:" << errMsg << "\n";
-                return addTempSet(setName, setId, needMem, numTries + 1);
+                return addTempSet(setName, setId, localityType, needMem, numTries + 1);
             }
             if (success == true) {
                 setId = ack->getTempSetID();
@@ -113,13 +132,13 @@ bool DataProxy::addTempSet(string setName, SetID& setId, bool needMem, int numTr
 
         {
             pdb::Handle<pdb::StorageAddTempSet> msg =
-                pdb::makeObject<pdb::StorageAddTempSet>(setName);
+                pdb::makeObject<pdb::StorageAddTempSet>(setName, DEFAULT_PAGE_SIZE, localityType);
             // we don't know the SetID to be added, the frontend will assign one.
             // send the message out
             if (!this->communicator->sendObject<pdb::StorageAddTempSet>(msg, errMsg)) {
                 // We reserve Database 0 and Type 0 as temp data
                 cout << "Sending object failure: " << errMsg << "\n";
-                return addTempSet(setName, setId, needMem, numTries + 1);
+                return addTempSet(setName, setId, localityType, needMem, numTries + 1);
             }
         }
 
@@ -130,7 +149,7 @@ bool DataProxy::addTempSet(string setName, SetID& setId, bool needMem, int numTr
                 this->communicator->getNextObject<pdb::StorageAddTempSetResult>(success, errMsg);
             if (ack == nullptr) {
                 cout << "Receiving ack failure:" << errMsg << "\n";
-                return addTempSet(setName, setId, needMem, numTries + 1);
+                return addTempSet(setName, setId, localityType, needMem, numTries + 1);
             }
             if (success == true) {
                 setId = ack->getTempSetID();
@@ -142,6 +161,7 @@ bool DataProxy::addTempSet(string setName, SetID& setId, bool needMem, int numTr
 
 
 bool DataProxy::removeTempSet(SetID setId, bool needMem, int numTries) {
+    waitForUnpinnedPages();
     if (numTries == MAX_RETRIES) {
         return false;
     }
@@ -569,6 +589,28 @@ bool DataProxy::unpinUserPage(NodeID nodeId,
         logger->error(std::string("DataProxy: unpinUserPage with numTries=") +
                       std::to_string(numTries));
     }
+
+    // release the page through the shared ring, without a message to the frontend
+    PageTransferChannelPtr channel = this->shm->getPageTransferChannel();
+    if (channel != nullptr) {
+        PageDescriptor descriptor;
+        descriptor.type = PageUnpinnedDescriptor;
+        descriptor.nodeId = nodeId;
+        descriptor.dbId = dbId;
+        descriptor.typeId = typeId;
+        descriptor.setId = setId;
+        descriptor.pageId = page->getPageID();
+        descriptor.pageSize = page->getSize();
+        descriptor.offset = page->getOffset();
+        descriptor.wasDirty = page->isDirty();
+        size_t ticket;
+        if (channel->getUnpinnedPages()->push(descriptor, ticket) == true) {
+            this->hasPendingUnpins = true;
+            this->lastUnpinTicket = ticket;
+            return true;
+        }
+    }
+
     std::string errMsg;
     if (this->communicator->isSocketClosed() == true) {
         std::cout << "ERROR in DataProxy: connection is closed" << std::endl;
@@ -663,6 +705,7 @@ bool DataProxy::unpinUserPage(NodeID nodeId,
 }
 
 PageScannerPtr DataProxy::getScanner(int numThreads) {
+    waitForUnpinnedPages();
     std::string errMsg;
     if (this->communicator->isSocketClosed() == true) {
         std::cout << "ERROR in DataProxy.getScanner: connection is closed" << std::endl;
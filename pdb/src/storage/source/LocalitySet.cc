@@ -27,9 +27,13 @@ LocalitySet::LocalitySet(LocalityType localityType,
                          DurabilityType durabilityType,
                          PersistenceType persistenceType) {
     cachedPages = new list<PDBPagePtr>();
+    pthread_mutex_init(&cachedPagesMutex, nullptr);
+    pthread_mutex_init(&accessPatternMutex, nullptr);
     this->localityType = localityType;
     this->replacementPolicy = replacementPolicy;
     this->operationType = operationType;
+    this->accessPattern = SmallSequential;
+    this->straightSequentialDeclared = false;
     this->durabilityType = durabilityType;
     this->persistenceType = persistenceType;
     this->lifetimeEnded = false;
@@ -37,34 +41,49 @@ LocalitySet::LocalitySet(LocalityType localityType,
 
 LocalitySet::~LocalitySet() {
     cachedPages->clear();
+    cachedPagePositions.clear();
     delete cachedPages;
+    pthread_mutex_destroy(&cachedPagesMutex);
+    pthread_mutex_destroy(&accessPatternMutex);
 }
 
 void LocalitySet::addCachedPage(PDBPagePtr page) {
-    cachedPages->push_back(page);
+    pthread_mutex_lock(&cachedPagesMutex);
+    auto position = cachedPagePositions.find(page.get());
+    if (position != cachedPagePositions.end()) {
+        cachedPages->erase(position->second);
+    }
+    cachedPagePositions[page.get()] = cachedPages->insert(cachedPages->end(), page);
+    pthread_mutex_unlock(&cachedPagesMutex);
 }
 
 void LocalitySet::updateCachedPage(PDBPagePtr page) {
-    for (list<PDBPagePtr>::iterator it = cachedPages->begin(); it != cachedPages->end(); ++it) {
-        if ((*it) == page) {
-            cachedPages->erase(it);
-            break;
-        }
+    // we don't wait here, the hit path should not be serialized on the set
+    if (pthread_mutex_trylock(&cachedPagesMutex) != 0) {
+        return;
+    }
+    auto position = cachedPagePositions.find(page.get());
+    if (position != cachedPagePositions.end()) {
+        cachedPages->splice(cachedPages->end(), *cachedPages, position->second);
+    } else {
+        cachedPagePositions[page.get()] = cachedPages->insert(cachedPages->end(), page);
     }
-    cachedPages->push_back(page);
+    pthread_mutex_unlock(&cachedPagesMutex);
 }
 
 void LocalitySet::removeCachedPage(PDBPagePtr page) {
-    for (list<PDBPagePtr>::iterator it = cachedPages->begin(); it != cachedPages->end(); ++it) {
-        if ((*it) == page) {
-            cachedPages->erase(it);
-            break;
-        }
+    pthread_mutex_lock(&cachedPagesMutex);
+    auto position = cachedPagePositions.find(page.get());
+    if (position != cachedPagePositions.end()) {
+        cachedPages->erase(position->second);
+        cachedPagePositions.erase(position);
     }
+    pthread_mutex_unlock(&cachedPagesMutex);
 }
 
 PDBPagePtr LocalitySet::selectPageForReplacement() {
     PDBPagePtr retPage = nullptr;
+    pthread_mutex_lock(&cachedPagesMutex);
     if (this->replacementPolicy == MRU) {
         for (list<PDBPagePtr>::reverse_iterator it = cachedPages->rbegin();
              it != cachedPages->rend();
@@ -82,13 +101,16 @@ PDBPagePtr LocalitySet::selectPageForReplacement() {
             }
         }
     }
+    pthread_mutex_unlock(&cachedPagesMutex);
     return retPage;
 }
 
 vector<PDBPagePtr>* LocalitySet::selectPagesForReplacement() {
     vector<PDBPagePtr>* retPages = new vector<PDBPagePtr>();
+    pthread_mutex_lock(&cachedPagesMutex);
     int totalPages = cachedPages->size();
     if (totalPages == 0) {
+        pthread_mutex_unlock(&cachedPagesMutex);
         delete retPages;
         return nullptr;
     }
@@ -125,6 +147,7 @@ vector<PDBPagePtr>* LocalitySet::selectPagesForReplacement() {
             }
         }
     }
+    pthread_mutex_unlock(&cachedPagesMutex);
     if (numPages == 0) {
         delete retPages;
         return nullptr;
@@ -144,6 +167,52 @@ void LocalitySet::unpin() {
     this->lifetimeEnded = true;
 }
 
+void LocalitySet::declareAccessPattern(AccessPattern accessPattern) {
+    pthread_mutex_lock(&accessPatternMutex);
+    if ((accessPattern != StraightSequential) || (this->accessPattern != LoopingSequential)) {
+        this->accessPattern = accessPattern;
+    }
+    this->straightSequentialDeclared = (this->accessPattern == StraightSequential);
+    pthread_mutex_unlock(&accessPatternMutex);
+}
+
+void LocalitySet::recordPageAccess(FilePartitionID partitionId, unsigned int pageSeqInPartition) {
+    pthread_mutex_lock(&accessPatternMutex);
+    auto access = partitionAccesses.find(partitionId);
+    if (access == partitionAccesses.end()) {
+        partitionAccesses[partitionId] = make_pair(pageSeqInPartition, 1);
+    } else if (pageSeqInPartition == access->second.first + 1) {
+        access->second.first = pageSeqInPartition;
+        access->second.second++;
+        if ((access->second.second >= SEQUENTIAL_ACCESS_THRESHOLD) &&
+            (this->accessPattern == SmallSequential)) {
+            this->accessPattern = StraightSequential;
+        }
+    } else {
+        // the partition is scanned again from the beginning after a sequential scan
+        if ((pageSeqInPartition == 0) && (this->accessPattern != SmallSequential)) {
+            this->accessPattern = LoopingSequential;
+        }
+        access->second.first = pageSeqInPartition;
+        access->second.second = 1;
+    }
+    pthread_mutex_unlock(&accessPatternMutex);
+}
+
+bool LocalitySet::isSequential() {
+    pthread_mutex_lock(&accessPatternMutex);
+    bool sequential = (this->accessPattern != SmallSequential);
+    pthread_mutex_unlock(&accessPatternMutex);
+    return sequential;
+}
+
+bool LocalitySet::isDroppedAfterRead() {
+    pthread_mutex_lock(&accessPatternMutex);
+    bool dropped = this->straightSequentialDeclared && (this->accessPattern == StraightSequential);
+    pthread_mutex_unlock(&accessPatternMutex);
+    return dropped && (this->replacementPolicy == MRU);
+}
+
 
 LocalityType LocalitySet::getLocalityType() {
     return this->localityType;
@@ -169,6 +238,19 @@ void LocalitySet::setOperationType(OperationType type) {
     this->operationType = type;
 }
 
+AccessPattern LocalitySet::getAccessPattern() {
+    pthread_mutex_lock(&accessPatternMutex);
+    AccessPattern pattern = this->accessPattern;
+    pthread_mutex_unlock(&accessPatternMutex);
+    return pattern;
+}
+
+void LocalitySet::setAccessPattern(AccessPattern pattern) {
+    pthread_mutex_lock(&accessPatternMutex);
+    this->accessPattern = pattern;
+    pthread_mutex_unlock(&accessPatternMutex);
+}
+
 
 DurabilityType LocalitySet::getDurabilityType() {
     return this->durabilityType;
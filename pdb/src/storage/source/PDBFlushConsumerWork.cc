@@ -85,28 +85,25 @@ void PDBFlushConsumerWork::execute(PDBBuzzerPtr callerBuzzer) {
                 PDB_COUT << "page with PageID " << page->getPageID()
                          << " appended to partition with PartitionID " << this->partitionId << "\n";
             }
+            // remove the page from cache first, and only free the page if nobody pinned it in
+            // the meantime, because the cache lookups do not take the flush lock
+            bool removed = false;
+            if (page->isInEviction() == true) {
 #ifndef UNPIN_FOR_NON_ZERO_REF_COUNT
-            if ((page->getRawBytes() != nullptr) && (page->getRefCount() == 0) &&
-                (page->isInEviction() == true)) {
+                removed = this->server->getCache()->removePageIfUnpinned(key);
 #else
-            if ((page->getRawBytes() != nullptr) && (page->isInEviction() == true)) {
+                removed = this->server->getCache()->removePage(key);
 #endif
-
-                // remove the page from cache!
-                PDB_COUT << "to free the page!\n";
-                this->server->getSharedMem()->free(page->getRawBytes() - page->getInternalOffset(),
-                                                   page->getSize() + 512);
-                PDB_COUT << "internalOffset=" << page->getInternalOffset() << "\n";
-                page->setOffset(0);
-                page->setRawBytes(nullptr);
             }
-// remove the page from cache!
-#ifndef UNPIN_FOR_NON_ZERO_REF_COUNT
-            if ((page->getRefCount() == 0) && (page->isInEviction() == true)) {
-#else
-            if (page->isInEviction() == true) {
-#endif
-                this->server->getCache()->removePage(key);
+            if (removed == true) {
+                if (page->getRawBytes() != nullptr) {
+                    PDB_COUT << "to free the page!\n";
+                    this->server->getSharedMem()->free(
+                        page->getRawBytes() - page->getInternalOffset(), page->getRawSize() + 512);
+                    PDB_COUT << "internalOffset=" << page->getInternalOffset() << "\n";
+                    page->setOffset(0);
+                    page->setRawBytes(nullptr);
+                }
             } else {
                 page->setInFlush(false);
                 page->setDirty(false);
@@ -45,8 +45,7 @@ PDBPage::PDBPage(char* dataIn,
     this->numObjects = numObjectsIn;
     this->curAppendOffset = sizeof(NodeID) + sizeof(DatabaseID) + sizeof(UserTypeID) +
         sizeof(SetID) + sizeof(PageID) + sizeof(int) + sizeof(size_t);
-    this->refCount = 0;
-    this->pinned = true;
+    this->pinState = PIN_STATE_PINNED;
     this->dirty = false;
     this->inFlush = false;
     this->partitionId = (FilePartitionID)(-1);
@@ -83,8 +82,7 @@ PDBPage::PDBPage(char* dataIn, size_t offset, int internalOffset) {
     this->numObjects = *((int*)cur);
     cur = cur + sizeof(int);
     this->size = *((size_t*)cur);
-    this->refCount = 0;
-    this->pinned = true;
+    this->pinState = PIN_STATE_PINNED;
     this->dirty = false;
     this->inFlush = false;
     this->partitionId = (FilePartitionID)(-1);
@@ -39,10 +39,14 @@ using namespace std;
 #define MAX_RETRIES 5
 #endif
 
-PDBScanWork::PDBScanWork(PageIteratorPtr iter, pdb::PangeaStorageServer* storage, int& counter)
+PDBScanWork::PDBScanWork(PageIteratorPtr iter,
+                         pdb::PangeaStorageServer* storage,
+                         int& counter,
+                         PageDescriptorRing* scanRing)
     : counter(counter) {
     this->iter = iter;
     this->storage = storage;
+    this->scanRing = scanRing;
     pthread_mutex_init(&connection_mutex, nullptr);
 }
 
@@ -106,10 +110,43 @@ bool PDBScanWork::acceptPagePinnedAck(pdb::PDBCommunicatorPtr myCommunicator,
 }
 
 
+void PDBScanWork::pushPagesToRing(PageDescriptorRing* ring) {
+    PageDescriptor descriptor;
+    descriptor.type = PagePinnedDescriptor;
+    descriptor.wasDirty = false;
+    size_t ticket;
+    while (this->iter->hasNext()) {
+        PDBPagePtr page = this->iter->next();
+        if (page == nullptr) {
+            continue;
+        }
+        descriptor.nodeId = page->getNodeID();
+        descriptor.dbId = page->getDbID();
+        descriptor.typeId = page->getTypeID();
+        descriptor.setId = page->getSetID();
+        descriptor.pageId = page->getPageID();
+        descriptor.pageSize = page->getSize();
+        descriptor.offset = page->getOffset();
+        // blocks while the backend is behind
+        if (ring->push(descriptor, ticket) == false) {
+            std::cout << "PDBScanWork: the page ring is closed" << std::endl;
+            return;
+        }
+    }
+}
+
 // do the actual work
 void PDBScanWork::execute(PDBBuzzerPtr callerBuzzer) {
     pdb::PDBLoggerPtr logger = make_shared<pdb::PDBLogger>("pdbScanWorks.log");
     logger->debug("PDBScanWork: running...");
+
+    // the backend takes the pages from the scan ring, we don't need a connection
+    if (this->scanRing != nullptr) {
+        this->pushPagesToRing(this->scanRing);
+        PDB_COUT << "PDBScanWork finished.\n";
+        callerBuzzer->buzz(PDBAlarm::WorkAllDone, this->counter);
+        return;
+    }
     PDBPagePtr page;
     string errMsg, info;
     bool wasError;
@@ -0,0 +1,56 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#include "PDBDebug.h"
+#include "PDBUnpinConsumerWork.h"
+
+PDBUnpinConsumerWork::PDBUnpinConsumerWork(PageDescriptorRing* ring,
+                                           pdb::PangeaStorageServer* server) {
+    this->ring = ring;
+    this->server = server;
+    this->isStopped = false;
+}
+
+void PDBUnpinConsumerWork::stop() {
+    this->isStopped = true;
+    this->ring->close();
+}
+
+
+void PDBUnpinConsumerWork::execute(PDBBuzzerPtr callerBuzzer) {
+    PageDescriptor descriptor;
+    size_t ticket;
+    while ((!isStopped) && (this->ring->pop(descriptor, ticket) == true)) {
+        int numUnpinned = 0;
+        do {
+            if (descriptor.type == PageUnpinnedDescriptor) {
+                if (this->server->unpinPage(descriptor.dbId,
+                                            descriptor.typeId,
+                                            descriptor.setId,
+                                            descriptor.pageId) == false) {
+                    std::cout << "Fatal Error: Page doesn't exist for unpinning page." << std::endl;
+                }
+            }
+            numUnpinned++;
+        } while ((numUnpinned < PAGE_UNPIN_BATCH_SIZE) &&
+                 (this->ring->tryPop(descriptor, ticket) == true));
+        // there is only one consumer, so completing the last ticket of the batch completes the
+        // ones before it, and a backend waiting for its pages to be unpinned is woken up once
+        this->ring->complete(ticket);
+    }
+    PDB_COUT << "unpinning thread stopped running\n";
+}
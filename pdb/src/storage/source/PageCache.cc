@@ -23,6 +23,7 @@
 #include "PageCache.h"
 #include "PDBEvictWork.h"
 
+#include <algorithm>
 #include <queue>
 #include <stdlib.h>
 #include <sched.h>
@@ -39,15 +40,18 @@ PageCache::PageCache(ConfigurationPtr conf,
                      pdb::PDBLoggerPtr logger,
                      SharedMemPtr shm,
                      CacheStrategy strategy) {
-    this->cache = new unordered_map<CacheKey, PDBPagePtr, CacheKeyHash, CacheKeyEqual>();
+    for (int i = 0; i < PAGE_CACHE_NUM_SHARDS; i++) {
+        this->shards.push_back(new PageCacheShard());
+    }
     this->conf = conf;
     this->workers = workers;
-    pthread_mutex_init(&this->countLock, nullptr);
-    pthread_mutex_init(&this->cacheMutex, nullptr);
     pthread_mutex_init(&this->evictionMutex, nullptr);
+    pthread_mutex_init(&this->ioEngineMutex, nullptr);
+    this->ioEngine = nullptr;
     pthread_rwlock_init(&this->evictionAndFlushLock, nullptr);
     this->accessCount = 0;
     this->inEviction = false;
+    this->nextShardToEvict = 0;
     this->maxSize = conf->getShmSize();
     this->size = 0;
     this->warnSize = (this->maxSize) * WARN_THRESHOLD;
@@ -71,7 +75,18 @@ PageCache::PageCache(ConfigurationPtr conf,
     this->flushBuffer = flushBuffer;
     this->logger = logger;
     this->shm = shm;
+    this->numNodes = 1;
+    for (int i = 0; i < shm->getNumArenas(); i++) {
+        this->numNodes = std::max(this->numNodes, shm->getArena(i).node + 1);
+    }
+    this->cachedBytesPerNode = new std::atomic<size_t>[this->numNodes];
+    for (int node = 0; node < this->numNodes; node++) {
+        this->cachedBytesPerNode[node] = 0;
+    }
     this->strategy = strategy;
+    if (strategy == UnifiedTwoQueue) {
+        this->twoQueueReplacer = make_shared<TwoQueueReplacer>(this->maxSize, conf->getPageSize());
+    }
     this->priorityList = new vector<list<LocalitySetPtr>*>();
     int i;
     for (i = 0; i < 6; i++) {
@@ -85,13 +100,92 @@ PageCache::PageCache(ConfigurationPtr conf,
 }
 
 PageCache::~PageCache() {
-    delete this->cache;
-    pthread_mutex_destroy(&this->countLock);
-    pthread_mutex_destroy(&this->cacheMutex);
+    for (PageCacheShard* shard : this->shards) {
+        delete shard;
+    }
+    delete[] this->cachedBytesPerNode;
     pthread_mutex_destroy(&this->evictionMutex);
+    pthread_mutex_destroy(&this->ioEngineMutex);
     pthread_rwlock_destroy(&this->evictionAndFlushLock);
 }
 
+SharedPageIOEnginePtr PageCache::getIOEngine() {
+    pthread_mutex_lock(&this->ioEngineMutex);
+    if (this->ioEngine == nullptr) {
+        this->ioEngine = createSharedPageIOEngine(PAGE_CACHE_IO_QUEUE_DEPTH);
+        this->logger->info(std::string("PageCache: loading pages through ") +
+                           this->ioEngine->getName());
+    }
+    SharedPageIOEnginePtr engine = this->ioEngine;
+    pthread_mutex_unlock(&this->ioEngineMutex);
+    return engine;
+}
+
+void PageCache::countPageBytes(PageCacheShard* shard, PDBPagePtr page, bool added) {
+    size_t pageSizeAllocated = page->getRawSize() + 512;
+    int node = 0;
+    if ((this->numNodes > 1) && (page->getRawBytes() != nullptr)) {
+        node = this->shm->getNodeOfAddress(page->getRawBytes());
+    }
+    if (added == true) {
+        shard->size += pageSizeAllocated;
+        this->size += pageSizeAllocated;
+        this->cachedBytesPerNode[node] += pageSizeAllocated;
+    } else {
+        shard->size -= pageSizeAllocated;
+        this->size -= pageSizeAllocated;
+        this->cachedBytesPerNode[node] -= pageSizeAllocated;
+    }
+}
+
+PageCacheShard* PageCache::getShard(CacheKey key) {
+    return this->shards[CacheKeyHash()(key) % this->shards.size()];
+}
+
+void PageCache::updateAccessSequenceId(PDBPagePtr page) {
+    page->setAccessSequenceId(this->accessCount.fetch_add(1));
+}
+
+// Look up a page and pin it under the read lock of its shard, so that a concurrent eviction,
+// which removes the page under the write lock, either sees the pin or removes the page before we
+// find it.
+PDBPagePtr PageCache::pinCachedPage(CacheKey key) {
+    PageCacheShard* shard = this->getShard(key);
+    PDBPagePtr page = nullptr;
+    pthread_rwlock_rdlock(&shard->lock);
+    auto iter = shard->pages.find(key);
+    if (iter != shard->pages.end()) {
+        page = iter->second;
+        if (page != nullptr) {
+            page->incRefCount();
+        }
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    if (page != nullptr) {
+        shard->numHits++;
+        if (this->twoQueueReplacer != nullptr) {
+            this->twoQueueReplacer->accessPage(key);
+        }
+    } else {
+        shard->numMisses++;
+    }
+    return page;
+}
+
+CacheStats PageCache::getStats() {
+    CacheStats stats;
+    for (PageCacheShard* shard : this->shards) {
+        stats.numHits += shard->numHits;
+        stats.numMisses += shard->numMisses;
+        stats.numEvicted += shard->numEvicted;
+        stats.numCached += shard->numCached;
+    }
+    for (int node = 0; node < this->numNodes; node++) {
+        stats.cachedBytesPerNode.push_back(this->cachedBytesPerNode[node]);
+    }
+    return stats;
+}
+
 // Cache the page with specified name and buffer;
 void PageCache::cachePage(PDBPagePtr page, LocalitySet* set) {
     if (page == nullptr) {
@@ -102,21 +196,28 @@ void PageCache::cachePage(PDBPagePtr page, LocalitySet* set) {
     key.typeId = page->getTypeID();
     key.setId = page->getSetID();
     key.pageId = page->getPageID();
-    pthread_mutex_lock(&this->cacheMutex);
-    if (this->cache->find(key) == this->cache->end()) {
+    PageCacheShard* shard = this->getShard(key);
+    pthread_rwlock_wrlock(&shard->lock);
+    if (shard->pages.find(key) == shard->pages.end()) {
         pair<CacheKey, PDBPagePtr> pair = make_pair(key, page);
-        this->cache->insert(pair);
-        this->size += page->getRawSize() + 512;
+        shard->pages.insert(pair);
+        this->countPageBytes(shard, page, true);
+        shard->numCached++;
+        if (this->twoQueueReplacer != nullptr) {
+            this->twoQueueReplacer->addPage(key, page);
+        }
     } else {
         logger->writeLn("LRUPageCache: page was there already.");
     }
-    pthread_mutex_unlock(&this->cacheMutex);
+    pthread_rwlock_unlock(&shard->lock);
     if (set != nullptr) {
         set->addCachedPage(page);
     }
 }
 
 // If there is sufficient room in shared memory, allocate the buffer as required
+// In NUMA mode the buffer comes from the arena of the node we run on, or from another arena if that
+// one is full.
 // Otherwise, try to evict a page from shared memory.
 // It will block until data can be allocated.
 char* PageCache::allocateBufferFromSharedMemoryBlocking(size_t size, int& alignOffset) {
@@ -286,16 +387,40 @@ PDBPagePtr PageCache::loadPage(SequenceFilePtr file, PageID pageId) {
 
 // Remove page specified by Key from cache hashMap.
 // This function will be used by the flushConsumer thread.
-bool PageCache::removePage(CacheKey key) {
-    pthread_mutex_lock(&this->cacheMutex);
-    if (this->containsPage(key) == false) {
-        pthread_mutex_unlock(&this->cacheMutex);
+bool PageCache::removePage(CacheKey key, bool evicted) {
+    PageCacheShard* shard = this->getShard(key);
+    pthread_rwlock_wrlock(&shard->lock);
+    auto iter = shard->pages.find(key);
+    if (iter == shard->pages.end()) {
+        pthread_rwlock_unlock(&shard->lock);
         return false;
     }
-    size_t pageSizeAllocated = this->cache->at(key)->getRawSize() + 512;
-    this->cache->erase(key);
-    this->size -= pageSizeAllocated;
-    pthread_mutex_unlock(&this->cacheMutex);
+    this->countPageBytes(shard, iter->second, false);
+    shard->pages.erase(iter);
+    pthread_rwlock_unlock(&shard->lock);
+    if (this->twoQueueReplacer != nullptr) {
+        this->twoQueueReplacer->removePage(key, evicted);
+    }
+    return true;
+}
+
+// Remove page specified by Key from cache hashMap if its reference count is zero.
+// Because pins are taken under the read lock of the shard, nobody can pin the page after we
+// removed it, so the caller can free its memory.
+bool PageCache::removePageIfUnpinned(CacheKey key, bool evicted) {
+    PageCacheShard* shard = this->getShard(key);
+    pthread_rwlock_wrlock(&shard->lock);
+    auto iter = shard->pages.find(key);
+    if ((iter == shard->pages.end()) || (iter->second->getRefCount() > 0)) {
+        pthread_rwlock_unlock(&shard->lock);
+        return false;
+    }
+    this->countPageBytes(shard, iter->second, false);
+    shard->pages.erase(iter);
+    pthread_rwlock_unlock(&shard->lock);
+    if (this->twoQueueReplacer != nullptr) {
+        this->twoQueueReplacer->removePage(key, evicted);
+    }
     return true;
 }
 
@@ -308,15 +433,9 @@ bool PageCache::freePage(PDBPagePtr curPage) {
     key.setId = curPage->getSetID();
     key.pageId = curPage->getPageID();
 
-    pthread_mutex_lock(&this->cacheMutex);
-    if (this->containsPage(key) == false) {
-        pthread_mutex_unlock(&this->cacheMutex);
+    if (this->removePage(key, false) == false) {
         return false;
     }
-    size_t pageSizeAllocated = this->cache->at(key)->getRawSize() + 512;
-    cache->erase(key);
-    this->size -= pageSizeAllocated;
-    pthread_mutex_unlock(&this->cacheMutex);
     this->shm->free(curPage->getRawBytes() - curPage->getInternalOffset(),
                     curPage->getRawSize() + 512);
     curPage->setOffset(0);
@@ -338,7 +457,16 @@ PDBPagePtr PageCache::getPage(PartitionedFilePtr file,
     key.typeId = file->getTypeId();
     key.setId = file->getSetId();
     key.pageId = pageId;
-    PDBPagePtr page;
+
+    // the hit path only takes the read lock of one shard
+    PDBPagePtr page = this->pinCachedPage(key);
+    if (page != nullptr) {
+        this->updateAccessSequenceId(page);
+        if (set != nullptr) {
+            set->updateCachedPage(page);
+        }
+        return page;
+    }
 
     if ((partitionId == (unsigned int)(-1)) || (pageSeqInPartition == (unsigned int)(-1))) {
         PageIndex pageIndex = file->getMetaData()->getPageIndex(pageId);
@@ -347,51 +475,15 @@ PDBPagePtr PageCache::getPage(PartitionedFilePtr file,
     }
     // Assumption: At one time, for a page, only one thread will try to load it.
     // Above assumption is guaranteed by the front-end scan model.
-    pthread_mutex_lock(&this->evictionMutex);
-    this->evictionLock();
-    pthread_mutex_lock(&this->cacheMutex);
-    if (this->containsPage(key) != true) {
-        pthread_mutex_unlock(&this->cacheMutex);
-        this->evictionUnlock();
-        pthread_mutex_unlock(&this->evictionMutex);
-        page = this->loadPage(file, partitionId, pageSeqInPartition, sequential);
-        if (page == nullptr) {
-            return nullptr;
-        }
-        pthread_mutex_lock(&this->countLock);
-        page->setAccessSequenceId(this->accessCount);
-        this->accessCount++;
-        pthread_mutex_unlock(&this->countLock);
-
-        pthread_mutex_lock(&this->evictionMutex);
-        this->cachePage(page, set);
-        page->setPinned(true);
-        page->setDirty(false);
-        page->incRefCount();
-        pthread_mutex_unlock(&this->evictionMutex);
-    } else {
-        page = this->cache->at(key);
-        pthread_mutex_unlock(&this->cacheMutex);
-        if (page == nullptr) {
-            std::cout << "WARNING: PartitionPageIterator get nullptr in cache.\n" << std::endl;
-            logger->warn("PartitionPageIterator get nullptr in cache.");
-            this->evictionUnlock();
-            pthread_mutex_unlock(&this->evictionMutex);
-            return nullptr;
-        }
-        page->setPinned(true);
-        page->incRefCount();
-        this->evictionUnlock();
-        pthread_mutex_unlock(&this->evictionMutex);
-        pthread_mutex_lock(&this->countLock);
-        page->setAccessSequenceId(this->accessCount);
-        this->accessCount++;
-        pthread_mutex_unlock(&this->countLock);
-        if (set != nullptr) {
-            set->updateCachedPage(page);
-        }
+    page = this->loadPage(file, partitionId, pageSeqInPartition, sequential);
+    if (page == nullptr) {
+        return nullptr;
     }
-
+    this->updateAccessSequenceId(page);
+    // pin the page before it becomes visible to the eviction
+    page->setDirty(false);
+    page->incRefCount();
+    this->cachePage(page, set);
     return page;
 }
 
@@ -405,30 +497,81 @@ PDBPagePtr PageCache::getPage(SequenceFilePtr file, PageID pageId) {
 // Below method will cause reference count ++;
 // It will only be used in SetCachePageIterator class to get dirty pages, and will be guarded there
 PDBPagePtr PageCache::getPage(CacheKey key, LocalitySet* set) {
-    pthread_mutex_lock(&this->cacheMutex);
-    if (this->containsPage(key) != true) {
-        pthread_mutex_unlock(&this->cacheMutex);
+    PDBPagePtr page = this->pinCachedPage(key);
+    if (page == nullptr) {
         std::cout << "WARNING: SetCachePageIterator get nullptr in cache.\n" << std::endl;
         logger->warn("SetCachePageIterator get nullptr in cache.");
         return nullptr;
-    } else {
-        PDBPagePtr page = this->cache->at(key);
-        pthread_mutex_unlock(&this->cacheMutex);
-        if (page == nullptr) {
-            std::cout << "WARNING: SetCachePageIterator get nullptr in cache.\n" << std::endl;
-            logger->warn("SetCachePageIterator get nullptr in cache.");
-            return nullptr;
-        }
-        page->incRefCount();
-        pthread_mutex_lock(&this->countLock);
-        page->setAccessSequenceId(this->accessCount);
-        this->accessCount++;
-        pthread_mutex_unlock(&this->countLock);
-        if (set != nullptr) {
-            set->updateCachedPage(page);
-        }
-        return page;
     }
+    this->updateAccessSequenceId(page);
+    if (set != nullptr) {
+        set->updateCachedPage(page);
+    }
+    return page;
+}
+
+PDBPagePtr PageCache::getPageIfCached(CacheKey key, LocalitySet* set) {
+    PDBPagePtr page = this->pinCachedPage(key);
+    if (page == nullptr) {
+        return nullptr;
+    }
+    this->updateAccessSequenceId(page);
+    if (set != nullptr) {
+        set->updateCachedPage(page);
+    }
+    return page;
+}
+
+PDBPagePtr PageCache::cacheLoadedPage(PartitionedFilePtr file,
+                                      FilePartitionID partitionId,
+                                      unsigned int pageSeqInPartition,
+                                      char* pageData,
+                                      int internalOffset,
+                                      size_t pageSize,
+                                      LocalitySet* set) {
+    PDBPagePtr page = this->buildPageFromSharedMemoryData(
+        file, pageData, partitionId, pageSeqInPartition, internalOffset, pageSize);
+    if (page == nullptr) {
+        return nullptr;
+    }
+    CacheKey key;
+    key.dbId = page->getDbID();
+    key.typeId = page->getTypeID();
+    key.setId = page->getSetID();
+    key.pageId = page->getPageID();
+
+    // pin the page before it becomes visible to the eviction
+    this->updateAccessSequenceId(page);
+    page->setDirty(false);
+    page->incRefCount();
+
+    PageCacheShard* shard = this->getShard(key);
+    pthread_rwlock_wrlock(&shard->lock);
+    auto iter = shard->pages.find(key);
+    if (iter != shard->pages.end()) {
+        // somebody loaded the page while our read was in flight, we use their copy
+        PDBPagePtr cachedPage = iter->second;
+        cachedPage->incRefCount();
+        pthread_rwlock_unlock(&shard->lock);
+        this->freeBuffer(pageData, internalOffset, pageSize);
+        page->setRawBytes(nullptr);
+        return cachedPage;
+    }
+    shard->pages.insert(make_pair(key, page));
+    this->countPageBytes(shard, page, true);
+    shard->numCached++;
+    if (this->twoQueueReplacer != nullptr) {
+        this->twoQueueReplacer->addPage(key, page);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    if (set != nullptr) {
+        set->addCachedPage(page);
+    }
+    return page;
+}
+
+void PageCache::freeBuffer(char* data, int internalOffset, size_t size) {
+    this->shm->free(data - internalOffset, size + 512);
 }
 
 PDBPagePtr PageCache::getNewPageNonBlocking(NodeID nodeId,
@@ -455,16 +598,10 @@ PDBPagePtr PageCache::getNewPageNonBlocking(NodeID nodeId,
                                            shm->computeOffset(pageData),
                                            internalOffset);
 
-    pthread_mutex_lock(&this->countLock);
-    page->setAccessSequenceId(this->accessCount);
-    this->accessCount++;
-    pthread_mutex_unlock(&this->countLock);
-    page->setPinned(true);
+    this->updateAccessSequenceId(page);
     page->setDirty(true);
-    pthread_mutex_lock(&evictionMutex);
-    this->cachePage(page, set);
     page->incRefCount();
-    pthread_mutex_unlock(&evictionMutex);
+    this->cachePage(page, set);
     return page;
 }
 
@@ -472,12 +609,9 @@ PDBPagePtr PageCache::getNewPageNonBlocking(NodeID nodeId,
 // Assumption: for a new pageId, at one time, only one thread will try to allocate a new page for it
 // To allocate a new page, set it as pinned&dirty, add it to cache, and increment reference count
 PDBPagePtr PageCache::getNewPage(NodeID nodeId, CacheKey key, LocalitySet* set, size_t pageSize) {
-    pthread_mutex_lock(&evictionMutex);
     if (this->containsPage(key) == true) {
-        pthread_mutex_unlock(&evictionMutex);
         return nullptr;
     }
-    pthread_mutex_unlock(&evictionMutex);
     int internalOffset = 0;
     char* pageData;
     pageData = allocateBufferFromSharedMemoryBlocking(pageSize, internalOffset);
@@ -498,33 +632,34 @@ PDBPagePtr PageCache::getNewPage(NodeID nodeId, CacheKey key, LocalitySet* set,
                                            shm->computeOffset(pageData),
                                            internalOffset);
 
-    pthread_mutex_lock(&this->countLock);
-    page->setAccessSequenceId(this->accessCount);
-    this->accessCount++;
-    pthread_mutex_unlock(&this->countLock);
-    page->setPinned(true);
+    this->updateAccessSequenceId(page);
     page->setDirty(true);
-    pthread_mutex_lock(&evictionMutex);
-    this->cachePage(page, set);
     page->incRefCount();
-    pthread_mutex_unlock(&evictionMutex);
+    this->cachePage(page, set);
     return page;
 }
 
 // please note that only below method will cause cached page reference count --
 
 bool PageCache::decPageRefCount(CacheKey key) {
-    if (this->containsPage(key) == false) {
+    PageCacheShard* shard = this->getShard(key);
+    pthread_rwlock_rdlock(&shard->lock);
+    auto iter = shard->pages.find(key);
+    if (iter == shard->pages.end()) {
+        pthread_rwlock_unlock(&shard->lock);
         return false;
-    } else {
-        PDBPagePtr page = this->cache->at(key);
-        page->decRefCount();
-        return true;
     }
+    iter->second->decRefCount();
+    pthread_rwlock_unlock(&shard->lock);
+    return true;
 }
 
 bool PageCache::containsPage(CacheKey key) {
-    return (this->cache->find(key) != this->cache->end());
+    PageCacheShard* shard = this->getShard(key);
+    pthread_rwlock_rdlock(&shard->lock);
+    bool ret = (shard->pages.find(key) != shard->pages.end());
+    pthread_rwlock_unlock(&shard->lock);
+    return ret;
 }
 
 
@@ -540,25 +675,24 @@ int PageCache::unpinAndEvictAllDirtyPages() {
     this->inEviction = true;
     int numEvicted = 0;
     PDBPagePtr page;
-    unordered_map<CacheKey, PDBPagePtr, CacheKeyHash, CacheKeyEqual>::iterator cacheIter;
     vector<PDBPagePtr>* evictableDirtyPages = new vector<PDBPagePtr>();
-    this->evictionLock();
-    for (cacheIter = this->cache->begin(); cacheIter != this->cache->end(); cacheIter++) {
-        page = cacheIter->second;
-        if (page == nullptr) {
-            this->inEviction = false;
-            pthread_mutex_unlock(&this->evictionMutex);
-            return 0;
-        } else if ((page->isDirty() == true) && (page->isInFlush() == false)) {
-            while (page->getRefCount() > 0) {
-                page->decRefCount();
+    for (PageCacheShard* shard : this->shards) {
+        pthread_rwlock_rdlock(&shard->lock);
+        for (auto cacheIter = shard->pages.begin(); cacheIter != shard->pages.end(); cacheIter++) {
+            page = cacheIter->second;
+            if (page == nullptr) {
+                continue;
+            } else if ((page->isDirty() == true) && (page->isInFlush() == false)) {
+                while (page->getRefCount() > 0) {
+                    page->decRefCount();
+                }
+                evictableDirtyPages->push_back(page);
+            } else {
+                // do nothing
             }
-            evictableDirtyPages->push_back(page);
-        } else {
-            // do nothing
         }
+        pthread_rwlock_unlock(&shard->lock);
     }
-    this->evictionUnlock();
     int i;
     for (i = 0; i < evictableDirtyPages->size(); i++) {
         page = evictableDirtyPages->at(i);
@@ -585,23 +719,22 @@ int PageCache::evictAllDirtyPages() {
     this->inEviction = true;
     int numEvicted = 0;
     PDBPagePtr page;
-    unordered_map<CacheKey, PDBPagePtr, CacheKeyHash, CacheKeyEqual>::iterator cacheIter;
     vector<PDBPagePtr>* evictableDirtyPages = new vector<PDBPagePtr>();
-    this->evictionLock();
-    for (cacheIter = this->cache->begin(); cacheIter != this->cache->end(); cacheIter++) {
-        page = cacheIter->second;
-        if (page == nullptr) {
-            this->inEviction = false;
-            pthread_mutex_unlock(&this->evictionMutex);
-            return 0;
-        } else if ((page->isDirty() == true) && (page->getRefCount() == 0) &&
-                   (page->isInFlush() == false)) {
-            evictableDirtyPages->push_back(page);
-        } else {
-            // do nothing
+    for (PageCacheShard* shard : this->shards) {
+        pthread_rwlock_rdlock(&shard->lock);
+        for (auto cacheIter = shard->pages.begin(); cacheIter != shard->pages.end(); cacheIter++) {
+            page = cacheIter->second;
+            if (page == nullptr) {
+                continue;
+            } else if ((page->isDirty() == true) && (page->getRefCount() == 0) &&
+                       (page->isInFlush() == false)) {
+                evictableDirtyPages->push_back(page);
+            } else {
+                // do nothing
+            }
         }
+        pthread_rwlock_unlock(&shard->lock);
     }
-    this->evictionUnlock();
     int i;
     for (i = 0; i < evictableDirtyPages->size(); i++) {
         page = evictableDirtyPages->at(i);
@@ -619,92 +752,126 @@ int PageCache::evictAllDirtyPages() {
 
 // Flush a page.
 bool PageCache::flushPageWithoutEviction(CacheKey key) {
-    if (this->containsPage(key) == true) {
-        PDBPagePtr page = this->cache->at(key);
-        if ((page->isDirty() == true) && (page->isInFlush() == false)) {
-            page->setInFlush(true);
-            page->setInEviction(false);
-            this->flushBuffer->addPageToTail(page);
-        } else {
-            // can't flush
-            return false;
-        }
-    } else {
+    PageCacheShard* shard = this->getShard(key);
+    pthread_rwlock_rdlock(&shard->lock);
+    auto iter = shard->pages.find(key);
+    if (iter == shard->pages.end()) {
+        pthread_rwlock_unlock(&shard->lock);
         // can't find page
         return false;
     }
+    PDBPagePtr page = iter->second;
+    pthread_rwlock_unlock(&shard->lock);
+    if ((page->isDirty() == true) && (page->isInFlush() == false)) {
+        page->setInFlush(true);
+        page->setInEviction(false);
+        this->flushBuffer->addPageToTail(page);
+    } else {
+        // can't flush
+        return false;
+    }
     return true;
 }
 
 
 // Evict a page
 
-bool PageCache::evictPage(CacheKey key, bool tryFlushOrNot) {
-    if (this->containsPage(key) == true) {
-        PDBPagePtr page = this->cache->at(key);
+bool PageCache::evictPage(CacheKey key, bool tryFlushOrNot, bool evicted) {
+    PageCacheShard* shard = this->getShard(key);
+    pthread_rwlock_rdlock(&shard->lock);
+    auto iter = shard->pages.find(key);
+    if (iter == shard->pages.end()) {
+        pthread_rwlock_unlock(&shard->lock);
+        PDB_COUT << "can not find page in cache!\n";
+        this->logger->writeLn("LRUPageCache: can not evict page because it is not in cache");
+        return false;
+    }
+    PDBPagePtr page = iter->second;
+    pthread_rwlock_unlock(&shard->lock);
+
 #ifndef UNPIN_FOR_NON_ZERO_REF_COUNT
-        if (page->getRefCount() > 0) {
-            cout << "can't be unpinned due to non-zero reference count " << page->getRefCount()
-                 << "with DatabaseID=" << page->getDbID() << ", TypeID=" << page->getTypeID()
-                 << ", SetID=" << page->getSetID() << ", PageID=" << page->getPageID() << "\n";
-            this->logger->writeLn(
-                "LRUPageCache: can not evict page because it has been pinned by at least one "
-                "client");
-            this->logger->writeInt(page->getPageID());
-            return false;
-        } else
+    if (page->getRefCount() > 0) {
+        cout << "can't be unpinned due to non-zero reference count " << page->getRefCount()
+             << "with DatabaseID=" << page->getDbID() << ", TypeID=" << page->getTypeID()
+             << ", SetID=" << page->getSetID() << ", PageID=" << page->getPageID() << "\n";
+        this->logger->writeLn(
+            "LRUPageCache: can not evict page because it has been pinned by at least one "
+            "client");
+        this->logger->writeInt(page->getPageID());
+        return false;
+    }
 #endif
-        {
 
-            page->setPinned(false);
-            if ((tryFlushOrNot == true) && (page->isDirty() == true) &&
-                (page->isInFlush() == false) &&
-                ((page->getDbID() != 0) || (page->getTypeID() != 1)) &&
-                ((page->getDbID() != 0) || (page->getTypeID() != 2))) {
+    if ((tryFlushOrNot == true) && (page->isDirty() == true) && (page->isInFlush() == false) &&
+        ((page->getDbID() != 0) || (page->getTypeID() != 1)) &&
+        ((page->getDbID() != 0) || (page->getTypeID() != 2))) {
 #ifdef PROFILING_CACHE
-                std::cout << "going to unpin a dirty page...\n";
+        std::cout << "going to unpin a dirty page...\n";
 #endif
-                // update counter
-                page->setInFlush(true);
-                page->setInEviction(true);
-                // flush the page
-                // first we release the lock so that the flushing thread can run.
-                this->flushBuffer->addPageToTail(page);
-
-            } else if (page->isInFlush() == false) {
+        page->setPinned(false);
+        // update counter
+        page->setInFlush(true);
+        page->setInEviction(true);
+        // flush the page
+        this->flushBuffer->addPageToTail(page);
+        shard->numEvicted++;
+
+    } else if (page->isInFlush() == false) {
 #ifdef PROFILING_CACHE
-                std::cout << "going to unpin a clean page...\n";
+        std::cout << "going to unpin a clean page...\n";
 #endif
-                // free the page
-                // We use flush lock (which is a read write lock) to synchronize with getPage() that
-                // will be invoked in PartitionPageIterator;
-                // One scenario is: PDB load old data from disk to memory through iterators while
-                // application pins new pages that requires to evict data, then an old page in
-                // checking for loading may get evicted before it is pinned.
-                // Add flush lock is to guard for similar scenarios.
-                this->flushLock();
-                this->shm->free(page->getRawBytes() - page->getInternalOffset(),
-                                page->getRawSize() + 512);
-
-                page->setOffset(0);
-                page->setRawBytes(nullptr);
-                removePage(key);
-                this->flushUnlock();
-            }
-#ifdef PROFILING_CACHE
-            std::cout << "Storage server: evicting page from cache for dbId:" << page->getDbID()
-                      << ", typeID:" << page->getTypeID() << ", setID=" << page->getSetID()
-                      << ", pageID: " << page->getPageID() << ", tryFlushing=" << tryFlushOrNot
-                      << ".\n";
+        // free the page
+        // We use flush lock (which is a read write lock) to synchronize with SetCachePageIterator,
+        // that takes the eviction lock while it iterates the dirty pages of a set.
+        // The page is removed from its shard before its memory is freed, and the removal fails if
+        // somebody pinned the page in the meantime, so that a concurrent getPage() either pins the
+        // page before we remove it, or does not find it at all and loads it again.
+        this->flushLock();
+#ifndef UNPIN_FOR_NON_ZERO_REF_COUNT
+        bool removed = removePageIfUnpinned(key, evicted);
+#else
+        bool removed = removePage(key, evicted);
 #endif
+        if (removed == false) {
+            this->flushUnlock();
+            return false;
         }
+        page->setPinned(false);
+        this->shm->free(page->getRawBytes() - page->getInternalOffset(), page->getRawSize() + 512);
+        page->setOffset(0);
+        page->setRawBytes(nullptr);
+        this->flushUnlock();
+        shard->numEvicted++;
+    }
+#ifdef PROFILING_CACHE
+    std::cout << "Storage server: evicting page from cache for dbId:" << page->getDbID()
+              << ", typeID:" << page->getTypeID() << ", setID=" << page->getSetID()
+              << ", pageID: " << page->getPageID() << ", tryFlushing=" << tryFlushOrNot << ".\n";
+#endif
 
-    } else {
-        PDB_COUT << "can not find page in cache!\n";
-        this->logger->writeLn("LRUPageCache: can not evict page because it is not in cache");
+    return true;
+}
+
+bool PageCache::dropConsumedPage(CacheKey key, LocalitySetPtr set) {
+    PageCacheShard* shard = this->getShard(key);
+    pthread_rwlock_rdlock(&shard->lock);
+    auto iter = shard->pages.find(key);
+    if (iter == shard->pages.end()) {
+        pthread_rwlock_unlock(&shard->lock);
         return false;
     }
-
+    PDBPagePtr page = iter->second;
+    pthread_rwlock_unlock(&shard->lock);
+    if ((page->isDirty() == true) || (page->isInFlush() == true) || (page->getRefCount() > 0)) {
+        return false;
+    }
+    // the page is clean, so we free it without flushing, and it is not a ghost of the 2Q replacer
+    if (this->evictPage(key, false, false) == false) {
+        return false;
+    }
+    if (set != nullptr) {
+        set->removeCachedPage(page);
+    }
     return true;
 }
 
@@ -733,6 +900,80 @@ void PageCache::runEviction() {
     worker->execute(evictWork, buzzer);
 }
 
+// Evict the unpinned pages of one shard in MRU order, until the cache is below the stopSize or the
+// shard is below the shardStopSize. We only hold the read lock of this shard while we collect the
+// candidates, so that the lookups in this shard are blocked only for a short time, and the lookups
+// in the other shards are not blocked at all.
+int PageCache::evictShard(PageCacheShard* shard, size_t stopSize, size_t shardStopSize) {
+    priority_queue<PDBPagePtr, vector<PDBPagePtr>, CompareCachedPagesMRU> cachedPages;
+    pthread_rwlock_rdlock(&shard->lock);
+    for (auto cacheIter = shard->pages.begin(); cacheIter != shard->pages.end(); cacheIter++) {
+        PDBPagePtr curPage = cacheIter->second;
+        if (curPage == nullptr) {
+            this->logger->error("PageCache::evict(): got a null page, skip it!");
+            continue;
+        }
+        if ((curPage->getRefCount() == 0) &&
+            ((curPage->isDirty() == false) ||
+             ((curPage->isDirty() == true) && (curPage->isInFlush() == false)))) {
+            cachedPages.push(curPage);
+#ifdef PROFILING_CACHE
+            std::cout << "Add to eviction queue: curPage->getRefCount()=" << curPage->getRefCount()
+                      << ", curPage->isDirty()=" << curPage->isDirty()
+                      << ", curPage->isInFlush)=" << curPage->isInFlush()
+                      << ", curPage->dbId=" << curPage->getDbID()
+                      << ", curPage->setId=" << curPage->getSetID() << std::endl;
+#endif
+        }
+    }
+    pthread_rwlock_unlock(&shard->lock);
+
+    int numEvicted = 0;
+    while ((this->size > stopSize) && (shard->size > shardStopSize) && (cachedPages.size() > 0)) {
+        PDBPagePtr page = cachedPages.top();
+        cachedPages.pop();
+        if (this->evictPage(page) == true) {
+#ifdef PROFILING
+            std::cout << "Storage server: evicted page from cache passively for dbId:"
+                      << page->getDbID() << ", typeID:" << page->getTypeID()
+                      << ", setID=" << page->getSetID() << ", pageID: " << page->getPageID()
+                      << ".\n";
+#endif
+            this->logger->debug(std::string("Storage server: evicting page from cache for pageID:") +
+                                std::to_string(page->getPageID()));
+            numEvicted++;
+        }
+    }
+    return numEvicted;
+}
+
+// If we are already below the evictStopSize, the caller could not allocate a page because the free
+// memory is fragmented into holes that are too small, so each such call frees half of the remaining
+// pages, otherwise we would never evict anything and the caller would spin forever.
+size_t PageCache::getEvictionStopSize() {
+    size_t curSize = this->size;
+    if (curSize <= this->evictStopSize) {
+        return curSize / 2;
+    }
+    return this->evictStopSize;
+}
+
+int PageCache::evictTwoQueue() {
+    size_t stopSize = this->getEvictionStopSize();
+    if (this->size <= stopSize) {
+        return 0;
+    }
+    vector<PDBPagePtr> pagesToEvict =
+        this->twoQueueReplacer->selectPagesForReplacement(this->size - stopSize);
+    int numEvicted = 0;
+    for (size_t i = 0; (i < pagesToEvict.size()) && (this->size > stopSize); i++) {
+        if (this->evictPage(pagesToEvict[i]) == true) {
+            numEvicted++;
+        }
+    }
+    return numEvicted;
+}
+
 void PageCache::evict() {
     if (this->inEviction == true) {
         return;
@@ -774,65 +1015,23 @@ void PageCache::evict() {
         }
         this->evictionUnlock();
 
+    } else if (this->strategy == UnifiedTwoQueue) {
+        this->evictTwoQueue();
     } else {
-        this->evictionLock();
-        this->logger->debug("PageCache::evict(): got the lock for evictionLock()...");
-        priority_queue<PDBPagePtr, vector<PDBPagePtr>, CompareCachedPagesMRU>* cachedPages =
-            new priority_queue<PDBPagePtr, vector<PDBPagePtr>, CompareCachedPagesMRU>();
-        unordered_map<CacheKey, PDBPagePtr, CacheKeyHash, CacheKeyEqual>::iterator cacheIter;
-        PDBPagePtr curPage;
-        for (cacheIter = this->cache->begin(); cacheIter != this->cache->end(); cacheIter++) {
-            curPage = cacheIter->second;
-            if (curPage == nullptr) {
-                this->logger->error("PageCache::evict(): got a null page, return!");
-                delete cachedPages;
-                this->inEviction = false;
-                this->evictionUnlock();
-                pthread_mutex_unlock(&this->evictionMutex);
-                return;
-            }
-            this->logger->debug(
-                "PageCache::evict(): got a page, check whether it can be evicted...");
-            if ((curPage->getRefCount() == 0) &&
-                ((curPage->isDirty() == false) ||
-                 ((curPage->isDirty() == true) && (curPage->isInFlush() == false)))) {
-                cachedPages->push(curPage);
-#ifdef PROFILING_CACHE
-                std::cout << "Add to eviction queue: curPage->getRefCount()="
-                          << curPage->getRefCount() << ", curPage->isDirty()=" << curPage->isDirty()
-                          << ", curPage->isInFlush)=" << curPage->isInFlush()
-                          << ", curPage->dbId=" << curPage->getDbID()
-                          << ", curPage->setId=" << curPage->getSetID() << std::endl;
-#endif
-            } else {
-                // do nothing
-            }
+        // we start from a different shard each time, so that the same shards are not always
+        // the first to lose their pages
+        unsigned int numShards = this->shards.size();
+        unsigned int firstShard = this->nextShardToEvict.fetch_add(1) % numShards;
+        // first each shard gives up its share of the memory we need to free, if the pages are not
+        // spread evenly that is not enough, so then we evict from any shard
+        size_t stopSize = this->getEvictionStopSize();
+        size_t shardStopSize = stopSize / numShards;
+        for (unsigned int i = 0; (i < numShards) && (this->size > stopSize); i++) {
+            this->evictShard(this->shards[(firstShard + i) % numShards], stopSize, shardStopSize);
         }
-        this->evictionUnlock();
-        PDBPagePtr page;
-        while ((this->size > this->evictStopSize) && (cachedPages->size() > 0)) {
-            page = cachedPages->top();
-            if (page == nullptr) {
-                PDB_COUT << "PageCache: nothing to evict, return!\n";
-                this->logger->debug("PageCache: nothing to evict, return!\n");
-                break;
-            }
-            if (this->evictPage(page) == true) {
-#ifdef PROFILING
-                std::cout << "Storage server: evicted page from cache passively for dbId:"
-                          << page->getDbID() << ", typeID:" << page->getTypeID()
-                          << ", setID=" << page->getSetID() << ", pageID: " << page->getPageID()
-                          << ".\n";
-#endif
-                this->logger->debug(
-                    std::string("Storage server: evicting page from cache for pageID:") +
-                    std::to_string(page->getPageID()));
-                cachedPages->pop();
-            } else {
-                cachedPages->pop();
-            }
+        for (unsigned int i = 0; (i < numShards) && (this->size > stopSize); i++) {
+            this->evictShard(this->shards[(firstShard + i) % numShards], stopSize, 0);
         }
-        delete cachedPages;
     }
     this->inEviction = false;
     pthread_mutex_unlock(&this->evictionMutex);
@@ -879,6 +1078,14 @@ void PageCache::pin(LocalitySetPtr set,
     }
 }
 
+void PageCache::pin(LocalitySetPtr set,
+                    LocalitySetReplacementPolicy policy,
+                    OperationType operationType,
+                    AccessPattern accessPattern) {
+    set->declareAccessPattern(accessPattern);
+    this->pin(set, policy, operationType);
+}
+
 void PageCache::unpin(LocalitySetPtr set) {
     set->unpin();
     if (set->getPersistenceType() == Transient) {
@@ -28,111 +28,178 @@
 #include <sched.h>
 
 PageCircularBuffer::PageCircularBuffer(unsigned int bufferSize, pdb::PDBLoggerPtr logger) {
-    this->maxArraySize = bufferSize + 1;
+    this->maxArraySize = (bufferSize > 0) ? bufferSize : 1;
     this->logger = logger;
     this->closed = false;
+    this->numParkedConsumers = 0;
+    this->numParkedProducers = 0;
     this->initArray();
     pthread_mutex_init(&(this->mutex), NULL);
-    pthread_mutex_init(&(this->addPageMutex), NULL);
-    pthread_cond_init(&(this->cond), NULL);
+    pthread_cond_init(&(this->notEmpty), NULL);
+    pthread_cond_init(&(this->notFull), NULL);
 }
 
 PageCircularBuffer::~PageCircularBuffer() {
     // the buffer is not responsible for freeing the elements in the buffer
-    delete[] this->pageArray;
+    delete[] this->slots;
     pthread_mutex_destroy(&(this->mutex));
-    pthread_cond_destroy(&(this->cond));
+    pthread_cond_destroy(&(this->notEmpty));
+    pthread_cond_destroy(&(this->notFull));
 }
 
 int PageCircularBuffer::initArray() {
-    this->pageArray = new PDBPagePtr[this->maxArraySize];
-    if (this->pageArray == nullptr) {
+    this->slots = new Slot[this->maxArraySize];
+    if (this->slots == nullptr) {
         cout << "PageCircularBuffer: Out of Memory in Heap.\n";
         this->logger->writeLn("PageCircularBuffer: Out of Memory in Heap.");
         return -1;
     }
+    // slot i is free for the page at position i
     unsigned int i;
     for (i = 0; i < this->maxArraySize; i++) {
-
-        this->pageArray[i] = nullptr;
+        this->slots[i].sequence.store(i, std::memory_order_relaxed);
+        this->slots[i].page = nullptr;
     }
     this->pageArrayHead = 0;
     this->pageArrayTail = 0;
     return 0;
 }
 
+void PageCircularBuffer::wakeUp(std::atomic<int>& numParked, pthread_cond_t& cond) {
+    // pairs with the increment of numParked in the parking thread, either we see it parking, or it
+    // sees the page (or the room) we have just made
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (numParked.load(std::memory_order_relaxed) > 0) {
+        pthread_mutex_lock(&(this->mutex));
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&(this->mutex));
+    }
+}
+
+bool PageCircularBuffer::tryAddPageToTail(PDBPagePtr page) {
+    size_t pos = this->pageArrayTail.load(std::memory_order_relaxed);
+    while (true) {
+        Slot* slot = &this->slots[pos % this->maxArraySize];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        long diff = (long)sequence - (long)pos;
+        if (diff == 0) {
+            // the slot is free for this position, try to claim it
+            if (this->pageArrayTail.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed)) {
+                slot->page = page;
+                slot->sequence.store(pos + 1, std::memory_order_release);
+                break;
+            }
+        } else if (diff < 0) {
+            // the slot still holds the page of the previous round, the buffer is full
+            return false;
+        } else {
+            pos = this->pageArrayTail.load(std::memory_order_relaxed);
+        }
+    }
+    wakeUp(this->numParkedConsumers, this->notEmpty);
+    return true;
+}
+
+bool PageCircularBuffer::tryPopPageFromHead(PDBPagePtr& page) {
+    size_t pos = this->pageArrayHead.load(std::memory_order_relaxed);
+    while (true) {
+        Slot* slot = &this->slots[pos % this->maxArraySize];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        long diff = (long)sequence - (long)(pos + 1);
+        if (diff == 0) {
+            // the slot holds the page for this position, try to claim it
+            if (this->pageArrayHead.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed)) {
+                page = std::move(slot->page);
+                slot->page = nullptr;
+                slot->sequence.store(pos + this->maxArraySize, std::memory_order_release);
+                break;
+            }
+        } else if (diff < 0) {
+            // the page for this position has not been added yet, the buffer is empty
+            return false;
+        } else {
+            pos = this->pageArrayHead.load(std::memory_order_relaxed);
+        }
+    }
+    wakeUp(this->numParkedProducers, this->notFull);
+    return true;
+}
+
 // in our case, more than one producer will add pages to the tail of the blocking queue
 int PageCircularBuffer::addPageToTail(PDBPagePtr page) {
-    pthread_mutex_lock(&(this->addPageMutex));
     int i = 0;
-    while (this->isFull()) {
+    while (this->tryAddPageToTail(page) == false) {
         i++;
-        if (i % 10000000 == 0) {
-            this->logger->info(std::to_string(i) +
-                               std::string(":PageCircularBuffer: array is full."));
+        if (i <= PAGE_CIRCULAR_BUFFER_SPINS) {
+            sched_yield();
+            continue;
         }
-        pthread_cond_signal(&(this->cond));
-        sched_yield();  // TODO: consider to use another conditional variable
-    }
-
-    this->logger->writeLn("PageCircularBuffer:got a place.");
-    this->pageArrayTail = (this->pageArrayTail + 1) % this->maxArraySize;
-    this->pageArray[this->pageArrayTail] = page;
-    pthread_mutex_unlock(&(this->addPageMutex));
-    pthread_mutex_lock(&(this->mutex));
-    if (this->getSize() <= 2) {  // TODO <= numThreads? or not necessary
-        pthread_cond_broadcast(&(this->cond));
-    } else {
-        pthread_cond_signal(&(this->cond));
+        pthread_mutex_lock(&(this->mutex));
+        this->numParkedProducers.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (this->isFull() == true) {
+            this->logger->writeLn("PageCircularBuffer: array is full.");
+            pthread_cond_wait(&(this->notFull), &(this->mutex));
+        }
+        this->numParkedProducers.fetch_sub(1, std::memory_order_relaxed);
+        pthread_mutex_unlock(&(this->mutex));
     }
-    pthread_mutex_unlock(&(this->mutex));
     return 0;
 }
 
-// there will be multiple consumers, so we need to guard the blocking queue
-
+// there will be multiple consumers, they wait until there is a page or the buffer is closed
 PDBPagePtr PageCircularBuffer::popPageFromHead() {
-    pthread_mutex_lock(&(this->mutex));
-    if (this->isEmpty() && (this->closed == false)) {
-        this->logger->writeLn("PageCircularBuffer: array is empty.");
-        pthread_cond_wait(&(this->cond), &(this->mutex));
-    }
-    if (!this->isEmpty()) {
-        this->logger->debug("PageCircularBuffer: not empty, return the head element");
-        this->pageArrayHead = (this->pageArrayHead + 1) % this->maxArraySize;
-        PDBPagePtr ret = this->pageArray[this->pageArrayHead];
-        this->pageArray[this->pageArrayHead] = nullptr;
-        pthread_mutex_unlock(&(this->mutex));
-        return ret;
-    } else {
+    PDBPagePtr page;
+    int i = 0;
+    while (this->tryPopPageFromHead(page) == false) {
+        if (this->isClosed() == true) {
+            // a page may have been added right before the buffer was closed
+            if (this->tryPopPageFromHead(page) == true) {
+                return page;
+            }
+            return nullptr;
+        }
+        i++;
+        if (i <= PAGE_CIRCULAR_BUFFER_SPINS) {
+            sched_yield();
+            continue;
+        }
+        pthread_mutex_lock(&(this->mutex));
+        this->numParkedConsumers.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((this->isEmpty() == true) && (this->isClosed() == false)) {
+            this->logger->writeLn("PageCircularBuffer: array is empty.");
+            pthread_cond_wait(&(this->notEmpty), &(this->mutex));
+        }
+        this->numParkedConsumers.fetch_sub(1, std::memory_order_relaxed);
         pthread_mutex_unlock(&(this->mutex));
-        return nullptr;
     }
+    return page;
 }
-// not thread-safe
 
+// a snapshot, it can be stale as soon as it is returned
 bool PageCircularBuffer::isFull() {
-    return (this->pageArrayHead == (this->pageArrayTail + 1) % this->maxArraySize);
+    return this->getSize() >= this->maxArraySize;
 }
-// not thread-safe
 
+// a snapshot, it can be stale as soon as it is returned
 bool PageCircularBuffer::isEmpty() {
-    PDB_COUT << "this->pageArrayHead=" << this->pageArrayHead << std::endl;
-    this->logger->debug(std::string("this->pageArrayHead=") + std::to_string(this->pageArrayHead));
-    this->logger->debug(std::string("this->pageArrayTail=") + std::to_string(this->pageArrayTail));
-    PDB_COUT << "this->pageArrayTail=" << this->pageArrayTail << std::endl;
-    return (this->pageArrayHead == this->pageArrayTail);
+    return this->getSize() == 0;
 }
-// not thread-safe
 
+// a snapshot, it counts the pages being added or popped
 unsigned int PageCircularBuffer::getSize() {
-    return (this->pageArrayTail - this->pageArrayHead + this->maxArraySize) % this->maxArraySize;
+    size_t head = this->pageArrayHead.load(std::memory_order_acquire);
+    size_t tail = this->pageArrayTail.load(std::memory_order_acquire);
+    return (tail > head) ? (unsigned int)(tail - head) : 0;
 }
 
 void PageCircularBuffer::close() {
     pthread_mutex_lock(&(this->mutex));
     this->closed = true;
-    pthread_cond_broadcast(&(this->cond));
+    pthread_cond_broadcast(&(this->notEmpty));
     pthread_mutex_unlock(&(this->mutex));
 }
 
@@ -0,0 +1,259 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PAGE_DESCRIPTOR_RING_CC
+#define PAGE_DESCRIPTOR_RING_CC
+
+#include "PageDescriptorRing.h"
+#include <climits>
+#include <linux/futex.h>
+#include <new>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+PageDescriptorRing::PageDescriptorRing(size_t capacity)
+    : capacity(capacity),
+      mask(capacity - 1),
+      allocationOffset(0),
+      enqueuePos(0),
+      dequeuePos(0),
+      numPushes(0),
+      numWaitingConsumers(0),
+      numPops(0),
+      numWaitingProducers(0),
+      numCompleted(0),
+      numCompletes(0),
+      numWaitingForCompletion(0),
+      closed(false) {
+    Slot* slots = getSlots();
+    for (size_t i = 0; i < capacity; i++) {
+        new (&slots[i]) Slot();
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+PageDescriptorRing* PageDescriptorRing::create(SharedMemPtr shm, unsigned int capacity) {
+    size_t roundedCapacity = 1;
+    while (roundedCapacity < capacity) {
+        roundedCapacity <<= 1;
+    }
+    size_t size = sizeof(PageDescriptorRing) + roundedCapacity * sizeof(Slot);
+    int allocationOffset;
+    void* memory = shm->mallocAlign(size, alignof(PageDescriptorRing), allocationOffset);
+    if (memory == nullptr) {
+        return nullptr;
+    }
+    PageDescriptorRing* ring = new (memory) PageDescriptorRing(roundedCapacity);
+    ring->allocationOffset = allocationOffset;
+    return ring;
+}
+
+void PageDescriptorRing::destroy(SharedMemPtr shm, PageDescriptorRing* ring) {
+    if (ring == nullptr) {
+        return;
+    }
+    size_t size = sizeof(PageDescriptorRing) + ring->capacity * sizeof(Slot);
+    char* memory = (char*)ring - ring->allocationOffset;
+    ring->~PageDescriptorRing();
+    shm->free(memory, size + alignof(PageDescriptorRing));
+}
+
+PageDescriptorRing::Slot* PageDescriptorRing::getSlots() {
+    return reinterpret_cast<Slot*>(this + 1);
+}
+
+void PageDescriptorRing::wait(std::atomic<int>* futexWord, int expected) {
+    // not FUTEX_WAIT_PRIVATE, the waker can be in the other process
+    syscall(SYS_futex, (int*)futexWord, FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+
+void PageDescriptorRing::wakeAll(std::atomic<int>* futexWord) {
+    syscall(SYS_futex, (int*)futexWord, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+bool PageDescriptorRing::tryPush(const PageDescriptor& descriptor, size_t& ticket) {
+    Slot* slots = getSlots();
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Slot* slot = &slots[pos & mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        long diff = (long)sequence - (long)pos;
+        if (diff == 0) {
+            // the slot is free, try to claim it
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot->descriptor = descriptor;
+                slot->sequence.store(pos + 1, std::memory_order_release);
+                ticket = pos;
+                break;
+            }
+        } else if (diff < 0) {
+            // the slot still holds the descriptor from the previous round, the ring is full
+            return false;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // wake up the consumers if somebody is sleeping
+    numPushes.fetch_add(1, std::memory_order_seq_cst);
+    if (numWaitingConsumers.load(std::memory_order_seq_cst) > 0) {
+        wakeAll(&numPushes);
+    }
+    return true;
+}
+
+bool PageDescriptorRing::tryPop(PageDescriptor& descriptor, size_t& ticket) {
+    Slot* slots = getSlots();
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+        Slot* slot = &slots[pos & mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        long diff = (long)sequence - (long)(pos + 1);
+        if (diff == 0) {
+            // the slot is written, try to claim it
+            if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                descriptor = slot->descriptor;
+                slot->sequence.store(pos + capacity, std::memory_order_release);
+                ticket = pos;
+                break;
+            }
+        } else if (diff < 0) {
+            // the slot is not written yet, the ring is empty
+            return false;
+        } else {
+            pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    // wake up the producers if somebody is sleeping
+    numPops.fetch_add(1, std::memory_order_seq_cst);
+    if (numWaitingProducers.load(std::memory_order_seq_cst) > 0) {
+        wakeAll(&numPops);
+    }
+    return true;
+}
+
+bool PageDescriptorRing::push(const PageDescriptor& descriptor, size_t& ticket) {
+    int numSpins = 0;
+    while (isClosed() == false) {
+        if (tryPush(descriptor, ticket) == true) {
+            return true;
+        }
+        if (numSpins < PAGE_DESCRIPTOR_RING_SPINS) {
+            numSpins++;
+            sched_yield();
+            continue;
+        }
+        // announce that we are going to sleep, and check again, so that a consumer that took a
+        // descriptor in the meantime either sees us or changes numPops before we sleep
+        int seenPops = numPops.load(std::memory_order_seq_cst);
+        numWaitingProducers.fetch_add(1, std::memory_order_seq_cst);
+        if ((tryPush(descriptor, ticket) == true)) {
+            numWaitingProducers.fetch_sub(1, std::memory_order_seq_cst);
+            return true;
+        }
+        if (isClosed() == false) {
+            wait(&numPops, seenPops);
+        }
+        numWaitingProducers.fetch_sub(1, std::memory_order_seq_cst);
+    }
+    return false;
+}
+
+bool PageDescriptorRing::pop(PageDescriptor& descriptor, size_t& ticket) {
+    int numSpins = 0;
+    while (true) {
+        if (tryPop(descriptor, ticket) == true) {
+            return true;
+        }
+        if (isClosed() == true) {
+            // a descriptor may have been added right before the ring was closed
+            return tryPop(descriptor, ticket);
+        }
+        if (numSpins < PAGE_DESCRIPTOR_RING_SPINS) {
+            numSpins++;
+            sched_yield();
+            continue;
+        }
+        int seenPushes = numPushes.load(std::memory_order_seq_cst);
+        numWaitingConsumers.fetch_add(1, std::memory_order_seq_cst);
+        if (tryPop(descriptor, ticket) == true) {
+            numWaitingConsumers.fetch_sub(1, std::memory_order_seq_cst);
+            return true;
+        }
+        if (isClosed() == false) {
+            wait(&numPushes, seenPushes);
+        }
+        numWaitingConsumers.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
+
+void PageDescriptorRing::complete(size_t ticket) {
+    numCompleted.store(ticket + 1, std::memory_order_release);
+    numCompletes.fetch_add(1, std::memory_order_seq_cst);
+    if (numWaitingForCompletion.load(std::memory_order_seq_cst) > 0) {
+        wakeAll(&numCompletes);
+    }
+}
+
+void PageDescriptorRing::waitForCompletion(size_t ticket) {
+    int numSpins = 0;
+    while (numCompleted.load(std::memory_order_acquire) <= ticket) {
+        if (isClosed() == true) {
+            return;
+        }
+        if (numSpins < PAGE_DESCRIPTOR_RING_SPINS) {
+            numSpins++;
+            sched_yield();
+            continue;
+        }
+        int seenCompletes = numCompletes.load(std::memory_order_seq_cst);
+        numWaitingForCompletion.fetch_add(1, std::memory_order_seq_cst);
+        if (numCompleted.load(std::memory_order_seq_cst) <= ticket) {
+            wait(&numCompletes, seenCompletes);
+        }
+        numWaitingForCompletion.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
+
+void PageDescriptorRing::close() {
+    closed.store(true, std::memory_order_seq_cst);
+    // change the futex words, so that a thread about to sleep doesn't
+    numPushes.fetch_add(1, std::memory_order_seq_cst);
+    numPops.fetch_add(1, std::memory_order_seq_cst);
+    numCompletes.fetch_add(1, std::memory_order_seq_cst);
+    wakeAll(&numPushes);
+    wakeAll(&numPops);
+    wakeAll(&numCompletes);
+}
+
+bool PageDescriptorRing::isClosed() {
+    return closed.load(std::memory_order_acquire);
+}
+
+size_t PageDescriptorRing::getSize() {
+    size_t head = dequeuePos.load(std::memory_order_acquire);
+    size_t tail = enqueuePos.load(std::memory_order_acquire);
+    return (tail > head) ? (tail - head) : 0;
+}
+
+size_t PageDescriptorRing::getCapacity() {
+    return capacity;
+}
+
+#endif
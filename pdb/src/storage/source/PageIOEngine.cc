@@ -0,0 +1,670 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PAGE_IO_ENGINE_CC
+#define PAGE_IO_ENGINE_CC
+
+#include "PageIOEngine.h"
+#include <deque>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/aio_abi.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define PAGE_IO_HAS_IO_URING
+#endif
+#endif
+
+#ifdef PAGE_IO_HAS_IO_URING
+
+/**
+ * The io_uring backend. Requests are written into the submission ring shared with the kernel, and
+ * a single io_uring_enter() call submits the whole batch.
+ */
+class IOUringPageIOEngine : public PageIOEngine {
+
+public:
+    IOUringPageIOEngine(unsigned int queueDepth) {
+        this->queueDepth = queueDepth;
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ringFd = (int)syscall(__NR_io_uring_setup, queueDepth, &params);
+        if (ringFd < 0) {
+            return;
+        }
+
+        // map the submission ring, the completion ring and the submission entries
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            sqRingSize = cqRingSize = (sqRingSize > cqRingSize) ? sqRingSize : cqRingSize;
+        }
+        sqRing = mmap(nullptr,
+                      sqRingSize,
+                      PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE,
+                      ringFd,
+                      IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) {
+            sqRing = nullptr;
+            return;
+        }
+        if (singleMap) {
+            cqRing = sqRing;
+        } else {
+            cqRing = mmap(nullptr,
+                          cqRingSize,
+                          PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE,
+                          ringFd,
+                          IORING_OFF_CQ_RING);
+            if (cqRing == MAP_FAILED) {
+                cqRing = nullptr;
+                return;
+            }
+        }
+        sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        sqes = (struct io_uring_sqe*)mmap(nullptr,
+                                          sqesSize,
+                                          PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE,
+                                          ringFd,
+                                          IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            sqes = nullptr;
+            return;
+        }
+
+        char* sq = (char*)sqRing;
+        sqTail = (unsigned*)(sq + params.sq_off.tail);
+        sqMask = (unsigned*)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned*)(sq + params.sq_off.array);
+        char* cq = (char*)cqRing;
+        cqHead = (unsigned*)(cq + params.cq_off.head);
+        cqTail = (unsigned*)(cq + params.cq_off.tail);
+        cqMask = (unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+        // we never have more requests in flight than there are submission entries
+        if (this->queueDepth > params.sq_entries) {
+            this->queueDepth = params.sq_entries;
+        }
+        initialized = true;
+    }
+
+    ~IOUringPageIOEngine() {
+        if (sqes != nullptr) {
+            munmap(sqes, sqesSize);
+        }
+        if ((cqRing != nullptr) && (cqRing != sqRing)) {
+            munmap(cqRing, cqRingSize);
+        }
+        if (sqRing != nullptr) {
+            munmap(sqRing, sqRingSize);
+        }
+        if (ringFd >= 0) {
+            close(ringFd);
+        }
+    }
+
+    bool isInitialized() {
+        return initialized;
+    }
+
+    bool submit(vector<PageIORequest*>& requests) override {
+        if (numInFlight + requests.size() > queueDepth) {
+            return false;
+        }
+        // only this thread writes the tail, the kernel reads it
+        unsigned tail = *sqTail;
+        for (PageIORequest* request : requests) {
+            unsigned index = tail & *sqMask;
+            struct io_uring_sqe* sqe = &sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            request->iov.iov_base = request->buffer;
+            request->iov.iov_len = request->length;
+            sqe->opcode = request->isWrite ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe->fd = request->handle;
+            sqe->addr = (unsigned long)&request->iov;
+            sqe->len = 1;
+            sqe->off = request->offset;
+            sqe->user_data = (unsigned long)request;
+            sqArray[index] = index;
+            tail++;
+        }
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+        unsigned toSubmit = requests.size();
+        while (toSubmit > 0) {
+            int ret = (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, 0, 0, nullptr, 0);
+            if (ret < 0) {
+                if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                    continue;
+                }
+                // the kernel did not take the remaining entries, we take them back out of the
+                // ring, since we are the only producer, and they complete right away with the error
+                int error = errno;
+                __atomic_store_n(sqTail, tail - toSubmit, __ATOMIC_RELEASE);
+                if (toSubmit == requests.size()) {
+                    return false;
+                }
+                pthread_mutex_lock(&failedMutex);
+                for (size_t i = requests.size() - toSubmit; i < requests.size(); i++) {
+                    requests[i]->result = -error;
+                    failedRequests.push_back(requests[i]);
+                }
+                pthread_mutex_unlock(&failedMutex);
+                break;
+            }
+            toSubmit -= ret;
+        }
+        numInFlight += requests.size();
+        return true;
+    }
+
+    PageIORequest* waitForCompletion() override {
+        if (numInFlight == 0) {
+            return nullptr;
+        }
+        PageIORequest* failedRequest = popFailedRequest();
+        if (failedRequest != nullptr) {
+            numInFlight--;
+            return failedRequest;
+        }
+        while (true) {
+            unsigned head = *cqHead;
+            if (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+                struct io_uring_cqe* cqe = &cqes[head & *cqMask];
+                PageIORequest* request = (PageIORequest*)cqe->user_data;
+                request->result = cqe->res;
+                __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+                numInFlight--;
+                return request;
+            }
+            int ret =
+                (int)syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if ((ret < 0) && (errno != EINTR) && (errno != EAGAIN)) {
+                return nullptr;
+            }
+        }
+    }
+
+    string getName() override {
+        return "io_uring";
+    }
+
+private:
+    // the requests that failed to submit are queued by the submitting thread
+    PageIORequest* popFailedRequest() {
+        PageIORequest* request = nullptr;
+        pthread_mutex_lock(&failedMutex);
+        if (!failedRequests.empty()) {
+            request = failedRequests.front();
+            failedRequests.pop_front();
+        }
+        pthread_mutex_unlock(&failedMutex);
+        return request;
+    }
+
+    bool initialized = false;
+    int ringFd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    size_t sqesSize = 0;
+    struct io_uring_sqe* sqes = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    struct io_uring_cqe* cqes = nullptr;
+    deque<PageIORequest*> failedRequests;
+    pthread_mutex_t failedMutex = PTHREAD_MUTEX_INITIALIZER;
+};
+
+#endif
+
+#ifdef __linux__
+
+/**
+ * The Linux native AIO backend, the same system calls libaio wraps.
+ */
+class KernelAIOPageIOEngine : public PageIOEngine {
+
+public:
+    KernelAIOPageIOEngine(unsigned int queueDepth) {
+        this->queueDepth = queueDepth;
+        if (syscall(__NR_io_setup, queueDepth, &context) < 0) {
+            context = 0;
+            return;
+        }
+        controlBlocks.resize(queueDepth);
+        for (unsigned int i = 0; i < queueDepth; i++) {
+            freeControlBlocks.push_back(&controlBlocks[i]);
+        }
+        initialized = true;
+    }
+
+    ~KernelAIOPageIOEngine() {
+        if (context != 0) {
+            syscall(__NR_io_destroy, context);
+        }
+    }
+
+    bool isInitialized() {
+        return initialized;
+    }
+
+    bool submit(vector<PageIORequest*>& requests) override {
+        // the control blocks are given back by the thread that waits for the completions
+        vector<struct iocb*> batch;
+        pthread_mutex_lock(&listMutex);
+        if (requests.size() > freeControlBlocks.size()) {
+            pthread_mutex_unlock(&listMutex);
+            return false;
+        }
+        for (size_t i = 0; i < requests.size(); i++) {
+            batch.push_back(freeControlBlocks.back());
+            freeControlBlocks.pop_back();
+        }
+        pthread_mutex_unlock(&listMutex);
+        for (size_t i = 0; i < requests.size(); i++) {
+            PageIORequest* request = requests[i];
+            struct iocb* cb = batch[i];
+            memset(cb, 0, sizeof(*cb));
+            cb->aio_lio_opcode = request->isWrite ? IOCB_CMD_PWRITE : IOCB_CMD_PREAD;
+            cb->aio_fildes = request->handle;
+            cb->aio_buf = (unsigned long)request->buffer;
+            cb->aio_nbytes = request->length;
+            cb->aio_offset = request->offset;
+            cb->aio_data = (unsigned long)request;
+        }
+
+        size_t submitted = 0;
+        while (submitted < batch.size()) {
+            long ret = syscall(
+                __NR_io_submit, context, (long)(batch.size() - submitted), batch.data() + submitted);
+            if (ret < 0) {
+                if (errno == EINTR || errno == EAGAIN) {
+                    continue;
+                }
+                // the requests we could not submit complete right away with the error
+                int error = errno;
+                pthread_mutex_lock(&listMutex);
+                for (size_t i = submitted; i < batch.size(); i++) {
+                    if (submitted > 0) {
+                        PageIORequest* request = (PageIORequest*)batch[i]->aio_data;
+                        request->result = -error;
+                        failedRequests.push_back(request);
+                    }
+                    freeControlBlocks.push_back(batch[i]);
+                }
+                pthread_mutex_unlock(&listMutex);
+                if (submitted == 0) {
+                    return false;
+                }
+                break;
+            }
+            submitted += ret;
+        }
+        numInFlight += batch.size();
+        return true;
+    }
+
+    PageIORequest* waitForCompletion() override {
+        if (numInFlight == 0) {
+            return nullptr;
+        }
+        pthread_mutex_lock(&listMutex);
+        if (!failedRequests.empty()) {
+            PageIORequest* request = failedRequests.front();
+            failedRequests.pop_front();
+            pthread_mutex_unlock(&listMutex);
+            numInFlight--;
+            return request;
+        }
+        pthread_mutex_unlock(&listMutex);
+        struct io_event event;
+        while (true) {
+            long ret = syscall(__NR_io_getevents, context, 1, 1, &event, nullptr);
+            if (ret == 1) {
+                break;
+            }
+            if ((ret < 0) && (errno != EINTR)) {
+                return nullptr;
+            }
+        }
+        pthread_mutex_lock(&listMutex);
+        freeControlBlocks.push_back((struct iocb*)event.obj);
+        pthread_mutex_unlock(&listMutex);
+        PageIORequest* request = (PageIORequest*)event.data;
+        request->result = (ssize_t)event.res;
+        numInFlight--;
+        return request;
+    }
+
+    string getName() override {
+        return "aio";
+    }
+
+private:
+    bool initialized = false;
+    aio_context_t context = 0;
+    vector<struct iocb> controlBlocks;
+    vector<struct iocb*> freeControlBlocks;
+    deque<PageIORequest*> failedRequests;
+    pthread_mutex_t listMutex = PTHREAD_MUTEX_INITIALIZER;
+};
+
+#endif
+
+/**
+ * The portable backend, a pool of threads that issue blocking pread()/pwrite() calls.
+ */
+class ThreadPoolPageIOEngine : public PageIOEngine {
+
+public:
+    ThreadPoolPageIOEngine(unsigned int queueDepth) {
+        this->queueDepth = queueDepth;
+        pthread_mutex_init(&mutex, nullptr);
+        pthread_cond_init(&requestAdded, nullptr);
+        pthread_cond_init(&requestCompleted, nullptr);
+        threads.resize(queueDepth);
+        for (unsigned int i = 0; i < queueDepth; i++) {
+            pthread_create(&threads[i], nullptr, runThread, this);
+        }
+    }
+
+    ~ThreadPoolPageIOEngine() {
+        pthread_mutex_lock(&mutex);
+        stopped = true;
+        pthread_cond_broadcast(&requestAdded);
+        pthread_mutex_unlock(&mutex);
+        for (pthread_t& thread : threads) {
+            pthread_join(thread, nullptr);
+        }
+        pthread_cond_destroy(&requestCompleted);
+        pthread_cond_destroy(&requestAdded);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    bool submit(vector<PageIORequest*>& requests) override {
+        if (numInFlight + requests.size() > queueDepth) {
+            return false;
+        }
+        pthread_mutex_lock(&mutex);
+        for (PageIORequest* request : requests) {
+            pending.push_back(request);
+        }
+        pthread_cond_broadcast(&requestAdded);
+        pthread_mutex_unlock(&mutex);
+        numInFlight += requests.size();
+        return true;
+    }
+
+    PageIORequest* waitForCompletion() override {
+        if (numInFlight == 0) {
+            return nullptr;
+        }
+        pthread_mutex_lock(&mutex);
+        while (completed.empty()) {
+            pthread_cond_wait(&requestCompleted, &mutex);
+        }
+        PageIORequest* request = completed.front();
+        completed.pop_front();
+        pthread_mutex_unlock(&mutex);
+        numInFlight--;
+        return request;
+    }
+
+    string getName() override {
+        return "threads";
+    }
+
+private:
+    static void* runThread(void* arg) {
+        ThreadPoolPageIOEngine* engine = (ThreadPoolPageIOEngine*)arg;
+        while (true) {
+            pthread_mutex_lock(&engine->mutex);
+            while (engine->pending.empty() && !engine->stopped) {
+                pthread_cond_wait(&engine->requestAdded, &engine->mutex);
+            }
+            if (engine->pending.empty()) {
+                pthread_mutex_unlock(&engine->mutex);
+                return nullptr;
+            }
+            PageIORequest* request = engine->pending.front();
+            engine->pending.pop_front();
+            pthread_mutex_unlock(&engine->mutex);
+
+            ssize_t ret;
+            if (request->isWrite) {
+                ret = pwrite(request->handle, request->buffer, request->length, request->offset);
+            } else {
+                ret = pread(request->handle, request->buffer, request->length, request->offset);
+            }
+            request->result = (ret < 0) ? -errno : ret;
+
+            pthread_mutex_lock(&engine->mutex);
+            engine->completed.push_back(request);
+            pthread_cond_signal(&engine->requestCompleted);
+            pthread_mutex_unlock(&engine->mutex);
+        }
+    }
+
+    pthread_mutex_t mutex;
+    pthread_cond_t requestAdded;
+    pthread_cond_t requestCompleted;
+    deque<PageIORequest*> pending;
+    deque<PageIORequest*> completed;
+    vector<pthread_t> threads;
+    bool stopped = false;
+};
+
+/**
+ * The client of a SharedPageIOEngine used by one scan, its requests are returned to it by the
+ * completion thread of the engine.
+ */
+class SharedPageIOEngineClient : public PageIOEngine {
+
+public:
+    SharedPageIOEngineClient(SharedPageIOEnginePtr engine, unsigned int queueDepth) {
+        this->engine = engine;
+        this->queueDepth = queueDepth;
+        pthread_mutex_init(&mutex, nullptr);
+        pthread_cond_init(&requestCompleted, nullptr);
+    }
+
+    ~SharedPageIOEngineClient() {
+        pthread_cond_destroy(&requestCompleted);
+        pthread_mutex_destroy(&mutex);
+    }
+
+    bool submit(vector<PageIORequest*>& requests) override {
+        if (numInFlight + requests.size() > queueDepth) {
+            return false;
+        }
+        // count the requests first, they may complete before the engine returns
+        numInFlight += requests.size();
+        if (engine->submit(this, requests) == false) {
+            numInFlight -= requests.size();
+            return false;
+        }
+        return true;
+    }
+
+    PageIORequest* waitForCompletion() override {
+        if (numInFlight == 0) {
+            return nullptr;
+        }
+        pthread_mutex_lock(&mutex);
+        while (completed.empty()) {
+            pthread_cond_wait(&requestCompleted, &mutex);
+        }
+        PageIORequest* request = completed.front();
+        completed.pop_front();
+        pthread_mutex_unlock(&mutex);
+        numInFlight--;
+        return request;
+    }
+
+    string getName() override {
+        return engine->getName();
+    }
+
+    // called by the completion thread of the engine
+    void complete(PageIORequest* request) {
+        pthread_mutex_lock(&mutex);
+        completed.push_back(request);
+        pthread_cond_signal(&requestCompleted);
+        pthread_mutex_unlock(&mutex);
+    }
+
+private:
+    SharedPageIOEnginePtr engine;
+    pthread_mutex_t mutex;
+    pthread_cond_t requestCompleted;
+    deque<PageIORequest*> completed;
+};
+
+SharedPageIOEngine::SharedPageIOEngine(PageIOEnginePtr backend) {
+    this->backend = backend;
+    this->numInFlight = 0;
+    this->stopped = false;
+    pthread_mutex_init(&mutex, nullptr);
+    pthread_cond_init(&requestSubmitted, nullptr);
+    if (backend != nullptr) {
+        pthread_create(&completionThread, nullptr, runCompletionThread, this);
+    }
+}
+
+SharedPageIOEngine::~SharedPageIOEngine() {
+    if (backend != nullptr) {
+        pthread_mutex_lock(&mutex);
+        stopped = true;
+        pthread_cond_signal(&requestSubmitted);
+        pthread_mutex_unlock(&mutex);
+        pthread_join(completionThread, nullptr);
+    }
+    pthread_cond_destroy(&requestSubmitted);
+    pthread_mutex_destroy(&mutex);
+}
+
+PageIOEnginePtr SharedPageIOEngine::createClient(unsigned int queueDepth) {
+    if (backend == nullptr) {
+        return nullptr;
+    }
+    if (queueDepth > backend->getQueueDepth()) {
+        queueDepth = backend->getQueueDepth();
+    }
+    if (queueDepth == 0) {
+        queueDepth = 1;
+    }
+    return make_shared<SharedPageIOEngineClient>(shared_from_this(), queueDepth);
+}
+
+bool SharedPageIOEngine::submit(void* client, vector<PageIORequest*>& requests) {
+    for (PageIORequest* request : requests) {
+        request->client = client;
+    }
+    pthread_mutex_lock(&mutex);
+    bool submitted = backend->submit(requests);
+    if (submitted == true) {
+        numInFlight += requests.size();
+        pthread_cond_signal(&requestSubmitted);
+    }
+    pthread_mutex_unlock(&mutex);
+    return submitted;
+}
+
+string SharedPageIOEngine::getName() {
+    return (backend == nullptr) ? "none" : backend->getName();
+}
+
+void* SharedPageIOEngine::runCompletionThread(void* arg) {
+    SharedPageIOEngine* engine = (SharedPageIOEngine*)arg;
+    while (true) {
+        pthread_mutex_lock(&engine->mutex);
+        while ((engine->numInFlight == 0) && (engine->stopped == false)) {
+            pthread_cond_wait(&engine->requestSubmitted, &engine->mutex);
+        }
+        if (engine->numInFlight == 0) {
+            pthread_mutex_unlock(&engine->mutex);
+            return nullptr;
+        }
+        pthread_mutex_unlock(&engine->mutex);
+
+        // only this thread waits on the backend, so the clients go on submitting meanwhile
+        PageIORequest* request = engine->backend->waitForCompletion();
+        if (request == nullptr) {
+            continue;
+        }
+        pthread_mutex_lock(&engine->mutex);
+        engine->numInFlight--;
+        pthread_mutex_unlock(&engine->mutex);
+        ((SharedPageIOEngineClient*)request->client)->complete(request);
+    }
+}
+
+PageIOEnginePtr createPageIOEngine(string name, unsigned int queueDepth) {
+    if (queueDepth == 0) {
+        queueDepth = 1;
+    }
+#ifdef PAGE_IO_HAS_IO_URING
+    if (name == "io_uring") {
+        shared_ptr<IOUringPageIOEngine> engine = make_shared<IOUringPageIOEngine>(queueDepth);
+        return engine->isInitialized() ? engine : nullptr;
+    }
+#endif
+#ifdef __linux__
+    if (name == "aio") {
+        shared_ptr<KernelAIOPageIOEngine> engine = make_shared<KernelAIOPageIOEngine>(queueDepth);
+        return engine->isInitialized() ? engine : nullptr;
+    }
+#endif
+    if (name == "threads") {
+        return make_shared<ThreadPoolPageIOEngine>(queueDepth);
+    }
+    return nullptr;
+}
+
+PageIOEnginePtr createPageIOEngine(unsigned int queueDepth) {
+    PageIOEnginePtr engine;
+    if ((engine = createPageIOEngine("io_uring", queueDepth)) != nullptr) {
+        return engine;
+    }
+    if ((engine = createPageIOEngine("aio", queueDepth)) != nullptr) {
+        return engine;
+    }
+    return createPageIOEngine("threads", queueDepth);
+}
+
+SharedPageIOEnginePtr createSharedPageIOEngine(unsigned int queueDepth) {
+    return make_shared<SharedPageIOEngine>(createPageIOEngine(queueDepth));
+}
+
+#endif
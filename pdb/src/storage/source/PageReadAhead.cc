@@ -0,0 +1,220 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PAGE_READ_AHEAD_CC
+#define PAGE_READ_AHEAD_CC
+
+#include "PageReadAhead.h"
+#include <iostream>
+
+PageReadAhead::PageReadAhead(PageCachePtr cache,
+                             PartitionedFilePtr file,
+                             LocalitySet* set,
+                             unsigned int maxDepth) {
+    this->cache = cache;
+    this->file = file;
+    this->set = set;
+
+    // don't keep more than PAGE_SCAN_MAX_IO_BYTES in flight
+    size_t pageSize = file->getPageSize();
+    if ((pageSize > 0) && (maxDepth > PAGE_SCAN_MAX_IO_BYTES / pageSize)) {
+        maxDepth = PAGE_SCAN_MAX_IO_BYTES / pageSize;
+    }
+    if (maxDepth == 0) {
+        maxDepth = 1;
+    }
+    this->maxDepth = maxDepth;
+    this->depth = maxDepth;
+    this->ioEngine = nullptr;
+    if (maxDepth > 1) {
+        this->ioEngine = cache->getIOEngine()->createClient(maxDepth);
+    }
+}
+
+PageReadAhead::~PageReadAhead() {
+    // wait for the loads in flight, so that nobody writes into the buffers after we free them
+    while ((this->ioEngine != nullptr) && (this->ioEngine->getNumInFlight() > 0)) {
+        PageIORequest* request = this->ioEngine->waitForCompletion();
+        if (request == nullptr) {
+            break;
+        }
+        ((ReadAheadSlot*)request->userData)->inFlight = false;
+    }
+    for (ReadAheadSlot* slot : this->window) {
+        if (slot->page != nullptr) {
+            CacheKey key;
+            key.dbId = slot->page->getDbID();
+            key.typeId = slot->page->getTypeID();
+            key.setId = slot->page->getSetID();
+            key.pageId = slot->page->getPageID();
+            cache->decPageRefCount(key);
+        } else if ((slot->inFlight == false) && (slot->request.buffer != nullptr)) {
+            cache->freeBuffer(slot->request.buffer, slot->internalOffset, slot->request.length);
+        }
+        delete slot;
+    }
+}
+
+bool PageReadAhead::isAsynchronous() {
+    return this->ioEngine != nullptr;
+}
+
+void PageReadAhead::setDepth(unsigned int depth) {
+    if (depth > this->maxDepth) {
+        depth = this->maxDepth;
+    }
+    if (depth == 0) {
+        depth = 1;
+    }
+    this->depth = depth;
+}
+
+bool PageReadAhead::isFull() {
+    return this->window.size() >= this->depth;
+}
+
+bool PageReadAhead::isEmpty() {
+    return this->window.empty();
+}
+
+PageID PageReadAhead::getFirstPageId() {
+    return this->window.front()->pageId;
+}
+
+PDBPagePtr PageReadAhead::loadPage(ReadAheadSlot* slot) {
+    // page is pinned (ref count ++)
+    return cache->getPage(
+        this->file, slot->partitionId, slot->pageSeqInPartition, slot->pageId, false, this->set);
+}
+
+bool PageReadAhead::add(FilePartitionID partitionId,
+                        unsigned int pageSeqInPartition,
+                        PageID pageId) {
+    if (this->isFull()) {
+        return false;
+    }
+
+    // the buffers in flight are not accounted in the cache size yet, so only the first page of
+    // the window may block and evict, for the others we stop reading ahead if there is no room
+    size_t pageSize = this->file->getPageSize();
+    int internalOffset = 0;
+    char* pageData = nullptr;
+    if (!this->window.empty()) {
+        pageData = cache->tryAllocateBufferFromSharedMemory(pageSize, internalOffset);
+        if (pageData == nullptr) {
+            return false;
+        }
+    }
+
+    ReadAheadSlot* slot = new ReadAheadSlot();
+    slot->partitionId = partitionId;
+    slot->pageSeqInPartition = pageSeqInPartition;
+    slot->pageId = pageId;
+    slot->inFlight = false;
+    slot->internalOffset = internalOffset;
+    slot->request.buffer = nullptr;
+    this->window.push_back(slot);
+
+    // pages already in cache are pinned right away
+    CacheKey key;
+    key.dbId = this->file->getDbId();
+    key.typeId = this->file->getTypeId();
+    key.setId = this->file->getSetId();
+    key.pageId = pageId;
+    slot->page = cache->getPageIfCached(key, this->set);
+    if (slot->page != nullptr) {
+        if (pageData != nullptr) {
+            cache->freeBuffer(pageData, slot->internalOffset, pageSize);
+        }
+        return true;
+    }
+    if (pageData == nullptr) {
+        pageData = cache->allocateBufferFromSharedMemoryBlocking(pageSize, slot->internalOffset);
+    }
+    if ((this->ioEngine == nullptr) ||
+        (this->file->prepareLoadPageRequest(
+             partitionId, pageSeqInPartition, pageData, pageSize, slot->request) == false)) {
+        cache->freeBuffer(pageData, slot->internalOffset, pageSize);
+        slot->request.buffer = nullptr;
+        slot->page = loadPage(slot);
+        return true;
+    }
+    slot->request.userData = slot;
+    slot->inFlight = true;
+    this->requestsToSubmit.push_back(&slot->request);
+    return true;
+}
+
+void PageReadAhead::submit() {
+    if (this->requestsToSubmit.empty()) {
+        return;
+    }
+    if (this->ioEngine->submit(this->requestsToSubmit) == false) {
+        // could not submit, load the pages synchronously
+        for (PageIORequest* request : this->requestsToSubmit) {
+            ReadAheadSlot* slot = (ReadAheadSlot*)request->userData;
+            slot->inFlight = false;
+            cache->freeBuffer(request->buffer, slot->internalOffset, request->length);
+            request->buffer = nullptr;
+            slot->page = loadPage(slot);
+        }
+    }
+    this->requestsToSubmit.clear();
+}
+
+PDBPagePtr PageReadAhead::take() {
+    if (this->window.empty()) {
+        return nullptr;
+    }
+    this->submit();
+    ReadAheadSlot* slot = this->window.front();
+    while (slot->inFlight == true) {
+        PageIORequest* request = this->ioEngine->waitForCompletion();
+        if (request == nullptr) {
+            break;
+        }
+        ((ReadAheadSlot*)request->userData)->inFlight = false;
+    }
+    this->window.pop_front();
+
+    PDBPagePtr pageToReturn = slot->page;
+    if (pageToReturn == nullptr) {
+        if ((slot->inFlight == false) && (slot->request.buffer != nullptr) &&
+            (slot->request.result == (ssize_t)slot->request.length)) {
+            pageToReturn = cache->cacheLoadedPage(this->file,
+                                                  slot->partitionId,
+                                                  slot->pageSeqInPartition,
+                                                  slot->request.buffer,
+                                                  slot->internalOffset,
+                                                  slot->request.length,
+                                                  this->set);
+        } else {
+            // the asynchronous load failed, try again synchronously
+            std::cout << "PageReadAhead: asynchronous load of page " << slot->pageId
+                      << " failed with " << slot->request.result << ", retrying" << std::endl;
+            if ((slot->inFlight == false) && (slot->request.buffer != nullptr)) {
+                cache->freeBuffer(
+                    slot->request.buffer, slot->internalOffset, slot->request.length);
+            }
+            pageToReturn = loadPage(slot);
+        }
+    }
+    delete slot;
+    return pageToReturn;
+}
+
+#endif
@@ -47,9 +47,15 @@ PageScanner::PageScanner(pdb::PDBCommunicatorPtr communicator,
     this->numThreads = numThreads;
     this->buffer = make_shared<PageCircularBuffer>(recvBufSize, logger);
     this->nodeId = nodeId;
+    this->ringThreadStarted = false;
+    this->scanRing = nullptr;
 }
 
-PageScanner::~PageScanner() {}
+PageScanner::~PageScanner() {
+    if (this->ringThreadStarted == true) {
+        pthread_join(this->ringThread, nullptr);
+    }
+}
 
 /**
  * To receive PagePinned objects from frontend.
@@ -123,14 +129,46 @@ vector<PageCircularBufferIteratorPtr> PageScanner::getSetIterators(NodeID nodeId
     getSetPagesRequest->setUserTypeID(typeId);
     getSetPagesRequest->setSetID(setId);
 
+    // the frontend pins the pages to a scan ring of our own, so that the end of another scan
+    // running at the same time doesn't end ours
+    PageTransferChannelPtr channel = this->shm->getPageTransferChannel();
+    if ((channel != nullptr) && (this->ringThreadStarted == false)) {
+        this->scanRing = make_shared<ScanRingGuard>(channel);
+        if (this->scanRing->getScanRingId() < 0) {
+            // all the rings stayed busy, the pages come over the socket instead
+            logger->warn("PageScanner: no scan ring was released in time, using the socket");
+            this->scanRing = nullptr;
+        } else {
+            getSetPagesRequest->setScanRingID(this->scanRing->getScanRingId());
+        }
+    }
+
     vector<PageCircularBufferIteratorPtr> vec;
     // send request to storage
     if (!this->communicator->sendObject<pdb::StorageGetSetPages>(getSetPagesRequest, errMsg)) {
         errMsg = "Could not send data to server.";
         logger->error(std::string("PageScanner: ") + errMsg);
+        this->scanRing = nullptr;
         return vec;
     }
 
+    // the frontend pins the pages to the scan ring, so we move them to the buffer ourselves
+    if ((this->scanRing != nullptr) && (this->ringThreadStarted == false)) {
+        this->ringThreadStarted = (pthread_create(&this->ringThread,
+                                                  nullptr,
+                                                  [](void* scanner) -> void* {
+                                                      ((PageScanner*)scanner)->recvPagesFromRing();
+                                                      return nullptr;
+                                                  },
+                                                  this) == 0);
+        if (this->ringThreadStarted == false) {
+            logger->error("PageScanner: can't start the thread to receive pages from the ring");
+            // the frontend is pushing the pages of this scan to the ring, so it can't be given to
+            // another scan
+            this->scanRing->dismiss();
+        }
+    }
+
     // initialize iterators;
     unsigned int i;
     PageCircularBufferIteratorPtr iter;
@@ -206,6 +244,30 @@ bool PageScanner::recvPagesLoop(pdb::Handle<pdb::StoragePagePinned> pinnedPage,
     return false;
 }
 
+/**
+ * Move the pages from the scan ring to the buffer
+ */
+void PageScanner::recvPagesFromRing() {
+    PageTransferChannelPtr channel = this->shm->getPageTransferChannel();
+    PageDescriptorRing* ring = channel->getScanRing(this->scanRing->getScanRingId());
+    PageDescriptor descriptor;
+    size_t ticket;
+    while (ring->pop(descriptor, ticket) == true) {
+        if (descriptor.type == NoMorePagesDescriptor) {
+            PDB_COUT << "PageScanner: no more pages in the ring" << std::endl;
+            break;
+        }
+        char* rawData = (char*)this->shm->getPointer(descriptor.offset);
+        PDBPagePtr page = make_shared<PDBPage>(rawData, descriptor.offset, 0);
+        this->buffer->addPageToTail(page);
+    }
+    logger->debug("PageScanner: received all the pages from the ring");
+    // the frontend pushes nothing after the NoMorePages descriptor, so the ring is empty and the
+    // next scan can have it
+    this->scanRing->release();
+    this->closeBuffer();
+}
+
 /**
  * Close the buffer
  */
@@ -0,0 +1,141 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef PAGE_TRANSFER_CHANNEL_CC
+#define PAGE_TRANSFER_CHANNEL_CC
+
+#include "PageTransferChannel.h"
+#include <errno.h>
+#include <time.h>
+
+PageTransferChannel::PageTransferChannel(SharedMemPtr shm,
+                                         unsigned int ringSize,
+                                         unsigned int numScanRings) {
+    for (unsigned int i = 0; i < numScanRings; i++) {
+        this->scanRings.push_back(PageDescriptorRing::create(shm, ringSize));
+        this->scanRingInUse.push_back(false);
+    }
+    this->unpinnedPages = PageDescriptorRing::create(shm, ringSize);
+    this->closed = false;
+    pthread_mutex_init(&this->scanRingMutex, nullptr);
+    pthread_cond_init(&this->scanRingReleased, nullptr);
+}
+
+PageTransferChannel::~PageTransferChannel() {
+    // after the fork both processes own a copy of the channel, but the rings are shared, and are
+    // released together with the pool
+    pthread_mutex_destroy(&this->scanRingMutex);
+    pthread_cond_destroy(&this->scanRingReleased);
+}
+
+bool PageTransferChannel::isValid() {
+    for (PageDescriptorRing* ring : this->scanRings) {
+        if (ring == nullptr) {
+            return false;
+        }
+    }
+    return (this->scanRings.size() > 0) && (this->unpinnedPages != nullptr);
+}
+
+int PageTransferChannel::acquireScanRing(unsigned int timeoutMs) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    pthread_mutex_lock(&this->scanRingMutex);
+    while (this->closed == false) {
+        for (size_t i = 0; i < this->scanRingInUse.size(); i++) {
+            if (this->scanRingInUse[i] == false) {
+                this->scanRingInUse[i] = true;
+                pthread_mutex_unlock(&this->scanRingMutex);
+                return (int)i;
+            }
+        }
+        if (pthread_cond_timedwait(&this->scanRingReleased, &this->scanRingMutex, &deadline) ==
+            ETIMEDOUT) {
+            break;
+        }
+    }
+    pthread_mutex_unlock(&this->scanRingMutex);
+    return -1;
+}
+
+void PageTransferChannel::releaseScanRing(int scanRingId) {
+    if ((scanRingId < 0) || (scanRingId >= (int)this->scanRingInUse.size())) {
+        return;
+    }
+    pthread_mutex_lock(&this->scanRingMutex);
+    this->scanRingInUse[scanRingId] = false;
+    pthread_cond_signal(&this->scanRingReleased);
+    pthread_mutex_unlock(&this->scanRingMutex);
+}
+
+PageDescriptorRing* PageTransferChannel::getScanRing(int scanRingId) {
+    if ((scanRingId < 0) || (scanRingId >= (int)this->scanRings.size())) {
+        return nullptr;
+    }
+    return this->scanRings[scanRingId];
+}
+
+PageDescriptorRing* PageTransferChannel::getUnpinnedPages() {
+    return this->unpinnedPages;
+}
+
+void PageTransferChannel::close() {
+    pthread_mutex_lock(&this->scanRingMutex);
+    this->closed = true;
+    pthread_cond_broadcast(&this->scanRingReleased);
+    pthread_mutex_unlock(&this->scanRingMutex);
+    for (PageDescriptorRing* ring : this->scanRings) {
+        if (ring != nullptr) {
+            ring->close();
+        }
+    }
+    if (this->unpinnedPages != nullptr) {
+        this->unpinnedPages->close();
+    }
+}
+
+ScanRingGuard::ScanRingGuard(PageTransferChannelPtr channel, unsigned int timeoutMs) {
+    this->channel = channel;
+    this->scanRingId = (channel == nullptr) ? -1 : channel->acquireScanRing(timeoutMs);
+}
+
+ScanRingGuard::~ScanRingGuard() {
+    release();
+}
+
+int ScanRingGuard::getScanRingId() {
+    return this->scanRingId;
+}
+
+void ScanRingGuard::release() {
+    if (this->scanRingId >= 0) {
+        this->channel->releaseScanRing(this->scanRingId);
+        this->scanRingId = -1;
+    }
+}
+
+void ScanRingGuard::dismiss() {
+    this->scanRingId = -1;
+}
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "PDBDebug.h"
 #include "PartitionPageIterator.h"
+#include <algorithm>
 
 /**
  * To create a new PartitionPageIterator instance
@@ -25,7 +26,8 @@
 PartitionPageIterator::PartitionPageIterator(PageCachePtr cache,
                                              PDBFilePtr file,
                                              FilePartitionID partitionId,
-                                             UserSet* set) {
+                                             UserSet* set,
+                                             unsigned int ioDepth) {
     this->cache = cache;
     this->file = file;
     this->partitionId = partitionId;
@@ -40,6 +42,51 @@ PartitionPageIterator::PartitionPageIterator(PageCachePtr cache,
         this->numPages = partitionedFile->getMetaData()->getPartition(partitionId)->getNumPages();
     }
     this->numIteratedPages = 0;
+    this->numRequestedPages = 0;
+    this->ioDepth = ioDepth;
+    this->readAhead = nullptr;
+}
+
+unsigned int PartitionPageIterator::getReadAheadDepth() {
+    if ((this->set != nullptr) && (this->set->isSequential() == true) &&
+        (this->ioDepth < SEQUENTIAL_SCAN_PREFETCH_DEPTH)) {
+        return SEQUENTIAL_SCAN_PREFETCH_DEPTH;
+    }
+    return this->ioDepth;
+}
+
+bool PartitionPageIterator::startReadAhead() {
+    // the first time, try to set up the read-ahead, the window may grow later if the set turns out
+    // to be scanned sequentially, so we size it for the biggest window
+    if ((this->readAhead == nullptr) && (this->ioDepth > 1)) {
+#ifdef USE_LOCALITY_SET
+        LocalitySet* localitySet = set;
+#else
+        LocalitySet* localitySet = nullptr;
+#endif
+        unsigned int maxDepth =
+            std::max(this->ioDepth, (unsigned int)SEQUENTIAL_SCAN_PREFETCH_DEPTH);
+        this->readAhead =
+            make_shared<PageReadAhead>(cache, this->partitionedFile, localitySet, maxDepth);
+    }
+    return (this->readAhead != nullptr) && (this->readAhead->isAsynchronous() == true);
+}
+
+PDBPagePtr PartitionPageIterator::takeFromReadAhead() {
+    if (this->set != nullptr) {
+        this->set->recordPageAccess(this->partitionId, this->numIteratedPages);
+    }
+    this->readAhead->setDepth(getReadAheadDepth());
+    while ((this->numRequestedPages < this->numPages) && (this->readAhead->isFull() == false)) {
+        PageID pageId =
+            this->partitionedFile->loadPageId(this->partitionId, this->numRequestedPages);
+        if (this->readAhead->add(this->partitionId, this->numRequestedPages, pageId) == false) {
+            break;
+        }
+        this->numRequestedPages++;
+    }
+    this->numIteratedPages++;
+    return this->readAhead->take();
 }
 
 /**
@@ -53,12 +100,17 @@ PDBPagePtr PartitionPageIterator::next() {
         if (this->type == FileType::SequenceFileType) {
             pageToReturn = cache->getPage(this->sequenceFile, this->numIteratedPages);
             this->numIteratedPages++;
+        } else if (this->startReadAhead() == true) {
+            pageToReturn = this->takeFromReadAhead();
         } else {
             PageID curPageId =
                 this->partitionedFile->loadPageId(this->partitionId, this->numIteratedPages);
             PDB_COUT << "PartitionedPageIterator: curTypeId=" << this->partitionedFile->getTypeId()
                      << ",curSetId=" << this->partitionedFile->getSetId()
                      << ",curPageId=" << curPageId << "\n";
+            if (this->set != nullptr) {
+                this->set->recordPageAccess(this->partitionId, this->numIteratedPages);
+            }
 // page is pinned (ref count ++)
 #ifdef USE_LOCALITY_SET
             pageToReturn = cache->getPage(this->partitionedFile,
@@ -512,14 +512,46 @@ size_t PartitionedFile::loadPageDirect(FilePartitionID partitionId,
         return (size_t)(-1);
     }
     if (pageSeqInPartition < this->getMetaData()->getPartition(partitionId)->getNumPages()) {
-        seekPageDirect(handle, pageSeqInPartition);
-        ret = read(handle, pageInCache, length);
+        // pread does not move the shared file position, so concurrent loads don't interfere
+        ret = pread(handle,
+                    pageInCache,
+                    length,
+                    (off_t)pageSeqInPartition * (off_t)this->metaData->getPageSize());
     } else {
         return (size_t)(-1);
     }
     return ret;
 }
 
+/**
+ * To prepare an asynchronous load of a page.
+ * If the file is not opened for direct I/O, we read from the descriptor of the FILE instance,
+ * this is safe because writeData() flushes the FILE buffer after each page.
+ */
+bool PartitionedFile::prepareLoadPageRequest(FilePartitionID partitionId,
+                                             unsigned int pageSeqInPartition,
+                                             char* pageInCache,
+                                             size_t length,
+                                             PageIORequest& request) {
+    int handle = -1;
+    if (usingDirect == true) {
+        handle = this->dataHandles.at(partitionId);
+    } else if (this->dataFiles.at(partitionId) != nullptr) {
+        handle = fileno(this->dataFiles.at(partitionId));
+    }
+    if ((handle < 0) ||
+        (pageSeqInPartition >= this->getMetaData()->getPartition(partitionId)->getNumPages())) {
+        return false;
+    }
+    request.handle = handle;
+    request.buffer = pageInCache;
+    request.length = length;
+    request.offset = (off_t)pageSeqInPartition * (off_t)this->metaData->getPageSize();
+    request.isWrite = false;
+    request.result = 0;
+    return true;
+}
+
 /**
  * To load the pageId for a specified page.
  * Return the pageId, if page exists, otherwise, return (unsigned int)(-1)
@@ -36,6 +36,7 @@ SetCachePageIterator::SetCachePageIterator(PageCachePtr cache, UserSet* set) {
     this->cache = cache;
     this->set = set;
     this->iter = this->set->getDirtyPageSet()->begin();
+    this->readAhead = nullptr;
 }
 
 // remove all elements that have been flushed to disk (inCache == false)
@@ -75,21 +76,24 @@ PDBPagePtr SetCachePageIterator::next() {
             PageID pageId = this->iter->first;
             PDB_COUT << "SetCachePageIterator: not in cache: curPageId=" << pageId << "\n";
             FileSearchKey searchKey = this->iter->second;
+            PDBPagePtr page = takeFlushedPageFromReadAhead(pageId);
+            if (page == nullptr) {
 #ifdef USE_LOCALITY_SET
-            PDBPagePtr page = this->cache->getPage(this->set->getFile(),
-                                                   searchKey.partitionId,
-                                                   searchKey.pageSeqInPartition,
-                                                   pageId,
-                                                   false,
-                                                   this->set);
+                page = this->cache->getPage(this->set->getFile(),
+                                            searchKey.partitionId,
+                                            searchKey.pageSeqInPartition,
+                                            pageId,
+                                            false,
+                                            this->set);
 #else
-            PDBPagePtr page = this->cache->getPage(this->set->getFile(),
-                                                   searchKey.partitionId,
-                                                   searchKey.pageSeqInPartition,
-                                                   pageId,
-                                                   false,
-                                                   nullptr);
+                page = this->cache->getPage(this->set->getFile(),
+                                            searchKey.partitionId,
+                                            searchKey.pageSeqInPartition,
+                                            pageId,
+                                            false,
+                                            nullptr);
 #endif
+            }
             // remove iter
             this->set->lockDirtyPageSet();
             this->iter = this->set->getDirtyPageSet()->erase(this->iter);
@@ -100,6 +104,53 @@ PDBPagePtr SetCachePageIterator::next() {
     return nullptr;
 }
 
+PDBPagePtr SetCachePageIterator::takeFlushedPageFromReadAhead(PageID pageId) {
+    if (this->set->isSequential() == false) {
+        return nullptr;
+    }
+    if (this->readAhead == nullptr) {
+#ifdef USE_LOCALITY_SET
+        LocalitySet* localitySet = this->set;
+#else
+        LocalitySet* localitySet = nullptr;
+#endif
+        this->readAhead = make_shared<PageReadAhead>(
+            this->cache, this->set->getFile(), localitySet, SEQUENTIAL_SCAN_PREFETCH_DEPTH);
+    }
+    if (this->readAhead->isAsynchronous() == false) {
+        return nullptr;
+    }
+    // once the window is empty, we add the flushed pages that follow, the pages still in cache
+    // are skipped, they are returned from the cache directly.
+    // We don't hold the lock of the dirty page set while adding, since adding may evict pages,
+    // and flushing them needs the lock.
+    if (this->readAhead->isEmpty() == true) {
+        vector<pair<PageID, FileSearchKey>> flushedPages;
+        this->set->lockDirtyPageSet();
+        auto nextIter = this->iter;
+        while ((nextIter != this->set->getDirtyPageSet()->end()) &&
+               (flushedPages.size() < SEQUENTIAL_SCAN_PREFETCH_DEPTH)) {
+            if (nextIter->second.inCache == false) {
+                flushedPages.push_back(*nextIter);
+            }
+            ++nextIter;
+        }
+        this->set->unlockDirtyPageSet();
+        for (auto& flushedPage : flushedPages) {
+            if (this->readAhead->add(flushedPage.second.partitionId,
+                                     flushedPage.second.pageSeqInPartition,
+                                     flushedPage.first) == false) {
+                break;
+            }
+        }
+    }
+    // the page may not be in the window if it was flushed after we filled the window
+    if ((this->readAhead->isEmpty() == true) || (this->readAhead->getFirstPageId() != pageId)) {
+        return nullptr;
+    }
+    return this->readAhead->take();
+}
+
 bool SetCachePageIterator::hasNext() {
     if (this->iter != this->set->getDirtyPageSet()->end()) {
         return true;
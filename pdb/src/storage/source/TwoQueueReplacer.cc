@@ -0,0 +1,187 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TWO_QUEUE_REPLACER_CC
+#define TWO_QUEUE_REPLACER_CC
+
+#include "TwoQueueReplacer.h"
+
+TwoQueueReplacer::TwoQueueReplacer(size_t maxSize, size_t pageSize) {
+    pthread_mutex_init(&this->mutex, nullptr);
+    this->recentSize = 0;
+    this->maxRecentSize = (size_t)(maxSize * TWO_QUEUE_RECENT_RATIO);
+    if (pageSize == 0) {
+        pageSize = 1;
+    }
+    this->maxNumGhosts = (size_t)((maxSize / pageSize) * TWO_QUEUE_GHOST_RATIO);
+    if (this->maxNumGhosts == 0) {
+        this->maxNumGhosts = 1;
+    }
+}
+
+TwoQueueReplacer::~TwoQueueReplacer() {
+    pthread_mutex_destroy(&this->mutex);
+}
+
+size_t TwoQueueReplacer::getCachedSize(PDBPagePtr page) {
+    // the same size the PageCache accounts for a page
+    return page->getRawSize() + 512;
+}
+
+bool TwoQueueReplacer::isEvictable(PDBPagePtr page) {
+    return (page->getRefCount() == 0) && (page->isInFlush() == false);
+}
+
+void TwoQueueReplacer::addPage(CacheKey key, PDBPagePtr page) {
+    pthread_mutex_lock(&this->mutex);
+    if (this->entries.find(key) != this->entries.end()) {
+        pthread_mutex_unlock(&this->mutex);
+        return;
+    }
+    Entry entry;
+    auto ghost = this->ghostPositions.find(key);
+    if (ghost != this->ghostPositions.end()) {
+        // the page was evicted recently, so it is reused and goes to the frequent queue
+        this->ghosts.erase(ghost->second);
+        this->ghostPositions.erase(ghost);
+        entry.queue = FrequentQueue;
+        entry.position = this->frequentPages.insert(this->frequentPages.end(), page);
+    } else {
+        entry.queue = RecentQueue;
+        entry.position = this->recentPages.insert(this->recentPages.end(), page);
+        this->recentSize += getCachedSize(page);
+    }
+    this->entries[key] = entry;
+    pthread_mutex_unlock(&this->mutex);
+}
+
+void TwoQueueReplacer::accessPage(CacheKey key) {
+    // we don't wait here, the hit path should not be serialized on the replacer
+    if (pthread_mutex_trylock(&this->mutex) != 0) {
+        return;
+    }
+    auto iter = this->entries.find(key);
+    if (iter != this->entries.end()) {
+        Entry& entry = iter->second;
+        if (entry.queue == RecentQueue) {
+            // a second reference, promote the page
+            this->recentSize -= getCachedSize(*entry.position);
+            this->frequentPages.splice(this->frequentPages.end(), this->recentPages, entry.position);
+            entry.queue = FrequentQueue;
+        } else {
+            this->frequentPages.splice(
+                this->frequentPages.end(), this->frequentPages, entry.position);
+        }
+    }
+    pthread_mutex_unlock(&this->mutex);
+}
+
+void TwoQueueReplacer::addGhost(CacheKey key) {
+    if (this->ghostPositions.find(key) != this->ghostPositions.end()) {
+        return;
+    }
+    this->ghostPositions[key] = this->ghosts.insert(this->ghosts.end(), key);
+    while (this->ghosts.size() > this->maxNumGhosts) {
+        this->ghostPositions.erase(this->ghosts.front());
+        this->ghosts.pop_front();
+    }
+}
+
+void TwoQueueReplacer::removePage(CacheKey key, bool evicted) {
+    pthread_mutex_lock(&this->mutex);
+    auto iter = this->entries.find(key);
+    if (iter == this->entries.end()) {
+        pthread_mutex_unlock(&this->mutex);
+        return;
+    }
+    Entry& entry = iter->second;
+    if (entry.queue == RecentQueue) {
+        this->recentSize -= getCachedSize(*entry.position);
+        this->recentPages.erase(entry.position);
+        if (evicted == true) {
+            this->addGhost(key);
+        }
+    } else {
+        this->frequentPages.erase(entry.position);
+    }
+    this->entries.erase(iter);
+    pthread_mutex_unlock(&this->mutex);
+}
+
+vector<PDBPagePtr> TwoQueueReplacer::selectPagesForReplacement(size_t bytesToFree) {
+    vector<PDBPagePtr> pagesToEvict;
+    size_t bytesSelected = 0;
+    pthread_mutex_lock(&this->mutex);
+
+    // first the oldest pages of the recent queue, as long as it is above its share
+    auto recentIter = this->recentPages.begin();
+    size_t projectedRecentSize = this->recentSize;
+    while ((bytesSelected < bytesToFree) && (projectedRecentSize > this->maxRecentSize) &&
+           (recentIter != this->recentPages.end())) {
+        if (isEvictable(*recentIter)) {
+            pagesToEvict.push_back(*recentIter);
+            bytesSelected += getCachedSize(*recentIter);
+            projectedRecentSize -= getCachedSize(*recentIter);
+        }
+        ++recentIter;
+    }
+
+    // then the least recently used pages of the frequent queue
+    for (auto iter = this->frequentPages.begin();
+         (bytesSelected < bytesToFree) && (iter != this->frequentPages.end());
+         ++iter) {
+        if (isEvictable(*iter)) {
+            pagesToEvict.push_back(*iter);
+            bytesSelected += getCachedSize(*iter);
+        }
+    }
+
+    // if everything else is pinned, the rest of the recent queue
+    while ((bytesSelected < bytesToFree) && (recentIter != this->recentPages.end())) {
+        if (isEvictable(*recentIter)) {
+            pagesToEvict.push_back(*recentIter);
+            bytesSelected += getCachedSize(*recentIter);
+        }
+        ++recentIter;
+    }
+
+    pthread_mutex_unlock(&this->mutex);
+    return pagesToEvict;
+}
+
+size_t TwoQueueReplacer::getNumRecentPages() {
+    pthread_mutex_lock(&this->mutex);
+    size_t ret = this->recentPages.size();
+    pthread_mutex_unlock(&this->mutex);
+    return ret;
+}
+
+size_t TwoQueueReplacer::getNumFrequentPages() {
+    pthread_mutex_lock(&this->mutex);
+    size_t ret = this->frequentPages.size();
+    pthread_mutex_unlock(&this->mutex);
+    return ret;
+}
+
+size_t TwoQueueReplacer::getNumGhosts() {
+    pthread_mutex_lock(&this->mutex);
+    size_t ret = this->ghosts.size();
+    pthread_mutex_unlock(&this->mutex);
+    return ret;
+}
+
+#endif
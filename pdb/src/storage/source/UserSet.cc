@@ -245,7 +245,7 @@ void UserSet::evictPages() {
                 key.setId = this->getSetID();
                 key.pageId = curPage->getPageID();
                 curPage->resetRefCount();
-                this->pageCache->evictPage(key, false);
+                this->pageCache->evictPage(key, false, false);
             }
         }
     }
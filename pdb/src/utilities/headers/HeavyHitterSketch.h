@@ -0,0 +1,112 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef PDB_HEAVY_HITTER_SKETCH_H
+#define PDB_HEAVY_HITTER_SKETCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pdb {
+
+/*
+ * This class finds the most frequent values of a stream of hashes with a fixed number of
+ * counters, the Space-Saving way: a value that has a counter increments it, and a value that has
+ * none takes the counter of the least frequent value, whose count it inherits as its error. A
+ * value is counted at least count - error times, and any value that is more frequent than one
+ * in numCounters has a counter.
+ */
+class HeavyHitterSketch {
+
+private:
+    struct Counter {
+        size_t hash;
+        size_t count;
+        size_t error;
+    };
+
+    std::vector<Counter> counters;
+    std::unordered_map<size_t, size_t> whichCounter;
+    size_t numCounters;
+    size_t numAdded = 0;
+
+public:
+    explicit HeavyHitterSketch(size_t numCounters) : numCounters(numCounters) {
+        counters.reserve(numCounters);
+        whichCounter.reserve(numCounters * 2);
+    }
+
+    // adds the hash, and returns the number of times it was added at least
+    size_t add(size_t hash) {
+        numAdded++;
+        auto it = whichCounter.find(hash);
+        if (it != whichCounter.end()) {
+            Counter& counter = counters[it->second];
+            counter.count++;
+            return counter.count - counter.error;
+        }
+        if (counters.size() < numCounters) {
+            whichCounter[hash] = counters.size();
+            counters.push_back(Counter{hash, 1, 0});
+            return 1;
+        }
+        size_t minIndex = 0;
+        for (size_t i = 1; i < counters.size(); i++) {
+            if (counters[i].count < counters[minIndex].count) {
+                minIndex = i;
+            }
+        }
+        Counter& counter = counters[minIndex];
+        whichCounter.erase(counter.hash);
+        whichCounter[hash] = minIndex;
+        counter.hash = hash;
+        counter.error = counter.count;
+        counter.count++;
+        return 1;
+    }
+
+    // the number of times the hash was added at least
+    size_t getLowerBound(size_t hash) const {
+        auto it = whichCounter.find(hash);
+        if (it == whichCounter.end()) {
+            return 0;
+        }
+        return counters[it->second].count - counters[it->second].error;
+    }
+
+    // the hashes that were added at least minCount times, with that number
+    std::vector<std::pair<size_t, size_t>> getHeavyHitters(size_t minCount) const {
+        std::vector<std::pair<size_t, size_t>> heavyHitters;
+        for (const Counter& counter : counters) {
+            if (counter.count - counter.error >= minCount) {
+                heavyHitters.push_back(std::make_pair(counter.hash, counter.count - counter.error));
+            }
+        }
+        return heavyHitters;
+    }
+
+    size_t getNumAdded() const {
+        return numAdded;
+    }
+};
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef PDB_HYPER_LOG_LOG_H
+#define PDB_HYPER_LOG_LOG_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// a HyperLogLog has 2^HYPER_LOG_LOG_BITS registers of a byte, and estimates within about
+// 1.04 / sqrt(2^HYPER_LOG_LOG_BITS), 1.6% with 12 bits
+#ifndef HYPER_LOG_LOG_BITS
+#define HYPER_LOG_LOG_BITS 12
+#endif
+
+namespace pdb {
+
+/*
+ * This class estimates the number of distinct values of a stream of hashes in a few KB, whatever
+ * the number of values: a hash picks a register with its first bits, and the register keeps the
+ * longest run of zeros seen at the end of the rest. The hashes are mixed first, so hashes that are
+ * the values themselves, as the ones of integers are, can be added too. Two estimators of the same
+ * values can be merged.
+ */
+class HyperLogLog {
+
+private:
+    std::vector<uint8_t> registers;
+
+    static uint64_t mix(uint64_t hash) {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+public:
+    HyperLogLog() : registers((size_t)1 << HYPER_LOG_LOG_BITS, 0) {}
+
+    void add(uint64_t hash) {
+        hash = mix(hash);
+        size_t index = hash >> (64 - HYPER_LOG_LOG_BITS);
+        uint64_t rest = hash << HYPER_LOG_LOG_BITS;
+        uint8_t rank = 1;
+        while ((rank <= 64 - HYPER_LOG_LOG_BITS) && ((rest & (1ULL << 63)) == 0)) {
+            rank++;
+            rest <<= 1;
+        }
+        registers[index] = std::max(registers[index], rank);
+    }
+
+    void merge(const HyperLogLog& other) {
+        for (size_t i = 0; i < registers.size(); i++) {
+            registers[i] = std::max(registers[i], other.registers[i]);
+        }
+    }
+
+    // the estimated number of distinct values added
+    size_t getEstimate() const {
+        double m = (double)registers.size();
+        double sum = 0;
+        size_t numZeros = 0;
+        for (uint8_t r : registers) {
+            sum += std::ldexp(1.0, -(int)r);
+            numZeros += (r == 0);
+        }
+        double estimate = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+
+        // few values leave registers empty, count them by the empty registers instead
+        if ((estimate <= 2.5 * m) && (numZeros > 0)) {
+            estimate = m * std::log(m / (double)numZeros);
+        }
+        return (size_t)(estimate + 0.5);
+    }
+
+    void clear() {
+        std::fill(registers.begin(), registers.end(), 0);
+    }
+};
+}
+
+#endif
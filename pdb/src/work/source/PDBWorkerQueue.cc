@@ -25,6 +25,7 @@
 #include "NothingWork.h"
 #include <limits.h>
 #include "PDBWorkerQueue.h"
+#include "NumaTopology.h"
 
 namespace pdb {
 
@@ -174,6 +175,12 @@ void PDBWorkerQueue::addAnotherWorker(void* stackBaseIn, void* stackEndIn) {
     // pthread_attr_setdetachstate(&tattr, PTHREAD_CREATE_DETACHED);
     pthread_attr_setstack(&tattr, stackBaseIn, ((char*)stackEndIn) - (char*)stackBaseIn);
 
+    // in NUMA mode, each worker stays on one core, so that the pages it allocates from the local
+    // arena of the shared memory pool stay local to it
+    if (NumaTopology::isEnabled()) {
+        NumaTopology::setThreadCpu(&tattr, NumaTopology::getCpuOfWorker(threads.size() - 1));
+    }
+
     int return_code = pthread_create(&(threads[threads.size() - 1]), &tattr, enterTheQueue, this);
     if (return_code) {
         cout << "ERROR; return code from pthread_create () is " << return_code << '\n';
@@ -0,0 +1,236 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_BLOOM_FILTER_CC
+#define TEST_BLOOM_FILTER_CC
+
+#include <cstddef>
+#include "Ptr.h"
+#include "ComputeExecutor.h"
+#include "ComputeInfo.h"
+#include "InterfaceFunctions.h"
+#include "TupleSpec.h"
+#include "TupleSet.h"
+#include "BlockedBloomFilter.h"
+#include "RuntimeFilterExecutor.h"
+
+#include <iostream>
+#include <stdlib.h>
+
+// BlockedBloomFilter and RuntimeFilterExecutor unit test: we fill a filter with the hashes of the
+// build side of a join, the keys themselves, like the hashes of ints, and check that it never
+// drops a key that is in, that it lets through about as many of the other keys as it should
+// before and after it is shrunk, that filters merge and go through a Vector as they are, and that
+// the executor drops the tuples of the probe side that have no match, until it finds that the
+// filter does not drop enough.
+
+#define NUM_KEYS (100 * 1000)
+#define NUM_PROBES (1000 * 1000)
+#define NUM_PARTITIONS 4
+
+using namespace pdb;
+
+void fail(std::string why) {
+    std::cout << why << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// the keys of the build side are the even ones
+void checkFilter(BlockedBloomFilter& filter, double maxFalsePositives, std::string what) {
+    for (size_t key = 0; key < 2 * NUM_KEYS; key += 2) {
+        if (!filter.mayContain(key)) {
+            fail(what + ": key " + std::to_string(key) + " is not in the filter");
+        }
+    }
+    size_t numFalsePositives = 0;
+    for (size_t key = 1; key < 2 * NUM_PROBES; key += 2) {
+        numFalsePositives += filter.mayContain(key);
+    }
+    double rate = (double)numFalsePositives / (double)NUM_PROBES;
+    std::cout << what << ": " << filter.getNumBytes() << " bytes, " << rate * 100
+              << "% false positives, " << filter.estimateFalsePositiveRate() * 100
+              << "% estimated" << std::endl;
+    if (rate > maxFalsePositives) {
+        fail(what + ": too many false positives");
+    }
+}
+
+TupleSpec makeSpec(std::string name, std::vector<std::string> atts) {
+    AttList attList;
+    for (auto& att : atts) {
+        attList.appendAttribute((char*)att.c_str());
+    }
+    return TupleSpec(name, attList);
+}
+
+// a batch of the probe side: the keys, and their hashes in the last column
+TupleSetPtr makeBatch(size_t firstKey, size_t numKeys) {
+    TupleSetPtr batch = std::make_shared<TupleSet>();
+    std::vector<long>* keys = new std::vector<long>(numKeys);
+    std::vector<size_t>* hashes = new std::vector<size_t>(numKeys);
+    for (size_t i = 0; i < numKeys; i++) {
+        (*keys)[i] = firstKey + i;
+        (*hashes)[i] = firstKey + i;
+    }
+    batch->addColumn(0, keys, true);
+    batch->addColumn(1, hashes, true);
+    return batch;
+}
+
+int main(int argc, char* argv[]) {
+
+    makeObjectAllocatorBlock(64 * 1024 * 1024, true);
+
+    // a filter as large as the ones the joins start with, then shrunk to the keys
+    BlockedBloomFilter filter(JOIN_RUNTIME_FILTER_MAX_BYTES);
+    for (size_t key = 0; key < 2 * NUM_KEYS; key += 2) {
+        filter.insert(key);
+    }
+    checkFilter(filter, 0.001, "large filter");
+    filter.shrink();
+    if (filter.getNumBytes() * 8 < NUM_KEYS * JOIN_RUNTIME_FILTER_BITS_PER_KEY / 2 ||
+        filter.getNumBytes() * 8 > NUM_KEYS * JOIN_RUNTIME_FILTER_BITS_PER_KEY * 2) {
+        fail("the filter is shrunk to " + std::to_string(filter.getNumBytes()) + " bytes");
+    }
+    checkFilter(filter, 0.05, "shrunk filter");
+    if (!filter.isSelective()) {
+        fail("the shrunk filter is not selective");
+    }
+
+    // two halves of the keys merged give the same filter
+    BlockedBloomFilter lower(filter.getNumBytes());
+    BlockedBloomFilter upper(filter.getNumBytes());
+    for (size_t key = 0; key < 2 * NUM_KEYS; key += 2) {
+        if (key < NUM_KEYS) {
+            lower.insert(key);
+        } else {
+            upper.insert(key);
+        }
+    }
+    if (!lower.merge(upper) || lower.merge(BlockedBloomFilter(filter.getNumBytes() * 2))) {
+        fail("filters of the same size don't merge, or of another size do");
+    }
+    checkFilter(lower, 0.05, "merged filter");
+
+    // a filter too small for its keys is not used
+    BlockedBloomFilter tooSmall(1024);
+    for (size_t key = 0; key < 2 * NUM_KEYS; key += 2) {
+        tooSmall.insert(key);
+    }
+    if (tooSmall.isSelective()) {
+        fail("a full filter is selective");
+    }
+
+    // the filters of the partitions go through a Vector, the ones with no keys are empty
+    std::vector<BlockedBloomFilterPtr> partitions;
+    for (int i = 0; i < NUM_PARTITIONS; i++) {
+        partitions.push_back(
+            std::make_shared<BlockedBloomFilter>(JOIN_RUNTIME_FILTER_MAX_BYTES / NUM_PARTITIONS));
+    }
+    for (size_t key = 0; key < 2 * NUM_KEYS; key += 2) {
+        partitions[key % NUM_PARTITIONS]->insert(key);
+    }
+    for (auto& partition : partitions) {
+        partition->shrink();
+    }
+    partitions[1] = nullptr;
+    partitions[3] = std::make_shared<BlockedBloomFilter>(1024);
+    partitions[3]->shrink();
+    Handle<Vector<uint64_t>> words = makeObject<Vector<uint64_t>>();
+    for (auto& partition : partitions) {
+        BlockedBloomFilter::appendTo(partition, *words);
+    }
+    std::vector<BlockedBloomFilterPtr> views;
+    if (!BlockedBloomFilter::readFrom(*words, views) || views.size() != NUM_PARTITIONS) {
+        fail("the filters don't come back from the Vector");
+    }
+    if ((views[1] != nullptr) || (views[0] == nullptr) || (views[3] == nullptr) ||
+        (views[0]->getNumBlocks() != partitions[0]->getNumBlocks())) {
+        fail("the filters are not the same after the Vector");
+    }
+    for (size_t key = 0; key < 2 * NUM_PROBES; key++) {
+        if ((key % NUM_PARTITIONS == 0) &&
+            (views[0]->mayContain(key) != partitions[0]->mayContain(key))) {
+            fail("the filter of partition 0 is not the same after the Vector");
+        }
+        if ((key % NUM_PARTITIONS == 3) && views[3]->mayContain(key)) {
+            fail("the empty filter of partition 3 lets key " + std::to_string(key) + " through");
+        }
+    }
+    Handle<Vector<uint64_t>> broken = makeObject<Vector<uint64_t>>();
+    broken->push_back(4);
+    broken->push_back(0);
+    std::vector<BlockedBloomFilterPtr> none;
+    if (BlockedBloomFilter::readFrom(*broken, none)) {
+        fail("a Vector that is cut short is read");
+    }
+
+    // the executor keeps the even keys of partitions 0 and 2, and all of the keys of partition 1
+    TupleSpec schema = makeSpec("hashed", {"key", "hash"});
+    RuntimeFilterExecutor executor(schema, views);
+    TupleSetPtr output = executor.process(makeBatch(0, NUM_KEYS));
+    std::vector<long>& keys = output->getColumn<long>(0);
+    std::vector<size_t>& hashes = output->getColumn<size_t>(1);
+    size_t numMatches = 0;
+    size_t last = 0;
+    for (size_t i = 0; i < keys.size(); i++) {
+        if ((size_t)keys[i] != hashes[i] || (i > 0 && (size_t)keys[i] <= last)) {
+            fail("the columns don't line up after the filter");
+        }
+        last = keys[i];
+        if (keys[i] % NUM_PARTITIONS == 3) {
+            fail("key " + std::to_string(keys[i]) + " of the empty partition got through");
+        }
+        numMatches += (keys[i] % NUM_PARTITIONS == 1) ||
+            ((keys[i] % 2 == 0) && (keys[i] < 2 * NUM_KEYS));
+    }
+    if (numMatches != NUM_KEYS / NUM_PARTITIONS * 3) {
+        fail("the filter dropped a key that has a match");
+    }
+    if (keys.size() > numMatches * 1.05) {
+        fail("the filter let " + std::to_string(keys.size() - numMatches) + " keys through");
+    }
+    std::cout << "kept " << keys.size() << " out of " << NUM_KEYS << " tuples, " << numMatches
+              << " have a match" << std::endl;
+
+    // a filter that drops next to nothing is turned off after the first tuples it looks at
+    BlockedBloomFilterPtr almostAll = std::make_shared<BlockedBloomFilter>(1024 * 1024);
+    for (size_t key = 0; key < NUM_PROBES; key++) {
+        if (key % 50 != 0) {
+            almostAll->insert(key);
+        }
+    }
+    std::vector<BlockedBloomFilterPtr> oneFilter = {almostAll};
+    RuntimeFilterExecutor lazyExecutor(schema, oneFilter);
+    size_t numKept = lazyExecutor.process(makeBatch(0, JOIN_RUNTIME_FILTER_CHECK_ROWS))
+                         ->getColumn<long>(0)
+                         .size();
+    if (numKept == JOIN_RUNTIME_FILTER_CHECK_ROWS) {
+        fail("the filter dropped nothing");
+    }
+    numKept = lazyExecutor.process(makeBatch(0, JOIN_RUNTIME_FILTER_CHECK_ROWS))
+                  ->getColumn<long>(0)
+                  .size();
+    if (numKept != JOIN_RUNTIME_FILTER_CHECK_ROWS) {
+        fail("the filter is still on after it dropped next to nothing");
+    }
+
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
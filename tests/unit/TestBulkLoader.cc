@@ -0,0 +1,333 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_BULK_LOADER_CC
+#define TEST_BULK_LOADER_CC
+
+#include "BulkLoader.h"
+#include "DataTypes.h"
+#include "DispatcherAddPages.h"
+#include "PageCodec.h"
+#include "PDBCommunicator.h"
+#include "GetListOfNodes.h"
+#include "ListOfNodes.h"
+#include "StorageAddObjectInLoop.h"
+#include "SimpleRequestResult.h"
+#include "StringIntPair.h"
+#include "InterfaceFunctions.h"
+#include "UseTemporaryAllocationBlock.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// BulkLoader unit test and benchmark: child processes play the manager, which only tells where the
+// workers are and which types the set takes, and the storage servers of the workers, which check
+// every page they get and take some time to store it. We check that every object is stored once,
+// that an object that does not fit in a page makes the load fail, that a type the set does not
+// take makes the load fail before any page is sent, and compare the time to load the set with one
+// thread and one page in flight to one worker (as the dispatcher does, one vector at a time) with
+// the time taken with BULK_LOAD_THREADS threads to NUM_WORKERS workers.
+
+#define NUM_OBJECTS 200000
+#define NUM_WORKERS 4
+#define PAGE_SIZE (256 * 1024)
+#define STORE_MICROS 2000
+
+using namespace pdb;
+
+// listens on a local port, returns the socket and puts the port in port
+int listenOnLocalPort(int& port) {
+    int listenFD = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if ((bind(listenFD, (struct sockaddr*)&address, sizeof(address)) < 0) ||
+        (listen(listenFD, 1) < 0) ||
+        (getsockname(listenFD, (struct sockaddr*)&address, &length) < 0)) {
+        std::cout << "can't listen on a local port" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    port = ntohs(address.sin_port);
+    return listenFD;
+}
+
+// the manager: returns the exit code of the child process
+int listWorkers(int listenFD, std::vector<std::string> workers) {
+    PDBLoggerPtr logger = make_shared<PDBLogger>("testBulkLoaderManager.log");
+    PDBCommunicatorPtr checker = make_shared<PDBCommunicator>();
+    std::string errMsg;
+    if (checker->pointToInternet(logger, listenFD, errMsg)) {
+        return 1;
+    }
+    const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+    bool success;
+    Handle<DispatcherAddPages> check = checker->getNextObject<DispatcherAddPages>(success, errMsg);
+    if ((success == false) || (check->getNumPages() != 0)) {
+        return 2;
+    }
+    bool takesType = (check->getSetName() == "load_set") && (check->getTypeName() == "load_type");
+    Handle<SimpleRequestResult> checked = makeObject<SimpleRequestResult>(
+        takesType, std::string(takesType ? "" : "the set stores load_type"));
+    if (checker->sendObject(checked, errMsg) == false) {
+        return 3;
+    }
+    if (takesType == false) {
+        return 0;
+    }
+
+    PDBCommunicatorPtr communicator = make_shared<PDBCommunicator>();
+    if (communicator->pointToInternet(logger, listenFD, errMsg)) {
+        return 1;
+    }
+    communicator->getNextObject<GetListOfNodes>(success, errMsg);
+    if (success == false) {
+        return 2;
+    }
+    Handle<Vector<String>> hostNames = makeObject<Vector<String>>();
+    for (std::string& worker : workers) {
+        hostNames->push_back(String(worker));
+    }
+    Handle<ListOfNodes> nodes = makeObject<ListOfNodes>();
+    nodes->setHostNames(hostNames);
+    return communicator->sendObject(nodes, errMsg) ? 0 : 3;
+}
+
+// the storage server of a worker: writes how many times it got every object to a file, and
+// returns the exit code of the child process
+int storePages(int listenFD, int worker) {
+    PDBLoggerPtr logger = make_shared<PDBLogger>("testBulkLoaderWorker.log");
+    PDBCommunicatorPtr communicator = make_shared<PDBCommunicator>();
+    std::string errMsg;
+    if (communicator->pointToInternet(logger, listenFD, errMsg)) {
+        return 1;
+    }
+    int noDelay = 1;
+    setsockopt(communicator->getSocketFD(), IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+    Handle<SimpleRequestResult> ack = makeObject<SimpleRequestResult>(true, std::string(""));
+    std::vector<unsigned char> numSeen(NUM_OBJECTS, 0);
+    size_t pageHeaderSize = sizeof(NodeID) + sizeof(DatabaseID) + sizeof(UserTypeID) +
+        sizeof(SetID) + sizeof(PageID) + sizeof(int) + sizeof(size_t);
+    char* requestBytes = (char*)malloc(1024);
+    char* page = (char*)malloc(PAGE_SIZE);
+    int exitCode = 0;
+    while (true) {
+        bool success;
+        size_t numBytes = communicator->getSizeOfNextObject();
+        if ((numBytes == 0) || (numBytes > 1024)) {
+            exitCode = 2;
+            break;
+        }
+        Handle<StorageAddObjectInLoop> request =
+            communicator->getNextObject<StorageAddObjectInLoop>(requestBytes, success, errMsg);
+        if (success == false) {
+            exitCode = 2;
+            break;
+        }
+        if (request->isLoopEnded()) {
+            communicator->sendObject(ack, errMsg);
+            break;
+        }
+        if ((request->isStoreAsPage() == false) || (request->getSetName() != "load_set")) {
+            exitCode = 3;
+            break;
+        }
+        PageFrameHeader header;
+        if ((PageCodec::receiveHeader(communicator, header, errMsg) == false) ||
+            (header.numBytes + pageHeaderSize > PAGE_SIZE) ||
+            (PageCodec::receivePage(communicator, header, page, errMsg) == false)) {
+            exitCode = 4;
+            break;
+        }
+        Handle<Vector<Handle<StringIntPair>>> objects =
+            ((Record<Vector<Handle<StringIntPair>>>*)page)->getRootObject();
+        for (int i = 0; i < objects->size(); i++) {
+            int myInt = (*objects)[i]->myInt;
+            if ((myInt < 0) || (myInt >= NUM_OBJECTS) ||
+                (*((*objects)[i]->myString) != "object_" + std::to_string(myInt))) {
+                exitCode = 5;
+                break;
+            }
+            numSeen[myInt]++;
+        }
+        usleep(STORE_MICROS);
+        if ((exitCode != 0) || (communicator->sendObject(ack, errMsg) == false)) {
+            break;
+        }
+    }
+    free(page);
+    free(requestBytes);
+    std::ofstream out("testBulkLoaderWorker" + std::to_string(worker) + ".seen",
+                      std::ios::binary | std::ios::trunc);
+    out.write((char*)numSeen.data(), NUM_OBJECTS);
+    return exitCode;
+}
+
+// loads the objects with the given number of threads, returns the seconds taken; exits if the
+// load does not do what it should. Objects with a name longer than a page can't be loaded, and the
+// set only takes objects of load_type.
+double loadObjects(int numWorkers,
+                   int numThreads,
+                   int numCredits,
+                   size_t nameSize,
+                   std::string typeName = "load_type") {
+
+    std::vector<std::string> workers;
+    std::vector<pid_t> children;
+    // the children leave with _exit, they must not wait for the threads of the loader, which are
+    // not theirs
+    for (int w = 0; w < numWorkers; w++) {
+        int port;
+        int listenFD = listenOnLocalPort(port);
+        pid_t child = fork();
+        if (child == 0) {
+            _exit(storePages(listenFD, w));
+        }
+        close(listenFD);
+        children.push_back(child);
+        workers.push_back("127.0.0.1:" + std::to_string(port));
+    }
+    int managerPort;
+    int listenFD = listenOnLocalPort(managerPort);
+    pid_t manager = fork();
+    if (manager == 0) {
+        _exit(listWorkers(listenFD, workers));
+    }
+    close(listenFD);
+    children.push_back(manager);
+
+    // every thread makes its share of the objects; the object that did not fit in a page is made
+    // again on the next one
+    std::vector<int> nextObject(numThreads);
+    for (int t = 0; t < numThreads; t++) {
+        nextObject[t] = t * (NUM_OBJECTS / numThreads);
+    }
+    BulkLoadFiller filler = [&](int threadId, Handle<Vector<Handle<Object>>> page) {
+        int end = (threadId == numThreads - 1) ? NUM_OBJECTS
+                                               : (threadId + 1) * (NUM_OBJECTS / numThreads);
+        while (nextObject[threadId] < end) {
+            int i = nextObject[threadId];
+            std::string name = "object_" + std::to_string(i);
+            if (name.size() < nameSize) {
+                name.resize(nameSize, '_');
+            }
+            page->push_back(makeObject<StringIntPair>(name, i));
+            nextObject[threadId]++;
+        }
+        return false;
+    };
+
+    PDBLoggerPtr logger = make_shared<PDBLogger>("testBulkLoader.log");
+    BulkLoader loader(logger, managerPort, "127.0.0.1", numThreads, numCredits);
+    std::string errMsg;
+    auto begin = std::chrono::steady_clock::now();
+    bool success = loader.load("load_db", "load_set", typeName, filler, PAGE_SIZE, errMsg);
+    auto end = std::chrono::steady_clock::now();
+
+    for (int c = 0; c < children.size(); c++) {
+        int status;
+        waitpid(children[c], &status, 0);
+        int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        if (exitCode != 0) {
+            std::cout << "child " << c << " failed with exit code " << exitCode << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (typeName != "load_type") {
+        if (success || (loader.getNumPagesSent() != 0) || (nextObject[0] != 0)) {
+            std::cout << "loaded objects of a type the set does not take" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::cout << "a load of a type the set does not take failed: " << errMsg << std::endl;
+        return 0;
+    }
+    if (nameSize >= PAGE_SIZE) {
+        if (success) {
+            std::cout << "loaded objects that do not fit in a page" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        std::cout << "a load of objects larger than a page failed: " << errMsg << std::endl;
+        return 0;
+    }
+    if (success == false) {
+        std::cout << "the load failed: " << errMsg << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<int> numSeen(NUM_OBJECTS, 0);
+    std::vector<unsigned char> workerSeen(NUM_OBJECTS);
+    for (int w = 0; w < numWorkers; w++) {
+        std::string fileName = "testBulkLoaderWorker" + std::to_string(w) + ".seen";
+        std::ifstream in(fileName, std::ios::binary);
+        in.read((char*)workerSeen.data(), NUM_OBJECTS);
+        for (int i = 0; i < NUM_OBJECTS; i++) {
+            numSeen[i] += workerSeen[i];
+        }
+        in.close();
+        unlink(fileName.c_str());
+    }
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        if (numSeen[i] != 1) {
+            std::cout << "object " << i << " was stored " << numSeen[i] << " times" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (loader.getNumPagesSent() < numWorkers) {
+        std::cout << "sent only " << loader.getNumPagesSent() << " pages" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::cout << loader.getNumPagesSent() << " pages with " << loader.getNumBytesSent()
+              << " bytes to " << numWorkers << " workers with " << numThreads << " threads and "
+              << numCredits << " pages in flight: "
+              << std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count()
+              << " s" << std::endl;
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+}
+
+int main(int argc, char* argv[]) {
+
+    // a worker may close the connection while we are sending
+    signal(SIGPIPE, SIG_IGN);
+
+    double oneAtATimeSeconds = loadObjects(1, 1, 1, 0);
+    double bulkSeconds = loadObjects(NUM_WORKERS, BULK_LOAD_THREADS, SHUFFLE_CHANNEL_CREDITS, 0);
+    loadObjects(NUM_WORKERS, BULK_LOAD_THREADS, SHUFFLE_CHANNEL_CREDITS, PAGE_SIZE);
+    // the storage servers never get a connection, so there are none
+    loadObjects(0, BULK_LOAD_THREADS, SHUFFLE_CHANNEL_CREDITS, 0, "other_type");
+
+    std::cout << "speedup: " << oneAtATimeSeconds / bulkSeconds << "x" << std::endl;
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
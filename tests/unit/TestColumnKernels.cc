@@ -0,0 +1,354 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_COLUMN_KERNELS_CC
+#define TEST_COLUMN_KERNELS_CC
+
+#include <cstddef>
+#include <iostream>
+#include "Ptr.h"
+#include "ComputeSource.h"
+#include "ComputeSink.h"
+#include "ComputeExecutor.h"
+#include "ComputeInfo.h"
+#include "InterfaceFunctions.h"
+#include "TupleSpec.h"
+#include "TupleSet.h"
+#include "TupleSetMachine.h"
+#include "Lambda.h"
+#include "EqualsLambda.h"
+#include "AndLambda.h"
+#include "ColumnKernels.h"
+
+#include <chrono>
+#include <stdlib.h>
+
+// ColumnKernels unit test and benchmark: checks every kernel against the scalar operators for
+// every instruction set the CPU has, then runs the executors of EqualsLambda, AndLambda and the
+// join hashers over 1M row TupleSets and compares them with the tuple at a time loops they used
+// to run.
+
+#define NUM_ROWS (1024 * 1024)
+#define NUM_BATCHES 20
+
+using namespace pdb;
+
+// a leaf that just names a column, so that we can build the lambdas around it
+template <class T>
+class ColumnLambda : public TypedLambdaObject<T> {
+
+public:
+    explicit ColumnLambda(int input) {
+        this->setInputIndex(0, input);
+    }
+
+    unsigned int getNumInputs() override {
+        return 1;
+    }
+
+    ComputeExecutorPtr getExecutor(TupleSpec& inputSchema,
+                                   TupleSpec& attsToOperateOn,
+                                   TupleSpec& attsToIncludeInOutput) override {
+        return nullptr;
+    }
+
+    std::string getTypeOfLambda() override {
+        return "column";
+    }
+
+    int getNumChildren() override {
+        return 0;
+    }
+
+    GenericLambdaObjectPtr getChild(int which) override {
+        return nullptr;
+    }
+
+    std::map<std::string, std::string> getInfo() override {
+        return std::map<std::string, std::string>();
+    }
+};
+
+TupleSpec makeSpec(std::string name, std::vector<std::string> atts) {
+    AttList attList;
+    for (auto& att : atts) {
+        attList.appendAttribute((char*)att.c_str());
+    }
+    return TupleSpec(name, attList);
+}
+
+void fail(std::string what) {
+    std::cout << what << " is wrong with the " << columnKernelLevelToString(getColumnKernelLevel())
+              << " kernels!" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// values from a small range so that there are plenty of ties
+template <class T>
+std::vector<T> randomColumn(size_t numRows, unsigned int seed) {
+    std::vector<T> column(numRows);
+    for (size_t i = 0; i < numRows; i++) {
+        column[i] = (T)(rand_r(&seed) % 64) - 32;
+    }
+    return column;
+}
+
+std::vector<bool> randomMask(size_t numRows, unsigned int seed) {
+    std::vector<bool> mask(numRows);
+    for (size_t i = 0; i < numRows; i++) {
+        mask[i] = rand_r(&seed) % 3 != 0;
+    }
+    return mask;
+}
+
+template <ColumnComparison op, class T>
+void checkComparison(size_t numRows) {
+    std::vector<T> lhs = randomColumn<T>(numRows, 1);
+    std::vector<T> rhs = randomColumn<T>(numRows, 2);
+    std::vector<bool> out;
+    if (!compareColumns(op, lhs, rhs, out) || out.size() != numRows) {
+        fail("the size of a comparison");
+    }
+    for (size_t i = 0; i < numRows; i++) {
+        if (out[i] != compareValues<op>(lhs[i], rhs[i])) {
+            fail("comparing " + getTypeName<T>());
+        }
+    }
+}
+
+template <class T>
+void checkHash(size_t numRows) {
+    std::vector<T> in = randomColumn<T>(numRows, 3);
+    if (numRows > 0) {
+        // one of the inputs that hashes to UNUSED
+        in[numRows / 2] = std::is_same<T, int64_t>::value ? UNUSED : 0;
+    }
+    std::vector<size_t> out;
+    if (!hashColumn(in, out) || out.size() != numRows) {
+        fail("the size of a hash");
+    }
+    for (size_t i = 0; i < numRows; i++) {
+        if (out[i] != Hasher<T>::hash(in[i])) {
+            fail("hashing " + getTypeName<T>());
+        }
+    }
+}
+
+void checkMasks(size_t numRows) {
+    std::vector<bool> lhs = randomMask(numRows, 4);
+    std::vector<bool> rhs = randomMask(numRows, 5);
+    std::vector<bool> andOut, orOut;
+    if (!andColumns(lhs, rhs, andOut) || !orColumns(lhs, rhs, orOut)) {
+        fail("combining masks");
+    }
+    std::vector<uint32_t> rows;
+    selectMaskedRows(lhs, rows);
+    size_t numSelected = 0;
+    for (size_t i = 0; i < numRows; i++) {
+        if ((andOut[i] != (lhs[i] && rhs[i])) || (orOut[i] != (lhs[i] || rhs[i]))) {
+            fail("AND and OR");
+        }
+        if (lhs[i] && (numSelected >= rows.size() || rows[numSelected++] != i)) {
+            fail("selecting rows");
+        }
+    }
+    if (numSelected != rows.size()) {
+        fail("selecting rows");
+    }
+}
+
+void checkKernels() {
+    std::vector<size_t> sizes = {0, 1, 7, 63, 64, 65, 130, 1000, 100003};
+    for (size_t numRows : sizes) {
+        checkComparison<ColumnEquals, int>(numRows);
+        checkComparison<ColumnLessThan, int>(numRows);
+        checkComparison<ColumnGreaterThan, int>(numRows);
+        checkComparison<ColumnEquals, long>(numRows);
+        checkComparison<ColumnLessThan, long>(numRows);
+        checkComparison<ColumnGreaterThan, long>(numRows);
+        checkComparison<ColumnEquals, double>(numRows);
+        checkComparison<ColumnLessThan, double>(numRows);
+        checkComparison<ColumnGreaterThan, double>(numRows);
+        checkHash<int>(numRows);
+        checkHash<long>(numRows);
+        checkMasks(numRows);
+    }
+}
+
+// the loops the lambdas used to run, the baseline
+struct EqualsLoop {
+    template <class T>
+    static void run(std::vector<T>& lhs, std::vector<T>& rhs, std::vector<bool>& out) {
+        int numTuples = lhs.size();
+        out.resize(numTuples);
+        for (int i = 0; i < numTuples; i++) {
+            out[i] = checkEquals(lhs[i], rhs[i]);
+        }
+    }
+};
+
+struct AndLoop {
+    template <class T>
+    static void run(std::vector<T>& lhs, std::vector<T>& rhs, std::vector<bool>& out) {
+        int numTuples = lhs.size();
+        out.resize(numTuples);
+        for (int i = 0; i < numTuples; i++) {
+            out[i] = checkAnd(lhs[i], rhs[i]);
+        }
+    }
+};
+
+struct HashLoop {
+    template <class T>
+    static void run(std::vector<T>& lhs, std::vector<T>& rhs, std::vector<size_t>& out) {
+        int numTuples = lhs.size();
+        out.resize(numTuples);
+        for (int i = 0; i < numTuples; i++) {
+            out[i] = hashHim(lhs[i]);
+        }
+    }
+};
+
+template <class T, class Out, class Loop>
+ComputeExecutorPtr getTupleAtATimeExecutor(TupleSpec& inputSchema,
+                                           TupleSpec& attsToOperateOn,
+                                           TupleSpec& attsToIncludeInOutput) {
+    TupleSetPtr output = std::make_shared<TupleSet>();
+    TupleSetSetupMachinePtr myMachine =
+        std::make_shared<TupleSetSetupMachine>(inputSchema, attsToIncludeInOutput);
+    std::vector<int> inputAtts = myMachine->match(attsToOperateOn);
+    int outAtt = attsToIncludeInOutput.getAtts().size();
+    return std::make_shared<SimpleComputeExecutor>(
+        output,
+        [=](TupleSetPtr input) {
+            myMachine->setup(input, output);
+            std::vector<T>& leftColumn = input->getColumn<T>(inputAtts[0]);
+            std::vector<T>& rightColumn = input->getColumn<T>(inputAtts[inputAtts.size() - 1]);
+            if (!output->hasColumn(outAtt)) {
+                output->addColumn(outAtt, new std::vector<Out>, true);
+            }
+            Loop::run(leftColumn, rightColumn, output->getColumn<Out>(outAtt));
+            return output;
+        },
+        "tupleAtATime");
+}
+
+// pushes the batches through the executor, returns the time it took and the last output column
+template <class Out>
+double runExecutor(ComputeExecutorPtr executor, TupleSetPtr input, std::vector<Out>& result) {
+    auto begin = std::chrono::steady_clock::now();
+    TupleSetPtr output;
+    for (int batch = 0; batch < NUM_BATCHES; batch++) {
+        output = executor->process(input);
+    }
+    auto end = std::chrono::steady_clock::now();
+    result = output->getColumn<Out>(2);
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+}
+
+template <class T, class Out, class Loop>
+void benchmark(std::string name,
+               std::function<ComputeExecutorPtr(TupleSpec&, TupleSpec&, TupleSpec&)> makeExecutor,
+               TupleSetPtr input) {
+
+    TupleSpec inputAtts = makeSpec("in", {"a", "b"});
+    TupleSpec operateOn = makeSpec("in", std::is_same<Loop, HashLoop>::value
+                                             ? std::vector<std::string>{"a"}
+                                             : std::vector<std::string>{"a", "b"});
+
+    std::vector<Out> expected, result;
+    ComputeExecutorPtr baseline =
+        getTupleAtATimeExecutor<T, Out, Loop>(inputAtts, operateOn, inputAtts);
+    double baselineSeconds = runExecutor(baseline, input, expected);
+    std::cout << name << ": tuple at a time " << baselineSeconds << "s";
+
+    ColumnKernelLevel supported = detectColumnKernelLevel();
+    for (int level = ScalarKernels; level <= supported; level++) {
+        setColumnKernelLevel((ColumnKernelLevel)level);
+        double seconds = runExecutor(makeExecutor(inputAtts, operateOn, inputAtts), input, result);
+        if (result != expected) {
+            fail(name);
+        }
+        std::cout << ", " << columnKernelLevelToString((ColumnKernelLevel)level) << " " << seconds
+                  << "s (" << baselineSeconds / seconds << "x)";
+    }
+    std::cout << std::endl;
+}
+
+template <class T>
+TupleSetPtr makeInput() {
+    TupleSetPtr input = std::make_shared<TupleSet>();
+    input->addColumn(0, new std::vector<T>(randomColumn<T>(NUM_ROWS, 6)), true);
+    input->addColumn(1, new std::vector<T>(randomColumn<T>(NUM_ROWS, 7)), true);
+    return input;
+}
+
+template <class T>
+void benchmarkEquals(std::string typeName) {
+    LambdaTree<T> lhs(std::make_shared<ColumnLambda<T>>(0));
+    LambdaTree<T> rhs(std::make_shared<ColumnLambda<T>>(1));
+    auto lambda = std::make_shared<EqualsLambda<T, T>>(lhs, rhs);
+    TupleSetPtr input = makeInput<T>();
+    benchmark<T, bool, EqualsLoop>(
+        typeName + " ==",
+        [&](TupleSpec& a, TupleSpec& b, TupleSpec& c) { return lambda->getExecutor(a, b, c); },
+        input);
+    if (IsHashKernelType<T>::value) {
+        benchmark<T, size_t, HashLoop>(
+            typeName + " hash",
+            [&](TupleSpec& a, TupleSpec& b, TupleSpec& c) {
+                return lambda->getLeftHasher(a, b, c);
+            },
+            input);
+    }
+}
+
+void benchmarkAnd() {
+    LambdaTree<bool> lhs(std::make_shared<ColumnLambda<bool>>(0));
+    LambdaTree<bool> rhs(std::make_shared<ColumnLambda<bool>>(1));
+    auto lambda = std::make_shared<AndLambda<bool, bool>>(lhs, rhs);
+    TupleSetPtr input = std::make_shared<TupleSet>();
+    input->addColumn(0, new std::vector<bool>(randomMask(NUM_ROWS, 8)), true);
+    input->addColumn(1, new std::vector<bool>(randomMask(NUM_ROWS, 9)), true);
+    benchmark<bool, bool, AndLoop>(
+        "bool &&",
+        [&](TupleSpec& a, TupleSpec& b, TupleSpec& c) { return lambda->getExecutor(a, b, c); },
+        input);
+}
+
+int main(int argc, char* argv[]) {
+
+    makeObjectAllocatorBlock(16 * 1024 * 1024, true);
+
+    ColumnKernelLevel supported = detectColumnKernelLevel();
+    std::cout << "the CPU supports the " << columnKernelLevelToString(supported) << " kernels"
+              << std::endl;
+    for (int level = ScalarKernels; level <= supported; level++) {
+        setColumnKernelLevel((ColumnKernelLevel)level);
+        checkKernels();
+    }
+
+    benchmarkEquals<int>("int");
+    benchmarkEquals<long>("long");
+    benchmarkEquals<double>("double");
+    benchmarkAnd();
+
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,178 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_COST_MODEL_CC
+#define TEST_COST_MODEL_CC
+
+#include "CostModel.h"
+#include "AtomicComputationClasses.h"
+#include "HyperLogLog.h"
+#include "InterfaceFunctions.h"
+#include "UseTemporaryAllocationBlock.h"
+
+#include <cmath>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+
+// CostModel unit test: the tuple sets of a plan that joins a large set with a small one on a key
+// and filters the result are estimated from the statistics of the sets, with and without the
+// distinct keys counted by the clients and the selectivities learned from the filters that ran,
+// and we check that a small side is broadcasted, that a side whose hash table does not fit on a
+// node never is, that two large sides are shuffled, and that a shuffle that spills costs more
+// than its bytes. The HyperLogLog the clients count the keys with is checked too.
+
+#define MB (1024.0 * 1024.0)
+#define GB (1024.0 * MB)
+
+using namespace pdb;
+
+// inA -> keyA -> hashA, inB -> keyB -> hashB, JOIN(hashA, hashB) -> joined -> eq -> filtered
+LogicalPlanPtr makePlan() {
+
+    AtomicComputationList computations;
+    auto add = [&](AtomicComputationPtr computation) {
+        computation->setShared(computation);
+        computations.addAtomicComputation(computation);
+        return computation;
+    };
+    TupleSpec inA("inA"), keyA("keyA"), hashA("hashA");
+    TupleSpec inB("inB"), keyB("keyB"), hashB("hashB");
+    TupleSpec joined("joined"), eq("eq"), filtered("filtered");
+
+    add(std::make_shared<ScanSet>(inA, "db", "large", "ScanA"));
+    auto keyOfA = add(std::make_shared<ApplyLambda>(inA, keyA, inA, "JoinComp", "attAccess_0"));
+    (*keyOfA->getKeyValuePairs())["attName"] = "myInt";
+    add(std::make_shared<HashLeft>(keyA, hashA, inA, "JoinComp", "attAccess_0"));
+
+    add(std::make_shared<ScanSet>(inB, "db", "small", "ScanB"));
+    auto keyOfB = add(std::make_shared<ApplyLambda>(inB, keyB, inB, "JoinComp", "attAccess_1"));
+    (*keyOfB->getKeyValuePairs())["attName"] = "myInt";
+    add(std::make_shared<HashRight>(keyB, hashB, inB, "JoinComp", "attAccess_1"));
+
+    add(std::make_shared<ApplyJoin>(joined, hashA, hashB, hashA, hashB, "JoinComp"));
+    auto predicate = add(std::make_shared<ApplyLambda>(joined, eq, joined, "JoinComp", "==_2"));
+    (*predicate->getKeyValuePairs())["lambdaType"] = "==";
+    add(std::make_shared<ApplyFilter>(eq, filtered, joined, "JoinComp"));
+
+    Vector<Handle<Computation>> noComputations;
+    return std::make_shared<LogicalPlan>(computations, noComputations);
+}
+
+bool isNear(double value, double expected) {
+    return std::fabs(value - expected) <= 0.01 * expected;
+}
+
+void check(bool ok, std::string what) {
+    if (!ok) {
+        std::cout << what << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+    LogicalPlanPtr plan = makePlan();
+
+    // a million tuples of 100 bytes join ten thousand, ten nodes with 64GB
+    StatisticsPtr stats = std::make_shared<Statistics>();
+    stats->setNumBytes("db", "large", 100 * 1000000);
+    stats->setNumTuples("db", "large", 1000000);
+    stats->setNumBytes("db", "small", 100 * 10000);
+    stats->setNumTuples("db", "small", 10000);
+    stats->setClusterResources(10, 64 * 1024 * 1024);
+
+    // without the keys the small side is taken to have unique keys
+    CostModel withoutKeys(stats, plan);
+    CostEstimate joinedEstimate = withoutKeys.getTupleSetEstimate("joined");
+    check(isNear(joinedEstimate.numTuples, 1000000) && isNear(joinedEstimate.numBytes, 200 * 1000000),
+          "wrong estimate of a join on a foreign key: " + std::to_string(joinedEstimate.numTuples));
+
+    // with them, the tuples of a key meet the tuples of the key on the other side
+    stats->setNumDistinctKeys("db", "large", "myInt", 1000);
+    stats->setNumDistinctKeys("db", "small", "myInt", 100);
+    CostModel withKeys(stats, plan);
+    joinedEstimate = withKeys.getTupleSetEstimate("joined");
+    check(isNear(joinedEstimate.numTuples, 10000000),
+          "wrong estimate of a join with distinct keys: " + std::to_string(joinedEstimate.numTuples));
+
+    // an equality keeps its default part of the tuples until a filter with one has run
+    CostEstimate filteredEstimate = withKeys.getTupleSetEstimate("filtered");
+    check(isNear(filteredEstimate.numTuples, COST_MODEL_EQUALITY_SELECTIVITY * 10000000),
+          "wrong estimate of a filter");
+    stats->setLambdaSelectivity("==", 0.5);
+    CostModel learned(stats, plan);
+    check(isNear(learned.getTupleSetEstimate("filtered").numTuples, 0.5 * 10000000),
+          "the learned selectivity was not used");
+
+    // a pipeline costs nothing without bytes, and more with more
+    check(learned.getPipelineCost(CostEstimate(), CostEstimate()) == 0, "an empty pipeline costs");
+    CostEstimate small, medium, large, huge;
+    small.numBytes = 10 * MB;
+    medium.numBytes = 2 * GB;
+    large.numBytes = 100 * GB;
+    huge.numBytes = 1000 * GB;
+    check(learned.getPipelineCost(small, small) < learned.getPipelineCost(large, small),
+          "a larger pipeline is not more expensive");
+
+    // a small side is broadcasted to a large one
+    check(learned.preferBroadcast(small, large), "a small side was not broadcasted");
+
+    // a hash table that does not fit on a node is never broadcasted
+    check(std::isinf(learned.getBroadcastJoinCost(large, huge)), "a large side can be broadcasted");
+    check(!learned.preferBroadcast(large, huge), "a large side was broadcasted");
+    check(!std::isinf(learned.getJoinCost(large, huge)), "a large join can not be run");
+
+    // two sides of the same size are cheaper to shuffle over ten nodes
+    check(!learned.preferBroadcast(medium, medium), "two medium sides were not shuffled");
+
+    // building on the smaller side is cheaper
+    check(learned.getJoinCost(small, large) < learned.getJoinCost(large, small),
+          "the larger side is cheaper to build on");
+
+    // the hash tables of a partition of 100GB fit on a node, the ones of 1000GB spill
+    double largeCost = learned.getShuffleJoinCost(large, large);
+    double hugeCost = learned.getShuffleJoinCost(huge, huge);
+    check(hugeCost > 10 * largeCost, "a shuffle that spills costs no more than its bytes");
+    std::cout << "broadcast 10MB to 100GB: " << learned.getBroadcastJoinCost(small, large)
+              << " s, shuffle: " << learned.getShuffleJoinCost(small, large) << " s" << std::endl;
+    std::cout << "shuffle 100GB with 100GB: " << largeCost << " s, 1000GB with 1000GB: "
+              << hugeCost << " s" << std::endl;
+
+    // the distinct values, counted twice, added to two estimators that are merged, and a few
+    HyperLogLog first, second, few;
+    for (uint64_t i = 0; i < 100000; i++) {
+        first.add(i);
+        (i % 2 == 0 ? first : second).add(i);
+    }
+    first.merge(second);
+    for (uint64_t i = 0; i < 100; i++) {
+        few.add(i * 7919);
+    }
+    check(std::fabs((double)first.getEstimate() - 100000) < 5000 &&
+              std::fabs((double)few.getEstimate() - 100) < 5,
+          "wrong number of distinct values: " + std::to_string(first.getEstimate()) + " and " +
+              std::to_string(few.getEstimate()));
+    few.clear();
+    check(few.getEstimate() == 0, "a cleared estimator is not empty");
+
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
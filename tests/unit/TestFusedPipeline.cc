@@ -0,0 +1,230 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_FUSED_PIPELINE_CC
+#define TEST_FUSED_PIPELINE_CC
+
+#include "Lambda.h"
+#include "LambdaCreationFunctions.h"
+#include "SelectionComp.h"
+#include "ScanUserSet.h"
+#include "StringIntPair.h"
+#include "WriteStringIntPairSet.h"
+#include "QueryGraphAnalyzer.h"
+#include "ComputePlan.h"
+#include "VectorTupleSetIterator.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// Fused pipeline unit test and benchmark: runs the same ComputePlan (scan -> selection -> write)
+// once with every APPLY and FILTER of the selection as a separate pipeline stage, and once with
+// the stages compiled into one loop, and checks that both write the same objects.
+
+#define NUM_OBJECTS 500000
+#define NUM_RUNS 5
+#define PAGE_SIZE (128 * 1024 * 1024)
+
+using namespace pdb;
+
+// the page the scan below iterates over
+void* inputPage = nullptr;
+
+// a scan over the page in memory, rather than over a set stored by the server
+class ScanStringIntPairPage : public ScanUserSet<StringIntPair> {
+
+public:
+    ENABLE_DEEP_COPY
+
+    ScanStringIntPairPage() {}
+
+    ScanStringIntPairPage(std::string dbName, std::string setName) {
+        setDatabaseName(dbName);
+        setSetName(setName);
+    }
+
+    ComputeSourcePtr getComputeSource(TupleSpec& schema, ComputePlan& plan) override {
+        std::shared_ptr<bool> done = std::make_shared<bool>(false);
+        return std::make_shared<VectorTupleSetIterator>(
+            [done]() -> void* {
+                if (*done) {
+                    return nullptr;
+                }
+                *done = true;
+                return inputPage;
+            },
+            [](void* freeMe) {},
+            DEFAULT_BATCH_SIZE);
+    }
+};
+
+// a selection built only from lambdas that can be fused: a member compared to a constant and a
+// native projection
+class StringIntPairFilter : public SelectionComp<StringIntPair, StringIntPair> {
+
+public:
+    ENABLE_DEEP_COPY
+
+    StringIntPairFilter() {}
+
+    Lambda<bool> getSelection(Handle<StringIntPair> checkMe) override {
+        return makeLambdaFromMember(checkMe, myInt) ==
+            makeLambda(checkMe, [](Handle<StringIntPair>& checkMe) { return 7; });
+    }
+
+    Lambda<Handle<StringIntPair>> getProjection(Handle<StringIntPair> checkMe) override {
+        return makeLambda(checkMe, [](Handle<StringIntPair>& checkMe) { return checkMe; });
+    }
+};
+
+// runs the pipeline of the selection, returns the number of objects written and the seconds taken
+long runPipeline(Handle<ComputePlan>& plan,
+                 std::vector<std::string>& buildTheseTupleSets,
+                 std::string& targetComputationName,
+                 double& seconds) {
+
+    const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+    long numWritten = 0;
+    bool wrongObject = false;
+    auto begin = std::chrono::steady_clock::now();
+    {
+        std::map<std::string, ComputeInfoPtr> params;
+        PipelinePtr pipeline = plan->buildPipeline(
+            buildTheseTupleSets,
+            buildTheseTupleSets[0],
+            targetComputationName,
+            []() -> std::pair<void*, size_t> {
+                return std::make_pair(malloc(PAGE_SIZE), PAGE_SIZE);
+            },
+            [](void* page) { free(page); },
+            [&](void* page) {
+                Handle<Vector<Handle<StringIntPair>>> written =
+                    ((Record<Vector<Handle<StringIntPair>>>*)page)->getRootObject();
+                for (int i = 0; i < written->size(); i++) {
+                    if ((*written)[i]->myInt != 7) {
+                        wrongObject = true;
+                    }
+                }
+                numWritten += written->size();
+                written = nullptr;
+                free(page);
+            },
+            params);
+        pipeline->run();
+    }
+    auto end = std::chrono::steady_clock::now();
+    seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+
+    if (wrongObject) {
+        std::cout << "the pipeline wrote an object that does not pass the selection!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return numWritten;
+}
+
+int main(int argc, char* argv[]) {
+
+    // write the input objects
+    inputPage = malloc(PAGE_SIZE);
+    long numExpected = 0;
+    {
+        const UseTemporaryAllocationBlock tempBlock{inputPage, PAGE_SIZE};
+        Handle<Vector<Handle<StringIntPair>>> data =
+            makeObject<Vector<Handle<StringIntPair>>>(NUM_OBJECTS);
+        for (int i = 0; i < NUM_OBJECTS; i++) {
+            Handle<StringIntPair> pair =
+                makeObject<StringIntPair>(std::to_string(i), i * 13 % 10);
+            data->push_back(pair);
+            if (pair->myInt == 7) {
+                numExpected++;
+            }
+        }
+        getRecord(data);
+    }
+
+    // build the plan, scan -> selection -> write
+    const UseTemporaryAllocationBlock tempBlock{64 * 1024 * 1024};
+    Handle<Computation> scan = makeObject<ScanStringIntPairPage>("test_db", "input_set");
+    Handle<Computation> selection = makeObject<StringIntPairFilter>();
+    selection->setInput(scan);
+    Handle<Computation> writer = makeObject<WriteStringIntPairSet>("test_db", "output_set");
+    writer->setInput(selection);
+
+    std::vector<Handle<Computation>> queryGraph;
+    queryGraph.push_back(writer);
+    QueryGraphAnalyzer queryAnalyzer(queryGraph);
+    std::string tcapString = queryAnalyzer.parseTCAPString();
+    std::cout << "TCAP OUTPUT:" << std::endl << tcapString << std::endl;
+    std::vector<Handle<Computation>> computations;
+    queryAnalyzer.parseComputations(computations);
+    Handle<Vector<Handle<Computation>>> allComputations =
+        makeObject<Vector<Handle<Computation>>>();
+    for (const auto& computation : computations) {
+        allComputations->push_back(computation);
+    }
+    Handle<ComputePlan> plan = makeObject<ComputePlan>(String(tcapString), *allComputations);
+
+    // the pipeline goes from the output of the scan to the writer
+    AtomicComputationList& allComps = plan->getPlan()->getComputations();
+    std::vector<std::string> buildTheseTupleSets;
+    buildTheseTupleSets.push_back(allComps.getAllScanSets()[0]->getOutputName());
+    std::string targetComputationName;
+    while (targetComputationName.empty()) {
+        std::vector<AtomicComputationPtr>& consumers =
+            allComps.getConsumingAtomicComputations(buildTheseTupleSets.back());
+        if (consumers.size() != 1) {
+            std::cout << "the selection is not a single pipeline!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        if (consumers[0]->getAtomicComputationType() == "WriteSet") {
+            targetComputationName = consumers[0]->getComputationName();
+        } else {
+            buildTheseTupleSets.push_back(consumers[0]->getOutputName());
+        }
+    }
+
+    // run it interpreted and fused
+    double interpretedSeconds = 0;
+    double fusedSeconds = 0;
+    for (int run = 0; run < NUM_RUNS; run++) {
+        for (bool fuse : {false, true}) {
+            plan->setFusePipelines(fuse);
+            double seconds;
+            long numWritten =
+                runPipeline(plan, buildTheseTupleSets, targetComputationName, seconds);
+            if (numWritten != numExpected) {
+                std::cout << (fuse ? "fused" : "interpreted") << " pipeline wrote " << numWritten
+                          << " objects, expected " << numExpected << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            (fuse ? fusedSeconds : interpretedSeconds) += seconds;
+        }
+    }
+    std::cout << "interpreted: " << interpretedSeconds / NUM_RUNS << " s per run" << std::endl;
+    std::cout << "fused: " << fusedSeconds / NUM_RUNS << " s per run" << std::endl;
+    std::cout << "speedup: " << interpretedSeconds / fusedSeconds << "x" << std::endl;
+
+    plan = nullptr;
+    free(inputPage);
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
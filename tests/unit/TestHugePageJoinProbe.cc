@@ -0,0 +1,142 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_HUGE_PAGE_JOIN_PROBE_CC
+#define TEST_HUGE_PAGE_JOIN_PROBE_CC
+
+#include <cstddef>
+#include <iostream>
+#include "Ptr.h"
+#include "ComputeSource.h"
+#include "ComputeSink.h"
+#include "ComputeExecutor.h"
+#include "InterfaceFunctions.h"
+#include "TupleSpec.h"
+#include "TupleSet.h"
+#include "TupleSetMachine.h"
+#include "JoinTuple.h"
+#include "SharedMem.h"
+#include "Configuration.h"
+
+#include <chrono>
+#include <stdlib.h>
+
+// SharedMem unit test and benchmark: builds a JoinMap in the shared memory pool and measures the
+// throughput of random probes with regular pages and with huge pages.
+//
+// Under ctest the probes are only checked on a small pool; the throughput is measured on a join
+// map larger than the TLB reach when the test is built with -DHUGE_PAGE_JOIN_PROBE_BENCHMARK.
+
+#ifdef HUGE_PAGE_JOIN_PROBE_BENCHMARK
+#define NUM_KEYS (2 * 1024 * 1024)
+#define NUM_PROBES (8 * 1024 * 1024)
+#define JOIN_MAP_BLOCK_SIZE ((size_t)384 * (size_t)1024 * (size_t)1024)
+#define SHM_SIZE ((size_t)512 * (size_t)1024 * (size_t)1024)
+#else
+#define NUM_KEYS (64 * 1024)
+#define NUM_PROBES (256 * 1024)
+#define JOIN_MAP_BLOCK_SIZE ((size_t)16 * (size_t)1024 * (size_t)1024)
+#define SHM_SIZE ((size_t)64 * (size_t)1024 * (size_t)1024)
+#endif
+
+using namespace pdb;
+
+typedef JoinMap<JoinTuple<int, char[0]>> IntJoinMap;
+
+// returns the probes per second, or a negative number if a probe found the wrong tuples
+double probeJoinMap(ConfigurationPtr conf, pdb::PDBLoggerPtr logger) {
+
+    SharedMemPtr shm = make_shared<SharedMem>(
+        conf->getShmSize(), logger, conf->getUseNuma(), conf->getHugePageMode());
+    void* block = shm->malloc(JOIN_MAP_BLOCK_SIZE);
+    if (block == nullptr) {
+        std::cout << "can't allocate the join map block, exit..." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    makeObjectAllocatorBlock(block, JOIN_MAP_BLOCK_SIZE, true);
+
+    // build the hash table, the keys are scattered over the hash space like real hash values
+    Handle<IntJoinMap> myMap = makeObject<IntJoinMap>(NUM_KEYS);
+    for (int i = 0; i < NUM_KEYS; i++) {
+        JoinTuple<int, char[0]>& tuple = myMap->push(Hasher<int>::hash(i));
+        tuple.myData = i;
+    }
+
+    // probe it with keys that hit and keys that miss
+    unsigned int seed = 0;
+    long numFound = 0;
+    bool wrongTuple = false;
+    auto begin = std::chrono::steady_clock::now();
+    for (long i = 0; i < NUM_PROBES; i++) {
+        int key = rand_r(&seed) % (2 * NUM_KEYS);
+        JoinRecordList<JoinTuple<int, char[0]>> records = myMap->lookup(Hasher<int>::hash(key));
+        for (size_t j = 0; j < records.size(); j++) {
+            if (records[j].myData != key) {
+                wrongTuple = true;
+            }
+            numFound++;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+    std::cout << "probed " << NUM_PROBES << " keys, found " << numFound << " tuples" << std::endl;
+
+    myMap = nullptr;
+    makeObjectAllocatorBlock(1024 * 1024, true);
+    shm->free(block, JOIN_MAP_BLOCK_SIZE);
+    return wrongTuple ? -1 : NUM_PROBES / seconds;
+}
+
+int main(int argc, char* argv[]) {
+
+    ConfigurationPtr conf = make_shared<Configuration>();
+    conf->setPageSize(1024 * 1024);
+    conf->setShufflePageSize(1024 * 1024);
+    conf->setBroadcastPageSize(1024 * 1024);
+    conf->setMaxPageSize(1024 * 1024);
+    conf->setShmSize(SHM_SIZE);
+    pdb::PDBLoggerPtr logger = make_shared<pdb::PDBLogger>("testHugePageJoinProbe.log");
+
+    // the huge pages may not be reserved on this machine, the pool then falls back to
+    // transparent huge pages or regular pages, and the probes must work just the same
+    std::vector<HugePageMode> modes = {RegularPages, TransparentHugePages, HugePages2MB};
+#ifdef HUGE_PAGE_JOIN_PROBE_BENCHMARK
+    double regularProbesPerSecond = 0;
+#endif
+    for (HugePageMode mode : modes) {
+        conf->setHugePageMode(mode);
+        double probesPerSecond = probeJoinMap(conf, logger);
+        if (probesPerSecond < 0) {
+            std::cout << "a probe with " << SharedMem::hugePageModeToString(mode)
+                      << " returned the wrong tuple!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+#ifdef HUGE_PAGE_JOIN_PROBE_BENCHMARK
+        if (mode == RegularPages) {
+            regularProbesPerSecond = probesPerSecond;
+        }
+        std::cout << "asking for " << SharedMem::hugePageModeToString(mode) << ": "
+                  << probesPerSecond << " probes/s, " << probesPerSecond / regularProbesPerSecond
+                  << "x regular pages" << std::endl;
+#endif
+    }
+
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,178 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_KEY_PARTITION_POLICIES_CC
+#define TEST_KEY_PARTITION_POLICIES_CC
+
+#include "HashPolicy.h"
+#include "RangePolicy.h"
+#include "NodeDispatcherData.h"
+#include "StringIntPair.h"
+#include "Statistics.h"
+#include "InterfaceFunctions.h"
+#include "UseTemporaryAllocationBlock.h"
+
+#include <iostream>
+#include <map>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+// HashPolicy and RangePolicy unit test: two sets are partitioned on the same key over the same
+// nodes, and we check that the objects with the same key go to the same node whatever the order
+// the nodes are listed in, that no object is lost, that the two sets get the same partition scheme
+// and a set over other nodes does not, that the ranges are sent to the nodes in order, and that
+// the policies count about as many distinct keys as there are.
+
+#define NUM_OBJECTS 1000
+#define NUM_KEYS 37
+
+using namespace pdb;
+
+Handle<Vector<Handle<NodeDispatcherData>>> makeNodes(std::vector<int> ports) {
+    Handle<Vector<Handle<NodeDispatcherData>>> nodes =
+        makeObject<Vector<Handle<NodeDispatcherData>>>();
+    for (int i = 0; i < ports.size(); i++) {
+        nodes->push_back(makeObject<NodeDispatcherData>(i, ports[i], "localhost"));
+    }
+    return nodes;
+}
+
+Handle<Vector<Handle<Object>>> makeData(int seed) {
+    Handle<Vector<Handle<Object>>> data = makeObject<Vector<Handle<Object>>>();
+    for (int i = 0; i < NUM_OBJECTS; i++) {
+        Handle<StringIntPair> object =
+            makeObject<StringIntPair>("key_" + std::to_string((seed + i) % NUM_KEYS), i);
+        data->push_back(object);
+    }
+    return data;
+}
+
+size_t hashKey(Handle<Object>& object) {
+    Handle<StringIntPair> pair = unsafeCast<StringIntPair>(object);
+    return std::hash<std::string>()(pair->myString->c_str());
+}
+
+int getRange(Handle<Object>& object) {
+    Handle<StringIntPair> pair = unsafeCast<StringIntPair>(object);
+    return atoi(pair->myString->c_str() + 4) * 4 / NUM_KEYS;
+}
+
+// partitions the data, and puts the port of the node of every key in keyPorts, exits if a key
+// goes to two nodes or an object is lost
+void checkPartition(KeyPartitionPolicy& policy,
+                    Handle<Vector<Handle<Object>>> data,
+                    std::map<std::string, int>& keyPorts) {
+    auto partitioned = policy.partition(data);
+    size_t numObjects = 0;
+    for (auto& entry : *partitioned) {
+        int port = policy.getNode(entry.first)->getPort();
+        for (int i = 0; i < entry.second->size(); i++) {
+            Handle<StringIntPair> pair = unsafeCast<StringIntPair>((*entry.second)[i]);
+            std::string key = pair->myString->c_str();
+            if ((keyPorts.count(key) > 0) && (keyPorts[key] != port)) {
+                std::cout << key << " was sent to two nodes" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            keyPorts[key] = port;
+            numObjects++;
+        }
+    }
+    if (numObjects != data->size()) {
+        std::cout << numObjects << " objects were partitioned out of " << data->size()
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main(int argc, char* argv[]) {
+
+    const UseTemporaryAllocationBlock tempBlock{64 * 1024 * 1024};
+
+    // two sets over the same nodes, listed in another order
+    HashPolicy leftPolicy("myString", "string", hashKey);
+    leftPolicy.updateStorageNodes(makeNodes({8108, 8109, 8110}));
+    HashPolicy rightPolicy("myString", "string", hashKey);
+    rightPolicy.updateStorageNodes(makeNodes({8110, 8108, 8109}));
+    std::map<std::string, int> keyPorts;
+    checkPartition(leftPolicy, makeData(0), keyPorts);
+    checkPartition(rightPolicy, makeData(5), keyPorts);
+    if (keyPorts.size() != NUM_KEYS) {
+        std::cout << "not every key was partitioned" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (leftPolicy.getPartitionScheme() != rightPolicy.getPartitionScheme()) {
+        std::cout << "the same partitioning has two schemes: " << leftPolicy.getPartitionScheme()
+                  << " and " << rightPolicy.getPartitionScheme() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // other nodes, or another kind of key, is another partitioning
+    HashPolicy otherPolicy("myString", "string", hashKey);
+    otherPolicy.updateStorageNodes(makeNodes({8108, 8109}));
+    HashPolicy otherTypePolicy("myString", "int", hashKey);
+    otherTypePolicy.updateStorageNodes(makeNodes({8108, 8109, 8110}));
+    if ((otherPolicy.getPartitionScheme() == leftPolicy.getPartitionScheme()) ||
+        (otherTypePolicy.getPartitionScheme() == leftPolicy.getPartitionScheme())) {
+        std::cout << "two partitionings have the same scheme" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // the ranges go to the nodes in order
+    RangePolicy rangePolicy("myString", "string", hashKey, getRange, 4, "9,18,27");
+    rangePolicy.updateStorageNodes(makeNodes({8110, 8109, 8108}));
+    std::map<std::string, int> rangePorts;
+    checkPartition(rangePolicy, makeData(0), rangePorts);
+    for (int i = 1; i < NUM_KEYS; i++) {
+        if (rangePorts["key_" + std::to_string(i)] < rangePorts["key_" + std::to_string(i - 1)]) {
+            std::cout << "the ranges are not sent to the nodes in order" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    // every policy counts the keys it has seen
+    if ((leftPolicy.getNumDistinctKeys() < NUM_KEYS - 2) ||
+        (leftPolicy.getNumDistinctKeys() > NUM_KEYS + 2) ||
+        (rangePolicy.getNumDistinctKeys() < NUM_KEYS - 2) ||
+        (rangePolicy.getNumDistinctKeys() > NUM_KEYS + 2)) {
+        std::cout << "counted " << leftPolicy.getNumDistinctKeys() << " and "
+                  << rangePolicy.getNumDistinctKeys() << " keys instead of " << NUM_KEYS
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if ((rangePolicy.getPolicy() != PartitionPolicy::Policy::RANGE) ||
+        (leftPolicy.getPolicy() != PartitionPolicy::Policy::HASH)) {
+        std::cout << "wrong policy" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // the planner sees the partitioning of a set, but not of its alias
+    Statistics stats;
+    stats.setPartitioning("db", "left", leftPolicy.getPartitionScheme(), "myString");
+    stats.addSetAlias("db", "left", "db", "leftAlias");
+    if ((stats.getPartitionScheme("db", "left") != leftPolicy.getPartitionScheme()) ||
+        (stats.getPartitionKey("db", "left") != "myString") ||
+        (stats.getPartitionScheme("db", "leftAlias") != "") ||
+        (stats.getPartitionKey("db", "right") != "")) {
+        std::cout << "wrong partitioning in the statistics" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
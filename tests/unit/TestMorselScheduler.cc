@@ -0,0 +1,199 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_MORSEL_SCHEDULER_CC
+#define TEST_MORSEL_SCHEDULER_CC
+
+#include "MorselScheduler.h"
+#include "MorselTupleSetIterator.h"
+#include "PageCircularBuffer.h"
+#include "PageCircularBufferIterator.h"
+#include "PDBPage.h"
+#include "StringIntPair.h"
+#include "InterfaceFunctions.h"
+#include "UseTemporaryAllocationBlock.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+// Morsel scheduler unit test and benchmark: a few threads scan a set of pages that is skewed (the
+// first page holds most of the objects, and its objects are the most expensive to process), once
+// taking whole pages and once taking morsels, and check that every object is processed once and
+// every page is released once. The number of active threads is changed while the scan runs.
+
+#define NUM_PAGES 16
+#define NUM_THREADS 4
+#define NUM_BIG_PAGE_OBJECTS 200000
+#define NUM_SMALL_PAGE_OBJECTS 1000
+#define PAGE_SIZE (16 * 1024 * 1024)
+#define PAGE_HEADER_SIZE                                                                        \
+    (sizeof(NodeID) + sizeof(DatabaseID) + sizeof(UserTypeID) + sizeof(SetID) + sizeof(PageID) + \
+     sizeof(int) + sizeof(size_t))
+
+using namespace pdb;
+
+std::vector<char*> rawPages;
+std::atomic<int>* numProcessed;
+std::atomic<int> numReleased[NUM_PAGES];
+long numObjects = 0;
+
+struct ScanArgs {
+    MorselSchedulerPtr scheduler;
+    int workerId;
+};
+
+// does some work for an object, more of it for the objects on the first page
+long process(Handle<StringIntPair>& object) {
+    long work = (object->myInt < NUM_BIG_PAGE_OBJECTS) ? 200 : 20;
+    long sum = 0;
+    for (long i = 0; i < work; i++) {
+        sum += (object->myInt * i) % 7;
+    }
+    return sum;
+}
+
+void* scan(void* arg) {
+    ScanArgs* args = (ScanArgs*)arg;
+    long sum = 0;
+    {
+        MorselTupleSetIterator source(
+            [&](Morsel& morsel) -> bool {
+                return args->scheduler->getNextMorsel(args->workerId, morsel);
+            },
+            [&](Morsel& morsel) -> void {
+                if (args->scheduler->finishMorsel(morsel)) {
+                    char* raw = (char*)morsel.page - PAGE_HEADER_SIZE;
+                    PDBPage page(raw, 0, 0);
+                    numReleased[page.getPageID()]++;
+                }
+            },
+            100);
+        TupleSetPtr input;
+        while ((input = source.getNextTupleSet()) != nullptr) {
+            std::vector<Handle<Object>>& column = input->getColumn<Handle<Object>>(0);
+            for (Handle<Object>& object : column) {
+                Handle<StringIntPair> pair = unsafeCast<StringIntPair, Object>(object);
+                numProcessed[pair->myInt]++;
+                sum += process(pair);
+            }
+        }
+    }
+    return (void*)sum;
+}
+
+// scans all of the pages with the given morsel size, returns the seconds taken
+double runScan(size_t morselSize) {
+
+    memset(numProcessed, 0, sizeof(std::atomic<int>) * numObjects);
+    for (int i = 0; i < NUM_PAGES; i++) {
+        numReleased[i] = 0;
+    }
+
+    // the pages come through one buffer shared by the iterators, as they do from a PageScanner
+    PDBLoggerPtr logger = make_shared<PDBLogger>("testMorselScheduler.log");
+    PageCircularBufferPtr buffer = make_shared<PageCircularBuffer>(NUM_PAGES + 1, logger);
+    std::vector<PageIteratorPtr> iterators;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        iterators.push_back(make_shared<PageCircularBufferIterator>(i, buffer, logger));
+    }
+    MorselSchedulerPtr scheduler =
+        make_shared<MorselScheduler>(iterators, NUM_THREADS, morselSize, logger);
+
+    // the allocator is shared by the threads, so they all use this block
+    const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+    auto begin = std::chrono::steady_clock::now();
+    pthread_t threads[NUM_THREADS];
+    ScanArgs args[NUM_THREADS];
+    for (int i = 0; i < NUM_THREADS; i++) {
+        args[i].scheduler = scheduler;
+        args[i].workerId = i;
+        pthread_create(&threads[i], nullptr, scan, &args[i]);
+    }
+    std::vector<PDBPagePtr> pages;
+    for (int i = 0; i < NUM_PAGES; i++) {
+        pages.push_back(make_shared<PDBPage>(rawPages[i], 0, 0));
+        buffer->addPageToTail(pages.back());
+    }
+    buffer->close();
+
+    // shrink and grow the number of threads while the scan runs
+    scheduler->setNumActiveWorkers(1);
+    usleep(10000);
+    scheduler->setNumActiveWorkers(NUM_THREADS);
+    for (int i = 0; i < NUM_THREADS; i++) {
+        pthread_join(threads[i], nullptr);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    for (long i = 0; i < numObjects; i++) {
+        if (numProcessed[i] != 1) {
+            std::cout << "object " << i << " was processed " << numProcessed[i] << " times"
+                      << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < NUM_PAGES; i++) {
+        if (numReleased[i] != 1) {
+            std::cout << "page " << i << " was released " << numReleased[i] << " times"
+                      << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    std::cout << "morsel size " << morselSize << ": " << scheduler->getNumMorsels()
+              << " morsels, " << scheduler->getNumSteals() << " stolen" << std::endl;
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+}
+
+int main(int argc, char* argv[]) {
+
+    // write the pages, the objects are numbered in the order they are written
+    for (int i = 0; i < NUM_PAGES; i++) {
+        char* raw = (char*)malloc(PAGE_HEADER_SIZE + PAGE_SIZE);
+        PDBPage page(raw, 0, 0, 0, 0, i, PAGE_HEADER_SIZE + PAGE_SIZE, 0);
+        page.preparePage();
+        const UseTemporaryAllocationBlock tempBlock{raw + PAGE_HEADER_SIZE, PAGE_SIZE};
+        int numPageObjects = (i == 0) ? NUM_BIG_PAGE_OBJECTS : NUM_SMALL_PAGE_OBJECTS;
+        Handle<Vector<Handle<Object>>> data =
+            makeObject<Vector<Handle<Object>>>(numPageObjects);
+        for (int j = 0; j < numPageObjects; j++) {
+            data->push_back(makeObject<StringIntPair>("", numObjects++));
+        }
+        getRecord(data);
+        rawPages.push_back(raw);
+    }
+    numProcessed = new std::atomic<int>[numObjects];
+
+    double pageSeconds = runScan(0);
+    double morselSeconds = runScan(MORSEL_SIZE);
+    std::cout << "whole pages: " << pageSeconds << " s" << std::endl;
+    std::cout << "morsels: " << morselSeconds << " s" << std::endl;
+
+    delete[] numProcessed;
+    for (char* raw : rawPages) {
+        free(raw);
+    }
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
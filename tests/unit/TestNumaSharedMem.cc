@@ -0,0 +1,180 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_NUMA_SHARED_MEM_CC
+#define TEST_NUMA_SHARED_MEM_CC
+
+#include "NumaTopology.h"
+#include "SharedMem.h"
+#include "PageCache.h"
+#include "PageCircularBuffer.h"
+#include "Configuration.h"
+#include "PDBWorkerQueue.h"
+
+#include <iostream>
+#include <sched.h>
+#include <stdlib.h>
+#include <vector>
+
+// SharedMem unit test for the NUMA mode: the pool is split into one arena per node, allocations
+// come from the requested node while it has room and then from the other nodes, and the cache
+// reports where its pages are.
+
+#define PAGE_SIZE (1024 * 1024)
+#define POOL_SIZE ((size_t)64 * 1024 * 1024)
+
+int main(int argc, char* argv[]) {
+
+    int numNodes = NumaTopology::getNumNodes();
+    std::cout << "found " << numNodes << " NUMA nodes" << std::endl;
+
+    // every worker gets a core we are allowed to run on, spread over the nodes
+    cpu_set_t allowedCpus;
+    sched_getaffinity(0, sizeof(cpu_set_t), &allowedCpus);
+    for (int worker = 0; worker < 2 * numNodes; worker++) {
+        int cpu = NumaTopology::getCpuOfWorker(worker);
+        if ((cpu < 0) || (CPU_ISSET(cpu, &allowedCpus) == 0)) {
+            std::cout << "worker " << worker << " placed on core " << cpu << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        int expectedNode = worker % numNodes;
+        if ((NumaTopology::getCpusOfNode(expectedNode).empty() == false) &&
+            (NumaTopology::getNodeOfCpu(cpu) != expectedNode)) {
+            std::cout << "worker " << worker << " not placed on node " << expectedNode << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pdb::PDBLoggerPtr logger = make_shared<pdb::PDBLogger>("testNumaSharedMem.log");
+
+    // without the NUMA mode there is a single arena
+    {
+        SharedMem shm(POOL_SIZE, logger);
+        if ((shm.getNumArenas() != 1) || (shm.getArena(0).size != POOL_SIZE)) {
+            std::cout << "the pool is split without the NUMA mode" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    SharedMemPtr shm = make_shared<SharedMem>(POOL_SIZE, logger, true);
+    if (shm->getNumArenas() != numNodes) {
+        std::cout << shm->getNumArenas() << " arenas for " << numNodes << " nodes" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    size_t totalSize = 0;
+    for (int i = 0; i < shm->getNumArenas(); i++) {
+        totalSize += shm->getArena(i).size;
+    }
+    if (totalSize != POOL_SIZE) {
+        std::cout << "the arenas cover " << totalSize << " bytes" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // fill the pool from node 0, the first pages come from node 0, the last ones from the others
+    std::vector<void*> buffers;
+    std::vector<int> numBuffersPerNode(numNodes, 0);
+    void* buffer;
+    while ((buffer = shm->mallocOnNode(PAGE_SIZE, 0)) != nullptr) {
+        int node = shm->getNodeOfAddress(buffer);
+        if ((buffers.empty() == false) && (node == 0) &&
+            (shm->getNodeOfAddress(buffers.back()) != 0)) {
+            std::cout << "got a page from node 0 after it was full" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        numBuffersPerNode[node]++;
+        buffers.push_back(buffer);
+    }
+    if (shm->getNodeOfAddress(buffers.front()) != 0) {
+        std::cout << "the first page doesn't come from the requested node" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    for (int node = 0; node < numNodes; node++) {
+        std::cout << "node " << node << ": " << numBuffersPerNode[node] << " pages" << std::endl;
+        if (numBuffersPerNode[node] == 0) {
+            std::cout << "no page allocated from node " << node << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (void* buffer : buffers) {
+        shm->free(buffer, PAGE_SIZE);
+    }
+
+    // the freed memory is available again from every node
+    for (int node = 0; node < numNodes; node++) {
+        buffer = shm->mallocOnNode(PAGE_SIZE, node);
+        if ((buffer == nullptr) || (shm->getNodeOfAddress(buffer) != node)) {
+            std::cout << "can't allocate from node " << node << " after freeing" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        shm->free(buffer, PAGE_SIZE);
+    }
+
+    // the cache reports where its pages are
+    ConfigurationPtr conf = make_shared<Configuration>();
+    conf->setPageSize(PAGE_SIZE);
+    conf->setShufflePageSize(PAGE_SIZE);
+    conf->setBroadcastPageSize(PAGE_SIZE);
+    conf->setMaxPageSize(PAGE_SIZE);
+    conf->setShmSize(POOL_SIZE);
+    pdb::PDBWorkerQueuePtr workers = make_shared<pdb::PDBWorkerQueue>(logger, 2);
+    PageCircularBufferPtr flushBuffer = make_shared<PageCircularBuffer>(16, logger);
+    PageCache cache(conf, workers, flushBuffer, logger, shm);
+    CacheKey key;
+    key.dbId = 1;
+    key.typeId = 1;
+    key.setId = 1;
+    int numPages = 16;
+    std::vector<PDBPagePtr> pages;
+    for (int i = 0; i < numPages; i++) {
+        key.pageId = i;
+        PDBPagePtr page = cache.getNewPage(0, key, nullptr, PAGE_SIZE);
+        if (page == nullptr) {
+            std::cout << "can't allocate page " << i << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        cache.decPageRefCount(key);
+        pages.push_back(page);
+    }
+    CacheStats stats = cache.getStats();
+    std::cout << stats.toString() << std::endl;
+    size_t cachedBytes = 0;
+    for (size_t bytes : stats.cachedBytesPerNode) {
+        cachedBytes += bytes;
+    }
+    if ((stats.cachedBytesPerNode.size() != (size_t)numNodes) ||
+        (cachedBytes < (size_t)numPages * PAGE_SIZE)) {
+        std::cout << "the cache reports " << cachedBytes << " bytes" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // and stops counting the pages it frees
+    for (PDBPagePtr& page : pages) {
+        cache.freePage(page);
+    }
+    for (size_t bytes : cache.getStats().cachedBytesPerNode) {
+        if (bytes != 0) {
+            std::cout << "the cache reports " << bytes << " bytes after freeing its pages"
+                      << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,155 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_PAGE_CACHE_CONCURRENT_HITS_CC
+#define TEST_PAGE_CACHE_CONCURRENT_HITS_CC
+
+#include "PageCache.h"
+#include "PageCircularBuffer.h"
+#include "SharedMem.h"
+#include "Configuration.h"
+#include "PDBWorkerQueue.h"
+
+#include <chrono>
+#include <iostream>
+#include <pthread.h>
+#include <stdlib.h>
+#include <vector>
+
+// PageCache unit test and benchmark: measures the throughput of cache hits (getPage + unpin) on
+// resident pages with an increasing number of threads.
+//
+// Under ctest a few threads only check that every pin is released; the throughput is measured
+// with enough threads and hits to mean something when the test is built with
+// -DPAGE_CACHE_BENCHMARK.
+
+#define NUM_PAGES 128
+#ifdef PAGE_CACHE_BENCHMARK
+#define NUM_HITS_PER_THREAD 200000
+#define THREAD_COUNTS \
+    { 1, 8, 32, 64 }
+#else
+#define NUM_HITS_PER_THREAD 5000
+#define THREAD_COUNTS \
+    { 1, 8 }
+#endif
+
+struct HitArgs {
+    PageCache* cache;
+    int threadId;
+    long numFailed;
+};
+
+void* runHits(void* arg) {
+    HitArgs* args = (HitArgs*)arg;
+    CacheKey key;
+    key.dbId = 1;
+    key.typeId = 1;
+    key.setId = 1;
+    // every thread walks the pages in a different order, so that they hit all the shards
+    unsigned int seed = args->threadId;
+    for (long i = 0; i < NUM_HITS_PER_THREAD; i++) {
+        key.pageId = rand_r(&seed) % NUM_PAGES;
+        PDBPagePtr page = args->cache->getPage(key, nullptr);
+        if (page == nullptr) {
+            args->numFailed++;
+            continue;
+        }
+        args->cache->decPageRefCount(key);
+    }
+    return nullptr;
+}
+
+int main(int argc, char* argv[]) {
+
+    ConfigurationPtr conf = make_shared<Configuration>();
+    conf->setPageSize(1024 * 1024);
+    conf->setShufflePageSize(1024 * 1024);
+    conf->setBroadcastPageSize(1024 * 1024);
+    conf->setMaxPageSize(1024 * 1024);
+    conf->setShmSize((size_t)256 * 1024 * 1024);
+    pdb::PDBLoggerPtr logger = make_shared<pdb::PDBLogger>("testPageCacheConcurrentHits.log");
+    SharedMemPtr shm = make_shared<SharedMem>(conf->getShmSize(), logger);
+    pdb::PDBWorkerQueuePtr workers = make_shared<pdb::PDBWorkerQueue>(logger, 4);
+    PageCircularBufferPtr flushBuffer = make_shared<PageCircularBuffer>(NUM_PAGES, logger);
+    PageCache cache(conf, workers, flushBuffer, logger, shm);
+
+    // allocate the pages, they all fit in the cache so every lookup below is a hit
+    CacheKey key;
+    key.dbId = 1;
+    key.typeId = 1;
+    key.setId = 1;
+    for (int i = 0; i < NUM_PAGES; i++) {
+        key.pageId = i;
+        PDBPagePtr page = cache.getNewPage(0, key, nullptr, conf->getMaxPageSize());
+        if (page == nullptr) {
+            std::cout << "can't allocate page " << i << ", exit..." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        cache.decPageRefCount(key);
+    }
+
+    std::vector<int> threadCounts = THREAD_COUNTS;
+    for (int numThreads : threadCounts) {
+        std::vector<pthread_t> threads(numThreads);
+        std::vector<HitArgs> args(numThreads);
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < numThreads; i++) {
+            args[i].cache = &cache;
+            args[i].threadId = i;
+            args[i].numFailed = 0;
+            pthread_create(&threads[i], nullptr, runHits, &args[i]);
+        }
+        long numFailed = 0;
+        for (int i = 0; i < numThreads; i++) {
+            pthread_join(threads[i], nullptr);
+            numFailed += args[i].numFailed;
+        }
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+        double hitsPerSecond = (double)numThreads * NUM_HITS_PER_THREAD / seconds;
+#ifdef PAGE_CACHE_BENCHMARK
+        std::cout << numThreads << " threads: " << hitsPerSecond << " hits/s, "
+                  << hitsPerSecond / numThreads << " hits/s per thread" << std::endl;
+#endif
+
+        if (numFailed > 0) {
+            std::cout << numFailed << " lookups of resident pages failed!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // every pin was released, so every page must be unpinned
+    for (int i = 0; i < NUM_PAGES; i++) {
+        key.pageId = i;
+        PDBPagePtr page = cache.getPage(key, nullptr);
+        if ((page == nullptr) || (page->getRefCount() != 1)) {
+            std::cout << "wrong reference count for page " << i << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        cache.decPageRefCount(key);
+        if (page->isPinned()) {
+            std::cout << "page " << i << " is still pinned" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
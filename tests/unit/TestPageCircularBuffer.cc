@@ -0,0 +1,282 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_PAGE_CIRCULAR_BUFFER_CC
+#define TEST_PAGE_CIRCULAR_BUFFER_CC
+
+#include "PageCircularBuffer.h"
+#include "PDBPage.h"
+#include "PDBLogger.h"
+
+#include <chrono>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <vector>
+
+// PageCircularBuffer unit test and benchmark: half of the threads add pages, the other half pops
+// them until the buffer is closed, we check that every page comes out exactly once, and compare the
+// throughput with the mutex and condition variable buffer the lock-free one replaced.
+//
+// Under ctest only the lock-free buffer is checked, on a few pages with up to 8 threads; the
+// comparison with the locked buffer runs up to 64 threads when the test is built with
+// -DPAGE_CIRCULAR_BUFFER_BENCHMARK.
+
+#define BUFFER_SIZE 128
+#ifdef PAGE_CIRCULAR_BUFFER_BENCHMARK
+#define NUM_PAGES_PER_RUN 400000
+#else
+#define NUM_PAGES_PER_RUN 20000
+#endif
+
+#ifdef PAGE_CIRCULAR_BUFFER_BENCHMARK
+// the previous implementation of PageCircularBuffer, kept here as the baseline
+class LockedPageBuffer {
+public:
+    explicit LockedPageBuffer(unsigned int bufferSize)
+        : maxArraySize(bufferSize + 1), head(0), tail(0), closed(false) {
+        pageArray = new PDBPagePtr[maxArraySize];
+        pthread_mutex_init(&mutex, nullptr);
+        pthread_mutex_init(&addPageMutex, nullptr);
+        pthread_cond_init(&cond, nullptr);
+    }
+
+    ~LockedPageBuffer() {
+        delete[] pageArray;
+        pthread_mutex_destroy(&mutex);
+        pthread_mutex_destroy(&addPageMutex);
+        pthread_cond_destroy(&cond);
+    }
+
+    int addPageToTail(PDBPagePtr page) {
+        pthread_mutex_lock(&addPageMutex);
+        while (head == (tail + 1) % maxArraySize) {
+            pthread_cond_signal(&cond);
+            sched_yield();
+        }
+        tail = (tail + 1) % maxArraySize;
+        pageArray[tail] = page;
+        pthread_mutex_unlock(&addPageMutex);
+        pthread_mutex_lock(&mutex);
+        if ((tail - head + maxArraySize) % maxArraySize <= 2) {
+            pthread_cond_broadcast(&cond);
+        } else {
+            pthread_cond_signal(&cond);
+        }
+        pthread_mutex_unlock(&mutex);
+        return 0;
+    }
+
+    PDBPagePtr popPageFromHead() {
+        pthread_mutex_lock(&mutex);
+        if ((head == tail) && (closed == false)) {
+            pthread_cond_wait(&cond, &mutex);
+        }
+        if (head != tail) {
+            head = (head + 1) % maxArraySize;
+            PDBPagePtr ret = pageArray[head];
+            pageArray[head] = nullptr;
+            pthread_mutex_unlock(&mutex);
+            return ret;
+        }
+        pthread_mutex_unlock(&mutex);
+        return nullptr;
+    }
+
+    bool isClosed() {
+        return closed;
+    }
+
+    bool isEmpty() {
+        return head == tail;
+    }
+
+    void close() {
+        pthread_mutex_lock(&mutex);
+        closed = true;
+        pthread_cond_broadcast(&cond);
+        pthread_mutex_unlock(&mutex);
+    }
+
+private:
+    PDBPagePtr* pageArray;
+    unsigned int maxArraySize;
+    volatile unsigned int head;
+    volatile unsigned int tail;
+    volatile bool closed;
+    pthread_mutex_t mutex;
+    pthread_mutex_t addPageMutex;
+    pthread_cond_t cond;
+};
+#endif
+
+template <class Buffer>
+struct ThreadArgs {
+    Buffer* buffer;
+    std::vector<PDBPagePtr>* pages;
+    int first;
+    int last;
+    long numPopped;
+    long sumOfPageIds;
+};
+
+template <class Buffer>
+void* runProducer(void* arg) {
+    ThreadArgs<Buffer>* args = (ThreadArgs<Buffer>*)arg;
+    for (int i = args->first; i < args->last; i++) {
+        args->buffer->addPageToTail(args->pages->at(i));
+    }
+    return nullptr;
+}
+
+template <class Buffer>
+void* runConsumer(void* arg) {
+    ThreadArgs<Buffer>* args = (ThreadArgs<Buffer>*)arg;
+    // like PageCircularBufferIterator, a nullptr is only the end if the buffer is closed and empty
+    while ((args->buffer->isClosed() == false) || (args->buffer->isEmpty() == false)) {
+        PDBPagePtr page = args->buffer->popPageFromHead();
+        if (page != nullptr) {
+            args->numPopped++;
+            args->sumOfPageIds += page->getPageID();
+        }
+    }
+    return nullptr;
+}
+
+// return the number of pages per second, or a negative value if pages were lost or duplicated
+template <class Buffer>
+double runBenchmark(Buffer* buffer, std::vector<PDBPagePtr>& pages, int numThreads) {
+    int numProducers = numThreads / 2;
+    int numConsumers = numThreads - numProducers;
+    std::vector<pthread_t> producers(numProducers);
+    std::vector<pthread_t> consumers(numConsumers);
+    std::vector<ThreadArgs<Buffer>> producerArgs(numProducers);
+    std::vector<ThreadArgs<Buffer>> consumerArgs(numConsumers);
+
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < numConsumers; i++) {
+        consumerArgs[i].buffer = buffer;
+        consumerArgs[i].numPopped = 0;
+        consumerArgs[i].sumOfPageIds = 0;
+        pthread_create(&consumers[i], nullptr, runConsumer<Buffer>, &consumerArgs[i]);
+    }
+    int numPagesPerProducer = pages.size() / numProducers;
+    for (int i = 0; i < numProducers; i++) {
+        producerArgs[i].buffer = buffer;
+        producerArgs[i].pages = &pages;
+        producerArgs[i].first = i * numPagesPerProducer;
+        producerArgs[i].last =
+            (i == numProducers - 1) ? (int)pages.size() : (i + 1) * numPagesPerProducer;
+        pthread_create(&producers[i], nullptr, runProducer<Buffer>, &producerArgs[i]);
+    }
+    for (int i = 0; i < numProducers; i++) {
+        pthread_join(producers[i], nullptr);
+    }
+    buffer->close();
+    long numPopped = 0;
+    long sumOfPageIds = 0;
+    for (int i = 0; i < numConsumers; i++) {
+        pthread_join(consumers[i], nullptr);
+        numPopped += consumerArgs[i].numPopped;
+        sumOfPageIds += consumerArgs[i].sumOfPageIds;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    long numPages = pages.size();
+    if ((numPopped != numPages) || (sumOfPageIds != numPages * (numPages - 1) / 2)) {
+        std::cout << "popped " << numPopped << " pages, expected " << numPages << std::endl;
+        return -1;
+    }
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+    return numPages / seconds;
+}
+
+int main(int argc, char* argv[]) {
+
+    pdb::PDBLoggerPtr logger = make_shared<pdb::PDBLogger>("testPageCircularBuffer.log");
+
+    // the pages only need a header, they all share the same one
+    static char header[1024] = {0};
+    std::vector<PDBPagePtr> pages;
+    for (int i = 0; i < NUM_PAGES_PER_RUN; i++) {
+        PDBPagePtr page = make_shared<PDBPage>(header, 0, 0);
+        page->setPageID(i);
+        pages.push_back(page);
+    }
+
+    // a closed and empty buffer doesn't block
+    PageCircularBuffer closedBuffer(4, logger);
+    closedBuffer.close();
+    if (closedBuffer.popPageFromHead() != nullptr) {
+        std::cout << "got a page from an empty buffer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // the buffer holds exactly bufferSize pages
+    PageCircularBuffer smallBuffer(4, logger);
+    for (int i = 0; i < 4; i++) {
+        if (smallBuffer.tryAddPageToTail(pages[i]) == false) {
+            std::cout << "can't add page " << i << " to a buffer that is not full" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    if ((smallBuffer.isFull() == false) || (smallBuffer.tryAddPageToTail(pages[4]) == true)) {
+        std::cout << "added a page to a full buffer" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    // the pages left in a closed buffer are still popped, in order
+    smallBuffer.close();
+    for (int i = 0; i < 4; i++) {
+        PDBPagePtr page = smallBuffer.popPageFromHead();
+        if ((page == nullptr) || (page->getPageID() != i)) {
+            std::cout << "wrong page popped from a closed buffer" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+#ifdef PAGE_CIRCULAR_BUFFER_BENCHMARK
+    std::vector<int> threadCounts = {2, 4, 8, 16, 32, 64};
+    for (int numThreads : threadCounts) {
+        LockedPageBuffer lockedBuffer(BUFFER_SIZE);
+        double lockedPagesPerSecond = runBenchmark(&lockedBuffer, pages, numThreads);
+
+        PageCircularBuffer lockFreeBuffer(BUFFER_SIZE, logger);
+        double lockFreePagesPerSecond = runBenchmark(&lockFreeBuffer, pages, numThreads);
+
+        if ((lockedPagesPerSecond < 0) || (lockFreePagesPerSecond < 0)) {
+            exit(EXIT_FAILURE);
+        }
+        std::cout << numThreads << " threads: locked " << lockedPagesPerSecond
+                  << " pages/s, lock-free " << lockFreePagesPerSecond << " pages/s, speedup "
+                  << lockFreePagesPerSecond / lockedPagesPerSecond << std::endl;
+    }
+#else
+    std::vector<int> threadCounts = {2, 3, 8};
+    for (int numThreads : threadCounts) {
+        PageCircularBuffer lockFreeBuffer(BUFFER_SIZE, logger);
+        if (runBenchmark(&lockFreeBuffer, pages, numThreads) < 0) {
+            exit(EXIT_FAILURE);
+        }
+    }
+#endif
+
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
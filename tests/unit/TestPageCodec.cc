@@ -0,0 +1,165 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_PAGE_CODEC_CC
+#define TEST_PAGE_CODEC_CC
+
+#include "PageCodec.h"
+#include "StringIntPair.h"
+#include "InterfaceFunctions.h"
+#include "UseTemporaryAllocationBlock.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// PageCodec unit test and benchmark: pages of objects and pages of random bytes are encoded with
+// every codec this build has, and with the adaptive codec at a slow and at a fast network, and we
+// check that every page is decoded to the bytes it was made of, that a page that does not get
+// smaller is sent as it is, and that the adaptive codec does not compress for a fast network.
+
+#define PAGE_BYTES (4 * 1024 * 1024)
+#define NUM_PAGES 8
+
+using namespace pdb;
+
+// a page of objects, the kind of page that is shuffled
+char* makeObjectPage(int seed, size_t& numBytes) {
+    char* bytes = (char*)malloc(PAGE_BYTES);
+    const UseTemporaryAllocationBlock tempBlock{bytes, PAGE_BYTES};
+    Handle<Vector<Handle<StringIntPair>>> data = makeObject<Vector<Handle<StringIntPair>>>();
+    try {
+        for (int i = 0; true; i++) {
+            data->push_back(makeObject<StringIntPair>("key_" + std::to_string(i % 1000), seed + i));
+        }
+    } catch (NotEnoughSpace& e) {
+    }
+    Record<Vector<Handle<StringIntPair>>>* record = getRecord(data);
+    numBytes = record->numBytes();
+    return bytes;
+}
+
+char* makeRandomPage(size_t& numBytes) {
+    char* bytes = (char*)malloc(PAGE_BYTES);
+    for (size_t i = 0; i < PAGE_BYTES; i++) {
+        bytes[i] = (char)rand();
+    }
+    numBytes = PAGE_BYTES;
+    return bytes;
+}
+
+// encodes and decodes a page, exits if the page does not come back
+void checkRoundTrip(PageCodec& codec, char* page, size_t numBytes, PageFrameHeader& header) {
+    const char* encodedBytes = codec.encode(page, numBytes, header);
+    if ((header.numBytes != numBytes) || (header.codec >= NUM_PAGE_CODECS) ||
+        ((header.codec == NoCodec) && (header.numEncodedBytes != numBytes)) ||
+        ((header.codec != NoCodec) && (header.numEncodedBytes >= numBytes))) {
+        std::cout << "bad frame header for a page of " << numBytes << " bytes" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    char* decoded = (char*)malloc(numBytes);
+    std::string errMsg;
+    if ((PageCodec::decode(header, encodedBytes, decoded, errMsg) == false) ||
+        (memcmp(decoded, page, numBytes) != 0)) {
+        std::cout << "a page encoded with " << PageCodec::getCodecName((PageCodecType)header.codec)
+                  << " was not decoded to its bytes: " << errMsg << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    free(decoded);
+}
+
+int main(int argc, char* argv[]) {
+
+    std::vector<char*> pages;
+    std::vector<size_t> sizes;
+    for (int i = 0; i < NUM_PAGES; i++) {
+        size_t numBytes;
+        pages.push_back(makeObjectPage(i * 100000, numBytes));
+        sizes.push_back(numBytes);
+    }
+    size_t randomBytes;
+    char* randomPage = makeRandomPage(randomBytes);
+
+    // the byte planes of a size that is not a multiple of 8
+    std::vector<char> planes(1001), unshuffled(1001);
+    PageCodec::shuffleBytes(randomPage, 1001, planes.data());
+    PageCodec::unshuffleBytes(planes.data(), 1001, unshuffled.data());
+    if (memcmp(unshuffled.data(), randomPage, 1001) != 0) {
+        std::cout << "the byte planes were not put back together" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // every codec of this build
+    PageFrameHeader header;
+    for (int c = 0; c < NUM_PAGE_CODECS; c++) {
+        PageCodecType codecType = (PageCodecType)c;
+        if (PageCodec::isAvailable(codecType) == false) {
+            continue;
+        }
+        PageCodec codec(PageCodec::getCodecName(codecType));
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < NUM_PAGES; i++) {
+            checkRoundTrip(codec, pages[i], sizes[i], header);
+        }
+        auto end = std::chrono::steady_clock::now();
+        checkRoundTrip(codec, randomPage, randomBytes, header);
+        if (header.codec != NoCodec) {
+            std::cout << "a page of random bytes was compressed" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        const PageCodecStats& stats = codec.getStats();
+        std::cout << PageCodec::getCodecName(codecType) << ": " << stats.toString() << ", "
+                  << std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count()
+                  << " s for the pages of objects" << std::endl;
+    }
+
+    // a fast network is not worth compressing for
+    PageCodec fastCodec("adaptive", 1024 * 1024 * 1024);
+    for (int i = 0; i < NUM_PAGES; i++) {
+        checkRoundTrip(fastCodec, pages[i], sizes[i], header);
+        if (header.codec != NoCodec) {
+            std::cout << "compressed a page for a fast network" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // a slow one is, if the pages compress at all
+    PageCodec slowCodec("adaptive", 1);
+    for (int i = 0; i < NUM_PAGES; i++) {
+        checkRoundTrip(slowCodec, pages[i], sizes[i], header);
+    }
+    checkRoundTrip(slowCodec, randomPage, randomBytes, header);
+    PageCodec snappyCodec("snappy");
+    snappyCodec.encode(pages[0], sizes[0], header);
+    if ((header.codec != NoCodec) && (slowCodec.getStats().getBytesSaved() <= 0)) {
+        std::cout << "did not compress the pages for a slow network" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::cout << "adaptive, fast network: " << fastCodec.getStats().toString() << std::endl;
+    std::cout << "adaptive, slow network: " << slowCodec.getStats().toString() << std::endl;
+
+    for (char* page : pages) {
+        free(page);
+    }
+    free(randomPage);
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
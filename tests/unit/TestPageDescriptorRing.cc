@@ -0,0 +1,286 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_PAGE_DESCRIPTOR_RING_CC
+#define TEST_PAGE_DESCRIPTOR_RING_CC
+
+#include "PageDescriptorRing.h"
+#include "PageTransferChannel.h"
+#include "SharedMem.h"
+#include "PDBLogger.h"
+
+#include <chrono>
+#include <iostream>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// PageDescriptorRing unit test and benchmark: a forked child plays the backend, it takes the
+// pages the parent pushes to the scan rings of two concurrent scans, and releases each of them
+// through the unpinned ring without waiting, like DataProxy::unpinUserPage() does, and waits for
+// the parent to unpin all of them at the end of the scan. The parent unpins the pages in batches,
+// like PDBUnpinConsumerWork. The first scan ends long before the second one, which must not end
+// with it. The backend also checks that a scan gives up waiting for a ring when all of them are
+// claimed, and that a ScanRingGuard gives its ring back.
+
+#define NUM_SCANS 2
+#define NUM_PRODUCERS 4
+#define NUM_PAGES_PER_PRODUCER 50000
+#define RING_SIZE 64
+
+struct ProducerArgs {
+    PageDescriptorRing* ring;
+    int producerId;
+    int numPages;
+};
+
+void* runProducer(void* arg) {
+    ProducerArgs* args = (ProducerArgs*)arg;
+    PageDescriptor descriptor;
+    descriptor.type = PagePinnedDescriptor;
+    descriptor.dbId = 1;
+    descriptor.typeId = 1;
+    descriptor.setId = args->producerId;
+    size_t ticket;
+    for (int i = 0; i < args->numPages; i++) {
+        descriptor.pageId = i;
+        descriptor.offset = (size_t)args->producerId * NUM_PAGES_PER_PRODUCER + i;
+        if (args->ring->push(descriptor, ticket) == false) {
+            std::cout << "can't push page " << i << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    return nullptr;
+}
+
+struct UnpinnerArgs {
+    PageDescriptorRing* ring;
+    long numUnpinned;
+    long sumOfOffsets;
+};
+
+void* runUnpinner(void* arg) {
+    UnpinnerArgs* args = (UnpinnerArgs*)arg;
+    PageDescriptor descriptor;
+    size_t ticket;
+    while (args->ring->pop(descriptor, ticket) == true) {
+        int numInBatch = 0;
+        do {
+            if (descriptor.type == PageUnpinnedDescriptor) {
+                args->numUnpinned++;
+                args->sumOfOffsets += descriptor.offset;
+            }
+            numInBatch++;
+        } while ((numInBatch < 16) && (args->ring->tryPop(descriptor, ticket) == true));
+        args->ring->complete(ticket);
+    }
+    return nullptr;
+}
+
+// the number of pages the producers of a scan push, the producers of the first scan are done early
+int getNumPages(int producerId) {
+    return (producerId % NUM_SCANS == 0) ? NUM_PAGES_PER_PRODUCER / 100 : NUM_PAGES_PER_PRODUCER;
+}
+
+struct ScannerArgs {
+    PageTransferChannelPtr channel;
+    int scanRingId;
+    int result;
+};
+
+// the backend scan: check that the pages of each producer of the scan come in order, and release
+// them
+void* runScanner(void* arg) {
+    ScannerArgs* args = (ScannerArgs*)arg;
+    PageTransferChannelPtr channel = args->channel;
+    args->result = EXIT_FAILURE;
+    std::vector<long> nextPageIds(NUM_PRODUCERS, 0);
+    PageDescriptor descriptor;
+    size_t ticket;
+    size_t lastUnpinTicket;
+    bool hasPendingUnpins = false;
+    while (channel->getScanRing(args->scanRingId)->pop(descriptor, ticket) == true) {
+        if (descriptor.type == NoMorePagesDescriptor) {
+            break;
+        }
+        if (descriptor.setId % NUM_SCANS != args->scanRingId) {
+            std::cout << "got page of producer " << descriptor.setId << " in scan "
+                      << args->scanRingId << std::endl;
+            return nullptr;
+        }
+        if (descriptor.pageId != nextPageIds[descriptor.setId]) {
+            std::cout << "got page " << descriptor.pageId << " of producer " << descriptor.setId
+                      << ", expected page " << nextPageIds[descriptor.setId] << std::endl;
+            return nullptr;
+        }
+        nextPageIds[descriptor.setId]++;
+        descriptor.type = PageUnpinnedDescriptor;
+        if (channel->getUnpinnedPages()->push(descriptor, ticket) == false) {
+            std::cout << "can't release page " << descriptor.pageId << std::endl;
+            return nullptr;
+        }
+        lastUnpinTicket = ticket;
+        hasPendingUnpins = true;
+    }
+    if (hasPendingUnpins == true) {
+        channel->getUnpinnedPages()->waitForCompletion(lastUnpinTicket);
+    }
+    for (int i = args->scanRingId; i < NUM_PRODUCERS; i += NUM_SCANS) {
+        if (nextPageIds[i] != getNumPages(i)) {
+            std::cout << "got " << nextPageIds[i] << " pages of producer " << i << std::endl;
+            return nullptr;
+        }
+    }
+    args->result = EXIT_SUCCESS;
+    return nullptr;
+}
+
+// the backend: one PageScanner per scan
+int runBackend(PageTransferChannelPtr channel) {
+    std::vector<pthread_t> scanners(NUM_SCANS);
+    std::vector<ScannerArgs> scannerArgs(NUM_SCANS);
+    for (int i = 0; i < NUM_SCANS; i++) {
+        scannerArgs[i].channel = channel;
+        scannerArgs[i].scanRingId = channel->acquireScanRing();
+        if (scannerArgs[i].scanRingId != i) {
+            std::cout << "claimed scan ring " << scannerArgs[i].scanRingId << std::endl;
+            return EXIT_FAILURE;
+        }
+        pthread_create(&scanners[i], nullptr, runScanner, &scannerArgs[i]);
+    }
+    {
+        // all the rings are claimed, a third scan must not wait forever
+        ScanRingGuard busy(channel, 10);
+        if (busy.getScanRingId() != -1) {
+            std::cout << "claimed scan ring " << busy.getScanRingId() << " twice" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    int result = EXIT_SUCCESS;
+    for (int i = 0; i < NUM_SCANS; i++) {
+        pthread_join(scanners[i], nullptr);
+        channel->releaseScanRing(scannerArgs[i].scanRingId);
+        if (scannerArgs[i].result != EXIT_SUCCESS) {
+            result = EXIT_FAILURE;
+        }
+    }
+    {
+        ScanRingGuard first(channel, 10);
+        if (first.getScanRingId() != 0) {
+            std::cout << "claimed scan ring " << first.getScanRingId() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    ScanRingGuard second(channel, 10);
+    if (second.getScanRingId() != 0) {
+        std::cout << "scan ring 0 was not given back by its guard" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+
+    pdb::PDBLoggerPtr logger = make_shared<pdb::PDBLogger>("testPageDescriptorRing.log");
+    SharedMemPtr shm = make_shared<SharedMem>((size_t)64 * 1024 * 1024, logger);
+    PageTransferChannelPtr channel = make_shared<PageTransferChannel>(shm, RING_SIZE, NUM_SCANS);
+    if (channel->isValid() == false) {
+        std::cout << "can't allocate the rings, exit..." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (channel->getScanRing(0)->getCapacity() != RING_SIZE) {
+        std::cout << "wrong ring capacity" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // the rings must be allocated before the fork, like in WorkerMain
+    pid_t child = fork();
+    if (child == 0) {
+        exit(runBackend(channel));
+    } else if (child < 0) {
+        std::cout << "can't fork, exit..." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+
+    pthread_t unpinner;
+    UnpinnerArgs unpinnerArgs;
+    unpinnerArgs.ring = channel->getUnpinnedPages();
+    unpinnerArgs.numUnpinned = 0;
+    unpinnerArgs.sumOfOffsets = 0;
+    pthread_create(&unpinner, nullptr, runUnpinner, &unpinnerArgs);
+
+    std::vector<pthread_t> producers(NUM_PRODUCERS);
+    std::vector<ProducerArgs> producerArgs(NUM_PRODUCERS);
+    for (int i = 0; i < NUM_PRODUCERS; i++) {
+        producerArgs[i].ring = channel->getScanRing(i % NUM_SCANS);
+        producerArgs[i].producerId = i;
+        producerArgs[i].numPages = getNumPages(i);
+        pthread_create(&producers[i], nullptr, runProducer, &producerArgs[i]);
+    }
+
+    // like the StorageGetSetPages handler, once all the scan threads of a scan are done, the first
+    // scan ends while the second one is still running
+    PageDescriptor noMorePages;
+    noMorePages.type = NoMorePagesDescriptor;
+    size_t ticket;
+    for (int scan = 0; scan < NUM_SCANS; scan++) {
+        for (int i = scan; i < NUM_PRODUCERS; i += NUM_SCANS) {
+            pthread_join(producers[i], nullptr);
+        }
+        channel->getScanRing(scan)->push(noMorePages, ticket);
+    }
+
+    int status;
+    waitpid(child, &status, 0);
+    auto end = std::chrono::steady_clock::now();
+
+    // all the releases have been completed, so we can stop the unpinner
+    channel->getUnpinnedPages()->close();
+    pthread_join(unpinner, nullptr);
+
+    if ((WIFEXITED(status) == false) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        std::cout << "the backend failed" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    long numPages = 0;
+    long expectedSum = 0;
+    for (int i = 0; i < NUM_PRODUCERS; i++) {
+        long firstOffset = (long)i * NUM_PAGES_PER_PRODUCER;
+        long numPagesOfProducer = getNumPages(i);
+        numPages += numPagesOfProducer;
+        expectedSum +=
+            numPagesOfProducer * firstOffset + numPagesOfProducer * (numPagesOfProducer - 1) / 2;
+    }
+    if ((unpinnerArgs.numUnpinned != numPages) || (unpinnerArgs.sumOfOffsets != expectedSum)) {
+        std::cout << "unpinned " << unpinnerArgs.numUnpinned << " pages, expected " << numPages
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+    std::cout << "passed " << numPages << " pages in " << seconds << "s, " << numPages / seconds
+              << " pin/unpin round trips/s" << std::endl;
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,209 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_PAGE_IO_ENGINE_CC
+#define TEST_PAGE_IO_ENGINE_CC
+
+#include "PageIOEngine.h"
+
+#include <chrono>
+#include <fcntl.h>
+#include <iostream>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+// PageIOEngine unit test and benchmark: writes a file of pages through each available backend,
+// reads it back with one and with many pages in flight, checks the data and reports the bandwidth.
+// Then several threads read the file at once through their own clients of one shared engine.
+
+#define PAGE_SIZE_FOR_TEST (1024 * 1024)
+#define NUM_PAGES_FOR_TEST 256
+#define NUM_SHARED_ENGINE_CLIENTS 4
+
+const char* testFile = "testPageIOEngine.dat";
+
+// run all the requests through the engine, keeping at most depth of them in flight
+bool runRequests(PageIOEnginePtr engine, vector<PageIORequest>& requests, unsigned int depth) {
+    size_t next = 0;
+    size_t numCompleted = 0;
+    while (numCompleted < requests.size()) {
+        vector<PageIORequest*> batch;
+        while ((next < requests.size()) && (engine->getNumInFlight() + batch.size() < depth)) {
+            batch.push_back(&requests[next++]);
+        }
+        if (!batch.empty() && !engine->submit(batch)) {
+            std::cout << "submit failed" << std::endl;
+            return false;
+        }
+        PageIORequest* request = engine->waitForCompletion();
+        if ((request == nullptr) || (request->result != (ssize_t)request->length)) {
+            std::cout << "request failed with " << (request ? request->result : 0) << std::endl;
+            return false;
+        }
+        numCompleted++;
+    }
+    return true;
+}
+
+vector<PageIORequest> makeRequests(int handle, vector<char*>& buffers, bool isWrite) {
+    vector<PageIORequest> requests(buffers.size());
+    for (size_t i = 0; i < buffers.size(); i++) {
+        requests[i].handle = handle;
+        requests[i].buffer = buffers[i];
+        requests[i].length = PAGE_SIZE_FOR_TEST;
+        requests[i].offset = (off_t)i * PAGE_SIZE_FOR_TEST;
+        requests[i].isWrite = isWrite;
+        requests[i].result = 0;
+        requests[i].userData = nullptr;
+        requests[i].client = nullptr;
+    }
+    return requests;
+}
+
+struct ClientArgs {
+    PageIOEnginePtr client;
+    vector<PageIORequest> requests;
+    bool success;
+};
+
+void* runClient(void* arg) {
+    ClientArgs* args = (ClientArgs*)arg;
+    args->success = runRequests(args->client, args->requests, args->client->getQueueDepth());
+    return nullptr;
+}
+
+int main(int argc, char* argv[]) {
+
+    // O_DIRECT is not supported by every file system, fall back to buffered I/O
+    int handle = open(testFile, O_RDWR | O_CREAT | O_TRUNC | O_DIRECT, S_IRWXU);
+    if (handle < 0) {
+        handle = open(testFile, O_RDWR | O_CREAT | O_TRUNC, S_IRWXU);
+    }
+    if (handle < 0) {
+        std::cout << "can't open " << testFile << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    vector<char*> buffers(NUM_PAGES_FOR_TEST);
+    for (int i = 0; i < NUM_PAGES_FOR_TEST; i++) {
+        if (posix_memalign((void**)&buffers[i], 4096, PAGE_SIZE_FOR_TEST) != 0) {
+            std::cout << "out of memory" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    bool success = true;
+    vector<string> backends = {"io_uring", "aio", "threads"};
+    for (string backend : backends) {
+        PageIOEnginePtr engine = createPageIOEngine(backend, 32);
+        if (engine == nullptr) {
+            std::cout << backend << ": not supported" << std::endl;
+            continue;
+        }
+
+        // write the pages, every page is filled with its own number
+        for (int i = 0; i < NUM_PAGES_FOR_TEST; i++) {
+            memset(buffers[i], i % 251, PAGE_SIZE_FOR_TEST);
+        }
+        vector<PageIORequest> writes = makeRequests(handle, buffers, true);
+        if (!runRequests(engine, writes, 32)) {
+            std::cout << backend << ": write failed" << std::endl;
+            success = false;
+            continue;
+        }
+        fsync(handle);
+
+        for (unsigned int depth : {1, 32}) {
+            for (int i = 0; i < NUM_PAGES_FOR_TEST; i++) {
+                memset(buffers[i], 0xff, PAGE_SIZE_FOR_TEST);
+            }
+            vector<PageIORequest> reads = makeRequests(handle, buffers, false);
+            auto begin = std::chrono::steady_clock::now();
+            if (!runRequests(engine, reads, depth)) {
+                std::cout << backend << ": read failed" << std::endl;
+                success = false;
+                continue;
+            }
+            auto end = std::chrono::steady_clock::now();
+            double seconds =
+                std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+            std::cout << backend << ": " << depth << " pages in flight, "
+                      << (double)NUM_PAGES_FOR_TEST * PAGE_SIZE_FOR_TEST / seconds / 1024 / 1024
+                      << " MB/s" << std::endl;
+
+            for (int i = 0; i < NUM_PAGES_FOR_TEST; i++) {
+                if ((buffers[i][0] != (char)(i % 251)) ||
+                    (buffers[i][PAGE_SIZE_FOR_TEST - 1] != (char)(i % 251))) {
+                    std::cout << backend << ": wrong data in page " << i << std::endl;
+                    success = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    // the file holds the pages written by the last backend, every client reads a quarter of them
+    SharedPageIOEnginePtr sharedEngine = createSharedPageIOEngine(32);
+    for (int i = 0; i < NUM_PAGES_FOR_TEST; i++) {
+        memset(buffers[i], 0xff, PAGE_SIZE_FOR_TEST);
+    }
+    vector<PageIORequest> reads = makeRequests(handle, buffers, false);
+    vector<ClientArgs> clients(NUM_SHARED_ENGINE_CLIENTS);
+    vector<pthread_t> threads(NUM_SHARED_ENGINE_CLIENTS);
+    for (int i = 0; i < NUM_SHARED_ENGINE_CLIENTS; i++) {
+        clients[i].client = sharedEngine->createClient(8);
+        for (int j = i; j < NUM_PAGES_FOR_TEST; j += NUM_SHARED_ENGINE_CLIENTS) {
+            clients[i].requests.push_back(reads[j]);
+        }
+        pthread_create(&threads[i], nullptr, runClient, &clients[i]);
+    }
+    for (int i = 0; i < NUM_SHARED_ENGINE_CLIENTS; i++) {
+        pthread_join(threads[i], nullptr);
+        if (clients[i].success == false) {
+            std::cout << sharedEngine->getName() << ": shared read failed" << std::endl;
+            success = false;
+        }
+    }
+    for (int i = 0; i < NUM_PAGES_FOR_TEST; i++) {
+        if ((buffers[i][0] != (char)(i % 251)) ||
+            (buffers[i][PAGE_SIZE_FOR_TEST - 1] != (char)(i % 251))) {
+            std::cout << sharedEngine->getName() << ": wrong data in shared page " << i
+                      << std::endl;
+            success = false;
+            break;
+        }
+    }
+    clients.clear();
+    sharedEngine = nullptr;
+
+    for (int i = 0; i < NUM_PAGES_FOR_TEST; i++) {
+        free(buffers[i]);
+    }
+    close(handle);
+    unlink(testFile);
+
+    if (!success) {
+        exit(EXIT_FAILURE);
+    }
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,331 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_PAIR_ARRAY_CC
+#define TEST_PAIR_ARRAY_CC
+
+#include "InterfaceFunctions.h"
+#include "PDBMap.h"
+#include "PDBString.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+// PairArray unit test and benchmark: we fill pdb::Maps with findOrInsert and operator[] and check
+// them against std::unordered_map, also after the pages they are on have been moved, and compare
+// the time to aggregate a column of keys with the layout that PairArray had before (a hash in
+// every record, slot = hash % (numSlots - 1), count () and then operator[] for every key) with
+// the time taken by a pdb::Map with count () and operator[], and with findOrInsert.
+//
+// Under ctest the hash tables are only compared on a few tuples; the timings are taken on enough
+// tuples to mean something when the test is built with -DPAIR_ARRAY_BENCHMARK.
+
+#ifdef PAIR_ARRAY_BENCHMARK
+#define NUM_TUPLES (8 * 1024 * 1024)
+#define NUM_KEYS (256 * 1024)
+#define BLOCK_SIZE ((size_t)256 * 1024 * 1024)
+#else
+#define NUM_TUPLES (64 * 1024)
+#define NUM_KEYS (4 * 1024)
+#define BLOCK_SIZE ((size_t)32 * 1024 * 1024)
+#endif
+
+using namespace pdb;
+
+// the layout of PairArray before the control bytes, kept to compare with: a hash in every record,
+// and slot = hash % (numSlots - 1)
+template <class KeyType, class ValueType>
+class OldPairArray {
+
+private:
+    struct Record {
+        size_t hash;
+        KeyType key;
+        ValueType value;
+    };
+
+    std::vector<Record> records;
+
+    // returns the record of a key, or the empty one it goes to
+    Record& find(const KeyType& me, size_t hashVal) {
+        size_t numSlots = records.size();
+        size_t slot = hashVal % (numSlots - 1);
+        while (records[slot].hash != UNUSED) {
+            if (records[slot].hash == hashVal && records[slot].key == me) {
+                break;
+            }
+            slot = (slot == numSlots - 1) ? 0 : slot + 1;
+        }
+        return records[slot];
+    }
+
+public:
+    OldPairArray(uint32_t numSlots) : records(numSlots) {
+        for (Record& record : records) {
+            record.hash = UNUSED;
+        }
+    }
+
+    int count(const KeyType& me) {
+        return (find(me, Hasher<KeyType>::hash(me)).hash == UNUSED) ? 0 : 1;
+    }
+
+    ValueType& operator[](const KeyType& me) {
+        size_t hashVal = Hasher<KeyType>::hash(me);
+        Record& record = find(me, hashVal);
+        if (record.hash == UNUSED) {
+            record.hash = hashVal;
+            record.key = me;
+            record.value = ValueType();
+        }
+        return record.value;
+    }
+};
+
+// checks a map against the sums it should have
+template <class KeyType, class SumKeyType>
+void checkMap(Map<KeyType, int>& myMap,
+              std::unordered_map<SumKeyType, int>& sums,
+              std::string what) {
+    if (myMap.size() != sums.size()) {
+        std::cout << what << ": the map has " << myMap.size() << " keys instead of "
+                  << sums.size() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    size_t numSeen = 0;
+    for (auto& record : myMap) {
+        SumKeyType key = record.key;
+        if ((sums.count(key) == 0) || (sums[key] != record.value)) {
+            std::cout << what << ": the map has a wrong value" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        numSeen++;
+    }
+    for (auto& sum : sums) {
+        KeyType key(sum.first);
+        if ((myMap.count(key) == 0) || (myMap[key] != sum.second)) {
+            std::cout << what << ": the map misses a key" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (numSeen != sums.size()) {
+        std::cout << what << ": iterated over " << numSeen << " keys" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+// adds to the value of a key as the aggregation sinks do
+template <class KeyType>
+void aggregate(Map<KeyType, int>& myMap, const KeyType& key, int value) {
+    bool inserted;
+    int& sum = myMap.findOrInsert(key, inserted);
+    if (inserted) {
+        sum = value;
+    } else {
+        sum = sum + value;
+    }
+}
+
+double getSeconds(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration_cast<std::chrono::duration<double>>(
+               std::chrono::steady_clock::now() - begin)
+        .count();
+}
+
+int main(int argc, char* argv[]) {
+
+    void* myBlock = malloc(BLOCK_SIZE);
+    makeObjectAllocatorBlock(myBlock, BLOCK_SIZE, true);
+
+    // integer keys, a map that starts with one slot and keeps doubling
+    std::unordered_map<int, int> intSums;
+    Handle<Map<int, int>> intMap = makeObject<Map<int, int>>();
+    unsigned int seed = 0;
+    for (int i = 0; i < 100000; i++) {
+        int key = rand_r(&seed) % 30000 - 15000;
+        aggregate(*intMap, key, i);
+        intSums[key] += i;
+    }
+    checkMap(*intMap, intSums, "int keys");
+
+    // std::hash is the identity on long, and these keys all have the same low bits
+    std::unordered_map<long, int> longSums;
+    Handle<Map<long, int>> longMap = makeObject<Map<long, int>>(100);
+    for (long i = 0; i < 20000; i++) {
+        (*longMap)[i * 1024] += 1;
+        longSums[i * 1024] += 1;
+    }
+    checkMap(*longMap, longSums, "long keys");
+
+    // a key that was just added can be taken out again
+    bool inserted;
+    longMap->findOrInsert(-1, inserted);
+    longMap->setUnused(-1);
+    if ((inserted == false) || (longMap->count(-1) != 0)) {
+        std::cout << "could not take out the last key" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // string keys, on a page that is moved somewhere else
+    std::unordered_map<std::string, int> stringSums;
+    Handle<Map<String, int>> stringMap = makeObject<Map<String, int>>(16);
+    for (int i = 0; i < 20000; i++) {
+        std::string key = "key_" + std::to_string(i % 5000);
+        aggregate(*stringMap, String(key), 1);
+        stringSums[key] += 1;
+    }
+    checkMap(*stringMap, stringSums, "string keys");
+    getRecord(stringMap);
+    void* myOtherBlock = malloc(BLOCK_SIZE);
+    memcpy(myOtherBlock, myBlock, BLOCK_SIZE);
+    intMap = nullptr;
+    longMap = nullptr;
+    stringMap = nullptr;
+    memset(myBlock, 0, BLOCK_SIZE);
+    Handle<Map<String, int>> movedMap =
+        ((Record<Map<String, int>>*)myOtherBlock)->getRootObject();
+    checkMap(*movedMap, stringSums, "moved string keys");
+
+    // and a deep copy of it
+    makeObjectAllocatorBlock(BLOCK_SIZE, true);
+    Handle<Map<String, int>> copiedMap =
+        deepCopyToCurrentAllocationBlock<Map<String, int>>(movedMap);
+    checkMap(*copiedMap, stringSums, "copied string keys");
+    movedMap = nullptr;
+    copiedMap = nullptr;
+    free(myOtherBlock);
+
+    // the benchmark, or the same on a few tuples: a column of keys to aggregate, and keys that are
+    // not there
+    std::vector<int> keys(NUM_TUPLES);
+    std::vector<int> missingKeys(NUM_TUPLES);
+    for (int i = 0; i < NUM_TUPLES; i++) {
+        keys[i] = rand_r(&seed) % NUM_KEYS;
+        missingKeys[i] = NUM_KEYS + rand_r(&seed) % NUM_KEYS;
+    }
+    uint32_t numSlots = PairArray<int, int>::getNumSlots(NUM_KEYS / FILL_FACTOR);
+    long numFound = 0;
+
+    // the old layout, with count () and then operator[] as the sinks did
+    OldPairArray<int, int> oldArray(numSlots);
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_TUPLES; i++) {
+        if (oldArray.count(keys[i]) == 0) {
+            oldArray[keys[i]] = 1;
+        } else {
+            oldArray[keys[i]] += 1;
+        }
+    }
+    double oldSeconds = getSeconds(begin);
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_TUPLES; i++) {
+        numFound += oldArray.count(missingKeys[i]);
+    }
+    double oldMissSeconds = getSeconds(begin);
+
+    // the control bytes, with count () and operator[], and with findOrInsert
+    makeObjectAllocatorBlock(BLOCK_SIZE, true);
+    size_t storageSize =
+        PairArray<int, int>::getStorageSize(sizeof(MapRecordClass<int, int>), numSlots);
+    Handle<PairArray<int, int>> countArray =
+        makeObjectWithExtraStorage<PairArray<int, int>>(storageSize, numSlots);
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_TUPLES; i++) {
+        if (countArray->count(keys[i]) == 0) {
+            (*countArray)[keys[i]] = 1;
+        } else {
+            (*countArray)[keys[i]] += 1;
+        }
+    }
+    double countSeconds = getSeconds(begin);
+
+    Handle<PairArray<int, int>> newArray =
+        makeObjectWithExtraStorage<PairArray<int, int>>(storageSize, numSlots);
+    PairArray<int, int>& findOrInsertArray = *newArray;
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_TUPLES; i++) {
+        int* sum = findOrInsertArray.findOrInsert(keys[i], Hasher<int>::hash(keys[i]), inserted);
+        if (inserted) {
+            *sum = 1;
+        } else {
+            *sum += 1;
+        }
+    }
+    double findOrInsertSeconds = getSeconds(begin);
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_TUPLES; i++) {
+        numFound += findOrInsertArray.count(missingKeys[i]);
+    }
+    double missSeconds = getSeconds(begin);
+
+    // and pdb::Maps that start small, as the one of a HashSink
+    Handle<Map<int, int>> countMap = makeObject<Map<int, int>>();
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_TUPLES; i++) {
+        if (countMap->count(keys[i]) == 0) {
+            (*countMap)[keys[i]] = 1;
+        } else {
+            (*countMap)[keys[i]] += 1;
+        }
+    }
+    double countMapSeconds = getSeconds(begin);
+
+    Handle<Map<int, int>> myMap = makeObject<Map<int, int>>();
+    begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < NUM_TUPLES; i++) {
+        aggregate(*myMap, keys[i], 1);
+    }
+    double mapSeconds = getSeconds(begin);
+
+    if (numFound != 0) {
+        std::cout << "found keys that are not there" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    for (int key = 0; key < NUM_KEYS; key++) {
+        int numSums = oldArray.count(key) + countArray->count(key) + findOrInsertArray.count(key) +
+            countMap->count(key) + myMap->count(key);
+        if ((numSums != 0) &&
+            ((numSums != 5) || (oldArray[key] != (*countArray)[key]) ||
+             (oldArray[key] != findOrInsertArray[key]) || (oldArray[key] != (*countMap)[key]) ||
+             (oldArray[key] != (*myMap)[key]))) {
+            std::cout << "the hash tables have different sums" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    std::cout << NUM_TUPLES << " tuples, " << myMap->size() << " keys, " << numSlots << " slots"
+              << std::endl;
+#ifdef PAIR_ARRAY_BENCHMARK
+    std::cout << "old PairArray, count () and []: " << oldSeconds << " s, misses: "
+              << oldMissSeconds << " s" << std::endl;
+    std::cout << "PairArray, count () and []: " << countSeconds << " s" << std::endl;
+    std::cout << "PairArray, findOrInsert: " << findOrInsertSeconds << " s, misses: "
+              << missSeconds << " s" << std::endl;
+    std::cout << "Map, count () and []: " << countMapSeconds << " s" << std::endl;
+    std::cout << "Map, findOrInsert: " << mapSeconds << " s" << std::endl;
+    std::cout << "speedup: " << oldSeconds / findOrInsertSeconds << "x, misses: "
+              << oldMissSeconds / missSeconds << "x" << std::endl;
+#endif
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,162 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_SEQUENTIAL_SCAN_PREFETCH_CC
+#define TEST_SEQUENTIAL_SCAN_PREFETCH_CC
+
+#include "PageReadAhead.h"
+#include "PageCache.h"
+#include "PageCircularBuffer.h"
+#include "LocalitySet.h"
+#include "SharedMem.h"
+#include "Configuration.h"
+#include "PDBWorkerQueue.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// Sequential scan unit test and benchmark: checks that a LocalitySet detects sequential and
+// looping scans, scans a file with and without read-ahead, and checks that the pages of a set
+// scanned once are dropped as soon as they are consumed.
+
+#define NUM_PAGES_IN_FILE 256
+#define PAGE_SIZE_FOR_TEST (1024 * 1024)
+
+void check(bool condition, std::string message) {
+    if (!condition) {
+        std::cout << "FAILED: " << message << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+CacheKey makeKey(PageID pageId) {
+    CacheKey key;
+    key.dbId = 1;
+    key.typeId = 1;
+    key.setId = 1;
+    key.pageId = pageId;
+    return key;
+}
+
+// scan all the pages of the partition with the provided window depth, if drop is true the pages
+// are dropped from the cache right after they are consumed
+double scan(PageCachePtr cache, PartitionedFilePtr file, unsigned int depth, bool drop) {
+    auto begin = std::chrono::steady_clock::now();
+    PageReadAhead readAhead(cache, file, nullptr, depth);
+    unsigned int numRequested = 0;
+    for (unsigned int i = 0; i < NUM_PAGES_IN_FILE; i++) {
+        while ((numRequested < NUM_PAGES_IN_FILE) && (readAhead.isFull() == false)) {
+            if (readAhead.add(0, numRequested, file->loadPageId(0, numRequested)) == false) {
+                break;
+            }
+            numRequested++;
+        }
+        PDBPagePtr page = readAhead.take();
+        check(page != nullptr, "no page returned");
+        check(page->getPageID() == (PageID)i, "pages returned out of order");
+        cache->decPageRefCount(makeKey(page->getPageID()));
+        if (drop) {
+            check(cache->dropConsumedPage(makeKey(page->getPageID()), nullptr),
+                  "consumed page not dropped");
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+}
+
+int main(int argc, char* argv[]) {
+
+    // the access pattern detection
+    LocalitySet set(JobData, MRU, Read, TryCache, Persistent);
+    check(set.getAccessPattern() == SmallSequential, "wrong initial access pattern");
+    for (unsigned int i = 0; i < SEQUENTIAL_ACCESS_THRESHOLD; i++) {
+        check(set.isSequential() == false, "sequential scan detected too early");
+        set.recordPageAccess(0, i);
+    }
+    check(set.getAccessPattern() == StraightSequential, "sequential scan not detected");
+    check(set.isDroppedAfterRead() == false, "pages of a set not declared read once are dropped");
+    set.recordPageAccess(0, 0);
+    check(set.getAccessPattern() == LoopingSequential, "second scan not detected");
+    set.declareAccessPattern(StraightSequential);
+    check(set.getAccessPattern() == LoopingSequential, "looping scan overridden by declaration");
+    check(set.isDroppedAfterRead() == false, "pages of a set scanned again are dropped");
+
+    // the pages are only dropped when the scan declares the set read once
+    LocalitySet declaredSet(JobData, MRU, Write, TryCache, Persistent);
+    declaredSet.declareAccessPattern(StraightSequential);
+    check(declaredSet.isDroppedAfterRead() == true, "pages of a set read once are not dropped");
+    declaredSet.recordPageAccess(0, 0);
+    declaredSet.recordPageAccess(0, 1);
+    declaredSet.recordPageAccess(0, 0);
+    check(declaredSet.isDroppedAfterRead() == false, "pages of a set scanned again are dropped");
+
+    // a cache that holds a quarter of the file
+    ConfigurationPtr conf = make_shared<Configuration>();
+    conf->setPageSize(PAGE_SIZE_FOR_TEST);
+    conf->setShufflePageSize(PAGE_SIZE_FOR_TEST);
+    conf->setBroadcastPageSize(PAGE_SIZE_FOR_TEST);
+    conf->setMaxPageSize(PAGE_SIZE_FOR_TEST);
+    conf->setShmSize((size_t)PAGE_SIZE_FOR_TEST * NUM_PAGES_IN_FILE / 4);
+    pdb::PDBLoggerPtr logger = make_shared<pdb::PDBLogger>("testSequentialScanPrefetch.log");
+    SharedMemPtr shm = make_shared<SharedMem>(conf->getShmSize(), logger);
+    pdb::PDBWorkerQueuePtr workers = make_shared<pdb::PDBWorkerQueue>(logger, 4);
+    PageCircularBufferPtr flushBuffer = make_shared<PageCircularBuffer>(16, logger);
+    PageCachePtr cache = make_shared<PageCache>(conf, workers, flushBuffer, logger, shm);
+
+    // write the file
+    system("rm -rf testSequentialScanPrefetch; mkdir -p testSequentialScanPrefetch");
+    vector<string> dataPaths = {"testSequentialScanPrefetch/data"};
+    PartitionedFilePtr file = make_shared<PartitionedFile>(
+        0, 1, 1, 1, "testSequentialScanPrefetch/meta", dataPaths, logger, PAGE_SIZE_FOR_TEST);
+    file->openAll();
+    char* buffer = (char*)malloc(PAGE_SIZE_FOR_TEST);
+    for (int i = 0; i < NUM_PAGES_IN_FILE; i++) {
+        memset(buffer, 0, PAGE_SIZE_FOR_TEST);
+        PDBPagePtr page =
+            make_shared<PDBPage>(buffer, 0, 1, 1, 1, (PageID)i, PAGE_SIZE_FOR_TEST, 0, 0);
+        page->preparePage();
+        check(file->appendPage(0, page) >= 0, "can't write the file");
+        page->setRawBytes(nullptr);
+    }
+    free(buffer);
+
+    double syncTime = scan(cache, file, 1, false);
+    std::cout << "scan without read-ahead: " << NUM_PAGES_IN_FILE / syncTime << " pages/s"
+              << std::endl;
+    double readAheadTime = scan(cache, file, SEQUENTIAL_SCAN_PREFETCH_DEPTH, false);
+    std::cout << "scan with " << SEQUENTIAL_SCAN_PREFETCH_DEPTH
+              << " pages of read-ahead: " << NUM_PAGES_IN_FILE / readAheadTime << " pages/s"
+              << std::endl;
+
+    // the pages consumed and dropped don't take room in the cache, so nothing has to be evicted
+    long numEvicted = cache->getStats().numEvicted;
+    double dropTime = scan(cache, file, SEQUENTIAL_SCAN_PREFETCH_DEPTH, true);
+    std::cout << "scan with read-ahead dropping consumed pages: "
+              << NUM_PAGES_IN_FILE / dropTime << " pages/s" << std::endl;
+    CacheStats stats = cache->getStats();
+    std::cout << "cache stats: " << stats.toString() << std::endl;
+    check(stats.numEvicted - numEvicted >= NUM_PAGES_IN_FILE, "consumed pages were not freed");
+
+    system("rm -rf testSequentialScanPrefetch");
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
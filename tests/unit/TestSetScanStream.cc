@@ -0,0 +1,236 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_SET_SCAN_STREAM_CC
+#define TEST_SET_SCAN_STREAM_CC
+
+#include "SetScanStream.h"
+#include "PageCodec.h"
+#include "PDBCommunicator.h"
+#include "SetScan.h"
+#include "DoneWithResult.h"
+#include "InterfaceFunctions.h"
+#include "UseTemporaryAllocationBlock.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// SetScanStream unit test and benchmark: child processes play the workers, streaming the pages of
+// their part of a set as the SetScan handler does, taking some time to get every page. We check
+// that every page arrives once, that a client that stops early stops the workers, and compare the
+// time to read the set from one worker a page at a time (a window of one page) with the time taken
+// with a window of SET_SCAN_WINDOW pages and with the set spread over NUM_WORKERS workers.
+
+#define NUM_PAGES 256
+#define NUM_WORKERS 4
+#define PAGE_BYTES (64 * 1024)
+#define PAGE_MICROS 500
+#define CONSUME_MICROS 100
+
+using namespace pdb;
+
+// the page i of a worker
+void makePage(int* page, int worker, int i) {
+    for (int j = 0; j < PAGE_BYTES / sizeof(int); j++) {
+        page[j] = worker * 1000000 + i + j;
+    }
+    page[0] = worker;
+    page[1] = i;
+}
+
+// a worker: returns the exit code of the child process
+int streamPages(int listenFD, int worker, int numPages) {
+    PDBLoggerPtr logger = make_shared<PDBLogger>("testSetScanStreamWorker.log");
+    PDBCommunicatorPtr communicator = make_shared<PDBCommunicator>();
+    std::string errMsg;
+    if (communicator->pointToInternet(logger, listenFD, errMsg)) {
+        return 1;
+    }
+    int noDelay = 1;
+    setsockopt(communicator->getSocketFD(), IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+    bool success;
+    Handle<SetScan> request = communicator->getNextObject<SetScan>(success, errMsg);
+    if ((success == false) || (request->getSetName() != "scan_set")) {
+        return 2;
+    }
+    int windowSize = request->getWindowSize();
+    int numUnacknowledged = 0;
+    bool stopped = false;
+    PageCodec codec("none");
+    int* page = (int*)malloc(PAGE_BYTES);
+    for (int i = 0; (i < numPages) && !stopped; i++) {
+        usleep(PAGE_MICROS);
+        makePage(page, worker, i);
+        if (codec.send(communicator, page, PAGE_BYTES, errMsg) == false) {
+            return 3;
+        }
+        numUnacknowledged++;
+        while (!stopped && (numUnacknowledged >= windowSize)) {
+            int numTaken;
+            if (SetScanStream::receiveCredit(communicator, numTaken, errMsg) == false) {
+                return 4;
+            }
+            numUnacknowledged -= numTaken;
+            stopped = (numTaken <= 0);
+        }
+    }
+    free(page);
+    Handle<DoneWithResult> done = makeObject<DoneWithResult>();
+    if (communicator->sendObject(done, errMsg) == false) {
+        return 5;
+    }
+    while (!stopped && (numUnacknowledged > 0)) {
+        int numTaken;
+        if (SetScanStream::receiveCredit(communicator, numTaken, errMsg) == false) {
+            return 6;
+        }
+        numUnacknowledged -= numTaken;
+        stopped = (numTaken <= 0);
+    }
+    return 0;
+}
+
+// reads the set from workers in child processes, returns the seconds taken; the client stops after
+// stopAfter pages if that is not negative
+double scanPages(int numWorkers, int windowSize, int stopAfter) {
+
+    std::vector<std::string> workers;
+    std::vector<pid_t> children;
+    for (int w = 0; w < numWorkers; w++) {
+        int listenFD = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+        socklen_t length = sizeof(address);
+        if ((bind(listenFD, (struct sockaddr*)&address, sizeof(address)) < 0) ||
+            (listen(listenFD, 1) < 0) ||
+            (getsockname(listenFD, (struct sockaddr*)&address, &length) < 0)) {
+            std::cout << "can't listen on a local port" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        pid_t child = fork();
+        if (child == 0) {
+            exit(streamPages(listenFD, w, NUM_PAGES / numWorkers));
+        }
+        close(listenFD);
+        children.push_back(child);
+        workers.push_back("127.0.0.1:" + std::to_string(ntohs(address.sin_port)));
+    }
+
+    PDBLoggerPtr logger = make_shared<PDBLogger>("testSetScanStream.log");
+    std::vector<std::vector<int>> numSeen(numWorkers, std::vector<int>(NUM_PAGES / numWorkers, 0));
+    int numTaken = 0;
+    bool ok;
+    std::string errMsg;
+    auto begin = std::chrono::steady_clock::now();
+    {
+        SetScanStream stream(logger, workers, "scan_db", "scan_set", windowSize);
+        if (stream.start(errMsg) == false) {
+            std::cout << "can't start the stream: " << errMsg << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        while ((stopAfter < 0) || (numTaken < stopAfter)) {
+            int* page = (int*)stream.nextPage();
+            if (page == nullptr) {
+                break;
+            }
+            int worker = page[0];
+            int i = page[1];
+            if ((worker < 0) || (worker >= numWorkers) || (i < 0) ||
+                (i >= NUM_PAGES / numWorkers) || (page[2] != worker * 1000000 + i + 2) ||
+                (page[PAGE_BYTES / sizeof(int) - 1] !=
+                 worker * 1000000 + i + PAGE_BYTES / sizeof(int) - 1)) {
+                std::cout << "got a page that was not sent" << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            numSeen[worker][i]++;
+            numTaken++;
+            usleep(CONSUME_MICROS);
+            free(page);
+        }
+        ok = stream.isOk();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    for (int w = 0; w < numWorkers; w++) {
+        int status;
+        waitpid(children[w], &status, 0);
+        int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        if (exitCode != 0) {
+            std::cout << "worker " << w << " failed with exit code " << exitCode << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (ok == false) {
+        std::cout << "the stream failed" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (stopAfter >= 0) {
+        if (numTaken != stopAfter) {
+            std::cout << "the stream ended before the client stopped it" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    } else {
+        for (int w = 0; w < numWorkers; w++) {
+            for (int i = 0; i < NUM_PAGES / numWorkers; i++) {
+                if (numSeen[w][i] != 1) {
+                    std::cout << "page " << i << " of worker " << w << " was received "
+                              << numSeen[w][i] << " times" << std::endl;
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+    }
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+}
+
+int main(int argc, char* argv[]) {
+
+    // a worker may close the connection while we are sending
+    signal(SIGPIPE, SIG_IGN);
+
+    double pageAtATimeSeconds = scanPages(1, 1, -1);
+    double windowSeconds = scanPages(1, SET_SCAN_WINDOW, -1);
+    double workersSeconds = scanPages(NUM_WORKERS, SET_SCAN_WINDOW, -1);
+    scanPages(NUM_WORKERS, SET_SCAN_WINDOW, NUM_PAGES / 8);
+    scanPages(NUM_WORKERS, SET_SCAN_WINDOW, 0);
+
+    std::cout << "one worker, one page in flight: " << pageAtATimeSeconds << " s" << std::endl;
+    std::cout << "one worker, " << SET_SCAN_WINDOW << " pages in flight: " << windowSeconds << " s"
+              << std::endl;
+    std::cout << NUM_WORKERS << " workers, " << SET_SCAN_WINDOW
+              << " pages in flight: " << workersSeconds << " s" << std::endl;
+    std::cout << "speedup: " << pageAtATimeSeconds / workersSeconds << "x" << std::endl;
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
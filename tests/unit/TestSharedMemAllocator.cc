@@ -0,0 +1,196 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_SHARED_MEM_ALLOCATOR_CC
+#define TEST_SHARED_MEM_ALLOCATOR_CC
+
+#include "SharedMem.h"
+#include "PDBLogger.h"
+#include "tlsf.h"
+
+#include <chrono>
+#include <iostream>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+// SharedMem unit test and benchmark: many threads allocate and free pages of two sizes, each thread
+// stamps its pages and checks the stamps before freeing them, so that a page given to two threads
+// is caught. We compare the throughput with a single tlsf allocator behind a mutex, which is what
+// SharedMem used before the chunk cache, run the same workload from a forked process at the same
+// time, and check that the cached chunks go back to the allocator when the pool runs out.
+
+#define POOL_SIZE ((size_t)256 * (size_t)1024 * (size_t)1024)
+#define SMALL_PAGE_SIZE ((size_t)64 * (size_t)1024)
+#define LARGE_PAGE_SIZE ((size_t)256 * (size_t)1024)
+#define NUM_PAGES_PER_THREAD 4
+#define NUM_OPS_PER_THREAD 100000
+
+// a single allocator behind a lock, the baseline
+class LockedPool {
+public:
+    LockedPool(size_t size) {
+        memory = ::malloc(size);
+        tlsf = allocator.tlsf_create_with_pool(memory, size);
+        pthread_mutex_init(&lock, nullptr);
+    }
+
+    ~LockedPool() {
+        pthread_mutex_destroy(&lock);
+        ::free(memory);
+    }
+
+    void* malloc(size_t size) {
+        pthread_mutex_lock(&lock);
+        void* ptr = allocator.tlsf_malloc(tlsf, size);
+        pthread_mutex_unlock(&lock);
+        return ptr;
+    }
+
+    void free(void* ptr, size_t size) {
+        pthread_mutex_lock(&lock);
+        allocator.tlsf_free(tlsf, ptr);
+        pthread_mutex_unlock(&lock);
+    }
+
+private:
+    void* memory;
+    tlsfAllocator allocator;
+    tlsf_t tlsf;
+    pthread_mutex_t lock;
+};
+
+template <class Pool>
+struct ChurnArgs {
+    Pool* pool;
+    long stamp;
+    long numErrors;
+};
+
+template <class Pool>
+void* churn(void* arg) {
+    ChurnArgs<Pool>* args = (ChurnArgs<Pool>*)arg;
+    void* pages[NUM_PAGES_PER_THREAD] = {nullptr};
+    size_t sizes[NUM_PAGES_PER_THREAD] = {0};
+    unsigned int seed = args->stamp;
+    for (long i = 0; i < NUM_OPS_PER_THREAD; i++) {
+        int which = i % NUM_PAGES_PER_THREAD;
+        if (pages[which] != nullptr) {
+            // nobody else may have written to the page while we held it
+            long* first = (long*)pages[which];
+            long* last = (long*)((char*)pages[which] + sizes[which] - sizeof(long));
+            if ((*first != args->stamp) || (*last != args->stamp)) {
+                args->numErrors++;
+            }
+            args->pool->free(pages[which], sizes[which]);
+        }
+        sizes[which] = (rand_r(&seed) % 2 == 0) ? SMALL_PAGE_SIZE : LARGE_PAGE_SIZE;
+        pages[which] = args->pool->malloc(sizes[which]);
+        if (pages[which] == nullptr) {
+            args->numErrors++;
+            continue;
+        }
+        *(long*)pages[which] = args->stamp;
+        *(long*)((char*)pages[which] + sizes[which] - sizeof(long)) = args->stamp;
+    }
+    for (int i = 0; i < NUM_PAGES_PER_THREAD; i++) {
+        if (pages[i] != nullptr) {
+            args->pool->free(pages[i], sizes[i]);
+        }
+    }
+    return nullptr;
+}
+
+// run the workload with numThreads threads, return the operations per second
+template <class Pool>
+double runChurn(Pool* pool, int numThreads, long firstStamp, long& numErrors) {
+    std::vector<pthread_t> threads(numThreads);
+    std::vector<ChurnArgs<Pool>> args(numThreads);
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < numThreads; i++) {
+        args[i].pool = pool;
+        args[i].stamp = firstStamp + i;
+        args[i].numErrors = 0;
+        pthread_create(&threads[i], nullptr, churn<Pool>, &args[i]);
+    }
+    for (int i = 0; i < numThreads; i++) {
+        pthread_join(threads[i], nullptr);
+        numErrors += args[i].numErrors;
+    }
+    auto end = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+    return (double)numThreads * NUM_OPS_PER_THREAD / seconds;
+}
+
+int main(int argc, char* argv[]) {
+
+    pdb::PDBLoggerPtr logger = make_shared<pdb::PDBLogger>("testSharedMemAllocator.log");
+    SharedMemPtr shm = make_shared<SharedMem>(POOL_SIZE, logger);
+    LockedPool lockedPool(POOL_SIZE);
+
+    // warm up both pools, so that neither pays for the first touch of its memory below
+    long numWarmUpErrors = 0;
+    runChurn(&lockedPool, 8, 1, numWarmUpErrors);
+    runChurn(shm.get(), 8, 1, numWarmUpErrors);
+
+    std::vector<int> threadCounts = {1, 8, 32, 64};
+    for (int numThreads : threadCounts) {
+        long numErrors = 0;
+        double lockedOpsPerSecond = runChurn(&lockedPool, numThreads, 1, numErrors);
+        double opsPerSecond = runChurn(shm.get(), numThreads, 1, numErrors);
+        std::cout << numThreads << " threads: " << opsPerSecond << " allocations/s, locked tlsf "
+                  << lockedOpsPerSecond << " allocations/s, speedup "
+                  << opsPerSecond / lockedOpsPerSecond << std::endl;
+        if (numErrors > 0) {
+            std::cout << numErrors << " pages were lost or given out twice!" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // the forked process shares the cache, the stamps of its threads differ from ours
+    pid_t child = fork();
+    if (child == 0) {
+        long numErrors = 0;
+        runChurn(shm.get(), 8, 1000, numErrors);
+        _exit(numErrors == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    long numErrors = 0;
+    runChurn(shm.get(), 8, 1, numErrors);
+    int status;
+    waitpid(child, &status, 0);
+    if ((numErrors > 0) || (WIFEXITED(status) == false) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+        std::cout << "pages were lost or given out twice across the processes!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // everything is freed, so most of the pool must be available again as one block, which needs
+    // the cached chunks to go back to the allocator
+    int offset;
+    void* block = shm->mallocAlign(POOL_SIZE / 4 * 3, 512, offset);
+    if (block == nullptr) {
+        std::cout << "the cached chunks were not given back to the allocator!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    shm->free((char*)block - offset, POOL_SIZE / 4 * 3 + 512);
+
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,258 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_SHUFFLE_CHANNEL_CC
+#define TEST_SHUFFLE_CHANNEL_CC
+
+#include "ShuffleChannel.h"
+#include "PageCodec.h"
+#include "PDBCommunicator.h"
+#include "StorageAddObjectInLoop.h"
+#include "SimpleRequestResult.h"
+#include "InterfaceFunctions.h"
+#include "UseTemporaryAllocationBlock.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ShuffleChannel unit test and benchmark: a child process plays the storage server of a remote
+// node, checking every page it gets and acknowledging it after a simulated network latency. We
+// check that all of the pages arrive in order, that a failed page makes the channel fail, and
+// compare the time to send the pages with one credit (a round trip per page, as before) with the
+// time taken with SHUFFLE_CHANNEL_CREDITS credits.
+
+#define NUM_PAGES 200
+#define PAGE_BYTES (64 * 1024)
+#define LATENCY_MICROS 1000
+
+using namespace pdb;
+
+// the acknowledgements waiting for their latency to pass, sent by a thread of their own
+struct AckQueue {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    std::deque<std::pair<std::chrono::steady_clock::time_point, bool>> acks;
+    bool done = false;
+    PDBCommunicator* communicator;
+    Handle<SimpleRequestResult> okAck;
+    Handle<SimpleRequestResult> failedAck;
+};
+
+void* sendAcks(void* arg) {
+    AckQueue* queue = (AckQueue*)arg;
+    std::string errMsg;
+    pthread_mutex_lock(&queue->mutex);
+    while ((queue->done == false) || (queue->acks.empty() == false)) {
+        if (queue->acks.empty()) {
+            pthread_cond_wait(&queue->cond, &queue->mutex);
+            continue;
+        }
+        auto ack = queue->acks.front();
+        queue->acks.pop_front();
+        pthread_mutex_unlock(&queue->mutex);
+        auto now = std::chrono::steady_clock::now();
+        if (ack.first > now) {
+            usleep(std::chrono::duration_cast<std::chrono::microseconds>(ack.first - now).count());
+        }
+        queue->communicator->sendObject(ack.second ? queue->okAck : queue->failedAck, errMsg);
+        pthread_mutex_lock(&queue->mutex);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return nullptr;
+}
+
+// the remote storage server: returns the exit code of the child process
+int receivePages(int listenFD, int failAt) {
+    PDBLoggerPtr logger = make_shared<PDBLogger>("testShuffleChannelReceiver.log");
+    PDBCommunicatorPtr communicator = make_shared<PDBCommunicator>();
+    std::string errMsg;
+    if (communicator->pointToInternet(logger, listenFD, errMsg)) {
+        return 1;
+    }
+    int noDelay = 1;
+    setsockopt(communicator->getSocketFD(), IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+    const UseTemporaryAllocationBlock tempBlock{1024 * 1024};
+    AckQueue queue;
+    pthread_mutex_init(&queue.mutex, nullptr);
+    pthread_cond_init(&queue.cond, nullptr);
+    queue.communicator = communicator.get();
+    queue.okAck = makeObject<SimpleRequestResult>(true, std::string(""));
+    queue.failedAck = makeObject<SimpleRequestResult>(false, std::string("no space left"));
+    getRecord(queue.okAck);
+    getRecord(queue.failedAck);
+    pthread_t acker;
+    pthread_create(&acker, nullptr, sendAcks, &queue);
+
+    int numReceived = 0;
+    int exitCode = 0;
+    char* requestBytes = (char*)malloc(1024);
+    char* page = (char*)malloc(PAGE_BYTES);
+    while (true) {
+        bool success;
+        size_t numBytes = communicator->getSizeOfNextObject();
+        if ((numBytes == 0) || (numBytes > 1024)) {
+            exitCode = 2;
+            break;
+        }
+        Handle<StorageAddObjectInLoop> request =
+            communicator->getNextObject<StorageAddObjectInLoop>(requestBytes, success, errMsg);
+        if (success == false) {
+            exitCode = 2;
+            break;
+        }
+        if (request->isLoopEnded()) {
+            pthread_mutex_lock(&queue.mutex);
+            queue.acks.push_back(std::make_pair(std::chrono::steady_clock::now(), true));
+            pthread_cond_signal(&queue.cond);
+            pthread_mutex_unlock(&queue.mutex);
+            exitCode = (numReceived == NUM_PAGES) ? 0 : 3;
+            break;
+        }
+        if ((request->isStoreAsPage() == false) || (request->getSetName() != "shuffle_set")) {
+            exitCode = 4;
+            break;
+        }
+        PageFrameHeader header;
+        if ((PageCodec::receiveHeader(communicator, header, errMsg) == false) ||
+            (header.numBytes != PAGE_BYTES) ||
+            (PageCodec::receivePage(communicator, header, page, errMsg) == false)) {
+            exitCode = 5;
+            break;
+        }
+        for (int i = 0; i < PAGE_BYTES / sizeof(int); i++) {
+            if (((int*)page)[i] != numReceived + i) {
+                exitCode = 6;
+            }
+        }
+        bool stored = (numReceived != failAt);
+        pthread_mutex_lock(&queue.mutex);
+        queue.acks.push_back(std::make_pair(
+            std::chrono::steady_clock::now() + std::chrono::microseconds(LATENCY_MICROS), stored));
+        pthread_cond_signal(&queue.cond);
+        pthread_mutex_unlock(&queue.mutex);
+        numReceived++;
+        if ((exitCode != 0) || (stored == false)) {
+            break;
+        }
+    }
+    pthread_mutex_lock(&queue.mutex);
+    queue.done = true;
+    pthread_cond_signal(&queue.cond);
+    pthread_mutex_unlock(&queue.mutex);
+    pthread_join(acker, nullptr);
+    free(page);
+    free(requestBytes);
+    return exitCode;
+}
+
+// sends the pages to a receiver in a child process, returns the seconds taken, or -1 on failure
+double sendPages(int numCredits, int failAt) {
+
+    int listenFD = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if ((bind(listenFD, (struct sockaddr*)&address, sizeof(address)) < 0) ||
+        (listen(listenFD, 1) < 0) ||
+        (getsockname(listenFD, (struct sockaddr*)&address, &length) < 0)) {
+        std::cout << "can't listen on a local port" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    pid_t child = fork();
+    if (child == 0) {
+        exit(receivePages(listenFD, failAt));
+    }
+    close(listenFD);
+
+    PDBLoggerPtr logger = make_shared<PDBLogger>("testShuffleChannel.log");
+    int* page = (int*)malloc(PAGE_BYTES);
+    bool allSent = true;
+    std::string errMsg;
+    auto begin = std::chrono::steady_clock::now();
+    bool closed;
+    {
+        ShuffleChannel channel(logger,
+                               "127.0.0.1",
+                               ntohs(address.sin_port),
+                               "shuffle_db",
+                               "shuffle_set",
+                               true,
+                               numCredits);
+        for (int i = 0; (i < NUM_PAGES) && allSent; i++) {
+            for (int j = 0; j < PAGE_BYTES / sizeof(int); j++) {
+                page[j] = i + j;
+            }
+            allSent = channel.sendPage(page, PAGE_BYTES, errMsg);
+        }
+        closed = channel.close(errMsg);
+    }
+    auto end = std::chrono::steady_clock::now();
+    free(page);
+
+    int status;
+    waitpid(child, &status, 0);
+    int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    if (failAt >= 0) {
+        if (allSent || closed) {
+            std::cout << "the channel did not fail after the receiver failed to store a page"
+                      << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        return -1;
+    }
+    if ((allSent == false) || (closed == false) || (exitCode != 0)) {
+        std::cout << "sending " << NUM_PAGES << " pages with " << numCredits
+                  << " credits failed, receiver exit code " << exitCode << ": " << errMsg
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+}
+
+int main(int argc, char* argv[]) {
+
+    // the receiver may close the connection while we are sending
+    signal(SIGPIPE, SIG_IGN);
+
+    double roundTripSeconds = sendPages(1, -1);
+    double creditSeconds = sendPages(SHUFFLE_CHANNEL_CREDITS, -1);
+    sendPages(SHUFFLE_CHANNEL_CREDITS, NUM_PAGES / 2);
+
+    std::cout << "one page in flight: " << roundTripSeconds << " s" << std::endl;
+    std::cout << SHUFFLE_CHANNEL_CREDITS << " pages in flight: " << creditSeconds << " s"
+              << std::endl;
+    std::cout << "speedup: " << roundTripSeconds / creditSeconds << "x" << std::endl;
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,303 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_SHUFFLE_SKEW_CC
+#define TEST_SHUFFLE_SKEW_CC
+
+#include <cstddef>
+#include "Ptr.h"
+#include "ComputeSource.h"
+#include "ComputeSink.h"
+#include "ComputeExecutor.h"
+#include "InterfaceFunctions.h"
+#include "TupleSpec.h"
+#include "TupleSet.h"
+#include "TupleSetMachine.h"
+#include "UseTemporaryAllocationBlock.h"
+#include "JoinTuple.h"
+#include "HeavyHitterSketch.h"
+#include "ShuffleSkew.h"
+
+#include <iostream>
+#include <map>
+#include <stdlib.h>
+#include <unordered_map>
+#include <vector>
+
+// ShuffleSkew unit test: we shuffle both sides of a hash partitioned join with PartitionedJoinSink,
+// the way the stages on NUM_NODES nodes do, but with the pages in memory. One key of the build
+// side has most of its tuples, so the build side sinks split it, and the other side is copied to
+// all of the partitions of the key, using the keys the nodes reported. We check that every pair
+// of tuples with the same key meets in one partition only, that the other keys stay in the
+// partition of their hash, that the build side is spread more evenly than without splitting, that
+// the partitions of a split key are all different, and that the sketch finds the heavy keys of a
+// skewed stream.
+
+#define NUM_NODES 2
+#define NUM_PARTITIONS_PER_NODE 4
+#define NUM_PARTITIONS (NUM_NODES * NUM_PARTITIONS_PER_NODE)
+#define NUM_KEYS 20000
+#define HEAVY_KEY 7
+#define NUM_HEAVY_BUILD (20 * NUM_KEYS)
+#define NUM_HEAVY_PROBE 1000
+#define BATCH_SIZE 1000
+#define PAGE_SIZE (256 * 1024)
+
+using namespace pdb;
+
+typedef JoinTuple<int, char[0]> Tuple;
+
+// the tuples of every key in every partition, for each side
+typedef std::vector<std::unordered_map<int, long>> PartitionCounts;
+
+void fail(std::string why) {
+    std::cout << why << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+TupleSpec makeSpec(std::string name, std::vector<std::string> atts) {
+    AttList attList;
+    for (auto& att : atts) {
+        attList.appendAttribute((char*)att.c_str());
+    }
+    return TupleSpec(name, attList);
+}
+
+// a batch of keys, and their hashes, the keys themselves, like the hashes of ints
+TupleSetPtr makeBatch(std::vector<int>& keys, size_t first, size_t numKeys) {
+    TupleSetPtr batch = std::make_shared<TupleSet>();
+    std::vector<Handle<int>>* keyColumn = new std::vector<Handle<int>>(numKeys);
+    std::vector<size_t>* hashColumn = new std::vector<size_t>(numKeys);
+    for (size_t i = 0; i < numKeys; i++) {
+        (*keyColumn)[i] = makeObject<int>(keys[first + i]);
+        (*hashColumn)[i] = keys[first + i];
+    }
+    batch->addColumn(0, keyColumn, true);
+    batch->addColumn(1, hashColumn, true);
+    return batch;
+}
+
+// takes the tuples out of the pages a sink wrote, by the partition they are in
+void readPages(std::vector<void*>& pages, PartitionCounts& counts) {
+    for (void* page : pages) {
+        Handle<Vector<Handle<Vector<Handle<JoinMap<Tuple>>>>>> maps =
+            ((Record<Vector<Handle<Vector<Handle<JoinMap<Tuple>>>>>>*)page)->getRootObject();
+        for (int i = 0; i < NUM_NODES; i++) {
+            for (int j = 0; j < NUM_PARTITIONS_PER_NODE; j++) {
+                JoinMap<Tuple>& map = *((*((*maps)[i]))[j]);
+                for (JoinMapIterator<Tuple> iter = map.begin(); iter != map.end(); ++iter) {
+                    JoinRecordList<Tuple>* list = *iter;
+                    for (size_t k = 0; k < list->size(); k++) {
+                        int key = (*list)[k].myData;
+                        if (list->getHash() != (size_t)key) {
+                            fail("key " + std::to_string(key) + " has the wrong hash");
+                        }
+                        counts[i * NUM_PARTITIONS_PER_NODE + j][key]++;
+                    }
+                    delete (list);
+                }
+            }
+        }
+        free(page);
+    }
+    pages.clear();
+}
+
+// shuffles the keys of a node with its own sink, the way a pipeline does, into pages
+void shuffle(std::vector<int>& keys, ShuffleSkewPtr skew, std::vector<void*>& pages) {
+    TupleSpec inputSchema = makeSpec("In", {"key", "hash"});
+    TupleSpec attsToOperateOn = makeSpec("In", {"hash"});
+    TupleSpec additionalAtts = makeSpec("In", {"key"});
+    std::vector<int> whereEveryoneGoes{0};
+    PartitionedJoinSink<Tuple> sink(NUM_PARTITIONS_PER_NODE,
+                                    NUM_NODES,
+                                    inputSchema,
+                                    attsToOperateOn,
+                                    additionalAtts,
+                                    whereEveryoneGoes);
+    sink.setShuffleSkew(skew);
+
+    // the batches are made before the pages, the keys are not written to them
+    std::vector<TupleSetPtr> batches;
+    for (size_t first = 0; first < keys.size(); first += BATCH_SIZE) {
+        size_t numKeys = std::min((size_t)BATCH_SIZE, keys.size() - first);
+        batches.push_back(makeBatch(keys, first, numKeys));
+    }
+
+    void* page = malloc(PAGE_SIZE);
+    UseTemporaryAllocationBlockPtr block =
+        std::make_shared<UseTemporaryAllocationBlock>(page, PAGE_SIZE);
+    Handle<Object> container = sink.createNewOutputContainer();
+    for (TupleSetPtr& batch : batches) {
+        try {
+            sink.writeOut(batch, container);
+        } catch (NotEnoughSpace& n) {
+            // the page is full, what was not written goes to another one
+            getRecord(container);
+            container = nullptr;
+            block = nullptr;
+            pages.push_back(page);
+            page = malloc(PAGE_SIZE);
+            block = std::make_shared<UseTemporaryAllocationBlock>(page, PAGE_SIZE);
+            container = sink.createNewOutputContainer();
+            sink.writeOut(batch, container);
+        }
+    }
+    getRecord(container);
+    container = nullptr;
+    block = nullptr;
+    pages.push_back(page);
+}
+
+int main(int argc, char* argv[]) {
+
+    makeObjectAllocatorBlock(64 * 1024 * 1024, true);
+
+    // the partitions of the copies of a key are all different, and start with its own
+    for (size_t hash = 0; hash < 1000; hash++) {
+        std::map<size_t, int> partitions;
+        for (int copy = 0; copy < NUM_PARTITIONS; copy++) {
+            partitions[ShuffleSkew::getPartition(
+                hash, copy, NUM_PARTITIONS_PER_NODE, NUM_NODES)]++;
+        }
+        if ((partitions.size() != NUM_PARTITIONS) ||
+            (ShuffleSkew::getPartition(hash, 0, NUM_PARTITIONS_PER_NODE, NUM_NODES) !=
+             hash % NUM_PARTITIONS)) {
+            fail("the partitions of hash " + std::to_string(hash) + " are wrong");
+        }
+    }
+
+    // the sketch finds the keys of a skewed stream, key k comes about 1 / (k + 1) of the time
+    HeavyHitterSketch sketch(SHUFFLE_SKEW_NUM_COUNTERS);
+    std::unordered_map<size_t, size_t> trueCounts;
+    srand(1);
+    for (int i = 0; i < 200 * 1000; i++) {
+        size_t key = (size_t)(NUM_KEYS / (1.0 + rand() % NUM_KEYS)) - 1;
+        sketch.add(key);
+        trueCounts[key]++;
+    }
+    size_t maxError = sketch.getNumAdded() / SHUFFLE_SKEW_NUM_COUNTERS;
+    std::vector<std::pair<size_t, size_t>> heavyHitters = sketch.getHeavyHitters(maxError);
+    for (auto& heavyHitter : heavyHitters) {
+        if ((heavyHitter.second > trueCounts[heavyHitter.first]) ||
+            (heavyHitter.second + maxError < trueCounts[heavyHitter.first])) {
+            fail("the sketch counts key " + std::to_string(heavyHitter.first) + " " +
+                 std::to_string(heavyHitter.second) + " times, it came " +
+                 std::to_string(trueCounts[heavyHitter.first]) + " times");
+        }
+    }
+    for (auto& trueCount : trueCounts) {
+        if ((trueCount.second > 2 * maxError) &&
+            (sketch.getLowerBound(trueCount.first) < trueCount.second - maxError)) {
+            fail("the sketch missed key " + std::to_string(trueCount.first));
+        }
+    }
+    std::cout << "the sketch found " << heavyHitters.size() << " heavy keys" << std::endl;
+
+    // the build side: every key once, and the heavy key most of the time, spread over the nodes
+    std::vector<std::vector<int>> buildKeys(NUM_NODES);
+    std::unordered_map<int, long> numBuild;
+    for (int i = 0; i < NUM_KEYS + NUM_HEAVY_BUILD; i++) {
+        int key = (i % 21 == 0 || i >= 21 * NUM_KEYS) ? (i / 21) % NUM_KEYS : HEAVY_KEY;
+        buildKeys[i % NUM_NODES].push_back(key);
+        numBuild[key]++;
+    }
+    PartitionCounts buildCounts(NUM_PARTITIONS);
+    ShuffleSkew master(NUM_PARTITIONS, NUM_NODES, false);
+    for (int node = 0; node < NUM_NODES; node++) {
+        ShuffleSkewPtr skew = std::make_shared<ShuffleSkew>(NUM_PARTITIONS, NUM_NODES, true);
+        std::vector<void*> pages;
+        shuffle(buildKeys[node], skew, pages);
+        readPages(pages, buildCounts);
+
+        // the report of the node goes to the master through a Vector
+        Handle<Vector<uint64_t>> report = makeObject<Vector<uint64_t>>();
+        skew->appendTo(*report);
+        if (!master.readFrom(*report)) {
+            fail("the report of node " + std::to_string(node) + " does not match");
+        }
+    }
+    std::cout << "build side: " << master.toString() << std::endl;
+
+    // only the heavy key is split, and the tuples of the other keys are in their partition
+    int fanout = master.getFanout(HEAVY_KEY);
+    if ((master.getNumSplitKeys() != 1) || (fanout < 2)) {
+        fail(std::to_string(master.getNumSplitKeys()) + " keys are split, the heavy key over " +
+             std::to_string(fanout) + " partitions");
+    }
+    int numPartitionsOfHeavyKey = 0;
+    for (int p = 0; p < NUM_PARTITIONS; p++) {
+        for (auto& count : buildCounts[p]) {
+            if ((count.first != HEAVY_KEY) && (count.first % NUM_PARTITIONS != p)) {
+                fail("key " + std::to_string(count.first) + " is in partition " +
+                     std::to_string(p));
+            }
+        }
+        numPartitionsOfHeavyKey += buildCounts[p].count(HEAVY_KEY);
+    }
+    if ((numPartitionsOfHeavyKey != fanout) || (buildCounts[HEAVY_KEY].count(HEAVY_KEY) == 0)) {
+        fail("the heavy key is in " + std::to_string(numPartitionsOfHeavyKey) + " partitions");
+    }
+
+    // it is spread more evenly than if the heavy key had stayed in its partition
+    double unsplitImbalance = (double)(numBuild[HEAVY_KEY] + NUM_KEYS / NUM_PARTITIONS) *
+        NUM_PARTITIONS / (NUM_KEYS + NUM_HEAVY_BUILD);
+    if (master.getImbalance() > unsplitImbalance / 2) {
+        fail("the build side is " + std::to_string(master.getImbalance()) +
+             " times the mean, without splitting it would be " +
+             std::to_string(unsplitImbalance));
+    }
+
+    // the other side gets the split keys, and copies the tuples of the heavy key
+    Handle<Vector<uint64_t>> splitKeys = makeObject<Vector<uint64_t>>();
+    master.appendSplitKeysTo(*splitKeys);
+    std::vector<std::vector<int>> probeKeys(NUM_NODES);
+    std::unordered_map<int, long> numProbe;
+    for (int i = 0; i < NUM_KEYS + NUM_HEAVY_PROBE; i++) {
+        int key = (i < NUM_KEYS) ? i : HEAVY_KEY;
+        probeKeys[i % NUM_NODES].push_back(key);
+        numProbe[key]++;
+    }
+    PartitionCounts probeCounts(NUM_PARTITIONS);
+    for (int node = 0; node < NUM_NODES; node++) {
+        ShuffleSkewPtr skew = std::make_shared<ShuffleSkew>(NUM_PARTITIONS, NUM_NODES, false);
+        skew->setSplitKeys(*splitKeys);
+        std::vector<void*> pages;
+        shuffle(probeKeys[node], skew, pages);
+        readPages(pages, probeCounts);
+        std::cout << "probe side on node " << node << ": " << skew->toString() << std::endl;
+    }
+
+    // every pair of tuples with the same key meets once
+    for (int key = 0; key < NUM_KEYS; key++) {
+        long numPairs = 0;
+        for (int p = 0; p < NUM_PARTITIONS; p++) {
+            if (buildCounts[p].count(key) && probeCounts[p].count(key)) {
+                numPairs += buildCounts[p][key] * probeCounts[p][key];
+            }
+        }
+        if (numPairs != numBuild[key] * numProbe[key]) {
+            fail("key " + std::to_string(key) + " has " + std::to_string(numPairs) +
+                 " pairs instead of " + std::to_string(numBuild[key] * numProbe[key]));
+        }
+    }
+    std::cout << "the heavy key is split over " << fanout << " partitions" << std::endl;
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
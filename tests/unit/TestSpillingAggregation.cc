@@ -0,0 +1,266 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_SPILLING_AGGREGATION_CC
+#define TEST_SPILLING_AGGREGATION_CC
+
+#include "DataTypes.h"
+#include "InterfaceFunctions.h"
+#include "UseTemporaryAllocationBlock.h"
+#include "AggregationMap.h"
+#include "AggregationProcessor.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <unordered_map>
+#include <vector>
+
+// AggregationProcessor spilling unit test: we aggregate more groups than fit in an output page,
+// the way SpillingAggregation does with temp sets, but with the spilled pages in memory. When the
+// output page is full its groups are spilled to FANOUT buckets; at the end the groups of every
+// bucket are aggregated on their own, and a bucket that still does not fit is split again at the
+// next level. We check that every group comes out once, with the right sum, that the spilled
+// groups are in the right buckets, and that the buckets had to be split. We also check that a
+// spill page too small for a single group fails the spill and keeps the groups in the output page.
+
+#define NUM_KEYS (200 * 1000)
+#define NUM_COPIES 4
+#define KEYS_PER_INPUT_PAGE 10000
+#define INPUT_PAGE_SIZE (1024 * 1024)
+#define OUTPUT_PAGE_SIZE (1024 * 1024)
+#define SPILL_PAGE_SIZE (256 * 1024)
+#define FANOUT 4
+#define MAX_LEVEL 3
+
+using namespace pdb;
+
+typedef AggregationProcessor<long, long> Processor;
+
+// the pages spilled to every bucket of every level
+std::vector<std::vector<std::vector<void*>>> buckets(MAX_LEVEL,
+                                                     std::vector<std::vector<void*>>(FANOUT));
+int deepestLevel = -1;
+long numSpillPages = 0;
+
+// the groups that came out, and the number of times each of them did
+std::unordered_map<long, long> results;
+std::unordered_map<long, int> numTimesOut;
+
+void fail(std::string why) {
+    std::cout << why << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// an input page like the combiner writes: a vector with the map of partition 0
+void* makeInputPage(long firstKey, long numKeys, long copy) {
+    void* page = malloc(INPUT_PAGE_SIZE);
+    UseTemporaryAllocationBlockPtr block =
+        std::make_shared<UseTemporaryAllocationBlock>(page, INPUT_PAGE_SIZE);
+    Handle<Vector<Handle<AggregationMap<long, long>>>> data =
+        makeObject<Vector<Handle<AggregationMap<long, long>>>>(1);
+    Handle<AggregationMap<long, long>> map = makeObject<AggregationMap<long, long>>();
+    map->setHashPartitionId(0);
+    data->push_back(map);
+    for (long key = firstKey; key < firstKey + numKeys; key++) {
+        (*map)[key] = key * NUM_COPIES + copy;
+    }
+    getRecord(data);
+    block = nullptr;
+    return page;
+}
+
+// writes the groups in the output page to the buckets of a level
+void spillTo(Processor& processor, int level) {
+    for (int i = 0; i < FANOUT; i++) {
+        if (processor.startSpill(level, FANOUT, i) == false) {
+            continue;
+        }
+        bool isFull = true;
+        while (isFull) {
+            void* page = malloc(SPILL_PAGE_SIZE);
+            isFull = processor.fillSpillPage(page, SPILL_PAGE_SIZE);
+            if (processor.hasSpillFailed()) {
+                fail("a group does not fit in a spill page of " + std::to_string(SPILL_PAGE_SIZE));
+            }
+            buckets[level][i].push_back(page);
+            numSpillPages++;
+        }
+    }
+    if (level > deepestLevel) {
+        deepestLevel = level;
+    }
+}
+
+// finalizes the groups in the output page and takes them out
+void emit(Processor& processor, void* page) {
+    processor.finalize();
+    processor.fillNextOutputPage();
+    processor.clearOutputPage();
+    processor.initialize();
+    Handle<Map<long, long>> map = ((Record<Map<long, long>>*)page)->getRootObject();
+    for (auto& group : *map) {
+        results[group.key] += group.value;
+        numTimesOut[group.key]++;
+    }
+}
+
+// checks that the spilled groups of a bucket are in that bucket
+void checkBucket(int level, int bucket) {
+    for (void* page : buckets[level][bucket]) {
+        Handle<Vector<Handle<AggregationMap<long, long>>>> data =
+            ((Record<Vector<Handle<AggregationMap<long, long>>>>*)page)->getRootObject();
+        if ((data->size() != 1) || ((*data)[0]->getHashPartitionId() != 0)) {
+            fail("a spill page is not a map of partition 0");
+        }
+        for (auto& group : *((*data)[0])) {
+            if (Processor::getSpillBucket(group.hash, level, FANOUT) != bucket) {
+                fail("group " + std::to_string(group.key) + " is in the wrong bucket");
+            }
+        }
+    }
+}
+
+void aggregateLevel(Processor& processor, void* page, int level) {
+    for (int i = 0; i < FANOUT; i++) {
+        if (buckets[level][i].empty()) {
+            continue;
+        }
+        checkBucket(level, i);
+        std::vector<void*> pages;
+        pages.swap(buckets[level][i]);
+        processor.loadOutputPage(page, OUTPUT_PAGE_SIZE);
+        bool isSplit = false;
+        for (void* inputPage : pages) {
+            processor.loadInputPage(inputPage);
+            while (processor.fillNextOutputPage()) {
+                if (level + 1 == MAX_LEVEL) {
+                    fail("the groups of a bucket can't be split any more");
+                }
+                spillTo(processor, level + 1);
+                processor.clearOutputPage();
+                processor.loadOutputPage(page, OUTPUT_PAGE_SIZE);
+                isSplit = true;
+            }
+            processor.clearInputPage();
+            free(inputPage);
+        }
+        if (isSplit) {
+            spillTo(processor, level + 1);
+            processor.clearOutputPage();
+            aggregateLevel(processor, page, level + 1);
+        } else {
+            emit(processor, page);
+        }
+    }
+}
+
+// a spill page that can't hold a single group stops the spill, and no group is lost
+void checkTooSmallSpillPage() {
+    void* outputPage = malloc(OUTPUT_PAGE_SIZE);
+    Processor processor(0);
+    processor.initialize();
+    processor.loadOutputPage(outputPage, OUTPUT_PAGE_SIZE);
+    void* inputPage = makeInputPage(0, KEYS_PER_INPUT_PAGE, 0);
+    processor.loadInputPage(inputPage);
+    if (processor.fillNextOutputPage()) {
+        fail("the groups of one input page do not fit in the output page");
+    }
+    processor.clearInputPage();
+    free(inputPage);
+
+    char tinyPage[64];
+    if (processor.startSpill(0, 1, 0) == false) {
+        fail("there is nothing to spill");
+    }
+    if (processor.fillSpillPage(tinyPage, sizeof(tinyPage)) == true) {
+        fail("a spill page too small for a group asks for another page");
+    }
+    if (processor.hasSpillFailed() == false) {
+        fail("a spill page too small for a group does not fail the spill");
+    }
+
+    processor.finalize();
+    processor.fillNextOutputPage();
+    processor.clearOutputPage();
+    Handle<Map<long, long>> map = ((Record<Map<long, long>>*)outputPage)->getRootObject();
+    if (map->size() != KEYS_PER_INPUT_PAGE) {
+        fail("the failed spill left " + std::to_string(map->size()) + " groups instead of " +
+             std::to_string(KEYS_PER_INPUT_PAGE));
+    }
+    free(outputPage);
+}
+
+int main(int argc, char* argv[]) {
+
+    makeObjectAllocatorBlock(16 * 1024 * 1024, true);
+    checkTooSmallSpillPage();
+    void* outputPage = malloc(OUTPUT_PAGE_SIZE);
+    Processor processor(0);
+    processor.initialize();
+    processor.loadOutputPage(outputPage, OUTPUT_PAGE_SIZE);
+
+    // every key comes NUM_COPIES times, in pages of KEYS_PER_INPUT_PAGE keys
+    int numSpills = 0;
+    for (long copy = 0; copy < NUM_COPIES; copy++) {
+        for (long firstKey = 0; firstKey < NUM_KEYS; firstKey += KEYS_PER_INPUT_PAGE) {
+            void* inputPage = makeInputPage(firstKey, KEYS_PER_INPUT_PAGE, copy);
+            processor.loadInputPage(inputPage);
+            while (processor.fillNextOutputPage()) {
+                spillTo(processor, 0);
+                processor.clearOutputPage();
+                processor.loadOutputPage(outputPage, OUTPUT_PAGE_SIZE);
+                numSpills++;
+            }
+            processor.clearInputPage();
+            free(inputPage);
+        }
+    }
+    if (numSpills == 0) {
+        fail("the groups fit in the output page, nothing was spilled");
+    }
+
+    // the groups left go to the buckets too, then the buckets are aggregated
+    spillTo(processor, 0);
+    processor.clearOutputPage();
+    aggregateLevel(processor, outputPage, 0);
+    free(outputPage);
+
+    if (deepestLevel < 1) {
+        fail("no bucket had to be split");
+    }
+    if (results.size() != NUM_KEYS) {
+        fail("got " + std::to_string(results.size()) + " groups instead of " +
+             std::to_string(NUM_KEYS));
+    }
+    for (long key = 0; key < NUM_KEYS; key++) {
+        if (numTimesOut[key] != 1) {
+            fail("group " + std::to_string(key) + " came out " +
+                 std::to_string(numTimesOut[key]) + " times");
+        }
+        long expected = key * NUM_COPIES * NUM_COPIES + NUM_COPIES * (NUM_COPIES - 1) / 2;
+        if (results[key] != expected) {
+            fail("group " + std::to_string(key) + " has " + std::to_string(results[key]) +
+                 " instead of " + std::to_string(expected));
+        }
+    }
+    std::cout << "spilled the output page " << numSpills << " times, " << numSpillPages
+              << " spill pages, down to level " << deepestLevel << std::endl;
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
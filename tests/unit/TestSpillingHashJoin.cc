@@ -0,0 +1,297 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_SPILLING_HASH_JOIN_CC
+#define TEST_SPILLING_HASH_JOIN_CC
+
+#include <cstddef>
+#include "Ptr.h"
+#include "ComputeSource.h"
+#include "ComputeSink.h"
+#include "ComputeExecutor.h"
+#include "InterfaceFunctions.h"
+#include "TupleSpec.h"
+#include "TupleSet.h"
+#include "TupleSetMachine.h"
+#include "UseTemporaryAllocationBlock.h"
+#include "JoinTuple.h"
+#include "PDBString.h"
+#include "SpillingHashJoin.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+// JoinSinkMerger spilling unit test: we build the hash tables of a hash partitioned join the way
+// SpillingHashJoin does, but with the spilled pages in memory. Only some of the partitions get a
+// hash table, and it is too small for their build side, so the rest of it is spilled, a page at a
+// time. Then the spilled build side of every partition is built again, a hash table at a time.
+// We check that every key comes out once, in its partition, that something was spilled and that
+// it took more than one hash table to build it again. We also check that copyPartitionMaps picks
+// the maps of a partition out of a page of the probe side, and that a merger whose value fits
+// neither in an empty hash table nor in a spill page fails instead of dropping it.
+
+#define NUM_KEYS (100 * 1000)
+#define KEYS_PER_INPUT_PAGE 20000
+#define NUM_PARTITIONS 4
+#define NUM_RESIDENT_PARTITIONS 2
+#define INPUT_PAGE_SIZE (2 * 1024 * 1024)
+#define TABLE_PAGE_SIZE (128 * 1024)
+#define SPILL_PAGE_SIZE (64 * 1024)
+#define SMALL_TABLE_PAGE_SIZE 1024
+#define LARGE_VALUE_SIZE 4000
+
+using namespace pdb;
+
+typedef JoinTuple<int, char[0]> Tuple;
+typedef JoinTuple<String, char[0]> StringTuple;
+
+// the number of times each key came out
+std::unordered_map<int, int> numTimesOut;
+
+void fail(std::string why) {
+    std::cout << why << std::endl;
+    exit(EXIT_FAILURE);
+}
+
+// an input page like the hash partition sink writes: a vector with a map for every partition
+void* makeInputPage(int firstKey, int numKeys) {
+    void* page = malloc(INPUT_PAGE_SIZE);
+    UseTemporaryAllocationBlockPtr block =
+        std::make_shared<UseTemporaryAllocationBlock>(page, INPUT_PAGE_SIZE);
+    Handle<Vector<Handle<JoinMap<Tuple>>>> data =
+        makeObject<Vector<Handle<JoinMap<Tuple>>>>(NUM_PARTITIONS);
+    for (int i = 0; i < NUM_PARTITIONS; i++) {
+        Handle<JoinMap<Tuple>> map = makeObject<JoinMap<Tuple>>(2, i, NUM_PARTITIONS);
+        data->push_back(map);
+    }
+    for (int key = firstKey; key < firstKey + numKeys; key++) {
+        Tuple& tuple = (*data)[key % NUM_PARTITIONS]->push(key);
+        tuple.myData = key;
+    }
+    getRecord(data);
+    block = nullptr;
+    return page;
+}
+
+// copies the record in a scratch page to a spill page of its own
+void* spill(void* scratchPage) {
+    size_t numBytes = ((Record<Object>*)scratchPage)->numBytes();
+    void* page = malloc(numBytes);
+    memcpy(page, scratchPage, numBytes);
+    return page;
+}
+
+// takes the keys out of a hash table of a partition
+void emit(void* page, int partitionId) {
+    Handle<JoinMap<Tuple>> map = ((Record<JoinMap<Tuple>>*)page)->getRootObject();
+    for (JoinMapIterator<Tuple> iter = map->begin(); iter != map->end(); ++iter) {
+        JoinRecordList<Tuple>* list = *iter;
+        for (size_t i = 0; i < list->size(); i++) {
+            int key = (*list)[i].myData;
+            if ((key % NUM_PARTITIONS != partitionId) || (list->getHash() != (size_t)key)) {
+                fail("key " + std::to_string(key) + " is in the wrong place");
+            }
+            numTimesOut[key]++;
+        }
+        delete (list);
+    }
+}
+
+// a value that does not fit in an empty hash table, or a spill page too small for a map, makes the
+// merger fail, and nothing is merged or spilled after that
+void checkTooSmallPages() {
+    void* inputPage = malloc(INPUT_PAGE_SIZE);
+    UseTemporaryAllocationBlockPtr block =
+        std::make_shared<UseTemporaryAllocationBlock>(inputPage, INPUT_PAGE_SIZE);
+    Handle<Vector<Handle<JoinMap<StringTuple>>>> data =
+        makeObject<Vector<Handle<JoinMap<StringTuple>>>>(1);
+    Handle<JoinMap<StringTuple>> map = makeObject<JoinMap<StringTuple>>(2, 0, 1);
+    data->push_back(map);
+    map->push(0).myData = String(std::string(LARGE_VALUE_SIZE, 'x'));
+    getRecord(data);
+    map = nullptr;
+    data = nullptr;
+    block = nullptr;
+    Handle<Object> maps = ((Record<Object>*)inputPage)->getRootObject();
+
+    std::shared_ptr<JoinSinkMerger<StringTuple>> merger =
+        std::make_shared<JoinSinkMerger<StringTuple>>();
+    char tinyPage[64];
+    merger->startPartition(maps, 0);
+    if (merger->fillSpillPage(tinyPage, sizeof(tinyPage)) || (merger->hasFailed() == false)) {
+        fail("a spill page that is too small for a map did not fail the merger");
+    }
+
+    merger = std::make_shared<JoinSinkMerger<StringTuple>>();
+    merger->startPartition(maps, 0);
+    void* smallPage = malloc(SMALL_TABLE_PAGE_SIZE);
+    block = std::make_shared<UseTemporaryAllocationBlock>(smallPage, SMALL_TABLE_PAGE_SIZE);
+    Handle<Object> table = merger->createNewOutputContainer();
+    if (merger->writePartitionOut(table) || (merger->hasFailed() == false)) {
+        fail("a value that does not fit in an empty hash table did not fail the merger");
+    }
+    void* scratchPage = malloc(SPILL_PAGE_SIZE);
+    if (merger->fillSpillPage(scratchPage, SPILL_PAGE_SIZE)) {
+        fail("a merger that failed spilled");
+    }
+    table = nullptr;
+    block = nullptr;
+    maps = nullptr;
+    free(scratchPage);
+    free(smallPage);
+    free(inputPage);
+}
+
+int main(int argc, char* argv[]) {
+
+    makeObjectAllocatorBlock(16 * 1024 * 1024, true);
+    std::vector<void*> inputPages;
+    for (int firstKey = 0; firstKey < NUM_KEYS; firstKey += KEYS_PER_INPUT_PAGE) {
+        inputPages.push_back(makeInputPage(firstKey, KEYS_PER_INPUT_PAGE));
+    }
+    checkTooSmallPages();
+    void* tablePage = malloc(TABLE_PAGE_SIZE);
+    void* scratchPage = malloc(SPILL_PAGE_SIZE);
+    int numSpillPages = 0;
+    int numTables = 0;
+
+    for (int i = 0; i < NUM_PARTITIONS; i++) {
+        std::shared_ptr<JoinSinkMerger<Tuple>> merger = std::make_shared<JoinSinkMerger<Tuple>>();
+        bool isResident = (i < NUM_RESIDENT_PARTITIONS);
+        bool isSpilled = false;
+        std::vector<void*> spillPages;
+
+        // the build side goes to the hash table as long as it fits, then it is spilled
+        UseTemporaryAllocationBlockPtr block = nullptr;
+        Handle<Object> table = nullptr;
+        if (isResident) {
+            block = std::make_shared<UseTemporaryAllocationBlock>(tablePage, TABLE_PAGE_SIZE);
+            table = merger->createNewOutputContainer();
+        }
+        for (void* inputPage : inputPages) {
+            merger->startPartition(((Record<Object>*)inputPage)->getRootObject(), i);
+            if (isResident && (isSpilled == false) && merger->writePartitionOut(table)) {
+                continue;
+            }
+            while (merger->fillSpillPage(scratchPage, SPILL_PAGE_SIZE)) {
+                spillPages.push_back(spill(scratchPage));
+                isSpilled = true;
+            }
+        }
+        if (isResident) {
+            getRecord(table);
+            block = nullptr;
+            table = nullptr;
+            emit(tablePage, i);
+        }
+        if (isSpilled == false) {
+            fail("partition " + std::to_string(i) + " did not spill");
+        }
+        numSpillPages += spillPages.size();
+
+        // and the spilled build side is built again, as many times as it takes
+        size_t nextPage = 0;
+        bool isMerging = false;
+        int numParts = 0;
+        bool isLastPart = false;
+        while (isLastPart == false) {
+            block = std::make_shared<UseTemporaryAllocationBlock>(tablePage, TABLE_PAGE_SIZE);
+            table = merger->createNewOutputContainer();
+            isLastPart = true;
+            while (true) {
+                if (isMerging) {
+                    if (merger->writePartitionOut(table) == false) {
+                        isLastPart = false;
+                        break;
+                    }
+                    isMerging = false;
+                }
+                if (nextPage == spillPages.size()) {
+                    break;
+                }
+                Handle<Vector<Handle<JoinMap<Tuple>>>> maps =
+                    ((Record<Vector<Handle<JoinMap<Tuple>>>>*)spillPages[nextPage])
+                        ->getRootObject();
+                if ((maps->size() != 1) || ((*maps)[0]->getPartitionId() != i)) {
+                    fail("a spill page is not a map of partition " + std::to_string(i));
+                }
+                merger->startPartition(unsafeCast<Object>(maps), i);
+                isMerging = true;
+                nextPage++;
+            }
+            getRecord(table);
+            block = nullptr;
+            table = nullptr;
+            emit(tablePage, i);
+            numParts++;
+        }
+        if (numParts < 2) {
+            fail("the spilled build side of partition " + std::to_string(i) + " fit in one table");
+        }
+        numTables += numParts;
+        for (void* spillPage : spillPages) {
+            free(spillPage);
+        }
+    }
+
+    if (numTimesOut.size() != NUM_KEYS) {
+        fail("got " + std::to_string(numTimesOut.size()) + " keys instead of " +
+             std::to_string(NUM_KEYS));
+    }
+    for (int key = 0; key < NUM_KEYS; key++) {
+        if (numTimesOut[key] != 1) {
+            fail("key " + std::to_string(key) + " came out " + std::to_string(numTimesOut[key]) +
+                 " times");
+        }
+    }
+
+    // the maps of a partition in a page of the probe side are copied with their keys
+    void* copyPage = malloc(INPUT_PAGE_SIZE);
+    for (int i = 0; i < NUM_PARTITIONS; i++) {
+        Record<Object>* copy = SpillingHashJoin::copyPartitionMaps(
+            (Record<Object>*)inputPages[0], i, copyPage, INPUT_PAGE_SIZE);
+        if (copy == nullptr) {
+            fail("the maps of partition " + std::to_string(i) + " were not copied");
+        }
+        Handle<Vector<Handle<JoinMap<Tuple>>>> maps =
+            ((Record<Vector<Handle<JoinMap<Tuple>>>>*)copy)->getRootObject();
+        if ((maps->size() != 1) || ((*maps)[0]->getPartitionId() != i) ||
+            ((*maps)[0]->size() != KEYS_PER_INPUT_PAGE / NUM_PARTITIONS)) {
+            fail("the copied maps of partition " + std::to_string(i) + " are wrong");
+        }
+    }
+    if (SpillingHashJoin::copyPartitionMaps(
+            (Record<Object>*)inputPages[0], NUM_PARTITIONS, copyPage, INPUT_PAGE_SIZE) != nullptr) {
+        fail("maps were copied for a partition that has none");
+    }
+    free(copyPage);
+
+    for (void* inputPage : inputPages) {
+        free(inputPage);
+    }
+    free(tablePage);
+    free(scratchPage);
+    std::cout << "spilled " << numSpillPages << " pages, built again in " << numTables
+              << " hash tables" << std::endl;
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,213 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_TUPLE_SET_SELECTION_CC
+#define TEST_TUPLE_SET_SELECTION_CC
+
+#include <cstddef>
+#include <iostream>
+#include "Ptr.h"
+#include "ComputeSource.h"
+#include "ComputeSink.h"
+#include "ComputeExecutor.h"
+#include "ComputeInfo.h"
+#include "InterfaceFunctions.h"
+#include "TupleSpec.h"
+#include "TupleSet.h"
+#include "TupleSetMachine.h"
+#include "FilterExecutor.h"
+
+#include <chrono>
+#include <stdlib.h>
+
+// TupleSet unit test and benchmark: runs a chain of predicates and filters, like the ones of
+// TPC-H Q06, over batches of rows, checks that the rows that come out are the right ones, and
+// compares the time with filters that copy every column, which is what FilterExecutor used to do.
+
+#define NUM_ROWS (1024 * 1024)
+#define NUM_PAYLOAD_COLUMNS 8
+#define NUM_BATCHES 10
+
+using namespace pdb;
+
+// computes (key % divisor == 0) into a new bool column, the way the lambdas do
+class DivisibleExecutor : public ComputeExecutor {
+
+private:
+    TupleSetPtr output;
+    TupleSetSetupMachine myMachine;
+    int whichAtt;
+    int outAtt;
+    int divisor;
+
+public:
+    DivisibleExecutor(TupleSpec& inputSchema,
+                      TupleSpec& attsToOperateOn,
+                      TupleSpec& attsToIncludeInOutput,
+                      int divisor)
+        : myMachine(inputSchema, attsToIncludeInOutput), divisor(divisor) {
+        output = std::make_shared<TupleSet>();
+        whichAtt = myMachine.match(attsToOperateOn)[0];
+        outAtt = attsToIncludeInOutput.getAtts().size();
+    }
+
+    TupleSetPtr process(TupleSetPtr input) override {
+        myMachine.setup(input, output);
+        std::vector<int>& inColumn = input->getColumn<int>(whichAtt);
+        if (!output->hasColumn(outAtt)) {
+            output->addColumn(outAtt, new std::vector<bool>(), true);
+        }
+        std::vector<bool>& outColumn = output->getColumn<bool>(outAtt);
+        outColumn.resize(inColumn.size());
+        for (size_t i = 0; i < inColumn.size(); i++) {
+            outColumn[i] = (inColumn[i] % divisor == 0);
+        }
+        return output;
+    }
+
+    std::string getType() override {
+        return "DIVISIBLE";
+    }
+};
+
+// the filter that copies all of the columns at each predicate, the baseline
+class CopyingFilterExecutor : public ComputeExecutor {
+
+private:
+    TupleSetPtr output;
+    int whichAtt;
+    TupleSetSetupMachine myMachine;
+
+public:
+    CopyingFilterExecutor(TupleSpec& inputSchema,
+                          TupleSpec& attsToOperateOn,
+                          TupleSpec& attsToIncludeInOutput)
+        : myMachine(inputSchema, attsToIncludeInOutput) {
+        output = std::make_shared<TupleSet>();
+        whichAtt = myMachine.match(attsToOperateOn)[0];
+    }
+
+    TupleSetPtr process(TupleSetPtr input) override {
+        myMachine.setup(input, output);
+        std::vector<bool>& inputColumn = input->getColumn<bool>(whichAtt);
+        int numColumns = output->getNumColumns();
+        for (int i = 0; i < numColumns; i++) {
+            output->filterColumn(i, inputColumn);
+        }
+        return output;
+    }
+
+    std::string getType() override {
+        return "FILTER";
+    }
+};
+
+TupleSpec makeSpec(std::string name, std::vector<std::string> atts) {
+    AttList attList;
+    for (auto& att : atts) {
+        attList.appendAttribute((char*)att.c_str());
+    }
+    return TupleSpec(name, attList);
+}
+
+// builds key % 2, % 3 and % 5 filters over the key and payload columns, returns the time it took
+// to push the batches through, or a negative number if the wrong rows came out
+template <class Filter>
+double runChain() {
+
+    std::vector<std::string> atts = {"key"};
+    for (int i = 0; i < NUM_PAYLOAD_COLUMNS; i++) {
+        atts.push_back("payload" + std::to_string(i));
+    }
+    std::vector<std::string> attsWithBool = atts;
+    attsWithBool.push_back("bool");
+
+    TupleSpec allAtts = makeSpec("in", atts);
+    TupleSpec keyAtt = makeSpec("in", {"key"});
+    TupleSpec withBool = makeSpec("withBool", attsWithBool);
+    TupleSpec boolAtt = makeSpec("withBool", {"bool"});
+
+    std::vector<ComputeExecutorPtr> chain;
+    std::vector<int> divisors = {2, 3, 5};
+    for (int divisor : divisors) {
+        chain.push_back(std::make_shared<DivisibleExecutor>(allAtts, keyAtt, allAtts, divisor));
+        chain.push_back(std::make_shared<Filter>(withBool, boolAtt, allAtts));
+    }
+
+    // the source columns
+    TupleSetPtr source = std::make_shared<TupleSet>();
+    std::vector<int>* keys = new std::vector<int>(NUM_ROWS);
+    for (int i = 0; i < NUM_ROWS; i++) {
+        (*keys)[i] = i;
+    }
+    source->addColumn(0, keys, true);
+    for (int j = 0; j < NUM_PAYLOAD_COLUMNS; j++) {
+        std::vector<double>* payload = new std::vector<double>(NUM_ROWS);
+        for (int i = 0; i < NUM_ROWS; i++) {
+            (*payload)[i] = i * (j + 1);
+        }
+        source->addColumn(j + 1, payload, true);
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    bool isCorrect = true;
+    for (int batch = 0; batch < NUM_BATCHES; batch++) {
+        TupleSetPtr current = source;
+        for (auto& executor : chain) {
+            current = executor->process(current);
+        }
+
+        // the sink reads every column
+        std::vector<int>& outKeys = current->getColumn<int>(0);
+        if (outKeys.size() != (NUM_ROWS + 29) / 30) {
+            isCorrect = false;
+        }
+        for (int j = 0; j < NUM_PAYLOAD_COLUMNS; j++) {
+            std::vector<double>& outPayload = current->getColumn<double>(j + 1);
+            for (size_t i = 0; i < outKeys.size(); i++) {
+                if ((outKeys[i] % 30 != 0) || (outPayload[i] != outKeys[i] * (double)(j + 1))) {
+                    isCorrect = false;
+                }
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (!isCorrect) {
+        return -1;
+    }
+    return std::chrono::duration_cast<std::chrono::duration<double>>(end - begin).count();
+}
+
+int main(int argc, char* argv[]) {
+
+    makeObjectAllocatorBlock(16 * 1024 * 1024, true);
+
+    double copyingSeconds = runChain<CopyingFilterExecutor>();
+    double selectionSeconds = runChain<FilterExecutor>();
+    if ((copyingSeconds < 0) || (selectionSeconds < 0)) {
+        std::cout << "the filters let the wrong rows through!" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::cout << "copying filters: " << copyingSeconds << "s, selection vectors: "
+              << selectionSeconds << "s, speedup " << copyingSeconds / selectionSeconds
+              << std::endl;
+
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif
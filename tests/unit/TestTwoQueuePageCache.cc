@@ -0,0 +1,150 @@
+/*****************************************************************************
+ *                                                                           *
+ *  Copyright 2018 Rice University                                           *
+ *                                                                           *
+ *  Licensed under the Apache License, Version 2.0 (the "License");          *
+ *  you may not use this file except in compliance with the License.         *
+ *  You may obtain a copy of the License at                                  *
+ *                                                                           *
+ *      http://www.apache.org/licenses/LICENSE-2.0                           *
+ *                                                                           *
+ *  Unless required by applicable law or agreed to in writing, software      *
+ *  distributed under the License is distributed on an "AS IS" BASIS,        *
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *
+ *  See the License for the specific language governing permissions and      *
+ *  limitations under the License.                                           *
+ *                                                                           *
+ *****************************************************************************/
+#ifndef TEST_TWO_QUEUE_PAGE_CACHE_CC
+#define TEST_TWO_QUEUE_PAGE_CACHE_CC
+
+#include "PageCache.h"
+#include "PageCircularBuffer.h"
+#include "SharedMem.h"
+#include "Configuration.h"
+#include "PDBWorkerQueue.h"
+
+#include <iostream>
+#include <stdlib.h>
+#include <unordered_set>
+
+// PageCache unit test for the UnifiedTwoQueue strategy: a sequential scan much larger than the
+// cache must not evict the pages that are being reused, and only evicted pages leave a ghost.
+
+#define NUM_REUSED_PAGES 8
+#define NUM_SCANNED_PAGES 256
+
+CacheKey makeKey(SetID setId, PageID pageId) {
+    CacheKey key;
+    key.dbId = 1;
+    key.typeId = 1;
+    key.setId = setId;
+    key.pageId = pageId;
+    return key;
+}
+
+// allocate a clean page, so that the eviction can free it without flushing it
+void addCleanPage(PageCache& cache, CacheKey key, size_t pageSize) {
+    PDBPagePtr page = cache.getNewPage(0, key, nullptr, pageSize);
+    if (page == nullptr) {
+        std::cout << "can't allocate page " << key.pageId << ", exit..." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    page->setDirty(false);
+    cache.decPageRefCount(key);
+}
+
+int main(int argc, char* argv[]) {
+
+    // the keys that used to collide in CacheKeyHash must hash differently now
+    CacheKeyHash hash;
+    if (hash(makeKey(1, 0)) == hash(makeKey(0, 256))) {
+        std::cout << "CacheKeyHash collision for pageId > 255" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::unordered_set<size_t> hashes;
+    for (SetID setId = 0; setId < 16; setId++) {
+        for (PageID pageId = 0; pageId < 4096; pageId++) {
+            hashes.insert(hash(makeKey(setId, pageId)));
+        }
+    }
+    if (hashes.size() != 16 * 4096) {
+        std::cout << "CacheKeyHash collisions: " << 16 * 4096 - hashes.size() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    size_t pageSize = 1024 * 1024;
+
+    // a page removed because it is not needed anymore comes back into the recent queue, a page
+    // evicted from the recent queue comes back into the frequent queue
+    TwoQueueReplacer replacer((size_t)64 * 1024 * 1024, pageSize);
+    static char header[1024] = {0};
+    PDBPagePtr page = make_shared<PDBPage>(header, 0, 0);
+    replacer.addPage(makeKey(3, 0), page);
+    replacer.removePage(makeKey(3, 0), false);
+    if (replacer.getNumGhosts() != 0) {
+        std::cout << "a page removed from the cache is remembered as a ghost" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    replacer.addPage(makeKey(3, 0), page);
+    if (replacer.getNumRecentPages() != 1) {
+        std::cout << "a page added again after its removal is not in the recent queue" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    replacer.removePage(makeKey(3, 0), true);
+    replacer.addPage(makeKey(3, 0), page);
+    if ((replacer.getNumGhosts() != 0) || (replacer.getNumFrequentPages() != 1)) {
+        std::cout << "a page loaded again after its eviction is not in the frequent queue"
+                  << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    ConfigurationPtr conf = make_shared<Configuration>();
+    conf->setPageSize(pageSize);
+    conf->setShufflePageSize(pageSize);
+    conf->setBroadcastPageSize(pageSize);
+    conf->setMaxPageSize(pageSize);
+    conf->setShmSize((size_t)64 * 1024 * 1024);
+    pdb::PDBLoggerPtr logger = make_shared<pdb::PDBLogger>("testTwoQueuePageCache.log");
+    SharedMemPtr shm = make_shared<SharedMem>(conf->getShmSize(), logger);
+    pdb::PDBWorkerQueuePtr workers = make_shared<pdb::PDBWorkerQueue>(logger, 4);
+    PageCircularBufferPtr flushBuffer = make_shared<PageCircularBuffer>(16, logger);
+    PageCache cache(conf, workers, flushBuffer, logger, shm, UnifiedTwoQueue);
+
+    // the pages of a hash table that are read over and over
+    for (PageID i = 0; i < NUM_REUSED_PAGES; i++) {
+        addCleanPage(cache, makeKey(2, i), pageSize);
+    }
+    for (PageID i = 0; i < NUM_REUSED_PAGES; i++) {
+        if (cache.getPage(makeKey(2, i)) == nullptr) {
+            std::cout << "reused page " << i << " is not in cache" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        cache.decPageRefCount(makeKey(2, i));
+    }
+
+    // a scan over a set four times the size of the cache
+    for (PageID i = 0; i < NUM_SCANNED_PAGES; i++) {
+        addCleanPage(cache, makeKey(1, i), pageSize);
+    }
+
+    for (PageID i = 0; i < NUM_REUSED_PAGES; i++) {
+        if (cache.containsPage(makeKey(2, i)) == false) {
+            std::cout << "reused page " << i << " was evicted by the scan" << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    CacheStats stats = cache.getStats();
+    std::cout << "cache stats: " << stats.toString() << std::endl;
+    if ((stats.numHits != NUM_REUSED_PAGES) ||
+        (stats.numCached != NUM_REUSED_PAGES + NUM_SCANNED_PAGES) || (stats.numEvicted == 0)) {
+        std::cout << "wrong cache stats" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::cout << "finish!" << std::endl;
+    return 0;
+}
+
+#endif